@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/arith.h>
+#include "isa_fixture.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 16;
+
+// Request/response latency pairs: start times a few per millisecond, each
+// followed by an end time up to 10ms later. Almost every pair shares the
+// same second; a few cross a second, minute or day boundary.
+struct latency_pairs
+{
+    std::vector<nanotime> starts;
+    std::vector<nanotime> ends;
+};
+
+static latency_pairs make_latency_pairs()
+{
+    std::mt19937_64 rng(1);
+    latency_pairs pairs;
+    pairs.starts.resize(count);
+    pairs.ends.resize(count);
+    int64_t current = 1500000000LL * 1000000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += (int64_t)(rng() % 500000);
+        pairs.starts[i] = nanotime_from_unix_nanoseconds(current);
+        pairs.ends[i] = nanotime_from_unix_nanoseconds(current + (int64_t)(rng() % 10000000));
+    }
+    return pairs;
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void diff_via_epoch(benchmark::State& state)
+{
+    latency_pairs pairs = make_latency_pairs();
+    std::vector<int64_t> durations(count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            durations[i] = nanotime_to_unix_nanoseconds(pairs.ends[i]) - nanotime_to_unix_nanoseconds(pairs.starts[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(diff_via_epoch);
+
+static void diff_inline(benchmark::State& state)
+{
+    latency_pairs pairs = make_latency_pairs();
+    std::vector<int64_t> durations(count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            durations[i] = nanotime_diff_ns(pairs.ends[i], pairs.starts[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(diff_inline);
+
+static void diff_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    latency_pairs pairs = make_latency_pairs();
+    std::vector<int64_t> durations(count);
+    for(auto _: state)
+    {
+        nanotime_batch_diff_ns(pairs.ends.data(), pairs.starts.data(), count, durations.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(diff_batch, );
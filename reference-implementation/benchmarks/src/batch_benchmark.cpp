@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/batch.h>
+#include "isa_fixture.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static std::vector<smalltime> make_smalltimes(size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        value = smalltime_new(1900 + rng() % 200, 1 + rng() % 12, 1 + rng() % 28,
+            rng() % 24, rng() % 60, rng() % 60, rng() % 1000000);
+    }
+    return values;
+}
+
+static std::vector<nanotime> make_nanotimes(size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        value = nanotime_new(1970 + rng() % 200, 1 + rng() % 12, 1 + rng() % 28,
+            rng() % 24, rng() % 60, rng() % 60, rng() % 1000000000);
+    }
+    return values;
+}
+
+struct column_storage
+{
+    std::vector<int> year, month, day, hour, minute, second, fraction;
+
+    explicit column_storage(size_t count)
+    : year(count), month(count), day(count), hour(count), minute(count), second(count), fraction(count)
+    {}
+
+    smalltime_columns smalltime() { return {year.data(), month.data(), day.data(), hour.data(), minute.data(), second.data(), fraction.data()}; }
+    nanotime_columns nanotime() { return {year.data(), month.data(), day.data(), hour.data(), minute.data(), second.data(), fraction.data()}; }
+};
+
+static void run_smalltime_decode(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    size_t count = state.range(0);
+    std::vector<smalltime> values = make_smalltimes(count);
+    column_storage storage(count);
+    smalltime_columns columns = storage.smalltime();
+    for(auto _: state)
+    {
+        smalltime_batch_decode(values.data(), count, &columns);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void run_smalltime_encode(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    size_t count = state.range(0);
+    std::vector<smalltime> values = make_smalltimes(count);
+    column_storage storage(count);
+    smalltime_columns columns = storage.smalltime();
+    smalltime_batch_decode(values.data(), count, &columns);
+    for(auto _: state)
+    {
+        smalltime_batch_encode(&columns, count, values.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void run_nanotime_decode(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    size_t count = state.range(0);
+    std::vector<nanotime> values = make_nanotimes(count);
+    column_storage storage(count);
+    nanotime_columns columns = storage.nanotime();
+    for(auto _: state)
+    {
+        nanotime_batch_decode(values.data(), count, &columns);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void run_nanotime_encode(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    size_t count = state.range(0);
+    std::vector<nanotime> values = make_nanotimes(count);
+    column_storage storage(count);
+    nanotime_columns columns = storage.nanotime();
+    nanotime_batch_decode(values.data(), count, &columns);
+    for(auto _: state)
+    {
+        nanotime_batch_encode(&columns, count, values.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+#define BATCH_SIZES ->Arg(4096)->Arg(1 << 20)
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+REGISTER_ALL_ISAS(run_smalltime_decode, BATCH_SIZES);
+REGISTER_ALL_ISAS(run_smalltime_encode, BATCH_SIZES);
+REGISTER_ALL_ISAS(run_nanotime_decode, BATCH_SIZES);
+REGISTER_ALL_ISAS(run_nanotime_encode, BATCH_SIZES);
@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/calendar.h>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t calendar_count = 1 << 20;
+
+// Dates, selected by the benchmark argument.
+//  0: Random days from 1970 to 2100.
+//  1: Every minute from 2018-01-01, so most values repeat the date before.
+#define DATES ->Arg(0)->Arg(1)
+
+static std::vector<smalltime> make_dates(int kind)
+{
+    std::vector<smalltime> values(calendar_count);
+    std::mt19937_64 random(20);
+    int32_t first = smalltime_days_from_civil(1970, 1, 1);
+    int32_t last = smalltime_days_from_civil(2100, 12, 31);
+    std::uniform_int_distribution<int32_t> days(first, last);
+    int32_t start = smalltime_days_from_civil(2018, 1, 1);
+    for(size_t i = 0; i < calendar_count; i++)
+    {
+        int32_t n = kind == 0 ? days(random) : start + (int32_t)(i / 1440);
+        int year, month, day;
+        smalltime_civil_from_days(n, &year, &month, &day);
+        values[i] = smalltime_new(year, month, day, (int)(i / 60 % 24), (int)(i % 60), 0, 0);
+    }
+    return values;
+}
+
+struct calendar_outputs
+{
+    std::vector<int> weekday = std::vector<int>(calendar_count);
+    std::vector<int> day_of_year = std::vector<int>(calendar_count);
+    std::vector<int> iso_week = std::vector<int>(calendar_count);
+    std::vector<int> iso_week_year = std::vector<int>(calendar_count);
+};
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * calendar_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// Converting to a day count and working from that, as with struct tm.
+static void calendar_via_day_count(benchmark::State& state)
+{
+    std::vector<smalltime> values = make_dates((int)state.range(0));
+    calendar_outputs out;
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < calendar_count; i++)
+        {
+            smalltime time = values[i];
+            int year = smalltime_get_year(time);
+            int32_t n = smalltime_days_from_civil(year, smalltime_get_month(time), smalltime_get_day(time));
+            int weekday = (n % 7 + 10) % 7 + 1;
+            int32_t thursday = n - weekday + 4;
+            int thursday_year, month, day;
+            smalltime_civil_from_days(thursday, &thursday_year, &month, &day);
+            out.weekday[i] = weekday;
+            out.day_of_year[i] = n - smalltime_days_from_civil(year, 1, 1) + 1;
+            out.iso_week[i] = (thursday - smalltime_days_from_civil(thursday_year, 1, 1)) / 7 + 1;
+            out.iso_week_year[i] = thursday_year;
+        }
+        benchmark::DoNotOptimize(out.iso_week.data());
+    }
+    report(state);
+}
+BENCHMARK(calendar_via_day_count) DATES;
+
+static void calendar_getters(benchmark::State& state)
+{
+    std::vector<smalltime> values = make_dates((int)state.range(0));
+    calendar_outputs out;
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < calendar_count; i++)
+        {
+            out.weekday[i] = smalltime_get_weekday(values[i]);
+            out.day_of_year[i] = smalltime_get_day_of_year(values[i]);
+            out.iso_week[i] = smalltime_get_iso_week(values[i]);
+            out.iso_week_year[i] = smalltime_get_iso_week_year(values[i]);
+        }
+        benchmark::DoNotOptimize(out.iso_week.data());
+    }
+    report(state);
+}
+BENCHMARK(calendar_getters) DATES;
+
+static void calendar_batch(benchmark::State& state)
+{
+    std::vector<smalltime> values = make_dates((int)state.range(0));
+    calendar_outputs out;
+    smalltime_calendar_columns columns = {out.weekday.data(), out.day_of_year.data(), out.iso_week.data(), out.iso_week_year.data()};
+    for(auto _: state)
+    {
+        smalltime_batch_calendar(values.data(), calendar_count, &columns);
+        benchmark::DoNotOptimize(out.iso_week.data());
+    }
+    report(state);
+}
+BENCHMARK(calendar_batch) DATES;
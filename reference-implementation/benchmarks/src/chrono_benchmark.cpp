@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/chrono.h>
+
+#if __cplusplus >= 202002L
+#include <random>
+#include <vector>
+
+using namespace smalltime_cpp;
+using namespace std::chrono;
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t chrono_count = 1 << 20;
+
+static std::vector<sys_time<microseconds>> make_sys_times()
+{
+    std::mt19937_64 random(22);
+    int64_t first = duration_cast<microseconds>(sys_days(1970y / 1 / 1d).time_since_epoch()).count();
+    int64_t last = duration_cast<microseconds>(sys_days(2100y / 12 / 31d).time_since_epoch()).count();
+    std::uniform_int_distribution<int64_t> ticks(first, last);
+    std::vector<sys_time<microseconds>> times(chrono_count);
+    for(auto& time: times)
+    {
+        time = sys_time<microseconds>(microseconds(ticks(random)));
+    }
+    return times;
+}
+
+// Broken down the std::chrono way, to compare with the packed fields.
+struct chrono_fields
+{
+    year_month_day date;
+    hh_mm_ss<microseconds> time_of_day;
+};
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * chrono_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void chrono_sys_to_fields_std(benchmark::State& state)
+{
+    std::vector<sys_time<microseconds>> times = make_sys_times();
+    std::vector<chrono_fields> fields(chrono_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < chrono_count; i++)
+        {
+            sys_days day = floor<days>(times[i]);
+            fields[i] = {year_month_day(day), hh_mm_ss<microseconds>(times[i] - day)};
+        }
+        benchmark::DoNotOptimize(fields.data());
+    }
+    report(state);
+}
+BENCHMARK(chrono_sys_to_fields_std);
+
+static void chrono_sys_to_fields_packed(benchmark::State& state)
+{
+    std::vector<sys_time<microseconds>> times = make_sys_times();
+    std::vector<packed_smalltime> values(chrono_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < chrono_count; i++)
+        {
+            values[i] = from_sys_time<packed_smalltime>(times[i]);
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(chrono_sys_to_fields_packed);
+
+static void chrono_fields_to_sys_std(benchmark::State& state)
+{
+    std::vector<sys_time<microseconds>> times = make_sys_times();
+    std::vector<chrono_fields> fields(chrono_count);
+    for(size_t i = 0; i < chrono_count; i++)
+    {
+        sys_days day = floor<days>(times[i]);
+        fields[i] = {year_month_day(day), hh_mm_ss<microseconds>(times[i] - day)};
+    }
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < chrono_count; i++)
+        {
+            const hh_mm_ss<microseconds>& t = fields[i].time_of_day;
+            times[i] = sys_days(fields[i].date) + t.hours() + t.minutes() + t.seconds() + t.subseconds();
+        }
+        benchmark::DoNotOptimize(times.data());
+    }
+    report(state);
+}
+BENCHMARK(chrono_fields_to_sys_std);
+
+static void chrono_fields_to_sys_packed(benchmark::State& state)
+{
+    std::vector<sys_time<microseconds>> times = make_sys_times();
+    std::vector<packed_smalltime> values(chrono_count);
+    for(size_t i = 0; i < chrono_count; i++)
+    {
+        values[i] = from_sys_time<packed_smalltime>(times[i]);
+    }
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < chrono_count; i++)
+        {
+            times[i] = to_sys_time(values[i]);
+        }
+        benchmark::DoNotOptimize(times.data());
+    }
+    report(state);
+}
+BENCHMARK(chrono_fields_to_sys_packed);
+
+static void chrono_now_system_clock(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(system_clock::now());
+    }
+}
+BENCHMARK(chrono_now_system_clock);
+
+static void chrono_now_smalltime_clock(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(smalltime_clock::now());
+    }
+}
+BENCHMARK(chrono_now_smalltime_clock);
+
+#endif // __cplusplus >= 202002L
@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/clock.h>
+#include <time.h>
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// The usual way: read the clock, split it with the C library, then pack.
+static void now_gmtime(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        struct timespec now;
+        struct tm fields;
+        clock_gettime(CLOCK_REALTIME, &now);
+        gmtime_r(&now.tv_sec, &fields);
+        smalltime value = smalltime_new(fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday,
+                                        fields.tm_hour, fields.tm_min, fields.tm_sec, (int)(now.tv_nsec / 1000));
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(now_gmtime);
+
+// The cost of the clock read alone, for reference.
+static void now_clock_gettime(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        benchmark::DoNotOptimize(now);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(now_clock_gettime);
+
+static void now_smalltime(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(smalltime_now());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(now_smalltime);
+
+static void now_nanotime(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(nanotime_now());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(now_nanotime);
+
+static void now_smalltime_coarse(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(smalltime_now_coarse());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(now_smalltime_coarse);
@@ -0,0 +1,216 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/codec.h>
+#include <smalltime/epoch.h>
+#include "isa_fixture.h"
+#include <random>
+#include <vector>
+
+#ifdef SMALLTIME_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 16;
+
+// Traces, selected by the benchmark argument:
+//  0: Log lines: smalltime, a few per millisecond.
+//  1: Sparse events: smalltime, about 5 per second.
+//  2: Market data ticks: nanotime, one every few microseconds.
+enum
+{
+    TRACE_LOGS,
+    TRACE_EVENTS,
+    TRACE_TICKS,
+};
+
+static bool is_nanotime(int trace)
+{
+    return trace == TRACE_TICKS;
+}
+
+static std::vector<uint64_t> make_trace(int trace)
+{
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> values(count);
+    switch(trace)
+    {
+        case TRACE_LOGS:
+        {
+            int64_t current = 1500000000LL * 1000000;
+            std::uniform_int_distribution<int64_t> gap(0, 700);
+            for(auto& value: values)
+            {
+                current += gap(rng);
+                value = (uint64_t)smalltime_from_unix_microseconds(current);
+            }
+            break;
+        }
+        case TRACE_EVENTS:
+        {
+            int64_t current = 1500000000LL * 1000000;
+            std::exponential_distribution<double> gap(1.0 / 200000);
+            for(auto& value: values)
+            {
+                current += (int64_t)gap(rng);
+                value = (uint64_t)smalltime_from_unix_microseconds(current);
+            }
+            break;
+        }
+        case TRACE_TICKS:
+        {
+            int64_t current = 1500000000LL * 1000000000;
+            std::exponential_distribution<double> gap(1.0 / 5000);
+            for(auto& value: values)
+            {
+                current += (int64_t)gap(rng);
+                value = nanotime_from_unix_nanoseconds(current);
+            }
+            break;
+        }
+    }
+    return values;
+}
+
+static size_t encode(int trace, const std::vector<uint64_t>& values, uint8_t* buffer)
+{
+    return is_nanotime(trace) ? nanotime_codec_encode(values.data(), values.size(), buffer)
+                              : smalltime_codec_encode((const smalltime*)values.data(), values.size(), buffer);
+}
+
+static void decode(int trace, const std::vector<uint8_t>& encoded, std::vector<uint64_t>& values)
+{
+    if(is_nanotime(trace))
+    {
+        nanotime_codec_decode(encoded.data(), encoded.size(), values.data(), values.size(), nullptr);
+    }
+    else
+    {
+        smalltime_codec_decode(encoded.data(), encoded.size(), (smalltime*)values.data(), values.size(), nullptr);
+    }
+}
+
+static void report(benchmark::State& state, size_t encoded_size)
+{
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count * 8);
+    state.counters["ratio"] = (double)(count * 8) / (double)encoded_size;
+}
+
+// The baseline: differences between neighbouring packed values.
+static std::vector<int64_t> differences(const std::vector<uint64_t>& values)
+{
+    std::vector<int64_t> result(values.size());
+    uint64_t previous = 0;
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        result[i] = (int64_t)(values[i] - previous);
+        previous = values[i];
+    }
+    return result;
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void codec_encode(benchmark::State& state)
+{
+    int trace = (int)state.range(0);
+    std::vector<uint64_t> values = make_trace(trace);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(count));
+    size_t size = 0;
+    for(auto _: state)
+    {
+        size = encode(trace, values, encoded.data());
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    report(state, size);
+}
+BENCHMARK(codec_encode)->Arg(TRACE_LOGS)->Arg(TRACE_EVENTS)->Arg(TRACE_TICKS);
+
+static void codec_decode(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    int trace = (int)state.range(0);
+    std::vector<uint64_t> values = make_trace(trace);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(count));
+    encoded.resize(encode(trace, values, encoded.data()));
+    std::vector<uint64_t> decoded(count);
+    for(auto _: state)
+    {
+        decode(trace, encoded, decoded);
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    report(state, encoded.size());
+}
+REGISTER_ALL_ISAS(codec_decode, ->Arg(TRACE_LOGS)->Arg(TRACE_EVENTS)->Arg(TRACE_TICKS));
+
+static void delta_varint_decode(benchmark::State& state)
+{
+    std::vector<uint64_t> values = make_trace((int)state.range(0));
+    std::vector<uint8_t> encoded;
+    for(int64_t difference: differences(values))
+    {
+        uint64_t zigzag = ((uint64_t)difference << 1) ^ (uint64_t)(difference >> 63);
+        for(; zigzag >= 0x80; zigzag >>= 7)
+        {
+            encoded.push_back((uint8_t)(zigzag | 0x80));
+        }
+        encoded.push_back((uint8_t)zigzag);
+    }
+    std::vector<uint64_t> decoded(count);
+    for(auto _: state)
+    {
+        const uint8_t* src = encoded.data();
+        uint64_t previous = 0;
+        for(auto& value: decoded)
+        {
+            uint64_t zigzag = 0;
+            int shift = 0;
+            for(; *src >= 0x80; shift += 7)
+            {
+                zigzag |= (uint64_t)(*src++ & 0x7f) << shift;
+            }
+            zigzag |= (uint64_t)*src++ << shift;
+            previous += (zigzag >> 1) ^ (0 - (zigzag & 1));
+            value = previous;
+        }
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    report(state, encoded.size());
+}
+BENCHMARK(delta_varint_decode)->Arg(TRACE_LOGS)->Arg(TRACE_EVENTS)->Arg(TRACE_TICKS);
+
+#ifdef SMALLTIME_HAVE_ZSTD
+
+static void delta_zstd_decode(benchmark::State& state)
+{
+    std::vector<uint64_t> values = make_trace((int)state.range(0));
+    std::vector<int64_t> deltas = differences(values);
+    std::vector<uint8_t> encoded(ZSTD_compressBound(count * 8));
+    encoded.resize(ZSTD_compress(encoded.data(), encoded.size(), deltas.data(), count * 8, 3));
+    std::vector<uint64_t> decoded(count);
+    for(auto _: state)
+    {
+        ZSTD_decompress(decoded.data(), count * 8, encoded.data(), encoded.size());
+        uint64_t previous = 0;
+        for(auto& value: decoded)
+        {
+            previous += value;
+            value = previous;
+        }
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    report(state, encoded.size());
+}
+BENCHMARK(delta_zstd_decode)->Arg(TRACE_LOGS)->Arg(TRACE_EVENTS)->Arg(TRACE_TICKS);
+
+#endif // SMALLTIME_HAVE_ZSTD
@@ -0,0 +1,133 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/column.h>
+#include <smalltime/epoch.h>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// The benchmark argument is the number of values in the file (8 bytes each).
+#define FILE_SIZES ->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24)
+
+// Log timestamps, 1000 per second on average. When late_odds isn't 0,
+// about 1 in late_odds values arrives up to a second late, which unsorts
+// the blocks holding them.
+static std::vector<smalltime> make_trace(size_t count, uint64_t late_odds)
+{
+    std::mt19937_64 rng(1);
+    std::vector<smalltime> values(count);
+    int64_t current = 1500000000LL * 1000000;
+    for(auto& value: values)
+    {
+        current += (int64_t)(rng() % 2000);
+        int64_t late = late_odds != 0 && rng() % late_odds == 0 ? (int64_t)(rng() % 1000000) : 0;
+        value = smalltime_from_unix_microseconds(current - late);
+    }
+    return values;
+}
+
+class column_file
+{
+public:
+    column_file(size_t count, uint64_t late_odds)
+        : path((std::filesystem::temp_directory_path() / "smalltime_column_benchmark").string())
+        , values(make_trace(count, late_odds))
+    {
+        smalltime_column_writer* writer = smalltime_column_writer_open(path.c_str(), 0);
+        smalltime_column_writer_append(writer, values.data(), values.size());
+        smalltime_column_writer_close(writer);
+        column = smalltime_column_open(path.c_str());
+    }
+
+    ~column_file()
+    {
+        smalltime_column_close(column);
+        std::remove(path.c_str());
+    }
+
+    // A random one second range within the column.
+    void random_range(std::mt19937_64& rng, smalltime* start, smalltime* end)
+    {
+        int64_t first = smalltime_to_unix_microseconds(values.front());
+        int64_t last = smalltime_to_unix_microseconds(values.back());
+        int64_t time = first + (int64_t)(rng() % (uint64_t)(last - first));
+        *start = smalltime_from_unix_microseconds(time);
+        *end = smalltime_from_unix_microseconds(time + 1000000);
+    }
+
+    std::string path;
+    std::vector<smalltime> values;
+    smalltime_column* column;
+};
+
+static void run_query(benchmark::State& state, uint64_t late_odds)
+{
+    column_file file((size_t)state.range(0), late_odds);
+    std::mt19937_64 rng(2);
+    size_t matched = 0;
+    for(auto _: state)
+    {
+        smalltime start;
+        smalltime end;
+        file.random_range(rng, &start, &end);
+        smalltime_column_query query;
+        smalltime_column_query_start(file.column, start, end, &query);
+        while(smalltime_column_query_next(&query))
+        {
+            for(size_t i = 0; i < query.count; i++)
+            {
+                matched += query.values[i] >= start && query.values[i] < end;
+            }
+        }
+    }
+    benchmark::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["file_MiB"] = (double)state.range(0) * 8 / (1 << 20);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void column_query_sorted(benchmark::State& state)
+{
+    run_query(state, 0);
+}
+BENCHMARK(column_query_sorted) FILE_SIZES;
+
+static void column_query_late_arrivals(benchmark::State& state)
+{
+    run_query(state, 1000);
+}
+BENCHMARK(column_query_late_arrivals) FILE_SIZES;
+
+// The baseline: filtering every value in the mapping.
+static void column_scan(benchmark::State& state)
+{
+    column_file file((size_t)state.range(0), 0);
+    std::mt19937_64 rng(2);
+    size_t count = 0;
+    const smalltime* values = smalltime_column_values(file.column, &count);
+    size_t matched = 0;
+    for(auto _: state)
+    {
+        smalltime start;
+        smalltime end;
+        file.random_range(rng, &start, &end);
+        for(size_t i = 0; i < count; i++)
+        {
+            matched += values[i] >= start && values[i] < end;
+        }
+    }
+    benchmark::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["file_MiB"] = (double)state.range(0) * 8 / (1 << 20);
+}
+BENCHMARK(column_scan) FILE_SIZES;
@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/convert.h>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t convert_count = 1 << 20;
+
+static std::vector<nanotime> make_nanotimes()
+{
+    std::vector<nanotime> values(convert_count);
+    std::mt19937_64 random(23);
+    for(auto& value: values)
+    {
+        value = nanotime_new(1970 + (int)(random() % 256), 1 + (int)(random() % 12), 1 + (int)(random() % 28),
+                             (int)(random() % 24), (int)(random() % 60), (int)(random() % 60), (int)(random() % 1000000000));
+    }
+    return values;
+}
+
+// Smalltime values with one in 16 outside of the nanotime year range.
+static std::vector<smalltime> make_smalltimes()
+{
+    std::vector<nanotime> nanotimes = make_nanotimes();
+    std::vector<smalltime> values(convert_count);
+    for(size_t i = 0; i < convert_count; i++)
+    {
+        values[i] = nanotime_to_smalltime(nanotimes[i], SMALLTIME_CONVERT_TRUNCATE);
+        if(i % 16 == 0)
+        {
+            values[i] = smalltime_with_year(values[i], 1600);
+        }
+    }
+    return values;
+}
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * convert_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// Decoding every field and re-encoding.
+static void to_smalltime_via_fields(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<smalltime> results(convert_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < convert_count; i++)
+        {
+            nanotime v = values[i];
+            results[i] = smalltime_new(nanotime_get_year(v), nanotime_get_month(v), nanotime_get_day(v), nanotime_get_hour(v),
+                                       nanotime_get_minute(v), nanotime_get_second(v), nanotime_get_nanosecond(v) / 1000);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_smalltime_via_fields);
+
+static void to_smalltime_scalar(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<smalltime> results(convert_count);
+    smalltime_convert_rounding rounding = (smalltime_convert_rounding)state.range(0);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < convert_count; i++)
+        {
+            results[i] = nanotime_to_smalltime(values[i], rounding);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_smalltime_scalar)->Arg(SMALLTIME_CONVERT_TRUNCATE)->Arg(SMALLTIME_CONVERT_ROUND_HALF_EVEN);
+
+static void to_smalltime_batch(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<smalltime> results(convert_count);
+    smalltime_convert_rounding rounding = (smalltime_convert_rounding)state.range(0);
+    for(auto _: state)
+    {
+        nanotime_batch_to_smalltime(values.data(), convert_count, rounding, results.data());
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_smalltime_batch)->Arg(SMALLTIME_CONVERT_TRUNCATE)->Arg(SMALLTIME_CONVERT_ROUND_HALF_EVEN);
+
+// Decoding every field and re-encoding, checking the year first.
+static void to_nanotime_via_fields(benchmark::State& state)
+{
+    std::vector<smalltime> values = make_smalltimes();
+    std::vector<nanotime> results(convert_count);
+    for(auto _: state)
+    {
+        size_t out_of_range = 0;
+        for(size_t i = 0; i < convert_count; i++)
+        {
+            smalltime v = values[i];
+            int year = smalltime_get_year(v);
+            if(year < 1970 || year > 2225)
+            {
+                out_of_range++;
+                continue;
+            }
+            results[i] = nanotime_new(year, smalltime_get_month(v), smalltime_get_day(v), smalltime_get_hour(v),
+                                      smalltime_get_minute(v), smalltime_get_second(v), smalltime_get_microsecond(v) * 1000);
+        }
+        benchmark::DoNotOptimize(out_of_range);
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_nanotime_via_fields);
+
+static void to_nanotime_batch(benchmark::State& state)
+{
+    std::vector<smalltime> values = make_smalltimes();
+    std::vector<nanotime> results(convert_count);
+    std::vector<uint64_t> out_of_range((convert_count + 63) / 64);
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(smalltime_batch_to_nanotime(values.data(), convert_count, results.data(), out_of_range.data()));
+    }
+    report(state);
+}
+BENCHMARK(to_nanotime_batch);
@@ -0,0 +1,168 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/epoch.h>
+#include "isa_fixture.h"
+#include <random>
+#include <time.h>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 16;
+
+// Event-stream-like microsecond counts: increasing, a few per millisecond.
+static std::vector<int64_t> make_clustered_microseconds()
+{
+    std::mt19937_64 rng(1);
+    std::vector<int64_t> values(count);
+    int64_t current = 1500000000LL * 1000000;
+    for(auto& value: values)
+    {
+        current += rng() % 500;
+        value = current;
+    }
+    return values;
+}
+
+// Uniformly spread over 1900 - 2100, so every value lands on a new day.
+static std::vector<int64_t> make_scattered_microseconds()
+{
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int64_t> anywhere(-2208988800LL * 1000000, 4102444800LL * 1000000);
+    std::vector<int64_t> values(count);
+    for(auto& value: values)
+    {
+        value = anywhere(rng);
+    }
+    return values;
+}
+
+static std::vector<int64_t> make_microseconds(int64_t pattern)
+{
+    return pattern == 0 ? make_clustered_microseconds() : make_scattered_microseconds();
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void from_unix_gmtime(benchmark::State& state)
+{
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            int64_t us = microseconds[i];
+            int64_t seconds = us >= 0 ? us / 1000000 : (us - 999999) / 1000000;
+            time_t t = (time_t)seconds;
+            struct tm tm;
+            gmtime_r(&t, &tm);
+            values[i] = smalltime_new(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(us - seconds * 1000000));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(from_unix_gmtime)->Arg(0)->Arg(1);
+
+static void from_unix_inline(benchmark::State& state)
+{
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            values[i] = smalltime_from_unix_microseconds(microseconds[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(from_unix_inline)->Arg(0)->Arg(1);
+
+static void from_unix_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    for(auto _: state)
+    {
+        smalltime_batch_from_unix_microseconds(microseconds.data(), count, values.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(from_unix_batch, ->Arg(0)->Arg(1));
+
+static void to_unix_timegm(benchmark::State& state)
+{
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    std::vector<int64_t> results(count);
+    smalltime_batch_from_unix_microseconds(microseconds.data(), count, values.data());
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            smalltime value = values[i];
+            struct tm tm = {};
+            tm.tm_year = smalltime_get_year(value) - 1900;
+            tm.tm_mon = smalltime_get_month(value) - 1;
+            tm.tm_mday = smalltime_get_day(value);
+            tm.tm_hour = smalltime_get_hour(value);
+            tm.tm_min = smalltime_get_minute(value);
+            tm.tm_sec = smalltime_get_second(value);
+            results[i] = (int64_t)timegm(&tm) * 1000000 + smalltime_get_microsecond(value);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(to_unix_timegm)->Arg(0)->Arg(1);
+
+static void to_unix_inline(benchmark::State& state)
+{
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    std::vector<int64_t> results(count);
+    smalltime_batch_from_unix_microseconds(microseconds.data(), count, values.data());
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            results[i] = smalltime_to_unix_microseconds(values[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(to_unix_inline)->Arg(0)->Arg(1);
+
+static void to_unix_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<int64_t> microseconds = make_microseconds(state.range(0));
+    std::vector<smalltime> values(count);
+    std::vector<int64_t> results(count);
+    smalltime_batch_from_unix_microseconds(microseconds.data(), count, values.data());
+    for(auto _: state)
+    {
+        smalltime_batch_to_unix_microseconds(values.data(), count, results.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(to_unix_batch, ->Arg(0)->Arg(1));
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/format.h>
+#include <smalltime/epoch.h>
+#include <stdio.h>
+#include <vector>
+#include "isa_fixture.h"
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 14;
+
+// Log-line-like timestamps, a few per millisecond.
+static std::vector<nanotime> make_nanotimes()
+{
+    std::vector<nanotime> values(count);
+    int64_t current = 1500000000LL * 1000000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += 123457 * (int64_t)(i % 7);
+        values[i] = nanotime_from_unix_nanoseconds(current);
+    }
+    return values;
+}
+
+static std::vector<smalltime> make_smalltimes()
+{
+    std::vector<smalltime> values(count);
+    int64_t current = 1500000000LL * 1000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += 123 * (int64_t)(i % 7);
+        values[i] = smalltime_from_unix_microseconds(current);
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void format_snprintf(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    char buffer[64];
+    for(auto _: state)
+    {
+        for(nanotime value: values)
+        {
+            snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%09dZ", nanotime_get_year(value),
+                nanotime_get_month(value), nanotime_get_day(value), nanotime_get_hour(value),
+                nanotime_get_minute(value), nanotime_get_second(value), nanotime_get_nanosecond(value));
+            benchmark::DoNotOptimize(buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(format_snprintf);
+
+static void format_single(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    char buffer[NANOTIME_ISO8601_LENGTH + 1];
+    for(auto _: state)
+    {
+        for(nanotime value: values)
+        {
+            nanotime_format_iso8601(value, buffer);
+            benchmark::DoNotOptimize(buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(format_single);
+
+static void format_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<char> buffer(count * (NANOTIME_ISO8601_LENGTH + 1));
+    for(auto _: state)
+    {
+        nanotime_batch_format_iso8601(values.data(), count, 0, buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(format_batch, );
+
+static void format_batch_smalltime(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<smalltime> values = make_smalltimes();
+    std::vector<char> buffer(count * (SMALLTIME_ISO8601_MAX_LENGTH + 1));
+    for(auto _: state)
+    {
+        smalltime_batch_format_iso8601(values.data(), count, 0, buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(format_batch_smalltime, );
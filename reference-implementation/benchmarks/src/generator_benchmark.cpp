@@ -0,0 +1,32 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/generator.h>
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// Shared by every thread of a multithreaded run.
+alignas(64) static nanotime_generator g_generator;
+
+static void generator_next(benchmark::State& state)
+{
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(nanotime_generator_next(&g_generator));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(generator_next)->ThreadRange(1, 8)->UseRealTime();
+
+static void generator_block_next(benchmark::State& state)
+{
+    nanotime_generator_block block = {};
+    size_t block_size = (size_t)state.range(0);
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(nanotime_generator_block_next(&g_generator, &block, block_size));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(generator_block_next)->Arg(64)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/index.h>
+#include <smalltime/epoch.h>
+#include "isa_fixture.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// The benchmark argument is the number of values in the array.
+#define ARRAY_SIZES ->Arg(1 << 16)->Arg(1 << 22)->Arg(100000000)
+
+static const size_t query_count = 1 << 12;
+
+// A sorted column of event times, about one every 10 microseconds.
+static std::vector<smalltime> make_column(size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::vector<smalltime> values(count);
+    int64_t current = 1500000000LL * 1000000;
+    for(auto& value: values)
+    {
+        current += (int64_t)(rng() % 20);
+        value = smalltime_from_unix_microseconds(current);
+    }
+    return values;
+}
+
+// Times spread over the whole column, in random order.
+static std::vector<smalltime> make_queries(const std::vector<smalltime>& values)
+{
+    std::mt19937_64 rng(2);
+    int64_t first = smalltime_to_unix_microseconds(values.front());
+    int64_t last = smalltime_to_unix_microseconds(values.back());
+    std::vector<smalltime> queries(query_count);
+    for(auto& query: queries)
+    {
+        query = smalltime_from_unix_microseconds(first + (int64_t)(rng() % (uint64_t)(last - first)));
+    }
+    return queries;
+}
+
+// Built once per array size, since the largest takes a while.
+struct fixture
+{
+    size_t count = 0;
+    std::vector<smalltime> values;
+    std::vector<smalltime> queries;
+    smalltime_index* index = nullptr;
+
+    void prepare(size_t new_count)
+    {
+        if(count == new_count)
+        {
+            return;
+        }
+        if(index != nullptr)
+        {
+            smalltime_index_free(index);
+        }
+        count = new_count;
+        values = make_column(count);
+        queries = make_queries(values);
+        index = smalltime_index_new(values.data(), values.size());
+    }
+};
+
+static fixture g_fixture;
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void std_lower_bound(benchmark::State& state)
+{
+    g_fixture.prepare((size_t)state.range(0));
+    for(auto _: state)
+    {
+        for(smalltime query: g_fixture.queries)
+        {
+            benchmark::DoNotOptimize(std::lower_bound(g_fixture.values.begin(), g_fixture.values.end(), query));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * query_count);
+}
+BENCHMARK(std_lower_bound) ARRAY_SIZES;
+
+static void index_lower_bound(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    g_fixture.prepare((size_t)state.range(0));
+    for(auto _: state)
+    {
+        for(smalltime query: g_fixture.queries)
+        {
+            benchmark::DoNotOptimize(smalltime_index_lower_bound(g_fixture.index, query));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * query_count);
+}
+REGISTER_ALL_ISAS(index_lower_bound, ARRAY_SIZES);
+
+static void index_batch_lower_bound(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    g_fixture.prepare((size_t)state.range(0));
+    std::vector<size_t> results(query_count);
+    for(auto _: state)
+    {
+        smalltime_index_batch_lower_bound(g_fixture.index, g_fixture.queries.data(), query_count, results.data());
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * query_count);
+}
+REGISTER_ALL_ISAS(index_batch_lower_bound, ARRAY_SIZES);
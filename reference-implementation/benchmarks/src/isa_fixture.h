@@ -0,0 +1,27 @@
+#ifndef KS_smalltime_isa_fixture_H
+#define KS_smalltime_isa_fixture_H
+
+#include <benchmark/benchmark.h>
+#include <smalltime/dispatch.h>
+
+// Routes the library's kernels to an instruction set level for the rest of
+// the benchmark, or marks the benchmark as skipped if the CPU lacks it.
+static inline bool select_isa(benchmark::State& state, smalltime_isa isa)
+{
+    if(smalltime_set_isa(isa) != isa)
+    {
+        state.SkipWithError("ISA not supported on this CPU");
+        return false;
+    }
+    state.SetLabel(smalltime_isa_name(isa));
+    return true;
+}
+
+// Registers a benchmark taking (state, isa) once per instruction set level.
+#define REGISTER_ALL_ISAS(RUNNER, ARGS) \
+    BENCHMARK_CAPTURE(RUNNER, scalar, SMALLTIME_ISA_SCALAR) ARGS; \
+    BENCHMARK_CAPTURE(RUNNER, sse42, SMALLTIME_ISA_SSE42) ARGS; \
+    BENCHMARK_CAPTURE(RUNNER, avx2, SMALLTIME_ISA_AVX2) ARGS; \
+    BENCHMARK_CAPTURE(RUNNER, avx512, SMALLTIME_ISA_AVX512) ARGS
+
+#endif // KS_smalltime_isa_fixture_H
@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/join.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t tick_count = 1 << 22;
+
+// Inputs, selected by the benchmark argument. Ticks are spread evenly
+// over an hour.
+//  0: Uniform: as many orders as ticks, spread evenly.
+//  1: Skewed: one order per 256 ticks, spread evenly.
+//  2: Clustered: one order per 16 ticks, in bursts of 1000 orders within
+//     a few milliseconds.
+#define INPUTS ->Arg(0)->Arg(1)->Arg(2)
+
+static std::vector<smalltime> sorted_times(std::vector<int64_t> offsets)
+{
+    std::sort(offsets.begin(), offsets.end());
+    std::vector<smalltime> values;
+    for(int64_t offset: offsets)
+    {
+        values.push_back(smalltime_from_unix_microseconds(1500000000LL * 1000000 + offset));
+    }
+    return values;
+}
+
+struct inputs
+{
+    std::vector<smalltime> ticks;
+    std::vector<smalltime> orders;
+
+    explicit inputs(int kind)
+    {
+        std::mt19937_64 rng(1);
+        const uint64_t hour = 3600000000ULL;
+        std::vector<int64_t> offsets(tick_count);
+        for(auto& offset: offsets)
+        {
+            offset = (int64_t)(rng() % hour);
+        }
+        ticks = sorted_times(offsets);
+
+        offsets.clear();
+        size_t order_count = kind == 0 ? tick_count : kind == 1 ? tick_count / 256 : tick_count / 16;
+        while(offsets.size() < order_count)
+        {
+            int64_t base = (int64_t)(rng() % hour);
+            size_t burst = kind == 2 ? 1000 : 1;
+            for(size_t i = 0; i < burst && offsets.size() < order_count; i++)
+            {
+                offsets.push_back(kind == 2 ? base + (int64_t)(rng() % 5000) : base);
+            }
+        }
+        orders = sorted_times(offsets);
+    }
+};
+
+static void report(benchmark::State& state, const inputs& data)
+{
+    state.SetItemsProcessed(state.iterations() * data.orders.size());
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void asof_upper_bound(benchmark::State& state)
+{
+    inputs data((int)state.range(0));
+    std::vector<size_t> matches(data.orders.size());
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < data.orders.size(); i++)
+        {
+            matches[i] = (size_t)(std::upper_bound(data.ticks.begin(), data.ticks.end(), data.orders[i]) - data.ticks.begin()) - 1;
+        }
+        benchmark::DoNotOptimize(matches.data());
+    }
+    report(state, data);
+}
+BENCHMARK(asof_upper_bound) INPUTS;
+
+static void asof_branchy_merge(benchmark::State& state)
+{
+    inputs data((int)state.range(0));
+    std::vector<size_t> matches(data.orders.size());
+    for(auto _: state)
+    {
+        size_t position = 0;
+        for(size_t i = 0; i < data.orders.size(); i++)
+        {
+            while(position < data.ticks.size() && data.ticks[position] <= data.orders[i])
+            {
+                position++;
+            }
+            matches[i] = position - 1;
+        }
+        benchmark::DoNotOptimize(matches.data());
+    }
+    report(state, data);
+}
+BENCHMARK(asof_branchy_merge) INPUTS;
+
+static void asof_join(benchmark::State& state)
+{
+    inputs data((int)state.range(0));
+    std::vector<size_t> matches(data.orders.size());
+    for(auto _: state)
+    {
+        smalltime_asof_join(data.ticks.data(), data.ticks.size(), data.orders.data(), data.orders.size(),
+                            matches.data(), 1);
+        benchmark::DoNotOptimize(matches.data());
+    }
+    report(state, data);
+}
+BENCHMARK(asof_join) INPUTS;
+
+// A window of 1 millisecond either side.
+static void window_join(benchmark::State& state)
+{
+    inputs data((int)state.range(0));
+    std::vector<size_t> starts(data.orders.size());
+    std::vector<size_t> ends(data.orders.size());
+    for(auto _: state)
+    {
+        smalltime_window_join(data.ticks.data(), data.ticks.size(), data.orders.data(), data.orders.size(),
+                              1000, 1000, starts.data(), ends.data(), 1);
+        benchmark::DoNotOptimize(ends.data());
+    }
+    report(state, data);
+}
+BENCHMARK(window_join) INPUTS;
+
+// The argument is the number of threads.
+static void asof_join_threads(benchmark::State& state)
+{
+    inputs data(0);
+    std::vector<size_t> matches(data.orders.size());
+    for(auto _: state)
+    {
+        smalltime_asof_join(data.ticks.data(), data.ticks.size(), data.orders.data(), data.orders.size(),
+                            matches.data(), (unsigned)state.range(0));
+        benchmark::DoNotOptimize(matches.data());
+    }
+    report(state, data);
+}
+BENCHMARK(asof_join_threads)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/leap.h>
+#include <smalltime/arith.h>
+#include <smalltime/epoch.h>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t leap_count = 1 << 16;
+
+// Pairs of times from 1970 to 2030.
+static std::vector<smalltime> make_smalltimes(int seed)
+{
+    std::vector<smalltime> values(leap_count);
+    std::mt19937_64 random(seed);
+    for(auto& value: values)
+    {
+        value = smalltime_from_unix_microseconds((int64_t)(random() % 1900000000000000ULL));
+    }
+    return values;
+}
+
+static const smalltime_leap_table* get_table(benchmark::State& state)
+{
+    static smalltime_leap_table* table = smalltime_leap_table_open("/usr/share/zoneinfo/leap-seconds.list");
+    if(table == NULL)
+    {
+        state.SkipWithError("No system leap second list");
+    }
+    return table;
+}
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * leap_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// POSIX differences, which don't count leap seconds, for reference.
+static void diff_posix(benchmark::State& state)
+{
+    std::vector<smalltime> ends = make_smalltimes(1);
+    std::vector<smalltime> starts = make_smalltimes(2);
+    std::vector<int64_t> durations(leap_count);
+    for(auto _: state)
+    {
+        smalltime_batch_diff_us(ends.data(), starts.data(), leap_count, durations.data());
+        benchmark::DoNotOptimize(durations.data());
+    }
+    report(state);
+}
+BENCHMARK(diff_posix);
+
+static void diff_leap(benchmark::State& state)
+{
+    const smalltime_leap_table* table = get_table(state);
+    if(table == NULL)
+    {
+        return;
+    }
+    std::vector<smalltime> ends = make_smalltimes(1);
+    std::vector<smalltime> starts = make_smalltimes(2);
+    std::vector<int64_t> durations(leap_count);
+    for(auto _: state)
+    {
+        smalltime_leap_batch_diff_us(table, ends.data(), starts.data(), leap_count, durations.data());
+        benchmark::DoNotOptimize(durations.data());
+    }
+    report(state);
+}
+BENCHMARK(diff_leap);
+
+static void to_tai(benchmark::State& state)
+{
+    const smalltime_leap_table* table = get_table(state);
+    if(table == NULL)
+    {
+        return;
+    }
+    std::vector<smalltime> values = make_smalltimes(1);
+    std::vector<smalltime> results(leap_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < leap_count; i++)
+        {
+            results[i] = smalltime_leap_to_tai(table, values[i]);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_tai);
+
+// Readers entering a read-side section and loading the published table
+// for each conversion.
+static void offset_current(benchmark::State& state)
+{
+    if(state.thread_index() == 0)
+    {
+        smalltime_leap_publish((smalltime_leap_table*)get_table(state));
+    }
+    std::vector<smalltime> values = make_smalltimes(1);
+    for(auto _: state)
+    {
+        int64_t total = 0;
+        for(size_t i = 0; i < leap_count; i++)
+        {
+            int token = smalltime_leap_read_lock();
+            total += smalltime_leap_offset(smalltime_leap_current(), values[i]);
+            smalltime_leap_read_unlock(token);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    report(state);
+}
+BENCHMARK(offset_current)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/merge.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 22;
+
+// The first benchmark argument is the number of streams. The second is
+// the longest burst of events that a stream writes at a time (1 for
+// streams that interleave value by value).
+#define STREAMS ->Args({8, 1})->Args({256, 1})->Args({256, 64})
+
+// Sorted streams of events from within a minute.
+static std::vector<std::vector<smalltime>> make_streams(size_t stream_count, size_t burst)
+{
+    std::mt19937_64 rng(1);
+    std::vector<std::vector<smalltime>> streams(stream_count);
+    int64_t current = 1500000000LL * 1000000;
+    for(size_t i = 0; i < count;)
+    {
+        auto& stream = streams[rng() % stream_count];
+        size_t length = std::min((size_t)(1 + rng() % burst), count - i);
+        for(size_t j = 0; j < length; j++)
+        {
+            current += (int64_t)(rng() % 30);
+            stream.push_back(smalltime_from_unix_microseconds(current));
+        }
+        i += length;
+    }
+    return streams;
+}
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void merge_priority_queue(benchmark::State& state)
+{
+    auto streams = make_streams((size_t)state.range(0), (size_t)state.range(1));
+    std::vector<smalltime> values(SMALLTIME_MERGE_BATCH_LENGTH);
+    std::vector<uint32_t> stream_numbers(SMALLTIME_MERGE_BATCH_LENGTH);
+    typedef std::pair<smalltime, uint32_t> head;
+    for(auto _: state)
+    {
+        std::vector<size_t> positions(streams.size());
+        std::priority_queue<head, std::vector<head>, std::greater<head>> queue;
+        for(uint32_t i = 0; i < streams.size(); i++)
+        {
+            if(!streams[i].empty())
+            {
+                queue.emplace(streams[i][0], i);
+            }
+        }
+        size_t written = 0;
+        while(!queue.empty())
+        {
+            head top = queue.top();
+            queue.pop();
+            values[written] = top.first;
+            stream_numbers[written] = top.second;
+            if(++written == values.size())
+            {
+                benchmark::DoNotOptimize(values.data());
+                written = 0;
+            }
+            if(++positions[top.second] < streams[top.second].size())
+            {
+                queue.emplace(streams[top.second][positions[top.second]], top.second);
+            }
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(merge_priority_queue) STREAMS;
+
+static void merge_loser_tree(benchmark::State& state)
+{
+    auto streams = make_streams((size_t)state.range(0), (size_t)state.range(1));
+    std::vector<smalltime> values(SMALLTIME_MERGE_BATCH_LENGTH);
+    std::vector<uint32_t> stream_numbers(SMALLTIME_MERGE_BATCH_LENGTH);
+    for(auto _: state)
+    {
+        smalltime_merge* merge = smalltime_merge_new();
+        for(const auto& stream: streams)
+        {
+            smalltime_merge_add_array(merge, stream.data(), stream.size());
+        }
+        while(smalltime_merge_next(merge, values.data(), stream_numbers.data(), values.size()) == values.size())
+        {
+            benchmark::DoNotOptimize(values.data());
+        }
+        smalltime_merge_free(merge);
+    }
+    report(state);
+}
+BENCHMARK(merge_loser_tree) STREAMS;
+
+// The third argument is the number of threads.
+static void merge_arrays(benchmark::State& state)
+{
+    auto streams = make_streams((size_t)state.range(0), (size_t)state.range(1));
+    std::vector<const smalltime*> arrays;
+    std::vector<size_t> counts;
+    for(const auto& stream: streams)
+    {
+        arrays.push_back(stream.data());
+        counts.push_back(stream.size());
+    }
+    std::vector<smalltime> values(count);
+    std::vector<uint32_t> stream_numbers(count);
+    for(auto _: state)
+    {
+        smalltime_merge_arrays(arrays.data(), counts.data(), arrays.size(), values.data(), stream_numbers.data(),
+                               (unsigned)state.range(2));
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(merge_arrays)->Args({256, 1, 1})->Args({256, 1, 2})->Args({256, 1, 4})->UseRealTime();
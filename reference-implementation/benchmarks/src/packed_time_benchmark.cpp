@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/packed_time.h>
+#include <random>
+#include <vector>
+
+using namespace smalltime_cpp;
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t packed_count = 1 << 20;
+
+template<typename TIME>
+static std::vector<TIME> make_packed_values()
+{
+    std::mt19937 random(21);
+    std::vector<TIME> values;
+    values.reserve(packed_count);
+    for(size_t i = 0; i < packed_count; i++)
+    {
+        values.emplace_back(1970 + (int)(random() % 64), (int)(random() % 12) + 1, (int)(random() % 28) + 1,
+                            (int)(random() % 24), (int)(random() % 60), (int)(random() % 60));
+    }
+    return values;
+}
+
+struct packed_outputs
+{
+    std::vector<int> columns[7];
+
+    packed_outputs()
+    {
+        for(auto& column: columns)
+        {
+            column.resize(packed_count);
+        }
+    }
+
+    packed_columns all()
+    {
+        return {columns[0].data(), columns[1].data(), columns[2].data(), columns[3].data(),
+                columns[4].data(), columns[5].data(), columns[6].data()};
+    }
+};
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * packed_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// The C accessors and the template accessors should run at the same speed.
+static void packed_decode_c_accessors(benchmark::State& state)
+{
+    std::vector<packed_smalltime> packed = make_packed_values<packed_smalltime>();
+    std::vector<smalltime> values(packed_count);
+    for(size_t i = 0; i < packed_count; i++)
+    {
+        values[i] = packed[i].bits();
+    }
+    packed_outputs out;
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < packed_count; i++)
+        {
+            out.columns[0][i] = smalltime_get_year(values[i]);
+            out.columns[1][i] = smalltime_get_month(values[i]);
+            out.columns[2][i] = smalltime_get_day(values[i]);
+            out.columns[3][i] = smalltime_get_hour(values[i]);
+        }
+        benchmark::DoNotOptimize(out.columns[3].data());
+    }
+    report(state);
+}
+BENCHMARK(packed_decode_c_accessors);
+
+static void packed_decode_template_accessors(benchmark::State& state)
+{
+    std::vector<packed_smalltime> values = make_packed_values<packed_smalltime>();
+    packed_outputs out;
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < packed_count; i++)
+        {
+            out.columns[0][i] = values[i].year();
+            out.columns[1][i] = values[i].month();
+            out.columns[2][i] = values[i].day();
+            out.columns[3][i] = values[i].hour();
+        }
+        benchmark::DoNotOptimize(out.columns[3].data());
+    }
+    report(state);
+}
+BENCHMARK(packed_decode_template_accessors);
+
+template<typename TIME>
+static void packed_batch_decode(benchmark::State& state)
+{
+    std::vector<TIME> values = make_packed_values<TIME>();
+    packed_outputs out;
+    packed_columns columns = out.all();
+    for(auto _: state)
+    {
+        batch_decode(values.data(), packed_count, columns);
+        benchmark::DoNotOptimize(out.columns[6].data());
+    }
+    report(state);
+}
+BENCHMARK_TEMPLATE(packed_batch_decode, packed_smalltime);
+BENCHMARK_TEMPLATE(packed_batch_decode, packed_nanotime);
+BENCHMARK_TEMPLATE(packed_batch_decode, packed_second32);
+
+template<typename TIME>
+static void packed_batch_encode(benchmark::State& state)
+{
+    std::vector<TIME> values = make_packed_values<TIME>();
+    packed_outputs out;
+    packed_columns columns = out.all();
+    batch_decode(values.data(), packed_count, columns);
+    for(auto _: state)
+    {
+        batch_encode(columns, packed_count, values.data());
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK_TEMPLATE(packed_batch_encode, packed_smalltime);
+BENCHMARK_TEMPLATE(packed_batch_encode, packed_nanotime);
+BENCHMARK_TEMPLATE(packed_batch_encode, packed_second32);
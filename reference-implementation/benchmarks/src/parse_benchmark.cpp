@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/parse.h>
+#include <smalltime/format.h>
+#include <smalltime/epoch.h>
+#include "isa_fixture.h"
+#include <time.h>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 14;
+
+// A newline-separated block of log-line-like timestamps, a few per
+// millisecond.
+static std::vector<char> make_text()
+{
+    std::vector<smalltime> values(count);
+    int64_t current = 1500000000LL * 1000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += 123 * (int64_t)(i % 7);
+        values[i] = smalltime_from_unix_microseconds(current);
+    }
+    std::vector<char> text(count * (SMALLTIME_ISO8601_LENGTH + 1));
+    text.resize(smalltime_batch_format_iso8601(values.data(), count, 0, text.data()));
+    return text;
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void parse_strptime(benchmark::State& state)
+{
+    std::vector<char> text = make_text();
+    for(auto _: state)
+    {
+        for(const char* line = text.data(); line < text.data() + text.size(); line += SMALLTIME_ISO8601_LENGTH + 1)
+        {
+            struct tm fields = {};
+            int microsecond = 0;
+            const char* rest = strptime(line, "%Y-%m-%dT%H:%M:%S", &fields);
+            sscanf(rest, ".%6d", &microsecond);
+            smalltime value = smalltime_new(fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday,
+                                            fields.tm_hour, fields.tm_min, fields.tm_sec, microsecond);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(parse_strptime);
+
+static void parse_single(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<char> text = make_text();
+    for(auto _: state)
+    {
+        for(const char* line = text.data(); line < text.data() + text.size(); line += SMALLTIME_ISO8601_LENGTH + 1)
+        {
+            smalltime value;
+            smalltime_parse_iso8601(line, SMALLTIME_ISO8601_LENGTH, SMALLTIME_PARSE_TRUNCATE, &value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(parse_single, );
+
+static void parse_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<char> text = make_text();
+    std::vector<smalltime> values(count);
+    for(auto _: state)
+    {
+        smalltime_batch_parse_iso8601(text.data(), text.size(), '\n', SMALLTIME_PARSE_TRUNCATE, values.data(), count, nullptr);
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(parse_batch, );
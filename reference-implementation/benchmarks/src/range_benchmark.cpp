@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/range.h>
+#include <smalltime/epoch.h>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t grid_size = 1 << 22;
+
+// Grids, selected by the benchmark argument.
+//  0: Every 15 minutes.
+//  1: Every second.
+//  2: Every millisecond.
+#define GRIDS ->Arg(0)->Arg(1)->Arg(2)
+
+struct grid
+{
+    smalltime_unit unit;
+    int64_t step;
+    int64_t microseconds;
+};
+
+static const grid grids[] =
+{
+    {SMALLTIME_UNIT_MINUTE, 15, 15 * 60 * 1000000LL},
+    {SMALLTIME_UNIT_SECOND, 1, 1000000},
+    {SMALLTIME_UNIT_MILLISECOND, 1, 1000},
+};
+
+static const smalltime grid_start = smalltime_new(2018, 1, 1, 0, 0, 0, 0);
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * grid_size);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// Stepping through epoch microseconds and converting each step.
+static void range_via_epoch(benchmark::State& state)
+{
+    const grid& g = grids[state.range(0)];
+    std::vector<smalltime> values(grid_size);
+    int64_t start = smalltime_to_unix_microseconds(grid_start);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < grid_size; i++)
+        {
+            values[i] = smalltime_from_unix_microseconds(start + (int64_t)i * g.microseconds);
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(range_via_epoch) GRIDS;
+
+static void range_next(benchmark::State& state)
+{
+    const grid& g = grids[state.range(0)];
+    std::vector<smalltime> values(grid_size);
+    for(auto _: state)
+    {
+        smalltime_range range;
+        smalltime_range_init(&range, grid_start, INT64_MAX, g.unit, g.step);
+        for(size_t i = 0; i < grid_size; i++)
+        {
+            smalltime_range_next(&range, &values[i]);
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(range_next) GRIDS;
+
+static void range_fill(benchmark::State& state)
+{
+    const grid& g = grids[state.range(0)];
+    std::vector<smalltime> values(grid_size);
+    for(auto _: state)
+    {
+        smalltime_range range;
+        smalltime_range_init(&range, grid_start, INT64_MAX, g.unit, g.step);
+        benchmark::DoNotOptimize(smalltime_range_fill(&range, values.data(), grid_size));
+    }
+    report(state);
+}
+BENCHMARK(range_fill) GRIDS;
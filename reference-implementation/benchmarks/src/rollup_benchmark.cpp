@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/rollup.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 22;
+
+// Inputs, selected by the benchmark argument. Events are spread over a
+// day and rolled up into 15 minute buckets.
+//  0: Sorted.
+//  1: Shuffled.
+#define INPUTS ->Arg(0)->Arg(1)
+
+struct rollup_inputs
+{
+    std::vector<smalltime> times;
+    std::vector<double> values;
+
+    explicit rollup_inputs(int kind)
+    {
+        std::mt19937_64 rng(1);
+        const uint64_t day = 86400000000ULL;
+        std::vector<int64_t> offsets(count);
+        for(auto& offset: offsets)
+        {
+            offset = (int64_t)(rng() % day);
+        }
+        if(kind == 0)
+        {
+            std::sort(offsets.begin(), offsets.end());
+        }
+        for(int64_t offset: offsets)
+        {
+            times.push_back(smalltime_from_unix_microseconds(1500000000LL * 1000000 + offset));
+            values.push_back((double)(rng() % 10000) / 100);
+        }
+    }
+};
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+struct hash_map_totals
+{
+    size_t count = 0;
+    double sum = 0;
+    double min = 1e300;
+    double max = -1e300;
+};
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// Truncating each time and looking its bucket up in a hash map.
+static void rollup_hash_map(benchmark::State& state)
+{
+    rollup_inputs data((int)state.range(0));
+    for(auto _: state)
+    {
+        std::unordered_map<smalltime, hash_map_totals> groups;
+        for(size_t i = 0; i < count; i++)
+        {
+            hash_map_totals& group = groups[smalltime_truncate_to_multiple(data.times[i], SMALLTIME_UNIT_MINUTE, 15)];
+            group.count++;
+            group.sum += data.values[i];
+            group.min = std::min(group.min, data.values[i]);
+            group.max = std::max(group.max, data.values[i]);
+        }
+        benchmark::DoNotOptimize(groups.size());
+    }
+    report(state);
+}
+BENCHMARK(rollup_hash_map) INPUTS;
+
+static void rollup(benchmark::State& state)
+{
+    rollup_inputs data((int)state.range(0));
+    std::vector<smalltime_group> groups(96);
+    for(auto _: state)
+    {
+        smalltime_rollup* rollup = smalltime_rollup_new(SMALLTIME_UNIT_MINUTE, 15);
+        smalltime_rollup_add(rollup, data.times.data(), data.values.data(), count);
+        benchmark::DoNotOptimize(smalltime_rollup_groups(rollup, groups.data(), groups.size()));
+        smalltime_rollup_free(rollup);
+    }
+    report(state);
+}
+BENCHMARK(rollup) INPUTS;
+
+static void truncate_to_multiple(benchmark::State& state)
+{
+    rollup_inputs data(1);
+    std::vector<smalltime> buckets(count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            buckets[i] = smalltime_truncate_to_multiple(data.times[i], SMALLTIME_UNIT_MINUTE, 15);
+        }
+        benchmark::DoNotOptimize(buckets.data());
+    }
+    report(state);
+}
+BENCHMARK(truncate_to_multiple);
@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/sort.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#if __has_include(<boost/sort/pdqsort/pdqsort.hpp>)
+#include <boost/sort/pdqsort/pdqsort.hpp>
+#define SMALLTIME_HAVE_PDQSORT 1
+#endif
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 22;
+
+// Traces, selected by the benchmark argument:
+//  0: Events from within one hour, crossing an hour boundary (5 digit passes).
+//  1: Events from within one year (6 digit passes).
+#define TRACES ->Arg(0)->Arg(1)
+
+static std::vector<smalltime> make_trace(int trace)
+{
+    std::mt19937_64 rng(1);
+    int64_t span = trace == 0 ? 3600LL * 1000000 : 365LL * 86400 * 1000000;
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        value = smalltime_from_unix_microseconds(1500000000LL * 1000000 + (int64_t)(rng() % (uint64_t)span));
+    }
+    return values;
+}
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void sort_std(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace((int)state.range(0));
+    std::vector<smalltime> values;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        values = trace;
+        state.ResumeTiming();
+        std::sort(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_std) TRACES;
+
+#ifdef SMALLTIME_HAVE_PDQSORT
+static void sort_pdqsort(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace((int)state.range(0));
+    std::vector<smalltime> values;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        values = trace;
+        state.ResumeTiming();
+        boost::sort::pdqsort_branchless(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_pdqsort) TRACES;
+#endif
+
+static void sort_radix(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace((int)state.range(0));
+    std::vector<smalltime> values;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        values = trace;
+        state.ResumeTiming();
+        smalltime_sort(values.data(), NULL, values.size(), 1);
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_radix) TRACES;
+
+static void sort_std_with_indices(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace((int)state.range(0));
+    std::vector<std::pair<smalltime, size_t>> pairs;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        pairs.clear();
+        for(size_t i = 0; i < count; i++)
+        {
+            pairs.emplace_back(trace[i], i);
+        }
+        state.ResumeTiming();
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first;
+        });
+        benchmark::DoNotOptimize(pairs.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_std_with_indices) TRACES;
+
+static void sort_radix_with_indices(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace((int)state.range(0));
+    std::vector<smalltime> values;
+    std::vector<size_t> indices(count);
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        values = trace;
+        std::iota(indices.begin(), indices.end(), 0);
+        state.ResumeTiming();
+        smalltime_sort(values.data(), indices.data(), values.size(), 1);
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_radix_with_indices) TRACES;
+
+// The argument is the number of threads.
+static void sort_radix_threads(benchmark::State& state)
+{
+    std::vector<smalltime> trace = make_trace(1);
+    std::vector<smalltime> values;
+    for(auto _: state)
+    {
+        state.PauseTiming();
+        values = trace;
+        state.ResumeTiming();
+        smalltime_sort(values.data(), NULL, values.size(), (unsigned)state.range(0));
+        benchmark::DoNotOptimize(values.data());
+    }
+    report(state);
+}
+BENCHMARK(sort_radix_threads)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/tz.h>
+#include <smalltime/epoch.h>
+#include <stdlib.h>
+#include <time.h>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t tz_count = 1 << 16;
+static const char* const tz_directory = "/usr/share/zoneinfo";
+static const char* const tz_name = "America/New_York";
+
+// Event times: sorted, about 40 minutes apart, over a few years.
+static std::vector<int64_t> make_seconds()
+{
+    std::vector<int64_t> seconds(tz_count);
+    std::mt19937_64 random(24);
+    int64_t t = 1514764800;
+    for(auto& value: seconds)
+    {
+        t += (int64_t)(random() % 4800);
+        value = t;
+    }
+    return seconds;
+}
+
+static std::vector<smalltime> make_smalltimes()
+{
+    std::vector<smalltime> values;
+    for(int64_t seconds: make_seconds())
+    {
+        values.push_back(smalltime_from_unix_seconds(seconds));
+    }
+    return values;
+}
+
+static const smalltime_tz* get_zone(benchmark::State& state)
+{
+    static smalltime_tz_cache* cache = smalltime_tz_cache_open(tz_directory);
+    const smalltime_tz* zone = smalltime_tz_cache_get(cache, tz_name);
+    if(zone == NULL)
+    {
+        state.SkipWithError("No system zone files");
+    }
+    return zone;
+}
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * tz_count);
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+// The usual way: the C library's local time, then pack.
+static void to_local_localtime(benchmark::State& state)
+{
+    if(get_zone(state) == NULL)
+    {
+        return;
+    }
+    if(state.thread_index() == 0)
+    {
+        setenv("TZ", tz_name, 1);
+        tzset();
+    }
+    std::vector<int64_t> seconds = make_seconds();
+    std::vector<smalltime> results(tz_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < tz_count; i++)
+        {
+            time_t t = (time_t)seconds[i];
+            struct tm fields;
+            localtime_r(&t, &fields);
+            results[i] = smalltime_new(fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday,
+                                       fields.tm_hour, fields.tm_min, fields.tm_sec, 0);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_local_localtime)->ThreadRange(1, 8)->UseRealTime();
+
+static void to_local_scalar(benchmark::State& state)
+{
+    const smalltime_tz* zone = get_zone(state);
+    if(zone == NULL)
+    {
+        return;
+    }
+    std::vector<smalltime> values = make_smalltimes();
+    std::vector<smalltime> results(tz_count);
+    for(auto _: state)
+    {
+        for(size_t i = 0; i < tz_count; i++)
+        {
+            results[i] = smalltime_tz_to_local(zone, values[i]);
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_local_scalar)->ThreadRange(1, 8)->UseRealTime();
+
+static void to_local_batch(benchmark::State& state)
+{
+    const smalltime_tz* zone = get_zone(state);
+    if(zone == NULL)
+    {
+        return;
+    }
+    std::vector<smalltime> values = make_smalltimes();
+    std::vector<smalltime> results(tz_count);
+    for(auto _: state)
+    {
+        smalltime_tz_batch_to_local(zone, values.data(), tz_count, results.data());
+        benchmark::DoNotOptimize(results.data());
+    }
+    report(state);
+}
+BENCHMARK(to_local_batch)->ThreadRange(1, 8)->UseRealTime();
+
+static void from_local_batch(benchmark::State& state)
+{
+    const smalltime_tz* zone = get_zone(state);
+    if(zone == NULL)
+    {
+        return;
+    }
+    std::vector<smalltime> values = make_smalltimes();
+    smalltime_tz_batch_to_local(zone, values.data(), tz_count, values.data());
+    std::vector<smalltime> results(tz_count);
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(smalltime_tz_batch_from_local(zone, values.data(), tz_count, SMALLTIME_TZ_AMBIGUOUS_EARLIER,
+                                                               SMALLTIME_TZ_GAP_SHIFT_FORWARD, results.data(), NULL));
+    }
+    report(state);
+}
+BENCHMARK(from_local_batch)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/validate.h>
+#include "isa_fixture.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t count = 1 << 16;
+
+// Mostly valid values, as in a column that is being screened.
+static std::vector<nanotime> make_nanotimes()
+{
+    std::mt19937_64 rng(1);
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        value = nanotime_from_unix_seconds((int64_t)(rng() % 4000000000u)) | (rng() % 1000000000);
+        if(rng() % 1000 == 0)
+        {
+            value |= 0x1fULL << 47;
+        }
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void validate_inline(benchmark::State& state)
+{
+    std::vector<nanotime> values = make_nanotimes();
+    for(auto _: state)
+    {
+        size_t invalid_count = 0;
+        for(nanotime value: values)
+        {
+            invalid_count += !nanotime_is_valid(value);
+        }
+        benchmark::DoNotOptimize(invalid_count);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(validate_inline);
+
+static void validate_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<uint64_t> invalid(count / 64);
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(nanotime_batch_validate(values.data(), count, invalid.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count * sizeof(nanotime));
+}
+REGISTER_ALL_ISAS(validate_batch, );
+
+static void normalize_batch(benchmark::State& state, smalltime_isa isa)
+{
+    if(!select_isa(state, isa))
+    {
+        return;
+    }
+    std::vector<nanotime> values = make_nanotimes();
+    std::vector<nanotime> results(count);
+    for(auto _: state)
+    {
+        benchmark::DoNotOptimize(nanotime_batch_normalize(values.data(), count, results.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+REGISTER_ALL_ISAS(normalize_batch, );
@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+#include <smalltime/wheel.h>
+#include <smalltime/arith.h>
+#include <queue>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Timer counts, selected by the benchmark argument. Deadlines are spread
+// over an hour, and time advances a second at a time until all have fired.
+#define TIMER_COUNTS ->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)
+
+static const smalltime wheel_start = smalltime_new(2018, 6, 30, 23, 30, 0, 0);
+
+static std::vector<smalltime> wheel_deadlines(size_t count)
+{
+    std::mt19937_64 rng(1);
+    std::vector<smalltime> deadlines(count);
+    for(auto& deadline: deadlines)
+    {
+        deadline = smalltime_add_microseconds(wheel_start, 1 + (int64_t)(rng() % 3600000000ULL));
+    }
+    return deadlines;
+}
+
+static smalltime wheel_tick(int second)
+{
+    return smalltime_add_microseconds(wheel_start, (int64_t)second * 1000000);
+}
+
+struct queued_timer
+{
+    smalltime deadline;
+    uint64_t sequence;
+    void* context;
+
+    bool operator<(const queued_timer& other) const
+    {
+        // std::priority_queue keeps the largest on top.
+        return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+    }
+};
+
+static void report(benchmark::State& state)
+{
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+// ==================================================================
+// Benchmarks
+// ==================================================================
+
+static void timers_priority_queue(benchmark::State& state)
+{
+    std::vector<smalltime> deadlines = wheel_deadlines((size_t)state.range(0));
+    for(auto _: state)
+    {
+        std::priority_queue<queued_timer> queue;
+        uint64_t sequence = 0;
+        for(smalltime deadline: deadlines)
+        {
+            queue.push({deadline, sequence++, nullptr});
+        }
+        size_t fired = 0;
+        for(int second = 1; second <= 3600; second++)
+        {
+            smalltime now = wheel_tick(second);
+            while(!queue.empty() && queue.top().deadline <= now)
+            {
+                benchmark::DoNotOptimize(queue.top().context);
+                queue.pop();
+                fired++;
+            }
+        }
+        benchmark::DoNotOptimize(fired);
+    }
+    report(state);
+}
+BENCHMARK(timers_priority_queue) TIMER_COUNTS;
+
+static void timers_wheel(benchmark::State& state)
+{
+    std::vector<smalltime> deadlines = wheel_deadlines((size_t)state.range(0));
+    std::vector<smalltime_expiry> expired(1024);
+    for(auto _: state)
+    {
+        smalltime_wheel* wheel = smalltime_wheel_new(wheel_start);
+        for(smalltime deadline: deadlines)
+        {
+            smalltime_wheel_add(wheel, deadline, nullptr);
+        }
+        size_t fired = 0;
+        for(int second = 1; second <= 3600; second++)
+        {
+            smalltime now = wheel_tick(second);
+            size_t count;
+            do
+            {
+                count = smalltime_wheel_advance_to(wheel, now, expired.data(), expired.size());
+                fired += count;
+            } while(count == expired.size());
+        }
+        benchmark::DoNotOptimize(fired);
+        smalltime_wheel_free(wheel);
+    }
+    report(state);
+}
+BENCHMARK(timers_wheel) TIMER_COUNTS;
+
+// Adding timers and cancelling most of them before they fire, as with
+// timeouts that are usually met.
+static void timers_wheel_cancel(benchmark::State& state)
+{
+    std::vector<smalltime> deadlines = wheel_deadlines((size_t)state.range(0));
+    std::vector<smalltime_timer> timers(deadlines.size());
+    std::vector<smalltime_expiry> expired(1024);
+    for(auto _: state)
+    {
+        smalltime_wheel* wheel = smalltime_wheel_new(wheel_start);
+        for(size_t i = 0; i < deadlines.size(); i++)
+        {
+            timers[i] = smalltime_wheel_add(wheel, deadlines[i], nullptr);
+        }
+        for(size_t i = 0; i < timers.size(); i++)
+        {
+            if(i % 8 != 0)
+            {
+                smalltime_wheel_cancel(wheel, timers[i]);
+            }
+        }
+        size_t count;
+        do
+        {
+            count = smalltime_wheel_advance_to(wheel, wheel_tick(3600), expired.data(), expired.size());
+        } while(count == expired.size());
+        smalltime_wheel_free(wheel);
+    }
+    report(state);
+}
+BENCHMARK(timers_wheel_cancel) TIMER_COUNTS;
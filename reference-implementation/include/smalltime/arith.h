@@ -0,0 +1,424 @@
+/*
+ * Smalltime Arithmetic
+ * ====================
+ *
+ * Calendar-aware addition and exact differences on packed smalltime and
+ * nanotime values.
+ *
+ * Each addition first tries to apply the amount directly to the field it
+ * belongs to, which works whenever the result stays within that field
+ * (a single add plus compare). Only when the amount carries into other
+ * fields does it fall back to a full calendar conversion, taking month
+ * lengths, leap years and year rollover into account.
+ *
+ * Differences likewise only decode as far as they need to: values within
+ * the same second subtract directly, values within the same day only
+ * decode the time of day, and only values on different days go through
+ * a full calendar conversion.
+ *
+ * Carries follow POSIX time (see epoch.h): a leap second (second 60) is
+ * treated as second 0 of the following minute whenever a carry touches it.
+ *
+ * The scalar functions are inline. The batch functions live in the
+ * compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_arith_H
+#define KS_smalltime_arith_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/civil.h>
+#include <smalltime/epoch.h>
+
+
+// Internal defines. These will be undef'd at the end of the header.
+#define SMALLTIME_ARITH_ST_SHIFT_MONTH   42
+#define SMALLTIME_ARITH_ST_SHIFT_DAY     37
+#define SMALLTIME_ARITH_ST_SHIFT_SECOND  20
+#define SMALLTIME_ARITH_ST_MASK_MICROSECOND 0xfffffLL
+#define SMALLTIME_ARITH_ST_TIME_OF_DAY   ((1ULL << SMALLTIME_ARITH_ST_SHIFT_DAY) - 1)
+
+#define SMALLTIME_ARITH_NT_SHIFT_MONTH   52
+#define SMALLTIME_ARITH_NT_SHIFT_DAY     47
+#define SMALLTIME_ARITH_NT_SHIFT_SECOND  30
+#define SMALLTIME_ARITH_NT_MASK_NANOSECOND 0x3fffffffULL
+#define SMALLTIME_ARITH_NT_TIME_OF_DAY   ((1ULL << SMALLTIME_ARITH_NT_SHIFT_DAY) - 1)
+
+// Adds to a field in place. The caller guarantees there is no carry.
+static inline uint64_t smalltime_arith_add_to_field(uint64_t value, int64_t amount, int shift)
+{
+    return value + ((uint64_t)amount << shift);
+}
+
+// Month arithmetic in the shifted calendar, where every year is positive.
+static inline void smalltime_arith_add_months(int* year, int* month, int* day, int64_t months)
+{
+    int64_t total = (int64_t)(*year + SMALLTIME_CIVIL_YEAR_SHIFT) * 12 + (*month - 1) + months;
+    *year = (int)(total / 12) - SMALLTIME_CIVIL_YEAR_SHIFT;
+    *month = (int)(total % 12) + 1;
+    // Clamp to the end of the month, so Jan 31 + 1 month = Feb 28/29.
+    int month_days = smalltime_days_in_month(*year, *month);
+    if(*day > month_days)
+    {
+        *day = month_days;
+    }
+}
+
+
+
+/**
+ * Add microseconds to a time value, carrying into the other fields.
+ * Note: Input is NOT validated! The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @param microseconds The number of microseconds to add (can be negative).
+ * @return the new time value.
+ */
+static inline smalltime smalltime_add_microseconds(smalltime time, int64_t microseconds)
+{
+    if((uint64_t)smalltime_get_microsecond(time) + (uint64_t)microseconds < 1000000)
+    {
+        return time + microseconds;
+    }
+    return smalltime_from_unix_microseconds(smalltime_to_unix_microseconds(time) + microseconds);
+}
+
+/**
+ * Add seconds to a time value, carrying into the other fields.
+ * Note: Input is NOT validated! The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @param seconds The number of seconds to add (can be negative).
+ * @return the new time value.
+ */
+static inline smalltime smalltime_add_seconds(smalltime time, int64_t seconds)
+{
+    if((uint64_t)smalltime_get_second(time) + (uint64_t)seconds < 60)
+    {
+        return (smalltime)smalltime_arith_add_to_field((uint64_t)time, seconds, SMALLTIME_ARITH_ST_SHIFT_SECOND);
+    }
+    if(seconds == 0)
+    {
+        return time;
+    }
+    return smalltime_from_unix_seconds(smalltime_to_unix_seconds(time) + seconds) | smalltime_get_microsecond(time);
+}
+
+/**
+ * Add days to a time value, carrying into the month and year fields.
+ * The time of day is unchanged.
+ * Note: Input is NOT validated! The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @param days The number of days to add (can be negative).
+ * @return the new time value.
+ */
+static inline smalltime smalltime_add_days(smalltime time, int64_t days)
+{
+    // Every month has at least 28 days.
+    if((uint64_t)(smalltime_get_day(time) - 1) + (uint64_t)days < 28)
+    {
+        return (smalltime)smalltime_arith_add_to_field((uint64_t)time, days, SMALLTIME_ARITH_ST_SHIFT_DAY);
+    }
+    int year, month, day;
+    int64_t day_count = smalltime_days_from_civil(smalltime_get_year(time), smalltime_get_month(time), smalltime_get_day(time)) + days;
+    smalltime_civil_from_days((int32_t)day_count, &year, &month, &day);
+    return smalltime_new(year, month, day, 0, 0, 0, 0) | (smalltime)((uint64_t)time & SMALLTIME_ARITH_ST_TIME_OF_DAY);
+}
+
+/**
+ * Add months to a time value, carrying into the year field.
+ * If the day doesn't exist in the new month, it is clamped to the last
+ * day of that month (e.g. Jan 31 + 1 month = Feb 28 or 29).
+ * The time of day is unchanged.
+ * Note: Input is NOT validated! The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @param months The number of months to add (can be negative).
+ * @return the new time value.
+ */
+static inline smalltime smalltime_add_months(smalltime time, int64_t months)
+{
+    if((uint64_t)(smalltime_get_month(time) - 1) + (uint64_t)months < 12 && smalltime_get_day(time) <= 28)
+    {
+        return (smalltime)smalltime_arith_add_to_field((uint64_t)time, months, SMALLTIME_ARITH_ST_SHIFT_MONTH);
+    }
+    int year = smalltime_get_year(time);
+    int month = smalltime_get_month(time);
+    int day = smalltime_get_day(time);
+    smalltime_arith_add_months(&year, &month, &day, months);
+    return smalltime_new(year, month, day, 0, 0, 0, 0) | (smalltime)((uint64_t)time & SMALLTIME_ARITH_ST_TIME_OF_DAY);
+}
+
+/**
+ * Add nanoseconds to a time value, carrying into the other fields.
+ * Note: Input is NOT validated! The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @param nanoseconds The number of nanoseconds to add (can be negative).
+ * @return the new time value.
+ */
+static inline nanotime nanotime_add_nanoseconds(nanotime time, int64_t nanoseconds)
+{
+    if((uint64_t)nanotime_get_nanosecond(time) + (uint64_t)nanoseconds < 1000000000)
+    {
+        return time + (uint64_t)nanoseconds;
+    }
+    return nanotime_from_unix_nanoseconds(nanotime_to_unix_nanoseconds(time) + nanoseconds);
+}
+
+/**
+ * Add seconds to a time value, carrying into the other fields.
+ * Note: Input is NOT validated! The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @param seconds The number of seconds to add (can be negative).
+ * @return the new time value.
+ */
+static inline nanotime nanotime_add_seconds(nanotime time, int64_t seconds)
+{
+    if((uint64_t)nanotime_get_second(time) + (uint64_t)seconds < 60)
+    {
+        return smalltime_arith_add_to_field(time, seconds, SMALLTIME_ARITH_NT_SHIFT_SECOND);
+    }
+    if(seconds == 0)
+    {
+        return time;
+    }
+    return nanotime_from_unix_seconds(nanotime_to_unix_seconds(time) + seconds) | (nanotime)nanotime_get_nanosecond(time);
+}
+
+/**
+ * Add days to a time value, carrying into the month and year fields.
+ * The time of day is unchanged.
+ * Note: Input is NOT validated! The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @param days The number of days to add (can be negative).
+ * @return the new time value.
+ */
+static inline nanotime nanotime_add_days(nanotime time, int64_t days)
+{
+    if((uint64_t)(nanotime_get_day(time) - 1) + (uint64_t)days < 28)
+    {
+        return smalltime_arith_add_to_field(time, days, SMALLTIME_ARITH_NT_SHIFT_DAY);
+    }
+    int year, month, day;
+    int64_t day_count = smalltime_days_from_civil(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time)) + days;
+    smalltime_civil_from_days((int32_t)day_count, &year, &month, &day);
+    return nanotime_new(year, month, day, 0, 0, 0, 0) | (time & SMALLTIME_ARITH_NT_TIME_OF_DAY);
+}
+
+/**
+ * Add months to a time value, carrying into the year field.
+ * If the day doesn't exist in the new month, it is clamped to the last
+ * day of that month (e.g. Jan 31 + 1 month = Feb 28 or 29).
+ * The time of day is unchanged.
+ * Note: Input is NOT validated! The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @param months The number of months to add (can be negative).
+ * @return the new time value.
+ */
+static inline nanotime nanotime_add_months(nanotime time, int64_t months)
+{
+    if((uint64_t)(nanotime_get_month(time) - 1) + (uint64_t)months < 12 && nanotime_get_day(time) <= 28)
+    {
+        return smalltime_arith_add_to_field(time, months, SMALLTIME_ARITH_NT_SHIFT_MONTH);
+    }
+    int year = nanotime_get_year(time);
+    int month = nanotime_get_month(time);
+    int day = nanotime_get_day(time);
+    smalltime_arith_add_months(&year, &month, &day, months);
+    return nanotime_new(year, month, day, 0, 0, 0, 0) | (time & SMALLTIME_ARITH_NT_TIME_OF_DAY);
+}
+
+/**
+ * Get the exact difference between two time values, in microseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param end The later time value.
+ * @param start The earlier time value.
+ * @return end - start, in microseconds (negative if end is before start).
+ */
+static inline int64_t smalltime_diff_us(smalltime end, smalltime start)
+{
+    uint64_t differing_bits = (uint64_t)(end ^ start);
+    if(differing_bits <= SMALLTIME_ARITH_ST_MASK_MICROSECOND)
+    {
+        return end - start;
+    }
+    if(differing_bits < (1ULL << SMALLTIME_ARITH_ST_SHIFT_DAY))
+    {
+        int64_t end_second = (int64_t)smalltime_epoch_time_of_day(smalltime_get_hour(end), smalltime_get_minute(end), smalltime_get_second(end));
+        int64_t start_second = (int64_t)smalltime_epoch_time_of_day(smalltime_get_hour(start), smalltime_get_minute(start), smalltime_get_second(start));
+        return (end_second - start_second) * 1000000 + (smalltime_get_microsecond(end) - smalltime_get_microsecond(start));
+    }
+    return smalltime_to_unix_microseconds(end) - smalltime_to_unix_microseconds(start);
+}
+
+/**
+ * Get the exact difference between two time values, in nanoseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param end The later time value.
+ * @param start The earlier time value.
+ * @return end - start, in nanoseconds (negative if end is before start).
+ */
+static inline int64_t nanotime_diff_ns(nanotime end, nanotime start)
+{
+    uint64_t differing_bits = end ^ start;
+    if(differing_bits <= SMALLTIME_ARITH_NT_MASK_NANOSECOND)
+    {
+        return (int64_t)(end - start);
+    }
+    if(differing_bits < (1ULL << SMALLTIME_ARITH_NT_SHIFT_DAY))
+    {
+        int64_t end_second = (int64_t)smalltime_epoch_time_of_day(nanotime_get_hour(end), nanotime_get_minute(end), nanotime_get_second(end));
+        int64_t start_second = (int64_t)smalltime_epoch_time_of_day(nanotime_get_hour(start), nanotime_get_minute(start), nanotime_get_second(start));
+        return (end_second - start_second) * 1000000000 + ((int64_t)nanotime_get_nanosecond(end) - (int64_t)nanotime_get_nanosecond(start));
+    }
+    return nanotime_to_unix_nanoseconds(end) - nanotime_to_unix_nanoseconds(start);
+}
+
+
+/**
+ * Add microseconds to an array of time values (see smalltime_add_microseconds).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param microseconds The number of microseconds to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void smalltime_batch_add_microseconds(const smalltime* values, size_t count, int64_t microseconds, smalltime* results);
+
+/**
+ * Add seconds to an array of time values (see smalltime_add_seconds).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param seconds The number of seconds to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void smalltime_batch_add_seconds(const smalltime* values, size_t count, int64_t seconds, smalltime* results);
+
+/**
+ * Add days to an array of time values (see smalltime_add_days).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param days The number of days to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void smalltime_batch_add_days(const smalltime* values, size_t count, int64_t days, smalltime* results);
+
+/**
+ * Add months to an array of time values (see smalltime_add_months).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param months The number of months to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void smalltime_batch_add_months(const smalltime* values, size_t count, int64_t months, smalltime* results);
+
+/**
+ * Add nanoseconds to an array of time values (see nanotime_add_nanoseconds).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param nanoseconds The number of nanoseconds to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void nanotime_batch_add_nanoseconds(const nanotime* values, size_t count, int64_t nanoseconds, nanotime* results);
+
+/**
+ * Add seconds to an array of time values (see nanotime_add_seconds).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param seconds The number of seconds to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void nanotime_batch_add_seconds(const nanotime* values, size_t count, int64_t seconds, nanotime* results);
+
+/**
+ * Add days to an array of time values (see nanotime_add_days).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param days The number of days to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void nanotime_batch_add_days(const nanotime* values, size_t count, int64_t days, nanotime* results);
+
+/**
+ * Add months to an array of time values (see nanotime_add_months).
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param months The number of months to add to each value.
+ * @param results Where to store the new time values (can be the same array as values).
+ */
+SMALLTIME_API void nanotime_batch_add_months(const nanotime* values, size_t count, int64_t months, nanotime* results);
+
+/**
+ * Get the exact differences between pairs of time values, in microseconds
+ * (see smalltime_diff_us).
+ * Note: Input is NOT validated!
+ *
+ * @param ends The later time values.
+ * @param starts The earlier time values.
+ * @param count The number of pairs.
+ * @param durations Where to store each end - start, in microseconds.
+ */
+SMALLTIME_API void smalltime_batch_diff_us(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations);
+
+/**
+ * Get the exact differences between pairs of time values, in nanoseconds
+ * (see nanotime_diff_ns).
+ * Note: Input is NOT validated!
+ *
+ * @param ends The later time values.
+ * @param starts The earlier time values.
+ * @param count The number of pairs.
+ * @param durations Where to store each end - start, in nanoseconds.
+ */
+SMALLTIME_API void nanotime_batch_diff_ns(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations);
+
+
+#undef SMALLTIME_ARITH_ST_SHIFT_MONTH
+#undef SMALLTIME_ARITH_ST_SHIFT_DAY
+#undef SMALLTIME_ARITH_ST_SHIFT_SECOND
+#undef SMALLTIME_ARITH_ST_MASK_MICROSECOND
+#undef SMALLTIME_ARITH_ST_TIME_OF_DAY
+#undef SMALLTIME_ARITH_NT_SHIFT_MONTH
+#undef SMALLTIME_ARITH_NT_SHIFT_DAY
+#undef SMALLTIME_ARITH_NT_SHIFT_SECOND
+#undef SMALLTIME_ARITH_NT_MASK_NANOSECOND
+#undef SMALLTIME_ARITH_NT_TIME_OF_DAY
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_arith_H
@@ -0,0 +1,113 @@
+/*
+ * Smalltime Batch Operations
+ * ==========================
+ *
+ * Converts whole arrays of smalltime and nanotime values to and from
+ * struct-of-arrays field columns.
+ *
+ * Results are bit-identical to calling the inline accessors in smalltime.h
+ * and nanotime.h on each value, but the work is done with SIMD instructions
+ * (SSE4.2, AVX2, AVX-512) where available, with a scalar fallback.
+ *
+ * These functions live in the compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_batch_H
+#define KS_smalltime_batch_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+/**
+ * Field columns for a batch of smalltime values.
+ * Each pointer must reference an array of at least as many elements as
+ * there are values in the batch.
+ */
+typedef struct
+{
+    int* year;
+    int* month;
+    int* day;
+    int* hour;
+    int* minute;
+    int* second;
+    int* microsecond;
+} smalltime_columns;
+
+/**
+ * Field columns for a batch of nanotime values.
+ * Each pointer must reference an array of at least as many elements as
+ * there are values in the batch.
+ */
+typedef struct
+{
+    int* year;
+    int* month;
+    int* day;
+    int* hour;
+    int* minute;
+    int* second;
+    int* nanosecond;
+} nanotime_columns;
+
+
+
+/**
+ * Split an array of time values into field columns.
+ * Equivalent to calling smalltime_get_*() on every value.
+ *
+ * @param values The time values to decode.
+ * @param count The number of values.
+ * @param columns Where to store the decoded fields.
+ */
+SMALLTIME_API void smalltime_batch_decode(const smalltime* values, size_t count, const smalltime_columns* columns);
+
+/**
+ * Pack field columns into an array of time values.
+ * Equivalent to calling smalltime_new() on every row.
+ * Note: Input is NOT validated!
+ *
+ * @param columns The fields to encode.
+ * @param count The number of rows.
+ * @param values Where to store the encoded time values.
+ */
+SMALLTIME_API void smalltime_batch_encode(const smalltime_columns* columns, size_t count, smalltime* values);
+
+/**
+ * Split an array of time values into field columns.
+ * Equivalent to calling nanotime_get_*() on every value.
+ *
+ * @param values The time values to decode.
+ * @param count The number of values.
+ * @param columns Where to store the decoded fields.
+ */
+SMALLTIME_API void nanotime_batch_decode(const nanotime* values, size_t count, const nanotime_columns* columns);
+
+/**
+ * Pack field columns into an array of time values.
+ * Equivalent to calling nanotime_new() on every row.
+ * Note: Input is NOT validated!
+ *
+ * @param columns The fields to encode.
+ * @param count The number of rows.
+ * @param values Where to store the encoded time values.
+ */
+SMALLTIME_API void nanotime_batch_encode(const nanotime_columns* columns, size_t count, nanotime* values);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_batch_H
@@ -0,0 +1,235 @@
+/*
+ * Smalltime Calendar Fields
+ * =========================
+ *
+ * Fields that aren't stored in a smalltime or nanotime value, but follow
+ * from its date: the day of the week, the day of the year, and the ISO
+ * 8601 week and week-based year.
+ *
+ * All are closed forms over the year, month and day fields, with no
+ * tables and no conversion to a day count:
+ *
+ *  * The day of the year is the number of days before the month, which
+ *    is (367 * month - 362) / 12 less 2 (or 1 in a leap year) after
+ *    February, plus the day.
+ *  * Each year moves the weekday on by one, since 365 days is 52 weeks and
+ *    a day, and each leap year before it by one more. The year is shifted
+ *    forward by whole 400-year cycles first (see civil.h), which keeps it
+ *    positive without changing any weekday.
+ *  * The ISO week is (day_of_year - weekday + 10) / 7. Week 0 is the last
+ *    week of the year before, and week 53 is week 1 of the next year
+ *    unless the year ends on a Thursday or later.
+ *
+ * Weekdays are numbered as in ISO 8601: 1 = Monday to 7 = Sunday.
+ *
+ * The scalar functions are inline. The batch functions live in the
+ * compiled smalltime library, and run 8 values at a time with AVX-512,
+ * using multiply-shift pairs for the divisions.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_calendar_H
+#define KS_smalltime_calendar_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+#include <smalltime/civil.h>
+
+
+/**
+ * Calendar field columns for a batch of time values.
+ * Each pointer must reference an array of at least as many elements as
+ * there are values in the batch, or be NULL to skip that field.
+ */
+typedef struct
+{
+    int* weekday;
+    int* day_of_year;
+    int* iso_week;
+    int* iso_week_year;
+} smalltime_calendar_columns;
+
+// Day of the year (1 - 366) of a date.
+static inline int smalltime_calendar_day_of_year(int year, int month, int day)
+{
+    int days = (367 * month - 362) / 12 + day;
+    return month > 2 ? days - 2 + smalltime_is_leap_year(year) : days;
+}
+
+// Weekday (1 = Monday - 7 = Sunday) of a date, given its day of the year.
+static inline int smalltime_calendar_weekday(int year, int day_of_year)
+{
+    uint32_t y = (uint32_t)(year + SMALLTIME_CIVIL_YEAR_SHIFT);
+    uint32_t before = y - 1;
+    uint32_t leap_days = before / 4 - before / 100 + before / 400;
+    return (int)((y + leap_days + (uint32_t)day_of_year + 5) % 7) + 1;
+}
+
+// ISO week (1 - 53) of a date, given its day of the year and weekday,
+// storing the year the week belongs to in *week_year.
+static inline int smalltime_calendar_iso_week(int year, int day_of_year, int weekday, int* week_year)
+{
+    int week = (day_of_year - weekday + 10) / 7;
+    if(week == 0)
+    {
+        // The year before has 53 weeks if it ended on a Thursday, or on a
+        // Friday in a leap year.
+        int last_weekday = (weekday - day_of_year + 7) % 7;
+        *week_year = year - 1;
+        return 52 + (last_weekday == 4 || (last_weekday == 5 && smalltime_is_leap_year(year - 1)));
+    }
+    if(week == 53 && weekday + 365 + smalltime_is_leap_year(year) - day_of_year < 4)
+    {
+        *week_year = year + 1;
+        return 1;
+    }
+    *week_year = year;
+    return week;
+}
+
+
+
+/**
+ * Get the day of the week.
+ *
+ * @param time The time value.
+ * @return The weekday (1 = Monday - 7 = Sunday).
+ */
+static inline int smalltime_get_weekday(smalltime time)
+{
+    int year = smalltime_get_year(time);
+    return smalltime_calendar_weekday(year, smalltime_calendar_day_of_year(year, smalltime_get_month(time), smalltime_get_day(time)));
+}
+
+/**
+ * Get the day of the week.
+ *
+ * @param time The time value.
+ * @return The weekday (1 = Monday - 7 = Sunday).
+ */
+static inline int nanotime_get_weekday(nanotime time)
+{
+    int year = nanotime_get_year(time);
+    return smalltime_calendar_weekday(year, smalltime_calendar_day_of_year(year, nanotime_get_month(time), nanotime_get_day(time)));
+}
+
+/**
+ * Get the day of the year.
+ *
+ * @param time The time value.
+ * @return The day of the year (1 - 366).
+ */
+static inline int smalltime_get_day_of_year(smalltime time)
+{
+    return smalltime_calendar_day_of_year(smalltime_get_year(time), smalltime_get_month(time), smalltime_get_day(time));
+}
+
+/**
+ * Get the day of the year.
+ *
+ * @param time The time value.
+ * @return The day of the year (1 - 366).
+ */
+static inline int nanotime_get_day_of_year(nanotime time)
+{
+    return smalltime_calendar_day_of_year(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time));
+}
+
+/**
+ * Get the ISO 8601 week number. Days at the start or end of a year can be
+ * in a week of the year before or after (see smalltime_get_iso_week_year()).
+ *
+ * @param time The time value.
+ * @return The week (1 - 53).
+ */
+static inline int smalltime_get_iso_week(smalltime time)
+{
+    int year = smalltime_get_year(time);
+    int day_of_year = smalltime_calendar_day_of_year(year, smalltime_get_month(time), smalltime_get_day(time));
+    int week_year;
+    return smalltime_calendar_iso_week(year, day_of_year, smalltime_calendar_weekday(year, day_of_year), &week_year);
+}
+
+/**
+ * Get the ISO 8601 week number. Days at the start or end of a year can be
+ * in a week of the year before or after (see nanotime_get_iso_week_year()).
+ *
+ * @param time The time value.
+ * @return The week (1 - 53).
+ */
+static inline int nanotime_get_iso_week(nanotime time)
+{
+    int year = nanotime_get_year(time);
+    int day_of_year = smalltime_calendar_day_of_year(year, nanotime_get_month(time), nanotime_get_day(time));
+    int week_year;
+    return smalltime_calendar_iso_week(year, day_of_year, smalltime_calendar_weekday(year, day_of_year), &week_year);
+}
+
+/**
+ * Get the year that the ISO 8601 week belongs to.
+ *
+ * @param time The time value.
+ * @return The week-based year (the year, or one before or after it).
+ */
+static inline int smalltime_get_iso_week_year(smalltime time)
+{
+    int year = smalltime_get_year(time);
+    int day_of_year = smalltime_calendar_day_of_year(year, smalltime_get_month(time), smalltime_get_day(time));
+    int week_year;
+    smalltime_calendar_iso_week(year, day_of_year, smalltime_calendar_weekday(year, day_of_year), &week_year);
+    return week_year;
+}
+
+/**
+ * Get the year that the ISO 8601 week belongs to.
+ *
+ * @param time The time value.
+ * @return The week-based year (the year, or one before or after it).
+ */
+static inline int nanotime_get_iso_week_year(nanotime time)
+{
+    int year = nanotime_get_year(time);
+    int day_of_year = smalltime_calendar_day_of_year(year, nanotime_get_month(time), nanotime_get_day(time));
+    int week_year;
+    smalltime_calendar_iso_week(year, day_of_year, smalltime_calendar_weekday(year, day_of_year), &week_year);
+    return week_year;
+}
+
+/**
+ * Get the calendar fields of an array of time values.
+ * Equivalent to calling the smalltime_get_*() functions above on every value.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param columns The columns to store the fields in.
+ */
+SMALLTIME_API void smalltime_batch_calendar(const smalltime* values, size_t count, const smalltime_calendar_columns* columns);
+
+/**
+ * Get the calendar fields of an array of time values.
+ * Equivalent to calling the nanotime_get_*() functions above on every value.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param columns The columns to store the fields in.
+ */
+SMALLTIME_API void nanotime_batch_calendar(const nanotime* values, size_t count, const smalltime_calendar_columns* columns);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_calendar_H
@@ -0,0 +1,290 @@
+/*
+ * Smalltime std::chrono Interop
+ * =============================
+ *
+ * Conversions between the packed time values of packed_time.h and the
+ * C++20 std::chrono types, for code that already works in sys_time,
+ * year_month_day and hh_mm_ss.
+ *
+ * smalltime_clock and nanotime_clock meet the Clock requirements. Their
+ * time points count microseconds (or nanoseconds) from the Unix epoch,
+ * the same as sys_time, so from_sys() and to_sys() (and clock_cast) cost
+ * nothing. Converting a time point or sys_time to a packed value and back
+ * goes through the civil algorithms of epoch.h, once per value.
+ *
+ * year_month_day comes straight from the year, month and day fields, with
+ * no calendar arithmetic. Note that std::chrono::year only goes from
+ * -32767 to 32767.
+ *
+ * Where <format> is available, std::formatter is specialized for
+ * packed_smalltime and packed_nanotime, writing ISO-8601 timestamps
+ * through format.h. Stream output does the same.
+ *
+ * Requires C++20. The formatter, like format.h, needs the compiled
+ * smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_chrono_H
+#define KS_smalltime_chrono_H
+
+#if defined(__cplusplus) && __cplusplus >= 202002L
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <type_traits>
+#include <version>
+#include <smalltime/packed_time.h>
+#include <smalltime/civil.h>
+#include <smalltime/epoch.h>
+#include <smalltime/format.h>
+
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+
+namespace smalltime_cpp
+{
+
+// The resolution of a packed time type, as a std::chrono duration.
+template<typename TIME>
+using packed_duration = std::chrono::duration<int64_t, std::ratio<1, TIME::layout::fractions_per_second>>;
+
+/**
+ * Convert a time value to a std::chrono::sys_time.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @return the same time, at the resolution of the time value.
+ */
+template<typename LAYOUT>
+inline std::chrono::sys_time<packed_duration<basic_packed_time<LAYOUT>>> to_sys_time(basic_packed_time<LAYOUT> time)
+{
+    using duration = packed_duration<basic_packed_time<LAYOUT>>;
+    if constexpr(std::is_same<LAYOUT, smalltime_layout>::value)
+    {
+        return std::chrono::sys_time<duration>(duration(smalltime_to_unix_microseconds(time.bits())));
+    }
+    else if constexpr(std::is_same<LAYOUT, nanotime_layout>::value)
+    {
+        return std::chrono::sys_time<duration>(duration(nanotime_to_unix_nanoseconds(time.bits())));
+    }
+    else
+    {
+        int64_t days = smalltime_days_from_civil(time.year(), time.month(), time.day());
+        int64_t seconds = days * 86400 + (int64_t)smalltime_epoch_time_of_day(time.hour(), time.minute(), time.second());
+        return std::chrono::sys_time<duration>(duration(seconds * LAYOUT::fractions_per_second + time.fraction()));
+    }
+}
+
+/**
+ * Convert a std::chrono::sys_time to a time value, rounding down to the
+ * resolution of the time value.
+ * Valid range is the year range of the time type.
+ *
+ * @param time The time.
+ * @return the time value.
+ */
+template<typename TIME, typename DURATION>
+inline TIME from_sys_time(const std::chrono::sys_time<DURATION>& time)
+{
+    using duration = packed_duration<TIME>;
+    int64_t ticks = std::chrono::floor<duration>(time).time_since_epoch().count();
+    if constexpr(std::is_same<typename TIME::layout, smalltime_layout>::value)
+    {
+        return TIME::from_bits(smalltime_from_unix_microseconds(ticks));
+    }
+    else if constexpr(std::is_same<typename TIME::layout, nanotime_layout>::value)
+    {
+        return TIME::from_bits(nanotime_from_unix_nanoseconds(ticks));
+    }
+    else
+    {
+        const int64_t ticks_per_day = 86400LL * TIME::layout::fractions_per_second;
+        int64_t days = ticks / ticks_per_day;
+        int64_t tick_of_day = ticks - days * ticks_per_day;
+        if(tick_of_day < 0)
+        {
+            days--;
+            tick_of_day += ticks_per_day;
+        }
+        int year, month, day;
+        smalltime_civil_from_days((int32_t)days, &year, &month, &day);
+        int64_t second_of_day = tick_of_day / TIME::layout::fractions_per_second;
+        return TIME(year, month, day,
+                    (int)(second_of_day / 3600),
+                    (int)(second_of_day / 60 % 60),
+                    (int)(second_of_day % 60),
+                    (int)(tick_of_day - second_of_day * TIME::layout::fractions_per_second));
+    }
+}
+
+/**
+ * Get the date of a time value.
+ * Valid range is the std::chrono::year range (-32767 - 32767).
+ *
+ * @param time The time value.
+ * @return the date.
+ */
+template<typename LAYOUT>
+constexpr std::chrono::year_month_day to_year_month_day(basic_packed_time<LAYOUT> time)
+{
+    return std::chrono::year_month_day(std::chrono::year(time.year()),
+                                       std::chrono::month((unsigned)time.month()),
+                                       std::chrono::day((unsigned)time.day()));
+}
+
+/**
+ * Get the time of day of a time value. A leap second (second 60) comes out
+ * as second 0 of the next minute.
+ *
+ * @param time The time value.
+ * @return the time of day.
+ */
+template<typename LAYOUT>
+constexpr std::chrono::hh_mm_ss<packed_duration<basic_packed_time<LAYOUT>>> to_hh_mm_ss(basic_packed_time<LAYOUT> time)
+{
+    using duration = packed_duration<basic_packed_time<LAYOUT>>;
+    int64_t seconds = time.hour() * 3600 + time.minute() * 60 + time.second();
+    return std::chrono::hh_mm_ss<duration>(duration(seconds * LAYOUT::fractions_per_second + time.fraction()));
+}
+
+/**
+ * Create a time value from a date and time of day, rounding the time of
+ * day down to the resolution of the time value.
+ * Note: Input is NOT validated!
+ *
+ * @param date The date.
+ * @param time_of_day The time of day.
+ * @return the time value.
+ */
+template<typename TIME, typename DURATION = std::chrono::seconds>
+constexpr TIME from_year_month_day(const std::chrono::year_month_day& date,
+                                   const std::chrono::hh_mm_ss<DURATION>& time_of_day = std::chrono::hh_mm_ss<DURATION>())
+{
+    using duration = packed_duration<TIME>;
+    return TIME((int)date.year(), (int)(unsigned)date.month(), (int)(unsigned)date.day(),
+                (int)time_of_day.hours().count(),
+                (int)time_of_day.minutes().count(),
+                (int)time_of_day.seconds().count(),
+                (int)std::chrono::floor<duration>(time_of_day.subseconds()).count());
+}
+
+/**
+ * A Clock over a packed time type. Time points count ticks of the packed
+ * type's resolution since the Unix epoch, the same as sys_time, and are
+ * converted to and from packed values with to_packed() and from_packed().
+ */
+template<typename TIME>
+struct packed_clock
+{
+    using packed = TIME;
+    using duration = packed_duration<TIME>;
+    using rep = typename duration::rep;
+    using period = typename duration::period;
+    using time_point = std::chrono::time_point<packed_clock, duration>;
+    static constexpr bool is_steady = false;
+
+    static time_point now() noexcept
+    {
+        return time_point(std::chrono::floor<duration>(std::chrono::system_clock::now().time_since_epoch()));
+    }
+
+    template<typename DURATION>
+    static constexpr std::chrono::time_point<packed_clock, std::common_type_t<DURATION, duration>>
+    from_sys(const std::chrono::sys_time<DURATION>& time) noexcept
+    {
+        return std::chrono::time_point<packed_clock, std::common_type_t<DURATION, duration>>(time.time_since_epoch());
+    }
+
+    template<typename DURATION>
+    static constexpr std::chrono::sys_time<std::common_type_t<DURATION, duration>>
+    to_sys(const std::chrono::time_point<packed_clock, DURATION>& time) noexcept
+    {
+        return std::chrono::sys_time<std::common_type_t<DURATION, duration>>(time.time_since_epoch());
+    }
+
+    static TIME to_packed(time_point time)
+    {
+        return from_sys_time<TIME>(to_sys(time));
+    }
+
+    static time_point from_packed(TIME time)
+    {
+        return time_point(to_sys_time(time).time_since_epoch());
+    }
+};
+
+using smalltime_clock = packed_clock<packed_smalltime>;
+using nanotime_clock = packed_clock<packed_nanotime>;
+
+/**
+ * Write a time value as an ISO-8601 timestamp (see format.h).
+ *
+ * @param time The time value.
+ * @param buffer Where to write, with room for at least SMALLTIME_ISO8601_MAX_LENGTH + 1 chars.
+ * @return the length of the timestamp.
+ */
+inline size_t format_iso8601(packed_smalltime time, char* buffer)
+{
+    return smalltime_format_iso8601(time.bits(), buffer);
+}
+
+inline size_t format_iso8601(packed_nanotime time, char* buffer)
+{
+    return nanotime_format_iso8601(time.bits(), buffer);
+}
+
+template<typename LAYOUT, typename = decltype(format_iso8601(basic_packed_time<LAYOUT>(), nullptr))>
+inline std::ostream& operator<<(std::ostream& stream, basic_packed_time<LAYOUT> time)
+{
+    char buffer[SMALLTIME_ISO8601_MAX_LENGTH + 1];
+    return stream.write(buffer, (std::streamsize)format_iso8601(time, buffer));
+}
+
+#ifdef __cpp_lib_format
+// Formats packed values as ISO-8601 timestamps. Takes no format spec.
+struct iso8601_formatter
+{
+    constexpr std::format_parse_context::iterator parse(std::format_parse_context& context)
+    {
+        auto it = context.begin();
+        if(it != context.end() && *it != '}')
+        {
+            throw std::format_error("smalltime values take no format spec");
+        }
+        return it;
+    }
+
+    template<typename TIME, typename CONTEXT>
+    typename CONTEXT::iterator format(TIME time, CONTEXT& context) const
+    {
+        char buffer[SMALLTIME_ISO8601_MAX_LENGTH + 1];
+        return std::copy_n(buffer, format_iso8601(time, buffer), context.out());
+    }
+};
+#endif // __cpp_lib_format
+
+} // namespace smalltime_cpp
+
+#ifdef __cpp_lib_format
+template<>
+struct std::formatter<smalltime_cpp::packed_smalltime, char>: smalltime_cpp::iso8601_formatter
+{
+};
+
+template<>
+struct std::formatter<smalltime_cpp::packed_nanotime, char>: smalltime_cpp::iso8601_formatter
+{
+};
+#endif // __cpp_lib_format
+
+#endif // __cplusplus >= 202002L
+
+#endif // KS_smalltime_chrono_H
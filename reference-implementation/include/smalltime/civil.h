@@ -0,0 +1,127 @@
+/*
+ * Smalltime Civil Calendar Helpers
+ * ================================
+ *
+ * Conversions between proleptic Gregorian dates and a linear day count
+ * (days since 1970-01-01), plus the leap year and month length rules.
+ *
+ * The day count conversions use the Neri-Schneider algorithms (Euclidean
+ * affine functions), which need no tables and no data dependent branches.
+ * The calendar is shifted forward by a whole number of 400-year cycles so
+ * that all intermediate values are unsigned, which covers the full
+ * smalltime year range (-131072 - 131071).
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_civil_H
+#define KS_smalltime_civil_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+// Number of 400-year cycles the calendar is shifted by so that year -131072
+// becomes positive.
+#define SMALLTIME_CIVIL_ERA_SHIFT   328
+// Years added by the shift.
+#define SMALLTIME_CIVIL_YEAR_SHIFT  (400 * SMALLTIME_CIVIL_ERA_SHIFT)
+// Days from the shifted calendar's origin (March 1st) to 1970-01-01.
+#define SMALLTIME_CIVIL_DAY_SHIFT   (719468 + 146097 * SMALLTIME_CIVIL_ERA_SHIFT)
+
+
+
+/**
+ * Check if a year is a leap year in the proleptic Gregorian calendar.
+ *
+ * @param year The year (1 = 1 AD, 0 = 1 BC, -1 = 2 BC, ...).
+ * @return nonzero if the year is a leap year.
+ */
+static inline int smalltime_is_leap_year(int year)
+{
+    // Divisible by 4, and either not by 100 or by 400 (i.e. by 16).
+    return (year & 3) == 0 && ((year % 100) != 0 || (year & 15) == 0);
+}
+
+/**
+ * Get the number of days in a month.
+ *
+ * @param year The year (1 = 1 AD, 0 = 1 BC, -1 = 2 BC, ...).
+ * @param month The month of the year (1 - 12).
+ * @return the number of days in the month (28 - 31).
+ */
+static inline int smalltime_days_in_month(int year, int month)
+{
+    if(month == 2)
+    {
+        return smalltime_is_leap_year(year) ? 29 : 28;
+    }
+    // 30 + alternating pattern that flips after July.
+    return 30 + ((month ^ (month >> 3)) & 1);
+}
+
+/**
+ * Convert a date to the number of days since 1970-01-01.
+ * Note: Input is NOT validated!
+ *
+ * @param year The year (-131072 - 131071).
+ * @param month The month of the year (1 - 12).
+ * @param day The day of the month (1 - 31).
+ * @return the number of days since 1970-01-01 (negative for earlier dates).
+ */
+static inline int32_t smalltime_days_from_civil(int year, int month, int day)
+{
+    // Count from March so that the leap day is the last day of the year.
+    uint32_t is_jan_feb = month <= 2;
+    uint32_t y = (uint32_t)(year + SMALLTIME_CIVIL_YEAR_SHIFT) - is_jan_feb;
+    uint32_t m = (uint32_t)month + 12 * is_jan_feb;
+    uint32_t century = y / 100;
+    uint32_t year_days = 1461 * y / 4 - century + century / 4;
+    uint32_t month_days = (979 * m - 2919) / 32;
+    uint32_t days = year_days + month_days + (uint32_t)day - 1;
+    return (int32_t)(days - SMALLTIME_CIVIL_DAY_SHIFT);
+}
+
+/**
+ * Convert a number of days since 1970-01-01 to a date.
+ *
+ * @param days The number of days since 1970-01-01.
+ * @param year Where to store the year.
+ * @param month Where to store the month of the year (1 - 12).
+ * @param day Where to store the day of the month (1 - 31).
+ */
+static inline void smalltime_civil_from_days(int32_t days, int* year, int* month, int* day)
+{
+    uint32_t n = (uint32_t)days + SMALLTIME_CIVIL_DAY_SHIFT;
+
+    uint32_t n1 = 4 * n + 3;
+    uint32_t century = n1 / 146097;
+    uint32_t day_of_century = n1 % 146097 / 4;
+
+    uint32_t n2 = 4 * day_of_century + 3;
+    uint64_t p2 = (uint64_t)2939745 * n2;
+    uint32_t year_of_century = (uint32_t)(p2 >> 32);
+    uint32_t day_of_year = (uint32_t)p2 / 2939745 / 4;
+
+    uint32_t n3 = 2141 * day_of_year + 197913;
+    uint32_t m = n3 >> 16;
+    uint32_t d = (n3 & 0xffff) / 2141;
+
+    // Days after February belong to the next calendar year.
+    uint32_t is_jan_feb = day_of_year >= 306;
+    *year = (int)(100 * century + year_of_century + is_jan_feb) - SMALLTIME_CIVIL_YEAR_SHIFT;
+    *month = (int)(m - 12 * is_jan_feb);
+    *day = (int)(d + 1);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_civil_H
@@ -0,0 +1,74 @@
+/*
+ * Smalltime Clock
+ * ===============
+ *
+ * Reads the current UTC time directly as a smalltime or nanotime value.
+ *
+ * Each thread caches the year, month, day and hour fields of the hour it
+ * last read, so most calls are a single clock read plus a few shifts and
+ * adds. The cached fields are only recalculated when the clock leaves that
+ * hour.
+ *
+ * The coarse variants read CLOCK_REALTIME_COARSE, which is cheaper still
+ * but only advances once per scheduler tick (typically 1 - 4 ms). Where
+ * there is no coarse clock they are the same as the regular variants.
+ *
+ * Like the system clock, these never return a leap second (second 60),
+ * and can go backwards if the system time is adjusted.
+ *
+ * The clock functions live in the compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_clock_H
+#define KS_smalltime_clock_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+
+/**
+ * Get the current time.
+ *
+ * @return the current time, with microsecond resolution.
+ */
+SMALLTIME_API smalltime smalltime_now(void);
+
+/**
+ * Get the current time.
+ * Note: The system clock must be within the nanotime range.
+ *
+ * @return the current time, with nanosecond resolution.
+ */
+SMALLTIME_API nanotime nanotime_now(void);
+
+/**
+ * Get the current time from the coarse clock.
+ *
+ * @return the current time, as of the last scheduler tick.
+ */
+SMALLTIME_API smalltime smalltime_now_coarse(void);
+
+/**
+ * Get the current time from the coarse clock.
+ * Note: The system clock must be within the nanotime range.
+ *
+ * @return the current time, as of the last scheduler tick.
+ */
+SMALLTIME_API nanotime nanotime_now_coarse(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_clock_H
@@ -0,0 +1,142 @@
+/*
+ * Smalltime Column Codec
+ * ======================
+ *
+ * Compresses arrays (columns) of smalltime or nanotime values, using the
+ * field layout instead of treating the values as opaque integers.
+ *
+ * Neighbouring values in a timestamp column almost always share the same
+ * year, month, day and hour, and their time within the hour differs by
+ * far less than an hour. The codec splits each value into two keys:
+ *
+ *  - The hour key: every field from the hour up (value >> hour shift).
+ *    Stored as an offset from the smallest hour key in the block.
+ *  - The time key: minutes, seconds and fraction as one count of
+ *    microseconds (nanoseconds) since the start of the hour. Stored as the
+ *    difference from the previous value's time key, or from the start of
+ *    the hour when the hour key changes, offset by the smallest difference
+ *    in the block.
+ *
+ * Both are bit-packed at the narrowest width that holds every value in the
+ * block. A block of a sorted column within one hour typically packs its
+ * hour keys into 0 bits, and its time keys into just enough bits for the
+ * largest gap between neighbours.
+ *
+ * Values with a minute, second or fraction field out of range (including
+ * leap seconds) don't have a time key, so a block holding any of them is
+ * stored raw. Encoding is lossless for any bit pattern.
+ *
+ * Decoding is vectorized (see dispatch.h).
+ *
+ *
+ * Format
+ * ------
+ *
+ * An encoded column is a sequence of blocks of up to 128 values each (only
+ * the last block is shorter). Multi-byte values are little endian.
+ *
+ *     byte 0: 0 = packed block, 1 = raw block
+ *     byte 1: number of values in the block - 1
+ *
+ * A raw block continues with the values, 8 bytes each. A packed block
+ * continues with:
+ *
+ *     8 bytes:  the first value
+ *     1 byte:   hour key width in bits
+ *     1 byte:   time key width in bits
+ *     varint:   first hour key - smallest hour key
+ *     varint:   smallest time difference (zigzag encoded)
+ *     bits:     hour key offsets of the remaining values
+ *     bits:     time differences of the remaining values
+ *     padding:  zeros, so that 8 bytes can be read starting at the byte
+ *               holding the last packed value (if there is one)
+ *
+ * Varints are unsigned LEB128. Packed values are stored least significant
+ * bit first, with each stream starting on a byte boundary.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_codec_H
+#define KS_smalltime_codec_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// The maximum number of values in a block.
+#define SMALLTIME_CODEC_BLOCK_LENGTH 128
+
+// The most space that encoding count values can take.
+#define SMALLTIME_CODEC_MAX_SIZE(count) \
+    ((count) * 8 + ((count) + SMALLTIME_CODEC_BLOCK_LENGTH - 1) / SMALLTIME_CODEC_BLOCK_LENGTH * 2)
+
+
+
+/**
+ * Encode a column of time values.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param buffer Where to write, with room for SMALLTIME_CODEC_MAX_SIZE(count) bytes.
+ * @return the number of bytes written.
+ */
+SMALLTIME_API size_t smalltime_codec_encode(const smalltime* values, size_t count, uint8_t* buffer);
+
+/**
+ * Encode a column of time values.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param buffer Where to write, with room for SMALLTIME_CODEC_MAX_SIZE(count) bytes.
+ * @return the number of bytes written.
+ */
+SMALLTIME_API size_t nanotime_codec_encode(const nanotime* values, size_t count, uint8_t* buffer);
+
+/**
+ * Decode a column of time values.
+ *
+ * Decoding stops early at a block that is corrupt or truncated, or that
+ * doesn't fit in the remaining capacity.
+ *
+ * @param data The encoded column.
+ * @param size The size of the encoded column in bytes.
+ * @param values Where to store the decoded values.
+ * @param capacity The number of values that fit in values.
+ * @param end_offset Receives the offset of the first block that wasn't
+ *                   decoded (size if every block was). Can be NULL.
+ * @return the number of values decoded.
+ */
+SMALLTIME_API size_t smalltime_codec_decode(const uint8_t* data, size_t size, smalltime* values, size_t capacity, size_t* end_offset);
+
+/**
+ * Decode a column of time values.
+ *
+ * Decoding stops early at a block that is corrupt or truncated, or that
+ * doesn't fit in the remaining capacity.
+ *
+ * @param data The encoded column.
+ * @param size The size of the encoded column in bytes.
+ * @param values Where to store the decoded values.
+ * @param capacity The number of values that fit in values.
+ * @param end_offset Receives the offset of the first block that wasn't
+ *                   decoded (size if every block was). Can be NULL.
+ * @return the number of values decoded.
+ */
+SMALLTIME_API size_t nanotime_codec_decode(const uint8_t* data, size_t size, nanotime* values, size_t capacity, size_t* end_offset);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_codec_H
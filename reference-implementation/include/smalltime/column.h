@@ -0,0 +1,268 @@
+/*
+ * Smalltime Column Files
+ * ======================
+ *
+ * Stores a column of smalltime or nanotime values on disk, and answers
+ * range queries ("every value from T1 up to T2") by memory mapping the
+ * file and handing out spans of the mapping, without reading or copying
+ * the rest of the column.
+ *
+ * Values are stored as-is, in fixed-size blocks. Each block has a zone map
+ * entry holding the smallest and largest value in the block, and whether
+ * the block is sorted. A query skips every block whose zone map doesn't
+ * overlap the range, and trims sorted blocks to the exact range by binary
+ * search. In a sorted column, the result is a single span.
+ *
+ * When the blocks are in order (each block's smallest and largest values
+ * are no smaller than the previous block's), as in a sorted column or one
+ * with a few late arrivals, the first matching block is found by binary
+ * search over the zone map, and the query stops at the first block past
+ * the range. Otherwise every zone map entry is checked.
+ *
+ * An unsorted block that only partly overlaps the range is returned whole,
+ * marked as inexact, and the caller has to filter it.
+ *
+ *
+ * Format
+ * ------
+ *
+ * Multi-byte values are in the byte order of the machine that wrote the
+ * file. Readers refuse files written in the other byte order, since values
+ * are handed out in place.
+ *
+ *     Header (64 bytes):
+ *         8 bytes: "STCOLUMN"
+ *         4 bytes: format version (1)
+ *         4 bytes: 0x01020304, as a byte order mark
+ *         4 bytes: 0 = smalltime column, 1 = nanotime column
+ *         4 bytes: values per block
+ *         8 bytes: number of values
+ *         8 bytes: offset of the zone map (64 + 8 * number of values)
+ *         8 bytes: flags (bit 0: the blocks are in order)
+ *         zeros up to 64 bytes
+ *
+ *     Values: 8 bytes each. Block n holds values from n * values per block.
+ *
+ *     Zone map, 24 bytes per block:
+ *         8 bytes: smallest value in the block
+ *         8 bytes: largest value in the block
+ *         8 bytes: flags (bit 0: the block is sorted)
+ *
+ * The writer fills in the header when it's closed, so a file that wasn't
+ * closed properly can't be opened.
+ *
+ * Reading needs mmap() (or MapViewOfFile() on Windows).
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_column_H
+#define KS_smalltime_column_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// The number of values per block when none is given (32 KiB blocks).
+#define SMALLTIME_COLUMN_BLOCK_LENGTH 4096
+
+typedef struct smalltime_column_writer smalltime_column_writer;
+typedef struct nanotime_column_writer nanotime_column_writer;
+typedef struct smalltime_column smalltime_column;
+typedef struct nanotime_column nanotime_column;
+
+// Iterates over the spans of values that a range query matches, in file
+// order. Only the span fields are public.
+typedef struct
+{
+    // The current span, pointing into the file mapping.
+    const smalltime* values;
+    size_t count;
+    // Nonzero if every value in the span is within the range. Otherwise
+    // the span is an unsorted block that needs to be filtered.
+    int exact;
+
+    const smalltime_column* column;
+    smalltime start;
+    smalltime end;
+    size_t next_block;
+} smalltime_column_query;
+
+typedef struct
+{
+    // The current span, pointing into the file mapping.
+    const nanotime* values;
+    size_t count;
+    // Nonzero if every value in the span is within the range. Otherwise
+    // the span is an unsorted block that needs to be filtered.
+    int exact;
+
+    const nanotime_column* column;
+    nanotime start;
+    nanotime end;
+    size_t next_block;
+} nanotime_column_query;
+
+
+
+/**
+ * Create (or replace) a column file, and open it for writing.
+ *
+ * @param path The file path.
+ * @param block_length The number of values per block, or 0 for
+ *                     SMALLTIME_COLUMN_BLOCK_LENGTH.
+ * @return the writer, or NULL if the file couldn't be created (see errno).
+ */
+SMALLTIME_API smalltime_column_writer* smalltime_column_writer_open(const char* path, size_t block_length);
+
+/**
+ * Create (or replace) a column file, and open it for writing.
+ *
+ * @param path The file path.
+ * @param block_length The number of values per block, or 0 for
+ *                     SMALLTIME_COLUMN_BLOCK_LENGTH.
+ * @return the writer, or NULL if the file couldn't be created (see errno).
+ */
+SMALLTIME_API nanotime_column_writer* nanotime_column_writer_open(const char* path, size_t block_length);
+
+/**
+ * Append values to a column file.
+ *
+ * @param writer The writer.
+ * @param values The values to append.
+ * @param count The number of values.
+ * @return nonzero on success, or 0 if writing failed (see errno).
+ */
+SMALLTIME_API int smalltime_column_writer_append(smalltime_column_writer* writer, const smalltime* values, size_t count);
+
+/**
+ * Append values to a column file.
+ *
+ * @param writer The writer.
+ * @param values The values to append.
+ * @param count The number of values.
+ * @return nonzero on success, or 0 if writing failed (see errno).
+ */
+SMALLTIME_API int nanotime_column_writer_append(nanotime_column_writer* writer, const nanotime* values, size_t count);
+
+/**
+ * Finish a column file and free the writer.
+ *
+ * @param writer The writer.
+ * @return nonzero on success, or 0 if this or any earlier write failed, in
+ *         which case the file is left unreadable.
+ */
+SMALLTIME_API int smalltime_column_writer_close(smalltime_column_writer* writer);
+
+/**
+ * Finish a column file and free the writer.
+ *
+ * @param writer The writer.
+ * @return nonzero on success, or 0 if this or any earlier write failed, in
+ *         which case the file is left unreadable.
+ */
+SMALLTIME_API int nanotime_column_writer_close(nanotime_column_writer* writer);
+
+/**
+ * Open and map a column file for reading.
+ *
+ * @param path The file path.
+ * @return the column, or NULL if the file couldn't be mapped, or isn't a
+ *         complete smalltime column file.
+ */
+SMALLTIME_API smalltime_column* smalltime_column_open(const char* path);
+
+/**
+ * Open and map a column file for reading.
+ *
+ * @param path The file path.
+ * @return the column, or NULL if the file couldn't be mapped, or isn't a
+ *         complete nanotime column file.
+ */
+SMALLTIME_API nanotime_column* nanotime_column_open(const char* path);
+
+/**
+ * Unmap a column file. Spans from it are no longer valid.
+ *
+ * @param column The column.
+ */
+SMALLTIME_API void smalltime_column_close(smalltime_column* column);
+
+/**
+ * Unmap a column file. Spans from it are no longer valid.
+ *
+ * @param column The column.
+ */
+SMALLTIME_API void nanotime_column_close(nanotime_column* column);
+
+/**
+ * Get every value in a column file.
+ *
+ * @param column The column.
+ * @param count Receives the number of values.
+ * @return the values, in the file mapping.
+ */
+SMALLTIME_API const smalltime* smalltime_column_values(const smalltime_column* column, size_t* count);
+
+/**
+ * Get every value in a column file.
+ *
+ * @param column The column.
+ * @param count Receives the number of values.
+ * @return the values, in the file mapping.
+ */
+SMALLTIME_API const nanotime* nanotime_column_values(const nanotime_column* column, size_t* count);
+
+/**
+ * Start a range query. Call smalltime_column_query_next() to get each span.
+ *
+ * @param column The column.
+ * @param start The start of the range (inclusive).
+ * @param end The end of the range (exclusive).
+ * @param query The query to start.
+ */
+SMALLTIME_API void smalltime_column_query_start(const smalltime_column* column, smalltime start, smalltime end,
+                                                smalltime_column_query* query);
+
+/**
+ * Start a range query. Call nanotime_column_query_next() to get each span.
+ *
+ * @param column The column.
+ * @param start The start of the range (inclusive).
+ * @param end The end of the range (exclusive).
+ * @param query The query to start.
+ */
+SMALLTIME_API void nanotime_column_query_start(const nanotime_column* column, nanotime start, nanotime end,
+                                               nanotime_column_query* query);
+
+/**
+ * Move a range query to its next span.
+ *
+ * @param query The query.
+ * @return nonzero if query now holds the next span, or 0 if there are no more.
+ */
+SMALLTIME_API int smalltime_column_query_next(smalltime_column_query* query);
+
+/**
+ * Move a range query to its next span.
+ *
+ * @param query The query.
+ * @return nonzero if query now holds the next span, or 0 if there are no more.
+ */
+SMALLTIME_API int nanotime_column_query_next(nanotime_column_query* query);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_column_H
@@ -0,0 +1,171 @@
+/*
+ * Smalltime / Nanotime Conversion
+ * ===============================
+ *
+ * Conversions between smalltime and nanotime values, for moving data
+ * between nanosecond resolution and the wider smalltime year range.
+ *
+ * Both types store the month, day, hour, minute and second fields in the
+ * same 26 bits, so these move across with a single shift. What changes is
+ * the year, which nanotime stores as an unsigned offset from 1970, and the
+ * sub-second field:
+ *
+ *  * Nanotime to smalltime always succeeds, since every nanotime year fits
+ *    in a smalltime. Nanoseconds are either truncated to microseconds, or
+ *    rounded to the nearest microsecond with ties going to the even one.
+ *    Rounding up from the last microsecond of a second carries into the
+ *    following second (see arith.h), which is the only case that looks at
+ *    the calendar.
+ *  * Smalltime to nanotime is lossless, but only years 1970 - 2225 fit in
+ *    a nanotime. Values outside of this range are reported rather than
+ *    converted.
+ *
+ * The scalar functions are inline. The batch functions live in the
+ * compiled smalltime library, and run 8 values at a time with AVX-512.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_convert_H
+#define KS_smalltime_convert_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+#include <smalltime/arith.h>
+
+
+// Internal defines. These will be undef'd at the end of the header.
+#define SMALLTIME_CONVERT_ST_SHIFT_YEAR 46
+#define SMALLTIME_CONVERT_ST_MASK_MICROSECOND 0xfffffULL
+#define SMALLTIME_CONVERT_NT_MASK_NANOSECOND 0x3fffffffULL
+#define SMALLTIME_CONVERT_NT_ZERO_YEAR 1970
+// The nanotime fields move down this far to land on the smalltime ones.
+#define SMALLTIME_CONVERT_FIELD_SHIFT 10
+// A nanotime year of 0, as a smalltime.
+#define SMALLTIME_CONVERT_YEAR_BASE ((uint64_t)SMALLTIME_CONVERT_NT_ZERO_YEAR << SMALLTIME_CONVERT_ST_SHIFT_YEAR)
+// One past the last year that fits, counted from SMALLTIME_CONVERT_YEAR_BASE.
+#define SMALLTIME_CONVERT_YEAR_LIMIT (256ULL << SMALLTIME_CONVERT_ST_SHIFT_YEAR)
+
+typedef enum
+{
+    // Drop the nanoseconds below the microsecond.
+    SMALLTIME_CONVERT_TRUNCATE         = 0,
+    // Round to the nearest microsecond, with halves rounded to even.
+    SMALLTIME_CONVERT_ROUND_HALF_EVEN  = 1,
+} smalltime_convert_rounding;
+
+// Rounds nanoseconds to microseconds. Can return 1000000.
+static inline uint32_t smalltime_convert_microseconds(uint32_t nanosecond, smalltime_convert_rounding rounding)
+{
+    uint32_t microsecond = nanosecond / 1000;
+    if(rounding == SMALLTIME_CONVERT_ROUND_HALF_EVEN)
+    {
+        uint32_t remainder = nanosecond - microsecond * 1000;
+        microsecond += remainder > 500 || (remainder == 500 && (microsecond & 1));
+    }
+    return microsecond;
+}
+
+// The second after the one a value is in. Leap seconds are followed by the
+// start of the next minute, like second 59.
+static inline smalltime smalltime_convert_next_second(smalltime time)
+{
+    if(smalltime_get_second(time) == 60)
+    {
+        time = smalltime_with_second(time, 59);
+    }
+    return smalltime_add_seconds(time, 1);
+}
+
+
+
+/**
+ * Convert a nanotime value to a smalltime value.
+ * Note: Input is NOT validated!
+ *
+ * @param time The nanotime value.
+ * @param rounding How to handle nanoseconds below the microsecond.
+ * @return the smalltime value.
+ */
+static inline smalltime nanotime_to_smalltime(nanotime time, smalltime_convert_rounding rounding)
+{
+    smalltime fields = (smalltime)(((time & ~SMALLTIME_CONVERT_NT_MASK_NANOSECOND) >> SMALLTIME_CONVERT_FIELD_SHIFT) + SMALLTIME_CONVERT_YEAR_BASE);
+    uint32_t microsecond = smalltime_convert_microseconds((uint32_t)(time & SMALLTIME_CONVERT_NT_MASK_NANOSECOND), rounding);
+    if(microsecond == 1000000)
+    {
+        return smalltime_convert_next_second(fields);
+    }
+    return fields | microsecond;
+}
+
+/**
+ * Convert a smalltime value to a nanotime value, if its year is within the
+ * nanotime range (1970 - 2225).
+ * Note: Input is NOT validated!
+ *
+ * @param time The smalltime value.
+ * @param result Where to store the nanotime value. Untouched on failure.
+ * @return nonzero if the value was converted, or 0 if it is out of range.
+ */
+static inline int smalltime_to_nanotime(smalltime time, nanotime* result)
+{
+    uint64_t rebased = (uint64_t)time - SMALLTIME_CONVERT_YEAR_BASE;
+    if(rebased >= SMALLTIME_CONVERT_YEAR_LIMIT)
+    {
+        return 0;
+    }
+    *result = ((rebased & ~SMALLTIME_CONVERT_ST_MASK_MICROSECOND) << SMALLTIME_CONVERT_FIELD_SHIFT) |
+              (rebased & SMALLTIME_CONVERT_ST_MASK_MICROSECOND) * 1000;
+    return 1;
+}
+
+/**
+ * Convert an array of nanotime values to smalltime values.
+ * Equivalent to calling nanotime_to_smalltime() on every value.
+ * Note: Input is NOT validated!
+ *
+ * @param values The nanotime values.
+ * @param count The number of values.
+ * @param rounding How to handle nanoseconds below the microsecond.
+ * @param results Where to store the smalltime values. Can be the same array as values.
+ */
+SMALLTIME_API void nanotime_batch_to_smalltime(const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results);
+
+/**
+ * Convert an array of smalltime values to nanotime values, flagging those
+ * outside of the nanotime year range (1970 - 2225). Value i is flagged by
+ * bit i % 64 of out_of_range[i / 64].
+ * Note: Input is NOT validated!
+ *
+ * @param values The smalltime values.
+ * @param count The number of values.
+ * @param results Where to store the nanotime values. Entries for values out of range are untouched.
+ * @param out_of_range Room for (count + 63) / 64 words, or NULL.
+ * @return the number of values out of range.
+ */
+SMALLTIME_API size_t smalltime_batch_to_nanotime(const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range);
+
+
+#undef SMALLTIME_CONVERT_ST_SHIFT_YEAR
+#undef SMALLTIME_CONVERT_ST_MASK_MICROSECOND
+#undef SMALLTIME_CONVERT_NT_MASK_NANOSECOND
+#undef SMALLTIME_CONVERT_NT_ZERO_YEAR
+#undef SMALLTIME_CONVERT_FIELD_SHIFT
+#undef SMALLTIME_CONVERT_YEAR_BASE
+#undef SMALLTIME_CONVERT_YEAR_LIMIT
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_convert_H
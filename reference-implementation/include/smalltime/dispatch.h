@@ -0,0 +1,82 @@
+/*
+ * Smalltime Kernel Dispatch
+ * =========================
+ *
+ * The batch kernels in the smalltime library are compiled for several
+ * instruction set levels. When the library is loaded, it detects what the
+ * CPU supports and routes every kernel to the best available variant, so
+ * one build runs everywhere and still uses AVX2/AVX-512 where present.
+ *
+ * The selection can be overridden at load time by setting the environment
+ * variable SMALLTIME_ISA to "scalar", "sse42", "avx2" or "avx512", or at
+ * runtime with smalltime_set_isa(). Requests for an instruction set the CPU
+ * doesn't support are lowered to the best one it does.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_dispatch_H
+#define KS_smalltime_dispatch_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <smalltime/export.h>
+
+
+/**
+ * Instruction set levels that kernels are built for, in ascending order.
+ */
+typedef enum
+{
+    SMALLTIME_ISA_SCALAR = 0,
+    SMALLTIME_ISA_SSE42  = 1,
+    SMALLTIME_ISA_AVX2   = 2,
+    SMALLTIME_ISA_AVX512 = 3,
+} smalltime_isa;
+
+
+/**
+ * Get the instruction set level the kernels are currently routed to.
+ *
+ * @return the active instruction set level.
+ */
+SMALLTIME_API smalltime_isa smalltime_get_isa(void);
+
+/**
+ * Get the highest instruction set level supported by both the library
+ * build and the CPU.
+ *
+ * @return the best available instruction set level.
+ */
+SMALLTIME_API smalltime_isa smalltime_get_best_isa(void);
+
+/**
+ * Route all kernels to a different instruction set level.
+ * Levels the CPU doesn't support are lowered to the best one it does.
+ * Note: This is NOT thread safe! It is intended for testing and
+ *       benchmarking, before any other threads use the library.
+ *
+ * @param isa The requested instruction set level.
+ * @return the instruction set level actually selected.
+ */
+SMALLTIME_API smalltime_isa smalltime_set_isa(smalltime_isa isa);
+
+/**
+ * Get the name of an instruction set level ("scalar", "sse42", "avx2",
+ * "avx512"), as accepted by the SMALLTIME_ISA environment variable.
+ *
+ * @param isa The instruction set level.
+ * @return the name, or "unknown".
+ */
+SMALLTIME_API const char* smalltime_isa_name(smalltime_isa isa);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_dispatch_H
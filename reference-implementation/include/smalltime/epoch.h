@@ -0,0 +1,260 @@
+/*
+ * Smalltime Unix Epoch Conversions
+ * ================================
+ *
+ * Converts between smalltime/nanotime values and linear Unix time counts
+ * (seconds, microseconds or nanoseconds since 1970-01-01T00:00:00Z),
+ * without going through gmtime_r() or timegm().
+ *
+ * As with POSIX time, leap seconds are not counted: a second field of 60
+ * converts to the same count as second 0 of the following minute, and
+ * conversions from a count never produce a second field of 60.
+ *
+ * The scalar conversions are inline. The batch conversions live in the
+ * compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_epoch_H
+#define KS_smalltime_epoch_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/civil.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// Internal defines. These will be undef'd at the end of the header.
+#define SMALLTIME_SECONDS_PER_DAY 86400
+// Seconds from the shifted civil origin to the Unix epoch. Adding this makes
+// every supported time non-negative, so the day split is a plain division.
+#define SMALLTIME_EPOCH_SECOND_SHIFT ((uint64_t)SMALLTIME_CIVIL_DAY_SHIFT * SMALLTIME_SECONDS_PER_DAY)
+
+static inline uint64_t smalltime_epoch_time_of_day(int hour, int minute, int second)
+{
+    return (uint64_t)(hour * 3600 + minute * 60 + second);
+}
+
+
+
+/**
+ * Convert Unix seconds to a time value.
+ * Valid range is the smalltime year range (-131072 - 131071).
+ *
+ * @param seconds Seconds since 1970-01-01T00:00:00Z.
+ * @return the time value.
+ */
+static inline smalltime smalltime_from_unix_seconds(int64_t seconds)
+{
+    uint64_t shifted = (uint64_t)seconds + SMALLTIME_EPOCH_SECOND_SHIFT;
+    uint64_t days = shifted / SMALLTIME_SECONDS_PER_DAY;
+    uint32_t second_of_day = (uint32_t)(shifted - days * SMALLTIME_SECONDS_PER_DAY);
+    int year, month, day;
+    smalltime_civil_from_days((int32_t)(days - SMALLTIME_CIVIL_DAY_SHIFT), &year, &month, &day);
+    return smalltime_new(year, month, day,
+                         second_of_day / 3600,
+                         second_of_day / 60 % 60,
+                         second_of_day % 60,
+                         0);
+}
+
+/**
+ * Convert Unix microseconds to a time value.
+ * Valid range is the smalltime year range (-131072 - 131071).
+ *
+ * @param microseconds Microseconds since 1970-01-01T00:00:00Z.
+ * @return the time value.
+ */
+static inline smalltime smalltime_from_unix_microseconds(int64_t microseconds)
+{
+    uint64_t shifted = (uint64_t)microseconds + SMALLTIME_EPOCH_SECOND_SHIFT * 1000000;
+    uint64_t seconds = shifted / 1000000;
+    int microsecond = (int)(shifted - seconds * 1000000);
+    return smalltime_from_unix_seconds((int64_t)(seconds - SMALLTIME_EPOCH_SECOND_SHIFT)) | microsecond;
+}
+
+/**
+ * Convert a time value to Unix seconds.
+ * The microsecond component is discarded.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @return seconds since 1970-01-01T00:00:00Z.
+ */
+static inline int64_t smalltime_to_unix_seconds(smalltime time)
+{
+    int64_t days = smalltime_days_from_civil(smalltime_get_year(time), smalltime_get_month(time), smalltime_get_day(time));
+    return days * SMALLTIME_SECONDS_PER_DAY +
+           (int64_t)smalltime_epoch_time_of_day(smalltime_get_hour(time), smalltime_get_minute(time), smalltime_get_second(time));
+}
+
+/**
+ * Convert a time value to Unix microseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @return microseconds since 1970-01-01T00:00:00Z.
+ */
+static inline int64_t smalltime_to_unix_microseconds(smalltime time)
+{
+    return smalltime_to_unix_seconds(time) * 1000000 + smalltime_get_microsecond(time);
+}
+
+/**
+ * Convert Unix seconds to a time value.
+ * Valid range is the nanotime year range (1970 - 2225).
+ *
+ * @param seconds Seconds since 1970-01-01T00:00:00Z.
+ * @return the time value.
+ */
+static inline nanotime nanotime_from_unix_seconds(int64_t seconds)
+{
+    uint64_t days = (uint64_t)seconds / SMALLTIME_SECONDS_PER_DAY;
+    uint32_t second_of_day = (uint32_t)((uint64_t)seconds - days * SMALLTIME_SECONDS_PER_DAY);
+    int year, month, day;
+    smalltime_civil_from_days((int32_t)days, &year, &month, &day);
+    return nanotime_new(year, month, day,
+                        second_of_day / 3600,
+                        second_of_day / 60 % 60,
+                        second_of_day % 60,
+                        0);
+}
+
+/**
+ * Convert Unix nanoseconds to a time value.
+ * Valid range is the nanotime year range (1970 - 2225).
+ *
+ * @param nanoseconds Nanoseconds since 1970-01-01T00:00:00Z.
+ * @return the time value.
+ */
+static inline nanotime nanotime_from_unix_nanoseconds(int64_t nanoseconds)
+{
+    uint64_t seconds = (uint64_t)nanoseconds / 1000000000;
+    int nanosecond = (int)((uint64_t)nanoseconds - seconds * 1000000000);
+    return nanotime_from_unix_seconds((int64_t)seconds) | (nanotime)nanosecond;
+}
+
+/**
+ * Convert a time value to Unix seconds.
+ * The nanosecond component is discarded.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @return seconds since 1970-01-01T00:00:00Z.
+ */
+static inline int64_t nanotime_to_unix_seconds(nanotime time)
+{
+    int64_t days = smalltime_days_from_civil(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time));
+    return days * SMALLTIME_SECONDS_PER_DAY +
+           (int64_t)smalltime_epoch_time_of_day(nanotime_get_hour(time), nanotime_get_minute(time), nanotime_get_second(time));
+}
+
+/**
+ * Convert a time value to Unix nanoseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @return nanoseconds since 1970-01-01T00:00:00Z.
+ */
+static inline int64_t nanotime_to_unix_nanoseconds(nanotime time)
+{
+    return nanotime_to_unix_seconds(time) * 1000000000 + nanotime_get_nanosecond(time);
+}
+
+
+
+/**
+ * Convert an array of Unix seconds to time values.
+ *
+ * @param seconds Seconds since 1970-01-01T00:00:00Z.
+ * @param count The number of values.
+ * @param values Where to store the time values.
+ */
+SMALLTIME_API void smalltime_batch_from_unix_seconds(const int64_t* seconds, size_t count, smalltime* values);
+
+/**
+ * Convert an array of Unix microseconds to time values.
+ *
+ * @param microseconds Microseconds since 1970-01-01T00:00:00Z.
+ * @param count The number of values.
+ * @param values Where to store the time values.
+ */
+SMALLTIME_API void smalltime_batch_from_unix_microseconds(const int64_t* microseconds, size_t count, smalltime* values);
+
+/**
+ * Convert an array of time values to Unix seconds.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param seconds Where to store the seconds since 1970-01-01T00:00:00Z.
+ */
+SMALLTIME_API void smalltime_batch_to_unix_seconds(const smalltime* values, size_t count, int64_t* seconds);
+
+/**
+ * Convert an array of time values to Unix microseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param microseconds Where to store the microseconds since 1970-01-01T00:00:00Z.
+ */
+SMALLTIME_API void smalltime_batch_to_unix_microseconds(const smalltime* values, size_t count, int64_t* microseconds);
+
+/**
+ * Convert an array of Unix seconds to time values.
+ *
+ * @param seconds Seconds since 1970-01-01T00:00:00Z.
+ * @param count The number of values.
+ * @param values Where to store the time values.
+ */
+SMALLTIME_API void nanotime_batch_from_unix_seconds(const int64_t* seconds, size_t count, nanotime* values);
+
+/**
+ * Convert an array of Unix nanoseconds to time values.
+ *
+ * @param nanoseconds Nanoseconds since 1970-01-01T00:00:00Z.
+ * @param count The number of values.
+ * @param values Where to store the time values.
+ */
+SMALLTIME_API void nanotime_batch_from_unix_nanoseconds(const int64_t* nanoseconds, size_t count, nanotime* values);
+
+/**
+ * Convert an array of time values to Unix seconds.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param seconds Where to store the seconds since 1970-01-01T00:00:00Z.
+ */
+SMALLTIME_API void nanotime_batch_to_unix_seconds(const nanotime* values, size_t count, int64_t* seconds);
+
+/**
+ * Convert an array of time values to Unix nanoseconds.
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param nanoseconds Where to store the nanoseconds since 1970-01-01T00:00:00Z.
+ */
+SMALLTIME_API void nanotime_batch_to_unix_nanoseconds(const nanotime* values, size_t count, int64_t* nanoseconds);
+
+
+#undef SMALLTIME_SECONDS_PER_DAY
+#undef SMALLTIME_EPOCH_SECOND_SHIFT
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_epoch_H
@@ -0,0 +1,26 @@
+/*
+ * Symbol visibility for the functions implemented in the smalltime library.
+ *
+ * The inline functions in smalltime.h and nanotime.h don't need this. Only
+ * functions that live in the compiled library (batch kernels and friends)
+ * are marked with SMALLTIME_API.
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_export_H
+#define KS_smalltime_export_H
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+    #if defined(SMALLTIME_BUILDING_LIBRARY)
+        #define SMALLTIME_API __declspec(dllexport)
+    #else
+        #define SMALLTIME_API __declspec(dllimport)
+    #endif
+#elif defined(__GNUC__) || defined(__clang__)
+    #define SMALLTIME_API __attribute__((visibility("default")))
+#else
+    #define SMALLTIME_API
+#endif
+
+#endif // KS_smalltime_export_H
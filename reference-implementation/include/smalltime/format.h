@@ -0,0 +1,116 @@
+/*
+ * Smalltime ISO-8601 Formatting
+ * =============================
+ *
+ * Writes smalltime and nanotime values as ISO-8601 / RFC 3339 UTC
+ * timestamps into caller-supplied buffers, without allocating.
+ *
+ * Output is fixed width, always with the full fraction:
+ *
+ *     smalltime: 1985-10-26T08:22:16.900142Z
+ *     nanotime:  1985-10-26T08:22:16.900142000Z
+ *
+ * Smalltime years outside of 0000 - 9999 use the ISO-8601 expanded year
+ * representation: a sign followed by 6 digits. Year 0 is 1 BC, -1 is 2 BC
+ * and so on, the same as in the year field itself:
+ *
+ *     -000001-01-01T00:00:00.000000Z  (January 1st, 2 BC)
+ *     +131071-12-31T23:59:59.999999Z
+ *
+ * Formatting lives in the compiled smalltime library. The batch forms are
+ * dispatched kernels (see dispatch.h), with an AVX-512 variant that splits
+ * eight values at a time. Single values always use the scalar code.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_format_H
+#define KS_smalltime_format_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// Length of a smalltime with a year from 0000 to 9999.
+#define SMALLTIME_ISO8601_LENGTH 27
+// Length of a smalltime with an expanded year.
+#define SMALLTIME_ISO8601_MAX_LENGTH 30
+// Length of every nanotime.
+#define NANOTIME_ISO8601_LENGTH 30
+
+
+
+/**
+ * Write a time value as an ISO-8601 timestamp, followed by a null terminator.
+ * Note: Input is NOT validated!
+ *
+ * @param value The time value.
+ * @param buffer Where to write, with room for at least SMALLTIME_ISO8601_MAX_LENGTH + 1 chars.
+ * @return the length of the timestamp, not including the null terminator.
+ */
+SMALLTIME_API size_t smalltime_format_iso8601(smalltime value, char* buffer);
+
+/**
+ * Write a time value as an ISO-8601 timestamp, followed by a null terminator.
+ * Note: Input is NOT validated!
+ *
+ * @param value The time value.
+ * @param buffer Where to write, with room for at least NANOTIME_ISO8601_LENGTH + 1 chars.
+ * @return the length of the timestamp, not including the null terminator.
+ */
+SMALLTIME_API size_t nanotime_format_iso8601(nanotime value, char* buffer);
+
+/**
+ * Write an array of time values as ISO-8601 timestamps, without null terminators.
+ *
+ * With a stride of 0, each timestamp is followed by a newline, and the
+ * buffer needs room for count * (SMALLTIME_ISO8601_MAX_LENGTH + 1) chars.
+ *
+ * Otherwise each timestamp is written at buffer + index * stride, padded
+ * with spaces up to the stride, which must be at least
+ * SMALLTIME_ISO8601_MAX_LENGTH. The buffer needs room for count * stride chars.
+ *
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param stride The distance between timestamps, or 0 to separate them with newlines.
+ * @param buffer Where to write.
+ * @return the number of chars written.
+ */
+SMALLTIME_API size_t smalltime_batch_format_iso8601(const smalltime* values, size_t count, size_t stride, char* buffer);
+
+/**
+ * Write an array of time values as ISO-8601 timestamps, without null terminators.
+ *
+ * With a stride of 0, each timestamp is followed by a newline, and the
+ * buffer needs room for count * (NANOTIME_ISO8601_LENGTH + 1) chars.
+ *
+ * Otherwise each timestamp is written at buffer + index * stride, padded
+ * with spaces up to the stride, which must be at least
+ * NANOTIME_ISO8601_LENGTH. The buffer needs room for count * stride chars.
+ *
+ * Note: Input is NOT validated!
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param stride The distance between timestamps, or 0 to separate them with newlines.
+ * @param buffer Where to write.
+ * @return the number of chars written.
+ */
+SMALLTIME_API size_t nanotime_batch_format_iso8601(const nanotime* values, size_t count, size_t stride, char* buffer);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_format_H
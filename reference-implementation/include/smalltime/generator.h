@@ -0,0 +1,166 @@
+/*
+ * Smalltime Unique Timestamp Generator
+ * ====================================
+ *
+ * Hands out strictly increasing time values from any number of threads,
+ * for use as event IDs or sort keys.
+ *
+ * A generator is a single 64-bit word holding the last value handed out.
+ * Since encoded values compare the same as the times they represent, each
+ * request reads the clock (see clock.h) and atomically swaps in the larger
+ * of that reading and the last value plus one microsecond (nanosecond for
+ * nanotime). The increment carries into the seconds and beyond, so values
+ * handed out faster than the clock ticks stay valid times that run
+ * slightly ahead of the clock until it catches up.
+ *
+ * High-rate producers can reserve a run of consecutive values with one
+ * atomic operation, and then hand them out from a per-thread block
+ * without touching the shared word. Values from a block are unique and
+ * increase within the block, but another thread can be handed larger
+ * values before the block is used up.
+ *
+ * A zero-initialized generator is ready to use. Give each generator its
+ * own cache line if it's shared by busy threads.
+ *
+ * The generator functions live in the compiled smalltime library. The
+ * block functions are inline.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_generator_H
+#define KS_smalltime_generator_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/arith.h>
+
+
+typedef struct
+{
+    // The last value handed out (or reserved). Only access atomically.
+    smalltime last;
+} smalltime_generator;
+
+typedef struct
+{
+    // The last value handed out (or reserved). Only access atomically.
+    nanotime last;
+} nanotime_generator;
+
+// Values reserved by one thread from a generator. Zero-initialize before
+// first use.
+typedef struct
+{
+    smalltime next;
+    size_t remaining;
+} smalltime_generator_block;
+
+typedef struct
+{
+    nanotime next;
+    size_t remaining;
+} nanotime_generator_block;
+
+
+
+/**
+ * Get the next value from a generator.
+ *
+ * @param generator The generator.
+ * @return a value greater than every value the generator has handed out
+ *         so far, and no earlier than the current time.
+ */
+SMALLTIME_API smalltime smalltime_generator_next(smalltime_generator* generator);
+
+/**
+ * Get the next value from a generator.
+ *
+ * @param generator The generator.
+ * @return a value greater than every value the generator has handed out
+ *         so far, and no earlier than the current time.
+ */
+SMALLTIME_API nanotime nanotime_generator_next(nanotime_generator* generator);
+
+/**
+ * Reserve a run of consecutive values from a generator, one microsecond
+ * apart.
+ *
+ * @param generator The generator.
+ * @param count The number of values to reserve (at least 1).
+ * @return the first value in the run. The rest follow it at one
+ *         microsecond intervals.
+ */
+SMALLTIME_API smalltime smalltime_generator_reserve(smalltime_generator* generator, size_t count);
+
+/**
+ * Reserve a run of consecutive values from a generator, one nanosecond
+ * apart.
+ *
+ * @param generator The generator.
+ * @param count The number of values to reserve (at least 1).
+ * @return the first value in the run. The rest follow it at one
+ *         nanosecond intervals.
+ */
+SMALLTIME_API nanotime nanotime_generator_reserve(nanotime_generator* generator, size_t count);
+
+/**
+ * Get the next value from a per-thread block, reserving a new block from
+ * the generator when it runs out.
+ *
+ * @param generator The generator.
+ * @param block The calling thread's block.
+ * @param block_size The number of values to reserve at a time (at least 1).
+ * @return a unique value, greater than the previous one from this block.
+ */
+static inline smalltime smalltime_generator_block_next(smalltime_generator* generator,
+                                                       smalltime_generator_block* block,
+                                                       size_t block_size)
+{
+    if(block->remaining == 0)
+    {
+        block->next = smalltime_generator_reserve(generator, block_size);
+        block->remaining = block_size;
+    }
+    smalltime value = block->next;
+    block->next = smalltime_add_microseconds(value, 1);
+    block->remaining--;
+    return value;
+}
+
+/**
+ * Get the next value from a per-thread block, reserving a new block from
+ * the generator when it runs out.
+ *
+ * @param generator The generator.
+ * @param block The calling thread's block.
+ * @param block_size The number of values to reserve at a time (at least 1).
+ * @return a unique value, greater than the previous one from this block.
+ */
+static inline nanotime nanotime_generator_block_next(nanotime_generator* generator,
+                                                     nanotime_generator_block* block,
+                                                     size_t block_size)
+{
+    if(block->remaining == 0)
+    {
+        block->next = nanotime_generator_reserve(generator, block_size);
+        block->remaining = block_size;
+    }
+    nanotime value = block->next;
+    block->next = nanotime_add_nanoseconds(value, 1);
+    block->remaining--;
+    return value;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_generator_H
@@ -0,0 +1,144 @@
+/*
+ * Smalltime Search Index
+ * ======================
+ *
+ * Speeds up lower bound searches over large sorted arrays of smalltime or
+ * nanotime values.
+ *
+ * A binary search over a large array takes a cache miss at nearly every
+ * step. The index is a static B-tree (S+ tree) built over the array: each
+ * node is one cache line holding 8 keys, compared all at once with SIMD
+ * (see dispatch.h), with 9 children. The array itself is the bottom
+ * layer, so the index takes about an eighth of the array's size, and a
+ * search over 100 million values touches 9 cache lines instead of 27.
+ *
+ * Since packed values compare the same as the times they represent, the
+ * index works directly on the 64-bit words.
+ *
+ * Batched searches run several lookups in lockstep, so that their cache
+ * misses overlap.
+ *
+ * The array must stay sorted, unchanged and alive for as long as its index
+ * is used.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_index_H
+#define KS_smalltime_index_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+typedef struct smalltime_index smalltime_index;
+typedef struct nanotime_index nanotime_index;
+
+
+
+/**
+ * Build an index over a sorted array.
+ *
+ * @param values The values, in ascending order.
+ * @param count The number of values.
+ * @return the index, or NULL if out of memory.
+ */
+SMALLTIME_API smalltime_index* smalltime_index_new(const smalltime* values, size_t count);
+
+/**
+ * Build an index over a sorted array.
+ *
+ * @param values The values, in ascending order.
+ * @param count The number of values.
+ * @return the index, or NULL if out of memory.
+ */
+SMALLTIME_API nanotime_index* nanotime_index_new(const nanotime* values, size_t count);
+
+/**
+ * Free an index. The array it was built over is untouched.
+ *
+ * @param index The index.
+ */
+SMALLTIME_API void smalltime_index_free(smalltime_index* index);
+
+/**
+ * Free an index. The array it was built over is untouched.
+ *
+ * @param index The index.
+ */
+SMALLTIME_API void nanotime_index_free(nanotime_index* index);
+
+/**
+ * Find the first value that isn't less than a given value.
+ *
+ * @param index The index.
+ * @param value The value to search for.
+ * @return the position of the first value >= value, or the array's count
+ *         if there is none.
+ */
+SMALLTIME_API size_t smalltime_index_lower_bound(const smalltime_index* index, smalltime value);
+
+/**
+ * Find the first value that isn't less than a given value.
+ *
+ * @param index The index.
+ * @param value The value to search for.
+ * @return the position of the first value >= value, or the array's count
+ *         if there is none.
+ */
+SMALLTIME_API size_t nanotime_index_lower_bound(const nanotime_index* index, nanotime value);
+
+/**
+ * Find the run of values equal to a given value.
+ *
+ * @param index The index.
+ * @param value The value to search for.
+ * @param first Receives the position of the first value >= value.
+ * @param last Receives the position of the first value > value.
+ */
+SMALLTIME_API void smalltime_index_equal_range(const smalltime_index* index, smalltime value, size_t* first, size_t* last);
+
+/**
+ * Find the run of values equal to a given value.
+ *
+ * @param index The index.
+ * @param value The value to search for.
+ * @param first Receives the position of the first value >= value.
+ * @param last Receives the position of the first value > value.
+ */
+SMALLTIME_API void nanotime_index_equal_range(const nanotime_index* index, nanotime value, size_t* first, size_t* last);
+
+/**
+ * Find the lower bound of each of an array of values.
+ *
+ * @param index The index.
+ * @param values The values to search for, in any order.
+ * @param count The number of values to search for.
+ * @param results Receives the lower bound of each value.
+ */
+SMALLTIME_API void smalltime_index_batch_lower_bound(const smalltime_index* index, const smalltime* values, size_t count, size_t* results);
+
+/**
+ * Find the lower bound of each of an array of values.
+ *
+ * @param index The index.
+ * @param values The values to search for, in any order.
+ * @param count The number of values to search for.
+ * @param results Receives the lower bound of each value.
+ */
+SMALLTIME_API void nanotime_index_batch_lower_bound(const nanotime_index* index, const nanotime* values, size_t count, size_t* results);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_index_H
@@ -0,0 +1,130 @@
+/*
+ * Smalltime Joins
+ * ===============
+ *
+ * Joins two sorted columns of smalltime or nanotime values by time: for
+ * each value in the right column (such as an order), find the values in
+ * the left column (such as market data ticks) that go with it.
+ *
+ * An as-of join matches each right value with the latest left value at or
+ * before it. A window join matches each right value with every left value
+ * within a window around it, and gives the matches as a range of left
+ * positions (so the matched pairs are right value i with each left value
+ * from starts[i] up to ends[i]).
+ *
+ * Both joins walk the left column once, from the match of one right value
+ * to the next. The right column is taken in chunks. Where a chunk's right
+ * values are about as dense as the left values they span, the walk is a
+ * merge that compares each right value with the next four left values
+ * without branching, and moves ahead by the number that come before it.
+ * Where the left values are much denser, the walk gallops (it probes 1, 2,
+ * 4, 8... values ahead, then binary searches the last step), which only
+ * touches a logarithmic number of the skipped values.
+ *
+ * Large right columns can be split among several threads, each of which
+ * finds its own starting point in the left column.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_join_H
+#define KS_smalltime_join_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// The as-of match of a right value that comes before every left value.
+#define SMALLTIME_JOIN_NO_MATCH SIZE_MAX
+
+
+
+/**
+ * For each right value, find the latest left value at or before it.
+ *
+ * @param left The left column, sorted.
+ * @param left_count The number of left values.
+ * @param right The right column, sorted.
+ * @param right_count The number of right values.
+ * @param matches Receives, for each right value, the position of the last
+ *                left value at or before it, or SMALLTIME_JOIN_NO_MATCH.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ */
+SMALLTIME_API void smalltime_asof_join(const smalltime* left, size_t left_count,
+                                       const smalltime* right, size_t right_count,
+                                       size_t* matches, unsigned threads);
+
+/**
+ * For each right value, find the latest left value at or before it.
+ *
+ * @param left The left column, sorted.
+ * @param left_count The number of left values.
+ * @param right The right column, sorted.
+ * @param right_count The number of right values.
+ * @param matches Receives, for each right value, the position of the last
+ *                left value at or before it, or SMALLTIME_JOIN_NO_MATCH.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ */
+SMALLTIME_API void nanotime_asof_join(const nanotime* left, size_t left_count,
+                                      const nanotime* right, size_t right_count,
+                                      size_t* matches, unsigned threads);
+
+/**
+ * For each right value, find the left values from microseconds_before
+ * before it to microseconds_after after it (inclusive). Windows that reach
+ * past the range of smalltime are cut off there.
+ *
+ * @param left The left column, sorted.
+ * @param left_count The number of left values.
+ * @param right The right column, sorted.
+ * @param right_count The number of right values.
+ * @param microseconds_before How far the window reaches before each right value.
+ * @param microseconds_after How far the window reaches after each right value.
+ * @param starts Receives, for each right value, the position of the first
+ *               left value in its window.
+ * @param ends Receives, for each right value, the position after the last
+ *             left value in its window (equal to the start if there's none).
+ * @param threads The most threads to use, or 0 for one per CPU.
+ */
+SMALLTIME_API void smalltime_window_join(const smalltime* left, size_t left_count,
+                                         const smalltime* right, size_t right_count,
+                                         int64_t microseconds_before, int64_t microseconds_after,
+                                         size_t* starts, size_t* ends, unsigned threads);
+
+/**
+ * For each right value, find the left values from nanoseconds_before
+ * before it to nanoseconds_after after it (inclusive). Windows that reach
+ * past the range of nanotime are cut off there.
+ *
+ * @param left The left column, sorted.
+ * @param left_count The number of left values.
+ * @param right The right column, sorted.
+ * @param right_count The number of right values.
+ * @param nanoseconds_before How far the window reaches before each right value.
+ * @param nanoseconds_after How far the window reaches after each right value.
+ * @param starts Receives, for each right value, the position of the first
+ *               left value in its window.
+ * @param ends Receives, for each right value, the position after the last
+ *             left value in its window (equal to the start if there's none).
+ * @param threads The most threads to use, or 0 for one per CPU.
+ */
+SMALLTIME_API void nanotime_window_join(const nanotime* left, size_t left_count,
+                                        const nanotime* right, size_t right_count,
+                                        int64_t nanoseconds_before, int64_t nanoseconds_after,
+                                        size_t* starts, size_t* ends, unsigned threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_join_H
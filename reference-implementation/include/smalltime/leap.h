@@ -0,0 +1,252 @@
+/*
+ * Smalltime Leap Seconds
+ * ======================
+ *
+ * Exact conversion between UTC and TAI, and elapsed time that counts leap
+ * seconds, using a leap second table loaded from a file.
+ *
+ * Smalltime and nanotime values can hold a leap second (second 60), but the
+ * rest of the library follows POSIX time (see epoch.h), where every day is
+ * 86400 seconds long, so a difference across a leap second is off by one.
+ * The functions here add the change in TAI - UTC between the two values.
+ *
+ * Tables are read from the leap-seconds.list format published by the IERS
+ * and NIST, and shipped with tzdata (/usr/share/zoneinfo/leap-seconds.list).
+ * Each entry is the start of a UTC day and the TAI - UTC offset from then
+ * on. The hash line is not checked.
+ *
+ * The entries are kept as smalltime values, in UTC and in TAI, so finding
+ * the offset of a value is a branchless binary search over a few dozen
+ * plain 64-bit compares, with no calendar conversion.
+ *
+ * A table is never modified once loaded. The current table is published
+ * read-copy-update style. Readers bracket their use of it with
+ * smalltime_leap_read_lock() and smalltime_leap_read_unlock(), which are
+ * an atomic increment and decrement that never wait for a writer, and get
+ * it with smalltime_leap_current(). A writer swaps in a new table with
+ * smalltime_leap_replace(), which waits until no reader can still hold
+ * the old one (a grace period) and then frees it.
+ *
+ * Before the first entry (1972), the first entry's offset is used. UTC
+ * wasn't an integer number of seconds from TAI then, so results there are
+ * only as exact as that. A NULL table has no entries and an offset of 0.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_leap_H
+#define KS_smalltime_leap_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+typedef struct smalltime_leap_table smalltime_leap_table;
+
+
+
+/**
+ * Load a leap second table from a file in the leap-seconds.list format.
+ *
+ * @param path The file path.
+ * @return the table, or NULL if the file couldn't be read (see errno), or
+ *         isn't a valid leap second list (errno is EINVAL).
+ */
+SMALLTIME_API smalltime_leap_table* smalltime_leap_table_open(const char* path);
+
+/**
+ * Free a table loaded with smalltime_leap_table_open().
+ *
+ * @param table The table.
+ */
+SMALLTIME_API void smalltime_leap_table_close(smalltime_leap_table* table);
+
+/**
+ * Get the time after which a table may be missing leap seconds.
+ *
+ * @param table The table.
+ * @return the expiry time (UTC), or 0 if the file didn't give one.
+ */
+SMALLTIME_API smalltime smalltime_leap_table_expires(const smalltime_leap_table* table);
+
+/**
+ * Enter a read-side critical section, in which the current table won't be
+ * freed. Safe to call from any number of threads at once, can be nested,
+ * and never waits for a writer.
+ *
+ * @return the token to pass to smalltime_leap_read_unlock().
+ */
+SMALLTIME_API int smalltime_leap_read_lock(void);
+
+/**
+ * Leave a read-side critical section. Tables gotten inside it must not be
+ * used afterwards.
+ *
+ * @param token The token returned by the matching smalltime_leap_read_lock().
+ */
+SMALLTIME_API void smalltime_leap_read_unlock(int token);
+
+/**
+ * Get the current table. Safe to call from any number of threads at once,
+ * and never waits. The table stays valid until the enclosing
+ * smalltime_leap_read_unlock().
+ *
+ * @return the table most recently published, or NULL if none has been.
+ */
+SMALLTIME_API const smalltime_leap_table* smalltime_leap_current(void);
+
+/**
+ * Make a table the current one. Readers see either the old or the new
+ * table, never a mix of the two.
+ *
+ * @param table The new table, or NULL.
+ * @return the previous table, which must not be freed until after a
+ *         smalltime_leap_synchronize() call that starts after this one
+ *         returns.
+ */
+SMALLTIME_API smalltime_leap_table* smalltime_leap_publish(smalltime_leap_table* table);
+
+/**
+ * Wait for a grace period: until every read-side critical section that was
+ * entered before this call has been left.
+ */
+SMALLTIME_API void smalltime_leap_synchronize(void);
+
+/**
+ * Make a table the current one, wait for a grace period, then free the
+ * previous table.
+ *
+ * @param table The new table, or NULL.
+ */
+SMALLTIME_API void smalltime_leap_replace(smalltime_leap_table* table);
+
+/**
+ * Get TAI - UTC at a point in time.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (UTC).
+ * @return the offset in seconds.
+ */
+SMALLTIME_API int32_t smalltime_leap_offset(const smalltime_leap_table* table, smalltime time);
+
+/**
+ * Get TAI - UTC at a point in time.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (UTC).
+ * @return the offset in seconds.
+ */
+SMALLTIME_API int32_t nanotime_leap_offset(const smalltime_leap_table* table, nanotime time);
+
+/**
+ * Convert a UTC time value to TAI.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (UTC). Can be a leap second.
+ * @return the time (TAI).
+ */
+SMALLTIME_API smalltime smalltime_leap_to_tai(const smalltime_leap_table* table, smalltime time);
+
+/**
+ * Convert a UTC time value to TAI.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (UTC). Can be a leap second.
+ * @param result Where to store the time (TAI). Untouched on failure.
+ * @return nonzero on success, or 0 if the result is outside of the nanotime range.
+ */
+SMALLTIME_API int nanotime_leap_to_tai(const smalltime_leap_table* table, nanotime time, nanotime* result);
+
+/**
+ * Convert a TAI time value to UTC.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (TAI).
+ * @return the time (UTC), with second 60 during a leap second.
+ */
+SMALLTIME_API smalltime smalltime_leap_from_tai(const smalltime_leap_table* table, smalltime time);
+
+/**
+ * Convert a TAI time value to UTC.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param time The time (TAI).
+ * @param result Where to store the time (UTC), with second 60 during a leap
+ *               second. Untouched on failure.
+ * @return nonzero on success, or 0 if the result is outside of the nanotime range.
+ */
+SMALLTIME_API int nanotime_leap_from_tai(const smalltime_leap_table* table, nanotime time, nanotime* result);
+
+/**
+ * Get the elapsed time between two UTC time values, in microseconds,
+ * counting leap seconds.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param end The later time value.
+ * @param start The earlier time value.
+ * @return end - start, in microseconds (negative if end is before start).
+ */
+SMALLTIME_API int64_t smalltime_leap_diff_us(const smalltime_leap_table* table, smalltime end, smalltime start);
+
+/**
+ * Get the elapsed time between two UTC time values, in nanoseconds,
+ * counting leap seconds.
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param end The later time value.
+ * @param start The earlier time value.
+ * @return end - start, in nanoseconds (negative if end is before start).
+ */
+SMALLTIME_API int64_t nanotime_leap_diff_ns(const smalltime_leap_table* table, nanotime end, nanotime start);
+
+/**
+ * Get the elapsed times between pairs of UTC time values, in microseconds,
+ * counting leap seconds (see smalltime_leap_diff_us).
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param ends The later time values.
+ * @param starts The earlier time values.
+ * @param count The number of pairs.
+ * @param durations Where to store each end - start, in microseconds.
+ */
+SMALLTIME_API void smalltime_leap_batch_diff_us(const smalltime_leap_table* table, const smalltime* ends, const smalltime* starts,
+                                                size_t count, int64_t* durations);
+
+/**
+ * Get the elapsed times between pairs of UTC time values, in nanoseconds,
+ * counting leap seconds (see nanotime_leap_diff_ns).
+ * Note: Input is NOT validated!
+ *
+ * @param table The table.
+ * @param ends The later time values.
+ * @param starts The earlier time values.
+ * @param count The number of pairs.
+ * @param durations Where to store each end - start, in nanoseconds.
+ */
+SMALLTIME_API void nanotime_leap_batch_diff_ns(const smalltime_leap_table* table, const nanotime* ends, const nanotime* starts,
+                                               size_t count, int64_t* durations);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_leap_H
@@ -0,0 +1,246 @@
+/*
+ * Smalltime K-Way Merge
+ * =====================
+ *
+ * Merges any number of streams of smalltime or nanotime values, each
+ * already sorted, into a single sorted stream, along with the number of
+ * the stream that each value came from (so that the caller can fetch the
+ * record that goes with it).
+ *
+ * The merge is a loser tree: a tournament whose leaves are the streams,
+ * and whose internal nodes hold the loser of the match played there,
+ * along with a copy of its key. Taking a value replays only the matches
+ * on its stream's path to the root, which reads one node per level and
+ * never touches the other streams.
+ *
+ * When a stream wins twice in a row, the merge works out the key that it
+ * has to beat, and copies values from that stream without replaying any
+ * matches until it reaches one that's too large. Streams with runs of
+ * values (such as logs from hosts that write in bursts) merge at close to
+ * the speed of a copy.
+ *
+ * Streams are read through sources, which hand out their values a batch
+ * at a time. A source can be an array, a column file (see column.h), or a
+ * callback that returns the next batch from anywhere else. Batches are
+ * read in place, and the merged values are written in batches to a buffer
+ * supplied by the caller, which can be kept small enough to stay in cache.
+ *
+ * Equal values come out in the order that their streams were added, so
+ * the merge is stable.
+ *
+ * Sorted arrays can also be merged in one call, split among several
+ * threads. The output is split into ranges of values, and each thread
+ * finds its range in every array by binary search and merges it into its
+ * own part of the output.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_merge_H
+#define KS_smalltime_merge_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+#include <smalltime/column.h>
+
+
+// A merge output buffer length that fits comfortably in the L1 cache
+// (8 KiB of values and 4 KiB of stream numbers).
+#define SMALLTIME_MERGE_BATCH_LENGTH 1024
+
+typedef struct smalltime_merge smalltime_merge;
+typedef struct nanotime_merge nanotime_merge;
+
+/**
+ * Get the next batch of values from a stream. The values must stay valid
+ * until the next call.
+ *
+ * @param context The context that the source was added with.
+ * @param values Receives a pointer to the values.
+ * @return the number of values, or 0 if the stream has ended.
+ */
+typedef size_t (*smalltime_merge_source)(void* context, const smalltime** values);
+
+/**
+ * Get the next batch of values from a stream. The values must stay valid
+ * until the next call.
+ *
+ * @param context The context that the source was added with.
+ * @param values Receives a pointer to the values.
+ * @return the number of values, or 0 if the stream has ended.
+ */
+typedef size_t (*nanotime_merge_source)(void* context, const nanotime** values);
+
+
+
+/**
+ * Create a merge with no streams.
+ *
+ * @return the merge, or NULL if there wasn't enough memory.
+ */
+SMALLTIME_API smalltime_merge* smalltime_merge_new(void);
+
+/**
+ * Create a merge with no streams.
+ *
+ * @return the merge, or NULL if there wasn't enough memory.
+ */
+SMALLTIME_API nanotime_merge* nanotime_merge_new(void);
+
+/**
+ * Free a merge. Its sources are left alone.
+ *
+ * @param merge The merge.
+ */
+SMALLTIME_API void smalltime_merge_free(smalltime_merge* merge);
+
+/**
+ * Free a merge. Its sources are left alone.
+ *
+ * @param merge The merge.
+ */
+SMALLTIME_API void nanotime_merge_free(nanotime_merge* merge);
+
+/**
+ * Add a stream that is read through a callback. Streams are numbered from
+ * 0 in the order they're added, and must all be added before the first
+ * call to smalltime_merge_next().
+ *
+ * @param merge The merge.
+ * @param source The callback that gets each batch of the stream's values.
+ * @param context A value to pass to the callback.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int smalltime_merge_add_source(smalltime_merge* merge, smalltime_merge_source source, void* context);
+
+/**
+ * Add a stream that is read through a callback. Streams are numbered from
+ * 0 in the order they're added, and must all be added before the first
+ * call to nanotime_merge_next().
+ *
+ * @param merge The merge.
+ * @param source The callback that gets each batch of the stream's values.
+ * @param context A value to pass to the callback.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int nanotime_merge_add_source(nanotime_merge* merge, nanotime_merge_source source, void* context);
+
+/**
+ * Add a stream that is read from an array. The array must stay valid
+ * until the merge is freed.
+ *
+ * @param merge The merge.
+ * @param values The sorted values.
+ * @param count The number of values.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int smalltime_merge_add_array(smalltime_merge* merge, const smalltime* values, size_t count);
+
+/**
+ * Add a stream that is read from an array. The array must stay valid
+ * until the merge is freed.
+ *
+ * @param merge The merge.
+ * @param values The sorted values.
+ * @param count The number of values.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int nanotime_merge_add_array(nanotime_merge* merge, const nanotime* values, size_t count);
+
+/**
+ * Add a stream that is read from a column file. The column must stay open
+ * until the merge is freed.
+ *
+ * @param merge The merge.
+ * @param column The column, whose values must be sorted.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int smalltime_merge_add_column(smalltime_merge* merge, const smalltime_column* column);
+
+/**
+ * Add a stream that is read from a column file. The column must stay open
+ * until the merge is freed.
+ *
+ * @param merge The merge.
+ * @param column The column, whose values must be sorted.
+ * @return nonzero on success, or 0 if there wasn't enough memory or the
+ *         merge has already started.
+ */
+SMALLTIME_API int nanotime_merge_add_column(nanotime_merge* merge, const nanotime_column* column);
+
+/**
+ * Get the next batch of merged values.
+ *
+ * @param merge The merge.
+ * @param values Receives the values.
+ * @param streams Receives the number of the stream that each value came
+ *                from, or NULL if they aren't needed.
+ * @param capacity The most values to get (see SMALLTIME_MERGE_BATCH_LENGTH).
+ * @return the number of values received, which is less than capacity only
+ *         once every stream has ended.
+ */
+SMALLTIME_API size_t smalltime_merge_next(smalltime_merge* merge, smalltime* values, uint32_t* streams, size_t capacity);
+
+/**
+ * Get the next batch of merged values.
+ *
+ * @param merge The merge.
+ * @param values Receives the values.
+ * @param streams Receives the number of the stream that each value came
+ *                from, or NULL if they aren't needed.
+ * @param capacity The most values to get (see SMALLTIME_MERGE_BATCH_LENGTH).
+ * @return the number of values received, which is less than capacity only
+ *         once every stream has ended.
+ */
+SMALLTIME_API size_t nanotime_merge_next(nanotime_merge* merge, nanotime* values, uint32_t* streams, size_t capacity);
+
+/**
+ * Merge sorted arrays in one call.
+ *
+ * @param arrays The sorted arrays.
+ * @param counts The number of values in each array.
+ * @param array_count The number of arrays.
+ * @param values Receives the merged values (as many as all the arrays hold).
+ * @param streams Receives the index of the array that each value came
+ *                from, or NULL if they aren't needed.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ * @return nonzero on success, or 0 if there wasn't enough memory.
+ */
+SMALLTIME_API int smalltime_merge_arrays(const smalltime* const* arrays, const size_t* counts, size_t array_count,
+                                         smalltime* values, uint32_t* streams, unsigned threads);
+
+/**
+ * Merge sorted arrays in one call.
+ *
+ * @param arrays The sorted arrays.
+ * @param counts The number of values in each array.
+ * @param array_count The number of arrays.
+ * @param values Receives the merged values (as many as all the arrays hold).
+ * @param streams Receives the index of the array that each value came
+ *                from, or NULL if they aren't needed.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ * @return nonzero on success, or 0 if there wasn't enough memory.
+ */
+SMALLTIME_API int nanotime_merge_arrays(const nanotime* const* arrays, const size_t* counts, size_t array_count,
+                                        nanotime* values, uint32_t* streams, unsigned threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_merge_H
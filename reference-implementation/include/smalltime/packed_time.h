@@ -0,0 +1,486 @@
+/*
+ * Smalltime Packed Time Template
+ * ==============================
+ *
+ * A C++17 class template for packed date & time values, with the bit
+ * layout as a compile-time descriptor. smalltime and nanotime are two
+ * instantiations of it, and other layouts can be defined the same way,
+ * such as the 32-bit second-resolution second32_layout below for compact
+ * columns.
+ *
+ * A layout lists the width of each field, from the year at the top down to
+ * the fraction of a second at the bottom, exactly as in the specifications,
+ * along with the storage type and the year stored as 0. The shifts and
+ * masks are worked out from the widths at compile time. If the storage
+ * type is signed, so is the year field.
+ *
+ * Construction and every accessor are constexpr, and compile to the same
+ * instructions as the C functions in smalltime.h and nanotime.h.
+ *
+ * The batch functions are specialized by layout: for smalltime and
+ * nanotime they go to the SIMD kernels of the compiled smalltime library,
+ * and for any other layout they run as one loop per column over
+ * compile-time shifts and masks, which compilers vectorize.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_packed_time_H
+#define KS_smalltime_packed_time_H
+
+#if defined(__cplusplus) && __cplusplus >= 201703L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+#include <smalltime/batch.h>
+#include <smalltime/calendar.h>
+
+namespace smalltime_cpp
+{
+
+// The smalltime specification's bit table.
+struct smalltime_layout
+{
+    using storage = int64_t;
+    static constexpr int year_bits = 18;
+    static constexpr int month_bits = 4;
+    static constexpr int day_bits = 5;
+    static constexpr int hour_bits = 5;
+    static constexpr int minute_bits = 6;
+    static constexpr int second_bits = 6;
+    static constexpr int fraction_bits = 20;
+    static constexpr int zero_year = 0;
+    static constexpr int fractions_per_second = 1000000;
+};
+
+// The nanotime specification's bit table.
+struct nanotime_layout
+{
+    using storage = uint64_t;
+    static constexpr int year_bits = 8;
+    static constexpr int month_bits = 4;
+    static constexpr int day_bits = 5;
+    static constexpr int hour_bits = 5;
+    static constexpr int minute_bits = 6;
+    static constexpr int second_bits = 6;
+    static constexpr int fraction_bits = 30;
+    static constexpr int zero_year = 1970;
+    static constexpr int fractions_per_second = 1000000000;
+};
+
+// Whole seconds from 1970 to 2033 in 32 bits, for compact columns.
+struct second32_layout
+{
+    using storage = uint32_t;
+    static constexpr int year_bits = 6;
+    static constexpr int month_bits = 4;
+    static constexpr int day_bits = 5;
+    static constexpr int hour_bits = 5;
+    static constexpr int minute_bits = 6;
+    static constexpr int second_bits = 6;
+    static constexpr int fraction_bits = 0;
+    static constexpr int zero_year = 1970;
+    static constexpr int fractions_per_second = 1;
+};
+
+/**
+ * Field columns for a batch of packed time values of any layout.
+ * Each pointer must reference an array of at least as many elements as
+ * there are values in the batch. When decoding, NULL columns are skipped.
+ */
+struct packed_columns
+{
+    int* year;
+    int* month;
+    int* day;
+    int* hour;
+    int* minute;
+    int* second;
+    int* fraction;
+};
+
+template<typename LAYOUT>
+class basic_packed_time
+{
+public:
+    using layout = LAYOUT;
+    using storage = typename LAYOUT::storage;
+
+    static_assert(std::is_integral<storage>::value && sizeof(storage) >= sizeof(int),
+                  "Layout storage must be an integer type at least as wide as int");
+    static_assert(LAYOUT::year_bits + LAYOUT::month_bits + LAYOUT::day_bits + LAYOUT::hour_bits +
+                  LAYOUT::minute_bits + LAYOUT::second_bits + LAYOUT::fraction_bits == (int)sizeof(storage) * 8,
+                  "Layout fields must fill the storage exactly");
+
+    static constexpr int fraction_shift = 0;
+    static constexpr int second_shift = fraction_shift + LAYOUT::fraction_bits;
+    static constexpr int minute_shift = second_shift + LAYOUT::second_bits;
+    static constexpr int hour_shift = minute_shift + LAYOUT::minute_bits;
+    static constexpr int day_shift = hour_shift + LAYOUT::hour_bits;
+    static constexpr int month_shift = day_shift + LAYOUT::day_bits;
+    static constexpr int year_shift = month_shift + LAYOUT::month_bits;
+
+    static constexpr int min_year = LAYOUT::zero_year - (std::is_signed<storage>::value ? 1 << (LAYOUT::year_bits - 1) : 0);
+    static constexpr int max_year = min_year + (1 << LAYOUT::year_bits) - 1;
+
+private:
+    using unsigned_storage = typename std::make_unsigned<storage>::type;
+
+    static constexpr storage mask(int bits, int shift)
+    {
+        return (storage)((((unsigned_storage)1 << bits) - 1) << shift);
+    }
+
+    // Field values are shifted as unsigned, so that negative years are
+    // well defined in constant expressions.
+    static constexpr storage place(int value, int shift)
+    {
+        return (storage)((unsigned_storage)(storage)value << shift);
+    }
+
+    static constexpr storage place_fraction(int fraction)
+    {
+        if constexpr(LAYOUT::fraction_bits == 0)
+        {
+            (void)fraction;
+            return 0;
+        }
+        else
+        {
+            return (storage)fraction;
+        }
+    }
+
+public:
+    static constexpr storage year_mask = mask(LAYOUT::year_bits, year_shift);
+    static constexpr storage month_mask = mask(LAYOUT::month_bits, month_shift);
+    static constexpr storage day_mask = mask(LAYOUT::day_bits, day_shift);
+    static constexpr storage hour_mask = mask(LAYOUT::hour_bits, hour_shift);
+    static constexpr storage minute_mask = mask(LAYOUT::minute_bits, minute_shift);
+    static constexpr storage second_mask = mask(LAYOUT::second_bits, second_shift);
+    static constexpr storage fraction_mask = mask(LAYOUT::fraction_bits, fraction_shift);
+
+    constexpr basic_packed_time() = default;
+
+    /**
+     * Create a new time value.
+     * Note: This does NOT validate input!
+     *
+     * @param year The year (min_year - max_year). Note: 1 = 1 AD, 0 = 1 BC, -1 = 2 BC, ...
+     * @param month The month of the year (1 - 12).
+     * @param day The day of the month (1 - 31).
+     * @param hour The hour of the day (0 - 23).
+     * @param minute The minute of the hour (0 - 59).
+     * @param second The second of the minute, allowing for leap second (0 - 60).
+     * @param fraction The fraction of the second (0 - fractions_per_second - 1).
+     */
+    constexpr basic_packed_time(int year, int month, int day, int hour = 0, int minute = 0, int second = 0, int fraction = 0)
+    : bits_(place(year - LAYOUT::zero_year, year_shift) |
+            place(month, month_shift) |
+            place(day, day_shift) |
+            place(hour, hour_shift) |
+            place(minute, minute_shift) |
+            place(second, second_shift) |
+            place_fraction(fraction))
+    {
+    }
+
+    /**
+     * Wrap an encoded value.
+     *
+     * @param bits The encoded value.
+     * @return the time value.
+     */
+    static constexpr basic_packed_time from_bits(storage bits)
+    {
+        basic_packed_time time;
+        time.bits_ = bits;
+        return time;
+    }
+
+    /**
+     * @return the encoded value.
+     */
+    constexpr storage bits() const
+    {
+        return bits_;
+    }
+
+    constexpr int year() const
+    {
+        return (int)(bits_ >> year_shift) + LAYOUT::zero_year;
+    }
+
+    constexpr int month() const
+    {
+        return (int)((bits_ & month_mask) >> month_shift);
+    }
+
+    constexpr int day() const
+    {
+        return (int)((bits_ & day_mask) >> day_shift);
+    }
+
+    constexpr int hour() const
+    {
+        return (int)((bits_ & hour_mask) >> hour_shift);
+    }
+
+    constexpr int minute() const
+    {
+        return (int)((bits_ & minute_mask) >> minute_shift);
+    }
+
+    constexpr int second() const
+    {
+        return (int)((bits_ & second_mask) >> second_shift);
+    }
+
+    constexpr int fraction() const
+    {
+        return (int)(bits_ & fraction_mask);
+    }
+
+    // The with_*() functions return a copy with one field replaced.
+    // Note: Input is NOT validated!
+
+    constexpr basic_packed_time with_year(int year) const
+    {
+        return from_bits((bits_ & ~year_mask) | place(year - LAYOUT::zero_year, year_shift));
+    }
+
+    constexpr basic_packed_time with_month(int month) const
+    {
+        return from_bits((bits_ & ~month_mask) | place(month, month_shift));
+    }
+
+    constexpr basic_packed_time with_day(int day) const
+    {
+        return from_bits((bits_ & ~day_mask) | place(day, day_shift));
+    }
+
+    constexpr basic_packed_time with_hour(int hour) const
+    {
+        return from_bits((bits_ & ~hour_mask) | place(hour, hour_shift));
+    }
+
+    constexpr basic_packed_time with_minute(int minute) const
+    {
+        return from_bits((bits_ & ~minute_mask) | place(minute, minute_shift));
+    }
+
+    constexpr basic_packed_time with_second(int second) const
+    {
+        return from_bits((bits_ & ~second_mask) | place(second, second_shift));
+    }
+
+    constexpr basic_packed_time with_fraction(int fraction) const
+    {
+        return from_bits((bits_ & ~fraction_mask) | place_fraction(fraction));
+    }
+
+    // Encoded values compare in time order.
+    friend constexpr bool operator==(basic_packed_time a, basic_packed_time b) { return a.bits_ == b.bits_; }
+    friend constexpr bool operator!=(basic_packed_time a, basic_packed_time b) { return a.bits_ != b.bits_; }
+    friend constexpr bool operator<(basic_packed_time a, basic_packed_time b) { return a.bits_ < b.bits_; }
+    friend constexpr bool operator<=(basic_packed_time a, basic_packed_time b) { return a.bits_ <= b.bits_; }
+    friend constexpr bool operator>(basic_packed_time a, basic_packed_time b) { return a.bits_ > b.bits_; }
+    friend constexpr bool operator>=(basic_packed_time a, basic_packed_time b) { return a.bits_ >= b.bits_; }
+
+private:
+    storage bits_ = 0;
+};
+
+using packed_smalltime = basic_packed_time<smalltime_layout>;
+using packed_nanotime = basic_packed_time<nanotime_layout>;
+using packed_second32 = basic_packed_time<second32_layout>;
+
+// Arrays of packed values are passed straight to the C batch functions.
+static_assert(sizeof(packed_smalltime) == sizeof(smalltime) && std::is_trivially_copyable<packed_smalltime>::value,
+              "packed_smalltime must have the same representation as smalltime");
+static_assert(sizeof(packed_nanotime) == sizeof(nanotime) && std::is_trivially_copyable<packed_nanotime>::value,
+              "packed_nanotime must have the same representation as nanotime");
+
+namespace packed_detail
+{
+
+// Columns are done in blocks of 8 values copied to the stack first. An int
+// column may alias a layout's unsigned storage, and without the copy
+// compilers won't vectorize the loop unless they add alias checks (which
+// they don't at -O2).
+static const size_t block_size = 8;
+
+template<typename LAYOUT, typename GET>
+inline void decode_column(const basic_packed_time<LAYOUT>* values, size_t count, int* column, GET get)
+{
+    if(column == nullptr)
+    {
+        return;
+    }
+    size_t i = 0;
+    for(; i + block_size <= count; i += block_size)
+    {
+        basic_packed_time<LAYOUT> block[block_size];
+        for(size_t j = 0; j < block_size; j++)
+        {
+            block[j] = values[i + j];
+        }
+        for(size_t j = 0; j < block_size; j++)
+        {
+            column[i + j] = get(block[j]);
+        }
+    }
+    for(; i < count; i++)
+    {
+        column[i] = get(values[i]);
+    }
+}
+
+template<typename LAYOUT>
+inline basic_packed_time<LAYOUT> encode_row(const packed_columns& columns, size_t i)
+{
+    return basic_packed_time<LAYOUT>(columns.year[i], columns.month[i], columns.day[i],
+                                     columns.hour[i], columns.minute[i], columns.second[i],
+                                     LAYOUT::fraction_bits == 0 ? 0 : columns.fraction[i]);
+}
+
+template<typename COLUMNS>
+inline COLUMNS to_c_columns(const packed_columns& columns)
+{
+    return {columns.year, columns.month, columns.day, columns.hour, columns.minute, columns.second, columns.fraction};
+}
+
+} // namespace packed_detail
+
+/**
+ * Split an array of time values into field columns.
+ * Equivalent to calling the accessors on every value.
+ *
+ * @param values The time values to decode.
+ * @param count The number of values.
+ * @param columns Where to store the decoded fields.
+ */
+template<typename LAYOUT>
+inline void batch_decode(const basic_packed_time<LAYOUT>* values, size_t count, const packed_columns& columns)
+{
+    if constexpr(std::is_same<LAYOUT, smalltime_layout>::value)
+    {
+        smalltime_columns c_columns = packed_detail::to_c_columns<smalltime_columns>(columns);
+        smalltime_batch_decode(reinterpret_cast<const smalltime*>(values), count, &c_columns);
+    }
+    else if constexpr(std::is_same<LAYOUT, nanotime_layout>::value)
+    {
+        nanotime_columns c_columns = packed_detail::to_c_columns<nanotime_columns>(columns);
+        nanotime_batch_decode(reinterpret_cast<const nanotime*>(values), count, &c_columns);
+    }
+    else
+    {
+        using time = basic_packed_time<LAYOUT>;
+        packed_detail::decode_column(values, count, columns.year, [](time t) { return t.year(); });
+        packed_detail::decode_column(values, count, columns.month, [](time t) { return t.month(); });
+        packed_detail::decode_column(values, count, columns.day, [](time t) { return t.day(); });
+        packed_detail::decode_column(values, count, columns.hour, [](time t) { return t.hour(); });
+        packed_detail::decode_column(values, count, columns.minute, [](time t) { return t.minute(); });
+        packed_detail::decode_column(values, count, columns.second, [](time t) { return t.second(); });
+        packed_detail::decode_column(values, count, columns.fraction, [](time t) { return t.fraction(); });
+    }
+}
+
+/**
+ * Pack field columns into an array of time values.
+ * Equivalent to constructing a value from every row. The fraction column
+ * may be NULL for layouts without one.
+ * Note: Input is NOT validated!
+ *
+ * @param columns The fields to encode.
+ * @param count The number of rows.
+ * @param values Where to store the encoded time values.
+ */
+template<typename LAYOUT>
+inline void batch_encode(const packed_columns& columns, size_t count, basic_packed_time<LAYOUT>* values)
+{
+    if constexpr(std::is_same<LAYOUT, smalltime_layout>::value)
+    {
+        smalltime_columns c_columns = packed_detail::to_c_columns<smalltime_columns>(columns);
+        smalltime_batch_encode(&c_columns, count, reinterpret_cast<smalltime*>(values));
+    }
+    else if constexpr(std::is_same<LAYOUT, nanotime_layout>::value)
+    {
+        nanotime_columns c_columns = packed_detail::to_c_columns<nanotime_columns>(columns);
+        nanotime_batch_encode(&c_columns, count, reinterpret_cast<nanotime*>(values));
+    }
+    else
+    {
+        const size_t block_size = packed_detail::block_size;
+        basic_packed_time<LAYOUT> block[block_size];
+        size_t i = 0;
+        for(; i + block_size <= count; i += block_size)
+        {
+            for(size_t j = 0; j < block_size; j++)
+            {
+                block[j] = packed_detail::encode_row<LAYOUT>(columns, i + j);
+            }
+            for(size_t j = 0; j < block_size; j++)
+            {
+                values[i + j] = block[j];
+            }
+        }
+        const size_t remaining = count - i;
+        for(size_t j = 0; j < remaining; j++)
+        {
+            block[j] = packed_detail::encode_row<LAYOUT>(columns, i + j);
+        }
+        for(size_t j = 0; j < remaining; j++)
+        {
+            values[i + j] = block[j];
+        }
+    }
+}
+
+/**
+ * Get the calendar fields of an array of time values (see calendar.h).
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param columns The columns to store the fields in.
+ */
+template<typename LAYOUT>
+inline void batch_calendar(const basic_packed_time<LAYOUT>* values, size_t count, const smalltime_calendar_columns& columns)
+{
+    if constexpr(std::is_same<LAYOUT, smalltime_layout>::value)
+    {
+        smalltime_batch_calendar(reinterpret_cast<const smalltime*>(values), count, &columns);
+    }
+    else if constexpr(std::is_same<LAYOUT, nanotime_layout>::value)
+    {
+        nanotime_batch_calendar(reinterpret_cast<const nanotime*>(values), count, &columns);
+    }
+    else
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            int year = values[i].year();
+            int day_of_year = smalltime_calendar_day_of_year(year, values[i].month(), values[i].day());
+            int weekday = smalltime_calendar_weekday(year, day_of_year);
+            int week_year;
+            int week = smalltime_calendar_iso_week(year, day_of_year, weekday, &week_year);
+            if(columns.weekday != nullptr) columns.weekday[i] = weekday;
+            if(columns.day_of_year != nullptr) columns.day_of_year[i] = day_of_year;
+            if(columns.iso_week != nullptr) columns.iso_week[i] = week;
+            if(columns.iso_week_year != nullptr) columns.iso_week_year[i] = week_year;
+        }
+    }
+}
+
+} // namespace smalltime_cpp
+
+#endif // __cplusplus >= 201703L
+
+#endif // KS_smalltime_packed_time_H
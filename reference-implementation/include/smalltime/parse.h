@@ -0,0 +1,130 @@
+/*
+ * Smalltime ISO-8601 Parsing
+ * ==========================
+ *
+ * Reads ISO-8601 / RFC 3339 timestamps into smalltime and nanotime values,
+ * without allocating or requiring null terminated input:
+ *
+ *     YYYY-MM-DDTHH:MM:SS[.fraction](Z|+hh:mm|-hh:mm)
+ *
+ * The date and time separator may be 'T', 't' or a space, and the fraction
+ * separator may be '.' or ','. The fraction may have any number of digits,
+ * and is truncated or rounded to the precision of the time type. A second
+ * field of 60 (leap second) is accepted. Timestamps with an offset are
+ * normalized to UTC.
+ *
+ * Smalltime also accepts the expanded year representation that the
+ * formatter writes for years outside of 0000 - 9999: a sign followed by
+ * 6 digits (for example -000001-01-01T00:00:00Z is January 1st, 2 BC).
+ *
+ * Unlike the rest of the API, input IS validated: the digits, separators,
+ * field ranges and days in the month are all checked, and the result must
+ * fit in the time type.
+ *
+ * Parsing lives in the compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_parse_H
+#define KS_smalltime_parse_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+/**
+ * How to fit a fraction with more digits than the time type holds.
+ */
+typedef enum
+{
+    // Drop the extra digits.
+    SMALLTIME_PARSE_TRUNCATE = 0,
+    // Round to the nearest microsecond/nanosecond, with halves rounded up.
+    SMALLTIME_PARSE_ROUND    = 1,
+} smalltime_parse_rounding;
+
+
+
+/**
+ * Parse an ISO-8601 timestamp at the start of some text.
+ *
+ * @param text The text, which doesn't need to be null terminated.
+ * @param length The length of the text.
+ * @param rounding How to handle fractions finer than a microsecond.
+ * @param value Where to store the time value. Untouched on failure.
+ * @return the length of the timestamp, or 0 if the text doesn't start with a valid timestamp.
+ */
+SMALLTIME_API size_t smalltime_parse_iso8601(const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value);
+
+/**
+ * Parse an ISO-8601 timestamp at the start of some text.
+ *
+ * @param text The text, which doesn't need to be null terminated.
+ * @param length The length of the text.
+ * @param rounding How to handle fractions finer than a nanosecond.
+ * @param value Where to store the time value. Untouched on failure.
+ * @return the length of the timestamp, or 0 if the text doesn't start with a valid timestamp.
+ */
+SMALLTIME_API size_t nanotime_parse_iso8601(const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value);
+
+/**
+ * Parse a block of ISO-8601 timestamps, each followed by a delimiter (the
+ * delimiter after the last one is optional).
+ *
+ * Parsing stops at the first error, or when the values array is full.
+ * end_offset receives the offset in the text where parsing stopped:
+ *   - length, if the whole text was parsed.
+ *   - The start of the next timestamp, if the values array filled up.
+ *   - Otherwise the offset of the first invalid character. For a field that
+ *     is out of range, this is the start of the field.
+ *
+ * @param text The text, which doesn't need to be null terminated.
+ * @param length The length of the text.
+ * @param delimiter The char that follows each timestamp (for example '\n' or ',').
+ * @param rounding How to handle fractions finer than a microsecond.
+ * @param values Where to store the time values.
+ * @param capacity The number of entries in values.
+ * @param end_offset Where to store the offset that parsing stopped at. Can be NULL.
+ * @return the number of values parsed.
+ */
+SMALLTIME_API size_t smalltime_batch_parse_iso8601(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                                   smalltime* values, size_t capacity, size_t* end_offset);
+
+/**
+ * Parse a block of ISO-8601 timestamps, each followed by a delimiter (the
+ * delimiter after the last one is optional).
+ *
+ * Parsing stops at the first error, or when the values array is full.
+ * end_offset receives the offset in the text where parsing stopped:
+ *   - length, if the whole text was parsed.
+ *   - The start of the next timestamp, if the values array filled up.
+ *   - Otherwise the offset of the first invalid character. For a field that
+ *     is out of range, this is the start of the field.
+ *
+ * @param text The text, which doesn't need to be null terminated.
+ * @param length The length of the text.
+ * @param delimiter The char that follows each timestamp (for example '\n' or ',').
+ * @param rounding How to handle fractions finer than a nanosecond.
+ * @param values Where to store the time values.
+ * @param capacity The number of entries in values.
+ * @param end_offset Where to store the offset that parsing stopped at. Can be NULL.
+ * @return the number of values parsed.
+ */
+SMALLTIME_API size_t nanotime_batch_parse_iso8601(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                                  nanotime* values, size_t capacity, size_t* end_offset);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_parse_H
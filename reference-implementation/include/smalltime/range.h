@@ -0,0 +1,478 @@
+/*
+ * Smalltime Ranges
+ * ================
+ *
+ * Lazy ranges of smalltime and nanotime values at a fixed calendar step,
+ * such as every 15 minutes from one time to another, or the first day of
+ * every month.
+ *
+ * A range steps by adding to the packed field of its unit, and only when
+ * that field overflows does it carry into the field above (and on up, one
+ * field at a time), so no step goes through an epoch conversion unless it
+ * crosses into another month. Month and year steps keep to the first
+ * value's day, ending on the last day of shorter months: a monthly range
+ * starting on Jan 31 gives Feb 28, Mar 31, Apr 30 and so on. Carries
+ * follow POSIX time (see arith.h).
+ *
+ * Values come out one at a time from smalltime_range_next(), or many at a
+ * time from smalltime_range_fill(). Filling writes the values between
+ * carries as a single arithmetic sequence with SIMD, and once a whole day
+ * has been written with a step that divides the day evenly, writes the
+ * following days by copying it with just the date changed.
+ *
+ * In C++20, smalltime_cpp::smalltime_range_view and nanotime_range_view
+ * wrap these as forward ranges.
+ *
+ * The stepping functions are inline. The fill functions live in the
+ * compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_range_H
+#define KS_smalltime_range_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/arith.h>
+#include <smalltime/rollup.h>
+
+
+// Internal defines. These will be undef'd at the end of the header.
+#define SMALLTIME_RANGE_ST_SHIFT_DAY    37
+#define SMALLTIME_RANGE_ST_SHIFT_HOUR   32
+#define SMALLTIME_RANGE_ST_SHIFT_MINUTE 26
+#define SMALLTIME_RANGE_ST_SHIFT_SECOND 20
+#define SMALLTIME_RANGE_ST_TIME_OF_DAY  ((1ULL << SMALLTIME_RANGE_ST_SHIFT_DAY) - 1)
+
+#define SMALLTIME_RANGE_NT_SHIFT_DAY    47
+#define SMALLTIME_RANGE_NT_SHIFT_HOUR   42
+#define SMALLTIME_RANGE_NT_SHIFT_MINUTE 36
+#define SMALLTIME_RANGE_NT_SHIFT_SECOND 30
+#define SMALLTIME_RANGE_NT_TIME_OF_DAY  ((1ULL << SMALLTIME_RANGE_NT_SHIFT_DAY) - 1)
+
+// Values from next up to (but not including) end, step units apart.
+// Set up with smalltime_range_init().
+typedef struct
+{
+    smalltime next;  // The next value the range will produce.
+    smalltime end;
+    int64_t step;
+    smalltime_unit unit;
+    int day;  // The first value's day, which month and year steps keep to.
+} smalltime_range;
+
+typedef struct
+{
+    nanotime next;  // The next value the range will produce.
+    nanotime end;
+    int64_t step;
+    smalltime_unit unit;
+    int day;  // The first value's day, which month and year steps keep to.
+} nanotime_range;
+
+// Adds an amount to the time of day field at level (0 = fraction, then
+// second, minute, hour), carrying one field at a time. shifts holds the
+// shifts of the fraction, second, minute, hour and day fields, and
+// fraction_radix the number of fractions in a second. Returns the value
+// with its date unchanged, and the number of days carried out in *days.
+static inline uint64_t smalltime_range_carry(uint64_t bits, int level, uint64_t amount,
+                                             const int* shifts, uint64_t fraction_radix, uint64_t* days)
+{
+    for(; level < 4; level++)
+    {
+        int shift = shifts[level];
+        uint64_t mask = (1ULL << (shifts[level + 1] - shift)) - 1;
+        uint64_t radix = level == 0 ? fraction_radix : level == 3 ? 24 : 60;
+        uint64_t field = ((bits >> shift) & mask) + amount;
+        bits &= ~(mask << shift);
+        if(field < radix)
+        {
+            *days = 0;
+            return bits | (field << shift);
+        }
+        bits |= (field % radix) << shift;
+        amount = field / radix;
+    }
+    *days = amount;
+    return bits;
+}
+
+// The time of day level and amount for a sub-day unit, with millisecond
+// and microsecond steps counted in fractions.
+static inline int smalltime_range_level(smalltime_unit unit, int64_t step, uint64_t fraction_radix, uint64_t* amount)
+{
+    *amount = (uint64_t)step;
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_HOUR:
+            return 3;
+        case SMALLTIME_UNIT_MINUTE:
+            return 2;
+        case SMALLTIME_UNIT_SECOND:
+            return 1;
+        case SMALLTIME_UNIT_MILLISECOND:
+            *amount *= fraction_radix / 1000;
+            return 0;
+        default:
+            *amount *= fraction_radix / 1000000;
+            return 0;
+    }
+}
+
+// Steps forward by months, ending on the last day of the month when it's
+// shorter than day.
+static inline smalltime smalltime_range_step_months(smalltime time, int64_t months, int day)
+{
+    int64_t month = smalltime_get_month(time) - 1 + months;
+    int year = smalltime_get_year(time) + (int)(month / 12);
+    month = month % 12 + 1;
+    int month_days = day > 28 ? smalltime_days_in_month(year, (int)month) : 28;
+    return smalltime_new(year, (int)month, day < month_days ? day : month_days, 0, 0, 0, 0)
+         | (smalltime)((uint64_t)time & SMALLTIME_RANGE_ST_TIME_OF_DAY);
+}
+
+static inline nanotime nanotime_range_step_months(nanotime time, int64_t months, int day)
+{
+    int64_t month = nanotime_get_month(time) - 1 + months;
+    int year = nanotime_get_year(time) + (int)(month / 12);
+    month = month % 12 + 1;
+    int month_days = day > 28 ? smalltime_days_in_month(year, (int)month) : 28;
+    return nanotime_new(year, (int)month, day < month_days ? day : month_days, 0, 0, 0, 0)
+         | (time & SMALLTIME_RANGE_NT_TIME_OF_DAY);
+}
+
+// Steps forward by days, carrying into the month and year one month at a
+// time (steps of more than a month go through the calendar).
+static inline smalltime smalltime_range_step_days(smalltime time, int64_t days)
+{
+    int64_t day = smalltime_get_day(time) + days;
+    if(day <= 28)
+    {
+        return (smalltime)((uint64_t)time + ((uint64_t)days << SMALLTIME_RANGE_ST_SHIFT_DAY));
+    }
+    if(days > 31)
+    {
+        return smalltime_add_days(time, days);
+    }
+    int year = smalltime_get_year(time);
+    int month = smalltime_get_month(time);
+    for(int month_days = smalltime_days_in_month(year, month); day > month_days; month_days = smalltime_days_in_month(year, month))
+    {
+        day -= month_days;
+        if(++month > 12)
+        {
+            month = 1;
+            year++;
+        }
+    }
+    return smalltime_new(year, month, (int)day, 0, 0, 0, 0) | (smalltime)((uint64_t)time & SMALLTIME_RANGE_ST_TIME_OF_DAY);
+}
+
+static inline nanotime nanotime_range_step_days(nanotime time, int64_t days)
+{
+    int64_t day = nanotime_get_day(time) + days;
+    if(day <= 28)
+    {
+        return time + ((uint64_t)days << SMALLTIME_RANGE_NT_SHIFT_DAY);
+    }
+    if(days > 31)
+    {
+        return nanotime_add_days(time, days);
+    }
+    int year = nanotime_get_year(time);
+    int month = nanotime_get_month(time);
+    for(int month_days = smalltime_days_in_month(year, month); day > month_days; month_days = smalltime_days_in_month(year, month))
+    {
+        day -= month_days;
+        if(++month > 12)
+        {
+            month = 1;
+            year++;
+        }
+    }
+    return nanotime_new(year, month, (int)day, 0, 0, 0, 0) | (time & SMALLTIME_RANGE_NT_TIME_OF_DAY);
+}
+
+
+
+/**
+ * Step a time value forward by a number of units, as a range does.
+ * Note: Input is NOT validated! The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @param unit The unit to step in.
+ * @param step The number of units to step (at least 1).
+ * @param day The day that month and year steps keep to, where the month has it.
+ * @return the next time value.
+ */
+static inline smalltime smalltime_range_step(smalltime time, smalltime_unit unit, int64_t step, int day)
+{
+    static const int shifts[] = {0, SMALLTIME_RANGE_ST_SHIFT_SECOND, SMALLTIME_RANGE_ST_SHIFT_MINUTE,
+                                 SMALLTIME_RANGE_ST_SHIFT_HOUR, SMALLTIME_RANGE_ST_SHIFT_DAY};
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return smalltime_range_step_months(time, step * 12, day);
+        case SMALLTIME_UNIT_MONTH:
+            return smalltime_range_step_months(time, step, day);
+        case SMALLTIME_UNIT_DAY:
+            return smalltime_range_step_days(time, step);
+        default:
+        {
+            uint64_t amount;
+            uint64_t days;
+            int level = smalltime_range_level(unit, step, 1000000, &amount);
+            smalltime bits = (smalltime)smalltime_range_carry((uint64_t)time, level, amount, shifts, 1000000, &days);
+            return days == 0 ? bits : smalltime_range_step_days(bits, (int64_t)days);
+        }
+    }
+}
+
+/**
+ * Step a time value forward by a number of units, as a range does.
+ * Note: Input is NOT validated! The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @param unit The unit to step in.
+ * @param step The number of units to step (at least 1).
+ * @param day The day that month and year steps keep to, where the month has it.
+ * @return the next time value.
+ */
+static inline nanotime nanotime_range_step(nanotime time, smalltime_unit unit, int64_t step, int day)
+{
+    static const int shifts[] = {0, SMALLTIME_RANGE_NT_SHIFT_SECOND, SMALLTIME_RANGE_NT_SHIFT_MINUTE,
+                                 SMALLTIME_RANGE_NT_SHIFT_HOUR, SMALLTIME_RANGE_NT_SHIFT_DAY};
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return nanotime_range_step_months(time, step * 12, day);
+        case SMALLTIME_UNIT_MONTH:
+            return nanotime_range_step_months(time, step, day);
+        case SMALLTIME_UNIT_DAY:
+            return nanotime_range_step_days(time, step);
+        default:
+        {
+            uint64_t amount;
+            uint64_t days;
+            int level = smalltime_range_level(unit, step, 1000000000, &amount);
+            nanotime bits = smalltime_range_carry(time, level, amount, shifts, 1000000000, &days);
+            return days == 0 ? bits : nanotime_range_step_days(bits, (int64_t)days);
+        }
+    }
+}
+
+/**
+ * Set up a range of time values from start up to (but not including) end,
+ * step units apart.
+ * Note: Input is NOT validated! start must be a valid time.
+ *
+ * @param range The range to set up.
+ * @param start The first value.
+ * @param end The value to stop before.
+ * @param unit The unit to step in.
+ * @param step The number of units between values (at least 1).
+ */
+static inline void smalltime_range_init(smalltime_range* range, smalltime start, smalltime end, smalltime_unit unit, int64_t step)
+{
+    range->next = start;
+    range->end = end;
+    range->step = step;
+    range->unit = unit;
+    range->day = smalltime_get_day(start);
+}
+
+/**
+ * Set up a range of time values from start up to (but not including) end,
+ * step units apart.
+ * Note: Input is NOT validated! start must be a valid time.
+ *
+ * @param range The range to set up.
+ * @param start The first value.
+ * @param end The value to stop before.
+ * @param unit The unit to step in.
+ * @param step The number of units between values (at least 1).
+ */
+static inline void nanotime_range_init(nanotime_range* range, nanotime start, nanotime end, smalltime_unit unit, int64_t step)
+{
+    range->next = start;
+    range->end = end;
+    range->step = step;
+    range->unit = unit;
+    range->day = nanotime_get_day(start);
+}
+
+/**
+ * Get the next value of a range.
+ *
+ * @param range The range.
+ * @param value Receives the next value.
+ * @return Nonzero if there was a value, or 0 if the range is used up.
+ */
+static inline int smalltime_range_next(smalltime_range* range, smalltime* value)
+{
+    if(range->next >= range->end)
+    {
+        return 0;
+    }
+    *value = range->next;
+    range->next = smalltime_range_step(range->next, range->unit, range->step, range->day);
+    return 1;
+}
+
+/**
+ * Get the next value of a range.
+ *
+ * @param range The range.
+ * @param value Receives the next value.
+ * @return Nonzero if there was a value, or 0 if the range is used up.
+ */
+static inline int nanotime_range_next(nanotime_range* range, nanotime* value)
+{
+    if(range->next >= range->end)
+    {
+        return 0;
+    }
+    *value = range->next;
+    range->next = nanotime_range_step(range->next, range->unit, range->step, range->day);
+    return 1;
+}
+
+/**
+ * Write the next values of a range to an array.
+ *
+ * @param range The range.
+ * @param values Receives the values.
+ * @param capacity The most values to write.
+ * @return The number of values written. Fewer than capacity means the
+ *         range is used up.
+ */
+SMALLTIME_API size_t smalltime_range_fill(smalltime_range* range, smalltime* values, size_t capacity);
+
+/**
+ * Write the next values of a range to an array.
+ *
+ * @param range The range.
+ * @param values Receives the values.
+ * @param capacity The most values to write.
+ * @return The number of values written. Fewer than capacity means the
+ *         range is used up.
+ */
+SMALLTIME_API size_t nanotime_range_fill(nanotime_range* range, nanotime* values, size_t capacity);
+
+
+#undef SMALLTIME_RANGE_ST_SHIFT_DAY
+#undef SMALLTIME_RANGE_ST_SHIFT_HOUR
+#undef SMALLTIME_RANGE_ST_SHIFT_MINUTE
+#undef SMALLTIME_RANGE_ST_SHIFT_SECOND
+#undef SMALLTIME_RANGE_ST_TIME_OF_DAY
+#undef SMALLTIME_RANGE_NT_SHIFT_DAY
+#undef SMALLTIME_RANGE_NT_SHIFT_HOUR
+#undef SMALLTIME_RANGE_NT_SHIFT_MINUTE
+#undef SMALLTIME_RANGE_NT_SHIFT_SECOND
+#undef SMALLTIME_RANGE_NT_TIME_OF_DAY
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#if defined(__cplusplus) && __cplusplus >= 202002L
+
+#include <iterator>
+#include <ranges>
+
+namespace smalltime_cpp
+{
+
+// A C range as a C++20 forward range. Iterators each hold their own copy
+// of the range, so they can be copied and stepped independently.
+template<typename RANGE, typename TIME, void (*INIT)(RANGE*, TIME, TIME, smalltime_unit, int64_t), int (*NEXT)(RANGE*, TIME*)>
+class basic_range_view: public std::ranges::view_interface<basic_range_view<RANGE, TIME, INIT, NEXT>>
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = TIME;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        iterator() = default;
+
+        explicit iterator(const RANGE& range): range_(range)
+        {
+            ++*this;
+        }
+
+        TIME operator*() const
+        {
+            return value_;
+        }
+
+        iterator& operator++()
+        {
+            done_ = !NEXT(&range_, &value_);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b)
+        {
+            return a.done_ == b.done_ && (a.done_ || a.value_ == b.value_);
+        }
+
+        friend bool operator==(const iterator& a, std::default_sentinel_t)
+        {
+            return a.done_;
+        }
+
+    private:
+        RANGE range_ {};
+        TIME value_ {};
+        bool done_ = true;
+    };
+
+    basic_range_view() = default;
+
+    basic_range_view(TIME start, TIME end, smalltime_unit unit, int64_t step)
+    {
+        INIT(&range_, start, end, unit, step);
+    }
+
+    iterator begin() const
+    {
+        return iterator(range_);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+private:
+    RANGE range_ {};
+};
+
+using smalltime_range_view = basic_range_view<smalltime_range, smalltime, smalltime_range_init, smalltime_range_next>;
+using nanotime_range_view = basic_range_view<nanotime_range, nanotime, nanotime_range_init, nanotime_range_next>;
+
+} // namespace smalltime_cpp
+
+#endif // __cplusplus >= 202002L
+
+#endif // KS_smalltime_range_H
@@ -0,0 +1,387 @@
+/*
+ * Smalltime Rollups
+ * =================
+ *
+ * Truncation of smalltime and nanotime values to a unit (the start of
+ * their year, month, day, hour and so on), and group-by aggregation of a
+ * column of values by the time bucket each one falls in.
+ *
+ * Since the fields are packed in order, truncating is a matter of masking
+ * off the fields below the unit (and setting month and day, which count
+ * from 1, to their first value). Buckets several units wide, such as 15
+ * minutes or 6 hours, round the unit's field down to a multiple of the
+ * width, so no conversion to an epoch time is needed. Buckets start over
+ * at each larger unit: 15 minute buckets start at minutes 0, 15, 30 and 45
+ * of every hour, and 10 day buckets at days 1, 11, 21 and 31 of every
+ * month. Widths that don't divide the larger unit evenly leave a short
+ * bucket at its end. A leap second (second 60) falls in the minute's last
+ * bucket, or in a bucket of its own when buckets are one second wide.
+ *
+ * A rollup keeps a count, sum, minimum and maximum of the values given
+ * with the times in each bucket. Times that share a bucket tend to come
+ * in runs (always so when they're sorted), and these are found with SIMD
+ * compares against the first time's bucket, several times at a time. The
+ * values of a run are then added up in eight lanes, without looking up the
+ * bucket again. The sums don't depend on the instruction set the library
+ * picks, since every variant adds in the same order.
+ *
+ * The truncation functions are inline. The rollups live in the compiled
+ * smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_rollup_H
+#define KS_smalltime_rollup_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+// Internal defines. These will be undef'd at the end of the header.
+#define SMALLTIME_ROLLUP_ST_SHIFT_YEAR   46
+#define SMALLTIME_ROLLUP_ST_SHIFT_MONTH  42
+#define SMALLTIME_ROLLUP_ST_SHIFT_DAY    37
+#define SMALLTIME_ROLLUP_ST_SHIFT_HOUR   32
+#define SMALLTIME_ROLLUP_ST_SHIFT_MINUTE 26
+#define SMALLTIME_ROLLUP_ST_SHIFT_SECOND 20
+#define SMALLTIME_ROLLUP_ST_MASK_MICROSECOND 0xfffffULL
+
+#define SMALLTIME_ROLLUP_NT_SHIFT_YEAR   56
+#define SMALLTIME_ROLLUP_NT_SHIFT_MONTH  52
+#define SMALLTIME_ROLLUP_NT_SHIFT_DAY    47
+#define SMALLTIME_ROLLUP_NT_SHIFT_HOUR   42
+#define SMALLTIME_ROLLUP_NT_SHIFT_MINUTE 36
+#define SMALLTIME_ROLLUP_NT_SHIFT_SECOND 30
+#define SMALLTIME_ROLLUP_NT_MASK_NANOSECOND 0x3fffffffULL
+
+// Clears every bit below a shift.
+#define SMALLTIME_ROLLUP_KEEP_FROM(SHIFT) (~((1ULL << (SHIFT)) - 1))
+
+// Units of time to truncate to.
+typedef enum
+{
+    SMALLTIME_UNIT_YEAR = 0,
+    SMALLTIME_UNIT_MONTH,
+    SMALLTIME_UNIT_DAY,
+    SMALLTIME_UNIT_HOUR,
+    SMALLTIME_UNIT_MINUTE,
+    SMALLTIME_UNIT_SECOND,
+    SMALLTIME_UNIT_MILLISECOND,
+    SMALLTIME_UNIT_MICROSECOND,
+} smalltime_unit;
+
+// The totals of the values in one time bucket.
+typedef struct
+{
+    smalltime bucket;  // The start of the bucket.
+    size_t count;
+    double sum;
+    double min;
+    double max;
+} smalltime_group;
+
+typedef struct
+{
+    nanotime bucket;  // The start of the bucket.
+    size_t count;
+    double sum;
+    double min;
+    double max;
+} nanotime_group;
+
+typedef struct smalltime_rollup smalltime_rollup;
+typedef struct nanotime_rollup nanotime_rollup;
+
+
+
+/**
+ * Truncate a time value to the start of its year, month, day, hour,
+ * minute, second, millisecond or microsecond.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @param unit The unit to truncate to.
+ * @return The truncated time value.
+ */
+static inline smalltime smalltime_truncate_to(smalltime time, smalltime_unit unit)
+{
+    uint64_t bits = (uint64_t)time;
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            bits = (bits & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_YEAR))
+                 | (1ULL << SMALLTIME_ROLLUP_ST_SHIFT_MONTH) | (1ULL << SMALLTIME_ROLLUP_ST_SHIFT_DAY);
+            break;
+        case SMALLTIME_UNIT_MONTH:
+            bits = (bits & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_MONTH)) | (1ULL << SMALLTIME_ROLLUP_ST_SHIFT_DAY);
+            break;
+        case SMALLTIME_UNIT_DAY:
+            bits &= SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_DAY);
+            break;
+        case SMALLTIME_UNIT_HOUR:
+            bits &= SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_HOUR);
+            break;
+        case SMALLTIME_UNIT_MINUTE:
+            bits &= SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_MINUTE);
+            break;
+        case SMALLTIME_UNIT_SECOND:
+            bits &= SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_ST_SHIFT_SECOND);
+            break;
+        case SMALLTIME_UNIT_MILLISECOND:
+            bits -= (bits & SMALLTIME_ROLLUP_ST_MASK_MICROSECOND) % 1000;
+            break;
+        default:
+            break;
+    }
+    return (smalltime)bits;
+}
+
+/**
+ * Truncate a time value to the start of its year, month, day, hour,
+ * minute, second, millisecond or microsecond.
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @param unit The unit to truncate to.
+ * @return The truncated time value.
+ */
+static inline nanotime nanotime_truncate_to(nanotime time, smalltime_unit unit)
+{
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return (time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_YEAR))
+                 | (1ULL << SMALLTIME_ROLLUP_NT_SHIFT_MONTH) | (1ULL << SMALLTIME_ROLLUP_NT_SHIFT_DAY);
+        case SMALLTIME_UNIT_MONTH:
+            return (time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_MONTH)) | (1ULL << SMALLTIME_ROLLUP_NT_SHIFT_DAY);
+        case SMALLTIME_UNIT_DAY:
+            return time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_DAY);
+        case SMALLTIME_UNIT_HOUR:
+            return time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_HOUR);
+        case SMALLTIME_UNIT_MINUTE:
+            return time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_MINUTE);
+        case SMALLTIME_UNIT_SECOND:
+            return time & SMALLTIME_ROLLUP_KEEP_FROM(SMALLTIME_ROLLUP_NT_SHIFT_SECOND);
+        case SMALLTIME_UNIT_MILLISECOND:
+            return time - (time & SMALLTIME_ROLLUP_NT_MASK_NANOSECOND) % 1000000;
+        case SMALLTIME_UNIT_MICROSECOND:
+            return time - (time & SMALLTIME_ROLLUP_NT_MASK_NANOSECOND) % 1000;
+        default:
+            return time;
+    }
+}
+
+// How far a field is past the start of its bucket, for buckets width
+// units wide that count from first (flooring for negative fields).
+static inline uint64_t smalltime_rollup_bucket_offset(int64_t field, int64_t first, int width)
+{
+    int64_t offset = (field - first) % width;
+    return (uint64_t)(offset < 0 ? offset + width : offset);
+}
+
+// The same for a second field, where a leap second (second 60) belongs to
+// the minute's last bucket.
+static inline uint64_t smalltime_rollup_second_offset(int second, int width)
+{
+    int last = second > 59 ? 59 : second;
+    return smalltime_rollup_bucket_offset(last, 0, width) + (uint64_t)(second - last);
+}
+
+/**
+ * Truncate a time value to the start of its bucket, for buckets that are
+ * width units long (see the start of this file).
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @param unit The unit that the buckets are measured in.
+ * @param width The number of units in a bucket (1 is the same as smalltime_truncate_to).
+ * @return The start of the bucket that the time value is in.
+ */
+static inline smalltime smalltime_truncate_to_multiple(smalltime time, smalltime_unit unit, int width)
+{
+    uint64_t bits = (uint64_t)smalltime_truncate_to(time, unit);
+    if(width <= 1)
+    {
+        return (smalltime)bits;
+    }
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return (smalltime)(bits - (smalltime_rollup_bucket_offset(smalltime_get_year(time), 0, width) << SMALLTIME_ROLLUP_ST_SHIFT_YEAR));
+        case SMALLTIME_UNIT_MONTH:
+            return (smalltime)(bits - (smalltime_rollup_bucket_offset(smalltime_get_month(time), 1, width) << SMALLTIME_ROLLUP_ST_SHIFT_MONTH));
+        case SMALLTIME_UNIT_DAY:
+            return (smalltime)(bits - (smalltime_rollup_bucket_offset(smalltime_get_day(time), 1, width) << SMALLTIME_ROLLUP_ST_SHIFT_DAY));
+        case SMALLTIME_UNIT_HOUR:
+            return (smalltime)(bits - (smalltime_rollup_bucket_offset(smalltime_get_hour(time), 0, width) << SMALLTIME_ROLLUP_ST_SHIFT_HOUR));
+        case SMALLTIME_UNIT_MINUTE:
+            return (smalltime)(bits - (smalltime_rollup_bucket_offset(smalltime_get_minute(time), 0, width) << SMALLTIME_ROLLUP_ST_SHIFT_MINUTE));
+        case SMALLTIME_UNIT_SECOND:
+            return (smalltime)(bits - (smalltime_rollup_second_offset(smalltime_get_second(time), width) << SMALLTIME_ROLLUP_ST_SHIFT_SECOND));
+        case SMALLTIME_UNIT_MILLISECOND:
+            return (smalltime)(bits - (bits & SMALLTIME_ROLLUP_ST_MASK_MICROSECOND) % (1000ULL * (unsigned)width));
+        default:
+            return (smalltime)(bits - (bits & SMALLTIME_ROLLUP_ST_MASK_MICROSECOND) % (unsigned)width);
+    }
+}
+
+/**
+ * Truncate a time value to the start of its bucket, for buckets that are
+ * width units long (see the start of this file).
+ * Note: Input is NOT validated!
+ *
+ * @param time The time value.
+ * @param unit The unit that the buckets are measured in.
+ * @param width The number of units in a bucket (1 is the same as nanotime_truncate_to).
+ * @return The start of the bucket that the time value is in.
+ */
+static inline nanotime nanotime_truncate_to_multiple(nanotime time, smalltime_unit unit, int width)
+{
+    nanotime bits = nanotime_truncate_to(time, unit);
+    if(width <= 1)
+    {
+        return bits;
+    }
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return bits - (smalltime_rollup_bucket_offset(nanotime_get_year(time), 0, width) << SMALLTIME_ROLLUP_NT_SHIFT_YEAR);
+        case SMALLTIME_UNIT_MONTH:
+            return bits - (smalltime_rollup_bucket_offset(nanotime_get_month(time), 1, width) << SMALLTIME_ROLLUP_NT_SHIFT_MONTH);
+        case SMALLTIME_UNIT_DAY:
+            return bits - (smalltime_rollup_bucket_offset(nanotime_get_day(time), 1, width) << SMALLTIME_ROLLUP_NT_SHIFT_DAY);
+        case SMALLTIME_UNIT_HOUR:
+            return bits - (smalltime_rollup_bucket_offset(nanotime_get_hour(time), 0, width) << SMALLTIME_ROLLUP_NT_SHIFT_HOUR);
+        case SMALLTIME_UNIT_MINUTE:
+            return bits - (smalltime_rollup_bucket_offset(nanotime_get_minute(time), 0, width) << SMALLTIME_ROLLUP_NT_SHIFT_MINUTE);
+        case SMALLTIME_UNIT_SECOND:
+            return bits - (smalltime_rollup_second_offset(nanotime_get_second(time), width) << SMALLTIME_ROLLUP_NT_SHIFT_SECOND);
+        case SMALLTIME_UNIT_MILLISECOND:
+            return bits - (bits & SMALLTIME_ROLLUP_NT_MASK_NANOSECOND) % (1000000ULL * (unsigned)width);
+        default:
+            return bits - (bits & SMALLTIME_ROLLUP_NT_MASK_NANOSECOND) % (1000ULL * (unsigned)width);
+    }
+}
+
+
+/**
+ * Create a rollup, which totals values by the time bucket they belong to.
+ *
+ * @param unit The unit that the buckets are measured in.
+ * @param width The number of units in a bucket.
+ * @return The rollup, or NULL if out of memory. Free with smalltime_rollup_free().
+ */
+SMALLTIME_API smalltime_rollup* smalltime_rollup_new(smalltime_unit unit, int width);
+
+/**
+ * Create a rollup, which totals values by the time bucket they belong to.
+ *
+ * @param unit The unit that the buckets are measured in.
+ * @param width The number of units in a bucket.
+ * @return The rollup, or NULL if out of memory. Free with nanotime_rollup_free().
+ */
+SMALLTIME_API nanotime_rollup* nanotime_rollup_new(smalltime_unit unit, int width);
+
+/**
+ * Free a rollup.
+ *
+ * @param rollup The rollup (can be NULL).
+ */
+SMALLTIME_API void smalltime_rollup_free(smalltime_rollup* rollup);
+
+/**
+ * Free a rollup.
+ *
+ * @param rollup The rollup (can be NULL).
+ */
+SMALLTIME_API void nanotime_rollup_free(nanotime_rollup* rollup);
+
+/**
+ * Add a column of values to a rollup, each one going to the bucket of the
+ * time beside it. The times can be in any order, though the more of them
+ * that come in runs from the same bucket, the faster this is.
+ * NaN values are left out of the minimum and maximum, but not the sum.
+ * Note: Input is NOT validated!
+ *
+ * @param rollup The rollup.
+ * @param times The times of the values.
+ * @param values The values.
+ * @param count The number of times and values.
+ * @return Nonzero on success, or 0 if out of memory (leaving some of the
+ *         values added).
+ */
+SMALLTIME_API int smalltime_rollup_add(smalltime_rollup* rollup, const smalltime* times, const double* values, size_t count);
+
+/**
+ * Add a column of values to a rollup, each one going to the bucket of the
+ * time beside it. The times can be in any order, though the more of them
+ * that come in runs from the same bucket, the faster this is.
+ * NaN values are left out of the minimum and maximum, but not the sum.
+ * Note: Input is NOT validated!
+ *
+ * @param rollup The rollup.
+ * @param times The times of the values.
+ * @param values The values.
+ * @param count The number of times and values.
+ * @return Nonzero on success, or 0 if out of memory (leaving some of the
+ *         values added).
+ */
+SMALLTIME_API int nanotime_rollup_add(nanotime_rollup* rollup, const nanotime* times, const double* values, size_t count);
+
+/**
+ * Get the totals of each bucket that has had values added, in order of
+ * time.
+ *
+ * @param rollup The rollup.
+ * @param groups Receives the totals of the first capacity buckets (can be
+ *               NULL if capacity is 0).
+ * @param capacity The most totals to get.
+ * @return The number of buckets, which may be more than capacity.
+ */
+SMALLTIME_API size_t smalltime_rollup_groups(smalltime_rollup* rollup, smalltime_group* groups, size_t capacity);
+
+/**
+ * Get the totals of each bucket that has had values added, in order of
+ * time.
+ *
+ * @param rollup The rollup.
+ * @param groups Receives the totals of the first capacity buckets (can be
+ *               NULL if capacity is 0).
+ * @param capacity The most totals to get.
+ * @return The number of buckets, which may be more than capacity.
+ */
+SMALLTIME_API size_t nanotime_rollup_groups(nanotime_rollup* rollup, nanotime_group* groups, size_t capacity);
+
+
+#undef SMALLTIME_ROLLUP_ST_SHIFT_YEAR
+#undef SMALLTIME_ROLLUP_ST_SHIFT_MONTH
+#undef SMALLTIME_ROLLUP_ST_SHIFT_DAY
+#undef SMALLTIME_ROLLUP_ST_SHIFT_HOUR
+#undef SMALLTIME_ROLLUP_ST_SHIFT_MINUTE
+#undef SMALLTIME_ROLLUP_ST_SHIFT_SECOND
+#undef SMALLTIME_ROLLUP_ST_MASK_MICROSECOND
+#undef SMALLTIME_ROLLUP_NT_SHIFT_YEAR
+#undef SMALLTIME_ROLLUP_NT_SHIFT_MONTH
+#undef SMALLTIME_ROLLUP_NT_SHIFT_DAY
+#undef SMALLTIME_ROLLUP_NT_SHIFT_HOUR
+#undef SMALLTIME_ROLLUP_NT_SHIFT_MINUTE
+#undef SMALLTIME_ROLLUP_NT_SHIFT_SECOND
+#undef SMALLTIME_ROLLUP_NT_MASK_NANOSECOND
+#undef SMALLTIME_ROLLUP_KEEP_FROM
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_rollup_H
@@ -0,0 +1,73 @@
+/*
+ * Smalltime Radix Sort
+ * ====================
+ *
+ * Sorts arrays of smalltime or nanotime values (optionally along with an
+ * array of indices, such as the positions of the records they came from)
+ * far faster than a comparison sort.
+ *
+ * The sort is a least significant digit radix sort on the packed 64-bit
+ * values, one byte per digit. Since packed values compare the same as the
+ * times they represent, sorting them as integers sorts them by time
+ * (smalltime's sign bit is flipped, so that negative years come first).
+ *
+ * A quick read of the array finds the digits that hold the same value
+ * throughout, which are skipped, and a second read counts the rest. In a
+ * batch of events spanning an hour, the year, month and day bytes never
+ * vary, so only five of the eight passes are made (four if the batch
+ * doesn't cross the top of an hour).
+ *
+ * The sort is stable, so equal values keep the order of their indices.
+ *
+ * Large arrays can be split among several threads, which count and
+ * scatter their own slices of the array in each pass.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_sort_H
+#define KS_smalltime_sort_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+
+/**
+ * Sort time values in ascending order.
+ *
+ * @param values The values to sort.
+ * @param indices An array to reorder along with values, or NULL.
+ * @param count The number of values.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ * @return nonzero on success, or 0 if there wasn't enough memory, in which
+ *         case the arrays are left unchanged.
+ */
+SMALLTIME_API int smalltime_sort(smalltime* values, size_t* indices, size_t count, unsigned threads);
+
+/**
+ * Sort time values in ascending order.
+ *
+ * @param values The values to sort.
+ * @param indices An array to reorder along with values, or NULL.
+ * @param count The number of values.
+ * @param threads The most threads to use, or 0 for one per CPU.
+ * @return nonzero on success, or 0 if there wasn't enough memory, in which
+ *         case the arrays are left unchanged.
+ */
+SMALLTIME_API int nanotime_sort(nanotime* values, size_t* indices, size_t count, unsigned threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_sort_H
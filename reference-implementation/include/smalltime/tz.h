@@ -0,0 +1,289 @@
+/*
+ * Smalltime Time Zones
+ * ====================
+ *
+ * Conversion of UTC time values to and from local (wall clock) time, using
+ * zone files in the TZif format (RFC 8536), as found in /usr/share/zoneinfo.
+ *
+ * A zone is loaded into an immutable table of periods, each with a UTC
+ * offset. The start of every period is stored as a smalltime value, both
+ * in UTC and in local time, and since smalltime values order the same as
+ * the times they represent, finding the period of a value is a branchless
+ * binary search over plain 64-bit compares, with no calendar conversion.
+ * Moving a value by its offset only touches the time of day fields, and
+ * the date fields when it crosses midnight.
+ *
+ * Times after the last transition in the file follow the rule in its
+ * footer (a POSIX TZ string). The rule is expanded into the table over one
+ * 400-year cycle, which is as long as the calendar takes to repeat, and
+ * values in later years are moved back by whole cycles before the search.
+ *
+ * Local times that occur twice (when the clocks go back) or not at all
+ * (when they go forward) are resolved by smalltime_tz_ambiguous and
+ * smalltime_tz_gap policies.
+ *
+ * Column conversions remember the last period they used, and only search
+ * when a value falls outside of it.
+ *
+ * Zones are never modified once loaded, so any number of threads can use
+ * them at once. A cache loads zones from a directory on first use, and
+ * publishes them with a single compare-and-swap, so lookups never wait on
+ * a lock, even while another thread is loading.
+ *
+ * Leap seconds (second 60) keep their second field. Zone files with leap
+ * second records (the "right/" zones) are refused.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_tz_H
+#define KS_smalltime_tz_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+typedef struct smalltime_tz smalltime_tz;
+typedef struct smalltime_tz_cache smalltime_tz_cache;
+
+// How to resolve a local time that occurs twice, when the clocks go back.
+typedef enum
+{
+    // The first occurrence, in the offset from before the transition.
+    SMALLTIME_TZ_AMBIGUOUS_EARLIER = 0,
+    // The second occurrence, in the offset from after the transition.
+    SMALLTIME_TZ_AMBIGUOUS_LATER   = 1,
+    // Fail.
+    SMALLTIME_TZ_AMBIGUOUS_REJECT  = 2,
+} smalltime_tz_ambiguous;
+
+// How to resolve a local time that never occurs, when the clocks go forward.
+typedef enum
+{
+    // Move forward by the length of the gap (reading the time in the
+    // offset from before the transition), so 02:30 becomes 03:30.
+    SMALLTIME_TZ_GAP_SHIFT_FORWARD = 0,
+    // The transition itself, the first time after the gap.
+    SMALLTIME_TZ_GAP_NEXT_VALID    = 1,
+    // Fail.
+    SMALLTIME_TZ_GAP_REJECT        = 2,
+} smalltime_tz_gap;
+
+
+
+/**
+ * Load a zone from a TZif file.
+ *
+ * @param path The file path.
+ * @return the zone, or NULL if the file couldn't be read (see errno), or
+ *         isn't a valid TZif file (errno is EINVAL).
+ */
+SMALLTIME_API smalltime_tz* smalltime_tz_open(const char* path);
+
+/**
+ * Free a zone loaded with smalltime_tz_open().
+ *
+ * @param zone The zone.
+ */
+SMALLTIME_API void smalltime_tz_close(smalltime_tz* zone);
+
+/**
+ * Create a cache of the zones in a directory. No files are read until a
+ * zone is asked for.
+ *
+ * @param directory The zone directory (such as "/usr/share/zoneinfo").
+ * @return the cache, or NULL if out of memory.
+ */
+SMALLTIME_API smalltime_tz_cache* smalltime_tz_cache_open(const char* directory);
+
+/**
+ * Get a zone from a cache, loading it on first use.
+ * Safe to call from any number of threads at once.
+ *
+ * @param cache The cache.
+ * @param name The zone name (such as "America/New_York"), a path relative to
+ *             the cache directory. Names that leave the directory are refused.
+ * @return the zone, valid until the cache is closed, or NULL if it couldn't
+ *         be loaded (see errno).
+ */
+SMALLTIME_API const smalltime_tz* smalltime_tz_cache_get(smalltime_tz_cache* cache, const char* name);
+
+/**
+ * Free a cache and every zone that it loaded. No other thread may be
+ * using the cache or its zones.
+ *
+ * @param cache The cache.
+ */
+SMALLTIME_API void smalltime_tz_cache_close(smalltime_tz_cache* cache);
+
+/**
+ * Get the UTC offset of a zone at a point in time.
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @return the offset in seconds, positive east of UTC.
+ */
+SMALLTIME_API int32_t smalltime_tz_offset(const smalltime_tz* zone, smalltime time);
+
+/**
+ * Get the UTC offset of a zone at a point in time.
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @return the offset in seconds, positive east of UTC.
+ */
+SMALLTIME_API int32_t nanotime_tz_offset(const smalltime_tz* zone, nanotime time);
+
+/**
+ * Get the abbreviation of a zone's local time at a point in time.
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @return the abbreviation (such as "EST"), valid for the lifetime of the zone.
+ */
+SMALLTIME_API const char* smalltime_tz_abbreviation(const smalltime_tz* zone, smalltime time);
+
+/**
+ * Get the abbreviation of a zone's local time at a point in time.
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @return the abbreviation (such as "EST"), valid for the lifetime of the zone.
+ */
+SMALLTIME_API const char* nanotime_tz_abbreviation(const smalltime_tz* zone, nanotime time);
+
+/**
+ * Convert a UTC time value to local time.
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @return the local time.
+ */
+SMALLTIME_API smalltime smalltime_tz_to_local(const smalltime_tz* zone, smalltime time);
+
+/**
+ * Convert a UTC time value to local time.
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param time The time (UTC).
+ * @param result Where to store the local time. Untouched on failure.
+ * @return nonzero on success, or 0 if the local time is outside of the
+ *         nanotime range.
+ */
+SMALLTIME_API int nanotime_tz_to_local(const smalltime_tz* zone, nanotime time, nanotime* result);
+
+/**
+ * Convert a local time value to UTC.
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param time The local time.
+ * @param ambiguous How to resolve a time that occurs twice.
+ * @param gap How to resolve a time that doesn't occur.
+ * @param result Where to store the time (UTC). Untouched on failure.
+ * @return nonzero on success, or 0 if a policy rejected the time.
+ */
+SMALLTIME_API int smalltime_tz_from_local(const smalltime_tz* zone, smalltime time,
+                                          smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                          smalltime* result);
+
+/**
+ * Convert a local time value to UTC.
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param time The local time.
+ * @param ambiguous How to resolve a time that occurs twice.
+ * @param gap How to resolve a time that doesn't occur.
+ * @param result Where to store the time (UTC). Untouched on failure.
+ * @return nonzero on success, or 0 if a policy rejected the time, or the
+ *         result is outside of the nanotime range.
+ */
+SMALLTIME_API int nanotime_tz_from_local(const smalltime_tz* zone, nanotime time,
+                                         smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                         nanotime* result);
+
+/**
+ * Convert an array of UTC time values to local time.
+ * Equivalent to calling smalltime_tz_to_local() on every value.
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param values The times (UTC).
+ * @param count The number of values.
+ * @param results Where to store the local times. Can be the same array as values.
+ */
+SMALLTIME_API void smalltime_tz_batch_to_local(const smalltime_tz* zone, const smalltime* values, size_t count, smalltime* results);
+
+/**
+ * Convert an array of UTC time values to local time, flagging those whose
+ * local time is outside of the nanotime range. Value i is flagged by bit
+ * i % 64 of failed[i / 64].
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param values The times (UTC).
+ * @param count The number of values.
+ * @param results Where to store the local times. Can be the same array as
+ *                values. Entries for flagged values are untouched.
+ * @param failed Room for (count + 63) / 64 words, or NULL.
+ * @return the number of values flagged.
+ */
+SMALLTIME_API size_t nanotime_tz_batch_to_local(const smalltime_tz* zone, const nanotime* values, size_t count, nanotime* results, uint64_t* failed);
+
+/**
+ * Convert an array of local time values to UTC, flagging those that a
+ * policy rejected. Value i is flagged by bit i % 64 of failed[i / 64].
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param values The local times.
+ * @param count The number of values.
+ * @param ambiguous How to resolve a time that occurs twice.
+ * @param gap How to resolve a time that doesn't occur.
+ * @param results Where to store the times (UTC). Can be the same array as
+ *                values. Entries for flagged values are untouched.
+ * @param failed Room for (count + 63) / 64 words, or NULL.
+ * @return the number of values flagged.
+ */
+SMALLTIME_API size_t smalltime_tz_batch_from_local(const smalltime_tz* zone, const smalltime* values, size_t count,
+                                                   smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                                   smalltime* results, uint64_t* failed);
+
+/**
+ * Convert an array of local time values to UTC, flagging those that a
+ * policy rejected, or whose result is outside of the nanotime range.
+ * Value i is flagged by bit i % 64 of failed[i / 64].
+ * Note: Input is NOT validated!
+ *
+ * @param zone The zone.
+ * @param values The local times.
+ * @param count The number of values.
+ * @param ambiguous How to resolve a time that occurs twice.
+ * @param gap How to resolve a time that doesn't occur.
+ * @param results Where to store the times (UTC). Can be the same array as
+ *                values. Entries for flagged values are untouched.
+ * @param failed Room for (count + 63) / 64 words, or NULL.
+ * @return the number of values flagged.
+ */
+SMALLTIME_API size_t nanotime_tz_batch_from_local(const smalltime_tz* zone, const nanotime* values, size_t count,
+                                                  smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                                  nanotime* results, uint64_t* failed);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_tz_H
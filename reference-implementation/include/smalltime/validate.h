@@ -0,0 +1,188 @@
+/*
+ * Smalltime Validation
+ * ====================
+ *
+ * The rest of the API trusts its input. These functions are for screening
+ * values from untrusted sources before they're used: a value is valid when
+ * every field is within its range, including the number of days in the
+ * month (taking leap years into account). A second field of 60 (leap
+ * second) is valid.
+ *
+ * Normalizing an invalid value rolls each field that is out of range into
+ * the next larger field, the same way timegm() does: February 30th becomes
+ * March 2nd (or 1st in a leap year), day 0 becomes the last day of the
+ * previous month, month 13 becomes January of the next year, minute 60
+ * becomes the next hour, and so on. Valid values, including leap seconds,
+ * are returned unchanged.
+ *
+ * The scalar functions are inline. The batch functions live in the
+ * compiled smalltime library.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_validate_H
+#define KS_smalltime_validate_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/civil.h>
+#include <smalltime/epoch.h>
+
+
+// Rolls the month field into the year, and then the day field into the
+// month, returning the days since 1970-01-01.
+static inline int64_t smalltime_validate_days(int year, int month, int day)
+{
+    int64_t months = (int64_t)year * 12 + month - 1;
+    int64_t years = months >= 0 ? months / 12 : -((11 - months) / 12);
+    return (int64_t)smalltime_days_from_civil((int)years, (int)(months - years * 12) + 1, 1) + day - 1;
+}
+
+
+
+/**
+ * Check if a time value is valid.
+ *
+ * @param time The time value.
+ * @return nonzero if every field is within its range.
+ */
+static inline int smalltime_is_valid(smalltime time)
+{
+    int month = smalltime_get_month(time);
+    int day = smalltime_get_day(time);
+    return month >= 1 && month <= 12 &&
+           day >= 1 && day <= smalltime_days_in_month(smalltime_get_year(time), month) &&
+           smalltime_get_hour(time) <= 23 &&
+           smalltime_get_minute(time) <= 59 &&
+           smalltime_get_second(time) <= 60 &&
+           smalltime_get_microsecond(time) <= 999999;
+}
+
+/**
+ * Check if a time value is valid.
+ *
+ * @param time The time value.
+ * @return nonzero if every field is within its range.
+ */
+static inline int nanotime_is_valid(nanotime time)
+{
+    int month = nanotime_get_month(time);
+    int day = nanotime_get_day(time);
+    return month >= 1 && month <= 12 &&
+           day >= 1 && day <= smalltime_days_in_month(nanotime_get_year(time), month) &&
+           nanotime_get_hour(time) <= 23 &&
+           nanotime_get_minute(time) <= 59 &&
+           nanotime_get_second(time) <= 60 &&
+           nanotime_get_nanosecond(time) <= 999999999;
+}
+
+/**
+ * Roll the fields of a time value that are out of range forward into the
+ * larger fields.
+ * Note: The result must be within the smalltime range.
+ *
+ * @param time The time value.
+ * @return the normalized time value.
+ */
+static inline smalltime smalltime_normalize(smalltime time)
+{
+    if(smalltime_is_valid(time))
+    {
+        return time;
+    }
+    int64_t days = smalltime_validate_days(smalltime_get_year(time), smalltime_get_month(time), smalltime_get_day(time));
+    int microsecond = smalltime_get_microsecond(time);
+    int64_t seconds = days * 86400 +
+                      smalltime_get_hour(time) * 3600 +
+                      smalltime_get_minute(time) * 60 +
+                      smalltime_get_second(time) +
+                      microsecond / 1000000;
+    return smalltime_from_unix_seconds(seconds) | (microsecond % 1000000);
+}
+
+/**
+ * Roll the fields of a time value that are out of range forward into the
+ * larger fields.
+ * Note: The result must be within the nanotime range.
+ *
+ * @param time The time value.
+ * @return the normalized time value.
+ */
+static inline nanotime nanotime_normalize(nanotime time)
+{
+    if(nanotime_is_valid(time))
+    {
+        return time;
+    }
+    int64_t days = smalltime_validate_days(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time));
+    int nanosecond = nanotime_get_nanosecond(time);
+    int64_t seconds = days * 86400 +
+                      nanotime_get_hour(time) * 3600 +
+                      nanotime_get_minute(time) * 60 +
+                      nanotime_get_second(time) +
+                      nanosecond / 1000000000;
+    return nanotime_from_unix_seconds(seconds) | (nanotime)(nanosecond % 1000000000);
+}
+
+
+
+/**
+ * Check an array of time values, flagging the invalid ones.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param invalid Receives one bit per value, set if the value is invalid
+ *                (value i is bit i % 64 of word i / 64). Needs room for
+ *                (count + 63) / 64 words. Can be NULL.
+ * @return the number of invalid values.
+ */
+SMALLTIME_API size_t smalltime_batch_validate(const smalltime* values, size_t count, uint64_t* invalid);
+
+/**
+ * Check an array of time values, flagging the invalid ones.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param invalid Receives one bit per value, set if the value is invalid
+ *                (value i is bit i % 64 of word i / 64). Needs room for
+ *                (count + 63) / 64 words. Can be NULL.
+ * @return the number of invalid values.
+ */
+SMALLTIME_API size_t nanotime_batch_validate(const nanotime* values, size_t count, uint64_t* invalid);
+
+/**
+ * Normalize an array of time values (see smalltime_normalize).
+ * Note: The results must be within the smalltime range.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param results Where to store the normalized values (can be the same array as values).
+ * @return the number of values that were invalid.
+ */
+SMALLTIME_API size_t smalltime_batch_normalize(const smalltime* values, size_t count, smalltime* results);
+
+/**
+ * Normalize an array of time values (see nanotime_normalize).
+ * Note: The results must be within the nanotime range.
+ *
+ * @param values The time values.
+ * @param count The number of values.
+ * @param results Where to store the normalized values (can be the same array as values).
+ * @return the number of values that were invalid.
+ */
+SMALLTIME_API size_t nanotime_batch_normalize(const nanotime* values, size_t count, nanotime* results);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_validate_H
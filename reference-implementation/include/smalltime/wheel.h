@@ -0,0 +1,195 @@
+/*
+ * Smalltime Timer Wheels
+ * ======================
+ *
+ * Keeps any number of pending deadlines (smalltime or nanotime values),
+ * and fires the ones that have passed as the wheel's time is advanced.
+ * Adding and cancelling a timer take constant time, however many are
+ * pending.
+ *
+ * The wheel is hierarchical, and its levels are the fields of the packed
+ * value: one level each for the month, day, hour, minute and second, and
+ * below that one level for every 10 bits of the fraction (so two levels of
+ * 1024 slots for smalltime's microseconds, and three for nanotime's
+ * nanoseconds). Each level has a slot for every value its field can hold.
+ *
+ * A timer goes in the level of the highest field where its deadline
+ * differs from the wheel's time, in the slot for that field's value, which
+ * takes just a compare of the two packed values. Deadlines in a later year
+ * wait on a list of their own. When the wheel's time reaches a slot, the
+ * timers there move down to the levels below by the same rule, until they
+ * reach the lowest level, whose slots each hold one exact deadline.
+ * Bitmaps of the slots in use let the wheel skip straight to the next one.
+ *
+ * Timers fire in order of their deadlines, and timers with the same
+ * deadline fire in the order they were added (except for ones that were
+ * already due when added, which fire on the next advance).
+ *
+ * Deadlines must be valid times, and a wheel is not thread safe.
+ *
+ *
+ * License
+ * -------
+ *
+ * Copyright 2018 Karl Stenerud
+ * Released under the MIT license (see LICENSE-CODE.md).
+ */
+#ifndef KS_smalltime_wheel_H
+#define KS_smalltime_wheel_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/export.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+
+
+typedef struct smalltime_wheel smalltime_wheel;
+typedef struct nanotime_wheel nanotime_wheel;
+
+// A pending timer, for cancelling it. 0 is never a valid timer.
+typedef uint64_t smalltime_timer;
+
+// A timer that has fired.
+typedef struct
+{
+    smalltime deadline;
+    void* context;
+} smalltime_expiry;
+
+typedef struct
+{
+    nanotime deadline;
+    void* context;
+} nanotime_expiry;
+
+
+
+/**
+ * Create a timer wheel.
+ *
+ * @param now The wheel's starting time.
+ * @return The wheel, or NULL if out of memory. Free with smalltime_wheel_free().
+ */
+SMALLTIME_API smalltime_wheel* smalltime_wheel_new(smalltime now);
+
+/**
+ * Create a timer wheel.
+ *
+ * @param now The wheel's starting time.
+ * @return The wheel, or NULL if out of memory. Free with nanotime_wheel_free().
+ */
+SMALLTIME_API nanotime_wheel* nanotime_wheel_new(nanotime now);
+
+/**
+ * Free a timer wheel, dropping any pending timers.
+ *
+ * @param wheel The wheel.
+ */
+SMALLTIME_API void smalltime_wheel_free(smalltime_wheel* wheel);
+
+/**
+ * Free a timer wheel, dropping any pending timers.
+ *
+ * @param wheel The wheel.
+ */
+SMALLTIME_API void nanotime_wheel_free(nanotime_wheel* wheel);
+
+/**
+ * Add a timer. A deadline at or before the wheel's time fires on the next
+ * advance.
+ *
+ * @param wheel The wheel.
+ * @param deadline When the timer fires.
+ * @param context Given back when the timer fires.
+ * @return The timer, or 0 if out of memory.
+ */
+SMALLTIME_API smalltime_timer smalltime_wheel_add(smalltime_wheel* wheel, smalltime deadline, void* context);
+
+/**
+ * Add a timer. A deadline at or before the wheel's time fires on the next
+ * advance.
+ *
+ * @param wheel The wheel.
+ * @param deadline When the timer fires.
+ * @param context Given back when the timer fires.
+ * @return The timer, or 0 if out of memory.
+ */
+SMALLTIME_API smalltime_timer nanotime_wheel_add(nanotime_wheel* wheel, nanotime deadline, void* context);
+
+/**
+ * Cancel a pending timer.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ * @return Nonzero if the timer was cancelled, or 0 if it has already fired
+ *         or been cancelled.
+ */
+SMALLTIME_API int smalltime_wheel_cancel(smalltime_wheel* wheel, smalltime_timer timer);
+
+/**
+ * Cancel a pending timer.
+ *
+ * @param wheel The wheel.
+ * @param timer The timer.
+ * @return Nonzero if the timer was cancelled, or 0 if it has already fired
+ *         or been cancelled.
+ */
+SMALLTIME_API int nanotime_wheel_cancel(nanotime_wheel* wheel, smalltime_timer timer);
+
+/**
+ * Advance the wheel's time, firing the timers whose deadlines are at or
+ * before it, up to capacity at a time. If as many as capacity fire, the
+ * wheel may have stopped short, so call again with the same time until
+ * fewer do. A time before the wheel's time only fires timers that are
+ * already due.
+ *
+ * @param wheel The wheel.
+ * @param now The time to advance to.
+ * @param expired Receives the timers that fired, in order of deadline.
+ * @param capacity The most timers to fire.
+ * @return The number of timers that fired.
+ */
+SMALLTIME_API size_t smalltime_wheel_advance_to(smalltime_wheel* wheel, smalltime now,
+                                                smalltime_expiry* expired, size_t capacity);
+
+/**
+ * Advance the wheel's time, firing the timers whose deadlines are at or
+ * before it, up to capacity at a time. If as many as capacity fire, the
+ * wheel may have stopped short, so call again with the same time until
+ * fewer do. A time before the wheel's time only fires timers that are
+ * already due.
+ *
+ * @param wheel The wheel.
+ * @param now The time to advance to.
+ * @param expired Receives the timers that fired, in order of deadline.
+ * @param capacity The most timers to fire.
+ * @return The number of timers that fired.
+ */
+SMALLTIME_API size_t nanotime_wheel_advance_to(nanotime_wheel* wheel, nanotime now,
+                                               nanotime_expiry* expired, size_t capacity);
+
+/**
+ * Get the number of pending timers.
+ *
+ * @param wheel The wheel.
+ * @return The number of timers that have neither fired nor been cancelled.
+ */
+SMALLTIME_API size_t smalltime_wheel_count(const smalltime_wheel* wheel);
+
+/**
+ * Get the number of pending timers.
+ *
+ * @param wheel The wheel.
+ * @return The number of timers that have neither fired nor been cancelled.
+ */
+SMALLTIME_API size_t nanotime_wheel_count(const nanotime_wheel* wheel);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_wheel_H
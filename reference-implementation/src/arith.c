@@ -0,0 +1,489 @@
+#include "kernels.h"
+#include <smalltime/arith.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+// Adding a constant to a field stays within the field if and only if the
+// field is within a range that depends only on the constant, so the
+// kernels check each value's fields against precomputed ranges and apply
+// the precomputed increment to those that pass.
+
+static inline int field_in_range(uint64_t value, const smalltime_field_range* range)
+{
+    int64_t field = (int64_t)((value >> range->shift) & range->mask);
+    return field >= range->min && field < range->max;
+}
+
+static inline int fields_in_range(uint64_t value, const smalltime_field_add* op)
+{
+    return field_in_range(value, &op->ranges[0]) && field_in_range(value, &op->ranges[1]);
+}
+
+static inline void add_field_range(const uint64_t* values, const smalltime_field_add* op, uint64_t* results, size_t begin, size_t end)
+{
+    for(size_t i = begin; i < end; i++)
+    {
+        uint64_t value = values[i];
+        results[i] = fields_in_range(value, op) ? value + op->increment : op->add(value, op->amount);
+    }
+}
+
+void smalltime_batch_add_field_scalar(const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results)
+{
+    add_field_range(values, op, results, 0, count);
+}
+
+void smalltime_batch_diff_us_scalar(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        durations[i] = smalltime_diff_us(ends[i], starts[i]);
+    }
+}
+
+void nanotime_batch_diff_ns_scalar(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        durations[i] = nanotime_diff_ns(ends[i], starts[i]);
+    }
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// The SIMD kernels check a whole vector at once, and store the fast path
+// results for every lane that passed. Lanes that failed are then finished
+// one at a time, reading from values before writing to results so that
+// the two may be the same array.
+//
+// The diff kernels have two fast paths: when every pair in the vector is
+// within the same second the values subtract directly, and pairs on the
+// same day take the difference of the second of the day (which fits in 32
+// bits) times the fractions per second, plus that of the fractions.
+
+// Where the time of day fields are, for the diff kernels.
+typedef struct
+{
+    int day_shift;
+    int hour_shift;
+    int minute_shift;
+    int second_shift;
+    uint64_t fraction_mask;
+    int fractions_per_second;
+    int64_t (*diff)(uint64_t end, uint64_t start);
+} diff_layout;
+
+static int64_t smalltime_diff_bits(uint64_t end, uint64_t start)
+{
+    return smalltime_diff_us((smalltime)end, (smalltime)start);
+}
+
+static int64_t nanotime_diff_bits(uint64_t end, uint64_t start)
+{
+    return nanotime_diff_ns(end, start);
+}
+
+static const diff_layout smalltime_layout =
+{
+    ST_SHIFT_DAY, ST_SHIFT_HOUR, ST_SHIFT_MINUTE, ST_SHIFT_SECOND, ST_MASK_MICROSECOND, 1000000, smalltime_diff_bits,
+};
+
+static const diff_layout nanotime_layout =
+{
+    NT_SHIFT_DAY, NT_SHIFT_HOUR, NT_SHIFT_MINUTE, NT_SHIFT_SECOND, NT_MASK_NANOSECOND, 1000000000, nanotime_diff_bits,
+};
+
+static inline void diff_range(const uint64_t* ends, const uint64_t* starts, int64_t* durations, size_t begin, size_t end, const diff_layout* layout)
+{
+    for(size_t i = begin; i < end; i++)
+    {
+        durations[i] = layout->diff(ends[i], starts[i]);
+    }
+}
+
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+// pcmpgtq arrived in SSE4.2, which is what makes these kernels possible.
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_field_in_range(__m128i v, const smalltime_field_range* range)
+{
+    __m128i field = _mm_and_si128(_mm_srl_epi64(v, _mm_cvtsi32_si128(range->shift)), _mm_set1_epi64x((long long)range->mask));
+    __m128i below = _mm_cmpgt_epi64(_mm_set1_epi64x(range->min), field);
+    __m128i under_max = _mm_cmpgt_epi64(_mm_set1_epi64x(range->max), field);
+    return _mm_andnot_si128(below, under_max);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_batch_add_field_sse42(const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results)
+{
+    const __m128i increment = _mm_set1_epi64x((long long)op->increment);
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i ok = _mm_and_si128(sse42_field_in_range(v, &op->ranges[0]), sse42_field_in_range(v, &op->ranges[1]));
+        if(_mm_movemask_pd(_mm_castsi128_pd(ok)) == 0x3)
+        {
+            _mm_storeu_si128((__m128i*)(results + i), _mm_add_epi64(v, increment));
+        }
+        else
+        {
+            add_field_range(values, op, results, i, i + 2);
+        }
+    }
+    add_field_range(values, op, results, i, count);
+}
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_second_of_day(__m128i v, const diff_layout* layout)
+{
+    __m128i hour = _mm_and_si128(_mm_srli_epi64(v, layout->hour_shift), _mm_set1_epi64x(0x1f));
+    __m128i minute = _mm_and_si128(_mm_srli_epi64(v, layout->minute_shift), _mm_set1_epi64x(0x3f));
+    __m128i second = _mm_and_si128(_mm_srli_epi64(v, layout->second_shift), _mm_set1_epi64x(0x3f));
+    return _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(hour, _mm_set1_epi64x(3600)),
+                                       _mm_mullo_epi32(minute, _mm_set1_epi64x(60))), second);
+}
+
+SMALLTIME_TARGET_SSE42
+static inline void sse42_diff(const uint64_t* ends, const uint64_t* starts, size_t count, int64_t* durations, const diff_layout* layout)
+{
+    const __m128i fraction_mask = _mm_set1_epi64x((long long)layout->fraction_mask);
+    const __m128i fractions_per_second = _mm_set1_epi64x(layout->fractions_per_second);
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i end = _mm_loadu_si128((const __m128i*)(ends + i));
+        __m128i start = _mm_loadu_si128((const __m128i*)(starts + i));
+        __m128i differing_bits = _mm_xor_si128(end, start);
+        if(_mm_testz_si128(_mm_srli_epi64(differing_bits, layout->second_shift), _mm_set1_epi64x(-1)))
+        {
+            _mm_storeu_si128((__m128i*)(durations + i), _mm_sub_epi64(end, start));
+            continue;
+        }
+        __m128i same_day = _mm_cmpeq_epi64(_mm_srli_epi64(differing_bits, layout->day_shift), _mm_setzero_si128());
+        if(_mm_movemask_pd(_mm_castsi128_pd(same_day)) == 0x3)
+        {
+            __m128i seconds = _mm_sub_epi32(sse42_second_of_day(end, layout), sse42_second_of_day(start, layout));
+            __m128i fractions = _mm_sub_epi64(_mm_and_si128(end, fraction_mask), _mm_and_si128(start, fraction_mask));
+            _mm_storeu_si128((__m128i*)(durations + i), _mm_add_epi64(_mm_mul_epi32(seconds, fractions_per_second), fractions));
+        }
+        else
+        {
+            diff_range(ends, starts, durations, i, i + 2, layout);
+        }
+    }
+    diff_range(ends, starts, durations, i, count, layout);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_batch_diff_us_sse42(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations)
+{
+    sse42_diff((const uint64_t*)ends, (const uint64_t*)starts, count, durations, &smalltime_layout);
+}
+
+SMALLTIME_TARGET_SSE42
+void nanotime_batch_diff_ns_sse42(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations)
+{
+    sse42_diff(ends, starts, count, durations, &nanotime_layout);
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_field_in_range(__m256i v, const smalltime_field_range* range)
+{
+    __m256i field = _mm256_and_si256(_mm256_srl_epi64(v, _mm_cvtsi32_si128(range->shift)), _mm256_set1_epi64x((long long)range->mask));
+    __m256i below = _mm256_cmpgt_epi64(_mm256_set1_epi64x(range->min), field);
+    __m256i under_max = _mm256_cmpgt_epi64(_mm256_set1_epi64x(range->max), field);
+    return _mm256_andnot_si256(below, under_max);
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_batch_add_field_avx2(const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results)
+{
+    const __m256i increment = _mm256_set1_epi64x((long long)op->increment);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i ok = _mm256_and_si256(avx2_field_in_range(v, &op->ranges[0]), avx2_field_in_range(v, &op->ranges[1]));
+        _mm256_maskstore_epi64((long long*)(results + i), ok, _mm256_add_epi64(v, increment));
+        for(unsigned slow = ~(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(ok)) & 0xf; slow != 0; slow &= slow - 1)
+        {
+            size_t lane = i + (size_t)__builtin_ctz(slow);
+            results[lane] = op->add(values[lane], op->amount);
+        }
+    }
+    add_field_range(values, op, results, i, count);
+}
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_second_of_day(__m256i v, const diff_layout* layout)
+{
+    __m256i hour = _mm256_and_si256(_mm256_srli_epi64(v, layout->hour_shift), _mm256_set1_epi64x(0x1f));
+    __m256i minute = _mm256_and_si256(_mm256_srli_epi64(v, layout->minute_shift), _mm256_set1_epi64x(0x3f));
+    __m256i second = _mm256_and_si256(_mm256_srli_epi64(v, layout->second_shift), _mm256_set1_epi64x(0x3f));
+    return _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(hour, _mm256_set1_epi64x(3600)),
+                                             _mm256_mullo_epi32(minute, _mm256_set1_epi64x(60))), second);
+}
+
+SMALLTIME_TARGET_AVX2
+static inline void avx2_diff(const uint64_t* ends, const uint64_t* starts, size_t count, int64_t* durations, const diff_layout* layout)
+{
+    const __m256i fraction_mask = _mm256_set1_epi64x((long long)layout->fraction_mask);
+    const __m256i fractions_per_second = _mm256_set1_epi64x(layout->fractions_per_second);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i end = _mm256_loadu_si256((const __m256i*)(ends + i));
+        __m256i start = _mm256_loadu_si256((const __m256i*)(starts + i));
+        __m256i differing_bits = _mm256_xor_si256(end, start);
+        if(_mm256_testz_si256(_mm256_srli_epi64(differing_bits, layout->second_shift), _mm256_set1_epi64x(-1)))
+        {
+            _mm256_storeu_si256((__m256i*)(durations + i), _mm256_sub_epi64(end, start));
+            continue;
+        }
+        __m256i same_day = _mm256_cmpeq_epi64(_mm256_srli_epi64(differing_bits, layout->day_shift), _mm256_setzero_si256());
+        __m256i seconds = _mm256_sub_epi32(avx2_second_of_day(end, layout), avx2_second_of_day(start, layout));
+        __m256i fractions = _mm256_sub_epi64(_mm256_and_si256(end, fraction_mask), _mm256_and_si256(start, fraction_mask));
+        _mm256_storeu_si256((__m256i*)(durations + i), _mm256_add_epi64(_mm256_mul_epi32(seconds, fractions_per_second), fractions));
+        for(unsigned slow = ~(unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(same_day)) & 0xf; slow != 0; slow &= slow - 1)
+        {
+            size_t lane = i + (size_t)__builtin_ctz(slow);
+            durations[lane] = layout->diff(ends[lane], starts[lane]);
+        }
+    }
+    diff_range(ends, starts, durations, i, count, layout);
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_batch_diff_us_avx2(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations)
+{
+    avx2_diff((const uint64_t*)ends, (const uint64_t*)starts, count, durations, &smalltime_layout);
+}
+
+SMALLTIME_TARGET_AVX2
+void nanotime_batch_diff_ns_avx2(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations)
+{
+    avx2_diff(ends, starts, count, durations, &nanotime_layout);
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+static inline __mmask8 avx512_field_in_range(__m512i v, const smalltime_field_range* range)
+{
+    __m512i field = _mm512_and_si512(_mm512_srl_epi64(v, _mm_cvtsi32_si128(range->shift)), _mm512_set1_epi64((long long)range->mask));
+    return _mm512_cmpge_epi64_mask(field, _mm512_set1_epi64(range->min)) &
+           _mm512_cmplt_epi64_mask(field, _mm512_set1_epi64(range->max));
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_add_field_avx512(const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results)
+{
+    const __m512i increment = _mm512_set1_epi64((long long)op->increment);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __mmask8 ok = avx512_field_in_range(v, &op->ranges[0]) & avx512_field_in_range(v, &op->ranges[1]);
+        _mm512_mask_storeu_epi64(results + i, ok, _mm512_add_epi64(v, increment));
+        for(unsigned slow = (uint8_t)~ok; slow != 0; slow &= slow - 1)
+        {
+            size_t lane = i + (size_t)__builtin_ctz(slow);
+            results[lane] = op->add(values[lane], op->amount);
+        }
+    }
+    add_field_range(values, op, results, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_second_of_day(__m512i v, const diff_layout* layout)
+{
+    __m512i hour = _mm512_and_si512(_mm512_srli_epi64(v, layout->hour_shift), _mm512_set1_epi64(0x1f));
+    __m512i minute = _mm512_and_si512(_mm512_srli_epi64(v, layout->minute_shift), _mm512_set1_epi64(0x3f));
+    __m512i second = _mm512_and_si512(_mm512_srli_epi64(v, layout->second_shift), _mm512_set1_epi64(0x3f));
+    return _mm512_add_epi32(_mm512_add_epi32(_mm512_mullo_epi32(hour, _mm512_set1_epi64(3600)),
+                                             _mm512_mullo_epi32(minute, _mm512_set1_epi64(60))), second);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline void avx512_diff(const uint64_t* ends, const uint64_t* starts, size_t count, int64_t* durations, const diff_layout* layout)
+{
+    const __m512i fraction_mask = _mm512_set1_epi64((long long)layout->fraction_mask);
+    const __m512i fractions_per_second = _mm512_set1_epi64(layout->fractions_per_second);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i end = _mm512_loadu_si512(ends + i);
+        __m512i start = _mm512_loadu_si512(starts + i);
+        __m512i differing_bits = _mm512_xor_si512(end, start);
+        if(_mm512_test_epi64_mask(_mm512_srli_epi64(differing_bits, layout->second_shift), _mm512_set1_epi64(-1)) == 0)
+        {
+            _mm512_storeu_si512(durations + i, _mm512_sub_epi64(end, start));
+            continue;
+        }
+        __mmask8 same_day = _mm512_testn_epi64_mask(_mm512_srli_epi64(differing_bits, layout->day_shift), _mm512_set1_epi64(-1));
+        __m512i seconds = _mm512_sub_epi32(avx512_second_of_day(end, layout), avx512_second_of_day(start, layout));
+        __m512i fractions = _mm512_sub_epi64(_mm512_and_si512(end, fraction_mask), _mm512_and_si512(start, fraction_mask));
+        _mm512_storeu_si512(durations + i, _mm512_add_epi64(_mm512_mul_epi32(seconds, fractions_per_second), fractions));
+        for(unsigned slow = (uint8_t)~same_day; slow != 0; slow &= slow - 1)
+        {
+            size_t lane = i + (size_t)__builtin_ctz(slow);
+            durations[lane] = layout->diff(ends[lane], starts[lane]);
+        }
+    }
+    diff_range(ends, starts, durations, i, count, layout);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_diff_us_avx512(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations)
+{
+    avx512_diff((const uint64_t*)ends, (const uint64_t*)starts, count, durations, &smalltime_layout);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_diff_ns_avx512(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations)
+{
+    avx512_diff(ends, starts, count, durations, &nanotime_layout);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+static uint64_t smalltime_add_microseconds_bits(uint64_t value, int64_t amount)
+{
+    return (uint64_t)smalltime_add_microseconds((smalltime)value, amount);
+}
+
+static uint64_t smalltime_add_seconds_bits(uint64_t value, int64_t amount)
+{
+    return (uint64_t)smalltime_add_seconds((smalltime)value, amount);
+}
+
+static uint64_t smalltime_add_days_bits(uint64_t value, int64_t amount)
+{
+    return (uint64_t)smalltime_add_days((smalltime)value, amount);
+}
+
+static uint64_t smalltime_add_months_bits(uint64_t value, int64_t amount)
+{
+    return (uint64_t)smalltime_add_months((smalltime)value, amount);
+}
+
+static uint64_t nanotime_add_nanoseconds_bits(uint64_t value, int64_t amount)
+{
+    return nanotime_add_nanoseconds(value, amount);
+}
+
+static uint64_t nanotime_add_seconds_bits(uint64_t value, int64_t amount)
+{
+    return nanotime_add_seconds(value, amount);
+}
+
+static uint64_t nanotime_add_days_bits(uint64_t value, int64_t amount)
+{
+    return nanotime_add_days(value, amount);
+}
+
+static uint64_t nanotime_add_months_bits(uint64_t value, int64_t amount)
+{
+    return nanotime_add_months(value, amount);
+}
+
+// Sets up an add to the field at shift, whose valid values are [min, max).
+// The second range is left open for the caller to fill in if needed.
+static smalltime_field_add make_field_add(int shift, uint64_t mask, int64_t min, int64_t max, int64_t amount,
+                                          uint64_t (*add)(uint64_t value, int64_t amount))
+{
+    smalltime_field_add op = {{{shift, mask, 0, 0}, {0, 0, 0, 1}}, (uint64_t)amount << shift, amount, add};
+    // Amounts this large always carry, so the range stays empty.
+    if(amount > -max && amount < max)
+    {
+        op.ranges[0].min = min - amount;
+        op.ranges[0].max = max - amount;
+    }
+    return op;
+}
+
+void smalltime_batch_add_microseconds(const smalltime* values, size_t count, int64_t microseconds, smalltime* results)
+{
+    smalltime_field_add op = make_field_add(0, ST_MASK_MICROSECOND, 0, 1000000, microseconds, smalltime_add_microseconds_bits);
+    smalltime_kernels.smalltime_batch_add_field((const uint64_t*)values, count, &op, (uint64_t*)results);
+}
+
+void smalltime_batch_add_seconds(const smalltime* values, size_t count, int64_t seconds, smalltime* results)
+{
+    smalltime_field_add op = make_field_add(ST_SHIFT_SECOND, 0x3f, 0, 60, seconds, smalltime_add_seconds_bits);
+    smalltime_kernels.smalltime_batch_add_field((const uint64_t*)values, count, &op, (uint64_t*)results);
+}
+
+void smalltime_batch_add_days(const smalltime* values, size_t count, int64_t days, smalltime* results)
+{
+    smalltime_field_add op = make_field_add(ST_SHIFT_DAY, 0x1f, 1, 29, days, smalltime_add_days_bits);
+    smalltime_kernels.smalltime_batch_add_field((const uint64_t*)values, count, &op, (uint64_t*)results);
+}
+
+void smalltime_batch_add_months(const smalltime* values, size_t count, int64_t months, smalltime* results)
+{
+    smalltime_field_add op = make_field_add(ST_SHIFT_MONTH, 0xf, 1, 13, months, smalltime_add_months_bits);
+    // The day must also exist in every month.
+    op.ranges[1] = (smalltime_field_range){ST_SHIFT_DAY, 0x1f, 1, 29};
+    smalltime_kernels.smalltime_batch_add_field((const uint64_t*)values, count, &op, (uint64_t*)results);
+}
+
+void nanotime_batch_add_nanoseconds(const nanotime* values, size_t count, int64_t nanoseconds, nanotime* results)
+{
+    smalltime_field_add op = make_field_add(0, NT_MASK_NANOSECOND, 0, 1000000000, nanoseconds, nanotime_add_nanoseconds_bits);
+    smalltime_kernels.smalltime_batch_add_field(values, count, &op, results);
+}
+
+void nanotime_batch_add_seconds(const nanotime* values, size_t count, int64_t seconds, nanotime* results)
+{
+    smalltime_field_add op = make_field_add(NT_SHIFT_SECOND, 0x3f, 0, 60, seconds, nanotime_add_seconds_bits);
+    smalltime_kernels.smalltime_batch_add_field(values, count, &op, results);
+}
+
+void nanotime_batch_add_days(const nanotime* values, size_t count, int64_t days, nanotime* results)
+{
+    smalltime_field_add op = make_field_add(NT_SHIFT_DAY, 0x1f, 1, 29, days, nanotime_add_days_bits);
+    smalltime_kernels.smalltime_batch_add_field(values, count, &op, results);
+}
+
+void nanotime_batch_add_months(const nanotime* values, size_t count, int64_t months, nanotime* results)
+{
+    smalltime_field_add op = make_field_add(NT_SHIFT_MONTH, 0xf, 1, 13, months, nanotime_add_months_bits);
+    op.ranges[1] = (smalltime_field_range){NT_SHIFT_DAY, 0x1f, 1, 29};
+    smalltime_kernels.smalltime_batch_add_field(values, count, &op, results);
+}
+
+void smalltime_batch_diff_us(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations)
+{
+    smalltime_kernels.smalltime_batch_diff_us(ends, starts, count, durations);
+}
+
+void nanotime_batch_diff_ns(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations)
+{
+    smalltime_kernels.nanotime_batch_diff_ns(ends, starts, count, durations);
+}
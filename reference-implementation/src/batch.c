@@ -0,0 +1,598 @@
+#include "kernels.h"
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+static inline void smalltime_decode_range(const smalltime* values, const smalltime_columns* columns, size_t begin, size_t end)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* microsecond = columns->microsecond;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        smalltime value = values[i];
+        year[i] = smalltime_get_year(value);
+        month[i] = smalltime_get_month(value);
+        day[i] = smalltime_get_day(value);
+        hour[i] = smalltime_get_hour(value);
+        minute[i] = smalltime_get_minute(value);
+        second[i] = smalltime_get_second(value);
+        microsecond[i] = smalltime_get_microsecond(value);
+    }
+}
+
+static inline void smalltime_encode_range(const smalltime_columns* columns, smalltime* values, size_t begin, size_t end)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* microsecond = columns->microsecond;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        values[i] = smalltime_new(year[i], month[i], day[i], hour[i], minute[i], second[i], microsecond[i]);
+    }
+}
+
+static inline void nanotime_decode_range(const nanotime* values, const nanotime_columns* columns, size_t begin, size_t end)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* nanosecond = columns->nanosecond;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        nanotime value = values[i];
+        year[i] = nanotime_get_year(value);
+        month[i] = nanotime_get_month(value);
+        day[i] = nanotime_get_day(value);
+        hour[i] = nanotime_get_hour(value);
+        minute[i] = nanotime_get_minute(value);
+        second[i] = nanotime_get_second(value);
+        nanosecond[i] = nanotime_get_nanosecond(value);
+    }
+}
+
+static inline void nanotime_encode_range(const nanotime_columns* columns, nanotime* values, size_t begin, size_t end)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* nanosecond = columns->nanosecond;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        values[i] = nanotime_new(year[i], month[i], day[i], hour[i], minute[i], second[i], nanosecond[i]);
+    }
+}
+
+void smalltime_batch_decode_scalar(const smalltime* values, size_t count, const smalltime_columns* columns)
+{
+    smalltime_decode_range(values, columns, 0, count);
+}
+
+void smalltime_batch_encode_scalar(const smalltime_columns* columns, size_t count, smalltime* values)
+{
+    smalltime_encode_range(columns, values, 0, count);
+}
+
+void nanotime_batch_decode_scalar(const nanotime* values, size_t count, const nanotime_columns* columns)
+{
+    nanotime_decode_range(values, columns, 0, count);
+}
+
+void nanotime_batch_encode_scalar(const nanotime_columns* columns, size_t count, nanotime* values)
+{
+    nanotime_encode_range(columns, values, 0, count);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// All decoders work on the low and high 32-bit halves of each value. Every
+// field except nanotime's second lies entirely within one half, so the
+// fields can be extracted with 32-bit lane operations, which gives twice
+// the lanes per register and avoids the missing 64-bit arithmetic shift.
+//
+// Encoders sign-extend each field to 64 bits before shifting it into place,
+// exactly as the (smalltime)/(nanotime) casts in the inline functions do,
+// so even invalid input produces identical bits.
+
+#define ST_HI_SHIFT_YEAR   (ST_SHIFT_YEAR - 32)
+#define ST_HI_SHIFT_MONTH  (ST_SHIFT_MONTH - 32)
+#define ST_HI_SHIFT_DAY    (ST_SHIFT_DAY - 32)
+#define NT_HI_SHIFT_YEAR   (NT_SHIFT_YEAR - 32)
+#define NT_HI_SHIFT_MONTH  (NT_SHIFT_MONTH - 32)
+#define NT_HI_SHIFT_DAY    (NT_SHIFT_DAY - 32)
+#define NT_HI_SHIFT_HOUR   (NT_SHIFT_HOUR - 32)
+#define NT_HI_SHIFT_MINUTE (NT_SHIFT_MINUTE - 32)
+
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_load_32_as_64(const int* src)
+{
+    return _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i*)src));
+}
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_low_halves(__m128i a, __m128i b)
+{
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_high_halves(__m128i a, __m128i b)
+{
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_batch_decode_sse42(const smalltime* values, size_t count, const smalltime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* microsecond = columns->microsecond;
+    const __m128i mask4 = _mm_set1_epi32(0xf);
+    const __m128i mask5 = _mm_set1_epi32(0x1f);
+    const __m128i mask6 = _mm_set1_epi32(0x3f);
+    const __m128i mask20 = _mm_set1_epi32(ST_MASK_MICROSECOND);
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(values + i + 2));
+        __m128i lo = sse42_low_halves(a, b);
+        __m128i hi = sse42_high_halves(a, b);
+
+        _mm_storeu_si128((__m128i*)(year + i), _mm_srai_epi32(hi, ST_HI_SHIFT_YEAR));
+        _mm_storeu_si128((__m128i*)(month + i), _mm_and_si128(_mm_srli_epi32(hi, ST_HI_SHIFT_MONTH), mask4));
+        _mm_storeu_si128((__m128i*)(day + i), _mm_and_si128(_mm_srli_epi32(hi, ST_HI_SHIFT_DAY), mask5));
+        _mm_storeu_si128((__m128i*)(hour + i), _mm_and_si128(hi, mask5));
+        _mm_storeu_si128((__m128i*)(minute + i), _mm_srli_epi32(lo, ST_SHIFT_MINUTE));
+        _mm_storeu_si128((__m128i*)(second + i), _mm_and_si128(_mm_srli_epi32(lo, ST_SHIFT_SECOND), mask6));
+        _mm_storeu_si128((__m128i*)(microsecond + i), _mm_and_si128(lo, mask20));
+    }
+    smalltime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_batch_encode_sse42(const smalltime_columns* columns, size_t count, smalltime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* microsecond = columns->microsecond;
+
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_slli_epi64(sse42_load_32_as_64(year + i), ST_SHIFT_YEAR);
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(month + i), ST_SHIFT_MONTH));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(day + i), ST_SHIFT_DAY));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(hour + i), ST_SHIFT_HOUR));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(minute + i), ST_SHIFT_MINUTE));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(second + i), ST_SHIFT_SECOND));
+        v = _mm_or_si128(v, sse42_load_32_as_64(microsecond + i));
+        _mm_storeu_si128((__m128i*)(values + i), v);
+    }
+    smalltime_encode_range(columns, values, i, count);
+}
+
+SMALLTIME_TARGET_SSE42
+void nanotime_batch_decode_sse42(const nanotime* values, size_t count, const nanotime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* nanosecond = columns->nanosecond;
+    const __m128i zero_year = _mm_set1_epi32(NT_ZERO_YEAR);
+    const __m128i mask4 = _mm_set1_epi32(0xf);
+    const __m128i mask5 = _mm_set1_epi32(0x1f);
+    const __m128i mask6 = _mm_set1_epi32(0x3f);
+    const __m128i mask30 = _mm_set1_epi32(NT_MASK_NANOSECOND);
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(values + i + 2));
+        __m128i lo = sse42_low_halves(a, b);
+        __m128i hi = sse42_high_halves(a, b);
+        __m128i sec = _mm_or_si128(_mm_srli_epi32(lo, NT_SHIFT_SECOND), _mm_slli_epi32(hi, 32 - NT_SHIFT_SECOND));
+
+        _mm_storeu_si128((__m128i*)(year + i), _mm_add_epi32(_mm_srli_epi32(hi, NT_HI_SHIFT_YEAR), zero_year));
+        _mm_storeu_si128((__m128i*)(month + i), _mm_and_si128(_mm_srli_epi32(hi, NT_HI_SHIFT_MONTH), mask4));
+        _mm_storeu_si128((__m128i*)(day + i), _mm_and_si128(_mm_srli_epi32(hi, NT_HI_SHIFT_DAY), mask5));
+        _mm_storeu_si128((__m128i*)(hour + i), _mm_and_si128(_mm_srli_epi32(hi, NT_HI_SHIFT_HOUR), mask5));
+        _mm_storeu_si128((__m128i*)(minute + i), _mm_and_si128(_mm_srli_epi32(hi, NT_HI_SHIFT_MINUTE), mask6));
+        _mm_storeu_si128((__m128i*)(second + i), _mm_and_si128(sec, mask6));
+        _mm_storeu_si128((__m128i*)(nanosecond + i), _mm_and_si128(lo, mask30));
+    }
+    nanotime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_SSE42
+void nanotime_batch_encode_sse42(const nanotime_columns* columns, size_t count, nanotime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* nanosecond = columns->nanosecond;
+    const __m128i zero_year = _mm_set1_epi64x(NT_ZERO_YEAR);
+
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_slli_epi64(_mm_sub_epi64(sse42_load_32_as_64(year + i), zero_year), NT_SHIFT_YEAR);
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(month + i), NT_SHIFT_MONTH));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(day + i), NT_SHIFT_DAY));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(hour + i), NT_SHIFT_HOUR));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(minute + i), NT_SHIFT_MINUTE));
+        v = _mm_or_si128(v, _mm_slli_epi64(sse42_load_32_as_64(second + i), NT_SHIFT_SECOND));
+        v = _mm_or_si128(v, sse42_load_32_as_64(nanosecond + i));
+        _mm_storeu_si128((__m128i*)(values + i), v);
+    }
+    nanotime_encode_range(columns, values, i, count);
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_load_32_as_64(const int* src)
+{
+    return _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)src));
+}
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_low_halves(__m256i a, __m256i b)
+{
+    __m256i mixed = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+    return _mm256_permute4x64_epi64(mixed, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_high_halves(__m256i a, __m256i b)
+{
+    __m256i mixed = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm256_permute4x64_epi64(mixed, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_batch_decode_avx2(const smalltime* values, size_t count, const smalltime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* microsecond = columns->microsecond;
+    const __m256i mask4 = _mm256_set1_epi32(0xf);
+    const __m256i mask5 = _mm256_set1_epi32(0x1f);
+    const __m256i mask6 = _mm256_set1_epi32(0x3f);
+    const __m256i mask20 = _mm256_set1_epi32(ST_MASK_MICROSECOND);
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(values + i + 4));
+        __m256i lo = avx2_low_halves(a, b);
+        __m256i hi = avx2_high_halves(a, b);
+
+        _mm256_storeu_si256((__m256i*)(year + i), _mm256_srai_epi32(hi, ST_HI_SHIFT_YEAR));
+        _mm256_storeu_si256((__m256i*)(month + i), _mm256_and_si256(_mm256_srli_epi32(hi, ST_HI_SHIFT_MONTH), mask4));
+        _mm256_storeu_si256((__m256i*)(day + i), _mm256_and_si256(_mm256_srli_epi32(hi, ST_HI_SHIFT_DAY), mask5));
+        _mm256_storeu_si256((__m256i*)(hour + i), _mm256_and_si256(hi, mask5));
+        _mm256_storeu_si256((__m256i*)(minute + i), _mm256_srli_epi32(lo, ST_SHIFT_MINUTE));
+        _mm256_storeu_si256((__m256i*)(second + i), _mm256_and_si256(_mm256_srli_epi32(lo, ST_SHIFT_SECOND), mask6));
+        _mm256_storeu_si256((__m256i*)(microsecond + i), _mm256_and_si256(lo, mask20));
+    }
+    smalltime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_batch_encode_avx2(const smalltime_columns* columns, size_t count, smalltime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* microsecond = columns->microsecond;
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_slli_epi64(avx2_load_32_as_64(year + i), ST_SHIFT_YEAR);
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(month + i), ST_SHIFT_MONTH));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(day + i), ST_SHIFT_DAY));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(hour + i), ST_SHIFT_HOUR));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(minute + i), ST_SHIFT_MINUTE));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(second + i), ST_SHIFT_SECOND));
+        v = _mm256_or_si256(v, avx2_load_32_as_64(microsecond + i));
+        _mm256_storeu_si256((__m256i*)(values + i), v);
+    }
+    smalltime_encode_range(columns, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX2
+void nanotime_batch_decode_avx2(const nanotime* values, size_t count, const nanotime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* nanosecond = columns->nanosecond;
+    const __m256i zero_year = _mm256_set1_epi32(NT_ZERO_YEAR);
+    const __m256i mask4 = _mm256_set1_epi32(0xf);
+    const __m256i mask5 = _mm256_set1_epi32(0x1f);
+    const __m256i mask6 = _mm256_set1_epi32(0x3f);
+    const __m256i mask30 = _mm256_set1_epi32(NT_MASK_NANOSECOND);
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(values + i + 4));
+        __m256i lo = avx2_low_halves(a, b);
+        __m256i hi = avx2_high_halves(a, b);
+        __m256i sec = _mm256_or_si256(_mm256_srli_epi32(lo, NT_SHIFT_SECOND), _mm256_slli_epi32(hi, 32 - NT_SHIFT_SECOND));
+
+        _mm256_storeu_si256((__m256i*)(year + i), _mm256_add_epi32(_mm256_srli_epi32(hi, NT_HI_SHIFT_YEAR), zero_year));
+        _mm256_storeu_si256((__m256i*)(month + i), _mm256_and_si256(_mm256_srli_epi32(hi, NT_HI_SHIFT_MONTH), mask4));
+        _mm256_storeu_si256((__m256i*)(day + i), _mm256_and_si256(_mm256_srli_epi32(hi, NT_HI_SHIFT_DAY), mask5));
+        _mm256_storeu_si256((__m256i*)(hour + i), _mm256_and_si256(_mm256_srli_epi32(hi, NT_HI_SHIFT_HOUR), mask5));
+        _mm256_storeu_si256((__m256i*)(minute + i), _mm256_and_si256(_mm256_srli_epi32(hi, NT_HI_SHIFT_MINUTE), mask6));
+        _mm256_storeu_si256((__m256i*)(second + i), _mm256_and_si256(sec, mask6));
+        _mm256_storeu_si256((__m256i*)(nanosecond + i), _mm256_and_si256(lo, mask30));
+    }
+    nanotime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_AVX2
+void nanotime_batch_encode_avx2(const nanotime_columns* columns, size_t count, nanotime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* nanosecond = columns->nanosecond;
+    const __m256i zero_year = _mm256_set1_epi64x(NT_ZERO_YEAR);
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_slli_epi64(_mm256_sub_epi64(avx2_load_32_as_64(year + i), zero_year), NT_SHIFT_YEAR);
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(month + i), NT_SHIFT_MONTH));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(day + i), NT_SHIFT_DAY));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(hour + i), NT_SHIFT_HOUR));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(minute + i), NT_SHIFT_MINUTE));
+        v = _mm256_or_si256(v, _mm256_slli_epi64(avx2_load_32_as_64(second + i), NT_SHIFT_SECOND));
+        v = _mm256_or_si256(v, avx2_load_32_as_64(nanosecond + i));
+        _mm256_storeu_si256((__m256i*)(values + i), v);
+    }
+    nanotime_encode_range(columns, values, i, count);
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_load_32_as_64(const int* src)
+{
+    return _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)src));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_low_halves(__m512i a, __m512i b)
+{
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    return _mm512_permutex2var_epi32(a, even, b);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_high_halves(__m512i a, __m512i b)
+{
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    return _mm512_permutex2var_epi32(a, odd, b);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_decode_avx512(const smalltime* values, size_t count, const smalltime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* microsecond = columns->microsecond;
+    const __m512i mask4 = _mm512_set1_epi32(0xf);
+    const __m512i mask5 = _mm512_set1_epi32(0x1f);
+    const __m512i mask6 = _mm512_set1_epi32(0x3f);
+    const __m512i mask20 = _mm512_set1_epi32(ST_MASK_MICROSECOND);
+
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        __m512i a = _mm512_loadu_si512(values + i);
+        __m512i b = _mm512_loadu_si512(values + i + 8);
+        __m512i lo = avx512_low_halves(a, b);
+        __m512i hi = avx512_high_halves(a, b);
+
+        _mm512_storeu_si512(year + i, _mm512_srai_epi32(hi, ST_HI_SHIFT_YEAR));
+        _mm512_storeu_si512(month + i, _mm512_and_si512(_mm512_srli_epi32(hi, ST_HI_SHIFT_MONTH), mask4));
+        _mm512_storeu_si512(day + i, _mm512_and_si512(_mm512_srli_epi32(hi, ST_HI_SHIFT_DAY), mask5));
+        _mm512_storeu_si512(hour + i, _mm512_and_si512(hi, mask5));
+        _mm512_storeu_si512(minute + i, _mm512_srli_epi32(lo, ST_SHIFT_MINUTE));
+        _mm512_storeu_si512(second + i, _mm512_and_si512(_mm512_srli_epi32(lo, ST_SHIFT_SECOND), mask6));
+        _mm512_storeu_si512(microsecond + i, _mm512_and_si512(lo, mask20));
+    }
+    smalltime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_encode_avx512(const smalltime_columns* columns, size_t count, smalltime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* microsecond = columns->microsecond;
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_slli_epi64(avx512_load_32_as_64(year + i), ST_SHIFT_YEAR);
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(month + i), ST_SHIFT_MONTH));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(day + i), ST_SHIFT_DAY));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(hour + i), ST_SHIFT_HOUR));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(minute + i), ST_SHIFT_MINUTE));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(second + i), ST_SHIFT_SECOND));
+        v = _mm512_or_si512(v, avx512_load_32_as_64(microsecond + i));
+        _mm512_storeu_si512(values + i, v);
+    }
+    smalltime_encode_range(columns, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_decode_avx512(const nanotime* values, size_t count, const nanotime_columns* columns)
+{
+    int* year = columns->year;
+    int* month = columns->month;
+    int* day = columns->day;
+    int* hour = columns->hour;
+    int* minute = columns->minute;
+    int* second = columns->second;
+    int* nanosecond = columns->nanosecond;
+    const __m512i zero_year = _mm512_set1_epi32(NT_ZERO_YEAR);
+    const __m512i mask4 = _mm512_set1_epi32(0xf);
+    const __m512i mask5 = _mm512_set1_epi32(0x1f);
+    const __m512i mask6 = _mm512_set1_epi32(0x3f);
+    const __m512i mask30 = _mm512_set1_epi32(NT_MASK_NANOSECOND);
+
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        __m512i a = _mm512_loadu_si512(values + i);
+        __m512i b = _mm512_loadu_si512(values + i + 8);
+        __m512i lo = avx512_low_halves(a, b);
+        __m512i hi = avx512_high_halves(a, b);
+        __m512i sec = _mm512_or_si512(_mm512_srli_epi32(lo, NT_SHIFT_SECOND), _mm512_slli_epi32(hi, 32 - NT_SHIFT_SECOND));
+
+        _mm512_storeu_si512(year + i, _mm512_add_epi32(_mm512_srli_epi32(hi, NT_HI_SHIFT_YEAR), zero_year));
+        _mm512_storeu_si512(month + i, _mm512_and_si512(_mm512_srli_epi32(hi, NT_HI_SHIFT_MONTH), mask4));
+        _mm512_storeu_si512(day + i, _mm512_and_si512(_mm512_srli_epi32(hi, NT_HI_SHIFT_DAY), mask5));
+        _mm512_storeu_si512(hour + i, _mm512_and_si512(_mm512_srli_epi32(hi, NT_HI_SHIFT_HOUR), mask5));
+        _mm512_storeu_si512(minute + i, _mm512_and_si512(_mm512_srli_epi32(hi, NT_HI_SHIFT_MINUTE), mask6));
+        _mm512_storeu_si512(second + i, _mm512_and_si512(sec, mask6));
+        _mm512_storeu_si512(nanosecond + i, _mm512_and_si512(lo, mask30));
+    }
+    nanotime_decode_range(values, columns, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_encode_avx512(const nanotime_columns* columns, size_t count, nanotime* values)
+{
+    const int* year = columns->year;
+    const int* month = columns->month;
+    const int* day = columns->day;
+    const int* hour = columns->hour;
+    const int* minute = columns->minute;
+    const int* second = columns->second;
+    const int* nanosecond = columns->nanosecond;
+    const __m512i zero_year = _mm512_set1_epi64(NT_ZERO_YEAR);
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_slli_epi64(_mm512_sub_epi64(avx512_load_32_as_64(year + i), zero_year), NT_SHIFT_YEAR);
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(month + i), NT_SHIFT_MONTH));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(day + i), NT_SHIFT_DAY));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(hour + i), NT_SHIFT_HOUR));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(minute + i), NT_SHIFT_MINUTE));
+        v = _mm512_or_si512(v, _mm512_slli_epi64(avx512_load_32_as_64(second + i), NT_SHIFT_SECOND));
+        v = _mm512_or_si512(v, avx512_load_32_as_64(nanosecond + i));
+        _mm512_storeu_si512(values + i, v);
+    }
+    nanotime_encode_range(columns, values, i, count);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+void smalltime_batch_decode(const smalltime* values, size_t count, const smalltime_columns* columns)
+{
+    smalltime_kernels.smalltime_batch_decode(values, count, columns);
+}
+
+void smalltime_batch_encode(const smalltime_columns* columns, size_t count, smalltime* values)
+{
+    smalltime_kernels.smalltime_batch_encode(columns, count, values);
+}
+
+void nanotime_batch_decode(const nanotime* values, size_t count, const nanotime_columns* columns)
+{
+    smalltime_kernels.nanotime_batch_decode(values, count, columns);
+}
+
+void nanotime_batch_encode(const nanotime_columns* columns, size_t count, nanotime* values)
+{
+    smalltime_kernels.nanotime_batch_encode(columns, count, values);
+}
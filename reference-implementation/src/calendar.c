@@ -0,0 +1,224 @@
+#include "kernels.h"
+#include <smalltime/calendar.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+// Fields of a value's date, from its layout.
+static inline int calendar_year(uint64_t value, const smalltime_calendar_layout* layout)
+{
+    return (int)((int64_t)((value ^ layout->flip) >> layout->year_shift) + layout->year_offset - SMALLTIME_CIVIL_YEAR_SHIFT);
+}
+
+static inline int calendar_month(uint64_t value, const smalltime_calendar_layout* layout)
+{
+    return (int)((value >> layout->month_shift) & 0xf);
+}
+
+static inline int calendar_day(uint64_t value, const smalltime_calendar_layout* layout)
+{
+    return (int)((value >> layout->day_shift) & 0x1f);
+}
+
+// Time columns are usually clustered in time, so the fields are only
+// worked out again when a value's date differs from the one before it.
+static inline void calendar_range(const uint64_t* values, const smalltime_calendar_layout* layout,
+                                  const smalltime_calendar_columns* columns, size_t begin, size_t end)
+{
+    const uint64_t date_mask = ~(uint64_t)0 << layout->day_shift;
+    uint64_t date = 0;
+    int weekday = 0;
+    int day_of_year = 0;
+    int iso_week = 0;
+    int iso_week_year = 0;
+    for(size_t i = begin; i < end; i++)
+    {
+        if(i == begin || (values[i] & date_mask) != date)
+        {
+            date = values[i] & date_mask;
+            int year = calendar_year(date, layout);
+            day_of_year = smalltime_calendar_day_of_year(year, calendar_month(date, layout), calendar_day(date, layout));
+            weekday = smalltime_calendar_weekday(year, day_of_year);
+            iso_week = smalltime_calendar_iso_week(year, day_of_year, weekday, &iso_week_year);
+        }
+        if(columns->weekday != NULL) columns->weekday[i] = weekday;
+        if(columns->day_of_year != NULL) columns->day_of_year[i] = day_of_year;
+        if(columns->iso_week != NULL) columns->iso_week[i] = iso_week;
+        if(columns->iso_week_year != NULL) columns->iso_week_year[i] = iso_week_year;
+    }
+}
+
+void smalltime_batch_calendar_scalar(const uint64_t* values, size_t count, const smalltime_calendar_layout* layout, const smalltime_calendar_columns* columns)
+{
+    calendar_range(values, layout, columns, 0, count);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+// Runs the closed forms from calendar.h on 8 values at a time in 64-bit
+// lanes. Every intermediate fits in 32 bits, so the divisions are done
+// with vpmuludq multiply-shift pairs (magic numbers verified over the full
+// input range), and the leap year tests share a single division by 100.
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_mul32(__m512i a, uint32_t b)
+{
+    return _mm512_mul_epu32(a, _mm512_set1_epi64(b));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __mmask8 avx512_is_zero(__m512i v)
+{
+    return _mm512_cmpeq_epi64_mask(v, _mm512_setzero_si512());
+}
+
+SMALLTIME_TARGET_AVX512
+static inline void avx512_calendar(__m512i v, const smalltime_calendar_layout* layout,
+                                   __m512i* weekday, __m512i* day_of_year, __m512i* iso_week, __m512i* iso_week_year)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i three = _mm512_set1_epi64(3);
+    const __m512i seven = _mm512_set1_epi64(7);
+
+    // Years shifted forward by SMALLTIME_CIVIL_YEAR_SHIFT.
+    __m512i y = _mm512_srli_epi64(_mm512_xor_si512(v, _mm512_set1_epi64((long long)layout->flip)), layout->year_shift);
+    y = _mm512_add_epi64(y, _mm512_set1_epi64(layout->year_offset));
+    __m512i month = _mm512_and_si512(_mm512_srli_epi64(v, layout->month_shift), _mm512_set1_epi64(0xf));
+    __m512i day = _mm512_and_si512(_mm512_srli_epi64(v, layout->day_shift), _mm512_set1_epi64(0x1f));
+
+    // Leap years, of this year and the one before. The year before is
+    // q * 100 + r, so this year is a multiple of 100 when r is 99.
+    __m512i before = _mm512_sub_epi64(y, one);
+    __m512i q = _mm512_srli_epi64(avx512_mul32(before, 335545), 25);
+    __m512i r = _mm512_sub_epi64(before, avx512_mul32(q, 100));
+    __mmask8 leap_before = avx512_is_zero(_mm512_and_si512(before, three)) &
+                           (_mm512_cmpneq_epi64_mask(r, _mm512_setzero_si512()) |
+                            avx512_is_zero(_mm512_and_si512(q, three)));
+    __mmask8 leap = avx512_is_zero(_mm512_and_si512(y, three)) &
+                    (_mm512_cmpneq_epi64_mask(r, _mm512_set1_epi64(99)) |
+                     avx512_is_zero(_mm512_and_si512(_mm512_add_epi64(q, one), three)));
+
+    __m512i doy = _mm512_sub_epi64(avx512_mul32(month, 367), _mm512_set1_epi64(362));
+    doy = _mm512_add_epi64(_mm512_srli_epi64(avx512_mul32(doy, 2731), 15), day);
+    __mmask8 after_february = _mm512_cmpgt_epu64_mask(month, _mm512_set1_epi64(2));
+    doy = _mm512_mask_sub_epi64(doy, after_february, doy, _mm512_set1_epi64(2));
+    doy = _mm512_mask_add_epi64(doy, after_february & leap, doy, one);
+
+    __m512i x = _mm512_add_epi64(y, _mm512_srli_epi64(before, 2));
+    x = _mm512_add_epi64(_mm512_sub_epi64(x, q), _mm512_srli_epi64(q, 2));
+    x = _mm512_add_epi64(x, _mm512_add_epi64(doy, _mm512_set1_epi64(5)));
+    __m512i wd = _mm512_sub_epi64(x, avx512_mul32(_mm512_srli_epi64(avx512_mul32(x, 599187), 22), 7));
+    wd = _mm512_add_epi64(wd, one);
+
+    __m512i week = _mm512_add_epi64(_mm512_sub_epi64(doy, wd), _mm512_set1_epi64(10));
+    week = _mm512_srli_epi64(avx512_mul32(week, 293), 11);
+    __m512i year = _mm512_sub_epi64(y, _mm512_set1_epi64(SMALLTIME_CIVIL_YEAR_SHIFT));
+    __m512i week_year = year;
+
+    // Week 0 is the last week of the year before, which is week 53 if that
+    // year ended on a Thursday, or on a Friday in a leap year.
+    __mmask8 in_year_before = avx512_is_zero(week);
+    if(in_year_before != 0)
+    {
+        __m512i last_weekday = _mm512_add_epi64(_mm512_sub_epi64(wd, doy), seven);
+        last_weekday = _mm512_mask_sub_epi64(last_weekday, _mm512_cmpge_epi64_mask(last_weekday, seven), last_weekday, seven);
+        __mmask8 long_year = _mm512_cmpeq_epi64_mask(last_weekday, _mm512_set1_epi64(4)) |
+                             (_mm512_cmpeq_epi64_mask(last_weekday, _mm512_set1_epi64(5)) & leap_before);
+        week = _mm512_mask_mov_epi64(week, in_year_before, _mm512_set1_epi64(52));
+        week = _mm512_mask_add_epi64(week, in_year_before & long_year, week, one);
+        week_year = _mm512_mask_sub_epi64(week_year, in_year_before, week_year, one);
+    }
+
+    // Week 53 is week 1 of the next year unless this year ends on a
+    // Thursday or later.
+    __mmask8 in_year_after = _mm512_cmpeq_epi64_mask(week, _mm512_set1_epi64(53));
+    if(in_year_after != 0)
+    {
+        __m512i days_left = _mm512_sub_epi64(_mm512_add_epi64(wd, _mm512_set1_epi64(365)), doy);
+        days_left = _mm512_mask_add_epi64(days_left, leap, days_left, one);
+        in_year_after &= _mm512_cmplt_epi64_mask(days_left, _mm512_set1_epi64(4));
+        week = _mm512_mask_mov_epi64(week, in_year_after, one);
+        week_year = _mm512_mask_add_epi64(week_year, in_year_after, week_year, one);
+    }
+
+    *weekday = wd;
+    *day_of_year = doy;
+    *iso_week = week;
+    *iso_week_year = week_year;
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_calendar_avx512(const uint64_t* values, size_t count, const smalltime_calendar_layout* layout, const smalltime_calendar_columns* columns)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i weekday, day_of_year, iso_week, iso_week_year;
+        avx512_calendar(_mm512_loadu_si512(values + i), layout, &weekday, &day_of_year, &iso_week, &iso_week_year);
+        if(columns->weekday != NULL)
+        {
+            _mm256_storeu_si256((__m256i*)(columns->weekday + i), _mm512_cvtepi64_epi32(weekday));
+        }
+        if(columns->day_of_year != NULL)
+        {
+            _mm256_storeu_si256((__m256i*)(columns->day_of_year + i), _mm512_cvtepi64_epi32(day_of_year));
+        }
+        if(columns->iso_week != NULL)
+        {
+            _mm256_storeu_si256((__m256i*)(columns->iso_week + i), _mm512_cvtepi64_epi32(iso_week));
+        }
+        if(columns->iso_week_year != NULL)
+        {
+            _mm256_storeu_si256((__m256i*)(columns->iso_week_year + i), _mm512_cvtepi64_epi32(iso_week_year));
+        }
+    }
+    calendar_range(values, layout, columns, i, count);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+// The flip makes the signed smalltime year count up from 0 as an unsigned
+// field, so that both types shift their years the same way.
+static const smalltime_calendar_layout smalltime_layout =
+{
+    0x8000000000000000ULL,
+    ST_SHIFT_YEAR,
+    SMALLTIME_CIVIL_YEAR_SHIFT + ST_MIN_YEAR,
+    ST_SHIFT_MONTH,
+    ST_SHIFT_DAY,
+};
+
+static const smalltime_calendar_layout nanotime_layout =
+{
+    0,
+    NT_SHIFT_YEAR,
+    SMALLTIME_CIVIL_YEAR_SHIFT + NT_ZERO_YEAR,
+    NT_SHIFT_MONTH,
+    NT_SHIFT_DAY,
+};
+
+void smalltime_batch_calendar(const smalltime* values, size_t count, const smalltime_calendar_columns* columns)
+{
+    smalltime_kernels.smalltime_batch_calendar((const uint64_t*)values, count, &smalltime_layout, columns);
+}
+
+void nanotime_batch_calendar(const nanotime* values, size_t count, const smalltime_calendar_columns* columns)
+{
+    smalltime_kernels.smalltime_batch_calendar(values, count, &nanotime_layout, columns);
+}
@@ -0,0 +1,141 @@
+// For clock_gettime() and CLOCK_REALTIME_COARSE when building in a strict
+// C mode.
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif
+
+#include <smalltime/clock.h>
+#include <smalltime/epoch.h>
+#include "layout.h"
+#include <time.h>
+
+
+// ==================================================================
+// Clock
+// ==================================================================
+
+#if defined(_WIN32)
+    #define SMALLTIME_THREAD_LOCAL __declspec(thread)
+#else
+    #define SMALLTIME_THREAD_LOCAL _Thread_local
+#endif
+
+typedef enum
+{
+    CLOCK_SOURCE_PRECISE,
+    CLOCK_SOURCE_COARSE,
+} clock_source;
+
+static inline void read_clock(clock_source source, struct timespec* now)
+{
+#if defined(_WIN32)
+    (void)source;
+    timespec_get(now, TIME_UTC);
+#elif defined(CLOCK_REALTIME_COARSE)
+    clock_gettime(source == CLOCK_SOURCE_COARSE ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME, now);
+#else
+    (void)source;
+    clock_gettime(CLOCK_REALTIME, now);
+#endif
+}
+
+
+// ==================================================================
+// Hour cache
+// ==================================================================
+
+typedef struct
+{
+    // Unix seconds at the start of the cached hour.
+    int64_t start;
+    // The year, month, day and hour fields of that hour.
+    uint64_t smalltime_fields;
+    uint64_t nanotime_fields;
+} hour_cache;
+
+// Starts out as far as possible from any real clock reading, so the first
+// lookup always misses.
+static SMALLTIME_THREAD_LOCAL hour_cache g_hour_cache = {INT64_MIN, 0, 0};
+
+static const hour_cache* rebuild_hour_cache(int64_t seconds)
+{
+    int64_t into_hour = seconds % 3600;
+    if(into_hour < 0)
+    {
+        into_hour += 3600;
+    }
+    hour_cache* cache = &g_hour_cache;
+    cache->start = seconds - into_hour;
+    cache->smalltime_fields = (uint64_t)smalltime_from_unix_seconds(cache->start);
+    cache->nanotime_fields = nanotime_from_unix_seconds(cache->start);
+    return cache;
+}
+
+// Returns the cache for the hour containing seconds, and the seconds into
+// that hour.
+static inline const hour_cache* lookup_hour(int64_t seconds, unsigned* into_hour)
+{
+    const hour_cache* cache = &g_hour_cache;
+    // Unsigned, so that readings before the start of the hour also miss.
+    uint64_t offset = (uint64_t)seconds - (uint64_t)cache->start;
+    if(offset >= 3600)
+    {
+        cache = rebuild_hour_cache(seconds);
+        offset = (uint64_t)(seconds - cache->start);
+    }
+    *into_hour = (unsigned)offset;
+    return cache;
+}
+
+static inline smalltime smalltime_read(clock_source source)
+{
+    struct timespec now;
+    read_clock(source, &now);
+    unsigned into_hour;
+    const hour_cache* cache = lookup_hour((int64_t)now.tv_sec, &into_hour);
+    unsigned minute = into_hour / 60;
+    unsigned second = into_hour - minute * 60;
+    return (smalltime)(cache->smalltime_fields |
+                       (uint64_t)minute << ST_SHIFT_MINUTE |
+                       (uint64_t)second << ST_SHIFT_SECOND |
+                       (uint64_t)now.tv_nsec / 1000);
+}
+
+static inline nanotime nanotime_read(clock_source source)
+{
+    struct timespec now;
+    read_clock(source, &now);
+    unsigned into_hour;
+    const hour_cache* cache = lookup_hour((int64_t)now.tv_sec, &into_hour);
+    unsigned minute = into_hour / 60;
+    unsigned second = into_hour - minute * 60;
+    return cache->nanotime_fields |
+           (uint64_t)minute << NT_SHIFT_MINUTE |
+           (uint64_t)second << NT_SHIFT_SECOND |
+           (uint64_t)now.tv_nsec;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+smalltime smalltime_now(void)
+{
+    return smalltime_read(CLOCK_SOURCE_PRECISE);
+}
+
+nanotime nanotime_now(void)
+{
+    return nanotime_read(CLOCK_SOURCE_PRECISE);
+}
+
+smalltime smalltime_now_coarse(void)
+{
+    return smalltime_read(CLOCK_SOURCE_COARSE);
+}
+
+nanotime nanotime_now_coarse(void)
+{
+    return nanotime_read(CLOCK_SOURCE_COARSE);
+}
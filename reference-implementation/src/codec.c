@@ -0,0 +1,575 @@
+#include "kernels.h"
+#include <smalltime/codec.h>
+#include <string.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+enum
+{
+    BLOCK_PACKED = 0,
+    BLOCK_RAW = 1,
+};
+
+// Kind and count.
+#define BLOCK_HEADER_SIZE 2
+// The first value and the two widths.
+#define PACKED_HEADER_SIZE 10
+// Packed values are read with 8-byte loads, which leaves 56 bits after
+// the bit offset within the first byte.
+#define MAX_WIDTH 56
+#define MAX_VARINT_SIZE 10
+
+static inline uint64_t load_le64(const uint8_t* src)
+{
+    uint64_t value;
+    memcpy(&value, src, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static inline void store_le64(uint8_t* dst, uint64_t value)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    memcpy(dst, &value, sizeof(value));
+}
+
+static inline uint64_t width_mask(int width)
+{
+    return width == 0 ? 0 : ~0ULL >> (64 - width);
+}
+
+static inline int bit_width(uint64_t value)
+{
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+// Bytes taken by count packed values, including the padding after the
+// last stream.
+static inline size_t stream_size(size_t count, int width)
+{
+    return (count * (size_t)width + 7) / 8;
+}
+
+static inline size_t padded_stream_size(size_t count, int width)
+{
+    size_t size = stream_size(count, width);
+    size_t readable = count == 0 ? 0 : (count - 1) * (size_t)width / 8 + 8;
+    return size > readable ? size : readable;
+}
+
+static inline uint64_t unpack(const uint8_t* bits, size_t index, int width)
+{
+    size_t bit = index * (size_t)width;
+    return (load_le64(bits + bit / 8) >> (bit % 8)) & width_mask(width);
+}
+
+// The hour key is signed, so that it can be shifted back into place.
+static inline int64_t hour_key(uint64_t value, const smalltime_codec_layout* layout)
+{
+    return (int64_t)value >> layout->hour_shift;
+}
+
+static inline uint64_t time_key(uint64_t value, const smalltime_codec_layout* layout, uint64_t fractions_per_second)
+{
+    uint64_t minute = (value >> layout->minute_shift) & 0x3f;
+    uint64_t second = (value >> layout->second_shift) & 0x3f;
+    return (minute * 60 + second) * fractions_per_second + (value & layout->fraction_mask);
+}
+
+static inline int has_time_key(uint64_t value, const smalltime_codec_layout* layout)
+{
+    return ((value >> layout->minute_shift) & 0x3f) < 60 &&
+           ((value >> layout->second_shift) & 0x3f) < 60 &&
+           (value & layout->fraction_mask) < layout->fractions_per_second;
+}
+
+static inline uint64_t from_keys(int64_t hour, uint64_t time, const smalltime_codec_layout* layout, uint64_t fractions_per_second)
+{
+    uint64_t minute = time / (fractions_per_second * 60);
+    time -= minute * fractions_per_second * 60;
+    uint64_t second = time / fractions_per_second;
+    return (uint64_t)hour << layout->hour_shift |
+           minute << layout->minute_shift |
+           second << layout->second_shift |
+           (time - second * fractions_per_second);
+}
+
+static inline uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static inline size_t varint_size(uint64_t value)
+{
+    size_t size = 1;
+    for(; value >= 0x80; value >>= 7)
+    {
+        size++;
+    }
+    return size;
+}
+
+static inline uint8_t* write_varint(uint8_t* dst, uint64_t value)
+{
+    for(; value >= 0x80; value >>= 7)
+    {
+        *dst++ = (uint8_t)(value | 0x80);
+    }
+    *dst++ = (uint8_t)value;
+    return dst;
+}
+
+// Returns NULL if the varint is malformed or runs past end.
+static inline const uint8_t* read_varint(const uint8_t* src, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for(int shift = 0; src < end && shift < MAX_VARINT_SIZE * 7; shift += 7)
+    {
+        uint8_t byte = *src++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if(byte < 0x80)
+        {
+            return src;
+        }
+    }
+    return NULL;
+}
+
+static uint8_t* pack(uint8_t* dst, const uint64_t* values, size_t count, int width)
+{
+    uint64_t pending = 0;
+    int pending_bits = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        pending |= values[i] << pending_bits;
+        pending_bits += width;
+        for(; pending_bits >= 8; pending_bits -= 8)
+        {
+            *dst++ = (uint8_t)pending;
+            pending >>= 8;
+        }
+    }
+    if(pending_bits > 0)
+    {
+        *dst++ = (uint8_t)pending;
+    }
+    return dst;
+}
+
+static size_t encode_block(const uint64_t* values, size_t count, const smalltime_codec_layout* layout, uint8_t* buffer)
+{
+    size_t raw_size = BLOCK_HEADER_SIZE + count * 8;
+    buffer[1] = (uint8_t)(count - 1);
+
+    int is_packable = 1;
+    for(size_t i = 0; i < count; i++)
+    {
+        is_packable &= has_time_key(values[i], layout);
+    }
+
+    if(is_packable)
+    {
+        uint64_t fractions_per_second = layout->fractions_per_second;
+        uint64_t hours[SMALLTIME_CODEC_BLOCK_LENGTH];
+        uint64_t times[SMALLTIME_CODEC_BLOCK_LENGTH];
+        int64_t first_hour = hour_key(values[0], layout);
+        int64_t min_hour = first_hour;
+        int64_t max_hour = first_hour;
+        int64_t min_time = INT64_MAX;
+        int64_t max_time = INT64_MIN;
+        int64_t previous_hour = first_hour;
+        uint64_t previous_time = time_key(values[0], layout, fractions_per_second);
+        for(size_t i = 1; i < count; i++)
+        {
+            int64_t hour = hour_key(values[i], layout);
+            uint64_t time = time_key(values[i], layout, fractions_per_second);
+            int64_t difference = (int64_t)(time - (hour == previous_hour ? previous_time : 0));
+            hours[i - 1] = (uint64_t)hour;
+            times[i - 1] = (uint64_t)difference;
+            min_hour = hour < min_hour ? hour : min_hour;
+            max_hour = hour > max_hour ? hour : max_hour;
+            min_time = difference < min_time ? difference : min_time;
+            max_time = difference > max_time ? difference : max_time;
+            previous_hour = hour;
+            previous_time = time;
+        }
+        if(count == 1)
+        {
+            min_time = max_time = 0;
+        }
+
+        int hour_width = bit_width((uint64_t)max_hour - (uint64_t)min_hour);
+        int time_width = bit_width((uint64_t)max_time - (uint64_t)min_time);
+        uint64_t hour_offset = (uint64_t)first_hour - (uint64_t)min_hour;
+        uint64_t time_base = zigzag_encode(min_time);
+        size_t packed_size = BLOCK_HEADER_SIZE + PACKED_HEADER_SIZE +
+                             varint_size(hour_offset) + varint_size(time_base) +
+                             stream_size(count - 1, hour_width) + padded_stream_size(count - 1, time_width);
+        if(packed_size < raw_size)
+        {
+            for(size_t i = 0; i < count - 1; i++)
+            {
+                hours[i] -= (uint64_t)min_hour;
+                times[i] -= (uint64_t)min_time;
+            }
+            buffer[0] = BLOCK_PACKED;
+            store_le64(buffer + BLOCK_HEADER_SIZE, values[0]);
+            buffer[BLOCK_HEADER_SIZE + 8] = (uint8_t)hour_width;
+            buffer[BLOCK_HEADER_SIZE + 9] = (uint8_t)time_width;
+            uint8_t* dst = buffer + BLOCK_HEADER_SIZE + PACKED_HEADER_SIZE;
+            dst = write_varint(dst, hour_offset);
+            dst = write_varint(dst, time_base);
+            dst = pack(dst, hours, count - 1, hour_width);
+            uint8_t* end = pack(dst, times, count - 1, time_width);
+            size_t padding = padded_stream_size(count - 1, time_width) - (size_t)(end - dst);
+            memset(end, 0, padding);
+            return packed_size;
+        }
+    }
+
+    buffer[0] = BLOCK_RAW;
+    for(size_t i = 0; i < count; i++)
+    {
+        store_le64(buffer + BLOCK_HEADER_SIZE + i * 8, values[i]);
+    }
+    return raw_size;
+}
+
+// Returns the size of the block, or 0 if it's corrupt or truncated.
+static size_t decode_block(const uint8_t* data, size_t size, const smalltime_codec_layout* layout, uint64_t* values)
+{
+    size_t count = (size_t)data[1] + 1;
+    if(data[0] == BLOCK_RAW)
+    {
+        size_t block_size = BLOCK_HEADER_SIZE + count * 8;
+        if(block_size > size)
+        {
+            return 0;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            values[i] = load_le64(data + BLOCK_HEADER_SIZE + i * 8);
+        }
+        return block_size;
+    }
+    if(data[0] != BLOCK_PACKED || size < BLOCK_HEADER_SIZE + PACKED_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    smalltime_codec_block block;
+    values[0] = load_le64(data + BLOCK_HEADER_SIZE);
+    block.hour_width = data[BLOCK_HEADER_SIZE + 8];
+    block.time_width = data[BLOCK_HEADER_SIZE + 9];
+    block.count = count;
+    if(block.hour_width > MAX_WIDTH || block.time_width > MAX_WIDTH)
+    {
+        return 0;
+    }
+
+    const uint8_t* end = data + size;
+    uint64_t hour_offset;
+    uint64_t time_base;
+    const uint8_t* src = read_varint(data + BLOCK_HEADER_SIZE + PACKED_HEADER_SIZE, end, &hour_offset);
+    if(src == NULL || (src = read_varint(src, end, &time_base)) == NULL)
+    {
+        return 0;
+    }
+    block.hour_base = (int64_t)((uint64_t)hour_key(values[0], layout) - hour_offset);
+    block.time_base = zigzag_decode(time_base);
+    block.hour_bits = src;
+    block.time_bits = src + stream_size(count - 1, block.hour_width);
+    size_t block_size = (size_t)(block.time_bits - data) + padded_stream_size(count - 1, block.time_width);
+    if(block_size > size)
+    {
+        return 0;
+    }
+    smalltime_kernels.smalltime_codec_decode_block(&block, layout, values);
+    return block_size;
+}
+
+static size_t encode_column(const uint64_t* values, size_t count, const smalltime_codec_layout* layout, uint8_t* buffer)
+{
+    uint8_t* dst = buffer;
+    for(size_t i = 0; i < count; i += SMALLTIME_CODEC_BLOCK_LENGTH)
+    {
+        size_t length = count - i < SMALLTIME_CODEC_BLOCK_LENGTH ? count - i : SMALLTIME_CODEC_BLOCK_LENGTH;
+        dst += encode_block(values + i, length, layout, dst);
+    }
+    return (size_t)(dst - buffer);
+}
+
+static size_t decode_column(const uint8_t* data, size_t size, const smalltime_codec_layout* layout,
+                            uint64_t* values, size_t capacity, size_t* end_offset)
+{
+    size_t offset = 0;
+    size_t count = 0;
+    while(size - offset >= BLOCK_HEADER_SIZE)
+    {
+        if((size_t)data[offset + 1] + 1 > capacity - count)
+        {
+            break;
+        }
+        size_t block_size = decode_block(data + offset, size - offset, layout, values + count);
+        if(block_size == 0)
+        {
+            break;
+        }
+        count += (size_t)data[offset + 1] + 1;
+        offset += block_size;
+    }
+    if(end_offset != NULL)
+    {
+        *end_offset = offset;
+    }
+    return count;
+}
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+static inline void scalar_decode_block(const smalltime_codec_block* block, const smalltime_codec_layout* layout,
+                                       uint64_t fractions_per_second, uint64_t* values)
+{
+    int64_t hour = hour_key(values[0], layout);
+    uint64_t time = time_key(values[0], layout, fractions_per_second);
+    for(size_t i = 1; i < block->count; i++)
+    {
+        int64_t next_hour = (int64_t)((uint64_t)block->hour_base + unpack(block->hour_bits, i - 1, block->hour_width));
+        uint64_t difference = (uint64_t)block->time_base + unpack(block->time_bits, i - 1, block->time_width);
+        time = (next_hour == hour ? time : 0) + difference;
+        hour = next_hour;
+        values[i] = from_keys(hour, time, layout, fractions_per_second);
+    }
+}
+
+void smalltime_codec_decode_block_scalar(const smalltime_codec_block* block, const smalltime_codec_layout* layout, uint64_t* values)
+{
+    // Constant divisors, so that the compiler can use multiplications.
+    if(layout->fractions_per_second == 1000000)
+    {
+        scalar_decode_block(block, layout, 1000000, values);
+    }
+    else
+    {
+        scalar_decode_block(block, layout, 1000000000, values);
+    }
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+// Eight values at a time: unpack the bits, restore the time keys with a
+// prefix sum that restarts wherever the hour changes, then split the time
+// keys into fields.
+//
+// Eight values of a stream take exactly width bytes, so every group starts
+// on a byte boundary, and where each lane's bits are within the group's
+// bytes is the same for the whole block.
+
+// A packed stream, with the per-lane constants for unpacking it.
+typedef struct
+{
+    const uint8_t* bits;
+    size_t width;
+    __mmask64 group_bytes;
+    // The word of the group holding each lane's first bit, and the next one.
+    __m512i low_word;
+    __m512i high_word;
+    __m512i low_shift;
+    __m512i high_shift;
+    __m512i mask;
+} avx512_stream;
+
+SMALLTIME_TARGET_AVX512
+static inline avx512_stream avx512_stream_new(const uint8_t* bits, int width)
+{
+    avx512_stream stream;
+    __m512i lane_bits = _mm512_mullo_epi64(_mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_epi64(width));
+    __m512i low_shift = _mm512_and_si512(lane_bits, _mm512_set1_epi64(63));
+    stream.bits = bits;
+    stream.width = (size_t)width;
+    stream.group_bytes = width == 0 ? 0 : ~0ULL >> (64 - width);
+    stream.low_word = _mm512_srli_epi64(lane_bits, 6);
+    stream.high_word = _mm512_add_epi64(stream.low_word, _mm512_set1_epi64(1));
+    stream.low_shift = low_shift;
+    // A shift of 64 gives 0, for values that fit in one word.
+    stream.high_shift = _mm512_sub_epi64(_mm512_set1_epi64(64), low_shift);
+    stream.mask = _mm512_set1_epi64((int64_t)width_mask(width));
+    return stream;
+}
+
+// Unpacks the group starting at value first, loading only the bytes that
+// the group's first lanes values are in.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_unpack(const avx512_stream* stream, size_t first, size_t lanes)
+{
+    __mmask64 load = lanes == 8 ? stream->group_bytes : stream->group_bytes >> (stream->width - (lanes * stream->width + 7) / 8);
+    __m512i words = _mm512_maskz_loadu_epi8(load, stream->bits + first * stream->width / 8);
+    __m512i low = _mm512_srlv_epi64(_mm512_permutexvar_epi64(stream->low_word, words), stream->low_shift);
+    __m512i high = _mm512_sllv_epi64(_mm512_permutexvar_epi64(stream->high_word, words), stream->high_shift);
+    return _mm512_and_si512(_mm512_or_si512(low, high), stream->mask);
+}
+
+// Adds up the differences of a group, restarting at the lanes in restart,
+// and adds the last time key of the previous group to the lanes before
+// the first restart.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_prefix_sum(__m512i times, __mmask8 restart, __m512i* previous_time)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    times = _mm512_mask_add_epi64(times, (__mmask8)~restart, times, _mm512_alignr_epi64(times, zero, 7));
+    restart |= (__mmask8)(restart << 1);
+    times = _mm512_mask_add_epi64(times, (__mmask8)~restart, times, _mm512_alignr_epi64(times, zero, 6));
+    restart |= (__mmask8)(restart << 2);
+    times = _mm512_mask_add_epi64(times, (__mmask8)~restart, times, _mm512_alignr_epi64(times, zero, 4));
+    restart |= (__mmask8)(restart << 4);
+    times = _mm512_mask_add_epi64(times, (__mmask8)~restart, times, *previous_time);
+    *previous_time = _mm512_permutexvar_epi64(_mm512_set1_epi64(7), times);
+    return times;
+}
+
+// Multiplies lanes below 2^32 by a constant below 2^32.
+#define MULTIPLY(X, CONSTANT) _mm512_mul_epu32(X, _mm512_set1_epi64(CONSTANT))
+
+// Puts the minute, second and fraction fields of the time keys in place.
+// Smalltime time keys are below 2^32, so they're split with exact integer
+// multiplications. Nanotime time keys are first split into seconds and
+// fraction in double precision (exact for time keys, which are well below
+// 2^53): (key + 0.5) / 10^9 is far enough from the next integer to survive
+// the rounding of the reciprocal.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_split_time(__m512i times, const smalltime_codec_layout* layout, int is_microseconds)
+{
+    __m512i seconds;
+    __m512i fractions;
+    if(is_microseconds)
+    {
+        // key / 10^6 for keys below 2^32.
+        seconds = _mm512_srli_epi64(MULTIPLY(times, 1125899907), 50);
+        fractions = _mm512_sub_epi64(times, MULTIPLY(seconds, 1000000));
+    }
+    else
+    {
+        __m512d dividend = _mm512_cvtepu64_pd(times);
+        __m512d quotient = _mm512_fmadd_pd(dividend, _mm512_set1_pd(1e-9), _mm512_set1_pd(0.5e-9));
+        quotient = _mm512_roundscale_pd(quotient, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        seconds = _mm512_cvttpd_epu64(quotient);
+        fractions = _mm512_cvttpd_epu64(_mm512_fnmadd_pd(quotient, _mm512_set1_pd(1e9), dividend));
+    }
+    // seconds / 60 for seconds below 2^14.
+    __m512i minutes = _mm512_srli_epi64(MULTIPLY(seconds, 17477), 20);
+    seconds = _mm512_sub_epi64(seconds, MULTIPLY(minutes, 60));
+    __m512i result = _mm512_or_si512(_mm512_slli_epi64(minutes, (unsigned)layout->minute_shift),
+                                     _mm512_slli_epi64(seconds, (unsigned)layout->second_shift));
+    return _mm512_or_si512(result, fractions);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline void avx512_decode_block(const smalltime_codec_block* block, const smalltime_codec_layout* layout,
+                                       int is_microseconds, uint64_t* values)
+{
+    size_t packed = block->count - 1;
+    int64_t first_hour = hour_key(values[0], layout);
+    __m512i hours = _mm512_set1_epi64(block->hour_base);
+    __m512i previous_hours = _mm512_set1_epi64(first_hour);
+    // Without an hour stream, every packed value has the hour base, so the
+    // only possible restart is at the first one, and it's made by starting
+    // from a time key of 0.
+    __m512i previous_time = _mm512_set1_epi64(block->hour_width == 0 && block->hour_base != first_hour ? 0 :
+                                              (int64_t)time_key(values[0], layout, layout->fractions_per_second));
+    __m512i hour_bits = _mm512_slli_epi64(hours, (unsigned)layout->hour_shift);
+    avx512_stream hour_stream = avx512_stream_new(block->hour_bits, block->hour_width);
+    avx512_stream time_stream = avx512_stream_new(block->time_bits, block->time_width);
+    __m512i time_base = _mm512_set1_epi64(block->time_base);
+    for(size_t i = 0; i < packed; i += 8)
+    {
+        size_t lanes = packed - i < 8 ? packed - i : 8;
+        __m512i times = _mm512_add_epi64(time_base, avx512_unpack(&time_stream, i, lanes));
+        __mmask8 restart = 0;
+        if(block->hour_width != 0)
+        {
+            hours = _mm512_add_epi64(_mm512_set1_epi64(block->hour_base), avx512_unpack(&hour_stream, i, lanes));
+            // Lanes where the hour changes start a new segment.
+            restart = _mm512_cmpneq_epi64_mask(hours, _mm512_alignr_epi64(hours, previous_hours, 7));
+            previous_hours = hours;
+            hour_bits = _mm512_slli_epi64(hours, (unsigned)layout->hour_shift);
+        }
+        times = avx512_prefix_sum(times, restart, &previous_time);
+        __m512i result = _mm512_or_si512(hour_bits, avx512_split_time(times, layout, is_microseconds));
+        _mm512_mask_storeu_epi64((void*)(values + 1 + i), (__mmask8)(0xff >> (8 - lanes)), result);
+    }
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_codec_decode_block_avx512(const smalltime_codec_block* block, const smalltime_codec_layout* layout, uint64_t* values)
+{
+    // Constant paths, as in the scalar variant.
+    if(layout->fractions_per_second == 1000000)
+    {
+        avx512_decode_block(block, layout, 1, values);
+    }
+    else
+    {
+        avx512_decode_block(block, layout, 0, values);
+    }
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+static const smalltime_codec_layout smalltime_layout =
+{
+    ST_SHIFT_HOUR, ST_SHIFT_MINUTE, ST_SHIFT_SECOND, ST_MASK_MICROSECOND, 1000000,
+};
+
+static const smalltime_codec_layout nanotime_layout =
+{
+    NT_SHIFT_HOUR, NT_SHIFT_MINUTE, NT_SHIFT_SECOND, NT_MASK_NANOSECOND, 1000000000,
+};
+
+size_t smalltime_codec_encode(const smalltime* values, size_t count, uint8_t* buffer)
+{
+    return encode_column((const uint64_t*)values, count, &smalltime_layout, buffer);
+}
+
+size_t nanotime_codec_encode(const nanotime* values, size_t count, uint8_t* buffer)
+{
+    return encode_column(values, count, &nanotime_layout, buffer);
+}
+
+size_t smalltime_codec_decode(const uint8_t* data, size_t size, smalltime* values, size_t capacity, size_t* end_offset)
+{
+    return decode_column(data, size, &smalltime_layout, (uint64_t*)values, capacity, end_offset);
+}
+
+size_t nanotime_codec_decode(const uint8_t* data, size_t size, nanotime* values, size_t capacity, size_t* end_offset)
+{
+    return decode_column(data, size, &nanotime_layout, values, capacity, end_offset);
+}
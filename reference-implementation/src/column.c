@@ -0,0 +1,648 @@
+// For mmap() and fstat() when building in a strict C mode.
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif
+
+#include <smalltime/column.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// All comparisons are done on keys, which order the same as the values
+// they came from: nanotime values as they are, and smalltime values with
+// the sign bit flipped so that they compare as unsigned.
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+#define FORMAT_VERSION 1
+#define BYTE_ORDER_MARK 0x01020304
+#define SORTED_FLAG 1
+#define BLOCKS_ORDERED_FLAG 1
+
+static const char file_magic[8] = {'S', 'T', 'C', 'O', 'L', 'U', 'M', 'N'};
+
+typedef enum
+{
+    KIND_SMALLTIME = 0,
+    KIND_NANOTIME = 1,
+} column_kind;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t kind;
+    uint32_t block_length;
+    uint64_t count;
+    uint64_t zone_map_offset;
+    uint64_t flags;
+    uint8_t reserved[16];
+} file_header;
+
+typedef struct
+{
+    uint64_t min;
+    uint64_t max;
+    uint64_t flags;
+} zone;
+
+static inline uint64_t key_flip(column_kind kind)
+{
+    return kind == KIND_SMALLTIME ? SMALLTIME_KEY_FLIP : NANOTIME_KEY_FLIP;
+}
+
+
+// ==================================================================
+// Writer
+// ==================================================================
+
+typedef struct
+{
+    FILE* file;
+    column_kind kind;
+    uint64_t flip;
+    size_t block_length;
+    uint64_t count;
+    int failed;
+
+    // The block being filled, as keys.
+    size_t block_fill;
+    uint64_t block_min;
+    uint64_t block_max;
+    int block_sorted;
+
+    uint64_t previous_key;
+    int blocks_ordered;
+
+    zone* zones;
+    size_t zone_count;
+    size_t zone_capacity;
+} column_writer;
+
+struct smalltime_column_writer
+{
+    column_writer writer;
+};
+
+struct nanotime_column_writer
+{
+    column_writer writer;
+};
+
+static int writer_init(column_writer* writer, const char* path, column_kind kind, size_t block_length)
+{
+    if(block_length == 0)
+    {
+        block_length = SMALLTIME_COLUMN_BLOCK_LENGTH;
+    }
+    if(block_length > UINT32_MAX)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->kind = kind;
+    writer->flip = key_flip(kind);
+    writer->block_length = block_length;
+    writer->blocks_ordered = 1;
+
+    writer->file = fopen(path, "wb");
+    if(writer->file == NULL)
+    {
+        return 0;
+    }
+
+    // The header is filled in on close.
+    static const file_header blank_header;
+    if(fwrite(&blank_header, sizeof(blank_header), 1, writer->file) != 1)
+    {
+        fclose(writer->file);
+        return 0;
+    }
+    return 1;
+}
+
+static int writer_end_block(column_writer* writer)
+{
+    if(writer->zone_count == writer->zone_capacity)
+    {
+        size_t capacity = writer->zone_capacity == 0 ? 64 : writer->zone_capacity * 2;
+        zone* zones = realloc(writer->zones, capacity * sizeof(*zones));
+        if(zones == NULL)
+        {
+            return 0;
+        }
+        writer->zones = zones;
+        writer->zone_capacity = capacity;
+    }
+
+    if(writer->zone_count > 0)
+    {
+        const zone* previous = &writer->zones[writer->zone_count - 1];
+        writer->blocks_ordered &= writer->block_min >= (previous->min ^ writer->flip) &&
+                                  writer->block_max >= (previous->max ^ writer->flip);
+    }
+
+    zone* entry = &writer->zones[writer->zone_count++];
+    entry->min = writer->block_min ^ writer->flip;
+    entry->max = writer->block_max ^ writer->flip;
+    entry->flags = writer->block_sorted ? SORTED_FLAG : 0;
+    writer->block_fill = 0;
+    return 1;
+}
+
+static int writer_append(column_writer* writer, const uint64_t* values, size_t count)
+{
+    if(writer->failed)
+    {
+        return 0;
+    }
+    if(fwrite(values, sizeof(*values), count, writer->file) != count)
+    {
+        writer->failed = 1;
+        return 0;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        uint64_t key = values[i] ^ writer->flip;
+        if(writer->block_fill == 0)
+        {
+            writer->block_min = key;
+            writer->block_max = key;
+            writer->block_sorted = 1;
+        }
+        else
+        {
+            writer->block_min = key < writer->block_min ? key : writer->block_min;
+            writer->block_max = key > writer->block_max ? key : writer->block_max;
+            writer->block_sorted &= key >= writer->previous_key;
+        }
+        writer->previous_key = key;
+
+        if(++writer->block_fill == writer->block_length && !writer_end_block(writer))
+        {
+            writer->failed = 1;
+            return 0;
+        }
+    }
+    writer->count += count;
+    return 1;
+}
+
+static int writer_close(column_writer* writer)
+{
+    int success = !writer->failed;
+    if(success && writer->block_fill > 0)
+    {
+        success = writer_end_block(writer);
+    }
+    if(success && writer->zone_count > 0)
+    {
+        success = fwrite(writer->zones, sizeof(*writer->zones), writer->zone_count, writer->file) == writer->zone_count;
+    }
+    if(success)
+    {
+        file_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, file_magic, sizeof(header.magic));
+        header.version = FORMAT_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.kind = writer->kind;
+        header.block_length = (uint32_t)writer->block_length;
+        header.count = writer->count;
+        header.zone_map_offset = sizeof(header) + writer->count * sizeof(uint64_t);
+        header.flags = writer->blocks_ordered ? BLOCKS_ORDERED_FLAG : 0;
+        success = fseek(writer->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    }
+    success &= fclose(writer->file) == 0;
+    free(writer->zones);
+    return success;
+}
+
+
+// ==================================================================
+// Reader
+// ==================================================================
+
+typedef struct
+{
+    const uint8_t* mapping;
+    size_t size;
+
+    uint64_t flip;
+    const uint64_t* values;
+    size_t count;
+    size_t block_length;
+    size_t block_count;
+    const zone* zones;
+    int blocks_ordered;
+} column_map;
+
+struct smalltime_column
+{
+    column_map column;
+};
+
+struct nanotime_column
+{
+    column_map column;
+};
+
+static const uint8_t* map_file(const char* path, size_t* size)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    const uint8_t* mapping = NULL;
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && (uint64_t)file_size.QuadPart <= SIZE_MAX)
+    {
+        // The view keeps the mapping alive after the handles are closed.
+        HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(map != NULL)
+        {
+            mapping = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(map);
+        }
+        *size = (size_t)file_size.QuadPart;
+    }
+    CloseHandle(file);
+    return mapping;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    const uint8_t* mapping = NULL;
+    if(fstat(fd, &info) == 0 && info.st_size > 0 && (uint64_t)info.st_size <= SIZE_MAX)
+    {
+        void* address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(address != MAP_FAILED)
+        {
+            mapping = address;
+            *size = (size_t)info.st_size;
+        }
+    }
+    close(fd);
+    return mapping;
+#endif
+}
+
+static void unmap_file(const uint8_t* mapping, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(mapping);
+#else
+    munmap((void*)mapping, size);
+#endif
+}
+
+static int column_init(column_map* column, const char* path, column_kind kind)
+{
+    memset(column, 0, sizeof(*column));
+    column->mapping = map_file(path, &column->size);
+    if(column->mapping == NULL)
+    {
+        return 0;
+    }
+
+    file_header header;
+    if(column->size < sizeof(header))
+    {
+        goto invalid;
+    }
+    memcpy(&header, column->mapping, sizeof(header));
+
+    size_t value_space = (column->size - sizeof(header)) / sizeof(uint64_t);
+    if(memcmp(header.magic, file_magic, sizeof(header.magic)) != 0 ||
+       header.version != FORMAT_VERSION ||
+       header.byte_order != BYTE_ORDER_MARK ||
+       header.kind != (uint32_t)kind ||
+       header.block_length == 0 ||
+       header.count > value_space ||
+       header.zone_map_offset != sizeof(header) + header.count * sizeof(uint64_t))
+    {
+        goto invalid;
+    }
+
+    column->flip = key_flip(kind);
+    column->values = (const uint64_t*)(column->mapping + sizeof(header));
+    column->count = (size_t)header.count;
+    column->block_length = header.block_length;
+    column->block_count = column->count / column->block_length + (column->count % column->block_length != 0);
+    column->zones = (const zone*)(column->mapping + header.zone_map_offset);
+    column->blocks_ordered = (header.flags & BLOCKS_ORDERED_FLAG) != 0;
+    if((column->size - header.zone_map_offset) / sizeof(zone) < column->block_count)
+    {
+        goto invalid;
+    }
+    return 1;
+
+invalid:
+    unmap_file(column->mapping, column->size);
+    errno = EINVAL;
+    return 0;
+}
+
+static inline uint64_t zone_min_key(const column_map* column, size_t block)
+{
+    return column->zones[block].min ^ column->flip;
+}
+
+static inline uint64_t zone_max_key(const column_map* column, size_t block)
+{
+    return column->zones[block].max ^ column->flip;
+}
+
+static inline size_t block_start(const column_map* column, size_t block)
+{
+    return block * column->block_length;
+}
+
+static inline size_t block_end(const column_map* column, size_t block)
+{
+    size_t end = (block + 1) * column->block_length;
+    return end < column->count ? end : column->count;
+}
+
+// Index of the first value in [start, end) whose key is at least key.
+static size_t lower_bound(const column_map* column, size_t start, size_t end, uint64_t key)
+{
+    while(start < end)
+    {
+        size_t middle = start + (end - start) / 2;
+        if((column->values[middle] ^ column->flip) < key)
+        {
+            start = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+    return start;
+}
+
+// The first block that can hold keys at or above start_key.
+static size_t first_block(const column_map* column, uint64_t start_key)
+{
+    if(!column->blocks_ordered)
+    {
+        return 0;
+    }
+    size_t low = 0;
+    size_t high = column->block_count;
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(zone_max_key(column, middle) < start_key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Gets the part of a block that overlaps [start_key, end_key).
+// Returns 0 if the zone map rules the block out.
+static int block_span(const column_map* column, size_t block, uint64_t start_key, uint64_t end_key,
+                      size_t* start, size_t* end, int* exact)
+{
+    uint64_t min_key = zone_min_key(column, block);
+    uint64_t max_key = zone_max_key(column, block);
+    if(max_key < start_key || min_key >= end_key)
+    {
+        return 0;
+    }
+
+    *start = block_start(column, block);
+    *end = block_end(column, block);
+    *exact = 1;
+    if(min_key >= start_key && max_key < end_key)
+    {
+        return 1;
+    }
+    if(column->zones[block].flags & SORTED_FLAG)
+    {
+        *start = lower_bound(column, *start, *end, start_key);
+        *end = lower_bound(column, *start, *end, end_key);
+        return 1;
+    }
+    *exact = 0;
+    return 1;
+}
+
+static int query_next(const column_map* column, uint64_t start_key, uint64_t end_key, size_t* next_block,
+                      const uint64_t** values, size_t* count, int* exact)
+{
+    size_t block = *next_block;
+    while(block < column->block_count)
+    {
+        size_t start;
+        size_t end;
+        if(!block_span(column, block, start_key, end_key, &start, &end, exact) || start == end)
+        {
+            if(column->blocks_ordered && zone_min_key(column, block) >= end_key)
+            {
+                block = column->block_count;
+                break;
+            }
+            block++;
+            continue;
+        }
+
+        // Exact spans that run into each other are contiguous in the
+        // file, so they're handed out as one.
+        block++;
+        size_t next_start;
+        size_t next_end;
+        int next_exact;
+        while(*exact && end == block_end(column, block - 1) && block < column->block_count &&
+              block_span(column, block, start_key, end_key, &next_start, &next_end, &next_exact) &&
+              next_exact && next_start == end)
+        {
+            end = next_end;
+            block++;
+        }
+
+        *next_block = block;
+        *values = column->values + start;
+        *count = end - start;
+        return 1;
+    }
+    *next_block = block;
+    return 0;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+smalltime_column_writer* smalltime_column_writer_open(const char* path, size_t block_length)
+{
+    smalltime_column_writer* writer = malloc(sizeof(*writer));
+    if(writer != NULL && !writer_init(&writer->writer, path, KIND_SMALLTIME, block_length))
+    {
+        free(writer);
+        writer = NULL;
+    }
+    return writer;
+}
+
+nanotime_column_writer* nanotime_column_writer_open(const char* path, size_t block_length)
+{
+    nanotime_column_writer* writer = malloc(sizeof(*writer));
+    if(writer != NULL && !writer_init(&writer->writer, path, KIND_NANOTIME, block_length))
+    {
+        free(writer);
+        writer = NULL;
+    }
+    return writer;
+}
+
+int smalltime_column_writer_append(smalltime_column_writer* writer, const smalltime* values, size_t count)
+{
+    return writer_append(&writer->writer, (const uint64_t*)values, count);
+}
+
+int nanotime_column_writer_append(nanotime_column_writer* writer, const nanotime* values, size_t count)
+{
+    return writer_append(&writer->writer, values, count);
+}
+
+int smalltime_column_writer_close(smalltime_column_writer* writer)
+{
+    int success = writer_close(&writer->writer);
+    free(writer);
+    return success;
+}
+
+int nanotime_column_writer_close(nanotime_column_writer* writer)
+{
+    int success = writer_close(&writer->writer);
+    free(writer);
+    return success;
+}
+
+smalltime_column* smalltime_column_open(const char* path)
+{
+    smalltime_column* column = malloc(sizeof(*column));
+    if(column != NULL && !column_init(&column->column, path, KIND_SMALLTIME))
+    {
+        free(column);
+        column = NULL;
+    }
+    return column;
+}
+
+nanotime_column* nanotime_column_open(const char* path)
+{
+    nanotime_column* column = malloc(sizeof(*column));
+    if(column != NULL && !column_init(&column->column, path, KIND_NANOTIME))
+    {
+        free(column);
+        column = NULL;
+    }
+    return column;
+}
+
+void smalltime_column_close(smalltime_column* column)
+{
+    unmap_file(column->column.mapping, column->column.size);
+    free(column);
+}
+
+void nanotime_column_close(nanotime_column* column)
+{
+    unmap_file(column->column.mapping, column->column.size);
+    free(column);
+}
+
+const smalltime* smalltime_column_values(const smalltime_column* column, size_t* count)
+{
+    *count = column->column.count;
+    return (const smalltime*)column->column.values;
+}
+
+const nanotime* nanotime_column_values(const nanotime_column* column, size_t* count)
+{
+    *count = column->column.count;
+    return column->column.values;
+}
+
+void smalltime_column_query_start(const smalltime_column* column, smalltime start, smalltime end,
+                                  smalltime_column_query* query)
+{
+    memset(query, 0, sizeof(*query));
+    query->column = column;
+    query->start = start;
+    query->end = end;
+    query->next_block = start < end ? first_block(&column->column, (uint64_t)start ^ SMALLTIME_KEY_FLIP)
+                                    : column->column.block_count;
+}
+
+void nanotime_column_query_start(const nanotime_column* column, nanotime start, nanotime end,
+                                 nanotime_column_query* query)
+{
+    memset(query, 0, sizeof(*query));
+    query->column = column;
+    query->start = start;
+    query->end = end;
+    query->next_block = start < end ? first_block(&column->column, start ^ NANOTIME_KEY_FLIP)
+                                    : column->column.block_count;
+}
+
+int smalltime_column_query_next(smalltime_column_query* query)
+{
+    const uint64_t* values;
+    if(!query_next(&query->column->column, (uint64_t)query->start ^ SMALLTIME_KEY_FLIP, (uint64_t)query->end ^ SMALLTIME_KEY_FLIP,
+                   &query->next_block, &values, &query->count, &query->exact))
+    {
+        query->values = NULL;
+        query->count = 0;
+        return 0;
+    }
+    query->values = (const smalltime*)values;
+    return 1;
+}
+
+int nanotime_column_query_next(nanotime_column_query* query)
+{
+    if(!query_next(&query->column->column, query->start ^ NANOTIME_KEY_FLIP, query->end ^ NANOTIME_KEY_FLIP,
+                   &query->next_block, &query->values, &query->count, &query->exact))
+    {
+        query->values = NULL;
+        query->count = 0;
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,161 @@
+#include "kernels.h"
+#include <smalltime/convert.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// The month to second fields line up once moved down this far.
+#define FIELD_SHIFT (NT_SHIFT_SECOND - ST_SHIFT_SECOND)
+// A nanotime year of 0, as a smalltime.
+#define YEAR_BASE ((uint64_t)NT_ZERO_YEAR << ST_SHIFT_YEAR)
+// One past the last year that fits in a nanotime, counted from YEAR_BASE.
+#define YEAR_LIMIT ((uint64_t)(NT_MAX_YEAR - NT_MIN_YEAR + 1) << ST_SHIFT_YEAR)
+
+// Converts values [begin, end) in a word that starts at values[0],
+// returning the out of range flags.
+static inline uint64_t to_nanotime_range(const smalltime* values, size_t begin, size_t end, nanotime* results)
+{
+    uint64_t out_of_range = 0;
+    for(size_t i = begin; i < end; i++)
+    {
+        out_of_range |= (uint64_t)!smalltime_to_nanotime(values[i], &results[i]) << i;
+    }
+    return out_of_range;
+}
+
+// Converts whole words of 64 values with WORD_TO_NANOTIME(values, results),
+// and the rest with to_nanotime_range().
+#define TO_NANOTIME_WORDS(WORD_TO_NANOTIME) \
+    size_t out_of_range_count = 0; \
+    for(size_t i = 0; i < count; i += 64) \
+    { \
+        uint64_t word = count - i >= 64 ? WORD_TO_NANOTIME(values + i, results + i) : to_nanotime_range(values + i, 0, count - i, results + i); \
+        out_of_range_count += (size_t)__builtin_popcountll(word); \
+        if(out_of_range != NULL) \
+        { \
+            out_of_range[i / 64] = word; \
+        } \
+    } \
+    return out_of_range_count
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+static inline uint64_t scalar_word_to_nanotime(const smalltime* values, nanotime* results)
+{
+    return to_nanotime_range(values, 0, 64, results);
+}
+
+void nanotime_batch_to_smalltime_scalar(const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        results[i] = nanotime_to_smalltime(values[i], rounding);
+    }
+}
+
+size_t smalltime_batch_to_nanotime_scalar(const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range)
+{
+    TO_NANOTIME_WORDS(scalar_word_to_nanotime);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+// Both directions are a shift and an add on the fields, plus a multiply
+// (or a multiply-shift division) on the fraction. Nanoseconds are below
+// 2^30, so n / 1000 is (n * 274877907) >> 38 for every one of them.
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_mul32(__m512i a, uint32_t b)
+{
+    return _mm512_mul_epu32(a, _mm512_set1_epi64(b));
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_to_smalltime_avx512(const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results)
+{
+    const __m512i fraction_mask = _mm512_set1_epi64((long long)NT_MASK_NANOSECOND);
+    const __m512i year_base = _mm512_set1_epi64((long long)YEAR_BASE);
+    const __m512i half = _mm512_set1_epi64(500);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i whole_second = _mm512_set1_epi64(1000000);
+    const int round = rounding == SMALLTIME_CONVERT_ROUND_HALF_EVEN;
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void*)(values + i));
+        __m512i fields = _mm512_add_epi64(_mm512_srli_epi64(_mm512_andnot_si512(fraction_mask, v), FIELD_SHIFT), year_base);
+        __m512i nanosecond = _mm512_and_si512(v, fraction_mask);
+        __m512i microsecond = _mm512_srli_epi64(avx512_mul32(nanosecond, 274877907), 38);
+        __mmask8 carries = 0;
+        if(round)
+        {
+            __m512i remainder = _mm512_sub_epi64(nanosecond, avx512_mul32(microsecond, 1000));
+            __mmask8 up = _mm512_cmpgt_epu64_mask(remainder, half) |
+                          (_mm512_cmpeq_epi64_mask(remainder, half) & _mm512_test_epi64_mask(microsecond, one));
+            microsecond = _mm512_mask_add_epi64(microsecond, up, microsecond, one);
+            carries = _mm512_cmpeq_epi64_mask(microsecond, whole_second);
+        }
+        _mm512_storeu_si512((void*)(results + i), _mm512_or_si512(fields, microsecond));
+
+        // Rounded up to the next second. results may alias values, so
+        // carry from what was stored.
+        for(; carries != 0; carries &= carries - 1)
+        {
+            size_t index = i + (size_t)__builtin_ctz(carries);
+            results[index] = smalltime_convert_next_second(results[index] & ~ST_MASK_MICROSECOND);
+        }
+    }
+    nanotime_batch_to_smalltime_scalar(values + i, count - i, rounding, results + i);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline uint64_t avx512_word_to_nanotime(const smalltime* values, nanotime* results)
+{
+    const __m512i year_base = _mm512_set1_epi64((long long)YEAR_BASE);
+    const __m512i year_limit = _mm512_set1_epi64((long long)YEAR_LIMIT);
+    const __m512i fraction_mask = _mm512_set1_epi64(ST_MASK_MICROSECOND);
+    uint64_t out_of_range = 0;
+    for(int i = 0; i < 64; i += 8)
+    {
+        __m512i rebased = _mm512_sub_epi64(_mm512_loadu_si512((const void*)(values + i)), year_base);
+        __mmask8 in_range = _mm512_cmplt_epu64_mask(rebased, year_limit);
+        __m512i v = _mm512_or_si512(_mm512_slli_epi64(_mm512_andnot_si512(fraction_mask, rebased), FIELD_SHIFT),
+                                    avx512_mul32(_mm512_and_si512(rebased, fraction_mask), 1000));
+        _mm512_mask_storeu_epi64((void*)(results + i), in_range, v);
+        out_of_range |= (uint64_t)(uint8_t)~in_range << i;
+    }
+    return out_of_range;
+}
+
+SMALLTIME_TARGET_AVX512
+size_t smalltime_batch_to_nanotime_avx512(const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range)
+{
+    TO_NANOTIME_WORDS(avx512_word_to_nanotime);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+void nanotime_batch_to_smalltime(const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results)
+{
+    smalltime_kernels.nanotime_batch_to_smalltime(values, count, rounding, results);
+}
+
+size_t smalltime_batch_to_nanotime(const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range)
+{
+    return smalltime_kernels.smalltime_batch_to_nanotime(values, count, results, out_of_range);
+}
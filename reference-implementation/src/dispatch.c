@@ -0,0 +1,185 @@
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Kernel table
+// ==================================================================
+
+// Scalar until the load-time constructor runs, so calls made by other
+// constructors before then still work.
+smalltime_kernel_table smalltime_kernels =
+{
+    smalltime_batch_decode_scalar,
+    smalltime_batch_encode_scalar,
+    nanotime_batch_decode_scalar,
+    nanotime_batch_encode_scalar,
+    smalltime_batch_from_unix_seconds_scalar,
+    smalltime_batch_from_unix_microseconds_scalar,
+    smalltime_batch_to_unix_seconds_scalar,
+    smalltime_batch_to_unix_microseconds_scalar,
+    nanotime_batch_from_unix_seconds_scalar,
+    nanotime_batch_from_unix_nanoseconds_scalar,
+    nanotime_batch_to_unix_seconds_scalar,
+    nanotime_batch_to_unix_nanoseconds_scalar,
+    smalltime_batch_add_field_scalar,
+    smalltime_batch_diff_us_scalar,
+    nanotime_batch_diff_ns_scalar,
+    smalltime_batch_format_iso8601_scalar,
+    nanotime_batch_format_iso8601_scalar,
+    smalltime_parse_iso8601_scalar,
+    nanotime_parse_iso8601_scalar,
+    smalltime_batch_parse_iso8601_scalar,
+    nanotime_batch_parse_iso8601_scalar,
+    smalltime_batch_validate_scalar,
+    smalltime_codec_decode_block_scalar,
+    smalltime_index_lower_bound_scalar,
+    smalltime_rollup_run_length_scalar,
+    smalltime_rollup_aggregate_scalar,
+    smalltime_range_fill_run_scalar,
+    smalltime_range_restamp_scalar,
+    smalltime_batch_calendar_scalar,
+    nanotime_batch_to_smalltime_scalar,
+    smalltime_batch_to_nanotime_scalar,
+};
+
+static smalltime_isa g_active_isa = SMALLTIME_ISA_SCALAR;
+
+static void install_kernels(smalltime_isa isa)
+{
+    smalltime_kernels.smalltime_batch_decode = SMALLTIME_SELECT_KERNEL(smalltime_batch_decode, isa);
+    smalltime_kernels.smalltime_batch_encode = SMALLTIME_SELECT_KERNEL(smalltime_batch_encode, isa);
+    smalltime_kernels.nanotime_batch_decode = SMALLTIME_SELECT_KERNEL(nanotime_batch_decode, isa);
+    smalltime_kernels.nanotime_batch_encode = SMALLTIME_SELECT_KERNEL(nanotime_batch_encode, isa);
+    smalltime_kernels.smalltime_batch_from_unix_seconds = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_from_unix_seconds, isa);
+    smalltime_kernels.smalltime_batch_from_unix_microseconds = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_from_unix_microseconds, isa);
+    smalltime_kernels.smalltime_batch_to_unix_seconds = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_to_unix_seconds, isa);
+    smalltime_kernels.smalltime_batch_to_unix_microseconds = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_to_unix_microseconds, isa);
+    smalltime_kernels.nanotime_batch_from_unix_seconds = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_from_unix_seconds, isa);
+    smalltime_kernels.nanotime_batch_from_unix_nanoseconds = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_from_unix_nanoseconds, isa);
+    smalltime_kernels.nanotime_batch_to_unix_seconds = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_to_unix_seconds, isa);
+    smalltime_kernels.nanotime_batch_to_unix_nanoseconds = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_to_unix_nanoseconds, isa);
+    smalltime_kernels.smalltime_batch_add_field = SMALLTIME_SELECT_KERNEL(smalltime_batch_add_field, isa);
+    smalltime_kernels.smalltime_batch_diff_us = SMALLTIME_SELECT_KERNEL(smalltime_batch_diff_us, isa);
+    smalltime_kernels.nanotime_batch_diff_ns = SMALLTIME_SELECT_KERNEL(nanotime_batch_diff_ns, isa);
+    smalltime_kernels.smalltime_batch_format_iso8601 = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_format_iso8601, isa);
+    smalltime_kernels.nanotime_batch_format_iso8601 = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_format_iso8601, isa);
+    smalltime_kernels.smalltime_parse_iso8601 = SMALLTIME_SELECT_KERNEL_SSE42(smalltime_parse_iso8601, isa);
+    smalltime_kernels.nanotime_parse_iso8601 = SMALLTIME_SELECT_KERNEL_SSE42(nanotime_parse_iso8601, isa);
+    smalltime_kernels.smalltime_batch_parse_iso8601 = SMALLTIME_SELECT_KERNEL_SSE42(smalltime_batch_parse_iso8601, isa);
+    smalltime_kernels.nanotime_batch_parse_iso8601 = SMALLTIME_SELECT_KERNEL_SSE42(nanotime_batch_parse_iso8601, isa);
+    smalltime_kernels.smalltime_batch_validate = SMALLTIME_SELECT_KERNEL(smalltime_batch_validate, isa);
+    smalltime_kernels.smalltime_codec_decode_block = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_codec_decode_block, isa);
+    smalltime_kernels.smalltime_index_lower_bound = SMALLTIME_SELECT_KERNEL(smalltime_index_lower_bound, isa);
+    smalltime_kernels.smalltime_rollup_run_length = SMALLTIME_SELECT_KERNEL(smalltime_rollup_run_length, isa);
+    smalltime_kernels.smalltime_rollup_aggregate = SMALLTIME_SELECT_KERNEL(smalltime_rollup_aggregate, isa);
+    smalltime_kernels.smalltime_range_fill_run = SMALLTIME_SELECT_KERNEL(smalltime_range_fill_run, isa);
+    smalltime_kernels.smalltime_range_restamp = SMALLTIME_SELECT_KERNEL(smalltime_range_restamp, isa);
+    smalltime_kernels.smalltime_batch_calendar = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_calendar, isa);
+    smalltime_kernels.nanotime_batch_to_smalltime = SMALLTIME_SELECT_KERNEL_AVX512(nanotime_batch_to_smalltime, isa);
+    smalltime_kernels.smalltime_batch_to_nanotime = SMALLTIME_SELECT_KERNEL_AVX512(smalltime_batch_to_nanotime, isa);
+    g_active_isa = isa;
+}
+
+
+// ==================================================================
+// Detection
+// ==================================================================
+
+static smalltime_isa detect_isa(void)
+{
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+    // Required before __builtin_cpu_supports() when called from a constructor.
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") &&
+       __builtin_cpu_supports("avx512bw") &&
+       __builtin_cpu_supports("avx512dq") &&
+       __builtin_cpu_supports("avx512vl"))
+    {
+        return SMALLTIME_ISA_AVX512;
+    }
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return SMALLTIME_ISA_AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.2"))
+    {
+        return SMALLTIME_ISA_SSE42;
+    }
+#endif
+    return SMALLTIME_ISA_SCALAR;
+}
+
+static const char* const g_isa_names[] =
+{
+    "scalar",
+    "sse42",
+    "avx2",
+    "avx512",
+};
+
+static smalltime_isa isa_from_environment(smalltime_isa fallback)
+{
+    const char* name = getenv("SMALLTIME_ISA");
+    if(name == NULL)
+    {
+        return fallback;
+    }
+    for(int isa = SMALLTIME_ISA_SCALAR; isa <= SMALLTIME_ISA_AVX512; isa++)
+    {
+        if(strcmp(name, g_isa_names[isa]) == 0)
+        {
+            return (smalltime_isa)isa;
+        }
+    }
+    return fallback;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor))
+#endif
+static void smalltime_init_dispatch(void)
+{
+    smalltime_set_isa(isa_from_environment(SMALLTIME_ISA_AVX512));
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+smalltime_isa smalltime_get_isa(void)
+{
+    return g_active_isa;
+}
+
+smalltime_isa smalltime_get_best_isa(void)
+{
+    static int best = -1;
+    if(best < 0)
+    {
+        best = detect_isa();
+    }
+    return (smalltime_isa)best;
+}
+
+smalltime_isa smalltime_set_isa(smalltime_isa isa)
+{
+    smalltime_isa best = smalltime_get_best_isa();
+    if((int)isa < SMALLTIME_ISA_SCALAR || isa > best)
+    {
+        isa = best;
+    }
+    install_kernels(isa);
+    return isa;
+}
+
+const char* smalltime_isa_name(smalltime_isa isa)
+{
+    if((int)isa < SMALLTIME_ISA_SCALAR || isa > SMALLTIME_ISA_AVX512)
+    {
+        return "unknown";
+    }
+    return g_isa_names[isa];
+}
@@ -0,0 +1,612 @@
+#include "kernels.h"
+#include <smalltime/epoch.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#define SECONDS_PER_DAY 86400
+#define MICROSECONDS_PER_SECOND 1000000
+#define NANOSECONDS_PER_SECOND 1000000000
+
+// Seconds from the shifted civil origin to the Unix epoch (see civil.h).
+// Adding this makes every supported time non-negative.
+#define EPOCH_SECOND_SHIFT ((uint64_t)SMALLTIME_CIVIL_DAY_SHIFT * SECONDS_PER_DAY)
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+// Timestamp columns are usually clustered in time, so the scalar kernels
+// remember the last day they converted and only run the calendar
+// algorithm when a value falls outside of it.
+
+typedef struct
+{
+    uint64_t start;    // First second of the day, shifted by EPOCH_SECOND_SHIFT.
+    uint64_t date;     // The year, month and day fields, already encoded.
+    int64_t unix_start; // First second of the day, in Unix seconds.
+} day_cache;
+
+static inline void day_cache_load_smalltime(day_cache* cache, uint64_t shifted_seconds)
+{
+    uint64_t days = shifted_seconds / SECONDS_PER_DAY;
+    int year, month, day;
+    smalltime_civil_from_days((int32_t)(days - SMALLTIME_CIVIL_DAY_SHIFT), &year, &month, &day);
+    cache->start = days * SECONDS_PER_DAY;
+    cache->date = (uint64_t)smalltime_new(year, month, day, 0, 0, 0, 0);
+}
+
+static inline void day_cache_load_nanotime(day_cache* cache, uint64_t shifted_seconds)
+{
+    uint64_t days = shifted_seconds / SECONDS_PER_DAY;
+    int year, month, day;
+    smalltime_civil_from_days((int32_t)(days - SMALLTIME_CIVIL_DAY_SHIFT), &year, &month, &day);
+    cache->start = days * SECONDS_PER_DAY;
+    cache->date = nanotime_new(year, month, day, 0, 0, 0, 0);
+}
+
+static inline smalltime smalltime_from_shifted_seconds(day_cache* cache, uint64_t shifted_seconds)
+{
+    uint64_t second_of_day = shifted_seconds - cache->start;
+    // Unsigned, so this catches values on either side of the cached day.
+    if(second_of_day >= SECONDS_PER_DAY)
+    {
+        day_cache_load_smalltime(cache, shifted_seconds);
+        second_of_day = shifted_seconds - cache->start;
+    }
+    uint32_t sod = (uint32_t)second_of_day;
+    return (smalltime)(cache->date |
+                       ((uint64_t)(sod / 3600) << ST_SHIFT_HOUR) |
+                       ((uint64_t)(sod / 60 % 60) << ST_SHIFT_MINUTE) |
+                       ((uint64_t)(sod % 60) << ST_SHIFT_SECOND));
+}
+
+static inline nanotime nanotime_from_shifted_seconds(day_cache* cache, uint64_t shifted_seconds)
+{
+    uint64_t second_of_day = shifted_seconds - cache->start;
+    if(second_of_day >= SECONDS_PER_DAY)
+    {
+        day_cache_load_nanotime(cache, shifted_seconds);
+        second_of_day = shifted_seconds - cache->start;
+    }
+    uint32_t sod = (uint32_t)second_of_day;
+    return cache->date |
+           ((uint64_t)(sod / 3600) << NT_SHIFT_HOUR) |
+           ((uint64_t)(sod / 60 % 60) << NT_SHIFT_MINUTE) |
+           ((uint64_t)(sod % 60) << NT_SHIFT_SECOND);
+}
+
+static inline int64_t smalltime_unix_day_start(day_cache* cache, smalltime time)
+{
+    uint64_t date = (uint64_t)time & (uint64_t)(ST_MASK_YEAR | ST_MASK_MONTH | ST_MASK_DAY);
+    if(date != cache->date)
+    {
+        cache->date = date;
+        cache->unix_start = (int64_t)smalltime_days_from_civil(smalltime_get_year(time), smalltime_get_month(time), smalltime_get_day(time)) * SECONDS_PER_DAY;
+    }
+    return cache->unix_start;
+}
+
+static inline int64_t nanotime_unix_day_start(day_cache* cache, nanotime time)
+{
+    uint64_t date = time & (NT_MASK_YEAR | NT_MASK_MONTH | NT_MASK_DAY);
+    if(date != cache->date)
+    {
+        cache->date = date;
+        cache->unix_start = (int64_t)smalltime_days_from_civil(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time)) * SECONDS_PER_DAY;
+    }
+    return cache->unix_start;
+}
+
+static inline int64_t smalltime_second_of_day(smalltime time)
+{
+    return smalltime_get_hour(time) * 3600 + smalltime_get_minute(time) * 60 + smalltime_get_second(time);
+}
+
+static inline int64_t nanotime_second_of_day(nanotime time)
+{
+    return nanotime_get_hour(time) * 3600 + nanotime_get_minute(time) * 60 + nanotime_get_second(time);
+}
+
+static inline void smalltime_from_unix_seconds_range(const int64_t* seconds, smalltime* values, size_t begin, size_t end)
+{
+    if(begin >= end)
+    {
+        return;
+    }
+    day_cache cache;
+    day_cache_load_smalltime(&cache, (uint64_t)seconds[begin] + EPOCH_SECOND_SHIFT);
+    for(size_t i = begin; i < end; i++)
+    {
+        values[i] = smalltime_from_shifted_seconds(&cache, (uint64_t)seconds[i] + EPOCH_SECOND_SHIFT);
+    }
+}
+
+static inline void smalltime_from_unix_microseconds_range(const int64_t* microseconds, smalltime* values, size_t begin, size_t end)
+{
+    if(begin >= end)
+    {
+        return;
+    }
+    const uint64_t shift = EPOCH_SECOND_SHIFT * MICROSECONDS_PER_SECOND;
+    day_cache cache;
+    day_cache_load_smalltime(&cache, ((uint64_t)microseconds[begin] + shift) / MICROSECONDS_PER_SECOND);
+    for(size_t i = begin; i < end; i++)
+    {
+        uint64_t shifted = (uint64_t)microseconds[i] + shift;
+        uint64_t shifted_seconds = shifted / MICROSECONDS_PER_SECOND;
+        uint64_t microsecond = shifted - shifted_seconds * MICROSECONDS_PER_SECOND;
+        values[i] = smalltime_from_shifted_seconds(&cache, shifted_seconds) | (smalltime)microsecond;
+    }
+}
+
+static inline void smalltime_to_unix_seconds_range(const smalltime* values, int64_t* seconds, size_t begin, size_t end)
+{
+    day_cache cache = {0, 1, 0};
+    for(size_t i = begin; i < end; i++)
+    {
+        seconds[i] = smalltime_unix_day_start(&cache, values[i]) + smalltime_second_of_day(values[i]);
+    }
+}
+
+static inline void smalltime_to_unix_microseconds_range(const smalltime* values, int64_t* microseconds, size_t begin, size_t end)
+{
+    day_cache cache = {0, 1, 0};
+    for(size_t i = begin; i < end; i++)
+    {
+        int64_t seconds = smalltime_unix_day_start(&cache, values[i]) + smalltime_second_of_day(values[i]);
+        microseconds[i] = seconds * MICROSECONDS_PER_SECOND + smalltime_get_microsecond(values[i]);
+    }
+}
+
+static inline void nanotime_from_unix_seconds_range(const int64_t* seconds, nanotime* values, size_t begin, size_t end)
+{
+    if(begin >= end)
+    {
+        return;
+    }
+    day_cache cache;
+    day_cache_load_nanotime(&cache, (uint64_t)seconds[begin] + EPOCH_SECOND_SHIFT);
+    for(size_t i = begin; i < end; i++)
+    {
+        values[i] = nanotime_from_shifted_seconds(&cache, (uint64_t)seconds[i] + EPOCH_SECOND_SHIFT);
+    }
+}
+
+static inline void nanotime_from_unix_nanoseconds_range(const int64_t* nanoseconds, nanotime* values, size_t begin, size_t end)
+{
+    if(begin >= end)
+    {
+        return;
+    }
+    day_cache cache;
+    day_cache_load_nanotime(&cache, (uint64_t)nanoseconds[begin] / NANOSECONDS_PER_SECOND + EPOCH_SECOND_SHIFT);
+    for(size_t i = begin; i < end; i++)
+    {
+        uint64_t unix_seconds = (uint64_t)nanoseconds[i] / NANOSECONDS_PER_SECOND;
+        uint64_t nanosecond = (uint64_t)nanoseconds[i] - unix_seconds * NANOSECONDS_PER_SECOND;
+        values[i] = nanotime_from_shifted_seconds(&cache, unix_seconds + EPOCH_SECOND_SHIFT) | nanosecond;
+    }
+}
+
+static inline void nanotime_to_unix_seconds_range(const nanotime* values, int64_t* seconds, size_t begin, size_t end)
+{
+    day_cache cache = {0, 1, 0};
+    for(size_t i = begin; i < end; i++)
+    {
+        seconds[i] = nanotime_unix_day_start(&cache, values[i]) + nanotime_second_of_day(values[i]);
+    }
+}
+
+static inline void nanotime_to_unix_nanoseconds_range(const nanotime* values, int64_t* nanoseconds, size_t begin, size_t end)
+{
+    day_cache cache = {0, 1, 0};
+    for(size_t i = begin; i < end; i++)
+    {
+        int64_t seconds = nanotime_unix_day_start(&cache, values[i]) + nanotime_second_of_day(values[i]);
+        nanoseconds[i] = seconds * NANOSECONDS_PER_SECOND + nanotime_get_nanosecond(values[i]);
+    }
+}
+
+void smalltime_batch_from_unix_seconds_scalar(const int64_t* seconds, size_t count, smalltime* values)
+{
+    smalltime_from_unix_seconds_range(seconds, values, 0, count);
+}
+
+void smalltime_batch_from_unix_microseconds_scalar(const int64_t* microseconds, size_t count, smalltime* values)
+{
+    smalltime_from_unix_microseconds_range(microseconds, values, 0, count);
+}
+
+void smalltime_batch_to_unix_seconds_scalar(const smalltime* values, size_t count, int64_t* seconds)
+{
+    smalltime_to_unix_seconds_range(values, seconds, 0, count);
+}
+
+void smalltime_batch_to_unix_microseconds_scalar(const smalltime* values, size_t count, int64_t* microseconds)
+{
+    smalltime_to_unix_microseconds_range(values, microseconds, 0, count);
+}
+
+void nanotime_batch_from_unix_seconds_scalar(const int64_t* seconds, size_t count, nanotime* values)
+{
+    nanotime_from_unix_seconds_range(seconds, values, 0, count);
+}
+
+void nanotime_batch_from_unix_nanoseconds_scalar(const int64_t* nanoseconds, size_t count, nanotime* values)
+{
+    nanotime_from_unix_nanoseconds_range(nanoseconds, values, 0, count);
+}
+
+void nanotime_batch_to_unix_seconds_scalar(const nanotime* values, size_t count, int64_t* seconds)
+{
+    nanotime_to_unix_seconds_range(values, seconds, 0, count);
+}
+
+void nanotime_batch_to_unix_nanoseconds_scalar(const nanotime* values, size_t count, int64_t* nanoseconds)
+{
+    nanotime_to_unix_nanoseconds_range(values, nanoseconds, 0, count);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+// The AVX-512 kernels run the civil algorithms on 8 values at a time in
+// 64-bit lanes. Every intermediate of the day/date arithmetic fits in 32
+// bits, so the constant divisions are done with vpmuludq multiply-shift
+// pairs (magic numbers verified over the full input range). Only the
+// initial split of the 64-bit count into days needs a wide division,
+// which is estimated in double precision and then corrected exactly.
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_mul32(__m512i a, uint32_t b)
+{
+    return _mm512_mul_epu32(a, _mm512_set1_epi64(b));
+}
+
+// Divides non-negative lanes (< 2^63) by a constant, returning the quotient
+// and storing the remainder.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_divmod(__m512i n, uint64_t divisor, __m512i* remainder)
+{
+    const __m512i d = _mm512_set1_epi64((long long)divisor);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i zero = _mm512_setzero_si512();
+    __m512d estimate = _mm512_mul_pd(_mm512_cvtepu64_pd(n), _mm512_set1_pd(1.0 / (double)divisor));
+    __m512i q = _mm512_cvttpd_epu64(estimate);
+    __m512i r = _mm512_sub_epi64(n, _mm512_mullo_epi64(q, d));
+
+    // The estimate is at most one off in either direction.
+    __mmask8 too_high = _mm512_cmplt_epi64_mask(r, zero);
+    q = _mm512_mask_sub_epi64(q, too_high, q, one);
+    r = _mm512_mask_add_epi64(r, too_high, r, d);
+    __mmask8 too_low = _mm512_cmpge_epu64_mask(r, d);
+    q = _mm512_mask_add_epi64(q, too_low, q, one);
+    r = _mm512_mask_sub_epi64(r, too_low, r, d);
+
+    *remainder = r;
+    return q;
+}
+
+// Splits a second of the day (0 - 86399) into hour, minute and second.
+SMALLTIME_TARGET_AVX512
+static inline void avx512_split_second_of_day(__m512i second_of_day, __m512i* hour, __m512i* minute, __m512i* second)
+{
+    *hour = _mm512_srli_epi64(avx512_mul32(second_of_day, 37283), 27);
+    __m512i second_of_hour = _mm512_sub_epi64(second_of_day, avx512_mul32(*hour, 3600));
+    *minute = _mm512_srli_epi64(avx512_mul32(second_of_hour, 2185), 17);
+    *second = _mm512_sub_epi64(second_of_hour, avx512_mul32(*minute, 60));
+}
+
+// Vector form of smalltime_civil_from_days(), taking shifted day numbers.
+SMALLTIME_TARGET_AVX512
+static inline void avx512_civil_from_shifted_days(__m512i n, __m512i* year, __m512i* month, __m512i* day)
+{
+    const __m512i three = _mm512_set1_epi64(3);
+
+    __m512i n1 = _mm512_add_epi64(_mm512_slli_epi64(n, 2), three);
+    __m512i century = _mm512_srli_epi64(avx512_mul32(n1, 481657695), 46);
+    __m512i day_of_century = _mm512_srli_epi64(_mm512_sub_epi64(n1, avx512_mul32(century, 146097)), 2);
+
+    __m512i n2 = _mm512_add_epi64(_mm512_slli_epi64(day_of_century, 2), three);
+    __m512i p2 = avx512_mul32(n2, 2939745);
+    __m512i year_of_century = _mm512_srli_epi64(p2, 32);
+    // vpmuludq only reads the low 32 bits of p2, which is the (uint32_t) cast.
+    __m512i day_of_year = _mm512_srli_epi64(avx512_mul32(p2, 1531969483), 54);
+
+    __m512i n3 = _mm512_add_epi64(avx512_mul32(day_of_year, 2141), _mm512_set1_epi64(197913));
+    __m512i m = _mm512_srli_epi64(n3, 16);
+    __m512i d = _mm512_srli_epi64(avx512_mul32(_mm512_and_si512(n3, _mm512_set1_epi64(0xffff)), 31345), 26);
+
+    __mmask8 is_jan_feb = _mm512_cmpge_epu64_mask(day_of_year, _mm512_set1_epi64(306));
+    __m512i y = _mm512_add_epi64(avx512_mul32(century, 100), year_of_century);
+    y = _mm512_mask_add_epi64(y, is_jan_feb, y, _mm512_set1_epi64(1));
+    *year = _mm512_sub_epi64(y, _mm512_set1_epi64(SMALLTIME_CIVIL_YEAR_SHIFT));
+    *month = _mm512_mask_sub_epi64(m, is_jan_feb, m, _mm512_set1_epi64(12));
+    *day = _mm512_add_epi64(d, _mm512_set1_epi64(1));
+}
+
+// Vector form of smalltime_days_from_civil(). Returns signed days since 1970.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_days_from_civil(__m512i year, __m512i month, __m512i day)
+{
+    __mmask8 is_jan_feb = _mm512_cmple_epu64_mask(month, _mm512_set1_epi64(2));
+    __m512i y = _mm512_add_epi64(year, _mm512_set1_epi64(SMALLTIME_CIVIL_YEAR_SHIFT));
+    y = _mm512_mask_sub_epi64(y, is_jan_feb, y, _mm512_set1_epi64(1));
+    __m512i m = _mm512_mask_add_epi64(month, is_jan_feb, month, _mm512_set1_epi64(12));
+
+    __m512i century = _mm512_srli_epi64(avx512_mul32(y, 335545), 25);
+    __m512i year_days = _mm512_srli_epi64(avx512_mul32(y, 1461), 2);
+    year_days = _mm512_add_epi64(_mm512_sub_epi64(year_days, century), _mm512_srli_epi64(century, 2));
+    __m512i month_days = _mm512_srli_epi64(_mm512_sub_epi64(avx512_mul32(m, 979), _mm512_set1_epi64(2919)), 5);
+
+    __m512i days = _mm512_add_epi64(_mm512_add_epi64(year_days, month_days), day);
+    return _mm512_sub_epi64(days, _mm512_set1_epi64(SMALLTIME_CIVIL_DAY_SHIFT + 1));
+}
+
+// Encodes the hour, minute, second and fraction fields from a count of ticks
+// since midnight.
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_encode_time_of_day(__m512i tick_of_day, uint64_t ticks_per_second,
+                                                int hour_shift, int minute_shift, int second_shift)
+{
+    __m512i fraction = _mm512_setzero_si512();
+    __m512i second_of_day = tick_of_day;
+    if(ticks_per_second > 1)
+    {
+        second_of_day = avx512_divmod(tick_of_day, ticks_per_second, &fraction);
+    }
+    __m512i hour, minute, second;
+    avx512_split_second_of_day(second_of_day, &hour, &minute, &second);
+
+    __m512i v = _mm512_or_si512(fraction, _mm512_slli_epi64(hour, hour_shift));
+    v = _mm512_or_si512(v, _mm512_slli_epi64(minute, minute_shift));
+    return _mm512_or_si512(v, _mm512_slli_epi64(second, second_shift));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_encode_smalltime_date(__m512i shifted_days)
+{
+    __m512i year, month, day;
+    avx512_civil_from_shifted_days(shifted_days, &year, &month, &day);
+    __m512i v = _mm512_slli_epi64(year, ST_SHIFT_YEAR);
+    v = _mm512_or_si512(v, _mm512_slli_epi64(month, ST_SHIFT_MONTH));
+    return _mm512_or_si512(v, _mm512_slli_epi64(day, ST_SHIFT_DAY));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_encode_nanotime_date(__m512i shifted_days)
+{
+    __m512i year, month, day;
+    avx512_civil_from_shifted_days(shifted_days, &year, &month, &day);
+    __m512i v = _mm512_slli_epi64(_mm512_sub_epi64(year, _mm512_set1_epi64(NT_ZERO_YEAR)), NT_SHIFT_YEAR);
+    v = _mm512_or_si512(v, _mm512_slli_epi64(month, NT_SHIFT_MONTH));
+    return _mm512_or_si512(v, _mm512_slli_epi64(day, NT_SHIFT_DAY));
+}
+
+// Converts non-negative tick counts to time values, 8 at a time. As with the
+// scalar kernels, the day of the previous vector is cached (broadcast to
+// all lanes), and when all 8 ticks fall within it the calendar conversion
+// is skipped entirely.
+//
+// day_shift is added to the day number before the calendar conversion, for
+// tick counts that aren't already shifted by SMALLTIME_CIVIL_DAY_SHIFT.
+SMALLTIME_TARGET_AVX512
+static inline size_t avx512_from_ticks(const int64_t* ticks, size_t count, uint64_t* values,
+                                       uint64_t tick_shift, uint64_t ticks_per_second, uint64_t day_shift,
+                                       int is_nanotime)
+{
+    const uint64_t ticks_per_day = ticks_per_second * SECONDS_PER_DAY;
+    const __m512i tick_shift_v = _mm512_set1_epi64((long long)tick_shift);
+    const __m512i ticks_per_day_v = _mm512_set1_epi64((long long)ticks_per_day);
+    const __m512i day_shift_v = _mm512_set1_epi64((long long)day_shift);
+    const __m512i last_lane = _mm512_set1_epi64(7);
+    const int hour_shift = is_nanotime ? NT_SHIFT_HOUR : ST_SHIFT_HOUR;
+    const int minute_shift = is_nanotime ? NT_SHIFT_MINUTE : ST_SHIFT_MINUTE;
+    const int second_shift = is_nanotime ? NT_SHIFT_SECOND : ST_SHIFT_SECOND;
+
+    // Starts out empty: no unsigned offset is below zero ticks per day.
+    __m512i cached_start = _mm512_setzero_si512();
+    __m512i cached_length = _mm512_setzero_si512();
+    __m512i cached_date = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i shifted = _mm512_add_epi64(_mm512_loadu_si512(ticks + i), tick_shift_v);
+        __m512i tick_of_day = _mm512_sub_epi64(shifted, cached_start);
+        __m512i date = cached_date;
+
+        if(_mm512_cmpge_epu64_mask(tick_of_day, cached_length) != 0)
+        {
+            __m512i days = avx512_divmod(shifted, ticks_per_day, &tick_of_day);
+            days = _mm512_add_epi64(days, day_shift_v);
+            date = is_nanotime ? avx512_encode_nanotime_date(days) : avx512_encode_smalltime_date(days);
+
+            __m512i start = _mm512_sub_epi64(shifted, tick_of_day);
+            cached_start = _mm512_permutexvar_epi64(last_lane, start);
+            cached_date = _mm512_permutexvar_epi64(last_lane, date);
+            cached_length = ticks_per_day_v;
+        }
+
+        __m512i time = avx512_encode_time_of_day(tick_of_day, ticks_per_second, hour_shift, minute_shift, second_shift);
+        _mm512_storeu_si512(values + i, _mm512_or_si512(date, time));
+    }
+    return i;
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_smalltime_to_unix_seconds(__m512i v)
+{
+    const __m512i mask5 = _mm512_set1_epi64(0x1f);
+    const __m512i mask6 = _mm512_set1_epi64(0x3f);
+    __m512i year = _mm512_srai_epi64(v, ST_SHIFT_YEAR);
+    __m512i month = _mm512_and_si512(_mm512_srli_epi64(v, ST_SHIFT_MONTH), _mm512_set1_epi64(0xf));
+    __m512i day = _mm512_and_si512(_mm512_srli_epi64(v, ST_SHIFT_DAY), mask5);
+    __m512i hour = _mm512_and_si512(_mm512_srli_epi64(v, ST_SHIFT_HOUR), mask5);
+    __m512i minute = _mm512_and_si512(_mm512_srli_epi64(v, ST_SHIFT_MINUTE), mask6);
+    __m512i second = _mm512_and_si512(_mm512_srli_epi64(v, ST_SHIFT_SECOND), mask6);
+
+    __m512i days = avx512_days_from_civil(year, month, day);
+    __m512i seconds = _mm512_mul_epi32(days, _mm512_set1_epi64(SECONDS_PER_DAY));
+    seconds = _mm512_add_epi64(seconds, avx512_mul32(hour, 3600));
+    seconds = _mm512_add_epi64(seconds, avx512_mul32(minute, 60));
+    return _mm512_add_epi64(seconds, second);
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_nanotime_to_unix_seconds(__m512i v)
+{
+    const __m512i mask5 = _mm512_set1_epi64(0x1f);
+    const __m512i mask6 = _mm512_set1_epi64(0x3f);
+    __m512i year = _mm512_add_epi64(_mm512_srli_epi64(v, NT_SHIFT_YEAR), _mm512_set1_epi64(NT_ZERO_YEAR));
+    __m512i month = _mm512_and_si512(_mm512_srli_epi64(v, NT_SHIFT_MONTH), _mm512_set1_epi64(0xf));
+    __m512i day = _mm512_and_si512(_mm512_srli_epi64(v, NT_SHIFT_DAY), mask5);
+    __m512i hour = _mm512_and_si512(_mm512_srli_epi64(v, NT_SHIFT_HOUR), mask5);
+    __m512i minute = _mm512_and_si512(_mm512_srli_epi64(v, NT_SHIFT_MINUTE), mask6);
+    __m512i second = _mm512_and_si512(_mm512_srli_epi64(v, NT_SHIFT_SECOND), mask6);
+
+    __m512i days = avx512_days_from_civil(year, month, day);
+    __m512i seconds = _mm512_mul_epi32(days, _mm512_set1_epi64(SECONDS_PER_DAY));
+    seconds = _mm512_add_epi64(seconds, avx512_mul32(hour, 3600));
+    seconds = _mm512_add_epi64(seconds, avx512_mul32(minute, 60));
+    return _mm512_add_epi64(seconds, second);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_from_unix_seconds_avx512(const int64_t* seconds, size_t count, smalltime* values)
+{
+    size_t i = avx512_from_ticks(seconds, count, (uint64_t*)values, EPOCH_SECOND_SHIFT, 1, 0, 0);
+    smalltime_from_unix_seconds_range(seconds, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_from_unix_microseconds_avx512(const int64_t* microseconds, size_t count, smalltime* values)
+{
+    size_t i = avx512_from_ticks(microseconds, count, (uint64_t*)values,
+                                 EPOCH_SECOND_SHIFT * MICROSECONDS_PER_SECOND, MICROSECONDS_PER_SECOND, 0, 0);
+    smalltime_from_unix_microseconds_range(microseconds, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_to_unix_seconds_avx512(const smalltime* values, size_t count, int64_t* seconds)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        _mm512_storeu_si512(seconds + i, avx512_smalltime_to_unix_seconds(v));
+    }
+    smalltime_to_unix_seconds_range(values, seconds, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_batch_to_unix_microseconds_avx512(const smalltime* values, size_t count, int64_t* microseconds)
+{
+    const __m512i scale = _mm512_set1_epi64(MICROSECONDS_PER_SECOND);
+    const __m512i mask20 = _mm512_set1_epi64(ST_MASK_MICROSECOND);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __m512i us = _mm512_mullo_epi64(avx512_smalltime_to_unix_seconds(v), scale);
+        _mm512_storeu_si512(microseconds + i, _mm512_add_epi64(us, _mm512_and_si512(v, mask20)));
+    }
+    smalltime_to_unix_microseconds_range(values, microseconds, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_from_unix_seconds_avx512(const int64_t* seconds, size_t count, nanotime* values)
+{
+    size_t i = avx512_from_ticks(seconds, count, values, 0, 1, SMALLTIME_CIVIL_DAY_SHIFT, 1);
+    nanotime_from_unix_seconds_range(seconds, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_from_unix_nanoseconds_avx512(const int64_t* nanoseconds, size_t count, nanotime* values)
+{
+    // Nanosecond counts can't be shifted without overflowing, but nanotime
+    // starts at 1970 so they are never negative anyway.
+    size_t i = avx512_from_ticks(nanoseconds, count, values, 0, NANOSECONDS_PER_SECOND, SMALLTIME_CIVIL_DAY_SHIFT, 1);
+    nanotime_from_unix_nanoseconds_range(nanoseconds, values, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_to_unix_seconds_avx512(const nanotime* values, size_t count, int64_t* seconds)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        _mm512_storeu_si512(seconds + i, avx512_nanotime_to_unix_seconds(v));
+    }
+    nanotime_to_unix_seconds_range(values, seconds, i, count);
+}
+
+SMALLTIME_TARGET_AVX512
+void nanotime_batch_to_unix_nanoseconds_avx512(const nanotime* values, size_t count, int64_t* nanoseconds)
+{
+    const __m512i scale = _mm512_set1_epi64(NANOSECONDS_PER_SECOND);
+    const __m512i mask30 = _mm512_set1_epi64((long long)NT_MASK_NANOSECOND);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __m512i ns = _mm512_mullo_epi64(avx512_nanotime_to_unix_seconds(v), scale);
+        _mm512_storeu_si512(nanoseconds + i, _mm512_add_epi64(ns, _mm512_and_si512(v, mask30)));
+    }
+    nanotime_to_unix_nanoseconds_range(values, nanoseconds, i, count);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+void smalltime_batch_from_unix_seconds(const int64_t* seconds, size_t count, smalltime* values)
+{
+    smalltime_kernels.smalltime_batch_from_unix_seconds(seconds, count, values);
+}
+
+void smalltime_batch_from_unix_microseconds(const int64_t* microseconds, size_t count, smalltime* values)
+{
+    smalltime_kernels.smalltime_batch_from_unix_microseconds(microseconds, count, values);
+}
+
+void smalltime_batch_to_unix_seconds(const smalltime* values, size_t count, int64_t* seconds)
+{
+    smalltime_kernels.smalltime_batch_to_unix_seconds(values, count, seconds);
+}
+
+void smalltime_batch_to_unix_microseconds(const smalltime* values, size_t count, int64_t* microseconds)
+{
+    smalltime_kernels.smalltime_batch_to_unix_microseconds(values, count, microseconds);
+}
+
+void nanotime_batch_from_unix_seconds(const int64_t* seconds, size_t count, nanotime* values)
+{
+    smalltime_kernels.nanotime_batch_from_unix_seconds(seconds, count, values);
+}
+
+void nanotime_batch_from_unix_nanoseconds(const int64_t* nanoseconds, size_t count, nanotime* values)
+{
+    smalltime_kernels.nanotime_batch_from_unix_nanoseconds(nanoseconds, count, values);
+}
+
+void nanotime_batch_to_unix_seconds(const nanotime* values, size_t count, int64_t* seconds)
+{
+    smalltime_kernels.nanotime_batch_to_unix_seconds(values, count, seconds);
+}
+
+void nanotime_batch_to_unix_nanoseconds(const nanotime* values, size_t count, int64_t* nanoseconds)
+{
+    smalltime_kernels.nanotime_batch_to_unix_nanoseconds(values, count, nanoseconds);
+}
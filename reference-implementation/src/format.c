@@ -0,0 +1,385 @@
+#include "kernels.h"
+#include <string.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Fields
+// ==================================================================
+
+// Each field is split into two-digit pairs, which are then copied from a
+// table. A pshufb-based variant that converted and placed all pairs of one
+// value at once measured slower than this on AVX-512 hardware: the fields
+// still have to be split with scalar divisions, and the shuffles all
+// compete for the same vector port while the pair copies spread over the
+// store and ALU ports. The batch kernels below instead split eight values
+// at a time.
+
+typedef struct
+{
+    char sign;        // '+' or '-' for an expanded year, 0 otherwise.
+    unsigned leading; // The two extra leading digits of an expanded year.
+    // Century, year of century, month, day, hour, minute, second, then the
+    // fraction in pairs (the last nanotime "pair" is a single digit).
+    unsigned pairs[12];
+} timestamp_pairs;
+
+static inline void split_smalltime(smalltime value, timestamp_pairs* split)
+{
+    int year = smalltime_get_year(value);
+    unsigned year_digits = (unsigned)year;
+    split->sign = 0;
+    split->leading = 0;
+    if(year < 0 || year > 9999)
+    {
+        split->sign = year < 0 ? '-' : '+';
+        year_digits = year < 0 ? 0u - (unsigned)year : (unsigned)year;
+        split->leading = year_digits / 10000;
+        year_digits %= 10000;
+    }
+    // The fraction field can hold values past 999999, so it's clamped to
+    // its decimal digits to keep every pair below 100.
+    unsigned microsecond = (unsigned)smalltime_get_microsecond(value) % 1000000;
+    split->pairs[0] = year_digits / 100;
+    split->pairs[1] = year_digits % 100;
+    split->pairs[2] = (unsigned)smalltime_get_month(value);
+    split->pairs[3] = (unsigned)smalltime_get_day(value);
+    split->pairs[4] = (unsigned)smalltime_get_hour(value);
+    split->pairs[5] = (unsigned)smalltime_get_minute(value);
+    split->pairs[6] = (unsigned)smalltime_get_second(value);
+    split->pairs[7] = microsecond / 10000;
+    split->pairs[8] = microsecond / 100 % 100;
+    split->pairs[9] = microsecond % 100;
+}
+
+static inline void split_nanotime(nanotime value, timestamp_pairs* split)
+{
+    unsigned year = (unsigned)nanotime_get_year(value);
+    unsigned nanosecond = (unsigned)nanotime_get_nanosecond(value) % 1000000000;
+    split->sign = 0;
+    split->leading = 0;
+    split->pairs[0] = year / 100;
+    split->pairs[1] = year % 100;
+    split->pairs[2] = (unsigned)nanotime_get_month(value);
+    split->pairs[3] = (unsigned)nanotime_get_day(value);
+    split->pairs[4] = (unsigned)nanotime_get_hour(value);
+    split->pairs[5] = (unsigned)nanotime_get_minute(value);
+    split->pairs[6] = (unsigned)nanotime_get_second(value);
+    split->pairs[7] = nanosecond / 10000000;
+    split->pairs[8] = nanosecond / 100000 % 100;
+    split->pairs[9] = nanosecond / 1000 % 100;
+    split->pairs[10] = nanosecond / 10 % 100;
+    split->pairs[11] = nanosecond % 10;
+}
+
+static const char g_digit_pairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline void write_pair(char* dst, unsigned pair)
+{
+    memcpy(dst, g_digit_pairs + pair * 2, 2);
+}
+
+// Writes the sign and leading digits of an expanded year, if any.
+static inline size_t write_year_prefix(char* dst, const timestamp_pairs* split)
+{
+    if(split->sign == 0)
+    {
+        return 0;
+    }
+    dst[0] = split->sign;
+    write_pair(dst + 1, split->leading);
+    return 3;
+}
+
+static inline size_t pad_record(char* dst, size_t length, size_t stride)
+{
+    if(stride == 0)
+    {
+        dst[length] = '\n';
+        return length + 1;
+    }
+    memset(dst + length, ' ', stride - length);
+    return stride;
+}
+
+
+// ==================================================================
+// Output
+// ==================================================================
+
+// Writes "YYYY-MM-DDTHH:MM:SS." (20 chars).
+static inline void write_date_time(char* dst, const unsigned* pairs)
+{
+    write_pair(dst + 0, pairs[0]);
+    write_pair(dst + 2, pairs[1]);
+    dst[4] = '-';
+    write_pair(dst + 5, pairs[2]);
+    dst[7] = '-';
+    write_pair(dst + 8, pairs[3]);
+    dst[10] = 'T';
+    write_pair(dst + 11, pairs[4]);
+    dst[13] = ':';
+    write_pair(dst + 14, pairs[5]);
+    dst[16] = ':';
+    write_pair(dst + 17, pairs[6]);
+    dst[19] = '.';
+}
+
+// Writes a timestamp without a terminator, returning the length.
+static inline size_t write_smalltime(smalltime value, char* buffer)
+{
+    timestamp_pairs split;
+    split_smalltime(value, &split);
+    size_t prefix = write_year_prefix(buffer, &split);
+    char* dst = buffer + prefix;
+    write_date_time(dst, split.pairs);
+    write_pair(dst + 20, split.pairs[7]);
+    write_pair(dst + 22, split.pairs[8]);
+    write_pair(dst + 24, split.pairs[9]);
+    dst[26] = 'Z';
+    return prefix + SMALLTIME_ISO8601_LENGTH;
+}
+
+static inline size_t write_nanotime(nanotime value, char* buffer)
+{
+    timestamp_pairs split;
+    split_nanotime(value, &split);
+    write_date_time(buffer, split.pairs);
+    write_pair(buffer + 20, split.pairs[7]);
+    write_pair(buffer + 22, split.pairs[8]);
+    write_pair(buffer + 24, split.pairs[9]);
+    write_pair(buffer + 26, split.pairs[10]);
+    buffer[28] = (char)('0' + split.pairs[11]);
+    buffer[29] = 'Z';
+    return NANOTIME_ISO8601_LENGTH;
+}
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+size_t smalltime_batch_format_iso8601_scalar(const smalltime* values, size_t count, size_t stride, char* buffer)
+{
+    char* dst = buffer;
+    for(size_t i = 0; i < count; i++)
+    {
+        dst += pad_record(dst, write_smalltime(values[i], dst), stride);
+    }
+    return (size_t)(dst - buffer);
+}
+
+size_t nanotime_batch_format_iso8601_scalar(const nanotime* values, size_t count, size_t stride, char* buffer)
+{
+    char* dst = buffer;
+    for(size_t i = 0; i < count; i++)
+    {
+        dst += pad_record(dst, write_nanotime(values[i], dst), stride);
+    }
+    return (size_t)(dst - buffer);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+// Eight values are split at once, one per 64-bit lane. Every division is
+// of a value below 2^32 by a constant, so it's a 32x32 bit multiply and a
+// shift. Each pair is then turned into its two ASCII digits in the same
+// lanes, and the digits and separators of each timestamp are combined
+// into four words, which are copied out one timestamp at a time.
+//
+// Smalltime values with an expanded year go through the scalar code, a
+// group of eight at a time.
+
+#define SPLAT(VALUE) _mm512_set1_epi64((long long)(VALUE))
+
+// x / divisor for lanes below 2^32, with the multiplier and shift that
+// make it exact over that range.
+#define DIVIDE(X, MULTIPLIER, SHIFT) _mm512_srli_epi64(_mm512_mul_epu32(X, SPLAT(MULTIPLIER)), SHIFT)
+#define DIVIDE_10(X)    DIVIDE(X, 3435973837u, 35)
+#define DIVIDE_100(X)   DIVIDE(X, 1374389535u, 37)
+#define DIVIDE_1000(X)  DIVIDE(X, 274877907u, 38)
+#define DIVIDE_10000(X) DIVIDE(X, 3518437209u, 45)
+
+#define FIELD(VALUES, SHIFT, MASK) _mm512_and_si512(_mm512_srli_epi64(VALUES, SHIFT), SPLAT(MASK))
+
+// The ASCII digits of a pair (below 100), first digit in the low byte.
+SMALLTIME_TARGET_AVX512
+static inline __m512i ascii_pair(__m512i pair)
+{
+    __m512i tens = _mm512_srli_epi64(_mm512_mul_epu32(pair, SPLAT(205)), 11);
+    __m512i ones = _mm512_sub_epi64(pair, _mm512_mullo_epi64(tens, SPLAT(10)));
+    return _mm512_or_si512(_mm512_or_si512(tens, _mm512_slli_epi64(ones, 8)), SPLAT(0x3030));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i modulo(__m512i x, __m512i quotient, uint64_t divisor)
+{
+    return _mm512_sub_epi64(x, _mm512_mullo_epi64(quotient, SPLAT(divisor)));
+}
+
+// Subtracts limit from the lanes at or above it, so that a fraction field
+// holding too large a value keeps only its decimal digits.
+SMALLTIME_TARGET_AVX512
+static inline __m512i wrap(__m512i x, uint64_t limit)
+{
+    __mmask8 is_over = _mm512_cmpge_epu64_mask(x, SPLAT(limit));
+    return _mm512_mask_sub_epi64(x, is_over, x, SPLAT(limit));
+}
+
+// Adds the ASCII digits of a pair to a word, starting at a byte.
+#define SHIFT_IN(WORD, PAIR, BYTE) _mm512_or_si512(WORD, _mm512_slli_epi64(ascii_pair(PAIR), (BYTE) * 8))
+
+// "YYYY-MM-D" and "DTHH:MM:" (bytes 0 to 15), the same for both types.
+SMALLTIME_TARGET_AVX512
+static inline void date_time_words(__m512i year, __m512i month, __m512i day, __m512i hour, __m512i minute, __m512i words[2])
+{
+    __m512i century = DIVIDE_100(year);
+    __m512i word = SPLAT(0x2d00002d00000000ULL);  // '-' at bytes 4 and 7
+    word = SHIFT_IN(word, century, 0);
+    word = SHIFT_IN(word, modulo(year, century, 100), 2);
+    words[0] = SHIFT_IN(word, month, 5);
+    word = SPLAT(0x00003a0000540000ULL);  // 'T' at byte 10, ':' at 13
+    word = SHIFT_IN(word, day, 0);
+    word = SHIFT_IN(word, hour, 3);
+    words[1] = SHIFT_IN(word, minute, 6);
+}
+
+// Copies timestamps out of the words of a group, returning the end.
+SMALLTIME_TARGET_AVX512
+static inline char* write_group(char* dst, const __m512i words[4], size_t length, size_t stride)
+{
+    uint64_t lanes[4][8];
+    for(int i = 0; i < 4; i++)
+    {
+        _mm512_storeu_si512(lanes[i], words[i]);
+    }
+    for(int lane = 0; lane < 8; lane++)
+    {
+        memcpy(dst, &lanes[0][lane], 8);
+        memcpy(dst + 8, &lanes[1][lane], 8);
+        memcpy(dst + 16, &lanes[2][lane], 8);
+        memcpy(dst + 24, &lanes[3][lane], length - 24);
+        dst += pad_record(dst, length, stride);
+    }
+    return dst;
+}
+
+SMALLTIME_TARGET_AVX512
+size_t smalltime_batch_format_iso8601_avx512(const smalltime* values, size_t count, size_t stride, char* buffer)
+{
+    char* dst = buffer;
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __m512i year = _mm512_srai_epi64(v, ST_SHIFT_YEAR);
+        if(_mm512_cmpgt_epu64_mask(year, SPLAT(9999)) != 0)
+        {
+            dst += smalltime_batch_format_iso8601_scalar(values + i, 8, stride, dst);
+            continue;
+        }
+        __m512i words[4];
+        date_time_words(year,
+                        FIELD(v, ST_SHIFT_MONTH, 0xf),
+                        FIELD(v, ST_SHIFT_DAY, 0x1f),
+                        FIELD(v, ST_SHIFT_HOUR, 0x1f),
+                        FIELD(v, ST_SHIFT_MINUTE, 0x3f),
+                        words);
+
+        // ":SS.ffff" and "ffZ".
+        __m512i microsecond = wrap(_mm512_and_si512(v, SPLAT(ST_MASK_MICROSECOND)), 1000000);
+        __m512i hundreds = DIVIDE_100(microsecond);
+        __m512i ten_thousands = DIVIDE_100(hundreds);
+        __m512i word = SPLAT(0x000000002e00003aULL);  // ':' at byte 16, '.' at 19
+        word = SHIFT_IN(word, FIELD(v, ST_SHIFT_SECOND, 0x3f), 1);
+        word = SHIFT_IN(word, ten_thousands, 4);
+        words[2] = SHIFT_IN(word, modulo(hundreds, ten_thousands, 100), 6);
+        words[3] = SHIFT_IN(SPLAT(0x5a0000), modulo(microsecond, hundreds, 100), 0);  // 'Z' at byte 26
+
+        dst = write_group(dst, words, SMALLTIME_ISO8601_LENGTH, stride);
+    }
+    dst += smalltime_batch_format_iso8601_scalar(values + i, count - i, stride, dst);
+    return (size_t)(dst - buffer);
+}
+
+SMALLTIME_TARGET_AVX512
+size_t nanotime_batch_format_iso8601_avx512(const nanotime* values, size_t count, size_t stride, char* buffer)
+{
+    char* dst = buffer;
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __m512i words[4];
+        date_time_words(_mm512_add_epi64(_mm512_srli_epi64(v, NT_SHIFT_YEAR), SPLAT(NT_ZERO_YEAR)),
+                        FIELD(v, NT_SHIFT_MONTH, 0xf),
+                        FIELD(v, NT_SHIFT_DAY, 0x1f),
+                        FIELD(v, NT_SHIFT_HOUR, 0x1f),
+                        FIELD(v, NT_SHIFT_MINUTE, 0x3f),
+                        words);
+
+        // ":SS.ffff" and "fffffZ".
+        __m512i nanosecond = wrap(_mm512_and_si512(v, SPLAT(NT_MASK_NANOSECOND)), 1000000000);
+        __m512i tens = DIVIDE_10(nanosecond);
+        __m512i thousands = DIVIDE_1000(nanosecond);
+        __m512i hundred_thousands = DIVIDE_100(thousands);
+        __m512i ten_millions = DIVIDE_10000(thousands);
+        __m512i word = SPLAT(0x000000002e00003aULL);  // ':' at byte 16, '.' at 19
+        word = SHIFT_IN(word, FIELD(v, NT_SHIFT_SECOND, 0x3f), 1);
+        word = SHIFT_IN(word, ten_millions, 4);
+        words[2] = SHIFT_IN(word, modulo(hundred_thousands, ten_millions, 100), 6);
+        word = SPLAT(0x5a0000000000ULL);  // 'Z' at byte 29
+        word = SHIFT_IN(word, modulo(thousands, hundred_thousands, 100), 0);
+        word = SHIFT_IN(word, modulo(tens, thousands, 100), 2);
+        word = _mm512_or_si512(word, _mm512_slli_epi64(modulo(nanosecond, tens, 10), 32));
+        words[3] = _mm512_or_si512(word, SPLAT((uint64_t)'0' << 32));
+
+        dst = write_group(dst, words, NANOTIME_ISO8601_LENGTH, stride);
+    }
+    dst += nanotime_batch_format_iso8601_scalar(values + i, count - i, stride, dst);
+    return (size_t)(dst - buffer);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+size_t smalltime_format_iso8601(smalltime value, char* buffer)
+{
+    size_t length = write_smalltime(value, buffer);
+    buffer[length] = 0;
+    return length;
+}
+
+size_t nanotime_format_iso8601(nanotime value, char* buffer)
+{
+    size_t length = write_nanotime(value, buffer);
+    buffer[length] = 0;
+    return length;
+}
+
+size_t smalltime_batch_format_iso8601(const smalltime* values, size_t count, size_t stride, char* buffer)
+{
+    return smalltime_kernels.smalltime_batch_format_iso8601(values, count, stride, buffer);
+}
+
+size_t nanotime_batch_format_iso8601(const nanotime* values, size_t count, size_t stride, char* buffer)
+{
+    return smalltime_kernels.nanotime_batch_format_iso8601(values, count, stride, buffer);
+}
@@ -0,0 +1,50 @@
+#include <smalltime/generator.h>
+#include <smalltime/clock.h>
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+// Every access is to the one word, which the compare-exchange totally
+// orders, so no fences are needed to keep the values unique.
+
+smalltime smalltime_generator_reserve(smalltime_generator* generator, size_t count)
+{
+    smalltime now = smalltime_now();
+    smalltime last = __atomic_load_n(&generator->last, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        smalltime first = now > last ? now : smalltime_add_microseconds(last, 1);
+        smalltime end = smalltime_add_microseconds(first, (int64_t)count - 1);
+        if(__atomic_compare_exchange_n(&generator->last, &last, end, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            return first;
+        }
+    }
+}
+
+nanotime nanotime_generator_reserve(nanotime_generator* generator, size_t count)
+{
+    nanotime now = nanotime_now();
+    nanotime last = __atomic_load_n(&generator->last, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        nanotime first = now > last ? now : nanotime_add_nanoseconds(last, 1);
+        nanotime end = nanotime_add_nanoseconds(first, (int64_t)count - 1);
+        if(__atomic_compare_exchange_n(&generator->last, &last, end, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            return first;
+        }
+    }
+}
+
+smalltime smalltime_generator_next(smalltime_generator* generator)
+{
+    return smalltime_generator_reserve(generator, 1);
+}
+
+nanotime nanotime_generator_next(nanotime_generator* generator)
+{
+    return nanotime_generator_reserve(generator, 1);
+}
@@ -0,0 +1,463 @@
+#include "kernels.h"
+#include <smalltime/index.h>
+#include <stdlib.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+#define NODE_SIZE 8
+#define FANOUT (NODE_SIZE + 1)
+#define CACHE_LINE_SIZE 64
+
+// Searches run in groups that descend the tree in lockstep, so that the
+// cache misses of one search overlap those of the others.
+#define SEARCH_GROUP_SIZE 8
+
+#define SMALLTIME_KEY_FLIP 0
+#define NANOTIME_KEY_FLIP  0x8000000000000000ULL
+
+static inline size_t min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+// The position in the array of the first value in leaf node (block) that
+// isn't less than key, looking at one value at a time.
+static inline size_t leaf_lower_bound(const smalltime_index_tree* tree, size_t block, int64_t key)
+{
+    size_t start = block * NODE_SIZE;
+    size_t end = min_size(start + NODE_SIZE, tree->count);
+    size_t position = start;
+    for(size_t i = start; i < end; i++)
+    {
+        position += (int64_t)(tree->values[i] ^ tree->flip) < key;
+    }
+    return position;
+}
+
+// Where the next layer's nodes are, for prefetching.
+static inline const void* layer_below(const smalltime_index_tree* tree, int layer)
+{
+    return layer + 1 < tree->height ? (const void*)tree->layers[layer + 1] : (const void*)tree->values;
+}
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+void smalltime_index_lower_bound_scalar(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        int64_t key = (int64_t)(values[i] ^ tree->flip);
+        size_t node = 0;
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            const int64_t* keys = tree->layers[layer] + node * NODE_SIZE;
+            size_t rank = 0;
+            for(int j = 0; j < NODE_SIZE; j++)
+            {
+                rank += keys[j] < key;
+            }
+            node = node * FANOUT + rank;
+        }
+        results[i] = leaf_lower_bound(tree, node, key);
+    }
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// Each kernel runs full groups of searches in lockstep, prefetching the
+// next node of every search in the group before comparing against any of
+// them, and then runs the rest one at a time.
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+// The number of keys less than key, in a node of 8.
+SMALLTIME_TARGET_SSE42
+static inline size_t sse42_rank(const int64_t* keys, __m128i key)
+{
+    __m128i less = _mm_add_epi64(_mm_add_epi64(_mm_cmpgt_epi64(key, _mm_loadu_si128((const __m128i*)keys)),
+                                               _mm_cmpgt_epi64(key, _mm_loadu_si128((const __m128i*)(keys + 2)))),
+                                 _mm_add_epi64(_mm_cmpgt_epi64(key, _mm_loadu_si128((const __m128i*)(keys + 4))),
+                                               _mm_cmpgt_epi64(key, _mm_loadu_si128((const __m128i*)(keys + 6)))));
+    less = _mm_add_epi64(less, _mm_unpackhi_epi64(less, less));
+    return (size_t)-_mm_cvtsi128_si64(less);
+}
+
+SMALLTIME_TARGET_SSE42
+static inline size_t sse42_child(const smalltime_index_tree* tree, int layer, size_t node, __m128i key)
+{
+    return node * FANOUT + sse42_rank(tree->layers[layer] + node * NODE_SIZE, key);
+}
+
+SMALLTIME_TARGET_SSE42
+static inline size_t sse42_leaf(const smalltime_index_tree* tree, size_t block, __m128i key, __m128i flip)
+{
+    if(block >= tree->count / NODE_SIZE)
+    {
+        return leaf_lower_bound(tree, block, _mm_cvtsi128_si64(key));
+    }
+    const uint64_t* leaf = tree->values + block * NODE_SIZE;
+    int64_t flipped[NODE_SIZE];
+    for(int j = 0; j < NODE_SIZE; j += 2)
+    {
+        _mm_storeu_si128((__m128i*)(flipped + j), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(leaf + j)), flip));
+    }
+    return block * NODE_SIZE + sse42_rank(flipped, key);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_index_lower_bound_sse42(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results)
+{
+    const __m128i flip = _mm_set1_epi64x((long long)tree->flip);
+    size_t first = 0;
+    for(; first + SEARCH_GROUP_SIZE <= count; first += SEARCH_GROUP_SIZE)
+    {
+        __m128i keys[SEARCH_GROUP_SIZE];
+        size_t nodes[SEARCH_GROUP_SIZE];
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            keys[i] = _mm_xor_si128(_mm_set1_epi64x((long long)values[first + i]), flip);
+            nodes[i] = 0;
+        }
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            const int64_t* below = layer_below(tree, layer);
+            for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+            {
+                nodes[i] = sse42_child(tree, layer, nodes[i], keys[i]);
+                _mm_prefetch((const char*)(below + nodes[i] * NODE_SIZE), _MM_HINT_T0);
+            }
+        }
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            results[first + i] = sse42_leaf(tree, nodes[i], keys[i], flip);
+        }
+    }
+    for(; first < count; first++)
+    {
+        __m128i key = _mm_xor_si128(_mm_set1_epi64x((long long)values[first]), flip);
+        size_t node = 0;
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            node = sse42_child(tree, layer, node, key);
+        }
+        results[first] = sse42_leaf(tree, node, key, flip);
+    }
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+static inline size_t avx2_rank(__m256i low, __m256i high, __m256i key)
+{
+    int low_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, low)));
+    int high_mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, high)));
+    return (size_t)__builtin_popcount((unsigned)(low_mask | high_mask << 4));
+}
+
+SMALLTIME_TARGET_AVX2
+static inline size_t avx2_child(const smalltime_index_tree* tree, int layer, size_t node, __m256i key)
+{
+    const int64_t* keys = tree->layers[layer] + node * NODE_SIZE;
+    return node * FANOUT + avx2_rank(_mm256_load_si256((const __m256i*)keys), _mm256_load_si256((const __m256i*)(keys + 4)), key);
+}
+
+SMALLTIME_TARGET_AVX2
+static inline size_t avx2_leaf(const smalltime_index_tree* tree, size_t block, __m256i key, __m256i flip)
+{
+    if(block >= tree->count / NODE_SIZE)
+    {
+        return leaf_lower_bound(tree, block, (int64_t)_mm256_extract_epi64(key, 0));
+    }
+    const uint64_t* leaf = tree->values + block * NODE_SIZE;
+    __m256i low = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)leaf), flip);
+    __m256i high = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(leaf + 4)), flip);
+    return block * NODE_SIZE + avx2_rank(low, high, key);
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_index_lower_bound_avx2(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results)
+{
+    const __m256i flip = _mm256_set1_epi64x((long long)tree->flip);
+    size_t first = 0;
+    for(; first + SEARCH_GROUP_SIZE <= count; first += SEARCH_GROUP_SIZE)
+    {
+        __m256i keys[SEARCH_GROUP_SIZE];
+        size_t nodes[SEARCH_GROUP_SIZE];
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            keys[i] = _mm256_xor_si256(_mm256_set1_epi64x((long long)values[first + i]), flip);
+            nodes[i] = 0;
+        }
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            const int64_t* below = layer_below(tree, layer);
+            for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+            {
+                nodes[i] = avx2_child(tree, layer, nodes[i], keys[i]);
+                _mm_prefetch((const char*)(below + nodes[i] * NODE_SIZE), _MM_HINT_T0);
+            }
+        }
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            results[first + i] = avx2_leaf(tree, nodes[i], keys[i], flip);
+        }
+    }
+    for(; first < count; first++)
+    {
+        __m256i key = _mm256_xor_si256(_mm256_set1_epi64x((long long)values[first]), flip);
+        size_t node = 0;
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            node = avx2_child(tree, layer, node, key);
+        }
+        results[first] = avx2_leaf(tree, node, key, flip);
+    }
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+static inline size_t avx512_child(const smalltime_index_tree* tree, int layer, size_t node, __m512i key)
+{
+    __m512i keys = _mm512_load_si512(tree->layers[layer] + node * NODE_SIZE);
+    return node * FANOUT + (size_t)__builtin_popcount(_mm512_cmplt_epi64_mask(keys, key));
+}
+
+// The last leaf can be short, and masked loads don't touch the lanes they
+// leave out.
+SMALLTIME_TARGET_AVX512
+static inline size_t avx512_leaf(const smalltime_index_tree* tree, size_t block, __m512i key, __m512i flip)
+{
+    size_t start = block * NODE_SIZE;
+    __mmask8 valid = (__mmask8)((1u << min_size(tree->count - start, NODE_SIZE)) - 1);
+    __m512i leaf = _mm512_xor_si512(_mm512_maskz_loadu_epi64(valid, tree->values + start), flip);
+    return start + (size_t)__builtin_popcount(_mm512_mask_cmplt_epi64_mask(valid, leaf, key));
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_index_lower_bound_avx512(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results)
+{
+    const __m512i flip = _mm512_set1_epi64((long long)tree->flip);
+    size_t first = 0;
+    for(; first + SEARCH_GROUP_SIZE <= count; first += SEARCH_GROUP_SIZE)
+    {
+        __m512i keys[SEARCH_GROUP_SIZE];
+        size_t nodes[SEARCH_GROUP_SIZE];
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            keys[i] = _mm512_xor_si512(_mm512_set1_epi64((long long)values[first + i]), flip);
+            nodes[i] = 0;
+        }
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            const int64_t* below = layer_below(tree, layer);
+            for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+            {
+                nodes[i] = avx512_child(tree, layer, nodes[i], keys[i]);
+                _mm_prefetch((const char*)(below + nodes[i] * NODE_SIZE), _MM_HINT_T0);
+            }
+        }
+        for(int i = 0; i < SEARCH_GROUP_SIZE; i++)
+        {
+            results[first + i] = avx512_leaf(tree, nodes[i], keys[i], flip);
+        }
+    }
+    for(; first < count; first++)
+    {
+        __m512i key = _mm512_xor_si512(_mm512_set1_epi64((long long)values[first]), flip);
+        size_t node = 0;
+        for(int layer = 0; layer < tree->height; layer++)
+        {
+            node = avx512_child(tree, layer, node, key);
+        }
+        results[first] = avx512_leaf(tree, node, key, flip);
+    }
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+struct smalltime_index
+{
+    smalltime_index_tree tree;
+    void* allocation;
+};
+
+struct nanotime_index
+{
+    smalltime_index_tree tree;
+    void* allocation;
+};
+
+// The first value of internal node key slot, or INT64_MAX if there is none.
+static int64_t separator(const smalltime_index_tree* tree, int level, size_t slot)
+{
+    size_t child = slot / NODE_SIZE * FANOUT + slot % NODE_SIZE + 1;
+    for(int i = 1; i < level; i++)
+    {
+        child *= FANOUT;
+    }
+    return child * NODE_SIZE < tree->count ? (int64_t)(tree->values[child * NODE_SIZE] ^ tree->flip) : INT64_MAX;
+}
+
+// Builds the internal layers, with level 1 just above the array.
+static void* build_tree(smalltime_index_tree* tree, const uint64_t* values, size_t count, uint64_t flip)
+{
+    tree->values = values;
+    tree->count = count;
+    tree->flip = flip;
+    tree->height = 0;
+
+    size_t layer_nodes[SMALLTIME_INDEX_MAX_HEIGHT];
+    size_t total_keys = 0;
+    for(size_t nodes = (count + NODE_SIZE - 1) / NODE_SIZE; nodes > 1; tree->height++)
+    {
+        nodes = (nodes + FANOUT - 1) / FANOUT;
+        layer_nodes[tree->height] = nodes;
+        total_keys += nodes * NODE_SIZE;
+    }
+
+    char* allocation = malloc(total_keys * sizeof(int64_t) + CACHE_LINE_SIZE);
+    if(allocation == NULL)
+    {
+        return NULL;
+    }
+    int64_t* keys = (int64_t*)(allocation + CACHE_LINE_SIZE - (uintptr_t)allocation % CACHE_LINE_SIZE);
+    for(int level = tree->height; level >= 1; level--)
+    {
+        size_t key_count = layer_nodes[level - 1] * NODE_SIZE;
+        for(size_t slot = 0; slot < key_count; slot++)
+        {
+            keys[slot] = separator(tree, level, slot);
+        }
+        tree->layers[tree->height - level] = keys;
+        keys += key_count;
+    }
+    return allocation;
+}
+
+static void lower_bound(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results)
+{
+    if(tree->count == 0)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            results[i] = 0;
+        }
+        return;
+    }
+    smalltime_kernels.smalltime_index_lower_bound(tree, values, count, results);
+}
+
+static void equal_range(const smalltime_index_tree* tree, uint64_t value, size_t* first, size_t* last)
+{
+    // Keys are integers, so the end of the run is the lower bound of the
+    // next key up.
+    int is_largest = (int64_t)(value ^ tree->flip) == INT64_MAX;
+    uint64_t bounds[2] = {value, value + 1};
+    size_t results[2];
+    lower_bound(tree, bounds, is_largest ? 1 : 2, results);
+    *first = results[0];
+    *last = is_largest ? tree->count : results[1];
+}
+
+smalltime_index* smalltime_index_new(const smalltime* values, size_t count)
+{
+    smalltime_index* index = malloc(sizeof(*index));
+    if(index == NULL)
+    {
+        return NULL;
+    }
+    index->allocation = build_tree(&index->tree, (const uint64_t*)values, count, SMALLTIME_KEY_FLIP);
+    if(index->allocation == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+nanotime_index* nanotime_index_new(const nanotime* values, size_t count)
+{
+    nanotime_index* index = malloc(sizeof(*index));
+    if(index == NULL)
+    {
+        return NULL;
+    }
+    index->allocation = build_tree(&index->tree, values, count, NANOTIME_KEY_FLIP);
+    if(index->allocation == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+void smalltime_index_free(smalltime_index* index)
+{
+    free(index->allocation);
+    free(index);
+}
+
+void nanotime_index_free(nanotime_index* index)
+{
+    free(index->allocation);
+    free(index);
+}
+
+size_t smalltime_index_lower_bound(const smalltime_index* index, smalltime value)
+{
+    size_t result;
+    lower_bound(&index->tree, (const uint64_t*)&value, 1, &result);
+    return result;
+}
+
+size_t nanotime_index_lower_bound(const nanotime_index* index, nanotime value)
+{
+    size_t result;
+    lower_bound(&index->tree, &value, 1, &result);
+    return result;
+}
+
+void smalltime_index_equal_range(const smalltime_index* index, smalltime value, size_t* first, size_t* last)
+{
+    equal_range(&index->tree, (uint64_t)value, first, last);
+}
+
+void nanotime_index_equal_range(const nanotime_index* index, nanotime value, size_t* first, size_t* last)
+{
+    equal_range(&index->tree, value, first, last);
+}
+
+void smalltime_index_batch_lower_bound(const smalltime_index* index, const smalltime* values, size_t count, size_t* results)
+{
+    lower_bound(&index->tree, (const uint64_t*)values, count, results);
+}
+
+void nanotime_index_batch_lower_bound(const nanotime_index* index, const nanotime* values, size_t count, size_t* results)
+{
+    lower_bound(&index->tree, values, count, results);
+}
@@ -0,0 +1,299 @@
+#include "workers.h"
+#include <smalltime/join.h>
+#include <smalltime/arith.h>
+#include <stdint.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// Right values are taken this many at a time, and each chunk picks its
+// own way of walking the left column.
+#define CHUNK_LENGTH 1024
+
+// A chunk gallops when it spans at least this many left values per right
+// value, and merges otherwise.
+#define GALLOP_RATIO 16
+
+// Each thread needs enough right values to be worth starting.
+#define MIN_VALUES_PER_THREAD 65536
+
+// Keys are the values xored with flip, which orders smalltime values
+// (whose sign bit flips) and nanotime values (which are left alone) as
+// unsigned integers.
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+// Every search is for the number of left keys less than a probe (a lower
+// bound). Searching for the keys at or before a probe uses the next key up
+// as the probe, and the largest key stays as it is. That key doesn't
+// encode a valid time, so no valid left key is left out.
+static inline uint64_t inclusive_probe(uint64_t key)
+{
+    return key + (key != UINT64_MAX);
+}
+
+// The bound of a probe in the left column, searching forward from
+// position by doubling steps and then a binary search of the last step.
+static inline size_t gallop(const uint64_t* left, size_t left_count, uint64_t flip, size_t position, uint64_t probe)
+{
+    size_t low = position;
+    size_t high = position;
+    size_t step = 1;
+    while(high < left_count && (left[high] ^ flip) < probe)
+    {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = high < left_count ? high : left_count;
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if((left[middle] ^ flip) < probe)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Finds the bound of each of a chunk of sorted probes, whose bounds are no
+// earlier than position, and returns the last bound.
+static size_t find_bounds(const uint64_t* left, size_t left_count, uint64_t flip,
+                          const uint64_t* probes, size_t count, size_t position, size_t* results)
+{
+    size_t last = gallop(left, left_count, flip, position, probes[count - 1]);
+    if(last - position >= count * GALLOP_RATIO)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            position = gallop(left, last, flip, position, probes[i]);
+            results[i] = position;
+        }
+        return last;
+    }
+
+    // Left values are compared with each probe four at a time, without
+    // branching. Since they're sorted, the number that come before the
+    // probe is how far to advance, and if all four do there may be more.
+    for(size_t i = 0; i < count; i++)
+    {
+        uint64_t probe = probes[i];
+        size_t advance = 4;
+        while(advance == 4 && position + 4 <= last)
+        {
+            advance = (size_t)((left[position] ^ flip) < probe)
+                    + (size_t)((left[position + 1] ^ flip) < probe)
+                    + (size_t)((left[position + 2] ^ flip) < probe)
+                    + (size_t)((left[position + 3] ^ flip) < probe);
+            position += advance;
+        }
+        if(advance == 4)
+        {
+            while(position < last && (left[position] ^ flip) < probe)
+            {
+                position++;
+            }
+        }
+        results[i] = position;
+    }
+    return last;
+}
+
+static inline size_t min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+
+// ==================================================================
+// Workers
+// ==================================================================
+
+// One thread's share of the right column.
+typedef struct
+{
+    const uint64_t* left;
+    size_t left_count;
+    const uint64_t* right;
+    size_t start;
+    size_t end;
+    uint64_t flip;
+
+    // As-of joins.
+    size_t* matches;
+
+    // Window joins.
+    uint64_t (*add)(uint64_t value, int64_t amount);
+    int64_t before;
+    int64_t after;
+    size_t* starts;
+    size_t* ends;
+} join_worker;
+
+static void asof_part(void* job)
+{
+    join_worker* worker = job;
+    uint64_t probes[CHUNK_LENGTH];
+    size_t position = 0;
+    for(size_t chunk = worker->start; chunk < worker->end; chunk += CHUNK_LENGTH)
+    {
+        size_t count = min_size(CHUNK_LENGTH, worker->end - chunk);
+        size_t* matches = worker->matches + chunk;
+        for(size_t i = 0; i < count; i++)
+        {
+            probes[i] = inclusive_probe(worker->right[chunk + i] ^ worker->flip);
+        }
+        position = find_bounds(worker->left, worker->left_count, worker->flip, probes, count, position, matches);
+        // The match is the value before the bound, and a bound of 0 wraps
+        // around to SMALLTIME_JOIN_NO_MATCH.
+        for(size_t i = 0; i < count; i++)
+        {
+            matches[i]--;
+        }
+    }
+}
+
+// The key of a value moved by amount, cut off at the smallest or largest
+// key if it wrapped around.
+static inline uint64_t moved_key(const join_worker* worker, uint64_t value, int64_t amount)
+{
+    uint64_t key = value ^ worker->flip;
+    uint64_t moved = worker->add(value, amount) ^ worker->flip;
+    if(amount < 0 && moved > key)
+    {
+        return 0;
+    }
+    if(amount > 0 && moved < key)
+    {
+        return UINT64_MAX;
+    }
+    return moved;
+}
+
+static void window_part(void* job)
+{
+    join_worker* worker = job;
+    uint64_t lower[CHUNK_LENGTH];
+    uint64_t upper[CHUNK_LENGTH];
+    size_t start_position = 0;
+    size_t end_position = 0;
+    for(size_t chunk = worker->start; chunk < worker->end; chunk += CHUNK_LENGTH)
+    {
+        size_t count = min_size(CHUNK_LENGTH, worker->end - chunk);
+        size_t* starts = worker->starts + chunk;
+        size_t* ends = worker->ends + chunk;
+        for(size_t i = 0; i < count; i++)
+        {
+            uint64_t value = worker->right[chunk + i];
+            lower[i] = moved_key(worker, value, -worker->before);
+            upper[i] = inclusive_probe(moved_key(worker, value, worker->after));
+        }
+        start_position = find_bounds(worker->left, worker->left_count, worker->flip, lower, count, start_position, starts);
+        end_position = find_bounds(worker->left, worker->left_count, worker->flip, upper, count, end_position, ends);
+        // A window that closes before it opens is empty.
+        for(size_t i = 0; i < count; i++)
+        {
+            ends[i] = ends[i] < starts[i] ? starts[i] : ends[i];
+        }
+    }
+}
+
+static void run_join(join_worker* prototype, size_t right_count, unsigned threads, void (*run)(void* worker))
+{
+    size_t worker_count = threads == 0 ? smalltime_cpu_count() : threads;
+    worker_count = min_size(worker_count, right_count / MIN_VALUES_PER_THREAD);
+    worker_count = worker_count < 1 ? 1 : min_size(worker_count, SMALLTIME_MAX_WORKERS);
+
+    join_worker workers[SMALLTIME_MAX_WORKERS];
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        workers[i] = *prototype;
+        workers[i].start = right_count * i / worker_count;
+        workers[i].end = right_count * (i + 1) / worker_count;
+    }
+    smalltime_run_workers(workers, sizeof(*workers), worker_count, run);
+}
+
+static uint64_t add_microseconds(uint64_t value, int64_t amount)
+{
+    return (uint64_t)smalltime_add_microseconds((smalltime)value, amount);
+}
+
+static uint64_t add_nanoseconds(uint64_t value, int64_t amount)
+{
+    return nanotime_add_nanoseconds(value, amount);
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+void smalltime_asof_join(const smalltime* left, size_t left_count,
+                         const smalltime* right, size_t right_count,
+                         size_t* matches, unsigned threads)
+{
+    join_worker join = {0};
+    join.left = (const uint64_t*)left;
+    join.left_count = left_count;
+    join.right = (const uint64_t*)right;
+    join.flip = SMALLTIME_KEY_FLIP;
+    join.matches = matches;
+    run_join(&join, right_count, threads, asof_part);
+}
+
+void nanotime_asof_join(const nanotime* left, size_t left_count,
+                        const nanotime* right, size_t right_count,
+                        size_t* matches, unsigned threads)
+{
+    join_worker join = {0};
+    join.left = left;
+    join.left_count = left_count;
+    join.right = right;
+    join.flip = NANOTIME_KEY_FLIP;
+    join.matches = matches;
+    run_join(&join, right_count, threads, asof_part);
+}
+
+void smalltime_window_join(const smalltime* left, size_t left_count,
+                           const smalltime* right, size_t right_count,
+                           int64_t microseconds_before, int64_t microseconds_after,
+                           size_t* starts, size_t* ends, unsigned threads)
+{
+    join_worker join = {0};
+    join.left = (const uint64_t*)left;
+    join.left_count = left_count;
+    join.right = (const uint64_t*)right;
+    join.flip = SMALLTIME_KEY_FLIP;
+    join.add = add_microseconds;
+    join.before = microseconds_before;
+    join.after = microseconds_after;
+    join.starts = starts;
+    join.ends = ends;
+    run_join(&join, right_count, threads, window_part);
+}
+
+void nanotime_window_join(const nanotime* left, size_t left_count,
+                          const nanotime* right, size_t right_count,
+                          int64_t nanoseconds_before, int64_t nanoseconds_after,
+                          size_t* starts, size_t* ends, unsigned threads)
+{
+    join_worker join = {0};
+    join.left = left;
+    join.left_count = left_count;
+    join.right = right;
+    join.flip = NANOTIME_KEY_FLIP;
+    join.add = add_nanoseconds;
+    join.before = nanoseconds_before;
+    join.after = nanoseconds_after;
+    join.starts = starts;
+    join.ends = ends;
+    run_join(&join, right_count, threads, window_part);
+}
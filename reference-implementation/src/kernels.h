@@ -0,0 +1,334 @@
+/*
+ * Internal declarations for the out-of-line kernels.
+ *
+ * Every kernel is built in several variants, one per instruction set level,
+ * using per-function target attributes so that a single translation unit
+ * can hold all of them regardless of the flags the library is built with.
+ */
+#ifndef KS_smalltime_kernels_H
+#define KS_smalltime_kernels_H
+
+#include <smalltime/arith.h>
+#include <smalltime/batch.h>
+#include <smalltime/calendar.h>
+#include <smalltime/convert.h>
+#include <smalltime/dispatch.h>
+#include <smalltime/epoch.h>
+#include <smalltime/format.h>
+#include <smalltime/parse.h>
+#include <smalltime/range.h>
+#include <smalltime/rollup.h>
+#include <smalltime/validate.h>
+#include "layout.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The SIMD kernels store fields into int columns 4 bytes at a time.
+typedef char smalltime_int_must_be_32_bits[sizeof(int) == 4 ? 1 : -1];
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define SMALLTIME_HAVE_X86_KERNELS 1
+    #define SMALLTIME_TARGET_SSE42  __attribute__((target("sse4.2")))
+    #define SMALLTIME_TARGET_AVX2   __attribute__((target("avx2")))
+    #define SMALLTIME_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+#endif
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+    #define SMALLTIME_DECLARE_KERNEL(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS; \
+        RETURN_TYPE NAME##_sse42 ARGS; \
+        RETURN_TYPE NAME##_avx2 ARGS; \
+        RETURN_TYPE NAME##_avx512 ARGS
+
+    // For kernels that only gain from the wider AVX-512 instruction set.
+    #define SMALLTIME_DECLARE_KERNEL_AVX512(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS; \
+        RETURN_TYPE NAME##_avx512 ARGS
+
+    // For kernels built around 128-bit byte shuffles, which gain nothing
+    // from wider registers.
+    #define SMALLTIME_DECLARE_KERNEL_SSE42(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS; \
+        RETURN_TYPE NAME##_sse42 ARGS
+#else
+    #define SMALLTIME_DECLARE_KERNEL(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS
+    #define SMALLTIME_DECLARE_KERNEL_AVX512(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS
+    #define SMALLTIME_DECLARE_KERNEL_SSE42(RETURN_TYPE, NAME, ARGS) \
+        RETURN_TYPE NAME##_scalar ARGS
+#endif
+
+// Picks the variant of a kernel for an instruction set level.
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+    #define SMALLTIME_SELECT_KERNEL(NAME, ISA) \
+        ((ISA) >= SMALLTIME_ISA_AVX512 ? NAME##_avx512 : \
+         (ISA) >= SMALLTIME_ISA_AVX2   ? NAME##_avx2 : \
+         (ISA) >= SMALLTIME_ISA_SSE42  ? NAME##_sse42 : \
+                                         NAME##_scalar)
+    #define SMALLTIME_SELECT_KERNEL_AVX512(NAME, ISA) \
+        ((ISA) >= SMALLTIME_ISA_AVX512 ? NAME##_avx512 : NAME##_scalar)
+    #define SMALLTIME_SELECT_KERNEL_SSE42(NAME, ISA) \
+        ((ISA) >= SMALLTIME_ISA_SSE42 ? NAME##_sse42 : NAME##_scalar)
+#else
+    #define SMALLTIME_SELECT_KERNEL(NAME, ISA) NAME##_scalar
+    #define SMALLTIME_SELECT_KERNEL_AVX512(NAME, ISA) NAME##_scalar
+    #define SMALLTIME_SELECT_KERNEL_SSE42(NAME, ISA) NAME##_scalar
+#endif
+
+
+// batch.c
+
+SMALLTIME_DECLARE_KERNEL(void, smalltime_batch_decode, (const smalltime* values, size_t count, const smalltime_columns* columns));
+SMALLTIME_DECLARE_KERNEL(void, smalltime_batch_encode, (const smalltime_columns* columns, size_t count, smalltime* values));
+SMALLTIME_DECLARE_KERNEL(void, nanotime_batch_decode, (const nanotime* values, size_t count, const nanotime_columns* columns));
+SMALLTIME_DECLARE_KERNEL(void, nanotime_batch_encode, (const nanotime_columns* columns, size_t count, nanotime* values));
+
+
+// epoch.c
+
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_batch_from_unix_seconds, (const int64_t* seconds, size_t count, smalltime* values));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_batch_from_unix_microseconds, (const int64_t* microseconds, size_t count, smalltime* values));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_batch_to_unix_seconds, (const smalltime* values, size_t count, int64_t* seconds));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_batch_to_unix_microseconds, (const smalltime* values, size_t count, int64_t* microseconds));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, nanotime_batch_from_unix_seconds, (const int64_t* seconds, size_t count, nanotime* values));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, nanotime_batch_from_unix_nanoseconds, (const int64_t* nanoseconds, size_t count, nanotime* values));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, nanotime_batch_to_unix_seconds, (const nanotime* values, size_t count, int64_t* seconds));
+SMALLTIME_DECLARE_KERNEL_AVX512(void, nanotime_batch_to_unix_nanoseconds, (const nanotime* values, size_t count, int64_t* nanoseconds));
+
+
+// arith.c
+
+// A field of a packed value, and the range of values it may hold.
+typedef struct
+{
+    int shift;
+    uint64_t mask;  // Applied after shifting.
+    int64_t min;    // Inclusive.
+    int64_t max;    // Exclusive.
+} smalltime_field_range;
+
+// Adds a constant amount to an array of packed values. Values whose fields
+// are all within range take the fast path of adding the precomputed
+// increment; all others go through the full calendar-aware add function.
+typedef struct
+{
+    smalltime_field_range ranges[2];
+    uint64_t increment;
+    int64_t amount;
+    uint64_t (*add)(uint64_t value, int64_t amount);
+} smalltime_field_add;
+
+SMALLTIME_DECLARE_KERNEL(void, smalltime_batch_add_field, (const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results));
+SMALLTIME_DECLARE_KERNEL(void, smalltime_batch_diff_us, (const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations));
+SMALLTIME_DECLARE_KERNEL(void, nanotime_batch_diff_ns, (const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations));
+
+
+// format.c
+
+SMALLTIME_DECLARE_KERNEL_AVX512(size_t, smalltime_batch_format_iso8601, (const smalltime* values, size_t count, size_t stride, char* buffer));
+SMALLTIME_DECLARE_KERNEL_AVX512(size_t, nanotime_batch_format_iso8601, (const nanotime* values, size_t count, size_t stride, char* buffer));
+
+
+// parse.c
+
+// Parse one timestamp, returning its length, or 0 with the offset of the
+// first invalid char in error_offset.
+SMALLTIME_DECLARE_KERNEL_SSE42(size_t, smalltime_parse_iso8601, (const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value, size_t* error_offset));
+SMALLTIME_DECLARE_KERNEL_SSE42(size_t, nanotime_parse_iso8601, (const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value, size_t* error_offset));
+SMALLTIME_DECLARE_KERNEL_SSE42(size_t, smalltime_batch_parse_iso8601, (const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding, smalltime* values, size_t capacity, size_t* end_offset));
+SMALLTIME_DECLARE_KERNEL_SSE42(size_t, nanotime_batch_parse_iso8601, (const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding, nanotime* values, size_t capacity, size_t* end_offset));
+
+
+// validate.c
+
+// Field layout of a time type, for the validation kernels.
+typedef struct
+{
+    int month_shift;
+    int day_shift;
+    int hour_shift;
+    int minute_shift;
+    int second_shift;
+    uint64_t fraction_mask;
+    uint64_t fractions_per_second;
+    // Checks a value on February 29th, which depends on the year.
+    int (*is_valid)(uint64_t value);
+} smalltime_validation_layout;
+
+// Flag invalid values, returning how many there are. invalid can be NULL.
+SMALLTIME_DECLARE_KERNEL(size_t, smalltime_batch_validate, (const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid));
+
+
+// codec.c
+
+// Field layout of a time type, for the codec kernels.
+typedef struct
+{
+    int hour_shift;
+    int minute_shift;
+    int second_shift;
+    uint64_t fraction_mask;
+    uint64_t fractions_per_second;
+} smalltime_codec_layout;
+
+// The packed streams of a block, with the headers already read.
+typedef struct
+{
+    const uint8_t* hour_bits;
+    const uint8_t* time_bits;
+    int hour_width;
+    int time_width;
+    int64_t hour_base;
+    int64_t time_base;
+    size_t count;  // Including the first value, which isn't packed.
+} smalltime_codec_block;
+
+// Unpack values 1 to count - 1 of a packed block. values[0] must already
+// hold the first value.
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_codec_decode_block, (const smalltime_codec_block* block, const smalltime_codec_layout* layout, uint64_t* values));
+
+
+// index.c
+
+// The most layers of internal nodes that an index can have.
+#define SMALLTIME_INDEX_MAX_HEIGHT 21
+
+// A static B-tree over a sorted array. Internal nodes are 8 keys (one
+// cache line), and node k's children are nodes k * 9 to k * 9 + 8 of the
+// layer below. Key j of a node is the first value of child j + 1's subtree,
+// or INT64_MAX if there's no such child. The sorted array itself is the
+// bottom layer, with node k being values k * 8 to k * 8 + 7.
+//
+// Keys are values xored with flip, so that both types compare as signed.
+typedef struct
+{
+    const int64_t* layers[SMALLTIME_INDEX_MAX_HEIGHT];  // Root first, 64-byte aligned.
+    int height;
+    const uint64_t* values;
+    size_t count;  // Never 0 when searched.
+    uint64_t flip;
+} smalltime_index_tree;
+
+SMALLTIME_DECLARE_KERNEL(void, smalltime_index_lower_bound, (const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results));
+
+
+// rollup.c
+
+// Which values are in a time bucket. A value is in the bucket if it
+// matches the bucket's start in the bits of upper_mask, and its field
+// (((value ^ flip) >> shift) & field_mask) is no less than the start's
+// and less than width past it. The flip makes the signed smalltime year
+// field count up as an unsigned one.
+typedef struct
+{
+    uint64_t upper_mask;
+    uint64_t flip;
+    int shift;
+    uint64_t field_mask;
+    uint64_t width;
+} smalltime_rollup_layout;
+
+// The values in a run are added up in this many lanes.
+#define SMALLTIME_ROLLUP_LANES 8
+
+typedef struct
+{
+    double sum;
+    double min;
+    double max;
+} smalltime_rollup_totals;
+
+// The number of values at the start of an array that are in the bucket
+// starting at bucket.
+SMALLTIME_DECLARE_KERNEL(size_t, smalltime_rollup_run_length, (const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout));
+
+// Totals of an array of values. Value i goes to lane i % 8, the lanes are
+// combined pairwise (lane i with lane i + 4, then i + 2, then i + 1), and
+// the values after the last whole 8 are then added one at a time, so that
+// every variant gives exactly the same sum.
+SMALLTIME_DECLARE_KERNEL(void, smalltime_rollup_aggregate, (const double* values, size_t count, smalltime_rollup_totals* totals));
+
+
+// range.c
+
+// Write first, first + delta, first + delta * 2 and so on.
+SMALLTIME_DECLARE_KERNEL(void, smalltime_range_fill_run, (uint64_t* values, uint64_t first, uint64_t delta, size_t count));
+
+// Write the values of day with their date fields replaced by date.
+SMALLTIME_DECLARE_KERNEL(void, smalltime_range_restamp, (uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count));
+
+
+// calendar.c
+
+// Field layout of a time type, for the calendar kernels. The year, shifted
+// forward by SMALLTIME_CIVIL_YEAR_SHIFT, is ((value ^ flip) >> year_shift)
+// + year_offset.
+typedef struct
+{
+    uint64_t flip;
+    int year_shift;
+    int64_t year_offset;
+    int month_shift;
+    int day_shift;
+} smalltime_calendar_layout;
+
+SMALLTIME_DECLARE_KERNEL_AVX512(void, smalltime_batch_calendar, (const uint64_t* values, size_t count, const smalltime_calendar_layout* layout, const smalltime_calendar_columns* columns));
+
+
+// convert.c
+
+SMALLTIME_DECLARE_KERNEL_AVX512(void, nanotime_batch_to_smalltime, (const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results));
+SMALLTIME_DECLARE_KERNEL_AVX512(size_t, smalltime_batch_to_nanotime, (const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range));
+
+
+// dispatch.c
+
+/**
+ * The variant of each kernel that the public API currently routes to.
+ * Starts out pointing at the scalar variants, and is upgraded to the best
+ * the CPU supports when the library is loaded.
+ */
+typedef struct
+{
+    void (*smalltime_batch_decode)(const smalltime* values, size_t count, const smalltime_columns* columns);
+    void (*smalltime_batch_encode)(const smalltime_columns* columns, size_t count, smalltime* values);
+    void (*nanotime_batch_decode)(const nanotime* values, size_t count, const nanotime_columns* columns);
+    void (*nanotime_batch_encode)(const nanotime_columns* columns, size_t count, nanotime* values);
+    void (*smalltime_batch_from_unix_seconds)(const int64_t* seconds, size_t count, smalltime* values);
+    void (*smalltime_batch_from_unix_microseconds)(const int64_t* microseconds, size_t count, smalltime* values);
+    void (*smalltime_batch_to_unix_seconds)(const smalltime* values, size_t count, int64_t* seconds);
+    void (*smalltime_batch_to_unix_microseconds)(const smalltime* values, size_t count, int64_t* microseconds);
+    void (*nanotime_batch_from_unix_seconds)(const int64_t* seconds, size_t count, nanotime* values);
+    void (*nanotime_batch_from_unix_nanoseconds)(const int64_t* nanoseconds, size_t count, nanotime* values);
+    void (*nanotime_batch_to_unix_seconds)(const nanotime* values, size_t count, int64_t* seconds);
+    void (*nanotime_batch_to_unix_nanoseconds)(const nanotime* values, size_t count, int64_t* nanoseconds);
+    void (*smalltime_batch_add_field)(const uint64_t* values, size_t count, const smalltime_field_add* op, uint64_t* results);
+    void (*smalltime_batch_diff_us)(const smalltime* ends, const smalltime* starts, size_t count, int64_t* durations);
+    void (*nanotime_batch_diff_ns)(const nanotime* ends, const nanotime* starts, size_t count, int64_t* durations);
+    size_t (*smalltime_batch_format_iso8601)(const smalltime* values, size_t count, size_t stride, char* buffer);
+    size_t (*nanotime_batch_format_iso8601)(const nanotime* values, size_t count, size_t stride, char* buffer);
+    size_t (*smalltime_parse_iso8601)(const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value, size_t* error_offset);
+    size_t (*nanotime_parse_iso8601)(const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value, size_t* error_offset);
+    size_t (*smalltime_batch_parse_iso8601)(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding, smalltime* values, size_t capacity, size_t* end_offset);
+    size_t (*nanotime_batch_parse_iso8601)(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding, nanotime* values, size_t capacity, size_t* end_offset);
+    size_t (*smalltime_batch_validate)(const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid);
+    void (*smalltime_codec_decode_block)(const smalltime_codec_block* block, const smalltime_codec_layout* layout, uint64_t* values);
+    void (*smalltime_index_lower_bound)(const smalltime_index_tree* tree, const uint64_t* values, size_t count, size_t* results);
+    size_t (*smalltime_rollup_run_length)(const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout);
+    void (*smalltime_rollup_aggregate)(const double* values, size_t count, smalltime_rollup_totals* totals);
+    void (*smalltime_range_fill_run)(uint64_t* values, uint64_t first, uint64_t delta, size_t count);
+    void (*smalltime_range_restamp)(uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count);
+    void (*smalltime_batch_calendar)(const uint64_t* values, size_t count, const smalltime_calendar_layout* layout, const smalltime_calendar_columns* columns);
+    void (*nanotime_batch_to_smalltime)(const nanotime* values, size_t count, smalltime_convert_rounding rounding, smalltime* results);
+    size_t (*smalltime_batch_to_nanotime)(const smalltime* values, size_t count, nanotime* results, uint64_t* out_of_range);
+} smalltime_kernel_table;
+
+extern smalltime_kernel_table smalltime_kernels;
+
+#ifdef __cplusplus
+}
+#endif
+#endif // KS_smalltime_kernels_H
@@ -0,0 +1,51 @@
+/*
+ * Bit layouts of smalltime and nanotime, for use by the library sources.
+ *
+ * The public headers undef their own copies of these, so the kernels keep
+ * a private set. Values are taken straight from the specifications.
+ */
+#ifndef KS_smalltime_layout_H
+#define KS_smalltime_layout_H
+
+#define ST_SHIFT_YEAR    46
+#define ST_SHIFT_MONTH   42
+#define ST_SHIFT_DAY     37
+#define ST_SHIFT_HOUR    32
+#define ST_SHIFT_MINUTE  26
+#define ST_SHIFT_SECOND  20
+
+#define ST_WIDTH_YEAR        18
+#define ST_WIDTH_MICROSECOND 20
+
+#define ST_MASK_YEAR        (0x3ffffLL << ST_SHIFT_YEAR)
+#define ST_MASK_MONTH       (0xfLL     << ST_SHIFT_MONTH)
+#define ST_MASK_DAY         (0x1fLL    << ST_SHIFT_DAY)
+#define ST_MASK_HOUR        (0x1fLL    << ST_SHIFT_HOUR)
+#define ST_MASK_MINUTE      (0x3fLL    << ST_SHIFT_MINUTE)
+#define ST_MASK_SECOND      (0x3fLL    << ST_SHIFT_SECOND)
+#define ST_MASK_MICROSECOND 0xfffffLL
+
+#define ST_MIN_YEAR -131072
+#define ST_MAX_YEAR  131071
+
+#define NT_ZERO_YEAR 1970
+
+#define NT_SHIFT_YEAR    56
+#define NT_SHIFT_MONTH   52
+#define NT_SHIFT_DAY     47
+#define NT_SHIFT_HOUR    42
+#define NT_SHIFT_MINUTE  36
+#define NT_SHIFT_SECOND  30
+
+#define NT_MASK_YEAR       (0xffULL << NT_SHIFT_YEAR)
+#define NT_MASK_MONTH      (0xfULL  << NT_SHIFT_MONTH)
+#define NT_MASK_DAY        (0x1fULL << NT_SHIFT_DAY)
+#define NT_MASK_HOUR       (0x1fULL << NT_SHIFT_HOUR)
+#define NT_MASK_MINUTE     (0x3fULL << NT_SHIFT_MINUTE)
+#define NT_MASK_SECOND     (0x3fULL << NT_SHIFT_SECOND)
+#define NT_MASK_NANOSECOND 0x3fffffffULL
+
+#define NT_MIN_YEAR NT_ZERO_YEAR
+#define NT_MAX_YEAR (NT_ZERO_YEAR + 255)
+
+#endif // KS_smalltime_layout_H
@@ -0,0 +1,361 @@
+#include <smalltime/leap.h>
+#include <smalltime/arith.h>
+#include <smalltime/convert.h>
+#include <smalltime/epoch.h>
+#include "layout.h"
+#include "tables.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// Seconds from the NTP epoch (1900-01-01) to the Unix epoch.
+#define NTP_TO_UNIX 2208988800LL
+// Far more entries than there will ever be leap seconds.
+#define MAX_ENTRIES 1024
+// TAI - UTC has never been far from 0.
+#define MAX_OFFSET 100000
+
+// Built by build_table(), with the arrays in the same block as the header.
+struct smalltime_leap_table
+{
+    // TAI - UTC is offsets[i] from utc_starts[i] (UTC) and tai_starts[i]
+    // (TAI) on. Entry 0 starts before every value.
+    size_t count;
+    const int64_t* utc_starts;
+    const int64_t* tai_starts;
+    const int32_t* offsets;
+    // Nonzero if entry i starts with a leap second (second 60 of the day
+    // before utc_starts[i]), in which case tai_starts[i] is its start.
+    const uint8_t* leaps;
+    smalltime expires;
+};
+
+static const int64_t empty_starts[1] = {INT64_MIN};
+static const int32_t empty_offsets[1] = {0};
+static const uint8_t empty_leaps[1] = {0};
+static const smalltime_leap_table empty_table = {1, empty_starts, empty_starts, empty_offsets, empty_leaps, 0};
+
+// Only access atomically.
+static smalltime_leap_table* current_table = NULL;
+
+// Readers inside smalltime_leap_read_lock(), counted by the phase they
+// entered in. A grace period flips the phase, then waits for the old
+// phase's count to drain. Only access atomically.
+static size_t reader_counts[2] = {0, 0};
+static unsigned reader_phase = 0;
+// Held by the thread waiting out a grace period.
+static unsigned char synchronize_lock = 0;
+
+static inline const smalltime_leap_table* table_or_empty(const smalltime_leap_table* table)
+{
+    return table != NULL ? table : &empty_table;
+}
+
+static inline int32_t offset_at(const smalltime_leap_table* table, smalltime time)
+{
+    table = table_or_empty(table);
+    return table->offsets[smalltime_table_search(table->utc_starts, table->count, time)];
+}
+
+static inline smalltime to_tai(const smalltime_leap_table* table, smalltime time)
+{
+    return smalltime_add_seconds(time, offset_at(table, time));
+}
+
+static inline smalltime from_tai(const smalltime_leap_table* table, smalltime time)
+{
+    table = table_or_empty(table);
+    size_t entry = smalltime_table_search(table->tai_starts, table->count, time);
+    if(table->leaps[entry] && (time & ~ST_MASK_MICROSECOND) == table->tai_starts[entry])
+    {
+        smalltime last_second = smalltime_add_seconds(table->utc_starts[entry], -1);
+        return (last_second & ~ST_MASK_SECOND) | ((smalltime)60 << ST_SHIFT_SECOND) | (time & ST_MASK_MICROSECOND);
+    }
+    return smalltime_add_seconds(time, -table->offsets[entry]);
+}
+
+
+// ==================================================================
+// Loading
+// ==================================================================
+
+static const char* skip_blanks(const char* text)
+{
+    while(*text == ' ' || *text == '\t' || *text == '\r')
+    {
+        text++;
+    }
+    return text;
+}
+
+static int parse_integer(const char** text, int64_t min, int64_t max, int64_t* value)
+{
+    const char* p = *text;
+    int is_negative = *p == '-';
+    p += is_negative || *p == '+';
+    int64_t number = 0;
+    const char* digits = p;
+    for(; *p >= '0' && *p <= '9' && p - digits < 12; p++)
+    {
+        number = number * 10 + (*p - '0');
+    }
+    number = is_negative ? -number : number;
+    if(p == digits || (*p >= '0' && *p <= '9') || number < min || number > max)
+    {
+        return 0;
+    }
+    *text = p;
+    *value = number;
+    return 1;
+}
+
+// An NTP timestamp at the start of a day, as a smalltime value.
+static int parse_day_start(const char** text, smalltime* time)
+{
+    int64_t ntp_seconds;
+    if(!parse_integer(text, 0, 99999999999LL, &ntp_seconds) || ntp_seconds % SECONDS_PER_DAY != 0)
+    {
+        return 0;
+    }
+    *time = smalltime_from_unix_seconds(ntp_seconds - NTP_TO_UNIX);
+    return 1;
+}
+
+// Packs the entries into a single allocation.
+static smalltime_leap_table* build_table(const smalltime* starts, const int32_t* offsets, size_t count, smalltime expires)
+{
+    size_t size = sizeof(smalltime_leap_table) + count * (2 * sizeof(int64_t) + sizeof(int32_t) + sizeof(uint8_t));
+    smalltime_leap_table* table = malloc(size);
+    if(table == NULL)
+    {
+        return NULL;
+    }
+    int64_t* utc_starts = (int64_t*)(table + 1);
+    int64_t* tai_starts = utc_starts + count;
+    int32_t* table_offsets = (int32_t*)(tai_starts + count);
+    uint8_t* leaps = (uint8_t*)(table_offsets + count);
+
+    memcpy(table_offsets, offsets, count * sizeof(*offsets));
+    for(size_t i = 0; i < count; i++)
+    {
+        leaps[i] = i > 0 && offsets[i] > offsets[i - 1];
+        utc_starts[i] = i == 0 ? INT64_MIN : starts[i];
+        tai_starts[i] = i == 0 ? INT64_MIN : smalltime_add_seconds(starts[i], offsets[i] - leaps[i]);
+    }
+
+    table->count = count;
+    table->utc_starts = utc_starts;
+    table->tai_starts = tai_starts;
+    table->offsets = table_offsets;
+    table->leaps = leaps;
+    table->expires = expires;
+    return table;
+}
+
+// Parses a leap-seconds.list file, setting errno to EINVAL if it isn't valid.
+static smalltime_leap_table* parse_leap_seconds(const char* text)
+{
+    smalltime starts[MAX_ENTRIES];
+    int32_t offsets[MAX_ENTRIES];
+    size_t count = 0;
+    smalltime expires = 0;
+
+    const char* line = text;
+    while(*line != 0)
+    {
+        const char* end = strchr(line, '\n');
+        end = end != NULL ? end : line + strlen(line);
+        const char* p = skip_blanks(line);
+        if(p[0] == '#' && p[1] == '@')
+        {
+            p = skip_blanks(p + 2);
+            if(!parse_day_start(&p, &expires))
+            {
+                goto invalid;
+            }
+        }
+        else if(*p != '#' && p != end)
+        {
+            int64_t offset;
+            if(count == MAX_ENTRIES || !parse_day_start(&p, &starts[count]) ||
+               (p = skip_blanks(p), !parse_integer(&p, -MAX_OFFSET, MAX_OFFSET, &offset)))
+            {
+                goto invalid;
+            }
+            // Each entry after the first adds or removes one leap second.
+            int64_t change = count > 0 ? offset - offsets[count - 1] : 1;
+            if(change * change != 1 || (count > 0 && starts[count] <= starts[count - 1]))
+            {
+                goto invalid;
+            }
+            offsets[count++] = (int32_t)offset;
+        }
+        else
+        {
+            p = end;
+        }
+        p = skip_blanks(p);
+        if(p != end && *p != '#')
+        {
+            goto invalid;
+        }
+        line = *end != 0 ? end + 1 : end;
+    }
+    if(count == 0)
+    {
+        goto invalid;
+    }
+
+    smalltime_leap_table* table = build_table(starts, offsets, count, expires);
+    if(table == NULL)
+    {
+        errno = ENOMEM;
+    }
+    return table;
+
+invalid:
+    errno = EINVAL;
+    return NULL;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+smalltime_leap_table* smalltime_leap_table_open(const char* path)
+{
+    size_t length;
+    uint8_t* text = smalltime_read_file(path, &length);
+    if(text == NULL)
+    {
+        return NULL;
+    }
+    smalltime_leap_table* table = parse_leap_seconds((const char*)text);
+    free(text);
+    return table;
+}
+
+void smalltime_leap_table_close(smalltime_leap_table* table)
+{
+    free(table);
+}
+
+smalltime smalltime_leap_table_expires(const smalltime_leap_table* table)
+{
+    return table->expires;
+}
+
+const smalltime_leap_table* smalltime_leap_current(void)
+{
+    return __atomic_load_n(&current_table, __ATOMIC_ACQUIRE);
+}
+
+smalltime_leap_table* smalltime_leap_publish(smalltime_leap_table* table)
+{
+    return __atomic_exchange_n(&current_table, table, __ATOMIC_SEQ_CST);
+}
+
+int smalltime_leap_read_lock(void)
+{
+    for(;;)
+    {
+        unsigned phase = __atomic_load_n(&reader_phase, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&reader_counts[phase], 1, __ATOMIC_SEQ_CST);
+        // If a grace period started in between, it may not wait for this
+        // count, so enter again in the new phase.
+        if(__atomic_load_n(&reader_phase, __ATOMIC_SEQ_CST) == phase)
+        {
+            return (int)phase;
+        }
+        __atomic_sub_fetch(&reader_counts[phase], 1, __ATOMIC_RELEASE);
+    }
+}
+
+void smalltime_leap_read_unlock(int token)
+{
+    __atomic_sub_fetch(&reader_counts[token], 1, __ATOMIC_RELEASE);
+}
+
+void smalltime_leap_synchronize(void)
+{
+    while(__atomic_test_and_set(&synchronize_lock, __ATOMIC_ACQUIRE))
+    {
+    }
+    unsigned phase = __atomic_fetch_xor(&reader_phase, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&reader_counts[phase], __ATOMIC_ACQUIRE) != 0)
+    {
+    }
+    __atomic_clear(&synchronize_lock, __ATOMIC_RELEASE);
+}
+
+void smalltime_leap_replace(smalltime_leap_table* table)
+{
+    smalltime_leap_table* old_table = smalltime_leap_publish(table);
+    smalltime_leap_synchronize();
+    smalltime_leap_table_close(old_table);
+}
+
+int32_t smalltime_leap_offset(const smalltime_leap_table* table, smalltime time)
+{
+    return offset_at(table, time);
+}
+
+int32_t nanotime_leap_offset(const smalltime_leap_table* table, nanotime time)
+{
+    return offset_at(table, smalltime_table_nanotime_key(time));
+}
+
+smalltime smalltime_leap_to_tai(const smalltime_leap_table* table, smalltime time)
+{
+    return to_tai(table, time);
+}
+
+int nanotime_leap_to_tai(const smalltime_leap_table* table, nanotime time, nanotime* result)
+{
+    return smalltime_table_nanotime_result(to_tai(table, smalltime_table_nanotime_key(time)), time, result);
+}
+
+smalltime smalltime_leap_from_tai(const smalltime_leap_table* table, smalltime time)
+{
+    return from_tai(table, time);
+}
+
+int nanotime_leap_from_tai(const smalltime_leap_table* table, nanotime time, nanotime* result)
+{
+    return smalltime_table_nanotime_result(from_tai(table, smalltime_table_nanotime_key(time)), time, result);
+}
+
+int64_t smalltime_leap_diff_us(const smalltime_leap_table* table, smalltime end, smalltime start)
+{
+    return smalltime_diff_us(end, start) + (int64_t)(offset_at(table, end) - offset_at(table, start)) * 1000000;
+}
+
+int64_t nanotime_leap_diff_ns(const smalltime_leap_table* table, nanotime end, nanotime start)
+{
+    return nanotime_diff_ns(end, start) +
+           (int64_t)(offset_at(table, smalltime_table_nanotime_key(end)) - offset_at(table, smalltime_table_nanotime_key(start))) * 1000000000;
+}
+
+void smalltime_leap_batch_diff_us(const smalltime_leap_table* table, const smalltime* ends, const smalltime* starts,
+                                  size_t count, int64_t* durations)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        durations[i] = smalltime_leap_diff_us(table, ends[i], starts[i]);
+    }
+}
+
+void nanotime_leap_batch_diff_ns(const smalltime_leap_table* table, const nanotime* ends, const nanotime* starts,
+                                 size_t count, int64_t* durations)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        durations[i] = nanotime_leap_diff_ns(table, ends[i], starts[i]);
+    }
+}
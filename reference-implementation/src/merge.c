@@ -0,0 +1,570 @@
+#include "workers.h"
+#include <smalltime/merge.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// Each thread needs enough values to be worth starting.
+#define MIN_VALUES_PER_THREAD 65536
+
+// Keys are the values xored with flip, which orders smalltime values
+// (whose sign bit flips) and nanotime values (which are left alone) as
+// unsigned integers.
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+// The first position in values whose key isn't less than key.
+static size_t lower_bound(const uint64_t* values, size_t count, uint64_t key, uint64_t flip)
+{
+    size_t start = 0;
+    size_t end = count;
+    while(start < end)
+    {
+        size_t middle = start + (end - start) / 2;
+        if((values[middle] ^ flip) < key)
+        {
+            start = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+    return start;
+}
+
+
+// ==================================================================
+// Loser Tree
+// ==================================================================
+
+typedef struct
+{
+    // The stream's current batch. A callback stream is asked for its next
+    // batch when this one runs out.
+    const uint64_t* next;
+    const uint64_t* end;
+    smalltime_merge_source smalltime_source;
+    nanotime_merge_source nanotime_source;
+    void* context;
+} merge_stream;
+
+// A stream's head key, and its rank, which breaks ties between equal keys.
+// A stream ranks by its number while it has values, and after every other
+// stream (by its number plus leaf_count) once it has ended.
+typedef struct
+{
+    uint64_t key;
+    size_t rank;
+} merge_node;
+
+typedef struct
+{
+    uint64_t flip;
+    merge_stream* streams;
+    size_t stream_count;
+    size_t stream_capacity;
+    // The tree has leaf_count leaves (a power of two), and the leaves past
+    // stream_count are streams that have already ended. nodes[0] holds the
+    // winner, and the rest hold the loser of the match played there, with
+    // the children of node n at 2n and 2n + 1, and the leaves below that.
+    merge_node* nodes;
+    size_t leaf_count;
+    int started;
+} merger;
+
+// Written without short-circuiting, since matches between interleaved
+// streams are unpredictable, and branches on them mostly mispredict. Where
+// there's a 128-bit type, key and rank are compared as one number, which
+// takes a compare and a subtract with borrow.
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 node_order;
+#endif
+
+static inline int beats(merge_node a, merge_node b)
+{
+#if defined(__SIZEOF_INT128__)
+    return (((node_order)a.key << 64) | a.rank) < (((node_order)b.key << 64) | b.rank);
+#else
+    return (a.key < b.key) | ((a.key == b.key) & (a.rank < b.rank));
+#endif
+}
+
+static int merger_init(merger* merger, uint64_t flip)
+{
+    memset(merger, 0, sizeof(*merger));
+    merger->flip = flip;
+    merger->leaf_count = 1;
+    merger->nodes = malloc(sizeof(*merger->nodes));
+    return merger->nodes != NULL;
+}
+
+static void merger_deinit(merger* merger)
+{
+    free(merger->streams);
+    free(merger->nodes);
+}
+
+static int merger_add(merger* merger, const uint64_t* values, size_t count,
+                      smalltime_merge_source smalltime_source, nanotime_merge_source nanotime_source, void* context)
+{
+    if(merger->started || merger->stream_count == UINT32_MAX)
+    {
+        return 0;
+    }
+    if(merger->stream_count == merger->stream_capacity)
+    {
+        size_t capacity = merger->stream_capacity == 0 ? 16 : merger->stream_capacity * 2;
+        merge_stream* streams = realloc(merger->streams, capacity * sizeof(*streams));
+        if(streams == NULL)
+        {
+            return 0;
+        }
+        merger->streams = streams;
+        merger->stream_capacity = capacity;
+    }
+    if(merger->stream_count == merger->leaf_count)
+    {
+        merge_node* nodes = realloc(merger->nodes, merger->leaf_count * 2 * sizeof(*nodes));
+        if(nodes == NULL)
+        {
+            return 0;
+        }
+        merger->nodes = nodes;
+        merger->leaf_count *= 2;
+    }
+
+    merge_stream* stream = &merger->streams[merger->stream_count++];
+    stream->next = values;
+    stream->end = values + count;
+    stream->smalltime_source = smalltime_source;
+    stream->nanotime_source = nanotime_source;
+    stream->context = context;
+    return 1;
+}
+
+// Gets a stream's next batch, returning 0 if it has ended.
+static int refill(merge_stream* stream)
+{
+    size_t count = 0;
+    if(stream->smalltime_source != NULL)
+    {
+        const smalltime* values = NULL;
+        count = stream->smalltime_source(stream->context, &values);
+        stream->next = (const uint64_t*)values;
+    }
+    else if(stream->nanotime_source != NULL)
+    {
+        const nanotime* values = NULL;
+        count = stream->nanotime_source(stream->context, &values);
+        stream->next = values;
+    }
+    if(count == 0)
+    {
+        stream->next = stream->end = NULL;
+        stream->smalltime_source = NULL;
+        stream->nanotime_source = NULL;
+        return 0;
+    }
+    stream->end = stream->next + count;
+    return 1;
+}
+
+static merge_node head(const merger* merger, size_t number)
+{
+    merge_node node = {UINT64_MAX, merger->leaf_count + number};
+    if(number < merger->stream_count)
+    {
+        merge_stream* stream = &merger->streams[number];
+        if(stream->next < stream->end || refill(stream))
+        {
+            node.key = *stream->next ^ merger->flip;
+            node.rank = number;
+        }
+    }
+    return node;
+}
+
+// Plays every match below a node, returning the winner.
+static merge_node play(merger* merger, size_t node)
+{
+    if(node >= merger->leaf_count)
+    {
+        return head(merger, node - merger->leaf_count);
+    }
+    merge_node winner = play(merger, node * 2);
+    merge_node loser = play(merger, node * 2 + 1);
+    if(beats(loser, winner))
+    {
+        merge_node swap = winner;
+        winner = loser;
+        loser = swap;
+    }
+    merger->nodes[node] = loser;
+    return winner;
+}
+
+// The best of the losers on a leaf's path, which is the node that the
+// winner at that leaf has to beat to stay the winner.
+static merge_node runner_up(const merge_node* nodes, size_t leaf)
+{
+    merge_node best = {UINT64_MAX, SIZE_MAX};
+    for(size_t node = leaf >> 1; node > 0; node >>= 1)
+    {
+        if(beats(nodes[node], best))
+        {
+            best = nodes[node];
+        }
+    }
+    return best;
+}
+
+// Copies values from the winning stream for as long as they beat limit.
+static size_t copy_run(merger* merger, size_t number, merge_node limit,
+                       uint64_t* values, uint32_t* streams, size_t capacity)
+{
+    merge_stream* stream = &merger->streams[number];
+    const uint64_t flip = merger->flip;
+    size_t written = 0;
+    for(;;)
+    {
+        const uint64_t* next = stream->next;
+        size_t available = (size_t)(stream->end - next);
+        size_t length = available < capacity - written ? available : capacity - written;
+        size_t run = 0;
+        while(run < length && ((next[run] ^ flip) < limit.key || ((next[run] ^ flip) == limit.key && number < limit.rank)))
+        {
+            run++;
+        }
+        memcpy(values + written, next, run * sizeof(*values));
+        if(streams != NULL)
+        {
+            for(size_t i = 0; i < run; i++)
+            {
+                streams[written + i] = (uint32_t)number;
+            }
+        }
+        written += run;
+        stream->next += run;
+        if(run < available || written == capacity || !refill(stream))
+        {
+            return written;
+        }
+    }
+}
+
+static size_t merger_next(merger* merger, uint64_t* values, uint32_t* streams, size_t capacity)
+{
+    if(!merger->started)
+    {
+        merger->nodes[0] = play(merger, 1);
+        merger->started = 1;
+    }
+
+    const uint64_t flip = merger->flip;
+    const size_t leaf_count = merger->leaf_count;
+    merge_node* nodes = merger->nodes;
+    merge_node winner = nodes[0];
+    size_t previous = SIZE_MAX;
+    size_t written = 0;
+    while(written < capacity && winner.rank < leaf_count)
+    {
+        size_t number = winner.rank;
+        merge_stream* stream = &merger->streams[number];
+        values[written] = winner.key ^ flip;
+        if(streams != NULL)
+        {
+            streams[written] = (uint32_t)number;
+        }
+        written++;
+        stream->next++;
+
+        // A stream that wins twice in a row probably has a run of values
+        // that win, which can be copied without playing any matches.
+        if(number == previous && written < capacity)
+        {
+            merge_node limit = runner_up(nodes, leaf_count + number);
+            written += copy_run(merger, number, limit, values + written,
+                                streams != NULL ? streams + written : NULL, capacity - written);
+        }
+        previous = number;
+
+        if(stream->next < stream->end || refill(stream))
+        {
+            winner.key = *stream->next ^ flip;
+        }
+        else
+        {
+            winner.key = UINT64_MAX;
+            winner.rank += leaf_count;
+        }
+        for(size_t node = (leaf_count + number) >> 1; node > 0; node >>= 1)
+        {
+            // Swapped with masks, since compilers tend to turn selects
+            // back into branches.
+            merge_node challenger = nodes[node];
+            uint64_t swap = (uint64_t)0 - (uint64_t)beats(challenger, winner);
+            uint64_t key_change = (challenger.key ^ winner.key) & swap;
+            size_t rank_change = (challenger.rank ^ winner.rank) & (size_t)swap;
+            nodes[node].key = challenger.key ^ key_change;
+            nodes[node].rank = challenger.rank ^ rank_change;
+            winner.key ^= key_change;
+            winner.rank ^= rank_change;
+        }
+    }
+    nodes[0] = winner;
+    return written;
+}
+
+
+// ==================================================================
+// Parallel Merge
+// ==================================================================
+
+// One thread's part of the output, and where it starts and ends in each
+// array.
+typedef struct
+{
+    const uint64_t* const* arrays;
+    size_t array_count;
+    const size_t* starts;
+    const size_t* ends;
+    uint64_t* values;
+    uint32_t* streams;
+    size_t count;
+    uint64_t flip;
+    int success;
+} merge_worker;
+
+static void merge_part(void* job)
+{
+    merge_worker* worker = job;
+    merger merger;
+    worker->success = merger_init(&merger, worker->flip);
+    for(size_t i = 0; i < worker->array_count && worker->success; i++)
+    {
+        worker->success = merger_add(&merger, worker->arrays[i] + worker->starts[i],
+                                     worker->ends[i] - worker->starts[i], NULL, NULL, NULL);
+    }
+    if(worker->success)
+    {
+        merger_next(&merger, worker->values, worker->streams, worker->count);
+    }
+    merger_deinit(&merger);
+}
+
+static size_t count_less(const uint64_t* const* arrays, const size_t* counts, size_t array_count,
+                         uint64_t key, uint64_t flip)
+{
+    size_t total = 0;
+    for(size_t i = 0; i < array_count; i++)
+    {
+        total += lower_bound(arrays[i], counts[i], key, flip);
+    }
+    return total;
+}
+
+// The smallest key that at least target values are less than (or the
+// largest key if there's none), found by binary search over the keys.
+static uint64_t split_key(const uint64_t* const* arrays, const size_t* counts, size_t array_count,
+                          size_t target, uint64_t flip)
+{
+    uint64_t low = 0;
+    uint64_t high = UINT64_MAX;
+    while(low < high)
+    {
+        uint64_t middle = low + (high - low) / 2;
+        if(count_less(arrays, counts, array_count, middle, flip) >= target)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+static int merge_arrays(const uint64_t* const* arrays, const size_t* counts, size_t array_count,
+                        uint64_t* values, uint32_t* streams, unsigned threads, uint64_t flip)
+{
+    if(array_count > UINT32_MAX)
+    {
+        return 0;
+    }
+    size_t total = 0;
+    for(size_t i = 0; i < array_count; i++)
+    {
+        total += counts[i];
+    }
+
+    size_t worker_count = threads == 0 ? smalltime_cpu_count() : threads;
+    worker_count = worker_count < total / MIN_VALUES_PER_THREAD ? worker_count : total / MIN_VALUES_PER_THREAD;
+    worker_count = worker_count < 1 ? 1 : worker_count > SMALLTIME_MAX_WORKERS ? SMALLTIME_MAX_WORKERS : worker_count;
+
+    // Worker n's part of array i is between positions[n * array_count + i]
+    // and positions[(n + 1) * array_count + i]. There's one extra position,
+    // so that it's never empty.
+    merge_worker* workers = malloc(worker_count * sizeof(*workers));
+    size_t* positions = malloc(((worker_count + 1) * array_count + 1) * sizeof(*positions));
+    if(workers == NULL || positions == NULL)
+    {
+        free(workers);
+        free(positions);
+        return 0;
+    }
+    for(size_t i = 0; i < array_count; i++)
+    {
+        positions[i] = 0;
+        positions[worker_count * array_count + i] = counts[i];
+    }
+    for(size_t n = 1; n < worker_count; n++)
+    {
+        uint64_t key = split_key(arrays, counts, array_count, total * n / worker_count, flip);
+        for(size_t i = 0; i < array_count; i++)
+        {
+            positions[n * array_count + i] = lower_bound(arrays[i], counts[i], key, flip);
+        }
+    }
+
+    size_t offset = 0;
+    for(size_t n = 0; n < worker_count; n++)
+    {
+        merge_worker* worker = &workers[n];
+        worker->arrays = arrays;
+        worker->array_count = array_count;
+        worker->starts = &positions[n * array_count];
+        worker->ends = &positions[(n + 1) * array_count];
+        worker->values = values + offset;
+        worker->streams = streams != NULL ? streams + offset : NULL;
+        worker->count = 0;
+        for(size_t i = 0; i < array_count; i++)
+        {
+            worker->count += worker->ends[i] - worker->starts[i];
+        }
+        worker->flip = flip;
+        offset += worker->count;
+    }
+    smalltime_run_workers(workers, sizeof(*workers), worker_count, merge_part);
+
+    int success = 1;
+    for(size_t n = 0; n < worker_count; n++)
+    {
+        success &= workers[n].success;
+    }
+    free(workers);
+    free(positions);
+    return success;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+struct smalltime_merge
+{
+    merger merger;
+};
+
+struct nanotime_merge
+{
+    merger merger;
+};
+
+smalltime_merge* smalltime_merge_new(void)
+{
+    smalltime_merge* merge = malloc(sizeof(*merge));
+    if(merge != NULL && !merger_init(&merge->merger, SMALLTIME_KEY_FLIP))
+    {
+        free(merge);
+        merge = NULL;
+    }
+    return merge;
+}
+
+nanotime_merge* nanotime_merge_new(void)
+{
+    nanotime_merge* merge = malloc(sizeof(*merge));
+    if(merge != NULL && !merger_init(&merge->merger, NANOTIME_KEY_FLIP))
+    {
+        free(merge);
+        merge = NULL;
+    }
+    return merge;
+}
+
+void smalltime_merge_free(smalltime_merge* merge)
+{
+    merger_deinit(&merge->merger);
+    free(merge);
+}
+
+void nanotime_merge_free(nanotime_merge* merge)
+{
+    merger_deinit(&merge->merger);
+    free(merge);
+}
+
+int smalltime_merge_add_source(smalltime_merge* merge, smalltime_merge_source source, void* context)
+{
+    return merger_add(&merge->merger, NULL, 0, source, NULL, context);
+}
+
+int nanotime_merge_add_source(nanotime_merge* merge, nanotime_merge_source source, void* context)
+{
+    return merger_add(&merge->merger, NULL, 0, NULL, source, context);
+}
+
+int smalltime_merge_add_array(smalltime_merge* merge, const smalltime* values, size_t count)
+{
+    return merger_add(&merge->merger, (const uint64_t*)values, count, NULL, NULL, NULL);
+}
+
+int nanotime_merge_add_array(nanotime_merge* merge, const nanotime* values, size_t count)
+{
+    return merger_add(&merge->merger, values, count, NULL, NULL, NULL);
+}
+
+int smalltime_merge_add_column(smalltime_merge* merge, const smalltime_column* column)
+{
+    size_t count = 0;
+    const smalltime* values = smalltime_column_values(column, &count);
+    return smalltime_merge_add_array(merge, values, count);
+}
+
+int nanotime_merge_add_column(nanotime_merge* merge, const nanotime_column* column)
+{
+    size_t count = 0;
+    const nanotime* values = nanotime_column_values(column, &count);
+    return nanotime_merge_add_array(merge, values, count);
+}
+
+size_t smalltime_merge_next(smalltime_merge* merge, smalltime* values, uint32_t* streams, size_t capacity)
+{
+    return merger_next(&merge->merger, (uint64_t*)values, streams, capacity);
+}
+
+size_t nanotime_merge_next(nanotime_merge* merge, nanotime* values, uint32_t* streams, size_t capacity)
+{
+    return merger_next(&merge->merger, values, streams, capacity);
+}
+
+int smalltime_merge_arrays(const smalltime* const* arrays, const size_t* counts, size_t array_count,
+                           smalltime* values, uint32_t* streams, unsigned threads)
+{
+    return merge_arrays((const uint64_t* const*)arrays, counts, array_count, (uint64_t*)values, streams, threads,
+                        SMALLTIME_KEY_FLIP);
+}
+
+int nanotime_merge_arrays(const nanotime* const* arrays, const size_t* counts, size_t array_count,
+                          nanotime* values, uint32_t* streams, unsigned threads)
+{
+    return merge_arrays(arrays, counts, array_count, values, streams, threads, NANOTIME_KEY_FLIP);
+}
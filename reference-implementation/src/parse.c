@@ -0,0 +1,545 @@
+#include "kernels.h"
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// "YYYY-MM-DDTHH:MM:SS", which every timestamp starts with (after the sign
+// and leading digits of an expanded year).
+#define FIXED_LENGTH 19
+
+typedef struct
+{
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    uint32_t fraction;
+    // 1 if the fraction was rounded up into the next second.
+    int carry;
+    // Seconds east of UTC.
+    int offset;
+} parsed_timestamp;
+
+static inline int is_digit(char ch)
+{
+    return (unsigned char)(ch - '0') < 10;
+}
+
+static inline int is_time_separator(char ch)
+{
+    return ch == 'T' || ch == 't' || ch == ' ';
+}
+
+static inline int two_digits(const char* text)
+{
+    return (text[0] - '0') * 10 + (text[1] - '0');
+}
+
+// Parses the sign and leading digits of an expanded year, if any, leaving
+// the offset where the fixed part starts in *start.
+static inline int parse_year_prefix(const char* text, size_t length, int* sign, int* leading, size_t* start, size_t* error)
+{
+    *sign = 0;
+    *leading = 0;
+    *start = 0;
+    if(length == 0 || (text[0] != '+' && text[0] != '-'))
+    {
+        return 1;
+    }
+    for(size_t i = 1; i < 3; i++)
+    {
+        if(i >= length || !is_digit(text[i]))
+        {
+            *error = i;
+            return 0;
+        }
+    }
+    *sign = text[0] == '-' ? -1 : 1;
+    *leading = two_digits(text + 1);
+    *start = 3;
+    return 1;
+}
+
+// Returns the offset of the first field that is out of range, relative to
+// the fixed part, or FIXED_LENGTH if they're all in range.
+static inline size_t check_fields(const parsed_timestamp* ts)
+{
+    if(ts->month < 1 || ts->month > 12)
+    {
+        return 5;
+    }
+    if(ts->day < 1 || ts->day > smalltime_days_in_month(ts->year, ts->month))
+    {
+        return 8;
+    }
+    if(ts->hour > 23)
+    {
+        return 11;
+    }
+    if(ts->minute > 59)
+    {
+        return 14;
+    }
+    if(ts->second > 60)
+    {
+        return 17;
+    }
+    return FIXED_LENGTH;
+}
+
+static const uint32_t g_fraction_limits[] = {0, 0, 0, 0, 0, 0, 1000000, 0, 0, 1000000000};
+
+// Parses the optional fraction and the UTC offset that follow the fixed
+// part, returning the end of the timestamp, or 0 with the error set.
+static inline size_t parse_suffix(const char* text, size_t length, size_t position, int precision,
+                                  smalltime_parse_rounding rounding, parsed_timestamp* ts, size_t* error)
+{
+    ts->fraction = 0;
+    ts->carry = 0;
+    ts->offset = 0;
+    if(position < length && (text[position] == '.' || text[position] == ','))
+    {
+        size_t start = ++position;
+        uint32_t fraction = 0;
+        uint32_t round_up = 0;
+        int digits = 0;
+        for(; position < length && is_digit(text[position]); position++, digits++)
+        {
+            if(digits < precision)
+            {
+                fraction = fraction * 10 + (uint32_t)(text[position] - '0');
+            }
+            else if(digits == precision && rounding == SMALLTIME_PARSE_ROUND)
+            {
+                round_up = text[position] >= '5';
+            }
+        }
+        if(position == start)
+        {
+            *error = position;
+            return 0;
+        }
+        for(; digits < precision; digits++)
+        {
+            fraction *= 10;
+        }
+        fraction += round_up;
+        if(fraction == g_fraction_limits[precision])
+        {
+            fraction = 0;
+            ts->carry = 1;
+        }
+        ts->fraction = fraction;
+    }
+
+    if(position >= length)
+    {
+        *error = position;
+        return 0;
+    }
+    char designator = text[position];
+    if(designator == 'Z' || designator == 'z')
+    {
+        return position + 1;
+    }
+    if(designator != '+' && designator != '-')
+    {
+        *error = position;
+        return 0;
+    }
+
+    // "+hh:mm"
+    for(size_t i = 1; i <= 5; i++)
+    {
+        if(position + i >= length || !(i == 3 ? text[position + i] == ':' : is_digit(text[position + i])))
+        {
+            *error = position + i;
+            return 0;
+        }
+    }
+    int hours = two_digits(text + position + 1);
+    int minutes = two_digits(text + position + 4);
+    if(hours > 23 || minutes > 59)
+    {
+        *error = position + (hours > 23 ? 1 : 4);
+        return 0;
+    }
+    ts->offset = (hours * 60 + minutes) * 60 * (designator == '-' ? -1 : 1);
+    return position + 6;
+}
+
+// Checks the fixed part and parses the rest of a timestamp into its fields.
+static inline size_t parse_rest(const char* text, size_t length, size_t start, size_t fixed_result, int precision,
+                                smalltime_parse_rounding rounding, parsed_timestamp* ts, size_t* error)
+{
+    if(fixed_result != FIXED_LENGTH)
+    {
+        *error = start + fixed_result;
+        return 0;
+    }
+    size_t field_error = check_fields(ts);
+    if(field_error != FIXED_LENGTH)
+    {
+        *error = start + field_error;
+        return 0;
+    }
+    return parse_suffix(text, length, start + FIXED_LENGTH, precision, rounding, ts, error);
+}
+
+// Offsets are below a day, so only values in the first or last year of the
+// range can be moved out of it.
+static inline int smalltime_shift(smalltime* value, int64_t seconds)
+{
+    int year = smalltime_get_year(*value);
+    if(year == ST_MIN_YEAR || year == ST_MAX_YEAR)
+    {
+        int64_t shifted = smalltime_to_unix_seconds(*value) + seconds;
+        if(shifted < smalltime_to_unix_seconds(smalltime_new(ST_MIN_YEAR, 1, 1, 0, 0, 0, 0)) ||
+           shifted > smalltime_to_unix_seconds(smalltime_new(ST_MAX_YEAR, 12, 31, 23, 59, 59, 0)))
+        {
+            return 0;
+        }
+    }
+    *value = smalltime_add_seconds(*value, seconds);
+    return 1;
+}
+
+static inline int nanotime_shift(nanotime* value, int64_t seconds)
+{
+    int year = nanotime_get_year(*value);
+    if(year == NT_MIN_YEAR || year == NT_MAX_YEAR)
+    {
+        int64_t shifted = nanotime_to_unix_seconds(*value) + seconds;
+        if(shifted < 0 || shifted > nanotime_to_unix_seconds(nanotime_new(NT_MAX_YEAR, 12, 31, 23, 59, 59, 0)))
+        {
+            return 0;
+        }
+    }
+    *value = nanotime_add_seconds(*value, seconds);
+    return 1;
+}
+
+static inline size_t finish_smalltime(const char* text, size_t length, size_t start, size_t fixed_result, int sign, int leading,
+                                      smalltime_parse_rounding rounding, parsed_timestamp* ts, smalltime* value, size_t* error)
+{
+    if(sign != 0 && fixed_result == FIXED_LENGTH)
+    {
+        int year = sign * (leading * 10000 + ts->year);
+        if(year < ST_MIN_YEAR || year > ST_MAX_YEAR)
+        {
+            *error = 0;
+            return 0;
+        }
+        ts->year = year;
+    }
+    size_t end = parse_rest(text, length, start, fixed_result, 6, rounding, ts, error);
+    if(end == 0)
+    {
+        return 0;
+    }
+
+    // A leap second can't be shifted, so it's shifted as second 59 and put
+    // back afterwards. Offsets are whole minutes, so it stays in place.
+    int is_leap_second = ts->second == 60;
+    smalltime result = smalltime_new(ts->year, ts->month, ts->day, ts->hour, ts->minute,
+                                     is_leap_second ? 59 : ts->second, (int)ts->fraction);
+    if((ts->carry != 0 || ts->offset != 0) && !smalltime_shift(&result, ts->carry - ts->offset))
+    {
+        *error = 0;
+        return 0;
+    }
+    if(is_leap_second && !ts->carry)
+    {
+        result = (result & ~ST_MASK_SECOND) | ((smalltime)60 << ST_SHIFT_SECOND);
+    }
+    *value = result;
+    return end;
+}
+
+static inline size_t finish_nanotime(const char* text, size_t length, size_t fixed_result,
+                                     smalltime_parse_rounding rounding, parsed_timestamp* ts, nanotime* value, size_t* error)
+{
+    if(fixed_result == FIXED_LENGTH && (ts->year < NT_MIN_YEAR || ts->year > NT_MAX_YEAR))
+    {
+        *error = 0;
+        return 0;
+    }
+    size_t end = parse_rest(text, length, 0, fixed_result, 9, rounding, ts, error);
+    if(end == 0)
+    {
+        return 0;
+    }
+
+    int is_leap_second = ts->second == 60;
+    nanotime result = nanotime_new(ts->year, ts->month, ts->day, ts->hour, ts->minute,
+                                   is_leap_second ? 59 : ts->second, (int)ts->fraction);
+    if((ts->carry != 0 || ts->offset != 0) && !nanotime_shift(&result, ts->carry - ts->offset))
+    {
+        *error = 0;
+        return 0;
+    }
+    if(is_leap_second && !ts->carry)
+    {
+        result = (result & ~NT_MASK_SECOND) | ((nanotime)60 << NT_SHIFT_SECOND);
+    }
+    *value = result;
+    return end;
+}
+
+// Parses timestamps until the text or the values run out, or an error.
+#define BATCH_PARSE(PARSE_ONE) \
+    size_t position = 0; \
+    size_t count = 0; \
+    while(position < length && count < capacity) \
+    { \
+        size_t error; \
+        size_t consumed = PARSE_ONE(text + position, length - position, rounding, values + count, &error); \
+        if(consumed == 0) \
+        { \
+            *end_offset = position + error; \
+            return count; \
+        } \
+        position += consumed; \
+        count++; \
+        if(position < length) \
+        { \
+            if(text[position] != delimiter) \
+            { \
+                break; \
+            } \
+            position++; \
+        } \
+    } \
+    *end_offset = position; \
+    return count
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+static const char g_fixed_layout[] = "dddd-dd-ddTdd:dd:dd";
+
+// Returns the offset of the first invalid char, or FIXED_LENGTH.
+static inline size_t scalar_parse_fixed(const char* text, size_t length, parsed_timestamp* ts)
+{
+    size_t end = length < FIXED_LENGTH ? length : FIXED_LENGTH;
+    for(size_t i = 0; i < end; i++)
+    {
+        char expected = g_fixed_layout[i];
+        char ch = text[i];
+        int is_valid = expected == 'd' ? is_digit(ch) :
+                       expected == 'T' ? is_time_separator(ch) :
+                                         ch == expected;
+        if(!is_valid)
+        {
+            return i;
+        }
+    }
+    if(end < FIXED_LENGTH)
+    {
+        return end;
+    }
+    ts->year = two_digits(text) * 100 + two_digits(text + 2);
+    ts->month = two_digits(text + 5);
+    ts->day = two_digits(text + 8);
+    ts->hour = two_digits(text + 11);
+    ts->minute = two_digits(text + 14);
+    ts->second = two_digits(text + 17);
+    return FIXED_LENGTH;
+}
+
+size_t smalltime_parse_iso8601_scalar(const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value, size_t* error_offset)
+{
+    parsed_timestamp ts;
+    int sign, leading;
+    size_t start;
+    if(!parse_year_prefix(text, length, &sign, &leading, &start, error_offset))
+    {
+        return 0;
+    }
+    size_t fixed_result = scalar_parse_fixed(text + start, length - start, &ts);
+    return finish_smalltime(text, length, start, fixed_result, sign, leading, rounding, &ts, value, error_offset);
+}
+
+size_t nanotime_parse_iso8601_scalar(const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value, size_t* error_offset)
+{
+    parsed_timestamp ts;
+    size_t fixed_result = scalar_parse_fixed(text, length, &ts);
+    return finish_nanotime(text, length, fixed_result, rounding, &ts, value, error_offset);
+}
+
+size_t smalltime_batch_parse_iso8601_scalar(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                            smalltime* values, size_t capacity, size_t* end_offset)
+{
+    BATCH_PARSE(smalltime_parse_iso8601_scalar);
+}
+
+size_t nanotime_batch_parse_iso8601_scalar(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                           nanotime* values, size_t capacity, size_t* end_offset)
+{
+    BATCH_PARSE(nanotime_parse_iso8601_scalar);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+// The fixed part is checked with two overlapping 16 byte loads (which
+// needs at least 20 chars, the length of the shortest timestamp), one
+// covering "YYYY-MM-DDTHH:MM" and one ending in ":SS". Every digit and
+// separator is checked at once, and the first bad one is found from the
+// combined bitmask. The digits are then gathered with pshufb and combined
+// into two-digit fields with pmaddubsw.
+
+#define Z -128 // pshufb index (high bit set) that produces a zero byte.
+
+// Bits of the chars in "YYYY-MM-DDTHH:MM" that must be digits, and of the
+// '-' and ':' separators. The 'T' at bit 10 is checked on its own.
+#define HEAD_DIGITS     0xdb6f
+#define HEAD_SEPARATORS 0x2090
+// Bits of ":SS" in the second load, which starts at offset 4.
+#define TAIL_DIGITS     0x6000
+#define TAIL_SEPARATORS 0x1000
+
+SMALLTIME_TARGET_SSE42
+static inline unsigned sse42_digit_mask(__m128i digits)
+{
+    // Subtracting '0' leaves digits at 0 - 9, and everything else above.
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits));
+}
+
+// Same contract as scalar_parse_fixed(), but requires 20 readable chars.
+SMALLTIME_TARGET_SSE42
+static inline size_t sse42_parse_fixed(const char* text, parsed_timestamp* ts)
+{
+    const __m128i head_separators = _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 0, 0, 0, ':', 0, 0);
+    const __m128i tail_separators = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', 0, 0, 0);
+    __m128i head = _mm_loadu_si128((const __m128i*)text);
+    __m128i tail = _mm_loadu_si128((const __m128i*)(text + 4));
+    __m128i head_digits = _mm_sub_epi8(head, _mm_set1_epi8('0'));
+    __m128i tail_digits = _mm_sub_epi8(tail, _mm_set1_epi8('0'));
+
+    unsigned head_valid = (sse42_digit_mask(head_digits) & HEAD_DIGITS) |
+                          ((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(head, head_separators)) & HEAD_SEPARATORS) |
+                          (unsigned)is_time_separator(text[10]) << 10;
+    unsigned tail_valid = (sse42_digit_mask(tail_digits) & TAIL_DIGITS) |
+                          ((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(tail, tail_separators)) & TAIL_SEPARATORS);
+    unsigned invalid = ~(head_valid | tail_valid << 4) & ((1u << FIXED_LENGTH) - 1);
+    if(invalid != 0)
+    {
+        return (size_t)__builtin_ctz(invalid);
+    }
+
+    // Digits in pairs: YY YY MM DD hh mm ss.
+    __m128i digits = _mm_or_si128(
+        _mm_shuffle_epi8(head_digits, _mm_setr_epi8(0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, Z, Z, Z, Z)),
+        _mm_shuffle_epi8(tail_digits, _mm_setr_epi8(Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z, 13, 14, Z, Z)));
+    __m128i fields = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    uint64_t date = (uint64_t)_mm_cvtsi128_si64(fields);
+    uint64_t time = (uint64_t)_mm_extract_epi64(fields, 1);
+    ts->year = (int)(date & 0xffff) * 100 + (int)((date >> 16) & 0xffff);
+    ts->month = (int)((date >> 32) & 0xffff);
+    ts->day = (int)(date >> 48);
+    ts->hour = (int)(time & 0xffff);
+    ts->minute = (int)((time >> 16) & 0xffff);
+    ts->second = (int)((time >> 32) & 0xffff);
+    return FIXED_LENGTH;
+}
+
+#undef Z
+#undef HEAD_DIGITS
+#undef HEAD_SEPARATORS
+#undef TAIL_DIGITS
+#undef TAIL_SEPARATORS
+
+SMALLTIME_TARGET_SSE42
+size_t smalltime_parse_iso8601_sse42(const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value, size_t* error_offset)
+{
+    parsed_timestamp ts;
+    int sign, leading;
+    size_t start;
+    if(!parse_year_prefix(text, length, &sign, &leading, &start, error_offset))
+    {
+        return 0;
+    }
+    size_t fixed_result = length - start > FIXED_LENGTH ? sse42_parse_fixed(text + start, &ts)
+                                                        : scalar_parse_fixed(text + start, length - start, &ts);
+    return finish_smalltime(text, length, start, fixed_result, sign, leading, rounding, &ts, value, error_offset);
+}
+
+SMALLTIME_TARGET_SSE42
+size_t nanotime_parse_iso8601_sse42(const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value, size_t* error_offset)
+{
+    parsed_timestamp ts;
+    size_t fixed_result = length > FIXED_LENGTH ? sse42_parse_fixed(text, &ts) : scalar_parse_fixed(text, length, &ts);
+    return finish_nanotime(text, length, fixed_result, rounding, &ts, value, error_offset);
+}
+
+SMALLTIME_TARGET_SSE42
+size_t smalltime_batch_parse_iso8601_sse42(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                           smalltime* values, size_t capacity, size_t* end_offset)
+{
+    BATCH_PARSE(smalltime_parse_iso8601_sse42);
+}
+
+SMALLTIME_TARGET_SSE42
+size_t nanotime_batch_parse_iso8601_sse42(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                          nanotime* values, size_t capacity, size_t* end_offset)
+{
+    BATCH_PARSE(nanotime_parse_iso8601_sse42);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+size_t smalltime_parse_iso8601(const char* text, size_t length, smalltime_parse_rounding rounding, smalltime* value)
+{
+    size_t error_offset;
+    return smalltime_kernels.smalltime_parse_iso8601(text, length, rounding, value, &error_offset);
+}
+
+size_t nanotime_parse_iso8601(const char* text, size_t length, smalltime_parse_rounding rounding, nanotime* value)
+{
+    size_t error_offset;
+    return smalltime_kernels.nanotime_parse_iso8601(text, length, rounding, value, &error_offset);
+}
+
+size_t smalltime_batch_parse_iso8601(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                     smalltime* values, size_t capacity, size_t* end_offset)
+{
+    size_t end;
+    size_t count = smalltime_kernels.smalltime_batch_parse_iso8601(text, length, delimiter, rounding, values, capacity, &end);
+    if(end_offset != NULL)
+    {
+        *end_offset = end;
+    }
+    return count;
+}
+
+size_t nanotime_batch_parse_iso8601(const char* text, size_t length, char delimiter, smalltime_parse_rounding rounding,
+                                    nanotime* values, size_t capacity, size_t* end_offset)
+{
+    size_t end;
+    size_t count = smalltime_kernels.nanotime_batch_parse_iso8601(text, length, delimiter, rounding, values, capacity, &end);
+    if(end_offset != NULL)
+    {
+        *end_offset = end;
+    }
+    return count;
+}
@@ -0,0 +1,344 @@
+#include "kernels.h"
+#include <smalltime/range.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+void smalltime_range_fill_run_scalar(uint64_t* values, uint64_t first, uint64_t delta, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        values[i] = first + i * delta;
+    }
+}
+
+void smalltime_range_restamp_scalar(uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        values[i] = (day[i] & time_of_day) | date;
+    }
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+SMALLTIME_TARGET_SSE42
+void smalltime_range_fill_run_sse42(uint64_t* values, uint64_t first, uint64_t delta, size_t count)
+{
+    __m128i v = _mm_set_epi64x((int64_t)(first + delta), (int64_t)first);
+    __m128i step = _mm_set1_epi64x((int64_t)(delta * 2));
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        _mm_storeu_si128((__m128i*)(values + i), v);
+        v = _mm_add_epi64(v, step);
+    }
+    smalltime_range_fill_run_scalar(values + i, first + i * delta, delta, count - i);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_range_restamp_sse42(uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count)
+{
+    __m128i date_v = _mm_set1_epi64x((int64_t)date);
+    __m128i mask = _mm_set1_epi64x((int64_t)time_of_day);
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(day + i));
+        _mm_storeu_si128((__m128i*)(values + i), _mm_or_si128(_mm_and_si128(v, mask), date_v));
+    }
+    smalltime_range_restamp_scalar(values + i, day + i, date, time_of_day, count - i);
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+void smalltime_range_fill_run_avx2(uint64_t* values, uint64_t first, uint64_t delta, size_t count)
+{
+    __m256i v = _mm256_add_epi64(_mm256_set1_epi64x((int64_t)first),
+                                 _mm256_set_epi64x((int64_t)(delta * 3), (int64_t)(delta * 2), (int64_t)delta, 0));
+    __m256i step = _mm256_set1_epi64x((int64_t)(delta * 4));
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        _mm256_storeu_si256((__m256i*)(values + i), v);
+        v = _mm256_add_epi64(v, step);
+    }
+    smalltime_range_fill_run_scalar(values + i, first + i * delta, delta, count - i);
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_range_restamp_avx2(uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count)
+{
+    __m256i date_v = _mm256_set1_epi64x((int64_t)date);
+    __m256i mask = _mm256_set1_epi64x((int64_t)time_of_day);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(day + i));
+        _mm256_storeu_si256((__m256i*)(values + i), _mm256_or_si256(_mm256_and_si256(v, mask), date_v));
+    }
+    smalltime_range_restamp_scalar(values + i, day + i, date, time_of_day, count - i);
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+void smalltime_range_fill_run_avx512(uint64_t* values, uint64_t first, uint64_t delta, size_t count)
+{
+    __m512i lanes = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i v = _mm512_add_epi64(_mm512_set1_epi64((int64_t)first), _mm512_mullo_epi64(lanes, _mm512_set1_epi64((int64_t)delta)));
+    __m512i step = _mm512_set1_epi64((int64_t)(delta * 8));
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        _mm512_storeu_si512((void*)(values + i), v);
+        v = _mm512_add_epi64(v, step);
+    }
+    if(i < count)
+    {
+        __mmask8 tail = (__mmask8)((1u << (count - i)) - 1);
+        _mm512_mask_storeu_epi64((void*)(values + i), tail, v);
+    }
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_range_restamp_avx512(uint64_t* values, const uint64_t* day, uint64_t date, uint64_t time_of_day, size_t count)
+{
+    __m512i date_v = _mm512_set1_epi64((int64_t)date);
+    __m512i mask = _mm512_set1_epi64((int64_t)time_of_day);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void*)(day + i));
+        _mm512_storeu_si512((void*)(values + i), _mm512_or_si512(_mm512_and_si512(v, mask), date_v));
+    }
+    if(i < count)
+    {
+        __mmask8 tail = (__mmask8)((1u << (count - i)) - 1);
+        __m512i v = _mm512_maskz_loadu_epi64(tail, (const void*)(day + i));
+        _mm512_mask_storeu_epi64((void*)(values + i), tail, _mm512_or_si512(_mm512_and_si512(v, mask), date_v));
+    }
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// Filling
+// ==================================================================
+
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+// Field layout of a time type.
+typedef struct
+{
+    // The shift and (shifted) mask of each unit's field, other than the
+    // year's mask, which isn't needed. Milliseconds and microseconds are
+    // steps of the fraction field.
+    int shifts[SMALLTIME_UNIT_MICROSECOND + 1];
+    uint64_t masks[SMALLTIME_UNIT_MICROSECOND + 1];
+    uint64_t fraction_radix;
+    uint64_t flip;
+    uint64_t (*step)(uint64_t value, smalltime_unit unit, int64_t step, int day);
+} range_layout;
+
+// The range being filled, as the unsigned type both share.
+typedef struct
+{
+    uint64_t next;
+    uint64_t end;
+    int64_t step;
+    smalltime_unit unit;
+    int day;
+} range_state;
+
+static uint64_t step_smalltime(uint64_t value, smalltime_unit unit, int64_t step, int day)
+{
+    return (uint64_t)smalltime_range_step((smalltime)value, unit, step, day);
+}
+
+static uint64_t step_nanotime(uint64_t value, smalltime_unit unit, int64_t step, int day)
+{
+    return nanotime_range_step(value, unit, step, day);
+}
+
+static const range_layout smalltime_layout =
+{
+    {ST_SHIFT_YEAR, ST_SHIFT_MONTH, ST_SHIFT_DAY, ST_SHIFT_HOUR, ST_SHIFT_MINUTE, ST_SHIFT_SECOND, 0, 0},
+    {0, ST_MASK_MONTH, ST_MASK_DAY, ST_MASK_HOUR, ST_MASK_MINUTE, ST_MASK_SECOND, ST_MASK_MICROSECOND, ST_MASK_MICROSECOND},
+    1000000,
+    SMALLTIME_KEY_FLIP,
+    step_smalltime,
+};
+
+static const range_layout nanotime_layout =
+{
+    {NT_SHIFT_YEAR, NT_SHIFT_MONTH, NT_SHIFT_DAY, NT_SHIFT_HOUR, NT_SHIFT_MINUTE, NT_SHIFT_SECOND, 0, 0},
+    {0, NT_MASK_MONTH, NT_MASK_DAY, NT_MASK_HOUR, NT_MASK_MINUTE, NT_MASK_SECOND, NT_MASK_NANOSECOND, NT_MASK_NANOSECOND},
+    1000000000,
+    NANOTIME_KEY_FLIP,
+    step_nanotime,
+};
+
+static inline uint64_t field_of(uint64_t value, const range_layout* layout, smalltime_unit unit)
+{
+    return (value & layout->masks[unit]) >> layout->shifts[unit];
+}
+
+// The number of fractions (or seconds, minutes, hours) that one step
+// adds, or 0 for units of a day or more.
+static uint64_t sub_day_amount(const range_state* r, const range_layout* layout)
+{
+    switch(r->unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+        case SMALLTIME_UNIT_MONTH:
+        case SMALLTIME_UNIT_DAY:
+            return 0;
+        case SMALLTIME_UNIT_MILLISECOND:
+            return (uint64_t)r->step * (layout->fraction_radix / 1000);
+        case SMALLTIME_UNIT_MICROSECOND:
+            return (uint64_t)r->step * (layout->fraction_radix / 1000000);
+        default:
+            return (uint64_t)r->step;
+    }
+}
+
+// The number of steps in a day, or 0 if the step doesn't divide a day.
+static size_t steps_per_day(const range_state* r, const range_layout* layout)
+{
+    uint64_t amount = sub_day_amount(r, layout);
+    if(amount == 0)
+    {
+        return 0;
+    }
+    uint64_t units = r->unit == SMALLTIME_UNIT_HOUR ? 24
+                   : r->unit == SMALLTIME_UNIT_MINUTE ? 24 * 60
+                   : r->unit == SMALLTIME_UNIT_SECOND ? 24 * 60 * 60
+                   : 24 * 60 * 60 * layout->fraction_radix;
+    return units % amount == 0 ? (size_t)(units / amount) : 0;
+}
+
+// The number of values starting at value that step by adding the same
+// delta to one field, before a step would carry (or clamp a day).
+static size_t run_length(const range_state* r, const range_layout* layout, uint64_t value, uint64_t* delta)
+{
+    uint64_t step = (uint64_t)r->step;
+    uint64_t field = field_of(value, layout, r->unit);
+    uint64_t last;
+    switch(r->unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            *delta = step << layout->shifts[SMALLTIME_UNIT_YEAR];
+            // Only Feb 29 moves its day from year to year.
+            return field_of(value, layout, SMALLTIME_UNIT_MONTH) == 2 && r->day > 28 ? 1 : SIZE_MAX;
+        case SMALLTIME_UNIT_MONTH:
+            // Days past the 28th move from month to month.
+            last = r->day > 28 ? 0 : 12;
+            break;
+        case SMALLTIME_UNIT_DAY:
+            // Every month has at least 28 days.
+            last = 28;
+            break;
+        case SMALLTIME_UNIT_HOUR:
+            last = 23;
+            break;
+        case SMALLTIME_UNIT_MINUTE:
+        case SMALLTIME_UNIT_SECOND:
+            last = 59;
+            break;
+        default:
+            step = sub_day_amount(r, layout);
+            last = layout->fraction_radix - 1;
+            break;
+    }
+    *delta = step << layout->shifts[r->unit];
+    return field > last ? 1 : (size_t)((last - field) / step + 1);
+}
+
+// Like smalltime_range_step(), treats any other unit as microseconds.
+static smalltime_unit known_unit(smalltime_unit unit)
+{
+    return (unsigned)unit < SMALLTIME_UNIT_MICROSECOND ? unit : SMALLTIME_UNIT_MICROSECOND;
+}
+
+static size_t fill(range_state* r, const range_layout* layout, uint64_t* values, size_t capacity)
+{
+    uint64_t time_of_day = (1ULL << layout->shifts[SMALLTIME_UNIT_DAY]) - 1;
+    uint64_t end_key = r->end ^ layout->flip;
+    size_t per_day = steps_per_day(r, layout);
+    size_t written = 0;
+    while(written < capacity && (r->next ^ layout->flip) < end_key)
+    {
+        uint64_t value = r->next;
+        size_t left = capacity - written;
+
+        // A whole day written before this one, starting at its first
+        // step, gives this day's values with just the date changed.
+        if(per_day != 0 && written >= per_day
+           && ((values[written - 1] ^ value) & ~time_of_day) != 0
+           && ((values[written - per_day] ^ value) & time_of_day) == 0)
+        {
+            size_t count = per_day < left ? per_day : left;
+            const uint64_t* day = values + written - per_day;
+            uint64_t last = (day[count - 1] & time_of_day) | (value & ~time_of_day);
+            if((last ^ layout->flip) < end_key)
+            {
+                smalltime_kernels.smalltime_range_restamp(values + written, day, value & ~time_of_day, time_of_day, count);
+                written += count;
+                r->next = layout->step(last, r->unit, r->step, r->day);
+                continue;
+            }
+        }
+
+        uint64_t delta;
+        size_t count = run_length(r, layout, value, &delta);
+        size_t before_end = (size_t)((end_key - (value ^ layout->flip) - 1) / delta + 1);
+        count = count < before_end ? count : before_end;
+        count = count < left ? count : left;
+        smalltime_kernels.smalltime_range_fill_run(values + written, value, delta, count);
+        written += count;
+        r->next = layout->step(value + (count - 1) * delta, r->unit, r->step, r->day);
+    }
+    return written;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+size_t smalltime_range_fill(smalltime_range* range, smalltime* values, size_t capacity)
+{
+    range_state r = {(uint64_t)range->next, (uint64_t)range->end, range->step, known_unit(range->unit), range->day};
+    size_t written = fill(&r, &smalltime_layout, (uint64_t*)values, capacity);
+    range->next = (smalltime)r.next;
+    return written;
+}
+
+size_t nanotime_range_fill(nanotime_range* range, nanotime* values, size_t capacity)
+{
+    range_state r = {range->next, range->end, range->step, known_unit(range->unit), range->day};
+    size_t written = fill(&r, &nanotime_layout, values, capacity);
+    range->next = r.next;
+    return written;
+}
@@ -0,0 +1,717 @@
+#include "kernels.h"
+#include <smalltime/rollup.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+static inline uint64_t bucket_field(uint64_t value, const smalltime_rollup_layout* layout)
+{
+    return ((value ^ layout->flip) >> layout->shift) & layout->field_mask;
+}
+
+static inline int is_in_bucket(uint64_t value, uint64_t bucket, uint64_t start, const smalltime_rollup_layout* layout)
+{
+    return ((value ^ bucket) & layout->upper_mask) == 0 && bucket_field(value, layout) - start < layout->width;
+}
+
+static inline size_t scalar_run_length(const uint64_t* values, size_t begin, size_t count,
+                                       uint64_t bucket, const smalltime_rollup_layout* layout)
+{
+    uint64_t start = bucket_field(bucket, layout);
+    size_t i = begin;
+    while(i < count && is_in_bucket(values[i], bucket, start, layout))
+    {
+        i++;
+    }
+    return i;
+}
+
+static inline double min_of(double value, double current)
+{
+    return value < current ? value : current;
+}
+
+static inline double max_of(double value, double current)
+{
+    return value > current ? value : current;
+}
+
+// Adds the values after the last whole 8 to the combined lanes.
+static inline void add_tail(const double* values, size_t begin, size_t count, smalltime_rollup_totals* totals)
+{
+    for(size_t i = begin; i < count; i++)
+    {
+        totals->sum += values[i];
+        totals->min = min_of(values[i], totals->min);
+        totals->max = max_of(values[i], totals->max);
+    }
+}
+
+static inline size_t whole_lanes(size_t count)
+{
+    return count - count % SMALLTIME_ROLLUP_LANES;
+}
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+size_t smalltime_rollup_run_length_scalar(const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout)
+{
+    return scalar_run_length(values, 0, count, bucket, layout);
+}
+
+void smalltime_rollup_aggregate_scalar(const double* values, size_t count, smalltime_rollup_totals* totals)
+{
+    double sum[SMALLTIME_ROLLUP_LANES];
+    double min[SMALLTIME_ROLLUP_LANES];
+    double max[SMALLTIME_ROLLUP_LANES];
+    for(int lane = 0; lane < SMALLTIME_ROLLUP_LANES; lane++)
+    {
+        sum[lane] = 0;
+        min[lane] = INFINITY;
+        max[lane] = -INFINITY;
+    }
+    size_t whole = whole_lanes(count);
+    for(size_t i = 0; i < whole; i += SMALLTIME_ROLLUP_LANES)
+    {
+        for(int lane = 0; lane < SMALLTIME_ROLLUP_LANES; lane++)
+        {
+            sum[lane] += values[i + lane];
+            min[lane] = min_of(values[i + lane], min[lane]);
+            max[lane] = max_of(values[i + lane], max[lane]);
+        }
+    }
+    for(int half = SMALLTIME_ROLLUP_LANES / 2; half > 0; half /= 2)
+    {
+        for(int lane = 0; lane < half; lane++)
+        {
+            sum[lane] = sum[lane] + sum[lane + half];
+            min[lane] = min_of(min[lane + half], min[lane]);
+            max[lane] = max_of(max[lane + half], max[lane]);
+        }
+    }
+    totals->sum = sum[0];
+    totals->min = min[0];
+    totals->max = max[0];
+    add_tail(values, whole, count, totals);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+// Fields are less than 2^30, so their differences can be compared as
+// signed integers.
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_outside(__m128i v, __m128i bucket, __m128i start, const smalltime_rollup_layout* layout)
+{
+    __m128i field = _mm_and_si128(_mm_srli_epi64(_mm_xor_si128(v, _mm_set1_epi64x((int64_t)layout->flip)), layout->shift),
+                                  _mm_set1_epi64x((int64_t)layout->field_mask));
+    __m128i offset = _mm_sub_epi64(field, start);
+    __m128i upper = _mm_and_si128(_mm_xor_si128(v, bucket), _mm_set1_epi64x((int64_t)layout->upper_mask));
+    __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(_mm_setzero_si128(), offset),
+                                   _mm_cmpgt_epi64(offset, _mm_set1_epi64x((int64_t)layout->width - 1)));
+    return _mm_or_si128(outside, _mm_xor_si128(_mm_cmpeq_epi64(upper, _mm_setzero_si128()), _mm_set1_epi64x(-1)));
+}
+
+SMALLTIME_TARGET_SSE42
+size_t smalltime_rollup_run_length_sse42(const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout)
+{
+    __m128i bucket_v = _mm_set1_epi64x((int64_t)bucket);
+    __m128i start = _mm_set1_epi64x((int64_t)bucket_field(bucket, layout));
+    size_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        int outside = _mm_movemask_pd(_mm_castsi128_pd(sse42_outside(v, bucket_v, start, layout)));
+        if(outside != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned)outside);
+        }
+    }
+    return scalar_run_length(values, i, count, bucket, layout);
+}
+
+SMALLTIME_TARGET_SSE42
+void smalltime_rollup_aggregate_sse42(const double* values, size_t count, smalltime_rollup_totals* totals)
+{
+    __m128d sum[4];
+    __m128d min[4];
+    __m128d max[4];
+    for(int i = 0; i < 4; i++)
+    {
+        sum[i] = _mm_setzero_pd();
+        min[i] = _mm_set1_pd(INFINITY);
+        max[i] = _mm_set1_pd(-INFINITY);
+    }
+    size_t whole = whole_lanes(count);
+    for(size_t i = 0; i < whole; i += SMALLTIME_ROLLUP_LANES)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            __m128d v = _mm_loadu_pd(values + i + j * 2);
+            sum[j] = _mm_add_pd(sum[j], v);
+            min[j] = _mm_min_pd(v, min[j]);
+            max[j] = _mm_max_pd(v, max[j]);
+        }
+    }
+    // Lanes i and i + 4, then lanes i and i + 2.
+    for(int j = 0; j < 2; j++)
+    {
+        sum[j] = _mm_add_pd(sum[j], sum[j + 2]);
+        min[j] = _mm_min_pd(min[j + 2], min[j]);
+        max[j] = _mm_max_pd(max[j + 2], max[j]);
+    }
+    __m128d s = _mm_add_pd(sum[0], sum[1]);
+    __m128d lo = _mm_min_pd(min[1], min[0]);
+    __m128d hi = _mm_max_pd(max[1], max[0]);
+    totals->sum = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    totals->min = _mm_cvtsd_f64(_mm_min_sd(_mm_unpackhi_pd(lo, lo), lo));
+    totals->max = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(hi, hi), hi));
+    add_tail(values, whole, count, totals);
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_outside(__m256i v, __m256i bucket, __m256i start, const smalltime_rollup_layout* layout)
+{
+    __m256i field = _mm256_and_si256(_mm256_srli_epi64(_mm256_xor_si256(v, _mm256_set1_epi64x((int64_t)layout->flip)), layout->shift),
+                                     _mm256_set1_epi64x((int64_t)layout->field_mask));
+    __m256i offset = _mm256_sub_epi64(field, start);
+    __m256i upper = _mm256_and_si256(_mm256_xor_si256(v, bucket), _mm256_set1_epi64x((int64_t)layout->upper_mask));
+    __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), offset),
+                                      _mm256_cmpgt_epi64(offset, _mm256_set1_epi64x((int64_t)layout->width - 1)));
+    return _mm256_or_si256(outside, _mm256_xor_si256(_mm256_cmpeq_epi64(upper, _mm256_setzero_si256()), _mm256_set1_epi64x(-1)));
+}
+
+SMALLTIME_TARGET_AVX2
+size_t smalltime_rollup_run_length_avx2(const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout)
+{
+    __m256i bucket_v = _mm256_set1_epi64x((int64_t)bucket);
+    __m256i start = _mm256_set1_epi64x((int64_t)bucket_field(bucket, layout));
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        int outside = _mm256_movemask_pd(_mm256_castsi256_pd(avx2_outside(v, bucket_v, start, layout)));
+        if(outside != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned)outside);
+        }
+    }
+    return scalar_run_length(values, i, count, bucket, layout);
+}
+
+// Combines lanes i and i + 2, then i and i + 1, of the 4 lanes left.
+SMALLTIME_TARGET_AVX2
+static inline void avx2_combine(__m256d sum, __m256d min, __m256d max, smalltime_rollup_totals* totals)
+{
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    __m128d lo = _mm_min_pd(_mm256_extractf128_pd(min, 1), _mm256_castpd256_pd128(min));
+    __m128d hi = _mm_max_pd(_mm256_extractf128_pd(max, 1), _mm256_castpd256_pd128(max));
+    totals->sum = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    totals->min = _mm_cvtsd_f64(_mm_min_sd(_mm_unpackhi_pd(lo, lo), lo));
+    totals->max = _mm_cvtsd_f64(_mm_max_sd(_mm_unpackhi_pd(hi, hi), hi));
+}
+
+SMALLTIME_TARGET_AVX2
+void smalltime_rollup_aggregate_avx2(const double* values, size_t count, smalltime_rollup_totals* totals)
+{
+    __m256d sum[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    __m256d min[2] = {_mm256_set1_pd(INFINITY), _mm256_set1_pd(INFINITY)};
+    __m256d max[2] = {_mm256_set1_pd(-INFINITY), _mm256_set1_pd(-INFINITY)};
+    size_t whole = whole_lanes(count);
+    for(size_t i = 0; i < whole; i += SMALLTIME_ROLLUP_LANES)
+    {
+        for(int j = 0; j < 2; j++)
+        {
+            __m256d v = _mm256_loadu_pd(values + i + j * 4);
+            sum[j] = _mm256_add_pd(sum[j], v);
+            min[j] = _mm256_min_pd(v, min[j]);
+            max[j] = _mm256_max_pd(v, max[j]);
+        }
+    }
+    avx2_combine(_mm256_add_pd(sum[0], sum[1]), _mm256_min_pd(min[1], min[0]), _mm256_max_pd(max[1], max[0]), totals);
+    add_tail(values, whole, count, totals);
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+size_t smalltime_rollup_run_length_avx512(const uint64_t* values, size_t count, uint64_t bucket, const smalltime_rollup_layout* layout)
+{
+    __m512i bucket_v = _mm512_set1_epi64((int64_t)bucket);
+    __m512i start = _mm512_set1_epi64((int64_t)bucket_field(bucket, layout));
+    __m512i flip = _mm512_set1_epi64((int64_t)layout->flip);
+    __m512i field_mask = _mm512_set1_epi64((int64_t)layout->field_mask);
+    __m512i upper_mask = _mm512_set1_epi64((int64_t)layout->upper_mask);
+    __m512i width = _mm512_set1_epi64((int64_t)layout->width);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void*)(values + i));
+        __m512i field = _mm512_and_si512(_mm512_srli_epi64(_mm512_xor_si512(v, flip), (unsigned)layout->shift), field_mask);
+        // Subtracting the start wraps fields before it around, so one
+        // unsigned compare checks both ends.
+        __mmask8 outside = _mm512_cmpge_epu64_mask(_mm512_sub_epi64(field, start), width) |
+                           _mm512_test_epi64_mask(_mm512_xor_si512(v, bucket_v), upper_mask);
+        if(outside != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned)outside);
+        }
+    }
+    return scalar_run_length(values, i, count, bucket, layout);
+}
+
+SMALLTIME_TARGET_AVX512
+void smalltime_rollup_aggregate_avx512(const double* values, size_t count, smalltime_rollup_totals* totals)
+{
+    __m512d sum = _mm512_setzero_pd();
+    __m512d min = _mm512_set1_pd(INFINITY);
+    __m512d max = _mm512_set1_pd(-INFINITY);
+    size_t whole = whole_lanes(count);
+    for(size_t i = 0; i < whole; i += SMALLTIME_ROLLUP_LANES)
+    {
+        __m512d v = _mm512_loadu_pd(values + i);
+        sum = _mm512_add_pd(sum, v);
+        min = _mm512_min_pd(v, min);
+        max = _mm512_max_pd(v, max);
+    }
+    avx2_combine(_mm256_add_pd(_mm512_castpd512_pd256(sum), _mm512_extractf64x4_pd(sum, 1)),
+                 _mm256_min_pd(_mm512_extractf64x4_pd(min, 1), _mm512_castpd512_pd256(min)),
+                 _mm256_max_pd(_mm512_extractf64x4_pd(max, 1), _mm512_castpd512_pd256(max)),
+                 totals);
+    add_tail(values, whole, count, totals);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// Rollup
+// ==================================================================
+
+typedef struct
+{
+    uint64_t key;  // The bucket's start, xored with the type's flip.
+    size_t count;
+    double sum;
+    double min;
+    double max;
+} rollup_group;
+
+typedef struct
+{
+    uint64_t key;
+    size_t group;  // The group's position plus 1, or 0 if the slot is empty.
+} rollup_slot;
+
+#define FIELD_OFFSETS 64
+
+typedef struct
+{
+    smalltime_unit unit;
+    int width;
+    smalltime_rollup_layout layout;
+    uint64_t (*truncate)(uint64_t value, smalltime_unit unit, int width);
+
+    // Units of a second or more, whose fields have few enough values (or
+    // whose buckets are one unit wide), are truncated without dividing:
+    // the bits below the field are cleared (and set to the first month
+    // and day where needed), and the field is moved back by its offset
+    // into the bucket.
+    int is_masked;
+    uint64_t keep_mask;
+    uint64_t first_bits;
+    uint8_t field_offsets[FIELD_OFFSETS];
+
+    rollup_group* groups;
+    size_t group_count;
+    size_t group_capacity;
+    int is_sorted;
+
+    // Open addressing from keys to groups. Never more than a quarter full.
+    rollup_slot* slots;
+    int slot_bits;
+} rollup_table;
+
+#define NO_GROUP SIZE_MAX
+#define INITIAL_SLOT_BITS 6
+
+// Field shifts by unit, with the year's upper neighbour at 64. Units from
+// milliseconds down are fractions of a second, at shift 0.
+static const int smalltime_shifts[] = {64, ST_SHIFT_YEAR, ST_SHIFT_MONTH, ST_SHIFT_DAY, ST_SHIFT_HOUR, ST_SHIFT_MINUTE, ST_SHIFT_SECOND, 0, 0};
+static const int nanotime_shifts[] = {64, NT_SHIFT_YEAR, NT_SHIFT_MONTH, NT_SHIFT_DAY, NT_SHIFT_HOUR, NT_SHIFT_MINUTE, NT_SHIFT_SECOND, 0, 0};
+
+static uint64_t truncate_smalltime(uint64_t value, smalltime_unit unit, int width)
+{
+    return (uint64_t)smalltime_truncate_to_multiple((smalltime)value, unit, width);
+}
+
+static uint64_t truncate_nanotime(uint64_t value, smalltime_unit unit, int width)
+{
+    return nanotime_truncate_to_multiple(value, unit, width);
+}
+
+// fraction_units holds how many of the type's fractions make up a
+// millisecond and a microsecond.
+static int rollup_init(rollup_table* r, smalltime_unit unit, int width, const int* shifts,
+                       const uint64_t* fraction_units, uint64_t flip,
+                       uint64_t (*truncate)(uint64_t value, smalltime_unit unit, int width))
+{
+    r->groups = NULL;
+    r->group_count = 0;
+    r->group_capacity = 0;
+    r->is_sorted = 1;
+    r->slots = NULL;
+    r->slot_bits = INITIAL_SLOT_BITS;
+    if((int)unit < SMALLTIME_UNIT_YEAR || unit > SMALLTIME_UNIT_MICROSECOND)
+    {
+        return 0;
+    }
+    width = width < 1 ? 1 : width;
+    r->unit = unit;
+    r->width = width;
+    r->truncate = truncate;
+
+    int upper_shift = unit >= SMALLTIME_UNIT_MILLISECOND ? shifts[SMALLTIME_UNIT_SECOND + 1] : shifts[unit];
+    int shift = shifts[unit + 1];
+    r->layout.upper_mask = upper_shift >= 64 ? 0 : ~((1ULL << upper_shift) - 1);
+    r->layout.flip = flip;
+    r->layout.shift = shift;
+    r->layout.field_mask = ((upper_shift >= 64 ? 0 : 1ULL << upper_shift) - 1) >> shift;
+    r->layout.width = (uint64_t)width;
+    if(unit >= SMALLTIME_UNIT_MILLISECOND)
+    {
+        r->layout.width *= fraction_units[unit - SMALLTIME_UNIT_MILLISECOND];
+    }
+
+    int first = unit == SMALLTIME_UNIT_MONTH || unit == SMALLTIME_UNIT_DAY ? 1 : 0;
+    r->is_masked = unit <= SMALLTIME_UNIT_SECOND && (r->layout.field_mask < FIELD_OFFSETS || width == 1);
+    r->keep_mask = ~((1ULL << shift) - 1);
+    r->first_bits = unit == SMALLTIME_UNIT_YEAR ? (1ULL << shifts[SMALLTIME_UNIT_MONTH + 1]) | (1ULL << shifts[SMALLTIME_UNIT_DAY + 1])
+                  : unit == SMALLTIME_UNIT_MONTH ? 1ULL << shifts[SMALLTIME_UNIT_DAY + 1]
+                  : 0;
+    for(int field = 0; field < FIELD_OFFSETS; field++)
+    {
+        // A leap second joins second 59's bucket, unless each second is
+        // its own bucket.
+        r->field_offsets[field] = (uint8_t)(field < first ? 0
+                                          : unit == SMALLTIME_UNIT_SECOND && width > 1 ? smalltime_rollup_second_offset(field, width)
+                                          : (uint64_t)((field - first) % width));
+    }
+
+    r->slots = calloc((size_t)1 << r->slot_bits, sizeof(*r->slots));
+    return r->slots != NULL;
+}
+
+static inline uint64_t bucket_of(const rollup_table* r, uint64_t value)
+{
+    if(!r->is_masked)
+    {
+        return r->truncate(value, r->unit, r->width);
+    }
+    uint64_t offset = r->field_offsets[bucket_field(value, &r->layout) % FIELD_OFFSETS];
+    return ((value & r->keep_mask) | r->first_bits) - (offset << r->layout.shift);
+}
+
+static void rollup_free(rollup_table* r)
+{
+    free(r->groups);
+    free(r->slots);
+}
+
+// Keys have many low bits clear (bucket starts), which a multiplicative
+// hash alone spreads poorly, so the halves are folded together first.
+static inline size_t slot_of(const rollup_table* r, uint64_t key)
+{
+    key ^= key >> 32;
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> (64 - r->slot_bits));
+}
+
+static void insert_slot(rollup_table* r, size_t group)
+{
+    size_t mask = ((size_t)1 << r->slot_bits) - 1;
+    uint64_t key = r->groups[group].key;
+    size_t slot = slot_of(r, key);
+    while(r->slots[slot].group != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    r->slots[slot].key = key;
+    r->slots[slot].group = group + 1;
+}
+
+static void refill_slots(rollup_table* r)
+{
+    memset(r->slots, 0, ((size_t)1 << r->slot_bits) * sizeof(*r->slots));
+    for(size_t i = 0; i < r->group_count; i++)
+    {
+        insert_slot(r, i);
+    }
+}
+
+static int grow_slots(rollup_table* r)
+{
+    rollup_slot* slots = malloc(((size_t)1 << (r->slot_bits + 1)) * sizeof(*slots));
+    if(slots == NULL)
+    {
+        return 0;
+    }
+    free(r->slots);
+    r->slots = slots;
+    r->slot_bits++;
+    refill_slots(r);
+    return 1;
+}
+
+// The group of a key, adding it if it's new, or NO_GROUP if out of memory.
+static size_t find_group(rollup_table* r, uint64_t key)
+{
+    size_t mask = ((size_t)1 << r->slot_bits) - 1;
+    for(size_t slot = slot_of(r, key); r->slots[slot].group != 0; slot = (slot + 1) & mask)
+    {
+        if(r->slots[slot].key == key)
+        {
+            return r->slots[slot].group - 1;
+        }
+    }
+
+    if((r->group_count + 1) * 4 > mask + 1 && !grow_slots(r))
+    {
+        return NO_GROUP;
+    }
+    if(r->group_count == r->group_capacity)
+    {
+        size_t capacity = r->group_capacity == 0 ? 16 : r->group_capacity * 2;
+        rollup_group* groups = realloc(r->groups, capacity * sizeof(*groups));
+        if(groups == NULL)
+        {
+            return NO_GROUP;
+        }
+        r->groups = groups;
+        r->group_capacity = capacity;
+    }
+    size_t group = r->group_count++;
+    rollup_group* g = &r->groups[group];
+    g->key = key;
+    g->count = 0;
+    g->sum = 0;
+    g->min = INFINITY;
+    g->max = -INFINITY;
+    r->is_sorted = r->is_sorted && (group == 0 || r->groups[group - 1].key < key);
+    insert_slot(r, group);
+    return group;
+}
+
+static void add_run(rollup_group* g, const double* values, size_t count)
+{
+    if(count == 1)
+    {
+        g->count++;
+        g->sum += values[0];
+        g->min = min_of(values[0], g->min);
+        g->max = max_of(values[0], g->max);
+        return;
+    }
+    smalltime_rollup_totals totals;
+    if(count < SMALLTIME_ROLLUP_LANES)
+    {
+        totals.sum = g->sum;
+        totals.min = g->min;
+        totals.max = g->max;
+        add_tail(values, 0, count, &totals);
+        g->sum = totals.sum;
+    }
+    else
+    {
+        smalltime_kernels.smalltime_rollup_aggregate(values, count, &totals);
+        g->sum += totals.sum;
+    }
+    g->count += count;
+    g->min = min_of(totals.min, g->min);
+    g->max = max_of(totals.max, g->max);
+}
+
+static int rollup_add(rollup_table* r, const uint64_t* times, const double* values, size_t count)
+{
+    if(count == 0)
+    {
+        return 1;
+    }
+    uint64_t bucket = bucket_of(r, times[0]);
+    size_t i = 0;
+    while(i < count)
+    {
+        size_t group = find_group(r, bucket ^ r->layout.flip);
+        if(group == NO_GROUP)
+        {
+            return 0;
+        }
+        // The next time's bucket is needed anyway, and only when it's the
+        // same does the kernel look for the rest of the run.
+        size_t end = i + 1;
+        uint64_t next_bucket = end < count ? bucket_of(r, times[end]) : 0;
+        if(end < count && next_bucket == bucket)
+        {
+            end += 1 + smalltime_kernels.smalltime_rollup_run_length(times + end + 1, count - end - 1, bucket, &r->layout);
+            next_bucket = end < count ? bucket_of(r, times[end]) : 0;
+        }
+        add_run(&r->groups[group], values + i, end - i);
+        i = end;
+        bucket = next_bucket;
+    }
+    return 1;
+}
+
+static int compare_groups(const void* a, const void* b)
+{
+    uint64_t key_a = ((const rollup_group*)a)->key;
+    uint64_t key_b = ((const rollup_group*)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Sorts the groups by time, if they aren't already.
+static void sort_groups(rollup_table* r)
+{
+    if(r->is_sorted)
+    {
+        return;
+    }
+    qsort(r->groups, r->group_count, sizeof(*r->groups), compare_groups);
+    r->is_sorted = 1;
+    refill_slots(r);
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+struct smalltime_rollup
+{
+    rollup_table impl;
+};
+
+struct nanotime_rollup
+{
+    rollup_table impl;
+};
+
+static const uint64_t smalltime_fraction_units[] = {1000, 1};
+static const uint64_t nanotime_fraction_units[] = {1000000, 1000};
+
+smalltime_rollup* smalltime_rollup_new(smalltime_unit unit, int width)
+{
+    smalltime_rollup* rollup = malloc(sizeof(*rollup));
+    if(rollup == NULL)
+    {
+        return NULL;
+    }
+    if(!rollup_init(&rollup->impl, unit, width, smalltime_shifts, smalltime_fraction_units, SMALLTIME_KEY_FLIP, truncate_smalltime))
+    {
+        smalltime_rollup_free(rollup);
+        return NULL;
+    }
+    return rollup;
+}
+
+nanotime_rollup* nanotime_rollup_new(smalltime_unit unit, int width)
+{
+    nanotime_rollup* rollup = malloc(sizeof(*rollup));
+    if(rollup == NULL)
+    {
+        return NULL;
+    }
+    if(!rollup_init(&rollup->impl, unit, width, nanotime_shifts, nanotime_fraction_units, NANOTIME_KEY_FLIP, truncate_nanotime))
+    {
+        nanotime_rollup_free(rollup);
+        return NULL;
+    }
+    return rollup;
+}
+
+void smalltime_rollup_free(smalltime_rollup* rollup)
+{
+    if(rollup != NULL)
+    {
+        rollup_free(&rollup->impl);
+        free(rollup);
+    }
+}
+
+void nanotime_rollup_free(nanotime_rollup* rollup)
+{
+    if(rollup != NULL)
+    {
+        rollup_free(&rollup->impl);
+        free(rollup);
+    }
+}
+
+int smalltime_rollup_add(smalltime_rollup* rollup, const smalltime* times, const double* values, size_t count)
+{
+    return rollup_add(&rollup->impl, (const uint64_t*)times, values, count);
+}
+
+int nanotime_rollup_add(nanotime_rollup* rollup, const nanotime* times, const double* values, size_t count)
+{
+    return rollup_add(&rollup->impl, times, values, count);
+}
+
+size_t smalltime_rollup_groups(smalltime_rollup* rollup, smalltime_group* groups, size_t capacity)
+{
+    rollup_table* r = &rollup->impl;
+    sort_groups(r);
+    for(size_t i = 0; i < capacity && i < r->group_count; i++)
+    {
+        const rollup_group* g = &r->groups[i];
+        groups[i].bucket = (smalltime)(g->key ^ SMALLTIME_KEY_FLIP);
+        groups[i].count = g->count;
+        groups[i].sum = g->sum;
+        groups[i].min = g->min;
+        groups[i].max = g->max;
+    }
+    return r->group_count;
+}
+
+size_t nanotime_rollup_groups(nanotime_rollup* rollup, nanotime_group* groups, size_t capacity)
+{
+    rollup_table* r = &rollup->impl;
+    sort_groups(r);
+    for(size_t i = 0; i < capacity && i < r->group_count; i++)
+    {
+        const rollup_group* g = &r->groups[i];
+        groups[i].bucket = g->key ^ NANOTIME_KEY_FLIP;
+        groups[i].count = g->count;
+        groups[i].sum = g->sum;
+        groups[i].min = g->min;
+        groups[i].max = g->max;
+    }
+    return r->group_count;
+}
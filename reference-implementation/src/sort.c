@@ -0,0 +1,319 @@
+#include "workers.h"
+#include <smalltime/sort.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define DIGIT_COUNT (64 / RADIX_BITS)
+
+// Below this, an insertion sort beats setting up the passes.
+#define INSERTION_SORT_LENGTH 64
+
+// Each thread needs enough values to be worth starting.
+#define MIN_VALUES_PER_THREAD 65536
+
+// Digits are taken from the values xored with flip, which orders smalltime
+// values (whose sign bit flips) and nanotime values (which are left alone)
+// as unsigned integers.
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+static inline size_t digit_of(uint64_t value, uint64_t flip, int digit)
+{
+    return (size_t)((value ^ flip) >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1);
+}
+
+static void insertion_sort(uint64_t* values, size_t* indices, size_t count, uint64_t flip)
+{
+    for(size_t i = 1; i < count; i++)
+    {
+        uint64_t value = values[i];
+        size_t index = indices != NULL ? indices[i] : 0;
+        size_t j = i;
+        for(; j > 0 && (values[j - 1] ^ flip) > (value ^ flip); j--)
+        {
+            values[j] = values[j - 1];
+            if(indices != NULL)
+            {
+                indices[j] = indices[j - 1];
+            }
+        }
+        values[j] = value;
+        if(indices != NULL)
+        {
+            indices[j] = index;
+        }
+    }
+}
+
+
+// ==================================================================
+// Workers
+// ==================================================================
+
+// One thread's slice of the array, and its digit counts. Before a scatter,
+// the counts of the digit being sorted on are turned into the positions
+// that the slice's values of each digit go to.
+typedef struct sort_worker
+{
+    const uint64_t* values_in;
+    uint64_t* values_out;
+    const size_t* indices_in;
+    size_t* indices_out;
+    size_t start;
+    size_t end;
+    uint64_t flip;
+    uint64_t same_bits;
+    uint64_t set_bits;
+    int digit;
+    int digits;
+    size_t counts[DIGIT_COUNT][RADIX_SIZE];
+} sort_worker;
+
+// The loops work on copies of the worker's fields, since stores through
+// the value and index arrays could otherwise alias them.
+
+static void find_varying_bits(void* job)
+{
+    sort_worker* worker = job;
+    const uint64_t* values = worker->values_in;
+    const size_t end = worker->end;
+    uint64_t all = ~(uint64_t)0;
+    uint64_t any = 0;
+    for(size_t i = worker->start; i < end; i++)
+    {
+        all &= values[i];
+        any |= values[i];
+    }
+    worker->same_bits = all;
+    worker->set_bits = any;
+}
+
+// Counts every digit marked in worker->digits (one bit per digit).
+static void count_digits(void* job)
+{
+    sort_worker* worker = job;
+    const uint64_t* values = worker->values_in;
+    const uint64_t flip = worker->flip;
+    const int digits = worker->digits;
+    const size_t end = worker->end;
+    size_t counts[DIGIT_COUNT][RADIX_SIZE] = {{0}};
+    for(size_t i = worker->start; i < end; i++)
+    {
+        uint64_t key = values[i] ^ flip;
+        for(int digit = 0; digit < DIGIT_COUNT; digit++)
+        {
+            if(digits & (1 << digit))
+            {
+                counts[digit][(key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+            }
+        }
+    }
+    memcpy(worker->counts, counts, sizeof(counts));
+}
+
+static void count_digit(void* job)
+{
+    sort_worker* worker = job;
+    const uint64_t* values = worker->values_in;
+    const uint64_t flip = worker->flip;
+    const int digit = worker->digit;
+    const size_t end = worker->end;
+    size_t counts[RADIX_SIZE] = {0};
+    for(size_t i = worker->start; i < end; i++)
+    {
+        counts[digit_of(values[i], flip, digit)]++;
+    }
+    memcpy(worker->counts[digit], counts, sizeof(counts));
+}
+
+static void scatter(void* job)
+{
+    sort_worker* worker = job;
+    const uint64_t* values_in = worker->values_in;
+    uint64_t* values_out = worker->values_out;
+    const size_t* indices_in = worker->indices_in;
+    size_t* indices_out = worker->indices_out;
+    const uint64_t flip = worker->flip;
+    const int shift = worker->digit * RADIX_BITS;
+    const size_t end = worker->end;
+    size_t positions[RADIX_SIZE];
+    memcpy(positions, worker->counts[worker->digit], sizeof(positions));
+
+    if(indices_in == NULL)
+    {
+        for(size_t i = worker->start; i < end; i++)
+        {
+            uint64_t value = values_in[i];
+            values_out[positions[((value ^ flip) >> shift) & (RADIX_SIZE - 1)]++] = value;
+        }
+        return;
+    }
+    for(size_t i = worker->start; i < end; i++)
+    {
+        uint64_t value = values_in[i];
+        size_t position = positions[((value ^ flip) >> shift) & (RADIX_SIZE - 1)]++;
+        values_out[position] = value;
+        indices_out[position] = indices_in[i];
+    }
+}
+
+// Runs a job on every worker.
+static void run_workers(sort_worker* workers, size_t worker_count, void (*run)(void* worker))
+{
+    smalltime_run_workers(workers, sizeof(*workers), worker_count, run);
+}
+
+
+// ==================================================================
+// Sort
+// ==================================================================
+
+static int radix_sort(uint64_t* values, size_t* indices, size_t count, unsigned threads, uint64_t flip)
+{
+    if(count < INSERTION_SORT_LENGTH)
+    {
+        insertion_sort(values, indices, count, flip);
+        return 1;
+    }
+
+    size_t worker_count = threads == 0 ? smalltime_cpu_count() : threads;
+    worker_count = worker_count < count / MIN_VALUES_PER_THREAD ? worker_count : count / MIN_VALUES_PER_THREAD;
+    worker_count = worker_count < 1 ? 1 : worker_count > SMALLTIME_MAX_WORKERS ? SMALLTIME_MAX_WORKERS : worker_count;
+
+    uint64_t* value_scratch = malloc(count * sizeof(*value_scratch));
+    size_t* index_scratch = indices != NULL ? malloc(count * sizeof(*index_scratch)) : NULL;
+    sort_worker* workers = malloc(worker_count * sizeof(*workers));
+    if(value_scratch == NULL || (indices != NULL && index_scratch == NULL) || workers == NULL)
+    {
+        free(value_scratch);
+        free(index_scratch);
+        free(workers);
+        return 0;
+    }
+
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        workers[i].values_in = values;
+        workers[i].start = count * i / worker_count;
+        workers[i].end = count * (i + 1) / worker_count;
+        workers[i].flip = flip;
+    }
+
+    // A digit that's the same throughout doesn't need a pass, and those are
+    // found by a cheap read of the array before counting the rest.
+    run_workers(workers, worker_count, find_varying_bits);
+    uint64_t same_bits = ~(uint64_t)0;
+    uint64_t set_bits = 0;
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        same_bits &= workers[i].same_bits;
+        set_bits |= workers[i].set_bits;
+    }
+    uint64_t varying_bits = same_bits ^ set_bits;
+    int varying_digits = 0;
+    for(int digit = 0; digit < DIGIT_COUNT; digit++)
+    {
+        if(digit_of(varying_bits, 0, digit) != 0)
+        {
+            varying_digits |= 1 << digit;
+        }
+    }
+    if(varying_digits == 0)
+    {
+        free(value_scratch);
+        free(index_scratch);
+        free(workers);
+        return 1;
+    }
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        workers[i].digits = varying_digits;
+    }
+    run_workers(workers, worker_count, count_digits);
+
+    uint64_t* values_in = values;
+    uint64_t* values_out = value_scratch;
+    size_t* indices_in = indices;
+    size_t* indices_out = index_scratch;
+    int counts_are_current = 1;
+    for(int digit = 0; digit < DIGIT_COUNT; digit++)
+    {
+        if(!(varying_digits & (1 << digit)))
+        {
+            continue;
+        }
+
+        for(size_t i = 0; i < worker_count; i++)
+        {
+            workers[i].values_in = values_in;
+            workers[i].values_out = values_out;
+            workers[i].indices_in = indices_in;
+            workers[i].indices_out = indices_out;
+            workers[i].digit = digit;
+        }
+
+        // Each pass moves values between slices, so with more than one
+        // slice the counts have to be redone after the first pass. A
+        // single slice is the whole array, whose counts never change.
+        if(!counts_are_current && worker_count > 1)
+        {
+            run_workers(workers, worker_count, count_digit);
+        }
+
+        size_t position = 0;
+        for(size_t bucket = 0; bucket < RADIX_SIZE; bucket++)
+        {
+            for(size_t i = 0; i < worker_count; i++)
+            {
+                size_t bucket_count = workers[i].counts[digit][bucket];
+                workers[i].counts[digit][bucket] = position;
+                position += bucket_count;
+            }
+        }
+        run_workers(workers, worker_count, scatter);
+        counts_are_current = 0;
+
+        uint64_t* values_swap = values_in;
+        values_in = values_out;
+        values_out = values_swap;
+        size_t* indices_swap = indices_in;
+        indices_in = indices_out;
+        indices_out = indices_swap;
+    }
+
+    if(values_in != values)
+    {
+        memcpy(values, values_in, count * sizeof(*values));
+        if(indices != NULL)
+        {
+            memcpy(indices, indices_in, count * sizeof(*indices));
+        }
+    }
+    free(value_scratch);
+    free(index_scratch);
+    free(workers);
+    return 1;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+int smalltime_sort(smalltime* values, size_t* indices, size_t count, unsigned threads)
+{
+    return radix_sort((uint64_t*)values, indices, count, threads, SMALLTIME_KEY_FLIP);
+}
+
+int nanotime_sort(nanotime* values, size_t* indices, size_t count, unsigned threads)
+{
+    return radix_sort(values, indices, count, threads, NANOTIME_KEY_FLIP);
+}
@@ -0,0 +1,32 @@
+#include "tables.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+uint8_t* smalltime_read_file(const char* path, size_t* length)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        return NULL;
+    }
+    uint8_t* data = NULL;
+    long size;
+    if(fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        data = malloc((size_t)size + 1);
+        if(data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size)
+        {
+            free(data);
+            data = NULL;
+            errno = EIO;
+        }
+        if(data != NULL)
+        {
+            data[size] = 0;
+            *length = (size_t)size;
+        }
+    }
+    fclose(file);
+    return data;
+}
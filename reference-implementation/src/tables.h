@@ -0,0 +1,79 @@
+/*
+ * Helpers shared by the library sources that load tables of transitions
+ * from files and look time values up in them (tz.c and leap.c).
+ */
+#ifndef KS_smalltime_tables_H
+#define KS_smalltime_tables_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <smalltime/smalltime.h>
+#include <smalltime/nanotime.h>
+#include <smalltime/convert.h>
+#include "layout.h"
+
+#define SECONDS_PER_DAY 86400
+
+/**
+ * Find the last key at or before a key, with a branchless binary search.
+ *
+ * @param keys The sorted keys. keys[0] must be at or before key.
+ * @param count The number of keys (at least 1).
+ * @param key The key to look up.
+ * @return the index of the key found.
+ */
+static inline size_t smalltime_table_search(const int64_t* keys, size_t count, int64_t key)
+{
+    const int64_t* base = keys;
+    while(count > 1)
+    {
+        size_t half = count / 2;
+        base = base[half] <= key ? base + half : base;
+        count -= half;
+    }
+    return (size_t)(base - keys);
+}
+
+/**
+ * Get the smalltime value to look a nanotime value up by. Tables are kept
+ * as smalltime values, so nanotime values are truncated to microseconds.
+ *
+ * @param time The nanotime value.
+ * @return the smalltime value.
+ */
+static inline smalltime smalltime_table_nanotime_key(nanotime time)
+{
+    return nanotime_to_smalltime(time, SMALLTIME_CONVERT_TRUNCATE);
+}
+
+/**
+ * Convert the result of a lookup back to nanotime, giving it the
+ * nanoseconds of the nanotime value that was looked up.
+ *
+ * @param time The result of the lookup.
+ * @param original The nanotime value that was looked up.
+ * @param result Where to store the nanotime value. Untouched on failure.
+ * @return nonzero on success, or 0 if the result is outside of the nanotime range.
+ */
+static inline int smalltime_table_nanotime_result(smalltime time, nanotime original, nanotime* result)
+{
+    nanotime converted;
+    if(!smalltime_to_nanotime(time, &converted))
+    {
+        return 0;
+    }
+    *result = (converted & ~NT_MASK_NANOSECOND) | (original & NT_MASK_NANOSECOND);
+    return 1;
+}
+
+/**
+ * Read a whole file into memory, followed by a 0 byte.
+ *
+ * @param path The file path.
+ * @param length Where to store the length of the file (without the 0 byte).
+ * @return the contents, to be freed with free(), or NULL if the file
+ *         couldn't be read (see errno).
+ */
+uint8_t* smalltime_read_file(const char* path, size_t* length);
+
+#endif // KS_smalltime_tables_H
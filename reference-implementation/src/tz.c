@@ -0,0 +1,1125 @@
+#include <smalltime/tz.h>
+#include <smalltime/arith.h>
+#include <smalltime/convert.h>
+#include "layout.h"
+#include "tables.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// The Gregorian calendar repeats every 400 years, weekdays and all.
+#define CYCLE_YEARS 400
+// The time of day fields of a smalltime (hour, minute, second, microsecond).
+#define TIME_OF_DAY_MASK (((uint64_t)1 << ST_SHIFT_DAY) - 1)
+// RFC 8536 keeps UT offsets within a little over a day either way.
+#define MIN_OFFSET -89999
+#define MAX_OFFSET 93599
+// Longest abbreviation accepted from a footer.
+#define MAX_NAME_LENGTH 15
+
+// A zone is one allocation: this header, then the arrays it points to.
+struct smalltime_tz
+{
+    // Period i starts at starts[i] (UTC) and has UTC offset offsets[i].
+    // Period 0 starts before every value.
+    size_t count;
+    const int64_t* starts;
+    // The local times that period i starts and ends at, in its own offset.
+    // Where these overlap with the period before, the clocks went back, and
+    // where they leave a gap, the clocks went forward.
+    const int64_t* local_starts;
+    const int64_t* local_ends;
+    const int32_t* offsets;
+    // Offsets into names, of null terminated abbreviations.
+    const uint16_t* abbreviations;
+    const char* names;
+    // Values from this time on (in UTC or local time) are moved back by
+    // whole cycles, into the years that the footer rule was expanded over.
+    smalltime cycle_start;
+    int cycle_year;
+};
+
+// Moves a smalltime value by a number of seconds (less than two days),
+// carrying into the date fields. A leap second stays second 60.
+static inline smalltime shift_seconds(smalltime time, int32_t seconds)
+{
+    int is_leap = smalltime_get_second(time) == 60;
+    int64_t second_of_day = (int64_t)smalltime_get_hour(time) * 3600 + smalltime_get_minute(time) * 60 +
+                            smalltime_get_second(time) - is_leap + seconds;
+    smalltime date = (smalltime)((uint64_t)time & ~TIME_OF_DAY_MASK);
+    if((uint64_t)second_of_day >= SECONDS_PER_DAY)
+    {
+        int64_t days = second_of_day < 0 ? -((SECONDS_PER_DAY - 1 - second_of_day) / SECONDS_PER_DAY) : second_of_day / SECONDS_PER_DAY;
+        date = smalltime_add_days(date, days);
+        second_of_day -= days * SECONDS_PER_DAY;
+    }
+    return date |
+           ((smalltime)(second_of_day / 3600) << ST_SHIFT_HOUR) |
+           ((smalltime)(second_of_day / 60 % 60) << ST_SHIFT_MINUTE) |
+           ((smalltime)(second_of_day % 60 + is_leap) << ST_SHIFT_SECOND) |
+           smalltime_get_microsecond(time);
+}
+
+// Moves a value from a later cycle back into the table, returning the
+// number of years it was moved by.
+static inline int64_t move_into_table(const smalltime_tz* zone, smalltime* time)
+{
+    if(*time < zone->cycle_start)
+    {
+        return 0;
+    }
+    int64_t years = (int64_t)(smalltime_get_year(*time) - zone->cycle_year + CYCLE_YEARS) / CYCLE_YEARS * CYCLE_YEARS;
+    *time = (smalltime)((uint64_t)*time - ((uint64_t)years << ST_SHIFT_YEAR));
+    return years;
+}
+
+static inline smalltime move_out_of_table(smalltime time, int64_t years)
+{
+    return (smalltime)((uint64_t)time + ((uint64_t)years << ST_SHIFT_YEAR));
+}
+
+static inline size_t find_period(const smalltime_tz* zone, smalltime time)
+{
+    move_into_table(zone, &time);
+    return smalltime_table_search(zone->starts, zone->count, time);
+}
+
+static inline smalltime to_local(const smalltime_tz* zone, smalltime time)
+{
+    int64_t years = move_into_table(zone, &time);
+    smalltime local = shift_seconds(time, zone->offsets[smalltime_table_search(zone->starts, zone->count, time)]);
+    return move_out_of_table(local, years);
+}
+
+// How from_local() resolved a time.
+typedef enum
+{
+    RESOLVED_REJECTED = 0,
+    // Moved by an offset, keeping the fraction.
+    RESOLVED_SHIFTED = 1,
+    // Replaced by the transition at the end of a gap.
+    RESOLVED_TRANSITION = 2,
+} resolution;
+
+// Resolves a local time to UTC, storing the period it was found in.
+static inline resolution from_local(const smalltime_tz* zone, smalltime time,
+                                    smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                    smalltime* result, size_t* found)
+{
+    int64_t years = move_into_table(zone, &time);
+    size_t period = smalltime_table_search(zone->local_starts, zone->count, time);
+    *found = period;
+    int32_t offset = zone->offsets[period];
+
+    if(time >= zone->local_ends[period])
+    {
+        // Skipped when the clocks went forward at the next transition.
+        switch(gap)
+        {
+            case SMALLTIME_TZ_GAP_SHIFT_FORWARD:
+                break;
+            case SMALLTIME_TZ_GAP_NEXT_VALID:
+                *result = move_out_of_table(zone->starts[period + 1], years);
+                return RESOLVED_TRANSITION;
+            default:
+                return RESOLVED_REJECTED;
+        }
+    }
+    else if(period > 0 && time < zone->local_ends[period - 1])
+    {
+        // Also in the period before, from before the clocks went back.
+        switch(ambiguous)
+        {
+            case SMALLTIME_TZ_AMBIGUOUS_EARLIER:
+                offset = zone->offsets[period - 1];
+                break;
+            case SMALLTIME_TZ_AMBIGUOUS_LATER:
+                break;
+            default:
+                return RESOLVED_REJECTED;
+        }
+    }
+    *result = move_out_of_table(shift_seconds(time, -offset), years);
+    return RESOLVED_SHIFTED;
+}
+
+// Nanotime values go through the smalltime tables. Shifted values keep their
+// nanoseconds; transitions are exact.
+static inline int nanotime_result(smalltime time, nanotime original, resolution how, nanotime* result)
+{
+    switch(how)
+    {
+        case RESOLVED_REJECTED:
+            return 0;
+        case RESOLVED_SHIFTED:
+            return smalltime_table_nanotime_result(time, original, result);
+        default:
+            return smalltime_to_nanotime(time, result);
+    }
+}
+
+// Adds the flag of value i to a bitmap word, storing the word once it's
+// full (or the values run out), and returning how many flags it had.
+static inline size_t flag_value(uint64_t* failed, uint64_t* word, size_t i, size_t count, int is_flagged)
+{
+    *word |= (uint64_t)is_flagged << (i % 64);
+    if(i % 64 != 63 && i + 1 != count)
+    {
+        return 0;
+    }
+    size_t flagged = (size_t)__builtin_popcountll(*word);
+    if(failed != NULL)
+    {
+        failed[i / 64] = *word;
+    }
+    *word = 0;
+    return flagged;
+}
+
+
+// ==================================================================
+// Columns
+// ==================================================================
+
+// Columns are usually clustered in time, so the column conversions keep
+// the range of values that the last period covers, and only search when a
+// value falls outside of it. The range never reaches into the later
+// cycles, whose values always search.
+
+typedef struct
+{
+    smalltime start;
+    smalltime end;
+    int32_t offset;
+} period_cache;
+
+static inline void period_cache_init(period_cache* cache)
+{
+    cache->start = INT64_MAX;
+    cache->end = INT64_MIN;
+    cache->offset = 0;
+}
+
+static inline smalltime cached_to_local(const smalltime_tz* zone, period_cache* cache, smalltime time)
+{
+    if(time < cache->start || time >= cache->end)
+    {
+        if(time >= zone->cycle_start)
+        {
+            return to_local(zone, time);
+        }
+        size_t period = smalltime_table_search(zone->starts, zone->count, time);
+        cache->start = zone->starts[period];
+        cache->end = period + 1 < zone->count ? zone->starts[period + 1] : zone->cycle_start;
+        cache->offset = zone->offsets[period];
+    }
+    return shift_seconds(time, cache->offset);
+}
+
+static inline resolution cached_from_local(const smalltime_tz* zone, period_cache* cache, smalltime time,
+                                           smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                           smalltime* result)
+{
+    if(time >= cache->start && time < cache->end)
+    {
+        *result = shift_seconds(time, -cache->offset);
+        return RESOLVED_SHIFTED;
+    }
+    size_t period;
+    resolution how = from_local(zone, time, ambiguous, gap, result, &period);
+    if(time < zone->cycle_start)
+    {
+        // The part of the period that no other period overlaps.
+        cache->start = zone->local_starts[period];
+        if(period > 0 && zone->local_ends[period - 1] > cache->start)
+        {
+            cache->start = zone->local_ends[period - 1];
+        }
+        cache->end = zone->local_ends[period] < zone->cycle_start ? zone->local_ends[period] : zone->cycle_start;
+        if(period + 1 < zone->count && zone->local_starts[period + 1] < cache->end)
+        {
+            cache->end = zone->local_starts[period + 1];
+        }
+        cache->offset = zone->offsets[period];
+    }
+    return how;
+}
+
+
+// ==================================================================
+// Footer rules
+// ==================================================================
+
+// The POSIX TZ string in a TZif footer, such as "EST5EDT,M3.2.0,M11.1.0".
+
+typedef struct
+{
+    // 'J' (1 - 365, never counting February 29th), 'D' (0 - 365), or 'M'.
+    char kind;
+    int day;     // Day of the year, or day of the week (0 = Sunday) for 'M'.
+    int month;   // 'M' only.
+    int week;    // 'M' only: 1 - 4, or 5 for the last.
+    int32_t time;  // Local time of day in seconds, which can be out of the day.
+} rule_date;
+
+typedef struct
+{
+    char std_name[MAX_NAME_LENGTH + 1];
+    char dst_name[MAX_NAME_LENGTH + 1];
+    int32_t std_offset;  // Positive east of UTC.
+    int32_t dst_offset;
+    int has_dst;
+    rule_date start;
+    rule_date end;
+} posix_tz;
+
+static int parse_number(const char** text, const char* end, int min, int max, int* value)
+{
+    const char* p = *text;
+    int number = 0;
+    for(; p < end && *p >= '0' && *p <= '9' && p - *text < 3; p++)
+    {
+        number = number * 10 + (*p - '0');
+    }
+    if(p == *text || number < min || number > max)
+    {
+        return 0;
+    }
+    *text = p;
+    *value = number;
+    return 1;
+}
+
+// [+-]hh[:mm[:ss]], in seconds.
+static int parse_hms(const char** text, const char* end, int max_hours, int32_t* seconds)
+{
+    const char* p = *text;
+    int sign = 1;
+    if(p < end && (*p == '+' || *p == '-'))
+    {
+        sign = *p++ == '-' ? -1 : 1;
+    }
+    int hours, minutes = 0, secs = 0;
+    if(!parse_number(&p, end, 0, max_hours, &hours))
+    {
+        return 0;
+    }
+    if(p < end && *p == ':')
+    {
+        p++;
+        if(!parse_number(&p, end, 0, 59, &minutes))
+        {
+            return 0;
+        }
+        if(p < end && *p == ':')
+        {
+            p++;
+            if(!parse_number(&p, end, 0, 59, &secs))
+            {
+                return 0;
+            }
+        }
+    }
+    *text = p;
+    *seconds = sign * (hours * 3600 + minutes * 60 + secs);
+    return 1;
+}
+
+// Letters, or anything between < and >.
+static int parse_name(const char** text, const char* end, char* name)
+{
+    const char* p = *text;
+    const char* first;
+    const char* last;
+    if(p < end && *p == '<')
+    {
+        first = ++p;
+        while(p < end && *p != '>')
+        {
+            p++;
+        }
+        if(p == end)
+        {
+            return 0;
+        }
+        last = p++;
+    }
+    else
+    {
+        first = p;
+        while(p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z')))
+        {
+            p++;
+        }
+        last = p;
+    }
+    size_t length = (size_t)(last - first);
+    if(length < 3 || length > MAX_NAME_LENGTH)
+    {
+        return 0;
+    }
+    memcpy(name, first, length);
+    name[length] = 0;
+    *text = p;
+    return 1;
+}
+
+static int parse_rule_date(const char** text, const char* end, rule_date* date)
+{
+    const char* p = *text;
+    if(p < end && *p == 'M')
+    {
+        p++;
+        date->kind = 'M';
+        if(!parse_number(&p, end, 1, 12, &date->month) || p == end || *p++ != '.' ||
+           !parse_number(&p, end, 1, 5, &date->week) || p == end || *p++ != '.' ||
+           !parse_number(&p, end, 0, 6, &date->day))
+        {
+            return 0;
+        }
+    }
+    else if(p < end && *p == 'J')
+    {
+        p++;
+        date->kind = 'J';
+        if(!parse_number(&p, end, 1, 365, &date->day))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        date->kind = 'D';
+        if(!parse_number(&p, end, 0, 365, &date->day))
+        {
+            return 0;
+        }
+    }
+    date->time = 2 * 3600;
+    if(p < end && *p == '/')
+    {
+        p++;
+        if(!parse_hms(&p, end, 167, &date->time))
+        {
+            return 0;
+        }
+    }
+    *text = p;
+    return 1;
+}
+
+static int parse_posix_tz(const char* text, const char* end, posix_tz* tz)
+{
+    memset(tz, 0, sizeof(*tz));
+    const char* p = text;
+    // POSIX offsets are positive west of UTC.
+    if(!parse_name(&p, end, tz->std_name) || !parse_hms(&p, end, 24, &tz->std_offset))
+    {
+        return 0;
+    }
+    tz->std_offset = -tz->std_offset;
+    if(p == end)
+    {
+        return 1;
+    }
+
+    tz->has_dst = 1;
+    if(!parse_name(&p, end, tz->dst_name))
+    {
+        return 0;
+    }
+    tz->dst_offset = tz->std_offset + 3600;
+    if(p < end && *p != ',')
+    {
+        if(!parse_hms(&p, end, 24, &tz->dst_offset))
+        {
+            return 0;
+        }
+        tz->dst_offset = -tz->dst_offset;
+    }
+    if(p == end)
+    {
+        // No rule given: use the US one.
+        static const rule_date us_start = {'M', 0, 3, 2, 2 * 3600};
+        static const rule_date us_end = {'M', 0, 11, 1, 2 * 3600};
+        tz->start = us_start;
+        tz->end = us_end;
+        return 1;
+    }
+    if(*p++ != ',' || !parse_rule_date(&p, end, &tz->start) ||
+       p == end || *p++ != ',' || !parse_rule_date(&p, end, &tz->end))
+    {
+        return 0;
+    }
+    return p == end;
+}
+
+// Days since 1970-01-01 of a rule date in a year.
+static int64_t rule_day(const rule_date* date, int year)
+{
+    int64_t first = smalltime_days_from_civil(year, 1, 1);
+    if(date->kind == 'J')
+    {
+        return first + date->day - 1 + (date->day >= 60 && smalltime_is_leap_year(year));
+    }
+    if(date->kind == 'D')
+    {
+        return first + date->day;
+    }
+    int64_t month_start = smalltime_days_from_civil(year, date->month, 1);
+    // 1970-01-01 was a Thursday.
+    int weekday = (int)((month_start % 7 + 11) % 7);
+    int day = (date->day - weekday + 7) % 7 + (date->week - 1) * 7;
+    int length = smalltime_days_in_month(year, date->month);
+    while(day >= length)
+    {
+        day -= 7;
+    }
+    return month_start + day;
+}
+
+// Unix seconds of a rule date's transition, given the offset before it.
+static int64_t rule_transition(const rule_date* date, int year, int32_t offset_before)
+{
+    return rule_day(date, year) * SECONDS_PER_DAY + date->time - offset_before;
+}
+
+
+// ==================================================================
+// Loading
+// ==================================================================
+
+// Periods as they're collected, before being packed into a zone.
+typedef struct
+{
+    int64_t* starts;
+    int32_t* offsets;
+    uint16_t* abbreviations;
+    size_t count;
+    size_t capacity;
+} period_list;
+
+// Transitions outside of these (Unix seconds) are clamped to the start of
+// time, or dropped. They leave room for a day's offset either way.
+static int64_t earliest_transition(void)
+{
+    return ((int64_t)smalltime_days_from_civil(ST_MIN_YEAR, 1, 1) + 2) * SECONDS_PER_DAY;
+}
+
+static int64_t latest_transition(void)
+{
+    return ((int64_t)smalltime_days_from_civil(ST_MAX_YEAR, 12, 31) - 2) * SECONDS_PER_DAY;
+}
+
+// Adds a period starting at a transition (in Unix seconds). A transition
+// at or before the last one replaces its period, and one that changes
+// nothing is skipped.
+static int period_list_add(period_list* list, int64_t seconds, int32_t offset, uint16_t abbreviation)
+{
+    if(seconds > latest_transition())
+    {
+        return 1;
+    }
+    int64_t start = seconds < earliest_transition() ? INT64_MIN : (int64_t)smalltime_from_unix_seconds(seconds);
+    size_t last = list->count - 1;
+    if(start <= list->starts[last])
+    {
+        list->offsets[last] = offset;
+        list->abbreviations[last] = abbreviation;
+        return 1;
+    }
+    if(offset == list->offsets[last] && abbreviation == list->abbreviations[last])
+    {
+        return 1;
+    }
+    if(list->count == list->capacity)
+    {
+        size_t capacity = list->capacity * 2;
+        int64_t* starts = realloc(list->starts, capacity * sizeof(*starts));
+        if(starts != NULL)
+        {
+            list->starts = starts;
+        }
+        int32_t* offsets = realloc(list->offsets, capacity * sizeof(*offsets));
+        if(offsets != NULL)
+        {
+            list->offsets = offsets;
+        }
+        uint16_t* abbreviations = realloc(list->abbreviations, capacity * sizeof(*abbreviations));
+        if(abbreviations != NULL)
+        {
+            list->abbreviations = abbreviations;
+        }
+        if(starts == NULL || offsets == NULL || abbreviations == NULL)
+        {
+            return 0;
+        }
+        list->capacity = capacity;
+    }
+    list->starts[list->count] = start;
+    list->offsets[list->count] = offset;
+    list->abbreviations[list->count] = abbreviation;
+    list->count++;
+    return 1;
+}
+
+static int period_list_init(period_list* list, int32_t offset, uint16_t abbreviation)
+{
+    list->capacity = 64;
+    list->count = 1;
+    list->starts = malloc(list->capacity * sizeof(*list->starts));
+    list->offsets = malloc(list->capacity * sizeof(*list->offsets));
+    list->abbreviations = malloc(list->capacity * sizeof(*list->abbreviations));
+    if(list->starts == NULL || list->offsets == NULL || list->abbreviations == NULL)
+    {
+        return 0;
+    }
+    list->starts[0] = INT64_MIN;
+    list->offsets[0] = offset;
+    list->abbreviations[0] = abbreviation;
+    return 1;
+}
+
+static void period_list_free(period_list* list)
+{
+    free(list->starts);
+    free(list->offsets);
+    free(list->abbreviations);
+}
+
+// Adds the footer rule's transitions from a year on, for one whole cycle
+// (and a year, so that every year moved into the table is whole).
+static int add_rule_periods(period_list* list, const posix_tz* tz, int first_year, uint16_t std_name, uint16_t dst_name)
+{
+    int64_t last_start = list->starts[list->count - 1];
+    for(int year = first_year; year <= first_year + CYCLE_YEARS + 1; year++)
+    {
+        int64_t dst_start = rule_transition(&tz->start, year, tz->std_offset);
+        int64_t dst_end = rule_transition(&tz->end, year, tz->dst_offset);
+        int64_t first = dst_start < dst_end ? dst_start : dst_end;
+        int64_t second = dst_start < dst_end ? dst_end : dst_start;
+        int first_is_dst = dst_start < dst_end;
+        if(first >= earliest_transition() && (int64_t)smalltime_from_unix_seconds(first) > last_start &&
+           !period_list_add(list, first, first_is_dst ? tz->dst_offset : tz->std_offset, first_is_dst ? dst_name : std_name))
+        {
+            return 0;
+        }
+        if(second >= earliest_transition() && (int64_t)smalltime_from_unix_seconds(second) > last_start &&
+           !period_list_add(list, second, first_is_dst ? tz->std_offset : tz->dst_offset, first_is_dst ? std_name : dst_name))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline uint32_t read_be32(const uint8_t* data)
+{
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+static inline int64_t read_be64(const uint8_t* data)
+{
+    return (int64_t)((uint64_t)read_be32(data) << 32 | read_be32(data + 4));
+}
+
+typedef struct
+{
+    int version;
+    uint32_t isutcnt;
+    uint32_t isstdcnt;
+    uint32_t leapcnt;
+    uint32_t timecnt;
+    uint32_t typecnt;
+    uint32_t charcnt;
+} tzif_header;
+
+#define TZIF_HEADER_SIZE 44
+
+static int read_tzif_header(const uint8_t* data, size_t length, tzif_header* header)
+{
+    if(length < TZIF_HEADER_SIZE || memcmp(data, "TZif", 4) != 0)
+    {
+        return 0;
+    }
+    header->version = data[4] == 0 ? 1 : data[4] - '0';
+    header->isutcnt = read_be32(data + 20);
+    header->isstdcnt = read_be32(data + 24);
+    header->leapcnt = read_be32(data + 28);
+    header->timecnt = read_be32(data + 32);
+    header->typecnt = read_be32(data + 36);
+    header->charcnt = read_be32(data + 40);
+    return header->version >= 1 && header->typecnt > 0 && header->typecnt <= 256 && header->charcnt > 0 && header->charcnt <= 4096 &&
+           (header->isutcnt == 0 || header->isutcnt == header->typecnt) &&
+           (header->isstdcnt == 0 || header->isstdcnt == header->typecnt) &&
+           header->timecnt <= 1000000 && header->leapcnt <= 1000000;
+}
+
+static size_t tzif_data_size(const tzif_header* header, size_t time_size)
+{
+    return header->timecnt * time_size + header->timecnt + header->typecnt * 6 + header->charcnt +
+           header->leapcnt * (time_size + 4) + header->isstdcnt + header->isutcnt;
+}
+
+// Packs the periods and names into a single allocation.
+static smalltime_tz* build_zone(const period_list* list, const char* names, size_t names_size, int cycle_year)
+{
+    size_t count = list->count;
+    size_t size = sizeof(smalltime_tz) + count * (3 * sizeof(int64_t) + sizeof(int32_t) + sizeof(uint16_t)) + names_size;
+    smalltime_tz* zone = malloc(size);
+    if(zone == NULL)
+    {
+        return NULL;
+    }
+    int64_t* starts = (int64_t*)(zone + 1);
+    int64_t* local_starts = starts + count;
+    int64_t* local_ends = local_starts + count;
+    int32_t* offsets = (int32_t*)(local_ends + count);
+    uint16_t* abbreviations = (uint16_t*)(offsets + count);
+    char* zone_names = (char*)(abbreviations + count);
+
+    memcpy(starts, list->starts, count * sizeof(*starts));
+    memcpy(offsets, list->offsets, count * sizeof(*offsets));
+    memcpy(abbreviations, list->abbreviations, count * sizeof(*abbreviations));
+    memcpy(zone_names, names, names_size);
+    for(size_t i = 0; i < count; i++)
+    {
+        local_starts[i] = i == 0 ? INT64_MIN : shift_seconds(starts[i], offsets[i]);
+        local_ends[i] = i + 1 == count ? INT64_MAX : shift_seconds(starts[i + 1], offsets[i]);
+    }
+
+    zone->count = count;
+    zone->starts = starts;
+    zone->local_starts = local_starts;
+    zone->local_ends = local_ends;
+    zone->offsets = offsets;
+    zone->abbreviations = abbreviations;
+    zone->names = zone_names;
+    zone->cycle_year = cycle_year;
+    zone->cycle_start = cycle_year <= ST_MAX_YEAR ? smalltime_new(cycle_year, 1, 1, 0, 0, 0, 0) : INT64_MAX;
+    return zone;
+}
+
+// Parses a TZif file, setting errno to EINVAL if it isn't valid.
+static smalltime_tz* parse_tzif(const uint8_t* data, size_t length)
+{
+    errno = EINVAL;
+    tzif_header header;
+    if(!read_tzif_header(data, length, &header))
+    {
+        return NULL;
+    }
+    size_t time_size = 4;
+    if(header.version >= 2)
+    {
+        // Skip the 32-bit data, to the 64-bit header and data.
+        size_t skip = TZIF_HEADER_SIZE + tzif_data_size(&header, 4);
+        if(skip > length)
+        {
+            return NULL;
+        }
+        data += skip;
+        length -= skip;
+        if(!read_tzif_header(data, length, &header))
+        {
+            return NULL;
+        }
+        time_size = 8;
+    }
+    if(header.leapcnt != 0 || length - TZIF_HEADER_SIZE < tzif_data_size(&header, time_size))
+    {
+        return NULL;
+    }
+
+    const uint8_t* times = data + TZIF_HEADER_SIZE;
+    const uint8_t* type_indices = times + header.timecnt * time_size;
+    const uint8_t* types = type_indices + header.timecnt;
+    const char* chars = (const char*)(types + header.typecnt * 6);
+    const char* footer = (const char*)data + TZIF_HEADER_SIZE + tzif_data_size(&header, time_size);
+    const char* data_end = (const char*)data + length;
+
+    // The footer, between newlines, follows the 64-bit data.
+    posix_tz tz;
+    int has_rule = 0;
+    if(header.version >= 2 && footer < data_end && *footer == '\n')
+    {
+        const char* footer_end = memchr(footer + 1, '\n', (size_t)(data_end - footer - 1));
+        if(footer_end == NULL)
+        {
+            return NULL;
+        }
+        if(footer_end > footer + 1)
+        {
+            if(!parse_posix_tz(footer + 1, footer_end, &tz))
+            {
+                return NULL;
+            }
+            has_rule = tz.has_dst;
+        }
+    }
+
+    // Abbreviations from the file, then the footer's, each null terminated.
+    size_t names_size = header.charcnt + (has_rule ? 2 * (MAX_NAME_LENGTH + 1) : 0) + 1;
+    char* names = malloc(names_size);
+    if(names == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(names, chars, header.charcnt);
+    names[header.charcnt] = 0;
+    uint16_t std_name = 0;
+    uint16_t dst_name = 0;
+    if(has_rule)
+    {
+        std_name = (uint16_t)(header.charcnt + 1);
+        dst_name = (uint16_t)(std_name + MAX_NAME_LENGTH + 1);
+        memcpy(names + std_name, tz.std_name, MAX_NAME_LENGTH + 1);
+        memcpy(names + dst_name, tz.dst_name, MAX_NAME_LENGTH + 1);
+    }
+
+    smalltime_tz* zone = NULL;
+    period_list list;
+    if(!period_list_init(&list, (int32_t)read_be32(types), types[5]))
+    {
+        goto out_of_memory;
+    }
+    for(uint32_t i = 0; i < header.typecnt; i++)
+    {
+        int32_t offset = (int32_t)read_be32(types + i * 6);
+        if(offset < MIN_OFFSET || offset > MAX_OFFSET || types[i * 6 + 4] > 1 || types[i * 6 + 5] >= header.charcnt)
+        {
+            goto done;
+        }
+    }
+    int64_t previous = INT64_MIN;
+    for(uint32_t i = 0; i < header.timecnt; i++)
+    {
+        int64_t seconds = time_size == 8 ? read_be64(times + i * 8) : (int32_t)read_be32(times + i * 4);
+        if(type_indices[i] >= header.typecnt || seconds <= previous)
+        {
+            goto done;
+        }
+        const uint8_t* type = types + type_indices[i] * 6;
+        if(!period_list_add(&list, seconds, (int32_t)read_be32(type), type[5]))
+        {
+            goto out_of_memory;
+        }
+        previous = seconds;
+    }
+
+    int cycle_year = ST_MAX_YEAR + 1;
+    if(has_rule)
+    {
+        int first_year = list.count > 1 ? smalltime_get_year(list.starts[list.count - 1]) : 1970;
+        if(first_year + CYCLE_YEARS + 1 < ST_MAX_YEAR)
+        {
+            if(!add_rule_periods(&list, &tz, first_year, std_name, dst_name))
+            {
+                goto out_of_memory;
+            }
+            cycle_year = first_year + CYCLE_YEARS + 1;
+        }
+    }
+    zone = build_zone(&list, names, names_size, cycle_year);
+    if(zone != NULL)
+    {
+        goto done;
+    }
+
+out_of_memory:
+    errno = ENOMEM;
+done:
+    period_list_free(&list);
+    free(names);
+    return zone;
+}
+
+
+// ==================================================================
+// Cache
+// ==================================================================
+
+// A fixed hash table of lists that are only ever pushed onto, with a
+// compare-and-swap. Entries are never modified once published.
+
+#define CACHE_BUCKETS 256
+
+typedef struct cache_entry
+{
+    struct cache_entry* next;
+    smalltime_tz* zone;
+    char name[];
+} cache_entry;
+
+struct smalltime_tz_cache
+{
+    cache_entry* buckets[CACHE_BUCKETS];  // Only access atomically.
+    char directory[];
+};
+
+static uint32_t hash_name(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for(; *name != 0; name++)
+    {
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    }
+    return hash;
+}
+
+// Searches the entries from first up to (not including) stop.
+static cache_entry* find_entry(cache_entry* first, const cache_entry* stop, const char* name)
+{
+    for(cache_entry* entry = first; entry != stop; entry = entry->next)
+    {
+        if(strcmp(entry->name, name) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Names are relative paths that stay inside the directory.
+static int is_safe_name(const char* name)
+{
+    if(*name == 0 || *name == '/' || strchr(name, '\\') != NULL)
+    {
+        return 0;
+    }
+    for(const char* part = name; part != NULL; part = strchr(part, '/'))
+    {
+        part += *part == '/';
+        if(part[0] == '.' && part[1] == '.' && (part[2] == '/' || part[2] == 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+smalltime_tz* smalltime_tz_open(const char* path)
+{
+    size_t length;
+    uint8_t* data = smalltime_read_file(path, &length);
+    if(data == NULL)
+    {
+        return NULL;
+    }
+    smalltime_tz* zone = parse_tzif(data, length);
+    free(data);
+    return zone;
+}
+
+void smalltime_tz_close(smalltime_tz* zone)
+{
+    free(zone);
+}
+
+smalltime_tz_cache* smalltime_tz_cache_open(const char* directory)
+{
+    size_t length = strlen(directory);
+    smalltime_tz_cache* cache = calloc(1, sizeof(*cache) + length + 1);
+    if(cache != NULL)
+    {
+        memcpy(cache->directory, directory, length + 1);
+    }
+    return cache;
+}
+
+const smalltime_tz* smalltime_tz_cache_get(smalltime_tz_cache* cache, const char* name)
+{
+    cache_entry** bucket = &cache->buckets[hash_name(name) % CACHE_BUCKETS];
+    cache_entry* head = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+    cache_entry* entry = find_entry(head, NULL, name);
+    if(entry != NULL)
+    {
+        return entry->zone;
+    }
+    if(!is_safe_name(name))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Load without holding anything. Another thread may be loading the
+    // same zone, in which case the first to publish wins.
+    size_t directory_length = strlen(cache->directory);
+    size_t name_length = strlen(name);
+    entry = malloc(sizeof(*entry) + name_length + 1);
+    char* path = malloc(directory_length + name_length + 2);
+    if(entry == NULL || path == NULL)
+    {
+        free(entry);
+        free(path);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(path, cache->directory, directory_length);
+    path[directory_length] = '/';
+    memcpy(path + directory_length + 1, name, name_length + 1);
+    memcpy(entry->name, name, name_length + 1);
+    entry->zone = smalltime_tz_open(path);
+    free(path);
+    if(entry->zone == NULL)
+    {
+        free(entry);
+        return NULL;
+    }
+
+    for(;;)
+    {
+        entry->next = head;
+        if(__atomic_compare_exchange_n(bucket, &head, entry, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        {
+            return entry->zone;
+        }
+        // Only the entries pushed since need checking.
+        cache_entry* winner = find_entry(head, entry->next, name);
+        if(winner != NULL)
+        {
+            smalltime_tz_close(entry->zone);
+            free(entry);
+            return winner->zone;
+        }
+    }
+}
+
+void smalltime_tz_cache_close(smalltime_tz_cache* cache)
+{
+    for(size_t i = 0; i < CACHE_BUCKETS; i++)
+    {
+        cache_entry* entry = cache->buckets[i];
+        while(entry != NULL)
+        {
+            cache_entry* next = entry->next;
+            smalltime_tz_close(entry->zone);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(cache);
+}
+
+int32_t smalltime_tz_offset(const smalltime_tz* zone, smalltime time)
+{
+    return zone->offsets[find_period(zone, time)];
+}
+
+int32_t nanotime_tz_offset(const smalltime_tz* zone, nanotime time)
+{
+    return zone->offsets[find_period(zone, smalltime_table_nanotime_key(time))];
+}
+
+const char* smalltime_tz_abbreviation(const smalltime_tz* zone, smalltime time)
+{
+    return zone->names + zone->abbreviations[find_period(zone, time)];
+}
+
+const char* nanotime_tz_abbreviation(const smalltime_tz* zone, nanotime time)
+{
+    return zone->names + zone->abbreviations[find_period(zone, smalltime_table_nanotime_key(time))];
+}
+
+smalltime smalltime_tz_to_local(const smalltime_tz* zone, smalltime time)
+{
+    return to_local(zone, time);
+}
+
+int nanotime_tz_to_local(const smalltime_tz* zone, nanotime time, nanotime* result)
+{
+    return nanotime_result(to_local(zone, smalltime_table_nanotime_key(time)), time, RESOLVED_SHIFTED, result);
+}
+
+int smalltime_tz_from_local(const smalltime_tz* zone, smalltime time,
+                            smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                            smalltime* result)
+{
+    size_t period;
+    return from_local(zone, time, ambiguous, gap, result, &period) != RESOLVED_REJECTED;
+}
+
+int nanotime_tz_from_local(const smalltime_tz* zone, nanotime time,
+                           smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                           nanotime* result)
+{
+    size_t period;
+    smalltime utc = 0;
+    resolution how = from_local(zone, smalltime_table_nanotime_key(time), ambiguous, gap, &utc, &period);
+    return nanotime_result(utc, time, how, result);
+}
+
+void smalltime_tz_batch_to_local(const smalltime_tz* zone, const smalltime* values, size_t count, smalltime* results)
+{
+    period_cache cache;
+    period_cache_init(&cache);
+    for(size_t i = 0; i < count; i++)
+    {
+        results[i] = cached_to_local(zone, &cache, values[i]);
+    }
+}
+
+size_t nanotime_tz_batch_to_local(const smalltime_tz* zone, const nanotime* values, size_t count, nanotime* results, uint64_t* failed)
+{
+    period_cache cache;
+    period_cache_init(&cache);
+    size_t flagged = 0;
+    uint64_t word = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        nanotime value = values[i];
+        smalltime local = cached_to_local(zone, &cache, smalltime_table_nanotime_key(value));
+        flagged += flag_value(failed, &word, i, count, !nanotime_result(local, value, RESOLVED_SHIFTED, &results[i]));
+    }
+    return flagged;
+}
+
+size_t smalltime_tz_batch_from_local(const smalltime_tz* zone, const smalltime* values, size_t count,
+                                     smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                     smalltime* results, uint64_t* failed)
+{
+    period_cache cache;
+    period_cache_init(&cache);
+    size_t flagged = 0;
+    uint64_t word = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        smalltime utc;
+        resolution how = cached_from_local(zone, &cache, values[i], ambiguous, gap, &utc);
+        if(how != RESOLVED_REJECTED)
+        {
+            results[i] = utc;
+        }
+        flagged += flag_value(failed, &word, i, count, how == RESOLVED_REJECTED);
+    }
+    return flagged;
+}
+
+size_t nanotime_tz_batch_from_local(const smalltime_tz* zone, const nanotime* values, size_t count,
+                                    smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                                    nanotime* results, uint64_t* failed)
+{
+    period_cache cache;
+    period_cache_init(&cache);
+    size_t flagged = 0;
+    uint64_t word = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        nanotime value = values[i];
+        smalltime utc = 0;
+        resolution how = cached_from_local(zone, &cache, smalltime_table_nanotime_key(value), ambiguous, gap, &utc);
+        flagged += flag_value(failed, &word, i, count, !nanotime_result(utc, value, how, &results[i]));
+    }
+    return flagged;
+}
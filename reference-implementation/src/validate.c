@@ -0,0 +1,306 @@
+#include "kernels.h"
+#include <string.h>
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// Every variant checks the fields the same way, with February taken to
+// have 29 days. The few values on February 29th are then checked against
+// the leap year rules through layout->is_valid().
+
+static inline int is_february_29(uint64_t value, const smalltime_validation_layout* layout)
+{
+    return ((value >> layout->month_shift) & 0xf) == 2 && ((value >> layout->day_shift) & 0x1f) == 29;
+}
+
+static inline int is_invalid(uint64_t value, const smalltime_validation_layout* layout)
+{
+    uint64_t month = (value >> layout->month_shift) & 0xf;
+    uint64_t day = (value >> layout->day_shift) & 0x1f;
+    // 30 + alternating pattern that flips after July, 29 for February.
+    uint64_t days_in_month = month == 2 ? 29 : 30 + ((month ^ (month >> 3)) & 1);
+    return month - 1 > 11 ||
+           day - 1 > days_in_month - 1 ||
+           ((value >> layout->hour_shift) & 0x1f) > 23 ||
+           ((value >> layout->minute_shift) & 0x3f) > 59 ||
+           ((value >> layout->second_shift) & 0x3f) > 60 ||
+           (value & layout->fraction_mask) >= layout->fractions_per_second ||
+           (is_february_29(value, layout) && !layout->is_valid(value));
+}
+
+// Flags values [begin, end) in a word that starts at values[0].
+static inline uint64_t invalid_range(const uint64_t* values, size_t begin, size_t end, const smalltime_validation_layout* layout)
+{
+    uint64_t invalid = 0;
+    for(size_t i = begin; i < end; i++)
+    {
+        invalid |= (uint64_t)is_invalid(values[i], layout) << i;
+    }
+    return invalid;
+}
+
+// Rechecks the lanes on February 29th, which were assumed to be in a leap year.
+static inline uint64_t check_february_29(const uint64_t* values, uint64_t lanes, const smalltime_validation_layout* layout)
+{
+    uint64_t invalid = 0;
+    for(; lanes != 0; lanes &= lanes - 1)
+    {
+        int lane = __builtin_ctzll(lanes);
+        invalid |= (uint64_t)!layout->is_valid(values[lane]) << lane;
+    }
+    return invalid;
+}
+
+// Validates whole words of 64 values with WORD_INVALID(values), and the
+// rest with invalid_range().
+#define VALIDATE_WORDS(WORD_INVALID) \
+    size_t invalid_count = 0; \
+    for(size_t i = 0; i < count; i += 64) \
+    { \
+        uint64_t word = count - i >= 64 ? WORD_INVALID(values + i, layout) : invalid_range(values + i, 0, count - i, layout); \
+        invalid_count += (size_t)__builtin_popcountll(word); \
+        if(invalid != NULL) \
+        { \
+            invalid[i / 64] = word; \
+        } \
+    } \
+    return invalid_count
+
+
+// ==================================================================
+// Scalar
+// ==================================================================
+
+static inline uint64_t scalar_word_invalid(const uint64_t* values, const smalltime_validation_layout* layout)
+{
+    return invalid_range(values, 0, 64, layout);
+}
+
+size_t smalltime_batch_validate_scalar(const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid)
+{
+    VALIDATE_WORDS(scalar_word_invalid);
+}
+
+
+#ifdef SMALLTIME_HAVE_X86_KERNELS
+
+// ==================================================================
+// SSE4.2
+// ==================================================================
+
+// All fields are small and non-negative, so signed compares work as
+// unsigned ones.
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_field(__m128i v, int shift, int mask)
+{
+    return _mm_and_si128(_mm_srli_epi64(v, shift), _mm_set1_epi64x(mask));
+}
+
+SMALLTIME_TARGET_SSE42
+static inline __m128i sse42_outside(__m128i field, int64_t min, int64_t max)
+{
+    return _mm_or_si128(_mm_cmpgt_epi64(_mm_set1_epi64x(min), field), _mm_cmpgt_epi64(field, _mm_set1_epi64x(max)));
+}
+
+SMALLTIME_TARGET_SSE42
+static inline uint64_t sse42_word_invalid(const uint64_t* values, const smalltime_validation_layout* layout)
+{
+    uint64_t invalid = 0;
+    uint64_t february_29 = 0;
+    for(int i = 0; i < 64; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i month = sse42_field(v, layout->month_shift, 0xf);
+        __m128i day = sse42_field(v, layout->day_shift, 0x1f);
+        __m128i is_february = _mm_cmpeq_epi64(month, _mm_set1_epi64x(2));
+        __m128i days_in_month = _mm_add_epi64(_mm_set1_epi64x(30), _mm_and_si128(_mm_xor_si128(month, _mm_srli_epi64(month, 3)), _mm_set1_epi64x(1)));
+        days_in_month = _mm_blendv_epi8(days_in_month, _mm_set1_epi64x(29), is_february);
+        __m128i bad = _mm_or_si128(sse42_outside(month, 1, 12), sse42_outside(day, 1, 31));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(day, days_in_month));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(sse42_field(v, layout->hour_shift, 0x1f), _mm_set1_epi64x(23)));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(sse42_field(v, layout->minute_shift, 0x3f), _mm_set1_epi64x(59)));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(sse42_field(v, layout->second_shift, 0x3f), _mm_set1_epi64x(60)));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(_mm_and_si128(v, _mm_set1_epi64x((int64_t)layout->fraction_mask)),
+                                                _mm_set1_epi64x((int64_t)layout->fractions_per_second - 1)));
+        invalid |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(bad)) << i;
+        __m128i leap_day = _mm_and_si128(is_february, _mm_cmpeq_epi64(day, _mm_set1_epi64x(29)));
+        february_29 |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(leap_day)) << i;
+    }
+    return invalid | check_february_29(values, february_29 & ~invalid, layout);
+}
+
+SMALLTIME_TARGET_SSE42
+size_t smalltime_batch_validate_sse42(const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid)
+{
+    VALIDATE_WORDS(sse42_word_invalid);
+}
+
+
+// ==================================================================
+// AVX2
+// ==================================================================
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_field(__m256i v, int shift, int mask)
+{
+    return _mm256_and_si256(_mm256_srli_epi64(v, shift), _mm256_set1_epi64x(mask));
+}
+
+SMALLTIME_TARGET_AVX2
+static inline __m256i avx2_outside(__m256i field, int64_t min, int64_t max)
+{
+    return _mm256_or_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x(min), field), _mm256_cmpgt_epi64(field, _mm256_set1_epi64x(max)));
+}
+
+SMALLTIME_TARGET_AVX2
+static inline uint64_t avx2_word_invalid(const uint64_t* values, const smalltime_validation_layout* layout)
+{
+    uint64_t invalid = 0;
+    uint64_t february_29 = 0;
+    for(int i = 0; i < 64; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i month = avx2_field(v, layout->month_shift, 0xf);
+        __m256i day = avx2_field(v, layout->day_shift, 0x1f);
+        __m256i is_february = _mm256_cmpeq_epi64(month, _mm256_set1_epi64x(2));
+        __m256i days_in_month = _mm256_add_epi64(_mm256_set1_epi64x(30), _mm256_and_si256(_mm256_xor_si256(month, _mm256_srli_epi64(month, 3)), _mm256_set1_epi64x(1)));
+        days_in_month = _mm256_blendv_epi8(days_in_month, _mm256_set1_epi64x(29), is_february);
+        __m256i bad = _mm256_or_si256(avx2_outside(month, 1, 12), avx2_outside(day, 1, 31));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(day, days_in_month));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(avx2_field(v, layout->hour_shift, 0x1f), _mm256_set1_epi64x(23)));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(avx2_field(v, layout->minute_shift, 0x3f), _mm256_set1_epi64x(59)));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(avx2_field(v, layout->second_shift, 0x3f), _mm256_set1_epi64x(60)));
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(_mm256_and_si256(v, _mm256_set1_epi64x((int64_t)layout->fraction_mask)),
+                                                      _mm256_set1_epi64x((int64_t)layout->fractions_per_second - 1)));
+        invalid |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(bad)) << i;
+        __m256i leap_day = _mm256_and_si256(is_february, _mm256_cmpeq_epi64(day, _mm256_set1_epi64x(29)));
+        february_29 |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(leap_day)) << i;
+    }
+    return invalid | check_february_29(values, february_29 & ~invalid, layout);
+}
+
+SMALLTIME_TARGET_AVX2
+size_t smalltime_batch_validate_avx2(const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid)
+{
+    VALIDATE_WORDS(avx2_word_invalid);
+}
+
+
+// ==================================================================
+// AVX-512
+// ==================================================================
+
+SMALLTIME_TARGET_AVX512
+static inline __m512i avx512_field(__m512i v, int shift, int mask)
+{
+    return _mm512_and_si512(_mm512_srli_epi64(v, (unsigned)shift), _mm512_set1_epi64(mask));
+}
+
+SMALLTIME_TARGET_AVX512
+static inline uint64_t avx512_word_invalid(const uint64_t* values, const smalltime_validation_layout* layout)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    uint64_t invalid = 0;
+    uint64_t february_29 = 0;
+    for(int i = 0; i < 64; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512((const void*)(values + i));
+        __m512i month = avx512_field(v, layout->month_shift, 0xf);
+        __m512i day = avx512_field(v, layout->day_shift, 0x1f);
+        __mmask8 is_february = _mm512_cmpeq_epi64_mask(month, _mm512_set1_epi64(2));
+        __m512i days_in_month = _mm512_add_epi64(_mm512_set1_epi64(30), _mm512_and_si512(_mm512_xor_si512(month, _mm512_srli_epi64(month, 3)), one));
+        days_in_month = _mm512_mask_mov_epi64(days_in_month, is_february, _mm512_set1_epi64(29));
+        // Subtracting 1 wraps zero around, so one unsigned compare checks both ends.
+        __mmask8 bad = _mm512_cmpgt_epu64_mask(_mm512_sub_epi64(month, one), _mm512_set1_epi64(11)) |
+                       _mm512_cmpgt_epu64_mask(_mm512_sub_epi64(day, one), _mm512_sub_epi64(days_in_month, one)) |
+                       _mm512_cmpgt_epu64_mask(avx512_field(v, layout->hour_shift, 0x1f), _mm512_set1_epi64(23)) |
+                       _mm512_cmpgt_epu64_mask(avx512_field(v, layout->minute_shift, 0x3f), _mm512_set1_epi64(59)) |
+                       _mm512_cmpgt_epu64_mask(avx512_field(v, layout->second_shift, 0x3f), _mm512_set1_epi64(60)) |
+                       _mm512_cmpge_epu64_mask(_mm512_and_si512(v, _mm512_set1_epi64((int64_t)layout->fraction_mask)),
+                                               _mm512_set1_epi64((int64_t)layout->fractions_per_second));
+        invalid |= (uint64_t)bad << i;
+        february_29 |= (uint64_t)(is_february & _mm512_cmpeq_epi64_mask(day, _mm512_set1_epi64(29))) << i;
+    }
+    return invalid | check_february_29(values, february_29 & ~invalid, layout);
+}
+
+SMALLTIME_TARGET_AVX512
+size_t smalltime_batch_validate_avx512(const uint64_t* values, size_t count, const smalltime_validation_layout* layout, uint64_t* invalid)
+{
+    VALIDATE_WORDS(avx512_word_invalid);
+}
+
+#endif // SMALLTIME_HAVE_X86_KERNELS
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+static int smalltime_is_valid_bits(uint64_t value)
+{
+    return smalltime_is_valid((smalltime)value);
+}
+
+static int nanotime_is_valid_bits(uint64_t value)
+{
+    return nanotime_is_valid((nanotime)value);
+}
+
+static const smalltime_validation_layout smalltime_layout =
+{
+    ST_SHIFT_MONTH, ST_SHIFT_DAY, ST_SHIFT_HOUR, ST_SHIFT_MINUTE, ST_SHIFT_SECOND, ST_MASK_MICROSECOND, 1000000, smalltime_is_valid_bits,
+};
+
+static const smalltime_validation_layout nanotime_layout =
+{
+    NT_SHIFT_MONTH, NT_SHIFT_DAY, NT_SHIFT_HOUR, NT_SHIFT_MINUTE, NT_SHIFT_SECOND, NT_MASK_NANOSECOND, 1000000000, nanotime_is_valid_bits,
+};
+
+size_t smalltime_batch_validate(const smalltime* values, size_t count, uint64_t* invalid)
+{
+    return smalltime_kernels.smalltime_batch_validate((const uint64_t*)values, count, &smalltime_layout, invalid);
+}
+
+size_t nanotime_batch_validate(const nanotime* values, size_t count, uint64_t* invalid)
+{
+    return smalltime_kernels.smalltime_batch_validate(values, count, &nanotime_layout, invalid);
+}
+
+// Screens a word at a time, copying it across and then fixing the values
+// that were flagged.
+#define NORMALIZE_WORDS(TYPE, LAYOUT, NORMALIZE) \
+    size_t invalid_count = 0; \
+    for(size_t i = 0; i < count; i += 64) \
+    { \
+        size_t length = count - i < 64 ? count - i : 64; \
+        uint64_t invalid; \
+        invalid_count += smalltime_kernels.smalltime_batch_validate((const uint64_t*)values + i, length, &LAYOUT, &invalid); \
+        if(results != values) \
+        { \
+            memcpy(results + i, values + i, length * sizeof(TYPE)); \
+        } \
+        for(; invalid != 0; invalid &= invalid - 1) \
+        { \
+            size_t index = i + (size_t)__builtin_ctzll(invalid); \
+            results[index] = NORMALIZE(values[index]); \
+        } \
+    } \
+    return invalid_count
+
+size_t smalltime_batch_normalize(const smalltime* values, size_t count, smalltime* results)
+{
+    NORMALIZE_WORDS(smalltime, smalltime_layout, smalltime_normalize);
+}
+
+size_t nanotime_batch_normalize(const nanotime* values, size_t count, nanotime* results)
+{
+    NORMALIZE_WORDS(nanotime, nanotime_layout, nanotime_normalize);
+}
@@ -0,0 +1,606 @@
+#include <smalltime/wheel.h>
+#include "layout.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// ==================================================================
+// Common
+// ==================================================================
+
+// Keys are the values xored with flip, which orders smalltime values
+// (whose sign bit flips) and nanotime values (which are left alone) as
+// unsigned integers. Only the year field changes, so levels and slots are
+// the same in either.
+#define SMALLTIME_KEY_FLIP 0x8000000000000000ULL
+#define NANOTIME_KEY_FLIP  0
+
+#define MAX_LEVELS 8
+#define FRACTION_LEVEL_BITS 10
+#define NO_NODE UINT32_MAX
+
+typedef struct
+{
+    uint64_t deadline;
+    void* context;
+    uint32_t next;
+    uint32_t prev;
+    uint32_t generation;  // Odd while the timer is pending.
+} timer_node;
+
+typedef struct
+{
+    uint32_t head;
+    uint32_t tail;
+} timer_list;
+
+typedef struct
+{
+    uint64_t flip;
+    uint64_t now;
+    // Writes a fired timer to the caller's array of expiries.
+    void (*store_expiry)(void* expired, size_t position, uint64_t deadline, void* context);
+
+    // Level k holds the timers whose deadlines first differ from now in
+    // bits shifts[k] to shifts[k + 1] - 1, which are its slot number. The
+    // lists are every level's slots in turn, then the overflow list (for
+    // deadlines that differ in the year), then the due list (for
+    // deadlines at or before now, waiting to be handed out).
+    int level_count;
+    int shifts[MAX_LEVELS + 1];
+    uint8_t level_of_bit[64];
+    size_t first_list[MAX_LEVELS + 1];
+    size_t first_word[MAX_LEVELS];
+    timer_list* lists;
+    uint64_t* bitmaps;  // A bit for each slot with timers.
+    size_t overflow_list;
+    size_t due_list;
+    // The smallest key on the overflow list, or less if timers have been
+    // cancelled since it was found (which only costs a wasted look).
+    uint64_t overflow_min;
+
+    timer_node* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    uint32_t free_nodes;
+    size_t pending;
+} wheel;
+
+static inline uint64_t key_of(const wheel* w, uint64_t value)
+{
+    return value ^ w->flip;
+}
+
+static inline size_t slot_count(const wheel* w, int level)
+{
+    return (size_t)1 << (w->shifts[level + 1] - w->shifts[level]);
+}
+
+static inline size_t digit(const wheel* w, uint64_t value, int level)
+{
+    return (size_t)(value >> w->shifts[level]) & (slot_count(w, level) - 1);
+}
+
+// shifts holds each level's lowest bit, then the lowest bit of the year.
+static int wheel_init(wheel* w, uint64_t now, uint64_t flip, const int* shifts, int level_count,
+                      void (*store_expiry)(void* expired, size_t position, uint64_t deadline, void* context))
+{
+    memset(w, 0, sizeof(*w));
+    w->flip = flip;
+    w->now = now;
+    w->store_expiry = store_expiry;
+    w->level_count = level_count;
+    w->free_nodes = NO_NODE;
+    w->overflow_min = UINT64_MAX;
+
+    size_t list_count = 0;
+    size_t word_count = 0;
+    for(int level = 0; level <= level_count; level++)
+    {
+        w->shifts[level] = shifts[level];
+    }
+    for(int level = 0; level < level_count; level++)
+    {
+        w->first_list[level] = list_count;
+        w->first_word[level] = word_count;
+        list_count += slot_count(w, level);
+        word_count += (slot_count(w, level) + 63) / 64;
+        for(int bit = shifts[level]; bit < shifts[level + 1]; bit++)
+        {
+            w->level_of_bit[bit] = (uint8_t)level;
+        }
+    }
+    for(int bit = shifts[level_count]; bit < 64; bit++)
+    {
+        w->level_of_bit[bit] = (uint8_t)level_count;
+    }
+    w->first_list[level_count] = list_count;
+    w->overflow_list = list_count;
+    w->due_list = list_count + 1;
+
+    w->lists = malloc((list_count + 2) * sizeof(*w->lists));
+    w->bitmaps = calloc(word_count, sizeof(*w->bitmaps));
+    if(w->lists == NULL || w->bitmaps == NULL)
+    {
+        free(w->lists);
+        free(w->bitmaps);
+        return 0;
+    }
+    for(size_t i = 0; i < list_count + 2; i++)
+    {
+        w->lists[i].head = NO_NODE;
+        w->lists[i].tail = NO_NODE;
+    }
+    return 1;
+}
+
+static void wheel_deinit(wheel* w)
+{
+    free(w->lists);
+    free(w->bitmaps);
+    free(w->nodes);
+}
+
+
+// ==================================================================
+// Lists
+// ==================================================================
+
+static inline void set_slot_bit(wheel* w, int level, size_t slot)
+{
+    w->bitmaps[w->first_word[level] + slot / 64] |= 1ULL << (slot % 64);
+}
+
+static inline void clear_slot_bit(wheel* w, int level, size_t slot)
+{
+    w->bitmaps[w->first_word[level] + slot / 64] &= ~(1ULL << (slot % 64));
+}
+
+static inline void append(wheel* w, size_t list, uint32_t index)
+{
+    timer_list* l = &w->lists[list];
+    timer_node* node = &w->nodes[index];
+    node->next = NO_NODE;
+    node->prev = l->tail;
+    if(l->tail == NO_NODE)
+    {
+        l->head = index;
+    }
+    else
+    {
+        w->nodes[l->tail].next = index;
+    }
+    l->tail = index;
+}
+
+static inline void unlink_node(wheel* w, size_t list, uint32_t index)
+{
+    timer_list* l = &w->lists[list];
+    timer_node* node = &w->nodes[index];
+    if(node->prev == NO_NODE)
+    {
+        l->head = node->next;
+    }
+    else
+    {
+        w->nodes[node->prev].next = node->next;
+    }
+    if(node->next == NO_NODE)
+    {
+        l->tail = node->prev;
+    }
+    else
+    {
+        w->nodes[node->next].prev = node->prev;
+    }
+}
+
+// The level a deadline belongs in, or level_count for the overflow list,
+// or -1 if it's due.
+static inline int level_of(const wheel* w, uint64_t deadline)
+{
+    if(key_of(w, deadline) <= key_of(w, w->now))
+    {
+        return -1;
+    }
+    return w->level_of_bit[63 - __builtin_clzll(deadline ^ w->now)];
+}
+
+static inline size_t list_of(const wheel* w, uint64_t deadline, int level)
+{
+    if(level < 0)
+    {
+        return w->due_list;
+    }
+    if(level == w->level_count)
+    {
+        return w->overflow_list;
+    }
+    return w->first_list[level] + digit(w, deadline, level);
+}
+
+// Puts a timer in the list for its deadline, relative to now.
+static inline void place(wheel* w, uint32_t index)
+{
+    uint64_t deadline = w->nodes[index].deadline;
+    int level = level_of(w, deadline);
+    append(w, list_of(w, deadline, level), index);
+    if(level >= 0 && level < w->level_count)
+    {
+        set_slot_bit(w, level, digit(w, deadline, level));
+    }
+    else if(level == w->level_count && key_of(w, deadline) < w->overflow_min)
+    {
+        w->overflow_min = key_of(w, deadline);
+    }
+}
+
+// Takes a whole list, leaving it empty, and returns its first timer.
+static inline uint32_t take_list(wheel* w, size_t list)
+{
+    uint32_t head = w->lists[list].head;
+    w->lists[list].head = NO_NODE;
+    w->lists[list].tail = NO_NODE;
+    return head;
+}
+
+// Moves the timers of a list to the lists for their deadlines, relative to
+// now, keeping their order.
+static void cascade(wheel* w, size_t list)
+{
+    for(uint32_t index = take_list(w, list); index != NO_NODE;)
+    {
+        uint32_t next = w->nodes[index].next;
+        place(w, index);
+        index = next;
+    }
+}
+
+// Moves a lowest level slot, whose timers all have the deadline now, to
+// the end of the due list.
+static void splice_due(wheel* w, size_t list)
+{
+    timer_list* due = &w->lists[w->due_list];
+    uint32_t head = w->lists[list].head;
+    uint32_t tail = w->lists[list].tail;
+    take_list(w, list);
+    w->nodes[head].prev = due->tail;
+    if(due->tail == NO_NODE)
+    {
+        due->head = head;
+    }
+    else
+    {
+        w->nodes[due->tail].next = head;
+    }
+    due->tail = tail;
+}
+
+
+// ==================================================================
+// Timers
+// ==================================================================
+
+static inline uint64_t handle_of(const wheel* w, uint32_t index)
+{
+    return ((uint64_t)w->nodes[index].generation << 32) | index;
+}
+
+static uint32_t allocate_node(wheel* w)
+{
+    if(w->free_nodes != NO_NODE)
+    {
+        uint32_t index = w->free_nodes;
+        w->free_nodes = w->nodes[index].next;
+        return index;
+    }
+    if(w->node_count == w->node_capacity)
+    {
+        if(w->node_capacity >= NO_NODE / 2)
+        {
+            return NO_NODE;
+        }
+        uint32_t capacity = w->node_capacity == 0 ? 64 : w->node_capacity * 2;
+        timer_node* nodes = realloc(w->nodes, capacity * sizeof(*nodes));
+        if(nodes == NULL)
+        {
+            return NO_NODE;
+        }
+        w->nodes = nodes;
+        w->node_capacity = capacity;
+    }
+    w->nodes[w->node_count].generation = 0;
+    return w->node_count++;
+}
+
+static void free_node(wheel* w, uint32_t index)
+{
+    w->nodes[index].generation++;
+    w->nodes[index].next = w->free_nodes;
+    w->free_nodes = index;
+    w->pending--;
+}
+
+static uint64_t wheel_add(wheel* w, uint64_t deadline, void* context)
+{
+    uint32_t index = allocate_node(w);
+    if(index == NO_NODE)
+    {
+        return 0;
+    }
+    timer_node* node = &w->nodes[index];
+    node->deadline = deadline;
+    node->context = context;
+    node->generation++;
+    w->pending++;
+    place(w, index);
+    return handle_of(w, index);
+}
+
+static int wheel_cancel(wheel* w, uint64_t timer)
+{
+    uint32_t index = (uint32_t)timer;
+    if(index >= w->node_count || w->nodes[index].generation != (uint32_t)(timer >> 32) || (timer >> 32) % 2 == 0)
+    {
+        return 0;
+    }
+    // Timers only move when now reaches their slot, so the list a timer
+    // is in can be worked out again from its deadline.
+    uint64_t deadline = w->nodes[index].deadline;
+    int level = level_of(w, deadline);
+    size_t list = list_of(w, deadline, level);
+    unlink_node(w, list, index);
+    if(level >= 0 && level < w->level_count && w->lists[list].head == NO_NODE)
+    {
+        clear_slot_bit(w, level, digit(w, deadline, level));
+    }
+    free_node(w, index);
+    return 1;
+}
+
+
+// ==================================================================
+// Advancing
+// ==================================================================
+
+// The first slot in use at a level at or after from, or slot_count if none.
+static size_t next_slot(const wheel* w, int level, size_t from)
+{
+    size_t count = slot_count(w, level);
+    if(from >= count)
+    {
+        return count;
+    }
+    const uint64_t* words = w->bitmaps + w->first_word[level];
+    size_t word = from / 64;
+    uint64_t bits = words[word] & (~0ULL << (from % 64));
+    size_t word_count = (count + 63) / 64;
+    while(bits == 0)
+    {
+        if(++word == word_count)
+        {
+            return count;
+        }
+        bits = words[word];
+    }
+    return word * 64 + (size_t)__builtin_ctzll(bits);
+}
+
+// Finds the earliest slot in use after now. Lower levels come first, since
+// all of their slots are before the next slot of any higher level.
+static int next_occupied(const wheel* w, int* level, size_t* slot)
+{
+    for(int l = 0; l < w->level_count; l++)
+    {
+        size_t s = next_slot(w, l, digit(w, w->now, l) + 1);
+        if(s < slot_count(w, l))
+        {
+            *level = l;
+            *slot = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Hands out due timers, writing them from position on.
+static size_t drain_due(wheel* w, void* expired, size_t position, size_t capacity)
+{
+    size_t count = position;
+    timer_list* due = &w->lists[w->due_list];
+    while(count < capacity && due->head != NO_NODE)
+    {
+        uint32_t index = due->head;
+        timer_node* node = &w->nodes[index];
+        w->store_expiry(expired, count, node->deadline, node->context);
+        count++;
+        due->head = node->next;
+        free_node(w, index);
+    }
+    if(due->head == NO_NODE)
+    {
+        due->tail = NO_NODE;
+    }
+    else
+    {
+        w->nodes[due->head].prev = NO_NODE;
+    }
+    return count - position;
+}
+
+// Moves now to the start of the year of the earliest overflow timer, and
+// moves the timers of that year down into the levels.
+static int advance_year(wheel* w, uint64_t target_key)
+{
+    if(w->lists[w->overflow_list].head == NO_NODE)
+    {
+        return 0;
+    }
+    uint64_t year_start = (w->overflow_min ^ w->flip) & ~((1ULL << w->shifts[w->level_count]) - 1);
+    if(key_of(w, year_start) > target_key)
+    {
+        return 0;
+    }
+    w->now = year_start;
+    w->overflow_min = UINT64_MAX;
+    cascade(w, w->overflow_list);
+    return 1;
+}
+
+static size_t wheel_advance(wheel* w, uint64_t target, void* expired, size_t capacity)
+{
+    uint64_t target_key = key_of(w, target);
+    size_t fired = drain_due(w, expired, 0, capacity);
+    while(fired < capacity)
+    {
+        int level;
+        size_t slot;
+        if(!next_occupied(w, &level, &slot))
+        {
+            if(!advance_year(w, target_key))
+            {
+                break;
+            }
+            fired += drain_due(w, expired, fired, capacity);
+            continue;
+        }
+        uint64_t start = (w->now & ~((1ULL << w->shifts[level + 1]) - 1)) | ((uint64_t)slot << w->shifts[level]);
+        if(key_of(w, start) > target_key)
+        {
+            break;
+        }
+        w->now = start;
+        clear_slot_bit(w, level, slot);
+        if(level == 0)
+        {
+            splice_due(w, w->first_list[0] + slot);
+        }
+        else
+        {
+            cascade(w, w->first_list[level] + slot);
+        }
+        fired += drain_due(w, expired, fired, capacity);
+    }
+    if(fired < capacity && key_of(w, w->now) < target_key)
+    {
+        w->now = target;
+    }
+    return fired;
+}
+
+
+// ==================================================================
+// API
+// ==================================================================
+
+struct smalltime_wheel
+{
+    wheel wheel;
+};
+
+struct nanotime_wheel
+{
+    wheel wheel;
+};
+
+// The sub-second levels split the fraction into 10 bit pieces (the last
+// one taking what's left).
+static const int smalltime_shifts[] =
+{
+    0, FRACTION_LEVEL_BITS, ST_SHIFT_SECOND, ST_SHIFT_MINUTE, ST_SHIFT_HOUR, ST_SHIFT_DAY, ST_SHIFT_MONTH, ST_SHIFT_YEAR,
+};
+
+static const int nanotime_shifts[] =
+{
+    0, FRACTION_LEVEL_BITS, FRACTION_LEVEL_BITS * 2, NT_SHIFT_SECOND, NT_SHIFT_MINUTE, NT_SHIFT_HOUR, NT_SHIFT_DAY, NT_SHIFT_MONTH, NT_SHIFT_YEAR,
+};
+
+static void store_smalltime_expiry(void* expired, size_t position, uint64_t deadline, void* context)
+{
+    smalltime_expiry* expiry = (smalltime_expiry*)expired + position;
+    expiry->deadline = (smalltime)deadline;
+    expiry->context = context;
+}
+
+static void store_nanotime_expiry(void* expired, size_t position, uint64_t deadline, void* context)
+{
+    nanotime_expiry* expiry = (nanotime_expiry*)expired + position;
+    expiry->deadline = deadline;
+    expiry->context = context;
+}
+
+#define LEVEL_COUNT(SHIFTS) ((int)(sizeof(SHIFTS) / sizeof(*(SHIFTS))) - 1)
+
+smalltime_wheel* smalltime_wheel_new(smalltime now)
+{
+    smalltime_wheel* w = malloc(sizeof(*w));
+    if(w != NULL && !wheel_init(&w->wheel, (uint64_t)now, SMALLTIME_KEY_FLIP, smalltime_shifts, LEVEL_COUNT(smalltime_shifts), store_smalltime_expiry))
+    {
+        free(w);
+        w = NULL;
+    }
+    return w;
+}
+
+nanotime_wheel* nanotime_wheel_new(nanotime now)
+{
+    nanotime_wheel* w = malloc(sizeof(*w));
+    if(w != NULL && !wheel_init(&w->wheel, now, NANOTIME_KEY_FLIP, nanotime_shifts, LEVEL_COUNT(nanotime_shifts), store_nanotime_expiry))
+    {
+        free(w);
+        w = NULL;
+    }
+    return w;
+}
+
+void smalltime_wheel_free(smalltime_wheel* wheel)
+{
+    wheel_deinit(&wheel->wheel);
+    free(wheel);
+}
+
+void nanotime_wheel_free(nanotime_wheel* wheel)
+{
+    wheel_deinit(&wheel->wheel);
+    free(wheel);
+}
+
+smalltime_timer smalltime_wheel_add(smalltime_wheel* wheel, smalltime deadline, void* context)
+{
+    return wheel_add(&wheel->wheel, (uint64_t)deadline, context);
+}
+
+smalltime_timer nanotime_wheel_add(nanotime_wheel* wheel, nanotime deadline, void* context)
+{
+    return wheel_add(&wheel->wheel, deadline, context);
+}
+
+int smalltime_wheel_cancel(smalltime_wheel* wheel, smalltime_timer timer)
+{
+    return wheel_cancel(&wheel->wheel, timer);
+}
+
+int nanotime_wheel_cancel(nanotime_wheel* wheel, smalltime_timer timer)
+{
+    return wheel_cancel(&wheel->wheel, timer);
+}
+
+size_t smalltime_wheel_advance_to(smalltime_wheel* wheel, smalltime now, smalltime_expiry* expired, size_t capacity)
+{
+    return wheel_advance(&wheel->wheel, (uint64_t)now, expired, capacity);
+}
+
+size_t nanotime_wheel_advance_to(nanotime_wheel* wheel, nanotime now, nanotime_expiry* expired, size_t capacity)
+{
+    return wheel_advance(&wheel->wheel, now, expired, capacity);
+}
+
+size_t smalltime_wheel_count(const smalltime_wheel* wheel)
+{
+    return wheel->wheel.pending;
+}
+
+size_t nanotime_wheel_count(const nanotime_wheel* wheel)
+{
+    return wheel->wheel.pending;
+}
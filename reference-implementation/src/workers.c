@@ -0,0 +1,92 @@
+// For sysconf() when building in a strict C mode.
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif
+
+#include "workers.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+typedef struct
+{
+    void (*run)(void* worker);
+    void* worker;
+} worker_job;
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread(LPVOID argument)
+{
+    worker_job* job = argument;
+    job->run(job->worker);
+    return 0;
+}
+#else
+static void* worker_thread(void* argument)
+{
+    worker_job* job = argument;
+    job->run(job->worker);
+    return NULL;
+}
+#endif
+
+void smalltime_run_workers(void* workers, size_t worker_size, size_t worker_count, void (*run)(void* worker))
+{
+    worker_job jobs[SMALLTIME_MAX_WORKERS];
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        jobs[i].run = run;
+        jobs[i].worker = (char*)workers + i * worker_size;
+    }
+#if defined(_WIN32)
+    HANDLE threads[SMALLTIME_MAX_WORKERS];
+    for(size_t i = 1; i < worker_count; i++)
+    {
+        threads[i] = CreateThread(NULL, 0, worker_thread, &jobs[i], 0, NULL);
+    }
+    run(workers);
+    for(size_t i = 1; i < worker_count; i++)
+    {
+        if(threads[i] == NULL)
+        {
+            run(jobs[i].worker);
+            continue;
+        }
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#else
+    pthread_t threads[SMALLTIME_MAX_WORKERS];
+    int started[SMALLTIME_MAX_WORKERS];
+    for(size_t i = 1; i < worker_count; i++)
+    {
+        started[i] = pthread_create(&threads[i], NULL, worker_thread, &jobs[i]) == 0;
+    }
+    run(workers);
+    for(size_t i = 1; i < worker_count; i++)
+    {
+        if(!started[i])
+        {
+            run(jobs[i].worker);
+            continue;
+        }
+        pthread_join(threads[i], NULL);
+    }
+#endif
+}
+
+size_t smalltime_cpu_count(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+#endif
+}
@@ -0,0 +1,32 @@
+/*
+ * Runs a batch of jobs on their own threads, for use by the library
+ * sources that split large arrays among several threads.
+ */
+#ifndef KS_smalltime_workers_H
+#define KS_smalltime_workers_H
+
+#include <stddef.h>
+
+// The most workers that smalltime_run_workers() will run at once.
+#define SMALLTIME_MAX_WORKERS 64
+
+/**
+ * Run a job on each worker and wait for them all to finish. The first job
+ * runs on the calling thread, as does any job whose thread can't be
+ * started.
+ *
+ * @param workers An array of worker_count workers of worker_size bytes each.
+ * @param worker_size The size of each worker.
+ * @param worker_count The number of workers (at most SMALLTIME_MAX_WORKERS).
+ * @param run The job, which is passed its worker.
+ */
+void smalltime_run_workers(void* workers, size_t worker_size, size_t worker_count, void (*run)(void* worker));
+
+/**
+ * Get the number of CPUs that are online.
+ *
+ * @return the number of CPUs (at least 1).
+ */
+size_t smalltime_cpu_count(void);
+
+#endif // KS_smalltime_workers_H
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+#include <smalltime/arith.h>
+#include "for_each_isa.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Kept away from the ends of the range so that any test amount stays in range.
+static const int64_t smalltime_min_us = smalltime_to_unix_microseconds(smalltime_new(-130000, 1, 1, 0, 0, 0, 0));
+static const int64_t smalltime_max_us = smalltime_to_unix_microseconds(smalltime_new(130000, 1, 1, 0, 0, 0, 0));
+static const int64_t nanotime_min_ns = nanotime_to_unix_nanoseconds(nanotime_new(1990, 1, 1, 0, 0, 0, 0));
+static const int64_t nanotime_max_ns = nanotime_to_unix_nanoseconds(nanotime_new(2200, 1, 1, 0, 0, 0, 0));
+
+static std::vector<smalltime> random_smalltimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(smalltime_min_us, smalltime_max_us);
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        value = smalltime_from_unix_microseconds(anywhere(rng));
+    }
+    return values;
+}
+
+static std::vector<nanotime> random_nanotimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(nanotime_min_ns, nanotime_max_ns);
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        value = nanotime_from_unix_nanoseconds(anywhere(rng));
+    }
+    return values;
+}
+
+// Mostly amounts that stay within the field, plus some that carry.
+static int64_t random_amount(std::mt19937_64& rng, int64_t field_size, int64_t max_carry)
+{
+    std::uniform_int_distribution<int64_t> small(-field_size / 4, field_size / 4);
+    std::uniform_int_distribution<int64_t> large(-field_size * max_carry, field_size * max_carry);
+    return rng() % 4 == 0 ? large(rng) : small(rng);
+}
+
+// Month arithmetic done the long way round.
+static void reference_add_months(int& year, int& month, int& day, int64_t months)
+{
+    for(; months > 0; months--)
+    {
+        if(++month > 12)
+        {
+            month = 1;
+            year++;
+        }
+    }
+    for(; months < 0; months++)
+    {
+        if(--month < 1)
+        {
+            month = 12;
+            year--;
+        }
+    }
+    day = std::min(day, smalltime_days_in_month(year, month));
+}
+
+template<typename T, typename BATCH, typename SCALAR>
+static void test_batch(const std::vector<T>& values, int64_t amount, BATCH batch, SCALAR scalar)
+{
+    std::vector<T> results(values.size());
+    batch(values.data(), values.size(), amount, results.data());
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        ASSERT_EQ(scalar(values[i], amount), results[i]) << "index " << i << ", amount " << amount;
+    }
+
+    // In place.
+    std::vector<T> in_place = values;
+    batch(in_place.data(), in_place.size(), amount, in_place.data());
+    ASSERT_EQ(results, in_place);
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Arith, carries)
+{
+    EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 0), smalltime_add_microseconds(smalltime_new(1999, 12, 31, 23, 59, 59, 999999), 1));
+    EXPECT_EQ(smalltime_new(1999, 12, 31, 23, 59, 59, 999999), smalltime_add_microseconds(smalltime_new(2000, 1, 1, 0, 0, 0, 0), -1));
+    EXPECT_EQ(smalltime_new(2020, 3, 1, 0, 1, 30, 5), smalltime_add_seconds(smalltime_new(2020, 3, 1, 0, 0, 0, 5), 90));
+    EXPECT_EQ(smalltime_new(2020, 2, 29, 23, 59, 0, 5), smalltime_add_seconds(smalltime_new(2020, 3, 1, 0, 0, 0, 5), -60));
+    EXPECT_EQ(smalltime_new(2020, 2, 29, 12, 0, 0, 0), smalltime_add_days(smalltime_new(2020, 2, 26, 12, 0, 0, 0), 3));
+    EXPECT_EQ(smalltime_new(2019, 3, 1, 12, 0, 0, 0), smalltime_add_days(smalltime_new(2019, 2, 26, 12, 0, 0, 0), 3));
+    EXPECT_EQ(smalltime_new(1, 1, 1, 0, 0, 0, 0), smalltime_add_days(smalltime_new(0, 12, 31, 0, 0, 0, 0), 1));
+    EXPECT_EQ(smalltime_new(-1, 12, 31, 0, 0, 0, 0), smalltime_add_days(smalltime_new(0, 1, 1, 0, 0, 0, 0), -1));
+    EXPECT_EQ(smalltime_new(2024, 2, 29, 1, 2, 3, 4), smalltime_add_months(smalltime_new(2024, 1, 31, 1, 2, 3, 4), 1));
+    EXPECT_EQ(smalltime_new(2023, 2, 28, 1, 2, 3, 4), smalltime_add_months(smalltime_new(2023, 1, 31, 1, 2, 3, 4), 1));
+    EXPECT_EQ(smalltime_new(2025, 1, 15, 0, 0, 0, 0), smalltime_add_months(smalltime_new(2024, 12, 15, 0, 0, 0, 0), 1));
+    EXPECT_EQ(smalltime_new(-2, 11, 30, 0, 0, 0, 0), smalltime_add_months(smalltime_new(0, 1, 31, 0, 0, 0, 0), -14));
+
+    EXPECT_EQ(nanotime_new(2000, 1, 1, 0, 0, 0, 0), nanotime_add_nanoseconds(nanotime_new(1999, 12, 31, 23, 59, 59, 999999999), 1));
+    EXPECT_EQ(nanotime_new(2020, 3, 1, 0, 1, 30, 5), nanotime_add_seconds(nanotime_new(2020, 3, 1, 0, 0, 0, 5), 90));
+    EXPECT_EQ(nanotime_new(2019, 3, 1, 12, 0, 0, 0), nanotime_add_days(nanotime_new(2019, 2, 26, 12, 0, 0, 0), 3));
+    EXPECT_EQ(nanotime_new(2024, 2, 29, 1, 2, 3, 4), nanotime_add_months(nanotime_new(2024, 1, 31, 1, 2, 3, 4), 1));
+    EXPECT_EQ(nanotime_new(1970, 12, 31, 0, 0, 0, 0), nanotime_add_months(nanotime_new(1971, 1, 31, 0, 0, 0, 0), -1));
+}
+
+TEST(Arith, leap_second)
+{
+    smalltime st = smalltime_new(2016, 12, 31, 23, 59, 60, 500000);
+    EXPECT_EQ(st, smalltime_add_seconds(st, 0));
+    EXPECT_EQ(smalltime_new(2016, 12, 31, 23, 59, 60, 600000), smalltime_add_microseconds(st, 100000));
+    EXPECT_EQ(smalltime_new(2017, 1, 1, 0, 0, 1, 500000), smalltime_add_seconds(st, 1));
+    EXPECT_EQ(smalltime_new(2016, 12, 31, 23, 59, 59, 500000), smalltime_add_seconds(st, -1));
+
+    nanotime nt = nanotime_new(2016, 12, 31, 23, 59, 60, 500000000);
+    EXPECT_EQ(nt, nanotime_add_seconds(nt, 0));
+    EXPECT_EQ(nanotime_new(2017, 1, 1, 0, 0, 1, 500000000), nanotime_add_seconds(nt, 1));
+}
+
+TEST(Arith, smalltime_matches_epoch)
+{
+    std::mt19937_64 rng(1);
+    for(smalltime value: random_smalltimes(100000, 1))
+    {
+        int64_t us = random_amount(rng, 1000000, 500);
+        int64_t s = random_amount(rng, 60, 500);
+        int64_t d = random_amount(rng, 30, 500);
+        ASSERT_EQ(smalltime_from_unix_microseconds(smalltime_to_unix_microseconds(value) + us), smalltime_add_microseconds(value, us));
+        ASSERT_EQ(smalltime_from_unix_microseconds(smalltime_to_unix_microseconds(value) + s * 1000000), smalltime_add_seconds(value, s));
+        ASSERT_EQ(smalltime_from_unix_microseconds(smalltime_to_unix_microseconds(value) + d * 86400000000LL), smalltime_add_days(value, d));
+    }
+}
+
+TEST(Arith, nanotime_matches_epoch)
+{
+    std::mt19937_64 rng(2);
+    for(nanotime value: random_nanotimes(100000, 2))
+    {
+        int64_t ns = random_amount(rng, 1000000000, 100);
+        int64_t s = random_amount(rng, 60, 100);
+        int64_t d = random_amount(rng, 30, 100);
+        ASSERT_EQ(nanotime_from_unix_nanoseconds(nanotime_to_unix_nanoseconds(value) + ns), nanotime_add_nanoseconds(value, ns));
+        ASSERT_EQ(nanotime_from_unix_nanoseconds(nanotime_to_unix_nanoseconds(value) + s * 1000000000), nanotime_add_seconds(value, s));
+        ASSERT_EQ(nanotime_from_unix_nanoseconds(nanotime_to_unix_nanoseconds(value) + d * 86400000000000LL), nanotime_add_days(value, d));
+    }
+}
+
+TEST(Arith, months_match_reference)
+{
+    std::mt19937_64 rng(3);
+    for(smalltime value: random_smalltimes(20000, 3))
+    {
+        int64_t months = random_amount(rng, 12, 500);
+        int year = smalltime_get_year(value);
+        int month = smalltime_get_month(value);
+        int day = smalltime_get_day(value);
+        reference_add_months(year, month, day, months);
+        smalltime expected = smalltime_new(year, month, day, smalltime_get_hour(value), smalltime_get_minute(value),
+            smalltime_get_second(value), smalltime_get_microsecond(value));
+        ASSERT_EQ(expected, smalltime_add_months(value, months)) << months;
+    }
+    for(nanotime value: random_nanotimes(20000, 4))
+    {
+        int64_t months = random_amount(rng, 12, 10);
+        int year = nanotime_get_year(value);
+        int month = nanotime_get_month(value);
+        int day = nanotime_get_day(value);
+        reference_add_months(year, month, day, months);
+        nanotime expected = nanotime_new(year, month, day, nanotime_get_hour(value), nanotime_get_minute(value),
+            nanotime_get_second(value), nanotime_get_nanosecond(value));
+        ASSERT_EQ(expected, nanotime_add_months(value, months)) << months;
+    }
+}
+
+TEST(Arith, batch_smalltime)
+{
+    for_each_isa([&]
+    {
+        std::mt19937_64 rng(5);
+        for(size_t count: {0, 1, 7, 8, 9, 31, 10003})
+        {
+            std::vector<smalltime> values = random_smalltimes(count, count);
+            for(int i = 0; i < 4; i++)
+            {
+                test_batch(values, random_amount(rng, 1000000, 500), smalltime_batch_add_microseconds, smalltime_add_microseconds);
+                test_batch(values, random_amount(rng, 60, 500), smalltime_batch_add_seconds, smalltime_add_seconds);
+                test_batch(values, random_amount(rng, 30, 500), smalltime_batch_add_days, smalltime_add_days);
+                test_batch(values, random_amount(rng, 12, 500), smalltime_batch_add_months, smalltime_add_months);
+            }
+        }
+    });
+}
+
+TEST(Arith, batch_nanotime)
+{
+    for_each_isa([&]
+    {
+        std::mt19937_64 rng(6);
+        for(size_t count: {0, 1, 7, 8, 9, 31, 10003})
+        {
+            std::vector<nanotime> values = random_nanotimes(count, count);
+            for(int i = 0; i < 4; i++)
+            {
+                test_batch(values, random_amount(rng, 1000000000, 100), nanotime_batch_add_nanoseconds, nanotime_add_nanoseconds);
+                test_batch(values, random_amount(rng, 60, 100), nanotime_batch_add_seconds, nanotime_add_seconds);
+                test_batch(values, random_amount(rng, 30, 100), nanotime_batch_add_days, nanotime_add_days);
+                test_batch(values, random_amount(rng, 12, 10), nanotime_batch_add_months, nanotime_add_months);
+            }
+        }
+    });
+}
+
+TEST(Arith, diff)
+{
+    EXPECT_EQ(5, smalltime_diff_us(smalltime_new(2020, 1, 1, 0, 0, 0, 10), smalltime_new(2020, 1, 1, 0, 0, 0, 5)));
+    EXPECT_EQ(-5, smalltime_diff_us(smalltime_new(2020, 1, 1, 0, 0, 0, 5), smalltime_new(2020, 1, 1, 0, 0, 0, 10)));
+    EXPECT_EQ(1, smalltime_diff_us(smalltime_new(2020, 1, 1, 0, 0, 0, 0), smalltime_new(2019, 12, 31, 23, 59, 59, 999999)));
+    EXPECT_EQ(3599999999LL, smalltime_diff_us(smalltime_new(2020, 1, 1, 0, 59, 59, 999999), smalltime_new(2020, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ(-86400000000LL, smalltime_diff_us(smalltime_new(-1, 12, 31, 0, 0, 0, 0), smalltime_new(0, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ(999999999, nanotime_diff_ns(nanotime_new(2020, 1, 1, 12, 0, 0, 999999999), nanotime_new(2020, 1, 1, 12, 0, 0, 0)));
+    EXPECT_EQ(1, nanotime_diff_ns(nanotime_new(2020, 1, 1, 12, 0, 1, 0), nanotime_new(2020, 1, 1, 12, 0, 0, 999999999)));
+    EXPECT_EQ(-1, nanotime_diff_ns(nanotime_new(2020, 1, 1, 12, 0, 0, 999999999), nanotime_new(2020, 1, 1, 12, 0, 1, 0)));
+    // A leap second counts as second 0 of the next minute.
+    EXPECT_EQ(0, nanotime_diff_ns(nanotime_new(2017, 1, 1, 0, 0, 0, 0), nanotime_new(2016, 12, 31, 23, 59, 60, 0)));
+    EXPECT_EQ(0, smalltime_diff_us(smalltime_new(2016, 12, 31, 23, 59, 60, 0), smalltime_new(2016, 12, 31, 23, 59, 60, 0)));
+}
+
+TEST(Arith, diff_matches_epoch)
+{
+    std::mt19937_64 rng(7);
+    std::vector<smalltime> smalltimes = random_smalltimes(100000, 7);
+    for(size_t i = 0; i < smalltimes.size(); i++)
+    {
+        smalltime end = smalltimes[i];
+        smalltime start = i % 2 ? smalltimes[i - 1] : smalltime_add_microseconds(end, -random_amount(rng, 1000000, 100000));
+        ASSERT_EQ(smalltime_to_unix_microseconds(end) - smalltime_to_unix_microseconds(start), smalltime_diff_us(end, start));
+    }
+    std::vector<nanotime> nanotimes = random_nanotimes(100000, 8);
+    for(size_t i = 0; i < nanotimes.size(); i++)
+    {
+        nanotime end = nanotimes[i];
+        nanotime start = i % 2 ? nanotimes[i - 1] : nanotime_add_nanoseconds(end, -random_amount(rng, 1000000000, 100000));
+        ASSERT_EQ(nanotime_to_unix_nanoseconds(end) - nanotime_to_unix_nanoseconds(start), nanotime_diff_ns(end, start));
+    }
+}
+
+TEST(Arith, batch_diff)
+{
+    for_each_isa([&]
+    {
+        std::mt19937_64 rng(9);
+        for(size_t count: {0, 1, 7, 8, 9, 31, 10003})
+        {
+            std::vector<smalltime> smalltime_ends = random_smalltimes(count, count);
+            std::vector<smalltime> smalltime_starts(count);
+            std::vector<nanotime> nanotime_ends = random_nanotimes(count, count);
+            std::vector<nanotime> nanotime_starts(count);
+            for(size_t i = 0; i < count; i++)
+            {
+                // Mostly latencies within the same day, sometimes across days.
+                smalltime_starts[i] = smalltime_add_microseconds(smalltime_ends[i], -random_amount(rng, 1000000, 100000));
+                nanotime_starts[i] = nanotime_add_nanoseconds(nanotime_ends[i], -random_amount(rng, 1000000000, 100000));
+            }
+            std::vector<int64_t> smalltime_durations(count), nanotime_durations(count);
+            smalltime_batch_diff_us(smalltime_ends.data(), smalltime_starts.data(), count, smalltime_durations.data());
+            nanotime_batch_diff_ns(nanotime_ends.data(), nanotime_starts.data(), count, nanotime_durations.data());
+            for(size_t i = 0; i < count; i++)
+            {
+                ASSERT_EQ(smalltime_diff_us(smalltime_ends[i], smalltime_starts[i]), smalltime_durations[i]);
+                ASSERT_EQ(nanotime_diff_ns(nanotime_ends[i], nanotime_starts[i]), nanotime_durations[i]);
+            }
+        }
+    });
+}
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <smalltime/batch.h>
+#include "for_each_isa.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+struct smalltime_column_storage
+{
+    std::vector<int> year, month, day, hour, minute, second, microsecond;
+    smalltime_columns columns;
+
+    explicit smalltime_column_storage(size_t count)
+    : year(count), month(count), day(count), hour(count), minute(count), second(count), microsecond(count)
+    {
+        columns = {year.data(), month.data(), day.data(), hour.data(), minute.data(), second.data(), microsecond.data()};
+    }
+};
+
+struct nanotime_column_storage
+{
+    std::vector<int> year, month, day, hour, minute, second, nanosecond;
+    nanotime_columns columns;
+
+    explicit nanotime_column_storage(size_t count)
+    : year(count), month(count), day(count), hour(count), minute(count), second(count), nanosecond(count)
+    {
+        columns = {year.data(), month.data(), day.data(), hour.data(), minute.data(), second.data(), nanosecond.data()};
+    }
+};
+
+// Any 64-bit pattern decodes, so decoders are checked against raw random bits.
+static std::vector<uint64_t> random_bits(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> values(count);
+    for(auto& value: values)
+    {
+        value = rng();
+    }
+    return values;
+}
+
+static void test_smalltime_decode(size_t count)
+{
+    std::vector<uint64_t> bits = random_bits(count, count);
+    std::vector<smalltime> values(bits.begin(), bits.end());
+    smalltime_column_storage storage(count);
+    smalltime_batch_decode(values.data(), count, &storage.columns);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(smalltime_get_year(values[i]), storage.year[i]);
+        ASSERT_EQ(smalltime_get_month(values[i]), storage.month[i]);
+        ASSERT_EQ(smalltime_get_day(values[i]), storage.day[i]);
+        ASSERT_EQ(smalltime_get_hour(values[i]), storage.hour[i]);
+        ASSERT_EQ(smalltime_get_minute(values[i]), storage.minute[i]);
+        ASSERT_EQ(smalltime_get_second(values[i]), storage.second[i]);
+        ASSERT_EQ(smalltime_get_microsecond(values[i]), storage.microsecond[i]);
+    }
+}
+
+static void test_smalltime_encode(size_t count)
+{
+    std::mt19937 rng(count);
+    smalltime_column_storage storage(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        storage.year[i] = std::uniform_int_distribution<int>(-131072, 131071)(rng);
+        storage.month[i] = rng() & 0xf;
+        storage.day[i] = rng() & 0x1f;
+        storage.hour[i] = rng() & 0x1f;
+        storage.minute[i] = rng() & 0x3f;
+        storage.second[i] = rng() & 0x3f;
+        storage.microsecond[i] = rng() & 0xfffff;
+    }
+    std::vector<smalltime> values(count);
+    smalltime_batch_encode(&storage.columns, count, values.data());
+
+    for(size_t i = 0; i < count; i++)
+    {
+        smalltime expected = smalltime_new(storage.year[i], storage.month[i], storage.day[i],
+            storage.hour[i], storage.minute[i], storage.second[i], storage.microsecond[i]);
+        ASSERT_EQ(expected, values[i]);
+    }
+}
+
+static void test_nanotime_decode(size_t count)
+{
+    std::vector<uint64_t> bits = random_bits(count, count);
+    std::vector<nanotime> values(bits.begin(), bits.end());
+    nanotime_column_storage storage(count);
+    nanotime_batch_decode(values.data(), count, &storage.columns);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(nanotime_get_year(values[i]), storage.year[i]);
+        ASSERT_EQ(nanotime_get_month(values[i]), storage.month[i]);
+        ASSERT_EQ(nanotime_get_day(values[i]), storage.day[i]);
+        ASSERT_EQ(nanotime_get_hour(values[i]), storage.hour[i]);
+        ASSERT_EQ(nanotime_get_minute(values[i]), storage.minute[i]);
+        ASSERT_EQ(nanotime_get_second(values[i]), storage.second[i]);
+        ASSERT_EQ(nanotime_get_nanosecond(values[i]), storage.nanosecond[i]);
+    }
+}
+
+static void test_nanotime_encode(size_t count)
+{
+    std::mt19937 rng(count);
+    nanotime_column_storage storage(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        storage.year[i] = 1970 + (rng() & 0xff);
+        storage.month[i] = rng() & 0xf;
+        storage.day[i] = rng() & 0x1f;
+        storage.hour[i] = rng() & 0x1f;
+        storage.minute[i] = rng() & 0x3f;
+        storage.second[i] = rng() & 0x3f;
+        storage.nanosecond[i] = rng() & 0x3fffffff;
+    }
+    std::vector<nanotime> values(count);
+    nanotime_batch_encode(&storage.columns, count, values.data());
+
+    for(size_t i = 0; i < count; i++)
+    {
+        nanotime expected = nanotime_new(storage.year[i], storage.month[i], storage.day[i],
+            storage.hour[i], storage.minute[i], storage.second[i], storage.nanosecond[i]);
+        ASSERT_EQ(expected, values[i]);
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Batch, smalltime_decode)
+{
+    for_each_isa([&]
+    {
+        for(size_t count = 0; count < 70; count++)
+        {
+            test_smalltime_decode(count);
+        }
+        test_smalltime_decode(100003);
+    });
+}
+
+TEST(Batch, smalltime_encode)
+{
+    for_each_isa([&]
+    {
+        for(size_t count = 0; count < 70; count++)
+        {
+            test_smalltime_encode(count);
+        }
+        test_smalltime_encode(100003);
+    });
+}
+
+TEST(Batch, nanotime_decode)
+{
+    for_each_isa([&]
+    {
+        for(size_t count = 0; count < 70; count++)
+        {
+            test_nanotime_decode(count);
+        }
+        test_nanotime_decode(100003);
+    });
+}
+
+TEST(Batch, nanotime_encode)
+{
+    for_each_isa([&]
+    {
+        for(size_t count = 0; count < 70; count++)
+        {
+            test_nanotime_encode(count);
+        }
+        test_nanotime_encode(100003);
+    });
+}
+
+TEST(Batch, smalltime_round_trip)
+{
+    for_each_isa([&]
+    {
+        std::vector<smalltime> values;
+        for(int year = -131072; year <= 131071; year += 7)
+        {
+            values.push_back(smalltime_new(year, 12, 31, 23, 59, 60, 999999));
+            values.push_back(smalltime_new(year, 1, 1, 0, 0, 0, 0));
+        }
+        smalltime_column_storage storage(values.size());
+        std::vector<smalltime> round_trip(values.size());
+        smalltime_batch_decode(values.data(), values.size(), &storage.columns);
+        smalltime_batch_encode(&storage.columns, values.size(), round_trip.data());
+        EXPECT_EQ(values, round_trip);
+    });
+}
+
+TEST(Batch, nanotime_round_trip)
+{
+    for_each_isa([&]
+    {
+        std::vector<nanotime> values;
+        for(int year = 1970; year <= 2225; year++)
+        {
+            values.push_back(nanotime_new(year, 12, 31, 23, 59, 60, 999999999));
+            values.push_back(nanotime_new(year, 1, 1, 0, 0, 0, 0));
+        }
+        nanotime_column_storage storage(values.size());
+        std::vector<nanotime> round_trip(values.size());
+        nanotime_batch_decode(values.data(), values.size(), &storage.columns);
+        nanotime_batch_encode(&storage.columns, values.size(), round_trip.data());
+        EXPECT_EQ(values, round_trip);
+    });
+}
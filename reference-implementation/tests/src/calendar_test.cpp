@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <smalltime/calendar.h>
+#include "for_each_isa.h"
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+struct calendar_fields
+{
+    std::vector<int> weekday;
+    std::vector<int> day_of_year;
+    std::vector<int> iso_week;
+    std::vector<int> iso_week_year;
+
+    explicit calendar_fields(size_t count)
+    : weekday(count)
+    , day_of_year(count)
+    , iso_week(count)
+    , iso_week_year(count)
+    {
+    }
+
+    smalltime_calendar_columns columns()
+    {
+        return {weekday.data(), day_of_year.data(), iso_week.data(), iso_week_year.data()};
+    }
+};
+
+// The fields of day number n (days since 1970-01-01), worked out by
+// counting days rather than from the year, month and day fields.
+static void reference_fields(int32_t n, calendar_fields& fields, size_t index)
+{
+    int year, month, day;
+    smalltime_civil_from_days(n, &year, &month, &day);
+    // 1970-01-01 was a Thursday.
+    int weekday = (int)(((int64_t)n % 7 + 10) % 7) + 1;
+    // ISO weeks belong to the year that their Thursday is in.
+    int32_t thursday = n - weekday + 4;
+    int thursday_year, thursday_month, thursday_day;
+    smalltime_civil_from_days(thursday, &thursday_year, &thursday_month, &thursday_day);
+
+    fields.weekday[index] = weekday;
+    fields.day_of_year[index] = n - smalltime_days_from_civil(year, 1, 1) + 1;
+    fields.iso_week[index] = (thursday - smalltime_days_from_civil(thursday_year, 1, 1)) / 7 + 1;
+    fields.iso_week_year[index] = thursday_year;
+}
+
+static void expect_same_fields(const calendar_fields& expected, const calendar_fields& actual, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        if(expected.weekday[i] != actual.weekday[i] ||
+           expected.day_of_year[i] != actual.day_of_year[i] ||
+           expected.iso_week[i] != actual.iso_week[i] ||
+           expected.iso_week_year[i] != actual.iso_week_year[i])
+        {
+            ADD_FAILURE() << "at index " << i
+                          << ": expected " << expected.weekday[i] << " " << expected.day_of_year[i] << " "
+                          << expected.iso_week[i] << " " << expected.iso_week_year[i]
+                          << ", got " << actual.weekday[i] << " " << actual.day_of_year[i] << " "
+                          << actual.iso_week[i] << " " << actual.iso_week_year[i];
+            return;
+        }
+    }
+}
+
+static const size_t chunk_size = 1 << 16;
+
+// Checks every day from first_day to last_day (inclusive), in chunks, with
+// the batch function under every instruction set and the getters. The time
+// of day changes from value to value, and must not affect anything.
+template<typename TIME, typename NEW, typename BATCH, typename GETTERS>
+static void check_every_day(int32_t first_day, int32_t last_day, NEW make, BATCH batch, GETTERS check_getters)
+{
+    std::vector<TIME> values(chunk_size);
+    calendar_fields expected(chunk_size);
+    calendar_fields actual(chunk_size);
+    for(int64_t start = first_day; start <= last_day; start += chunk_size)
+    {
+        size_t count = (size_t)std::min<int64_t>(chunk_size, last_day - start + 1);
+        for(size_t i = 0; i < count; i++)
+        {
+            int32_t n = (int32_t)(start + (int64_t)i);
+            int year, month, day;
+            smalltime_civil_from_days(n, &year, &month, &day);
+            values[i] = make(year, month, day, (int)(i % 24), (int)(i % 60));
+            reference_fields(n, expected, i);
+        }
+        for_each_isa([&]
+        {
+            smalltime_calendar_columns columns = actual.columns();
+            batch(values.data(), count, &columns);
+            expect_same_fields(expected, actual, count);
+        });
+        calendar_fields got(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            check_getters(values[i], got, i);
+        }
+        expect_same_fields(expected, got, count);
+        if(::testing::Test::HasFailure())
+        {
+            return;
+        }
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Calendar, known_dates)
+{
+    smalltime time = smalltime_new(2018, 3, 14, 15, 9, 26, 535897);
+    EXPECT_EQ(3, smalltime_get_weekday(time));
+    EXPECT_EQ(73, smalltime_get_day_of_year(time));
+    EXPECT_EQ(11, smalltime_get_iso_week(time));
+    EXPECT_EQ(2018, smalltime_get_iso_week_year(time));
+
+    // Saturday, in the last week of 2004 (which has 53).
+    nanotime ntime = nanotime_new(2005, 1, 1, 0, 0, 0, 0);
+    EXPECT_EQ(6, nanotime_get_weekday(ntime));
+    EXPECT_EQ(1, nanotime_get_day_of_year(ntime));
+    EXPECT_EQ(53, nanotime_get_iso_week(ntime));
+    EXPECT_EQ(2004, nanotime_get_iso_week_year(ntime));
+
+    // Monday, in the first week of 2009.
+    time = smalltime_new(2008, 12, 29, 23, 59, 59, 999999);
+    EXPECT_EQ(1, smalltime_get_weekday(time));
+    EXPECT_EQ(364, smalltime_get_day_of_year(time));
+    EXPECT_EQ(1, smalltime_get_iso_week(time));
+    EXPECT_EQ(2009, smalltime_get_iso_week_year(time));
+
+    // 1 BC is a leap year.
+    time = smalltime_new(0, 12, 31, 0, 0, 0, 0);
+    EXPECT_EQ(366, smalltime_get_day_of_year(time));
+    EXPECT_EQ(7, smalltime_get_weekday(time));
+}
+
+TEST(Calendar, every_smalltime_day)
+{
+    int32_t first_day = smalltime_days_from_civil(-131072, 1, 1);
+    int32_t last_day = smalltime_days_from_civil(131071, 12, 31);
+    check_every_day<smalltime>(first_day, last_day,
+        [](int year, int month, int day, int hour, int minute)
+        {
+            return smalltime_new(year, month, day, hour, minute, 59, 999999);
+        },
+        smalltime_batch_calendar,
+        [](smalltime time, calendar_fields& fields, size_t i)
+        {
+            fields.weekday[i] = smalltime_get_weekday(time);
+            fields.day_of_year[i] = smalltime_get_day_of_year(time);
+            fields.iso_week[i] = smalltime_get_iso_week(time);
+            fields.iso_week_year[i] = smalltime_get_iso_week_year(time);
+        });
+}
+
+TEST(Calendar, every_nanotime_day)
+{
+    int32_t first_day = smalltime_days_from_civil(1970, 1, 1);
+    int32_t last_day = smalltime_days_from_civil(2225, 12, 31);
+    check_every_day<nanotime>(first_day, last_day,
+        [](int year, int month, int day, int hour, int minute)
+        {
+            return nanotime_new(year, month, day, hour, minute, 59, 999999999);
+        },
+        nanotime_batch_calendar,
+        [](nanotime time, calendar_fields& fields, size_t i)
+        {
+            fields.weekday[i] = nanotime_get_weekday(time);
+            fields.day_of_year[i] = nanotime_get_day_of_year(time);
+            fields.iso_week[i] = nanotime_get_iso_week(time);
+            fields.iso_week_year[i] = nanotime_get_iso_week_year(time);
+        });
+}
+
+TEST(Calendar, repeated_dates_and_partial_columns)
+{
+    // Runs of the same date take the cached path, and skipped columns must
+    // be left alone.
+    std::vector<smalltime> values;
+    for(int hour = 0; hour < 24; hour++)
+    {
+        values.push_back(smalltime_new(2020, 12, 31, hour, 0, 0, 0));
+    }
+    for(int hour = 0; hour < 13; hour++)
+    {
+        values.push_back(smalltime_new(2021, 1, 1, hour, 0, 0, 0));
+    }
+    for_each_isa([&]
+    {
+        std::vector<int> iso_week(values.size(), -1);
+        std::vector<int> day_of_year(values.size(), -1);
+        smalltime_calendar_columns columns = {nullptr, day_of_year.data(), iso_week.data(), nullptr};
+        smalltime_batch_calendar(values.data(), values.size(), &columns);
+        for(size_t i = 0; i < values.size(); i++)
+        {
+            ASSERT_EQ(53, iso_week[i]) << i;
+            ASSERT_EQ(i < 24 ? 366 : 1, day_of_year[i]) << i;
+        }
+    });
+}
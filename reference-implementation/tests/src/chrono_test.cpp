@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <smalltime/chrono.h>
+
+#if __cplusplus >= 202002L
+#include <random>
+#include <sstream>
+
+using namespace smalltime_cpp;
+using namespace std::chrono;
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static_assert(is_clock_v<smalltime_clock>);
+static_assert(is_clock_v<nanotime_clock>);
+static_assert(std::is_same_v<smalltime_clock::duration, microseconds>);
+static_assert(std::is_same_v<nanotime_clock::duration, nanoseconds>);
+static_assert(to_year_month_day(packed_smalltime(2018, 3, 14, 15, 9, 26, 535897)) == 2018y / March / 14d);
+static_assert(from_year_month_day<packed_nanotime>(2100y / 2 / 28d, hh_mm_ss<seconds>(23h + 59min + 59s)) ==
+              packed_nanotime(2100, 2, 28, 23, 59, 59, 0));
+
+// Random times within std::chrono's year range, at the given resolution.
+template<typename DURATION>
+static std::vector<sys_time<DURATION>> random_sys_times(int min_year, int max_year, size_t count)
+{
+    std::mt19937_64 random(22);
+    int64_t first = duration_cast<DURATION>(sys_days(year(min_year) / 1 / 1).time_since_epoch()).count();
+    int64_t last = duration_cast<DURATION>(sys_days(year(max_year) / 12 / 31).time_since_epoch()).count();
+    std::uniform_int_distribution<int64_t> ticks(first, last);
+    std::vector<sys_time<DURATION>> times(count);
+    for(auto& time: times)
+    {
+        time = sys_time<DURATION>(DURATION(ticks(random)));
+    }
+    return times;
+}
+
+// The date and time of day, worked out by std::chrono.
+template<typename TIME, typename DURATION>
+static void expect_same_fields(sys_time<DURATION> expected, TIME actual)
+{
+    sys_days day = floor<days>(expected);
+    hh_mm_ss<DURATION> time_of_day(expected - day);
+    ASSERT_EQ(year_month_day(day), to_year_month_day(actual));
+    ASSERT_EQ(time_of_day.to_duration(), to_hh_mm_ss(actual).to_duration());
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Chrono, smalltime_sys_time_round_trip)
+{
+    for(auto time: random_sys_times<microseconds>(-32767, 32767, 100000))
+    {
+        packed_smalltime value = from_sys_time<packed_smalltime>(time);
+        ASSERT_NO_FATAL_FAILURE(expect_same_fields(time, value));
+        ASSERT_EQ(time, to_sys_time(value));
+        ASSERT_EQ(value, from_year_month_day<packed_smalltime>(to_year_month_day(value), to_hh_mm_ss(value)));
+    }
+}
+
+TEST(Chrono, nanotime_sys_time_round_trip)
+{
+    for(auto time: random_sys_times<nanoseconds>(1970, 2225, 100000))
+    {
+        packed_nanotime value = from_sys_time<packed_nanotime>(time);
+        ASSERT_NO_FATAL_FAILURE(expect_same_fields(time, value));
+        ASSERT_EQ(time, to_sys_time(value));
+        ASSERT_EQ(value, from_year_month_day<packed_nanotime>(to_year_month_day(value), to_hh_mm_ss(value)));
+    }
+}
+
+TEST(Chrono, second32_sys_time_round_trip)
+{
+    for(auto time: random_sys_times<seconds>(1970, 2033, 100000))
+    {
+        packed_second32 value = from_sys_time<packed_second32>(time);
+        ASSERT_NO_FATAL_FAILURE(expect_same_fields(time, value));
+        ASSERT_EQ(time, to_sys_time(value));
+    }
+}
+
+TEST(Chrono, rounds_down_to_resolution)
+{
+    sys_time<nanoseconds> before_epoch = sys_days(1969y / 12 / 31d) + 23h + 59min + 59s + 999999999ns;
+    EXPECT_EQ(packed_smalltime(1969, 12, 31, 23, 59, 59, 999999), from_sys_time<packed_smalltime>(before_epoch));
+    EXPECT_EQ(packed_second32(2000, 1, 1, 0, 0, 0), from_sys_time<packed_second32>(sys_days(2000y / 1 / 1d) + 999ms));
+    EXPECT_EQ(packed_smalltime(2000, 1, 1, 0, 0, 0, 1),
+              from_year_month_day<packed_smalltime>(2000y / 1 / 1d, hh_mm_ss<nanoseconds>(1999ns)));
+}
+
+TEST(Chrono, leap_second)
+{
+    // sys_time has no leap seconds, so second 60 is the next minute.
+    packed_smalltime leap(2016, 12, 31, 23, 59, 60, 500000);
+    EXPECT_EQ(sys_days(2017y / 1 / 1d) + 500ms, to_sys_time(leap));
+}
+
+TEST(Chrono, clocks)
+{
+    auto system_before = floor<microseconds>(system_clock::now());
+    auto now = smalltime_clock::now();
+    auto system_after = system_clock::now();
+    EXPECT_LE(system_before, smalltime_clock::to_sys(now));
+    EXPECT_GE(system_after, smalltime_clock::to_sys(now));
+
+    sys_time<microseconds> time = sys_days(2018y / 3 / 14d) + 15h + 9min + 26s + 535897us;
+    smalltime_clock::time_point point = smalltime_clock::from_sys(time);
+    EXPECT_EQ(packed_smalltime(2018, 3, 14, 15, 9, 26, 535897), smalltime_clock::to_packed(point));
+    EXPECT_EQ(point, smalltime_clock::from_packed(smalltime_clock::to_packed(point)));
+    EXPECT_EQ(packed_nanotime(2018, 3, 14, 15, 9, 26, 535897000),
+              nanotime_clock::to_packed(nanotime_clock::from_sys(smalltime_clock::to_sys(point))));
+#if __cpp_lib_chrono >= 201907L
+    EXPECT_EQ(point, clock_cast<smalltime_clock>(time));
+    EXPECT_EQ(time, clock_cast<system_clock>(point));
+#endif
+}
+
+TEST(Chrono, formatting)
+{
+    std::ostringstream stream;
+    stream << packed_smalltime(1985, 10, 26, 8, 22, 16, 900142) << ' ' << packed_nanotime(2001, 2, 3, 4, 5, 6, 7);
+    EXPECT_EQ("1985-10-26T08:22:16.900142Z 2001-02-03T04:05:06.000000007Z", stream.str());
+#ifdef __cpp_lib_format
+    EXPECT_EQ("at 1985-10-26T08:22:16.900142Z", std::format("at {}", packed_smalltime(1985, 10, 26, 8, 22, 16, 900142)));
+    EXPECT_EQ("-000001-01-01T00:00:00.000000Z", std::format("{}", packed_smalltime(-1, 1, 1)));
+#endif
+}
+
+#endif // __cplusplus >= 202002L
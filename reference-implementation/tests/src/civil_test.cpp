@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <smalltime/civil.h>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static bool reference_is_leap_year(int year)
+{
+    if(year % 400 == 0) return true;
+    if(year % 100 == 0) return false;
+    return year % 4 == 0;
+}
+
+static int reference_days_in_month(int year, int month)
+{
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && reference_is_leap_year(year) ? 29 : days[month - 1];
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Civil, leap_years)
+{
+    EXPECT_TRUE(smalltime_is_leap_year(2000));
+    EXPECT_TRUE(smalltime_is_leap_year(2004));
+    EXPECT_FALSE(smalltime_is_leap_year(1900));
+    EXPECT_FALSE(smalltime_is_leap_year(2001));
+    EXPECT_TRUE(smalltime_is_leap_year(0));
+    EXPECT_TRUE(smalltime_is_leap_year(-4));
+    EXPECT_FALSE(smalltime_is_leap_year(-100));
+    EXPECT_TRUE(smalltime_is_leap_year(-400));
+
+    for(int year = -131072; year <= 131071; year++)
+    {
+        ASSERT_EQ(reference_is_leap_year(year), smalltime_is_leap_year(year) != 0) << year;
+    }
+}
+
+TEST(Civil, days_in_month)
+{
+    for(int year = -1000; year <= 3000; year++)
+    {
+        for(int month = 1; month <= 12; month++)
+        {
+            ASSERT_EQ(reference_days_in_month(year, month), smalltime_days_in_month(year, month)) << year << "-" << month;
+        }
+    }
+}
+
+TEST(Civil, known_dates)
+{
+    EXPECT_EQ(0, smalltime_days_from_civil(1970, 1, 1));
+    EXPECT_EQ(-1, smalltime_days_from_civil(1969, 12, 31));
+    EXPECT_EQ(10957, smalltime_days_from_civil(2000, 1, 1));
+    EXPECT_EQ(-719528, smalltime_days_from_civil(0, 1, 1));
+    EXPECT_EQ(11016, smalltime_days_from_civil(2000, 2, 29));
+}
+
+// Walks every day of the smalltime year range, checking both directions
+// against a simple day counter.
+TEST(Civil, full_range)
+{
+    int year = -131072;
+    int month = 1;
+    int day = 1;
+    int32_t days = smalltime_days_from_civil(year, month, day);
+    int mismatches = 0;
+
+    while(year <= 131071)
+    {
+        if(smalltime_days_from_civil(year, month, day) != days)
+        {
+            mismatches++;
+        }
+        int actual_year, actual_month, actual_day;
+        smalltime_civil_from_days(days, &actual_year, &actual_month, &actual_day);
+        if(actual_year != year || actual_month != month || actual_day != day)
+        {
+            mismatches++;
+        }
+
+        days++;
+        if(++day > reference_days_in_month(year, month))
+        {
+            day = 1;
+            if(++month > 12)
+            {
+                month = 1;
+                year++;
+            }
+        }
+    }
+    EXPECT_EQ(0, mismatches);
+    EXPECT_EQ(smalltime_days_from_civil(131072, 1, 1), days);
+}
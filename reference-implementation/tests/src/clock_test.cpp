@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <smalltime/clock.h>
+#include <smalltime/epoch.h>
+#include <smalltime/validate.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+#ifdef CLOCK_REALTIME_COARSE
+    static const clockid_t coarse_clock = CLOCK_REALTIME_COARSE;
+#else
+    static const clockid_t coarse_clock = CLOCK_REALTIME;
+#endif
+
+static int64_t read_microseconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int64_t read_nanoseconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// The packed values sort the same as the times they represent, so a
+// reading taken between two clock readings must fall between them.
+static void assert_smalltime_between(clockid_t clock, smalltime (*now)(void))
+{
+    for(int i = 0; i < 1000; i++)
+    {
+        smalltime before = smalltime_from_unix_microseconds(read_microseconds(clock));
+        smalltime value = now();
+        smalltime after = smalltime_from_unix_microseconds(read_microseconds(clock));
+        ASSERT_TRUE(smalltime_is_valid(value)) << std::hex << value;
+        ASSERT_LE(before, value);
+        ASSERT_GE(after, value);
+    }
+}
+
+static void assert_nanotime_between(clockid_t clock, nanotime (*now)(void))
+{
+    for(int i = 0; i < 1000; i++)
+    {
+        nanotime before = nanotime_from_unix_nanoseconds(read_nanoseconds(clock));
+        nanotime value = now();
+        nanotime after = nanotime_from_unix_nanoseconds(read_nanoseconds(clock));
+        ASSERT_TRUE(nanotime_is_valid(value)) << std::hex << value;
+        ASSERT_LE(before, value);
+        ASSERT_GE(after, value);
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Clock, now)
+{
+    assert_smalltime_between(CLOCK_REALTIME, smalltime_now);
+    assert_nanotime_between(CLOCK_REALTIME, nanotime_now);
+}
+
+TEST(Clock, now_coarse)
+{
+    assert_smalltime_between(coarse_clock, smalltime_now_coarse);
+    assert_nanotime_between(coarse_clock, nanotime_now_coarse);
+}
+
+TEST(Clock, matches_unix_conversion)
+{
+    // Truncating a nanosecond reading must give the smalltime reading when
+    // both land in the same microsecond, which happens often enough.
+    int matches = 0;
+    for(int i = 0; i < 1000; i++)
+    {
+        smalltime small = smalltime_now();
+        nanotime nano = nanotime_now();
+        int64_t microseconds = nanotime_to_unix_nanoseconds(nano) / 1000;
+        matches += smalltime_from_unix_microseconds(microseconds) == small;
+    }
+    EXPECT_GT(matches, 0);
+}
+
+TEST(Clock, threads_have_their_own_cache)
+{
+    std::vector<std::thread> threads;
+    std::vector<int> failures(8);
+    for(size_t i = 0; i < failures.size(); i++)
+    {
+        threads.emplace_back([&failures, i]
+        {
+            for(int j = 0; j < 10000; j++)
+            {
+                smalltime before = smalltime_from_unix_microseconds(read_microseconds(CLOCK_REALTIME));
+                smalltime value = smalltime_now();
+                smalltime after = smalltime_from_unix_microseconds(read_microseconds(CLOCK_REALTIME));
+                failures[i] += value < before || value > after;
+            }
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+    for(int count: failures)
+    {
+        EXPECT_EQ(0, count);
+    }
+}
@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+#include <smalltime/codec.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// A sorted trace: mostly small gaps, with the occasional gap of hours or
+// days (1 in jump_odds / 2 each) so that blocks cross hour, day, month and
+// year boundaries.
+static std::vector<int64_t> trace_microseconds(size_t count, uint64_t seed, int64_t start, uint64_t jump_odds = 64)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<int64_t> times(count);
+    int64_t current = start;
+    for(auto& time: times)
+    {
+        switch(rng() % jump_odds)
+        {
+            case 0: current += (int64_t)(rng() % (86400LL * 40 * 1000000)); break;
+            case 1: current += (int64_t)(rng() % (3600LL * 1000000)); break;
+            case 2: break;
+            default: current += (int64_t)(rng() % 5000); break;
+        }
+        time = current;
+    }
+    return times;
+}
+
+static std::vector<smalltime> smalltime_trace(size_t count, uint64_t seed, uint64_t jump_odds = 64)
+{
+    std::vector<smalltime> values;
+    for(int64_t time: trace_microseconds(count, seed, -62198755200LL * 1000000, jump_odds))
+    {
+        values.push_back(smalltime_from_unix_microseconds(time));
+    }
+    return values;
+}
+
+static std::vector<nanotime> nanotime_trace(size_t count, uint64_t seed)
+{
+    std::vector<nanotime> values;
+    std::mt19937_64 rng(seed);
+    for(int64_t time: trace_microseconds(count, seed, 946684000LL * 1000000))
+    {
+        values.push_back(nanotime_from_unix_nanoseconds(time * 1000 + (int64_t)(rng() % 1000)));
+    }
+    return values;
+}
+
+static std::vector<uint64_t> random_bits(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> values(count);
+    for(auto& value: values)
+    {
+        value = rng();
+    }
+    return values;
+}
+
+static void expect_smalltime_round_trip(const std::vector<smalltime>& values)
+{
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = smalltime_codec_encode(values.data(), values.size(), encoded.data());
+    ASSERT_LE(size, encoded.size());
+    for_each_isa([&]
+    {
+        std::vector<smalltime> decoded(values.size());
+        size_t end_offset = 0;
+        ASSERT_EQ(values.size(), smalltime_codec_decode(encoded.data(), size, decoded.data(), decoded.size(), &end_offset));
+        EXPECT_EQ(size, end_offset);
+        EXPECT_EQ(values, decoded);
+    });
+}
+
+static void expect_nanotime_round_trip(const std::vector<nanotime>& values)
+{
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = nanotime_codec_encode(values.data(), values.size(), encoded.data());
+    ASSERT_LE(size, encoded.size());
+    for_each_isa([&]
+    {
+        std::vector<nanotime> decoded(values.size());
+        size_t end_offset = 0;
+        ASSERT_EQ(values.size(), nanotime_codec_decode(encoded.data(), size, decoded.data(), decoded.size(), &end_offset));
+        EXPECT_EQ(size, end_offset);
+        EXPECT_EQ(values, decoded);
+    });
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Codec, empty)
+{
+    uint8_t buffer[1];
+    EXPECT_EQ(0u, smalltime_codec_encode(NULL, 0, buffer));
+    size_t end_offset = 1;
+    EXPECT_EQ(0u, smalltime_codec_decode(buffer, 0, NULL, 0, &end_offset));
+    EXPECT_EQ(0u, end_offset);
+}
+
+TEST(Codec, round_trip_lengths)
+{
+    for(size_t count: {1, 2, 8, 9, 127, 128, 129, 1000})
+    {
+        SCOPED_TRACE(count);
+        expect_smalltime_round_trip(smalltime_trace(count, count));
+        expect_nanotime_round_trip(nanotime_trace(count, count));
+    }
+}
+
+TEST(Codec, round_trip_boundaries)
+{
+    expect_smalltime_round_trip({
+        smalltime_new(-1, 12, 31, 23, 59, 59, 999999),
+        smalltime_new(0, 1, 1, 0, 0, 0, 0),
+        smalltime_new(0, 1, 1, 0, 0, 0, 0),
+        smalltime_new(0, 1, 1, 0, 59, 59, 999999),
+        smalltime_new(0, 1, 1, 1, 0, 0, 1),
+        smalltime_new(0, 1, 31, 23, 0, 0, 1),
+        smalltime_new(0, 2, 1, 0, 0, 0, 0),
+        smalltime_new(-131072, 1, 1, 0, 0, 0, 0),
+        smalltime_new(131071, 12, 31, 23, 59, 59, 999999),
+        smalltime_new(1999, 12, 31, 23, 59, 59, 999999),
+        smalltime_new(2000, 1, 1, 0, 0, 0, 0),
+    });
+    expect_nanotime_round_trip({
+        nanotime_new(1970, 1, 1, 0, 0, 0, 0),
+        nanotime_new(2225, 12, 31, 23, 59, 59, 999999999),
+        nanotime_new(2000, 1, 1, 0, 59, 59, 999999999),
+        nanotime_new(2000, 1, 1, 1, 0, 0, 0),
+    });
+}
+
+TEST(Codec, round_trip_unsorted)
+{
+    std::mt19937_64 rng(1);
+    std::vector<smalltime> smalltimes;
+    for(int i = 0; i < 1000; i++)
+    {
+        smalltimes.push_back(smalltime_new((int)(rng() % 262144) - 131072, 1 + (int)(rng() % 12), 1 + (int)(rng() % 28),
+                                           (int)(rng() % 24), (int)(rng() % 60), (int)(rng() % 60), (int)(rng() % 1000000)));
+    }
+    expect_smalltime_round_trip(smalltimes);
+
+    std::vector<nanotime> nanotimes = nanotime_trace(1000, 2);
+    std::shuffle(nanotimes.begin(), nanotimes.end(), rng);
+    expect_nanotime_round_trip(nanotimes);
+}
+
+TEST(Codec, round_trip_any_bits)
+{
+    std::vector<uint64_t> bits = random_bits(1000, 3);
+    expect_smalltime_round_trip(std::vector<smalltime>(bits.begin(), bits.end()));
+    expect_nanotime_round_trip(bits);
+
+    // A leap second in an otherwise packable block.
+    std::vector<smalltime> smalltimes = smalltime_trace(300, 4);
+    smalltimes[130] = smalltime_new(2016, 12, 31, 23, 59, 60, 500000);
+    expect_smalltime_round_trip(smalltimes);
+}
+
+TEST(Codec, compresses_traces)
+{
+    // A jump widens every value in its block, so only a few are allowed.
+    std::vector<smalltime> smalltimes = smalltime_trace(100000, 5, 10000);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(smalltimes.size()));
+    size_t size = smalltime_codec_encode(smalltimes.data(), smalltimes.size(), encoded.data());
+    // Gaps up to 5000 microseconds need 13 bits.
+    EXPECT_LT(size, smalltimes.size() * 2);
+
+    std::vector<uint64_t> bits = random_bits(1000, 6);
+    EXPECT_EQ(SMALLTIME_CODEC_MAX_SIZE(bits.size()), nanotime_codec_encode(bits.data(), bits.size(), encoded.data()));
+}
+
+TEST(Codec, corrupted_hour_offset)
+{
+    // The encoder never writes an hour offset without an hour stream, but a
+    // decoder has to agree with the scalar one on what such a block means.
+    std::vector<smalltime> values;
+    for(int i = 0; i < 20; i++)
+    {
+        values.push_back(smalltime_new(2000, 1, 1, 1, 30, i, 1000 * i));
+    }
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = smalltime_codec_encode(values.data(), values.size(), encoded.data());
+    ASSERT_EQ(0u, encoded[10]);
+    ASSERT_EQ(0u, encoded[12]);
+    encoded[12] = 1;
+    std::vector<smalltime> expected;
+    for_each_isa([&]
+    {
+        std::vector<smalltime> decoded(values.size());
+        ASSERT_EQ(values.size(), smalltime_codec_decode(encoded.data(), size, decoded.data(), decoded.size(), NULL));
+        if(expected.empty())
+        {
+            expected = decoded;
+        }
+        EXPECT_EQ(expected, decoded);
+    });
+}
+
+TEST(Codec, stops_at_capacity)
+{
+    std::vector<smalltime> values = smalltime_trace(1000, 7);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = smalltime_codec_encode(values.data(), values.size(), encoded.data());
+    size_t first_block = smalltime_codec_encode(values.data(), SMALLTIME_CODEC_BLOCK_LENGTH, encoded.data());
+
+    std::vector<smalltime> decoded(values.size());
+    size_t end_offset = 0;
+    EXPECT_EQ(128u, smalltime_codec_decode(encoded.data(), size, decoded.data(), 255, &end_offset));
+    EXPECT_EQ(first_block, end_offset);
+    EXPECT_EQ(0u, smalltime_codec_decode(encoded.data(), size, decoded.data(), 127, &end_offset));
+    EXPECT_EQ(0u, end_offset);
+}
+
+TEST(Codec, truncated_input)
+{
+    std::vector<nanotime> values = nanotime_trace(300, 8);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = nanotime_codec_encode(values.data(), values.size(), encoded.data());
+    for_each_isa([&]
+    {
+        for(size_t length = 0; length < size; length++)
+        {
+            // Copied so that reads past the end are caught by sanitizers.
+            std::vector<uint8_t> truncated(encoded.begin(), encoded.begin() + (ptrdiff_t)length);
+            std::vector<nanotime> decoded(values.size());
+            size_t end_offset = 0;
+            size_t count = nanotime_codec_decode(truncated.data(), length, decoded.data(), decoded.size(), &end_offset);
+            ASSERT_LT(count, values.size());
+            ASSERT_LE(end_offset, length);
+            ASSERT_TRUE(std::equal(decoded.begin(), decoded.begin() + (ptrdiff_t)count, values.begin()));
+        }
+    });
+}
+
+TEST(Codec, corrupted_input)
+{
+    std::vector<smalltime> values = smalltime_trace(1000, 9);
+    std::vector<uint8_t> encoded(SMALLTIME_CODEC_MAX_SIZE(values.size()));
+    size_t size = smalltime_codec_encode(values.data(), values.size(), encoded.data());
+    std::mt19937_64 rng(10);
+    for_each_isa([&]
+    {
+        for(int i = 0; i < 1000; i++)
+        {
+            std::vector<uint8_t> corrupted(encoded.begin(), encoded.begin() + (ptrdiff_t)size);
+            corrupted[rng() % size] ^= (uint8_t)(1 << (rng() % 8));
+            std::vector<smalltime> decoded(values.size());
+            size_t end_offset = 0;
+            size_t count = smalltime_codec_decode(corrupted.data(), size, decoded.data(), decoded.size(), &end_offset);
+            ASSERT_LE(count, values.size());
+            ASSERT_LE(end_offset, size);
+        }
+    });
+}
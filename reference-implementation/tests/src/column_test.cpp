@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <smalltime/column.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static std::string temp_path(const char* name)
+{
+    return ::testing::TempDir() + "smalltime_column_" + name;
+}
+
+// One value every 0-2 seconds from the start of 1999, crossing a year.
+static std::vector<smalltime> smalltime_trace(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<smalltime> values;
+    int64_t current = 915148800LL * 1000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += (int64_t)(rng() % 2000000);
+        values.push_back(smalltime_from_unix_microseconds(current));
+    }
+    return values;
+}
+
+static void write_smalltime(const std::string& path, const std::vector<smalltime>& values, size_t block_length)
+{
+    smalltime_column_writer* writer = smalltime_column_writer_open(path.c_str(), block_length);
+    ASSERT_NE(nullptr, writer);
+    // Appended in uneven pieces, so that appends straddle blocks.
+    for(size_t i = 0; i < values.size(); i += 1000)
+    {
+        size_t count = std::min((size_t)1000, values.size() - i);
+        ASSERT_TRUE(smalltime_column_writer_append(writer, values.data() + i, count));
+    }
+    ASSERT_TRUE(smalltime_column_writer_close(writer));
+}
+
+struct query_result
+{
+    std::vector<smalltime> matches;
+    size_t spans = 0;
+    size_t inexact_values = 0;
+};
+
+static query_result query(const smalltime_column* column, smalltime start, smalltime end)
+{
+    query_result result;
+    smalltime_column_query query;
+    smalltime_column_query_start(column, start, end, &query);
+    while(smalltime_column_query_next(&query))
+    {
+        result.spans++;
+        if(!query.exact)
+        {
+            result.inexact_values += query.count;
+        }
+        for(size_t i = 0; i < query.count; i++)
+        {
+            smalltime value = query.values[i];
+            if(query.exact)
+            {
+                EXPECT_TRUE(value >= start && value < end);
+            }
+            if(value >= start && value < end)
+            {
+                result.matches.push_back(value);
+            }
+        }
+    }
+    return result;
+}
+
+static std::vector<smalltime> brute_force(const std::vector<smalltime>& values, smalltime start, smalltime end)
+{
+    std::vector<smalltime> matches;
+    for(smalltime value: values)
+    {
+        if(value >= start && value < end)
+        {
+            matches.push_back(value);
+        }
+    }
+    return matches;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Column, round_trip)
+{
+    std::string path = temp_path("round_trip");
+    std::vector<smalltime> values = smalltime_trace(10000, 1);
+    write_smalltime(path, values, 256);
+
+    smalltime_column* column = smalltime_column_open(path.c_str());
+    ASSERT_NE(nullptr, column);
+    size_t count = 0;
+    const smalltime* mapped = smalltime_column_values(column, &count);
+    ASSERT_EQ(values.size(), count);
+    EXPECT_TRUE(std::equal(values.begin(), values.end(), mapped));
+    smalltime_column_close(column);
+    std::remove(path.c_str());
+}
+
+TEST(Column, sorted_queries_are_one_exact_span)
+{
+    std::string path = temp_path("sorted");
+    std::vector<smalltime> values = smalltime_trace(10000, 2);
+    write_smalltime(path, values, 256);
+    smalltime_column* column = smalltime_column_open(path.c_str());
+    ASSERT_NE(nullptr, column);
+
+    std::mt19937_64 rng(3);
+    for(int i = 0; i < 200; i++)
+    {
+        smalltime start = values[rng() % values.size()];
+        smalltime end = values[rng() % values.size()];
+        query_result result = query(column, start, end);
+        std::vector<smalltime> expected = brute_force(values, start, end);
+        ASSERT_EQ(expected, result.matches);
+        ASSERT_EQ(expected.empty() ? 0u : 1u, result.spans);
+        ASSERT_EQ(0u, result.inexact_values);
+    }
+
+    // Ranges outside the column.
+    EXPECT_EQ(0u, query(column, smalltime_new(1970, 1, 1, 0, 0, 0, 0), values.front()).spans);
+    EXPECT_EQ(0u, query(column, values.back() + 1, smalltime_new(3000, 1, 1, 0, 0, 0, 0)).spans);
+    EXPECT_EQ(values.size(), query(column, values.front(), values.back() + 1).matches.size());
+    smalltime_column_close(column);
+    std::remove(path.c_str());
+}
+
+TEST(Column, unsorted_queries)
+{
+    // Late arrivals leave the blocks in order. A shuffled stretch doesn't.
+    for(bool shuffled: {false, true})
+    {
+        SCOPED_TRACE(shuffled);
+        std::vector<smalltime> values = smalltime_trace(10000, 4);
+        std::mt19937_64 rng(5);
+        for(size_t i = 300; i < values.size(); i += 300 + rng() % 200)
+        {
+            std::swap(values[i], values[i - 1 - rng() % 50]);
+        }
+        if(shuffled)
+        {
+            std::shuffle(values.begin() + 5000, values.begin() + 6000, rng);
+        }
+
+        std::string path = temp_path("unsorted");
+        write_smalltime(path, values, 128);
+        smalltime_column* column = smalltime_column_open(path.c_str());
+        ASSERT_NE(nullptr, column);
+
+        for(int i = 0; i < 200; i++)
+        {
+            smalltime start = values[rng() % values.size()];
+            smalltime end = values[rng() % values.size()];
+            query_result result = query(column, start, end);
+            std::vector<smalltime> expected = brute_force(values, start, end);
+            ASSERT_EQ(expected, result.matches);
+            // The zone maps skip most of the column.
+            ASSERT_LE(result.inexact_values, expected.size() + 30 * 128u);
+        }
+        smalltime_column_close(column);
+        std::remove(path.c_str());
+    }
+}
+
+TEST(Column, negative_smalltime)
+{
+    std::vector<smalltime> values;
+    for(int year = -1000; year < 1000; year += 3)
+    {
+        values.push_back(smalltime_new(year, 6, 15, 12, 0, 0, 0));
+    }
+    std::string path = temp_path("negative");
+    write_smalltime(path, values, 64);
+    smalltime_column* column = smalltime_column_open(path.c_str());
+    ASSERT_NE(nullptr, column);
+    smalltime start = smalltime_new(-10, 1, 1, 0, 0, 0, 0);
+    smalltime end = smalltime_new(10, 1, 1, 0, 0, 0, 0);
+    query_result result = query(column, start, end);
+    EXPECT_EQ(brute_force(values, start, end), result.matches);
+    EXPECT_EQ(1u, result.spans);
+    smalltime_column_close(column);
+    std::remove(path.c_str());
+}
+
+TEST(Column, nanotime)
+{
+    // Values from both sides of the top bit.
+    std::vector<nanotime> values;
+    for(int year = 1970; year <= 2225; year++)
+    {
+        for(int month = 1; month <= 12; month++)
+        {
+            values.push_back(nanotime_new(year, month, 1, 0, 0, 0, (unsigned)year));
+        }
+    }
+    std::string path = temp_path("nanotime");
+    nanotime_column_writer* writer = nanotime_column_writer_open(path.c_str(), 100);
+    ASSERT_NE(nullptr, writer);
+    ASSERT_TRUE(nanotime_column_writer_append(writer, values.data(), values.size()));
+    ASSERT_TRUE(nanotime_column_writer_close(writer));
+
+    nanotime_column* column = nanotime_column_open(path.c_str());
+    ASSERT_NE(nullptr, column);
+    nanotime start = nanotime_new(2090, 3, 1, 0, 0, 0, 0);
+    nanotime end = nanotime_new(2110, 1, 1, 0, 0, 0, 0);
+    nanotime_column_query query;
+    nanotime_column_query_start(column, start, end, &query);
+    ASSERT_TRUE(nanotime_column_query_next(&query));
+    EXPECT_TRUE(query.exact);
+    ASSERT_EQ(20u * 12 - 2, query.count);
+    EXPECT_EQ(nanotime_new(2090, 3, 1, 0, 0, 0, 2090), query.values[0]);
+    EXPECT_FALSE(nanotime_column_query_next(&query));
+    nanotime_column_close(column);
+
+    // The kind is checked.
+    EXPECT_EQ(nullptr, smalltime_column_open(path.c_str()));
+    std::remove(path.c_str());
+}
+
+TEST(Column, empty)
+{
+    std::string path = temp_path("empty");
+    write_smalltime(path, {}, 0);
+    smalltime_column* column = smalltime_column_open(path.c_str());
+    ASSERT_NE(nullptr, column);
+    size_t count = 1;
+    smalltime_column_values(column, &count);
+    EXPECT_EQ(0u, count);
+    EXPECT_EQ(0u, query(column, 0, INT64_MAX).spans);
+    smalltime_column_close(column);
+    std::remove(path.c_str());
+}
+
+TEST(Column, rejects_bad_files)
+{
+    EXPECT_EQ(nullptr, smalltime_column_open(temp_path("missing").c_str()));
+
+    std::string path = temp_path("bad");
+    std::vector<smalltime> values = smalltime_trace(1000, 6);
+    write_smalltime(path, values, 100);
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(nullptr, file);
+    std::vector<char> contents(64 + 1000 * 8 + 10 * 24);
+    ASSERT_EQ(contents.size(), std::fread(contents.data(), 1, contents.size(), file));
+    std::fclose(file);
+
+    auto expect_rejected = [&](const std::vector<char>& bytes)
+    {
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        std::fwrite(bytes.data(), 1, bytes.size(), out);
+        std::fclose(out);
+        EXPECT_EQ(nullptr, smalltime_column_open(path.c_str()));
+    };
+
+    // Truncated zone map.
+    expect_rejected(std::vector<char>(contents.begin(), contents.end() - 1));
+    // Unfinished (the header is written last).
+    std::vector<char> bytes = contents;
+    std::fill(bytes.begin(), bytes.begin() + 64, 0);
+    expect_rejected(bytes);
+    // Count beyond the end of the file.
+    bytes = contents;
+    bytes[24 + 7] = 1;
+    expect_rejected(bytes);
+    // Other byte order.
+    bytes = contents;
+    std::reverse(bytes.begin() + 12, bytes.begin() + 16);
+    expect_rejected(bytes);
+    std::remove(path.c_str());
+}
+
+TEST(Column, unwritable_path)
+{
+    EXPECT_EQ(nullptr, smalltime_column_writer_open("/nonexistent-directory/column", 0));
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <smalltime/convert.h>
+#include "for_each_isa.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Valid nanotime values, with a quarter of the nanoseconds on or next to
+// a rounding boundary, and some in the last microsecond of the second.
+static std::vector<nanotime> random_nanotimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        int nanosecond = (int)(rng() % 1000000000);
+        if(rng() % 4 == 0)
+        {
+            nanosecond = nanosecond / 1000 * 1000 + 499 + (int)(rng() % 3);
+        }
+        else if(rng() % 16 == 0)
+        {
+            nanosecond = 999999000 + (int)(rng() % 1000);
+        }
+        value = nanotime_new(1970 + (int)(rng() % 256), 1 + (int)(rng() % 12), 1 + (int)(rng() % 28),
+                             (int)(rng() % 24), (int)(rng() % 60), (int)(rng() % 61), nanosecond);
+    }
+    return values;
+}
+
+// Valid smalltime values, with a third of the years outside of the
+// nanotime range.
+static std::vector<smalltime> random_smalltimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        int year = rng() % 3 == 0 ? (int)(rng() % 262144) - 131072 : 1970 + (int)(rng() % 256);
+        value = smalltime_new(year, 1 + (int)(rng() % 12), 1 + (int)(rng() % 28),
+                              (int)(rng() % 24), (int)(rng() % 60), (int)(rng() % 61), (int)(rng() % 1000000));
+    }
+    return values;
+}
+
+// Decodes and re-encodes, the long way round.
+static smalltime reference_to_smalltime(nanotime time, smalltime_convert_rounding rounding)
+{
+    int nanosecond = nanotime_get_nanosecond(time);
+    int microsecond = nanosecond / 1000;
+    if(rounding == SMALLTIME_CONVERT_ROUND_HALF_EVEN)
+    {
+        int remainder = nanosecond % 1000;
+        microsecond += remainder > 500 || (remainder == 500 && microsecond % 2 == 1);
+    }
+    smalltime result = smalltime_new(nanotime_get_year(time), nanotime_get_month(time), nanotime_get_day(time),
+                                     nanotime_get_hour(time), nanotime_get_minute(time), nanotime_get_second(time), 0);
+    if(microsecond == 1000000)
+    {
+        return smalltime_convert_next_second(result);
+    }
+    return result | microsecond;
+}
+
+static void expect_rounds_to(nanotime time, smalltime truncated, smalltime rounded)
+{
+    EXPECT_EQ(truncated, nanotime_to_smalltime(time, SMALLTIME_CONVERT_TRUNCATE));
+    EXPECT_EQ(rounded, nanotime_to_smalltime(time, SMALLTIME_CONVERT_ROUND_HALF_EVEN));
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Convert, matches_field_by_field)
+{
+    for(nanotime value: random_nanotimes(100000, 1))
+    {
+        EXPECT_EQ(reference_to_smalltime(value, SMALLTIME_CONVERT_TRUNCATE), nanotime_to_smalltime(value, SMALLTIME_CONVERT_TRUNCATE));
+        EXPECT_EQ(reference_to_smalltime(value, SMALLTIME_CONVERT_ROUND_HALF_EVEN), nanotime_to_smalltime(value, SMALLTIME_CONVERT_ROUND_HALF_EVEN));
+    }
+}
+
+TEST(Convert, rounds_half_to_even)
+{
+    smalltime base = smalltime_new(2018, 6, 1, 12, 0, 0, 0);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 0), base, base);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 499), base, base);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 500), base, base);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 501), base, base | 1);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 1500), base | 1, base | 2);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 2500), base | 2, base | 2);
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 999998500), base | 999998, base | 999998);
+}
+
+TEST(Convert, rounding_carries_into_the_next_second)
+{
+    expect_rounds_to(nanotime_new(2018, 6, 1, 12, 0, 0, 999999500),
+                     smalltime_new(2018, 6, 1, 12, 0, 0, 999999),
+                     smalltime_new(2018, 6, 1, 12, 0, 1, 0));
+    expect_rounds_to(nanotime_new(2018, 12, 31, 23, 59, 59, 999999999),
+                     smalltime_new(2018, 12, 31, 23, 59, 59, 999999),
+                     smalltime_new(2019, 1, 1, 0, 0, 0, 0));
+    expect_rounds_to(nanotime_new(2020, 2, 28, 23, 59, 59, 999999600),
+                     smalltime_new(2020, 2, 28, 23, 59, 59, 999999),
+                     smalltime_new(2020, 2, 29, 0, 0, 0, 0));
+    expect_rounds_to(nanotime_new(2016, 12, 31, 23, 59, 60, 999999999),
+                     smalltime_new(2016, 12, 31, 23, 59, 60, 999999),
+                     smalltime_new(2017, 1, 1, 0, 0, 0, 0));
+    expect_rounds_to(nanotime_new(2225, 12, 31, 23, 59, 59, 999999999),
+                     smalltime_new(2225, 12, 31, 23, 59, 59, 999999),
+                     smalltime_new(2226, 1, 1, 0, 0, 0, 0));
+}
+
+TEST(Convert, round_trips_through_nanotime)
+{
+    for(smalltime value: random_smalltimes(100000, 2))
+    {
+        int year = smalltime_get_year(value);
+        nanotime converted = 0;
+        ASSERT_EQ(year >= 1970 && year <= 2225, smalltime_to_nanotime(value, &converted) != 0) << year;
+        if(year >= 1970 && year <= 2225)
+        {
+            EXPECT_EQ(nanotime_new(year, smalltime_get_month(value), smalltime_get_day(value), smalltime_get_hour(value),
+                                   smalltime_get_minute(value), smalltime_get_second(value), smalltime_get_microsecond(value) * 1000),
+                      converted);
+            EXPECT_EQ(value, nanotime_to_smalltime(converted, SMALLTIME_CONVERT_TRUNCATE));
+            EXPECT_EQ(value, nanotime_to_smalltime(converted, SMALLTIME_CONVERT_ROUND_HALF_EVEN));
+        }
+    }
+}
+
+TEST(Convert, reports_years_outside_nanotime)
+{
+    nanotime result = 12345;
+    EXPECT_EQ(0, smalltime_to_nanotime(smalltime_new(1969, 12, 31, 23, 59, 59, 999999), &result));
+    EXPECT_EQ(0, smalltime_to_nanotime(smalltime_new(2226, 1, 1, 0, 0, 0, 0), &result));
+    EXPECT_EQ(0, smalltime_to_nanotime(smalltime_new(-1, 1, 1, 0, 0, 0, 0), &result));
+    EXPECT_EQ(0, smalltime_to_nanotime(smalltime_new(-131072, 1, 1, 0, 0, 0, 0), &result));
+    EXPECT_EQ(0, smalltime_to_nanotime(smalltime_new(131071, 12, 31, 23, 59, 59, 999999), &result));
+    EXPECT_EQ(12345u, result);
+
+    EXPECT_NE(0, smalltime_to_nanotime(smalltime_new(1970, 1, 1, 0, 0, 0, 0), &result));
+    EXPECT_EQ(nanotime_new(1970, 1, 1, 0, 0, 0, 0), result);
+    EXPECT_NE(0, smalltime_to_nanotime(smalltime_new(2225, 12, 31, 23, 59, 60, 999999), &result));
+    EXPECT_EQ(nanotime_new(2225, 12, 31, 23, 59, 60, 999999000), result);
+}
+
+TEST(Convert, batch_to_smalltime_matches_scalar)
+{
+    std::vector<nanotime> values = random_nanotimes(10001, 3);
+    for(smalltime_convert_rounding rounding: {SMALLTIME_CONVERT_TRUNCATE, SMALLTIME_CONVERT_ROUND_HALF_EVEN})
+    {
+        std::vector<smalltime> expected(values.size());
+        for(size_t i = 0; i < values.size(); i++)
+        {
+            expected[i] = nanotime_to_smalltime(values[i], rounding);
+        }
+        for_each_isa([&]
+        {
+            for(size_t count: {(size_t)0, (size_t)1, (size_t)7, (size_t)8, (size_t)9, values.size()})
+            {
+                std::vector<smalltime> results(count);
+                nanotime_batch_to_smalltime(values.data(), count, rounding, results.data());
+                ASSERT_EQ(std::vector<smalltime>(expected.begin(), expected.begin() + (ptrdiff_t)count), results);
+            }
+
+            // In place.
+            std::vector<nanotime> copy = values;
+            nanotime_batch_to_smalltime(copy.data(), copy.size(), rounding, (smalltime*)copy.data());
+            ASSERT_EQ(0, memcmp(expected.data(), copy.data(), copy.size() * sizeof(smalltime)));
+        });
+    }
+}
+
+TEST(Convert, batch_to_nanotime_matches_scalar)
+{
+    std::vector<smalltime> values = random_smalltimes(10001, 4);
+    const nanotime untouched = 0xdeadbeef;
+    std::vector<nanotime> expected(values.size(), untouched);
+    std::vector<uint64_t> expected_flags((values.size() + 63) / 64);
+    size_t expected_count = 0;
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        if(!smalltime_to_nanotime(values[i], &expected[i]))
+        {
+            expected_flags[i / 64] |= 1ULL << (i % 64);
+            expected_count++;
+        }
+    }
+    ASSERT_GT(expected_count, 0u);
+
+    for_each_isa([&]
+    {
+        for(size_t count: {(size_t)0, (size_t)1, (size_t)63, (size_t)64, (size_t)65, values.size()})
+        {
+            std::vector<nanotime> results(count, untouched);
+            std::vector<uint64_t> flags((count + 63) / 64);
+            size_t out_of_range = smalltime_batch_to_nanotime(values.data(), count, results.data(), flags.data());
+            ASSERT_EQ(std::vector<nanotime>(expected.begin(), expected.begin() + (ptrdiff_t)count), results);
+            for(size_t i = 0; i < count; i++)
+            {
+                ASSERT_EQ((expected_flags[i / 64] >> (i % 64)) & 1, (flags[i / 64] >> (i % 64)) & 1) << i;
+            }
+            ASSERT_EQ(out_of_range, smalltime_batch_to_nanotime(values.data(), count, results.data(), NULL));
+        }
+        std::vector<nanotime> results(values.size(), untouched);
+        ASSERT_EQ(expected_count, smalltime_batch_to_nanotime(values.data(), values.size(), results.data(), NULL));
+    });
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <smalltime/dispatch.h>
+#include <string>
+
+
+TEST(Dispatch, starts_on_best_isa)
+{
+    // The test binary isn't run with SMALLTIME_ISA set.
+    EXPECT_EQ(smalltime_get_best_isa(), smalltime_get_isa());
+}
+
+TEST(Dispatch, set_isa)
+{
+    smalltime_isa best = smalltime_get_best_isa();
+    for(int isa = SMALLTIME_ISA_SCALAR; isa <= best; isa++)
+    {
+        EXPECT_EQ(isa, smalltime_set_isa((smalltime_isa)isa));
+        EXPECT_EQ(isa, smalltime_get_isa());
+    }
+    smalltime_set_isa(best);
+}
+
+TEST(Dispatch, unsupported_isa_is_lowered)
+{
+    smalltime_isa best = smalltime_get_best_isa();
+    EXPECT_EQ(best, smalltime_set_isa((smalltime_isa)(SMALLTIME_ISA_AVX512 + 1)));
+    EXPECT_EQ(best, smalltime_get_isa());
+}
+
+TEST(Dispatch, isa_names)
+{
+    EXPECT_EQ(std::string("scalar"), smalltime_isa_name(SMALLTIME_ISA_SCALAR));
+    EXPECT_EQ(std::string("sse42"), smalltime_isa_name(SMALLTIME_ISA_SSE42));
+    EXPECT_EQ(std::string("avx2"), smalltime_isa_name(SMALLTIME_ISA_AVX2));
+    EXPECT_EQ(std::string("avx512"), smalltime_isa_name(SMALLTIME_ISA_AVX512));
+    EXPECT_EQ(std::string("unknown"), smalltime_isa_name((smalltime_isa)99));
+}
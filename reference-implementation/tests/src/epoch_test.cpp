@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <random>
+#include <time.h>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const int64_t smalltime_min_seconds = smalltime_to_unix_seconds(smalltime_new(-131072, 1, 1, 0, 0, 0, 0));
+static const int64_t smalltime_max_seconds = smalltime_to_unix_seconds(smalltime_new(131071, 12, 31, 23, 59, 59, 0));
+static const int64_t nanotime_max_seconds = nanotime_to_unix_seconds(nanotime_new(2225, 12, 31, 23, 59, 59, 0));
+
+static void test_against_gmtime(int64_t seconds)
+{
+    time_t t = (time_t)seconds;
+    struct tm tm;
+    ASSERT_NE(nullptr, gmtime_r(&t, &tm));
+    smalltime expected = smalltime_new(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, 0);
+    ASSERT_EQ(expected, smalltime_from_unix_seconds(seconds)) << seconds;
+    ASSERT_EQ(seconds, smalltime_to_unix_seconds(expected)) << seconds;
+}
+
+// Mostly clustered values, so the batch kernels' same-day shortcuts are
+// exercised, mixed with values from anywhere in the range.
+static std::vector<int64_t> make_counts(size_t count, int64_t min, int64_t max, int64_t scale, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(min * scale, max * scale + scale - 1);
+    std::vector<int64_t> counts(count);
+    int64_t current = anywhere(rng);
+    for(auto& value: counts)
+    {
+        if(rng() % 8 == 0)
+        {
+            current = anywhere(rng);
+        }
+        else
+        {
+            current += (int64_t)(rng() % 5000) * scale / 10;
+            if(current > max * scale) current = max * scale;
+        }
+        value = current;
+    }
+    return counts;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Epoch, epoch)
+{
+    EXPECT_EQ(smalltime_new(1970, 1, 1, 0, 0, 0, 0), smalltime_from_unix_seconds(0));
+    EXPECT_EQ(nanotime_new(1970, 1, 1, 0, 0, 0, 0), nanotime_from_unix_seconds(0));
+    EXPECT_EQ(smalltime_new(1969, 12, 31, 23, 59, 59, 999999), smalltime_from_unix_microseconds(-1));
+    EXPECT_EQ(smalltime_new(2001, 9, 9, 1, 46, 40, 0), smalltime_from_unix_seconds(1000000000));
+    EXPECT_EQ(nanotime_new(2001, 9, 9, 1, 46, 40, 123456789), nanotime_from_unix_nanoseconds(1000000000123456789LL));
+    EXPECT_EQ(1000000000123456789LL, nanotime_to_unix_nanoseconds(nanotime_new(2001, 9, 9, 1, 46, 40, 123456789)));
+    EXPECT_EQ(-1, smalltime_to_unix_microseconds(smalltime_new(1969, 12, 31, 23, 59, 59, 999999)));
+}
+
+TEST(Epoch, leap_second)
+{
+    EXPECT_EQ(smalltime_to_unix_seconds(smalltime_new(2017, 1, 1, 0, 0, 0, 0)),
+              smalltime_to_unix_seconds(smalltime_new(2016, 12, 31, 23, 59, 60, 0)));
+    EXPECT_EQ(nanotime_to_unix_seconds(nanotime_new(2017, 1, 1, 0, 0, 0, 0)),
+              nanotime_to_unix_seconds(nanotime_new(2016, 12, 31, 23, 59, 60, 0)));
+}
+
+TEST(Epoch, range_limits)
+{
+    EXPECT_EQ(smalltime_new(-131072, 1, 1, 0, 0, 0, 0), smalltime_from_unix_seconds(smalltime_min_seconds));
+    EXPECT_EQ(smalltime_new(131071, 12, 31, 23, 59, 59, 999999), smalltime_from_unix_microseconds(smalltime_max_seconds * 1000000 + 999999));
+    EXPECT_EQ(smalltime_new(-131072, 1, 1, 0, 0, 0, 0), smalltime_from_unix_microseconds(smalltime_min_seconds * 1000000));
+    EXPECT_EQ(nanotime_new(2225, 12, 31, 23, 59, 59, 999999999), nanotime_from_unix_nanoseconds(nanotime_max_seconds * 1000000000 + 999999999));
+}
+
+TEST(Epoch, matches_gmtime)
+{
+    std::mt19937_64 rng(1);
+    // gmtime_r() can't represent years before -1900 + INT_MIN, which is far
+    // beyond smalltime's range, so the whole range can be compared.
+    std::uniform_int_distribution<int64_t> anywhere(smalltime_min_seconds, smalltime_max_seconds);
+    for(int i = 0; i < 200000; i++)
+    {
+        test_against_gmtime(anywhere(rng));
+    }
+    for(int64_t seconds = -86400 * 3; seconds < 86400 * 3; seconds += 17)
+    {
+        test_against_gmtime(seconds);
+    }
+}
+
+TEST(Epoch, round_trip)
+{
+    std::mt19937_64 rng(2);
+    std::uniform_int_distribution<int64_t> smalltime_us(smalltime_min_seconds * 1000000, smalltime_max_seconds * 1000000);
+    std::uniform_int_distribution<int64_t> nanotime_ns(0, nanotime_max_seconds * 1000000000);
+    for(int i = 0; i < 200000; i++)
+    {
+        int64_t us = smalltime_us(rng);
+        ASSERT_EQ(us, smalltime_to_unix_microseconds(smalltime_from_unix_microseconds(us)));
+        int64_t ns = nanotime_ns(rng);
+        ASSERT_EQ(ns, nanotime_to_unix_nanoseconds(nanotime_from_unix_nanoseconds(ns)));
+        nanotime nt = nanotime_from_unix_nanoseconds(ns);
+        ASSERT_EQ(nanotime_to_unix_seconds(nt), nanotime_to_unix_seconds(nanotime_from_unix_seconds(ns / 1000000000)));
+    }
+}
+
+TEST(Epoch, batch_smalltime)
+{
+    for_each_isa([&]
+    {
+        for(size_t count: {0, 1, 7, 8, 9, 31, 100003})
+        {
+            std::vector<int64_t> seconds = make_counts(count, smalltime_min_seconds, smalltime_max_seconds, 1, count);
+            std::vector<int64_t> microseconds = make_counts(count, smalltime_min_seconds, smalltime_max_seconds, 1000000, count);
+            std::vector<smalltime> from_seconds(count), from_microseconds(count);
+            std::vector<int64_t> to_seconds(count), to_microseconds(count);
+
+            smalltime_batch_from_unix_seconds(seconds.data(), count, from_seconds.data());
+            smalltime_batch_from_unix_microseconds(microseconds.data(), count, from_microseconds.data());
+            smalltime_batch_to_unix_seconds(from_seconds.data(), count, to_seconds.data());
+            smalltime_batch_to_unix_microseconds(from_microseconds.data(), count, to_microseconds.data());
+
+            for(size_t i = 0; i < count; i++)
+            {
+                ASSERT_EQ(smalltime_from_unix_seconds(seconds[i]), from_seconds[i]) << seconds[i];
+                ASSERT_EQ(smalltime_from_unix_microseconds(microseconds[i]), from_microseconds[i]) << microseconds[i];
+                ASSERT_EQ(seconds[i], to_seconds[i]);
+                ASSERT_EQ(microseconds[i], to_microseconds[i]);
+            }
+        }
+    });
+}
+
+TEST(Epoch, batch_nanotime)
+{
+    for_each_isa([&]
+    {
+        for(size_t count: {0, 1, 7, 8, 9, 31, 100003})
+        {
+            std::vector<int64_t> seconds = make_counts(count, 0, nanotime_max_seconds, 1, count);
+            std::vector<int64_t> nanoseconds = make_counts(count, 0, nanotime_max_seconds, 1000000000, count);
+            std::vector<nanotime> from_seconds(count), from_nanoseconds(count);
+            std::vector<int64_t> to_seconds(count), to_nanoseconds(count);
+
+            nanotime_batch_from_unix_seconds(seconds.data(), count, from_seconds.data());
+            nanotime_batch_from_unix_nanoseconds(nanoseconds.data(), count, from_nanoseconds.data());
+            nanotime_batch_to_unix_seconds(from_seconds.data(), count, to_seconds.data());
+            nanotime_batch_to_unix_nanoseconds(from_nanoseconds.data(), count, to_nanoseconds.data());
+
+            for(size_t i = 0; i < count; i++)
+            {
+                ASSERT_EQ(nanotime_from_unix_seconds(seconds[i]), from_seconds[i]) << seconds[i];
+                ASSERT_EQ(nanotime_from_unix_nanoseconds(nanoseconds[i]), from_nanoseconds[i]) << nanoseconds[i];
+                ASSERT_EQ(seconds[i], to_seconds[i]);
+                ASSERT_EQ(nanoseconds[i], to_nanoseconds[i]);
+            }
+        }
+    });
+}
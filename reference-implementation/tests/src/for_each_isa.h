@@ -0,0 +1,21 @@
+#ifndef KS_smalltime_for_each_isa_H
+#define KS_smalltime_for_each_isa_H
+
+#include <gtest/gtest.h>
+#include <smalltime/dispatch.h>
+
+// Runs a check once for every instruction set level this CPU supports,
+// restoring the original selection afterwards.
+template<typename FUNCTION>
+static void for_each_isa(FUNCTION function)
+{
+    smalltime_isa original = smalltime_get_isa();
+    for(int isa = SMALLTIME_ISA_SCALAR; isa <= smalltime_get_best_isa(); isa++)
+    {
+        SCOPED_TRACE(smalltime_isa_name(smalltime_set_isa((smalltime_isa)isa)));
+        function();
+    }
+    smalltime_set_isa(original);
+}
+
+#endif // KS_smalltime_for_each_isa_H
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <smalltime/format.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static std::string reference_format(smalltime value)
+{
+    char buffer[100];
+    int year = smalltime_get_year(value);
+    const char* format = year >= 0 && year <= 9999
+        ? "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ"
+        : (year < 0 ? "-%06d-%02d-%02dT%02d:%02d:%02d.%06dZ" : "+%06d-%02d-%02dT%02d:%02d:%02d.%06dZ");
+    snprintf(buffer, sizeof(buffer), format, abs(year), smalltime_get_month(value), smalltime_get_day(value),
+        smalltime_get_hour(value), smalltime_get_minute(value), smalltime_get_second(value), smalltime_get_microsecond(value));
+    return buffer;
+}
+
+static std::string reference_format(nanotime value)
+{
+    char buffer[100];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%09dZ", nanotime_get_year(value), nanotime_get_month(value),
+        nanotime_get_day(value), nanotime_get_hour(value), nanotime_get_minute(value), nanotime_get_second(value),
+        nanotime_get_nanosecond(value));
+    return buffer;
+}
+
+static std::string format(smalltime value)
+{
+    char buffer[SMALLTIME_ISO8601_MAX_LENGTH + 1];
+    size_t length = smalltime_format_iso8601(value, buffer);
+    EXPECT_EQ(strlen(buffer), length);
+    return buffer;
+}
+
+static std::string format(nanotime value)
+{
+    char buffer[NANOTIME_ISO8601_LENGTH + 1];
+    size_t length = nanotime_format_iso8601(value, buffer);
+    EXPECT_EQ(strlen(buffer), length);
+    return buffer;
+}
+
+static std::vector<smalltime> random_smalltimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(smalltime_to_unix_seconds(smalltime_new(-131072, 1, 1, 0, 0, 0, 0)),
+                                                    smalltime_to_unix_seconds(smalltime_new(131071, 12, 31, 23, 59, 59, 0)));
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        value = smalltime_from_unix_seconds(anywhere(rng)) | (smalltime)(rng() % 1000000);
+    }
+    return values;
+}
+
+// Mostly four digit years, with an expanded year every so often.
+static std::vector<smalltime> mixed_smalltimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> four_digits(smalltime_to_unix_seconds(smalltime_new(0, 1, 1, 0, 0, 0, 0)),
+                                                       smalltime_to_unix_seconds(smalltime_new(9999, 12, 31, 23, 59, 59, 0)));
+    std::vector<smalltime> expanded = random_smalltimes(count, seed);
+    std::vector<smalltime> values(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        values[i] = i % 50 == 7 ? expanded[i] : smalltime_from_unix_seconds(four_digits(rng)) | (smalltime)(rng() % 1000000);
+    }
+    return values;
+}
+
+static std::vector<nanotime> random_nanotimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(0, nanotime_to_unix_seconds(nanotime_new(2225, 12, 31, 23, 59, 59, 0)));
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        value = nanotime_from_unix_seconds(anywhere(rng)) | (rng() % 1000000000);
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Format, examples)
+{
+    EXPECT_EQ("1985-10-26T08:22:16.900142Z", format((smalltime)0x1f06b48590dbc2e));
+    EXPECT_EQ("0000-01-01T00:00:00.000000Z", format(smalltime_new(0, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ("9999-12-31T23:59:60.999999Z", format(smalltime_new(9999, 12, 31, 23, 59, 60, 999999)));
+    EXPECT_EQ("-000001-01-01T00:00:00.000000Z", format(smalltime_new(-1, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ("+010000-01-01T00:00:00.000001Z", format(smalltime_new(10000, 1, 1, 0, 0, 0, 1)));
+    EXPECT_EQ("-131072-01-01T00:00:00.000000Z", format(smalltime_new(-131072, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ("+131071-12-31T23:59:59.999999Z", format(smalltime_new(131071, 12, 31, 23, 59, 59, 999999)));
+    EXPECT_EQ("1970-01-01T00:00:00.000000000Z", format(nanotime_new(1970, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ("2225-12-31T23:59:60.999999999Z", format(nanotime_new(2225, 12, 31, 23, 59, 60, 999999999)));
+    EXPECT_EQ("2001-09-09T01:46:40.123456789Z", format(nanotime_new(2001, 9, 9, 1, 46, 40, 123456789)));
+}
+
+TEST(Format, matches_snprintf)
+{
+    for(smalltime value: random_smalltimes(20000, 1))
+    {
+        ASSERT_EQ(reference_format(value), format(value));
+    }
+    for(nanotime value: random_nanotimes(20000, 2))
+    {
+        ASSERT_EQ(reference_format(value), format(value));
+    }
+}
+
+TEST(Format, invalid_input_is_bounded)
+{
+    // Out-of-range fields produce garbage, but never more than the maximum
+    // length, and never anything other than digits and separators.
+    std::mt19937_64 rng(3);
+    for(int i = 0; i < 20000; i++)
+    {
+        uint64_t bits = rng();
+        for(const std::string& text: {format((smalltime)bits), format((nanotime)bits)})
+        {
+            ASSERT_LE(text.size(), (size_t)SMALLTIME_ISO8601_MAX_LENGTH);
+            ASSERT_EQ(std::string::npos, text.find_first_not_of("0123456789+-T:.Z"));
+        }
+    }
+}
+
+TEST(Format, batch_newlines)
+{
+    std::vector<smalltime> smalltimes = mixed_smalltimes(1000, 4);
+    std::vector<nanotime> nanotimes = random_nanotimes(1000, 5);
+    std::string smalltime_expected, nanotime_expected;
+    for(size_t i = 0; i < smalltimes.size(); i++)
+    {
+        smalltime_expected += reference_format(smalltimes[i]) + "\n";
+        nanotime_expected += reference_format(nanotimes[i]) + "\n";
+    }
+
+    for_each_isa([&]
+    {
+        std::vector<char> buffer(smalltimes.size() * (SMALLTIME_ISO8601_MAX_LENGTH + 1));
+        size_t length = smalltime_batch_format_iso8601(smalltimes.data(), smalltimes.size(), 0, buffer.data());
+        EXPECT_EQ(smalltime_expected, std::string(buffer.data(), length));
+
+        buffer.assign(nanotimes.size() * (NANOTIME_ISO8601_LENGTH + 1), 0);
+        length = nanotime_batch_format_iso8601(nanotimes.data(), nanotimes.size(), 0, buffer.data());
+        EXPECT_EQ(nanotime_expected, std::string(buffer.data(), length));
+    });
+}
+
+TEST(Format, batch_stride)
+{
+    const size_t stride = 32;
+    std::vector<smalltime> smalltimes = mixed_smalltimes(1000, 6);
+    std::vector<nanotime> nanotimes = random_nanotimes(1000, 7);
+    std::string smalltime_expected, nanotime_expected;
+    for(size_t i = 0; i < smalltimes.size(); i++)
+    {
+        std::string smalltime_text = reference_format(smalltimes[i]);
+        std::string nanotime_text = reference_format(nanotimes[i]);
+        smalltime_expected += smalltime_text + std::string(stride - smalltime_text.size(), ' ');
+        nanotime_expected += nanotime_text + std::string(stride - nanotime_text.size(), ' ');
+    }
+
+    for_each_isa([&]
+    {
+        std::vector<char> buffer(smalltimes.size() * stride);
+        EXPECT_EQ(buffer.size(), smalltime_batch_format_iso8601(smalltimes.data(), smalltimes.size(), stride, buffer.data()));
+        EXPECT_EQ(smalltime_expected, std::string(buffer.begin(), buffer.end()));
+        EXPECT_EQ(buffer.size(), nanotime_batch_format_iso8601(nanotimes.data(), nanotimes.size(), stride, buffer.data()));
+        EXPECT_EQ(nanotime_expected, std::string(buffer.begin(), buffer.end()));
+    });
+}
+
+TEST(Format, batch_invalid_input_matches_single)
+{
+    // Every level writes the same garbage for out-of-range fields as the
+    // single value functions.
+    std::mt19937_64 rng(8);
+    std::vector<uint64_t> bits(1000);
+    std::string smalltime_expected, nanotime_expected;
+    for(auto& value: bits)
+    {
+        // Mostly four digit smalltime years, so that most groups of eight
+        // take the vector path.
+        value = rng() & (rng() % 4 == 0 ? ~0ULL : 0x00ffffffffffffffULL);
+        smalltime_expected += format((smalltime)value) + "\n";
+        nanotime_expected += format((nanotime)value) + "\n";
+    }
+
+    for_each_isa([&]
+    {
+        std::vector<char> buffer(bits.size() * (SMALLTIME_ISO8601_MAX_LENGTH + 1));
+        size_t length = smalltime_batch_format_iso8601((const smalltime*)bits.data(), bits.size(), 0, buffer.data());
+        EXPECT_EQ(smalltime_expected, std::string(buffer.data(), length));
+        length = nanotime_batch_format_iso8601((const nanotime*)bits.data(), bits.size(), 0, buffer.data());
+        EXPECT_EQ(nanotime_expected, std::string(buffer.data(), length));
+    });
+}
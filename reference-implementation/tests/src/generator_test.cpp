@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <smalltime/generator.h>
+#include <smalltime/clock.h>
+#include <smalltime/validate.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const size_t thread_count = 8;
+static const size_t per_thread = 20000;
+
+// Runs get_values on several threads at once, checks that each thread's
+// values increase, and returns all of them sorted.
+template<typename T, typename F>
+static std::vector<T> collect_from_threads(F get_values)
+{
+    std::vector<std::vector<T>> results(thread_count);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back([&results, &get_values, i]
+        {
+            results[i].reserve(per_thread);
+            get_values(results[i]);
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+
+    std::vector<T> all;
+    for(auto& values: results)
+    {
+        EXPECT_EQ(per_thread, values.size());
+        EXPECT_TRUE(std::adjacent_find(values.begin(), values.end(), std::greater_equal<T>()) == values.end());
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+template<typename T>
+static void expect_unique(const std::vector<T>& sorted)
+{
+    EXPECT_TRUE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Generator, next_is_not_before_now)
+{
+    smalltime_generator small_generator = {};
+    nanotime_generator nano_generator = {};
+    smalltime small_before = smalltime_now();
+    nanotime nano_before = nanotime_now();
+    EXPECT_LE(small_before, smalltime_generator_next(&small_generator));
+    EXPECT_LE(nano_before, nanotime_generator_next(&nano_generator));
+}
+
+TEST(Generator, collisions_carry)
+{
+    // Start ahead of the clock, so every value comes from the increment.
+    smalltime_generator small_generator = {smalltime_new(2199, 12, 31, 23, 59, 59, 999998)};
+    EXPECT_EQ(smalltime_new(2199, 12, 31, 23, 59, 59, 999999), smalltime_generator_next(&small_generator));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 0), smalltime_generator_next(&small_generator));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 1), smalltime_generator_next(&small_generator));
+
+    nanotime_generator nano_generator = {nanotime_new(2199, 2, 28, 23, 59, 59, 999999999)};
+    EXPECT_EQ(nanotime_new(2199, 3, 1, 0, 0, 0, 0), nanotime_generator_next(&nano_generator));
+    EXPECT_EQ(nanotime_new(2199, 3, 1, 0, 0, 0, 1), nanotime_generator_next(&nano_generator));
+}
+
+TEST(Generator, reserve)
+{
+    smalltime_generator small_generator = {smalltime_new(2199, 12, 31, 23, 59, 59, 999990)};
+    EXPECT_EQ(smalltime_new(2199, 12, 31, 23, 59, 59, 999991), smalltime_generator_reserve(&small_generator, 100));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 91), smalltime_generator_next(&small_generator));
+
+    nanotime_generator nano_generator = {nanotime_new(2199, 12, 31, 23, 59, 59, 999999990)};
+    EXPECT_EQ(nanotime_new(2199, 12, 31, 23, 59, 59, 999999991), nanotime_generator_reserve(&nano_generator, 1000));
+    EXPECT_EQ(nanotime_new(2200, 1, 1, 0, 0, 0, 991), nanotime_generator_next(&nano_generator));
+}
+
+TEST(Generator, block_next)
+{
+    smalltime_generator generator = {smalltime_new(2199, 12, 31, 23, 59, 59, 999998)};
+    smalltime_generator_block block = {};
+    smalltime first = smalltime_generator_block_next(&generator, &block, 4);
+    EXPECT_EQ(smalltime_new(2199, 12, 31, 23, 59, 59, 999999), first);
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 0), smalltime_generator_block_next(&generator, &block, 4));
+    // Another thread gets the values after the block.
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 3), smalltime_generator_next(&generator));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 1), smalltime_generator_block_next(&generator, &block, 4));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 2), smalltime_generator_block_next(&generator, &block, 4));
+    EXPECT_EQ(smalltime_new(2200, 1, 1, 0, 0, 0, 4), smalltime_generator_block_next(&generator, &block, 4));
+}
+
+TEST(Generator, unique_across_threads)
+{
+    smalltime_generator small_generator = {};
+    std::vector<smalltime> smalltimes = collect_from_threads<smalltime>([&](std::vector<smalltime>& values)
+    {
+        for(size_t i = 0; i < per_thread; i++)
+        {
+            values.push_back(smalltime_generator_next(&small_generator));
+        }
+    });
+    expect_unique(smalltimes);
+    for(smalltime value: smalltimes)
+    {
+        ASSERT_TRUE(smalltime_is_valid(value)) << std::hex << value;
+    }
+
+    nanotime_generator nano_generator = {};
+    std::vector<nanotime> nanotimes = collect_from_threads<nanotime>([&](std::vector<nanotime>& values)
+    {
+        for(size_t i = 0; i < per_thread; i++)
+        {
+            values.push_back(nanotime_generator_next(&nano_generator));
+        }
+    });
+    expect_unique(nanotimes);
+    for(nanotime value: nanotimes)
+    {
+        ASSERT_TRUE(nanotime_is_valid(value)) << std::hex << value;
+    }
+}
+
+TEST(Generator, blocks_unique_across_threads)
+{
+    for(size_t block_size: {1, 7, 64})
+    {
+        smalltime_generator small_generator = {};
+        std::vector<smalltime> smalltimes = collect_from_threads<smalltime>([&](std::vector<smalltime>& values)
+        {
+            smalltime_generator_block block = {};
+            for(size_t i = 0; i < per_thread; i++)
+            {
+                values.push_back(smalltime_generator_block_next(&small_generator, &block, block_size));
+            }
+        });
+        expect_unique(smalltimes);
+
+        nanotime_generator nano_generator = {};
+        std::vector<nanotime> nanotimes = collect_from_threads<nanotime>([&](std::vector<nanotime>& values)
+        {
+            nanotime_generator_block block = {};
+            for(size_t i = 0; i < per_thread; i++)
+            {
+                values.push_back(nanotime_generator_block_next(&nano_generator, &block, block_size));
+            }
+        });
+        expect_unique(nanotimes);
+        for(nanotime value: nanotimes)
+        {
+            ASSERT_TRUE(nanotime_is_valid(value)) << std::hex << value;
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <smalltime/index.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Sorted values 0-3 microseconds apart, so that there are runs of
+// duplicates.
+static std::vector<smalltime> smalltime_sorted(size_t count, uint64_t seed, int64_t start)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<smalltime> values;
+    int64_t current = start;
+    for(size_t i = 0; i < count; i++)
+    {
+        current += (int64_t)(rng() % 4);
+        values.push_back(smalltime_from_unix_microseconds(current));
+    }
+    return values;
+}
+
+// Every value, the values on either side of them (wrapping around), and
+// the extremes.
+static std::vector<smalltime> smalltime_probes(const std::vector<smalltime>& values)
+{
+    std::vector<smalltime> probes = {INT64_MIN, INT64_MIN + 1, -1, 0, 1, INT64_MAX - 1, INT64_MAX};
+    for(smalltime value: values)
+    {
+        probes.push_back((smalltime)((uint64_t)value - 1));
+        probes.push_back(value);
+        probes.push_back((smalltime)((uint64_t)value + 1));
+    }
+    return probes;
+}
+
+static void expect_smalltime_searches(const std::vector<smalltime>& values)
+{
+    smalltime_index* index = smalltime_index_new(values.data(), values.size());
+    ASSERT_NE(nullptr, index);
+    std::vector<smalltime> probes = smalltime_probes(values);
+    for_each_isa([&]
+    {
+        std::vector<size_t> batch(probes.size());
+        smalltime_index_batch_lower_bound(index, probes.data(), probes.size(), batch.data());
+        for(size_t i = 0; i < probes.size(); i++)
+        {
+            size_t expected = (size_t)(std::lower_bound(values.begin(), values.end(), probes[i]) - values.begin());
+            ASSERT_EQ(expected, smalltime_index_lower_bound(index, probes[i])) << "probe " << probes[i];
+            ASSERT_EQ(expected, batch[i]) << "probe " << probes[i];
+        }
+    });
+    smalltime_index_free(index);
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Index, lower_bound)
+{
+    // Around every layer boundary (blocks of 8 under nodes of 9).
+    for(size_t count: {0, 1, 7, 8, 9, 63, 64, 65, 71, 72, 73, 647, 648, 649, 5831, 5832, 5833, 100000})
+    {
+        SCOPED_TRACE(count);
+        expect_smalltime_searches(smalltime_sorted(count, count, 1500000000LL * 1000000));
+    }
+}
+
+TEST(Index, negative_smalltime)
+{
+    std::vector<smalltime> values;
+    for(int year = -131072; year < 131072; year += 97)
+    {
+        values.push_back(smalltime_new(year, 1 + year % 12 * (year < 0 ? -1 : 1), 1, 0, 0, 0, 0));
+    }
+    std::sort(values.begin(), values.end());
+    expect_smalltime_searches(values);
+}
+
+TEST(Index, extreme_values)
+{
+    expect_smalltime_searches({INT64_MIN, INT64_MIN, 0, INT64_MAX, INT64_MAX});
+    std::vector<smalltime> values(100, INT64_MAX);
+    values[0] = INT64_MIN;
+    expect_smalltime_searches(values);
+}
+
+TEST(Index, nanotime)
+{
+    // Values from both sides of the top bit, which must still compare as
+    // unsigned.
+    std::vector<nanotime> values;
+    for(int year = 1970; year <= 2225; year++)
+    {
+        for(int day = 1; day <= 28; day += 9)
+        {
+            values.push_back(nanotime_new(year, 1 + year % 12, day, 0, 0, 0, 0));
+        }
+    }
+    std::sort(values.begin(), values.end());
+    nanotime_index* index = nanotime_index_new(values.data(), values.size());
+    ASSERT_NE(nullptr, index);
+    std::vector<nanotime> probes = {0, 1, UINT64_MAX, UINT64_MAX - 1, 0x8000000000000000ULL, 0x7fffffffffffffffULL};
+    for(nanotime value: values)
+    {
+        probes.push_back(value - 1);
+        probes.push_back(value);
+        probes.push_back(value + 1);
+    }
+    for_each_isa([&]
+    {
+        std::vector<size_t> batch(probes.size());
+        nanotime_index_batch_lower_bound(index, probes.data(), probes.size(), batch.data());
+        for(size_t i = 0; i < probes.size(); i++)
+        {
+            size_t expected = (size_t)(std::lower_bound(values.begin(), values.end(), probes[i]) - values.begin());
+            ASSERT_EQ(expected, nanotime_index_lower_bound(index, probes[i])) << "probe " << probes[i];
+            ASSERT_EQ(expected, batch[i]) << "probe " << probes[i];
+        }
+    });
+    nanotime_index_free(index);
+}
+
+TEST(Index, equal_range)
+{
+    std::vector<smalltime> values = smalltime_sorted(10000, 1, 0);
+    values.push_back(INT64_MAX);
+    values.push_back(INT64_MAX);
+    smalltime_index* index = smalltime_index_new(values.data(), values.size());
+    ASSERT_NE(nullptr, index);
+    for_each_isa([&]
+    {
+        for(smalltime probe: smalltime_probes(values))
+        {
+            auto expected = std::equal_range(values.begin(), values.end(), probe);
+            size_t first = 0;
+            size_t last = 0;
+            smalltime_index_equal_range(index, probe, &first, &last);
+            ASSERT_EQ((size_t)(expected.first - values.begin()), first) << "probe " << probe;
+            ASSERT_EQ((size_t)(expected.second - values.begin()), last) << "probe " << probe;
+        }
+    });
+    smalltime_index_free(index);
+
+    std::vector<nanotime> nanotimes = {1, 2, 2, UINT64_MAX};
+    nanotime_index* nanotime_index = nanotime_index_new(nanotimes.data(), nanotimes.size());
+    size_t first = 0;
+    size_t last = 0;
+    nanotime_index_equal_range(nanotime_index, 2, &first, &last);
+    EXPECT_EQ(1u, first);
+    EXPECT_EQ(3u, last);
+    nanotime_index_equal_range(nanotime_index, UINT64_MAX, &first, &last);
+    EXPECT_EQ(3u, first);
+    EXPECT_EQ(4u, last);
+    nanotime_index_free(nanotime_index);
+}
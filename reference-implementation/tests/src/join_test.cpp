@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <smalltime/join.h>
+#include <smalltime/arith.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Sorted events within an hour, about one in ten of them repeating the
+// previous time.
+static std::vector<smalltime> smalltime_events(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<smalltime> values;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(i > 0 && rng() % 10 == 0)
+        {
+            values.push_back(values.back());
+            continue;
+        }
+        values.push_back(smalltime_from_unix_microseconds(1500000000LL * 1000000 + (int64_t)(rng() % 3600000000LL)));
+    }
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+static void expect_smalltime_asof(const std::vector<smalltime>& left, const std::vector<smalltime>& right,
+                                  unsigned threads)
+{
+    std::vector<size_t> matches(right.size());
+    smalltime_asof_join(left.data(), left.size(), right.data(), right.size(), matches.data(), threads);
+    for(size_t i = 0; i < right.size(); i++)
+    {
+        size_t expected = (size_t)(std::upper_bound(left.begin(), left.end(), right[i]) - left.begin()) - 1;
+        ASSERT_EQ(expected, matches[i]) << "at " << i;
+    }
+}
+
+static void expect_smalltime_window(const std::vector<smalltime>& left, const std::vector<smalltime>& right,
+                                    int64_t before, int64_t after, unsigned threads)
+{
+    std::vector<size_t> starts(right.size());
+    std::vector<size_t> ends(right.size());
+    smalltime_window_join(left.data(), left.size(), right.data(), right.size(), before, after,
+                          starts.data(), ends.data(), threads);
+    for(size_t i = 0; i < right.size(); i++)
+    {
+        smalltime lower = smalltime_add_microseconds(right[i], -before);
+        smalltime upper = smalltime_add_microseconds(right[i], after);
+        size_t start = (size_t)(std::lower_bound(left.begin(), left.end(), lower) - left.begin());
+        size_t end = (size_t)(std::upper_bound(left.begin(), left.end(), upper) - left.begin());
+        ASSERT_EQ(start, starts[i]) << "at " << i;
+        ASSERT_EQ(std::max(start, end), ends[i]) << "at " << i;
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Join, asof_uniform)
+{
+    std::vector<smalltime> left = smalltime_events(50000, 1);
+    std::vector<smalltime> right = smalltime_events(50000, 2);
+    expect_smalltime_asof(left, right, 1);
+}
+
+TEST(Join, asof_skewed)
+{
+    // Dense ticks with sparse orders (galloping), and the reverse.
+    std::vector<smalltime> dense = smalltime_events(200000, 3);
+    std::vector<smalltime> sparse = smalltime_events(500, 4);
+    expect_smalltime_asof(dense, sparse, 1);
+    expect_smalltime_asof(sparse, dense, 1);
+}
+
+TEST(Join, asof_threads)
+{
+    std::vector<smalltime> left = smalltime_events(100000, 5);
+    std::vector<smalltime> right = smalltime_events(65536 * 3 + 5, 6);
+    for(unsigned threads: {0, 2, 3, 100})
+    {
+        SCOPED_TRACE(threads);
+        expect_smalltime_asof(left, right, threads);
+    }
+}
+
+TEST(Join, asof_edges)
+{
+    std::vector<smalltime> left = {smalltime_new(-5, 1, 1, 0, 0, 0, 0), smalltime_new(2000, 1, 1, 0, 0, 0, 0)};
+    std::vector<smalltime> right = {smalltime_new(-10, 1, 1, 0, 0, 0, 0),
+                                    smalltime_new(-5, 1, 1, 0, 0, 0, 0),
+                                    smalltime_new(0, 1, 1, 0, 0, 0, 0),
+                                    smalltime_new(3000, 1, 1, 0, 0, 0, 0)};
+    std::vector<size_t> matches(right.size());
+    smalltime_asof_join(left.data(), left.size(), right.data(), right.size(), matches.data(), 1);
+    ASSERT_EQ((std::vector<size_t>{SMALLTIME_JOIN_NO_MATCH, 0, 0, 1}), matches);
+
+    smalltime_asof_join(nullptr, 0, right.data(), right.size(), matches.data(), 1);
+    ASSERT_EQ(std::vector<size_t>(right.size(), SMALLTIME_JOIN_NO_MATCH), matches);
+    smalltime_asof_join(left.data(), left.size(), nullptr, 0, nullptr, 1);
+}
+
+TEST(Join, window)
+{
+    std::vector<smalltime> left = smalltime_events(50000, 7);
+    std::vector<smalltime> right = smalltime_events(20000, 8);
+    expect_smalltime_window(left, right, 0, 0, 1);
+    expect_smalltime_window(left, right, 1000, 2000, 1);
+    expect_smalltime_window(left, right, 60000000, 0, 2);
+    // A window entirely after the right value, and one that closes before
+    // it opens.
+    expect_smalltime_window(left, right, -1000, 5000, 1);
+    expect_smalltime_window(left, right, -5000, 1000, 1);
+}
+
+TEST(Join, window_skewed)
+{
+    std::vector<smalltime> dense = smalltime_events(200000, 9);
+    std::vector<smalltime> sparse = smalltime_events(300, 10);
+    expect_smalltime_window(dense, sparse, 100000, 100000, 1);
+    expect_smalltime_window(sparse, dense, 100000, 100000, 1);
+}
+
+TEST(Join, nanotime_window_cut_off)
+{
+    // Windows reaching before 1970 or past 2225 stop at the ends.
+    std::vector<nanotime> left = {nanotime_new(1970, 1, 1, 0, 0, 0, 0),
+                                  nanotime_new(1970, 1, 1, 0, 0, 0, 10),
+                                  nanotime_new(2225, 12, 31, 23, 59, 59, 999999990),
+                                  nanotime_new(2225, 12, 31, 23, 59, 59, 999999999)};
+    std::vector<nanotime> right = {nanotime_new(1970, 1, 1, 0, 0, 0, 5),
+                                   nanotime_new(2225, 12, 31, 23, 59, 59, 999999995)};
+    std::vector<size_t> starts(2);
+    std::vector<size_t> ends(2);
+    nanotime_window_join(left.data(), left.size(), right.data(), right.size(), 100, 100,
+                         starts.data(), ends.data(), 1);
+    ASSERT_EQ((std::vector<size_t>{0, 2}), starts);
+    ASSERT_EQ((std::vector<size_t>{2, 4}), ends);
+
+    std::vector<size_t> matches(2);
+    nanotime_asof_join(left.data(), left.size(), right.data(), right.size(), matches.data(), 1);
+    ASSERT_EQ((std::vector<size_t>{0, 2}), matches);
+}
@@ -0,0 +1,360 @@
+#include <gtest/gtest.h>
+#include <smalltime/leap.h>
+#include <smalltime/arith.h>
+#include <smalltime/epoch.h>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static const char* const leap_seconds_list =
+    "#\tA cut down leap-seconds.list.\n"
+    "#\n"
+    "#$\t 3676924800\n"
+    "#@\t3960057600\n"
+    "#\n"
+    "2272060800\t10\t# 1 Jan 1972\n"
+    "2287785600\t11\t# 1 Jul 1972\n"
+    "2303683200\t12\t# 1 Jan 1973\n"
+    "2335219200\t13\t# 1 Jan 1974\n"
+    "2366755200\t14\t# 1 Jan 1975\n"
+    "2398291200\t15\t# 1 Jan 1976\n"
+    "2429913600\t16\t# 1 Jan 1977\n"
+    "2461449600\t17\t# 1 Jan 1978\n"
+    "2492985600\t18\t# 1 Jan 1979\n"
+    "2524521600\t19\t# 1 Jan 1980\n"
+    "2571782400\t20\t# 1 Jul 1981\n"
+    "2603318400\t21\t# 1 Jul 1982\n"
+    "2634854400\t22\t# 1 Jul 1983\n"
+    "2698012800\t23\t# 1 Jul 1985\n"
+    "2776982400\t24\t# 1 Jan 1988\n"
+    "2840140800\t25\t# 1 Jan 1990\n"
+    "2871676800\t26\t# 1 Jan 1991\n"
+    "2918937600\t27\t# 1 Jul 1992\n"
+    "2950473600\t28\t# 1 Jul 1993\n"
+    "2982009600\t29\t# 1 Jul 1994\n"
+    "3029443200\t30\t# 1 Jan 1996\n"
+    "3076704000\t31\t# 1 Jul 1997\n"
+    "3124137600\t32\t# 1 Jan 1999\n"
+    "3345062400\t33\t# 1 Jan 2006\n"
+    "3439756800\t34\t# 1 Jan 2009\n"
+    "3550089600\t35\t# 1 Jul 2012\n"
+    "3644697600\t36\t# 1 Jul 2015\n"
+    "3692217600\t37\t# 1 Jan 2017\n"
+    "#h\t16edd0f0 3666784f 37db6bdd e74ced87 59af48f1\n";
+
+// 2030-01-01 and 2031-01-01, at the start of the day, in NTP seconds.
+static const std::string ntp_2030 = "4102444800";
+static const std::string ntp_2031 = "4133980800";
+
+static smalltime_leap_table* open_table(const std::string& text)
+{
+    std::string path = ::testing::TempDir() + "smalltime_leap_seconds.list";
+    std::ofstream(path, std::ios::binary) << text;
+    smalltime_leap_table* table = smalltime_leap_table_open(path.c_str());
+    std::remove(path.c_str());
+    return table;
+}
+
+static smalltime st(int year, int month, int day, int hour, int minute, int second, int microsecond = 0)
+{
+    return smalltime_new(year, month, day, hour, minute, second, microsecond);
+}
+
+// Each leap second in the list (second 60 of the day before each entry).
+static std::vector<smalltime> leap_seconds()
+{
+    std::vector<smalltime> values;
+    for(const char* line = leap_seconds_list; *line != 0; line = strchr(line, '\n') + 1)
+    {
+        // Every entry but the first (1972-01-01) follows a leap second.
+        if(*line >= '0' && *line <= '9' && strncmp(line, "2272060800", 10) != 0)
+        {
+            smalltime day = smalltime_from_unix_seconds(strtoll(line, NULL, 10) - 2208988800LL);
+            values.push_back(smalltime_with_second(smalltime_add_seconds(day, -1), 60));
+        }
+    }
+    return values;
+}
+
+// Times around every leap second, then scattered ones.
+static std::vector<smalltime> test_values()
+{
+    std::vector<smalltime> values;
+    for(smalltime leap: leap_seconds())
+    {
+        for(int64_t offset = -3000000; offset <= 3000000; offset += 250000)
+        {
+            smalltime before = smalltime_with_second(leap, 59);
+            values.push_back(offset < 0 ? smalltime_add_microseconds(before, offset + 1000000) :
+                             offset < 1000000 ? leap | (smalltime)offset : smalltime_add_microseconds(before, offset));
+        }
+    }
+    std::mt19937_64 rng(25);
+    for(int i = 0; i < 10000; i++)
+    {
+        values.push_back(smalltime_from_unix_microseconds((int64_t)(rng() % 4000000000000000ULL)));
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Leap, offset)
+{
+    smalltime_leap_table* table = open_table(leap_seconds_list);
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(10, smalltime_leap_offset(table, st(1960, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(10, smalltime_leap_offset(table, st(1972, 6, 30, 23, 59, 59, 999999)));
+    EXPECT_EQ(10, smalltime_leap_offset(table, st(1972, 6, 30, 23, 59, 60, 999999)));
+    EXPECT_EQ(11, smalltime_leap_offset(table, st(1972, 7, 1, 0, 0, 0)));
+    EXPECT_EQ(36, smalltime_leap_offset(table, st(2016, 12, 31, 23, 59, 60, 500000)));
+    EXPECT_EQ(37, smalltime_leap_offset(table, st(2017, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(37, smalltime_leap_offset(table, st(100000, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(36, nanotime_leap_offset(table, nanotime_new(2016, 12, 31, 23, 59, 60, 999999999)));
+    EXPECT_EQ(37, nanotime_leap_offset(table, nanotime_new(2017, 1, 1, 0, 0, 0, 0)));
+    EXPECT_EQ(st(2025, 6, 28, 0, 0, 0), smalltime_leap_table_expires(table));
+    smalltime_leap_table_close(table);
+
+    table = open_table("2272060800 10\n");
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(0, smalltime_leap_table_expires(table));
+    smalltime_leap_table_close(table);
+
+    EXPECT_EQ(0, smalltime_leap_offset(NULL, st(2017, 1, 1, 0, 0, 0)));
+}
+
+TEST(Leap, tai)
+{
+    smalltime_leap_table* table = open_table(leap_seconds_list);
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 35, 1), smalltime_leap_to_tai(table, st(2016, 12, 31, 23, 59, 59, 1)));
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 36, 500000), smalltime_leap_to_tai(table, st(2016, 12, 31, 23, 59, 60, 500000)));
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 37), smalltime_leap_to_tai(table, st(2017, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(st(1972, 1, 1, 0, 0, 10), smalltime_leap_to_tai(table, st(1972, 1, 1, 0, 0, 0)));
+
+    EXPECT_EQ(st(2016, 12, 31, 23, 59, 59, 1), smalltime_leap_from_tai(table, st(2017, 1, 1, 0, 0, 35, 1)));
+    EXPECT_EQ(st(2016, 12, 31, 23, 59, 60), smalltime_leap_from_tai(table, st(2017, 1, 1, 0, 0, 36)));
+    EXPECT_EQ(st(2016, 12, 31, 23, 59, 60, 999999), smalltime_leap_from_tai(table, st(2017, 1, 1, 0, 0, 36, 999999)));
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 0), smalltime_leap_from_tai(table, st(2017, 1, 1, 0, 0, 37)));
+    EXPECT_EQ(st(1972, 6, 30, 23, 59, 60, 5), smalltime_leap_from_tai(table, st(1972, 7, 1, 0, 0, 10, 5)));
+
+    for(smalltime utc: test_values())
+    {
+        ASSERT_EQ(utc, smalltime_leap_from_tai(table, smalltime_leap_to_tai(table, utc))) << utc;
+    }
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 0), smalltime_leap_to_tai(NULL, st(2017, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(st(2017, 1, 1, 0, 0, 0), smalltime_leap_from_tai(NULL, st(2017, 1, 1, 0, 0, 0)));
+    smalltime_leap_table_close(table);
+}
+
+TEST(Leap, nanotime_tai)
+{
+    smalltime_leap_table* table = open_table(leap_seconds_list);
+    ASSERT_NE(nullptr, table);
+    nanotime result = 12345;
+    EXPECT_TRUE(nanotime_leap_to_tai(table, nanotime_new(2016, 12, 31, 23, 59, 60, 123456789), &result));
+    EXPECT_EQ(nanotime_new(2017, 1, 1, 0, 0, 36, 123456789), result);
+    EXPECT_TRUE(nanotime_leap_from_tai(table, result, &result));
+    EXPECT_EQ(nanotime_new(2016, 12, 31, 23, 59, 60, 123456789), result);
+    EXPECT_TRUE(nanotime_leap_from_tai(table, nanotime_new(2017, 1, 1, 0, 0, 37, 1), &result));
+    EXPECT_EQ(nanotime_new(2017, 1, 1, 0, 0, 0, 1), result);
+
+    EXPECT_FALSE(nanotime_leap_to_tai(table, nanotime_new(2225, 12, 31, 23, 59, 50, 0), &result));
+    EXPECT_FALSE(nanotime_leap_from_tai(table, nanotime_new(1970, 1, 1, 0, 0, 5, 0), &result));
+    EXPECT_EQ(nanotime_new(2017, 1, 1, 0, 0, 0, 1), result);
+    smalltime_leap_table_close(table);
+}
+
+TEST(Leap, diff)
+{
+    smalltime_leap_table* table = open_table(leap_seconds_list);
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(2000000, smalltime_leap_diff_us(table, st(2017, 1, 1, 0, 0, 0), st(2016, 12, 31, 23, 59, 59)));
+    EXPECT_EQ(-2000000, smalltime_leap_diff_us(table, st(2016, 12, 31, 23, 59, 59), st(2017, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(1000000, smalltime_leap_diff_us(table, st(2017, 1, 1, 0, 0, 0), st(2016, 12, 31, 23, 59, 60)));
+    EXPECT_EQ(1500000, smalltime_leap_diff_us(table, st(2016, 12, 31, 23, 59, 60, 500000), st(2016, 12, 31, 23, 59, 59)));
+    EXPECT_EQ(1000000, smalltime_leap_diff_us(table, st(2016, 12, 31, 23, 59, 59), st(2016, 12, 31, 23, 59, 58)));
+    smalltime start = st(1971, 6, 1, 0, 0, 0);
+    smalltime end = st(2020, 6, 1, 0, 0, 0);
+    EXPECT_EQ(smalltime_diff_us(end, start) + 27000000, smalltime_leap_diff_us(table, end, start));
+    EXPECT_EQ(smalltime_diff_us(end, start), smalltime_leap_diff_us(NULL, end, start));
+
+    EXPECT_EQ(2000000001, nanotime_leap_diff_ns(table, nanotime_new(2017, 1, 1, 0, 0, 0, 1), nanotime_new(2016, 12, 31, 23, 59, 59, 0)));
+    EXPECT_EQ(999999999, nanotime_leap_diff_ns(table, nanotime_new(2017, 1, 1, 0, 0, 0, 0), nanotime_new(2016, 12, 31, 23, 59, 60, 1)));
+
+    // Elapsed TAI time, in every case.
+    std::vector<smalltime> values = test_values();
+    std::vector<smalltime> ends(values.begin() + 1, values.end());
+    std::vector<int64_t> durations(ends.size());
+    smalltime_leap_batch_diff_us(table, ends.data(), values.data(), ends.size(), durations.data());
+    for(size_t i = 0; i < ends.size(); i++)
+    {
+        int64_t expected = smalltime_to_unix_microseconds(smalltime_leap_to_tai(table, ends[i])) -
+                           smalltime_to_unix_microseconds(smalltime_leap_to_tai(table, values[i]));
+        ASSERT_EQ(expected, durations[i]) << i;
+        ASSERT_EQ(expected, smalltime_leap_diff_us(table, ends[i], values[i])) << i;
+    }
+
+    std::vector<nanotime> nanotime_starts;
+    std::vector<nanotime> nanotime_ends;
+    for(size_t i = 0; i < ends.size(); i++)
+    {
+        if(smalltime_get_year(values[i]) >= 1970 && smalltime_get_year(values[i]) <= 2225 &&
+           smalltime_get_year(ends[i]) >= 1970 && smalltime_get_year(ends[i]) <= 2225)
+        {
+            nanotime_starts.push_back(nanotime_new(smalltime_get_year(values[i]), smalltime_get_month(values[i]), smalltime_get_day(values[i]),
+                                                   smalltime_get_hour(values[i]), smalltime_get_minute(values[i]), smalltime_get_second(values[i]),
+                                                   smalltime_get_microsecond(values[i]) * 1000 + 7));
+            nanotime_ends.push_back(nanotime_new(smalltime_get_year(ends[i]), smalltime_get_month(ends[i]), smalltime_get_day(ends[i]),
+                                                 smalltime_get_hour(ends[i]), smalltime_get_minute(ends[i]), smalltime_get_second(ends[i]),
+                                                 smalltime_get_microsecond(ends[i]) * 1000 + 3));
+            ASSERT_EQ(smalltime_leap_diff_us(table, ends[i], values[i]) * 1000 - 4, nanotime_leap_diff_ns(table, nanotime_ends.back(), nanotime_starts.back())) << i;
+        }
+    }
+    ASSERT_GT(nanotime_starts.size(), 1000u);
+    durations.resize(nanotime_ends.size());
+    nanotime_leap_batch_diff_ns(table, nanotime_ends.data(), nanotime_starts.data(), nanotime_ends.size(), durations.data());
+    for(size_t i = 0; i < nanotime_ends.size(); i++)
+    {
+        ASSERT_EQ(nanotime_leap_diff_ns(table, nanotime_ends[i], nanotime_starts[i]), durations[i]) << i;
+    }
+    smalltime_leap_table_close(table);
+}
+
+TEST(Leap, negative_leap_second)
+{
+    // 2029-12-31T23:59:59 is skipped.
+    smalltime_leap_table* table = open_table(std::string(leap_seconds_list) + ntp_2030 + " 36\n");
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(37, smalltime_leap_offset(table, st(2029, 12, 31, 23, 59, 58)));
+    EXPECT_EQ(36, smalltime_leap_offset(table, st(2030, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(1000000, smalltime_leap_diff_us(table, st(2030, 1, 1, 0, 0, 0), st(2029, 12, 31, 23, 59, 58)));
+    EXPECT_EQ(st(2030, 1, 1, 0, 0, 36), smalltime_leap_to_tai(table, st(2030, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(st(2030, 1, 1, 0, 0, 35, 9), smalltime_leap_to_tai(table, st(2029, 12, 31, 23, 59, 58, 9)));
+    EXPECT_EQ(st(2029, 12, 31, 23, 59, 58, 9), smalltime_leap_from_tai(table, st(2030, 1, 1, 0, 0, 35, 9)));
+    EXPECT_EQ(st(2030, 1, 1, 0, 0, 0), smalltime_leap_from_tai(table, st(2030, 1, 1, 0, 0, 36)));
+    smalltime_leap_table_close(table);
+}
+
+TEST(Leap, refuses_invalid_files)
+{
+    std::string valid = leap_seconds_list;
+    for(const std::string& text: {std::string(), std::string("# Nothing\n"), std::string("garbage\n"), valid + ntp_2030 + " 39\n",
+                                  valid + ntp_2030 + " 37\n", valid + "3692217600 38\n", valid + "4102444801 38\n",
+                                  valid + ntp_2030 + " 38 junk\n", valid + "#@ nothing\n", valid + "-" + ntp_2030 + " 38\n",
+                                  valid + "41024448000000000 38\n"})
+    {
+        errno = 0;
+        EXPECT_EQ(nullptr, open_table(text)) << text.substr(valid.size() <= text.size() ? valid.size() : 0);
+        EXPECT_EQ(EINVAL, errno);
+    }
+    smalltime_leap_table* table = open_table(valid + ntp_2030 + "  38 \r\n" + ntp_2031 + "\t+39");
+    ASSERT_NE(nullptr, table);
+    EXPECT_EQ(39, smalltime_leap_offset(table, st(2031, 1, 1, 0, 0, 0)));
+    smalltime_leap_table_close(table);
+
+    errno = 0;
+    EXPECT_EQ(nullptr, smalltime_leap_table_open((::testing::TempDir() + "does_not_exist").c_str()));
+    EXPECT_EQ(ENOENT, errno);
+}
+
+TEST(Leap, publish)
+{
+    smalltime_leap_table* first = open_table(leap_seconds_list);
+    ASSERT_NE(nullptr, first);
+    EXPECT_EQ(nullptr, smalltime_leap_current());
+    EXPECT_EQ(nullptr, smalltime_leap_publish(first));
+    EXPECT_EQ(first, smalltime_leap_current());
+
+    // Readers see one table or the other, never anything in between, and
+    // never a table that has been freed.
+    std::vector<smalltime_leap_table*> tables;
+    for(int i = 0; i < 200; i++)
+    {
+        tables.push_back(open_table(i % 2 == 0 ? std::string(leap_seconds_list) + ntp_2030 + " 38\n" : leap_seconds_list));
+        ASSERT_NE(nullptr, tables.back());
+    }
+    std::atomic<bool> done(false);
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; i++)
+    {
+        readers.emplace_back([&] {
+            while(!done.load())
+            {
+                int token = smalltime_leap_read_lock();
+                const smalltime_leap_table* table = smalltime_leap_current();
+                int32_t offset = smalltime_leap_offset(table, st(2031, 1, 1, 0, 0, 0));
+                int64_t diff = smalltime_leap_diff_us(table, st(2031, 1, 1, 0, 0, 0), st(2016, 1, 1, 0, 0, 0));
+                smalltime_leap_read_unlock(token);
+                errors += (offset != 37 || diff != smalltime_diff_us(st(2031, 1, 1, 0, 0, 0), st(2016, 1, 1, 0, 0, 0)) + 1000000) &&
+                          (offset != 38 || diff != smalltime_diff_us(st(2031, 1, 1, 0, 0, 0), st(2016, 1, 1, 0, 0, 0)) + 2000000);
+            }
+        });
+    }
+    for(smalltime_leap_table* table: tables)
+    {
+        smalltime_leap_replace(table);
+    }
+    done = true;
+    for(auto& reader: readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(0u, errors.load());
+
+    EXPECT_EQ(tables.back(), smalltime_leap_publish(NULL));
+    EXPECT_EQ(nullptr, smalltime_leap_current());
+    smalltime_leap_synchronize();
+    smalltime_leap_table_close(tables.back());
+}
+
+TEST(Leap, grace_period)
+{
+    // Nested sections, and a grace period that waits for the outer one.
+    int outer = smalltime_leap_read_lock();
+    int inner = smalltime_leap_read_lock();
+    smalltime_leap_read_unlock(inner);
+    std::atomic<bool> synchronized(false);
+    std::thread writer([&] {
+        smalltime_leap_synchronize();
+        synchronized = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(synchronized.load());
+
+    smalltime_leap_read_unlock(outer);
+    writer.join();
+    EXPECT_TRUE(synchronized.load());
+
+    // With no readers, it returns at once.
+    smalltime_leap_synchronize();
+}
+
+TEST(Leap, system_table)
+{
+    smalltime_leap_table* table = smalltime_leap_table_open("/usr/share/zoneinfo/leap-seconds.list");
+    if(table == NULL)
+    {
+        GTEST_SKIP() << "No system leap second list";
+    }
+    EXPECT_EQ(10, smalltime_leap_offset(table, st(1972, 1, 1, 0, 0, 0)));
+    EXPECT_EQ(37, smalltime_leap_offset(table, st(2017, 1, 1, 0, 0, 0)));
+    EXPECT_GE(smalltime_leap_table_expires(table), st(2017, 1, 1, 0, 0, 0));
+    smalltime_leap_table_close(table);
+}
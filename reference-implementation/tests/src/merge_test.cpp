@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+#include <smalltime/merge.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+typedef std::vector<std::vector<smalltime>> smalltime_streams;
+
+// Sorted streams of events from within a minute. With a nonzero burst
+// length, each stream writes runs of up to that many events at a time.
+static smalltime_streams smalltime_logs(size_t stream_count, size_t count, size_t burst, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    smalltime_streams streams(stream_count);
+    int64_t start = 1500000000LL * 1000000;
+    for(size_t i = 0; i < count; i++)
+    {
+        auto& stream = streams[rng() % stream_count];
+        size_t length = burst == 0 ? 1 : 1 + rng() % burst;
+        for(size_t j = 0; j < length; j++)
+        {
+            stream.push_back(smalltime_from_unix_microseconds(start + (int64_t)(rng() % 60000000)));
+        }
+    }
+    for(auto& stream: streams)
+    {
+        std::sort(stream.begin(), stream.end());
+    }
+    return streams;
+}
+
+// Every value with its stream number, in merged order.
+template <typename T>
+static std::vector<std::pair<T, uint32_t>> expected_merge(const std::vector<std::vector<T>>& streams)
+{
+    std::vector<std::pair<T, uint32_t>> merged;
+    for(size_t i = 0; i < streams.size(); i++)
+    {
+        for(T value: streams[i])
+        {
+            merged.emplace_back(value, (uint32_t)i);
+        }
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const auto& a, const auto& b)
+    {
+        return a.first < b.first;
+    });
+    return merged;
+}
+
+static std::vector<std::pair<smalltime, uint32_t>> drain(smalltime_merge* merge, size_t capacity)
+{
+    std::vector<std::pair<smalltime, uint32_t>> merged;
+    std::vector<smalltime> values(capacity);
+    std::vector<uint32_t> streams(capacity);
+    for(;;)
+    {
+        size_t count = smalltime_merge_next(merge, values.data(), streams.data(), capacity);
+        for(size_t i = 0; i < count; i++)
+        {
+            merged.emplace_back(values[i], streams[i]);
+        }
+        if(count < capacity)
+        {
+            return merged;
+        }
+    }
+}
+
+// Hands out a stream in batches of 1 to 10 values.
+struct batch_source
+{
+    const std::vector<smalltime>* values;
+    size_t position;
+    std::mt19937_64 rng;
+
+    static size_t next(void* context, const smalltime** values)
+    {
+        batch_source* source = (batch_source*)context;
+        size_t count = std::min((size_t)(1 + source->rng() % 10), source->values->size() - source->position);
+        *values = source->values->data() + source->position;
+        source->position += count;
+        return count;
+    }
+};
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Merge, arrays)
+{
+    for(size_t stream_count: {1, 2, 3, 8, 100})
+    {
+        SCOPED_TRACE(stream_count);
+        smalltime_streams streams = smalltime_logs(stream_count, 20000, 0, stream_count);
+        for(size_t capacity: {(size_t)1, (size_t)7, (size_t)SMALLTIME_MERGE_BATCH_LENGTH})
+        {
+            smalltime_merge* merge = smalltime_merge_new();
+            ASSERT_NE(nullptr, merge);
+            for(const auto& stream: streams)
+            {
+                ASSERT_TRUE(smalltime_merge_add_array(merge, stream.data(), stream.size()));
+            }
+            ASSERT_EQ(expected_merge(streams), drain(merge, capacity));
+            smalltime_merge_free(merge);
+        }
+    }
+}
+
+TEST(Merge, bursts)
+{
+    // Runs that are copied without replaying the tree, read in small
+    // batches so that runs cross batches.
+    smalltime_streams streams = smalltime_logs(5, 5000, 50, 1);
+    std::vector<batch_source> sources;
+    for(size_t i = 0; i < streams.size(); i++)
+    {
+        sources.push_back(batch_source{&streams[i], 0, std::mt19937_64(i)});
+    }
+    smalltime_merge* merge = smalltime_merge_new();
+    for(auto& source: sources)
+    {
+        ASSERT_TRUE(smalltime_merge_add_source(merge, batch_source::next, &source));
+    }
+    ASSERT_EQ(expected_merge(streams), drain(merge, 100));
+    smalltime_merge_free(merge);
+}
+
+TEST(Merge, ties)
+{
+    // Equal values come out in stream order, including the largest value,
+    // and streams that are empty or end early don't get in the way.
+    smalltime largest = INT64_MAX;
+    smalltime_streams streams = {
+        {1, 1, 2, largest},
+        {},
+        {1, 2, 2, largest, largest},
+        {1},
+        {largest},
+    };
+    smalltime_merge* merge = smalltime_merge_new();
+    for(const auto& stream: streams)
+    {
+        ASSERT_TRUE(smalltime_merge_add_array(merge, stream.data(), stream.size()));
+    }
+    ASSERT_EQ(expected_merge(streams), drain(merge, 3));
+    smalltime_merge_free(merge);
+}
+
+TEST(Merge, negative_smalltime)
+{
+    smalltime_streams streams = {
+        {smalltime_new(-100, 1, 1, 0, 0, 0, 0), smalltime_new(2000, 1, 1, 0, 0, 0, 0)},
+        {smalltime_new(-5, 6, 1, 0, 0, 0, 0), smalltime_new(0, 1, 1, 0, 0, 0, 0)},
+    };
+    smalltime_merge* merge = smalltime_merge_new();
+    for(const auto& stream: streams)
+    {
+        ASSERT_TRUE(smalltime_merge_add_array(merge, stream.data(), stream.size()));
+    }
+    ASSERT_EQ(expected_merge(streams), drain(merge, 10));
+    smalltime_merge_free(merge);
+}
+
+TEST(Merge, no_streams)
+{
+    smalltime_merge* merge = smalltime_merge_new();
+    smalltime value;
+    ASSERT_EQ(0u, smalltime_merge_next(merge, &value, nullptr, 1));
+    smalltime_merge_free(merge);
+}
+
+TEST(Merge, add_after_start)
+{
+    smalltime value = 1;
+    smalltime_merge* merge = smalltime_merge_new();
+    ASSERT_TRUE(smalltime_merge_add_array(merge, &value, 1));
+    smalltime result;
+    ASSERT_EQ(1u, smalltime_merge_next(merge, &result, nullptr, 1));
+    ASSERT_FALSE(smalltime_merge_add_array(merge, &value, 1));
+    smalltime_merge_free(merge);
+}
+
+TEST(Merge, columns)
+{
+    smalltime_streams streams = smalltime_logs(3, 10000, 10, 2);
+    std::vector<smalltime_column*> columns;
+    smalltime_merge* merge = smalltime_merge_new();
+    for(size_t i = 0; i < streams.size(); i++)
+    {
+        std::string path = ::testing::TempDir() + "smalltime_merge_" + std::to_string(i);
+        smalltime_column_writer* writer = smalltime_column_writer_open(path.c_str(), 0);
+        ASSERT_NE(nullptr, writer);
+        ASSERT_TRUE(smalltime_column_writer_append(writer, streams[i].data(), streams[i].size()));
+        ASSERT_TRUE(smalltime_column_writer_close(writer));
+        columns.push_back(smalltime_column_open(path.c_str()));
+        ASSERT_NE(nullptr, columns.back());
+        ASSERT_TRUE(smalltime_merge_add_column(merge, columns.back()));
+        std::remove(path.c_str());
+    }
+    ASSERT_EQ(expected_merge(streams), drain(merge, SMALLTIME_MERGE_BATCH_LENGTH));
+    smalltime_merge_free(merge);
+    for(auto column: columns)
+    {
+        smalltime_column_close(column);
+    }
+}
+
+TEST(Merge, nanotime)
+{
+    // Unsigned, so values with the top bit set come last.
+    std::mt19937_64 rng(3);
+    std::vector<std::vector<nanotime>> streams(4);
+    for(auto& stream: streams)
+    {
+        for(int i = 0; i < 1000; i++)
+        {
+            stream.push_back(rng() | (rng() % 2 == 0 ? 0x8000000000000000ULL : 0));
+        }
+        std::sort(stream.begin(), stream.end());
+    }
+    nanotime_merge* merge = nanotime_merge_new();
+    for(const auto& stream: streams)
+    {
+        ASSERT_TRUE(nanotime_merge_add_array(merge, stream.data(), stream.size()));
+    }
+    std::vector<nanotime> values(4000);
+    std::vector<uint32_t> stream_numbers(4000);
+    ASSERT_EQ(4000u, nanotime_merge_next(merge, values.data(), stream_numbers.data(), 4001));
+    auto expected = expected_merge(streams);
+    for(size_t i = 0; i < expected.size(); i++)
+    {
+        ASSERT_EQ(expected[i].first, values[i]);
+        ASSERT_EQ(expected[i].second, stream_numbers[i]);
+    }
+    nanotime_merge_free(merge);
+}
+
+TEST(Merge, parallel_arrays)
+{
+    // Enough values for several threads, with bursts and duplicates.
+    smalltime_streams streams = smalltime_logs(50, 100000, 5, 4);
+    streams.push_back(streams[7]);
+    streams.emplace_back();
+    std::vector<const smalltime*> arrays;
+    std::vector<size_t> counts;
+    size_t total = 0;
+    for(const auto& stream: streams)
+    {
+        arrays.push_back(stream.data());
+        counts.push_back(stream.size());
+        total += stream.size();
+    }
+    auto expected = expected_merge(streams);
+    for(unsigned threads: {0, 1, 2, 3, 100})
+    {
+        SCOPED_TRACE(threads);
+        std::vector<smalltime> values(total);
+        std::vector<uint32_t> stream_numbers(total);
+        ASSERT_TRUE(smalltime_merge_arrays(arrays.data(), counts.data(), arrays.size(),
+                                           values.data(), stream_numbers.data(), threads));
+        for(size_t i = 0; i < total; i++)
+        {
+            ASSERT_EQ(expected[i].first, values[i]);
+            ASSERT_EQ(expected[i].second, stream_numbers[i]);
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <smalltime/packed_time.h>
+#include <random>
+#include <vector>
+
+using namespace smalltime_cpp;
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Everything is usable in constant expressions.
+static_assert(packed_smalltime(2018, 3, 14, 15, 9, 26, 535897).bits() ==
+              ((2018LL << 46) | (3LL << 42) | (14LL << 37) | (15LL << 32) | (9LL << 26) | (26LL << 20) | 535897), "");
+static_assert(packed_smalltime(-5000, 2, 28).year() == -5000, "");
+static_assert(packed_nanotime(2225, 12, 31, 23, 59, 60, 999999999).second() == 60, "");
+static_assert(packed_second32(2033, 12, 31, 23, 59, 59).with_month(6).month() == 6, "");
+static_assert(packed_smalltime::year_shift == 46 && packed_smalltime::second_shift == 20, "");
+static_assert(packed_nanotime::year_shift == 56 && packed_nanotime::second_shift == 30, "");
+static_assert(packed_smalltime::min_year == -131072 && packed_smalltime::max_year == 131071, "");
+static_assert(packed_nanotime::min_year == 1970 && packed_nanotime::max_year == 2225, "");
+static_assert(packed_second32::min_year == 1970 && packed_second32::max_year == 2033, "");
+static_assert(sizeof(packed_second32) == 4, "");
+static_assert(packed_second32(2000, 1, 1) < packed_second32(2000, 1, 1, 0, 0, 1), "");
+
+struct random_fields
+{
+    int year, month, day, hour, minute, second, fraction;
+};
+
+template<typename TIME>
+static std::vector<random_fields> make_random_fields(size_t count)
+{
+    std::mt19937 random(21);
+    std::uniform_int_distribution<int> years(TIME::min_year, TIME::max_year);
+    std::uniform_int_distribution<int> fractions(0, TIME::layout::fractions_per_second - 1);
+    std::vector<random_fields> fields(count);
+    for(auto& f: fields)
+    {
+        f = {years(random), (int)(random() % 12) + 1, (int)(random() % 31) + 1,
+             (int)(random() % 24), (int)(random() % 60), (int)(random() % 61), fractions(random)};
+    }
+    return fields;
+}
+
+template<typename TIME>
+static void check_batches(size_t count)
+{
+    std::vector<random_fields> fields = make_random_fields<TIME>(count);
+    std::vector<TIME> values;
+    for(const auto& f: fields)
+    {
+        values.emplace_back(f.year, f.month, f.day, f.hour, f.minute, f.second, f.fraction);
+    }
+
+    std::vector<int> columns[7];
+    for(auto& column: columns)
+    {
+        column.assign(count, -1);
+    }
+    packed_columns packed = {columns[0].data(), columns[1].data(), columns[2].data(), columns[3].data(),
+                             columns[4].data(), columns[5].data(), columns[6].data()};
+    batch_decode(values.data(), count, packed);
+    for(size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(values[i].year(), columns[0][i]) << i;
+        ASSERT_EQ(values[i].month(), columns[1][i]) << i;
+        ASSERT_EQ(values[i].day(), columns[2][i]) << i;
+        ASSERT_EQ(values[i].hour(), columns[3][i]) << i;
+        ASSERT_EQ(values[i].minute(), columns[4][i]) << i;
+        ASSERT_EQ(values[i].second(), columns[5][i]) << i;
+        ASSERT_EQ(values[i].fraction(), columns[6][i]) << i;
+    }
+
+    std::vector<TIME> encoded(count);
+    batch_encode(packed, count, encoded.data());
+    ASSERT_EQ(values, encoded);
+
+    std::vector<int> weekday(count);
+    std::vector<int> iso_week_year(count);
+    smalltime_calendar_columns calendar = {weekday.data(), nullptr, nullptr, iso_week_year.data()};
+    batch_calendar(values.data(), count, calendar);
+    for(size_t i = 0; i < count; i++)
+    {
+        int year = values[i].year();
+        int day_of_year = smalltime_calendar_day_of_year(year, values[i].month(), values[i].day());
+        int expected_weekday = smalltime_calendar_weekday(year, day_of_year);
+        int expected_week_year;
+        smalltime_calendar_iso_week(year, day_of_year, expected_weekday, &expected_week_year);
+        ASSERT_EQ(expected_weekday, weekday[i]) << i;
+        ASSERT_EQ(expected_week_year, iso_week_year[i]) << i;
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(PackedTime, smalltime_matches_c_functions)
+{
+    for(const auto& f: make_random_fields<packed_smalltime>(100000))
+    {
+        smalltime c = smalltime_new(f.year, f.month, f.day, f.hour, f.minute, f.second, f.fraction);
+        packed_smalltime t(f.year, f.month, f.day, f.hour, f.minute, f.second, f.fraction);
+        ASSERT_EQ(c, t.bits());
+        ASSERT_EQ(smalltime_get_year(c), t.year());
+        ASSERT_EQ(smalltime_get_month(c), t.month());
+        ASSERT_EQ(smalltime_get_day(c), t.day());
+        ASSERT_EQ(smalltime_get_hour(c), t.hour());
+        ASSERT_EQ(smalltime_get_minute(c), t.minute());
+        ASSERT_EQ(smalltime_get_second(c), t.second());
+        ASSERT_EQ(smalltime_get_microsecond(c), t.fraction());
+        ASSERT_EQ(smalltime_with_year(c, -f.year / 2), t.with_year(-f.year / 2).bits());
+        ASSERT_EQ(smalltime_with_day(c, 13), t.with_day(13).bits());
+        ASSERT_EQ(smalltime_with_microsecond(c, 7), t.with_fraction(7).bits());
+    }
+}
+
+TEST(PackedTime, nanotime_matches_c_functions)
+{
+    for(const auto& f: make_random_fields<packed_nanotime>(100000))
+    {
+        nanotime c = nanotime_new(f.year, f.month, f.day, f.hour, f.minute, f.second, f.fraction);
+        packed_nanotime t(f.year, f.month, f.day, f.hour, f.minute, f.second, f.fraction);
+        ASSERT_EQ(c, t.bits());
+        ASSERT_EQ(nanotime_get_year(c), t.year());
+        ASSERT_EQ(nanotime_get_month(c), t.month());
+        ASSERT_EQ(nanotime_get_day(c), t.day());
+        ASSERT_EQ(nanotime_get_hour(c), t.hour());
+        ASSERT_EQ(nanotime_get_minute(c), t.minute());
+        ASSERT_EQ(nanotime_get_second(c), t.second());
+        ASSERT_EQ(nanotime_get_nanosecond(c), t.fraction());
+        ASSERT_EQ(nanotime_with_year(c, 2000), t.with_year(2000).bits());
+        ASSERT_EQ(nanotime_with_hour(c, 5), t.with_hour(5).bits());
+        ASSERT_EQ(nanotime_with_nanosecond(c, 7), t.with_fraction(7).bits());
+    }
+}
+
+TEST(PackedTime, second32_fields)
+{
+    packed_second32 time(2033, 12, 31, 23, 59, 60);
+    EXPECT_EQ(2033, time.year());
+    EXPECT_EQ(12, time.month());
+    EXPECT_EQ(31, time.day());
+    EXPECT_EQ(23, time.hour());
+    EXPECT_EQ(59, time.minute());
+    EXPECT_EQ(60, time.second());
+    EXPECT_EQ(0, time.fraction());
+    EXPECT_EQ(time, time.with_fraction(123));
+    EXPECT_EQ(1970, time.with_year(1970).year());
+    EXPECT_EQ(0u, packed_second32(1970, 0, 0).bits());
+}
+
+TEST(PackedTime, ordering)
+{
+    EXPECT_LT(packed_smalltime(-1, 12, 31, 23, 59, 59, 999999), packed_smalltime(0, 1, 1));
+    EXPECT_LT(packed_nanotime(2100, 1, 1), packed_nanotime(2100, 1, 1, 0, 0, 0, 1));
+    EXPECT_GT(packed_second32(2020, 2, 1), packed_second32(2020, 1, 31, 23, 59, 59));
+}
+
+TEST(PackedTime, batches)
+{
+    check_batches<packed_smalltime>(1001);
+    check_batches<packed_nanotime>(1001);
+    check_batches<packed_second32>(1001);
+}
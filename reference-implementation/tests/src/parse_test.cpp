@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <smalltime/parse.h>
+#include <smalltime/format.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <random>
+#include <string>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static smalltime parse_smalltime(const std::string& text, smalltime_parse_rounding rounding = SMALLTIME_PARSE_TRUNCATE)
+{
+    smalltime value = 0;
+    EXPECT_EQ(text.size(), smalltime_parse_iso8601(text.data(), text.size(), rounding, &value)) << text;
+    return value;
+}
+
+static nanotime parse_nanotime(const std::string& text, smalltime_parse_rounding rounding = SMALLTIME_PARSE_TRUNCATE)
+{
+    nanotime value = 0;
+    EXPECT_EQ(text.size(), nanotime_parse_iso8601(text.data(), text.size(), rounding, &value)) << text;
+    return value;
+}
+
+// Offset of the first error, or the length if the text is valid.
+static size_t smalltime_error_offset(const std::string& text)
+{
+    smalltime value;
+    size_t end_offset = 0;
+    smalltime_batch_parse_iso8601(text.data(), text.size(), '\n', SMALLTIME_PARSE_TRUNCATE, &value, 1, &end_offset);
+    return end_offset;
+}
+
+static size_t nanotime_error_offset(const std::string& text)
+{
+    nanotime value;
+    size_t end_offset = 0;
+    nanotime_batch_parse_iso8601(text.data(), text.size(), '\n', SMALLTIME_PARSE_TRUNCATE, &value, 1, &end_offset);
+    return end_offset;
+}
+
+static std::vector<smalltime> random_smalltimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(smalltime_to_unix_seconds(smalltime_new(-131072, 1, 1, 0, 0, 0, 0)),
+                                                    smalltime_to_unix_seconds(smalltime_new(131071, 12, 31, 23, 59, 59, 0)));
+    std::vector<smalltime> values(count);
+    for(auto& value: values)
+    {
+        value = smalltime_from_unix_seconds(anywhere(rng)) | (smalltime)(rng() % 1000000);
+    }
+    return values;
+}
+
+static std::vector<nanotime> random_nanotimes(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> anywhere(0, nanotime_to_unix_seconds(nanotime_new(2225, 12, 31, 23, 59, 59, 0)));
+    std::vector<nanotime> values(count);
+    for(auto& value: values)
+    {
+        value = nanotime_from_unix_seconds(anywhere(rng)) | (rng() % 1000000000);
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Parse, examples)
+{
+    for_each_isa([&]
+    {
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 8, 22, 16, 900142), parse_smalltime("1985-10-26T08:22:16.900142Z"));
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 8, 22, 16, 0), parse_smalltime("1985-10-26t08:22:16z"));
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 8, 22, 16, 900000), parse_smalltime("1985-10-26 08:22:16,9Z"));
+        EXPECT_EQ(smalltime_new(2016, 12, 31, 23, 59, 60, 500000), parse_smalltime("2016-12-31T23:59:60.5Z"));
+        EXPECT_EQ(smalltime_new(2000, 2, 29, 0, 0, 0, 0), parse_smalltime("2000-02-29T00:00:00Z"));
+        EXPECT_EQ(smalltime_new(-1, 1, 1, 0, 0, 0, 0), parse_smalltime("-000001-01-01T00:00:00.000000Z"));
+        EXPECT_EQ(smalltime_new(-131072, 1, 1, 0, 0, 0, 0), parse_smalltime("-131072-01-01T00:00:00Z"));
+        EXPECT_EQ(smalltime_new(131071, 12, 31, 23, 59, 59, 999999), parse_smalltime("+131071-12-31T23:59:59.999999Z"));
+        EXPECT_EQ(smalltime_new(2020, 1, 1, 0, 0, 0, 0), parse_smalltime("+002020-01-01T00:00:00Z"));
+        EXPECT_EQ(nanotime_new(1970, 1, 1, 0, 0, 0, 0), parse_nanotime("1970-01-01T00:00:00Z"));
+        EXPECT_EQ(nanotime_new(2225, 12, 31, 23, 59, 60, 999999999), parse_nanotime("2225-12-31T23:59:60.999999999Z"));
+        EXPECT_EQ(nanotime_new(2001, 9, 9, 1, 46, 40, 123456000), parse_nanotime("2001-09-09T01:46:40.123456Z"));
+    });
+}
+
+TEST(Parse, precision)
+{
+    for_each_isa([&]
+    {
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 123456), parse_smalltime("2000-01-01T00:00:00.1234565Z"));
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 123457), parse_smalltime("2000-01-01T00:00:00.1234565Z", SMALLTIME_PARSE_ROUND));
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 123456), parse_smalltime("2000-01-01T00:00:00.1234564999Z", SMALLTIME_PARSE_ROUND));
+        EXPECT_EQ(nanotime_new(2000, 1, 1, 0, 0, 0, 123456789), parse_nanotime("2000-01-01T00:00:00.12345678949999999999Z"));
+        EXPECT_EQ(nanotime_new(2000, 1, 1, 0, 0, 0, 123456790), parse_nanotime("2000-01-01T00:00:00.1234567895Z", SMALLTIME_PARSE_ROUND));
+
+        // Rounding up can carry all the way into the next year.
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 0), parse_smalltime("1999-12-31T23:59:59.9999995Z", SMALLTIME_PARSE_ROUND));
+        EXPECT_EQ(nanotime_new(2000, 1, 1, 0, 0, 0, 0), parse_nanotime("1999-12-31T23:59:59.9999999995Z", SMALLTIME_PARSE_ROUND));
+        // Including out of a leap second.
+        EXPECT_EQ(smalltime_new(2017, 1, 1, 0, 0, 0, 0), parse_smalltime("2016-12-31T23:59:60.9999999Z", SMALLTIME_PARSE_ROUND));
+        EXPECT_EQ(smalltime_new(2016, 12, 31, 23, 59, 60, 999999), parse_smalltime("2016-12-31T23:59:60.9999999Z"));
+    });
+}
+
+TEST(Parse, offsets)
+{
+    for_each_isa([&]
+    {
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 6, 22, 16, 0), parse_smalltime("1985-10-26T08:22:16+02:00"));
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 13, 52, 16, 0), parse_smalltime("1985-10-26T08:22:16-05:30"));
+        EXPECT_EQ(smalltime_new(1985, 10, 26, 8, 22, 16, 0), parse_smalltime("1985-10-26T08:22:16-00:00"));
+        EXPECT_EQ(smalltime_new(1999, 12, 31, 23, 0, 0, 0), parse_smalltime("2000-01-01T00:00:00+01:00"));
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 59, 0, 0), parse_smalltime("1999-12-31T23:59:00-01:00"));
+        EXPECT_EQ(smalltime_new(2016, 12, 31, 23, 59, 60, 0), parse_smalltime("2017-01-01T08:59:60+09:00"));
+        EXPECT_EQ(smalltime_new(-131072, 1, 1, 0, 0, 0, 0), parse_smalltime("-131072-01-01T01:00:00+01:00"));
+        EXPECT_EQ(nanotime_new(1970, 1, 1, 0, 0, 0, 5), parse_nanotime("1970-01-01T05:00:00.000000005+05:00"));
+        EXPECT_EQ(nanotime_new(2225, 12, 31, 23, 59, 59, 0), parse_nanotime("2225-12-31T22:59:59-01:00"));
+
+        // Results that don't fit.
+        EXPECT_EQ(0u, smalltime_error_offset("-131072-01-01T00:59:59+01:00"));
+        EXPECT_EQ(0u, smalltime_error_offset("+131071-12-31T23:00:00-01:00"));
+        EXPECT_EQ(0u, nanotime_error_offset("1970-01-01T00:00:00+00:01"));
+        EXPECT_EQ(0u, nanotime_error_offset("2225-12-31T23:59:59.5-00:01"));
+    });
+}
+
+TEST(Parse, errors)
+{
+    for_each_isa([&]
+    {
+        // Syntax errors are reported at the first bad char.
+        EXPECT_EQ(0u, smalltime_error_offset("x985-10-26T08:22:16Z"));
+        EXPECT_EQ(4u, smalltime_error_offset("1985/10-26T08:22:16Z"));
+        EXPECT_EQ(6u, smalltime_error_offset("1985-1O-26T08:22:16Z"));
+        EXPECT_EQ(10u, smalltime_error_offset("1985-10-26_08:22:16Z"));
+        EXPECT_EQ(16u, smalltime_error_offset("1985-10-26T08:22.16Z"));
+        EXPECT_EQ(18u, smalltime_error_offset("1985-10-26T08:22:1Z"));
+        EXPECT_EQ(19u, smalltime_error_offset("1985-10-26T08:22:16"));
+        EXPECT_EQ(19u, smalltime_error_offset("1985-10-26T08:22:16X"));
+        EXPECT_EQ(20u, smalltime_error_offset("1985-10-26T08:22:16.Z"));
+        EXPECT_EQ(21u, smalltime_error_offset("1985-10-26T08:22:16.1"));
+        EXPECT_EQ(22u, smalltime_error_offset("1985-10-26T08:22:16+0200"));
+        EXPECT_EQ(21u, smalltime_error_offset("1985-10-26T08:22:16+0"));
+        EXPECT_EQ(11u, smalltime_error_offset("1985-10-26T"));
+        EXPECT_EQ(0u, smalltime_error_offset(""));
+        EXPECT_EQ(2u, smalltime_error_offset("+1"));
+        EXPECT_EQ(7u, smalltime_error_offset("+010000/01-01T00:00:00Z"));
+        EXPECT_EQ(0u, nanotime_error_offset("+001985-10-26T08:22:16Z"));
+
+        // Range errors are reported at the start of the field.
+        EXPECT_EQ(5u, smalltime_error_offset("1985-13-26T08:22:16Z"));
+        EXPECT_EQ(5u, smalltime_error_offset("1985-00-26T08:22:16Z"));
+        EXPECT_EQ(8u, smalltime_error_offset("1985-02-29T08:22:16Z"));
+        EXPECT_EQ(8u, smalltime_error_offset("1900-02-29T08:22:16Z"));
+        EXPECT_EQ(8u, smalltime_error_offset("1985-04-31T08:22:16Z"));
+        EXPECT_EQ(8u, smalltime_error_offset("1985-10-00T08:22:16Z"));
+        EXPECT_EQ(11u, smalltime_error_offset("1985-10-26T24:00:00Z"));
+        EXPECT_EQ(14u, smalltime_error_offset("1985-10-26T08:60:16Z"));
+        EXPECT_EQ(17u, smalltime_error_offset("1985-10-26T08:22:61Z"));
+        EXPECT_EQ(20u, smalltime_error_offset("1985-10-26T08:22:16+24:00"));
+        EXPECT_EQ(23u, smalltime_error_offset("1985-10-26T08:22:16+02:60"));
+        EXPECT_EQ(11u, smalltime_error_offset("-000100-02-29T08:22:16Z"));
+        EXPECT_EQ(0u, smalltime_error_offset("+131072-01-01T00:00:00Z"));
+        EXPECT_EQ(0u, smalltime_error_offset("-131073-01-01T00:00:00Z"));
+        EXPECT_EQ(0u, nanotime_error_offset("1969-12-31T23:59:59Z"));
+        EXPECT_EQ(0u, nanotime_error_offset("2226-01-01T00:00:00Z"));
+
+        // Nothing is stored on failure.
+        smalltime value = 1234;
+        EXPECT_EQ(0u, smalltime_parse_iso8601("1985-13-26T08:22:16Z", 20, SMALLTIME_PARSE_TRUNCATE, &value));
+        EXPECT_EQ(1234, value);
+    });
+}
+
+TEST(Parse, does_not_read_past_length)
+{
+    for_each_isa([&]
+    {
+        std::string text = "1985-10-26T08:22:16.123456789+02:00";
+        for(size_t length = 0; length <= text.size(); length++)
+        {
+            // Copied so that reading past the end is caught by sanitizers.
+            std::vector<char> truncated(text.begin(), text.begin() + (ptrdiff_t)length);
+            smalltime value;
+            size_t expected = length == text.size() ? length : 0;
+            EXPECT_EQ(expected, smalltime_parse_iso8601(truncated.data(), length, SMALLTIME_PARSE_TRUNCATE, &value)) << length;
+            EXPECT_EQ(length, smalltime_error_offset(std::string(text, 0, length)));
+        }
+    });
+}
+
+TEST(Parse, round_trips_format)
+{
+    for_each_isa([&]
+    {
+        for(smalltime value: random_smalltimes(20000, 1))
+        {
+            char buffer[SMALLTIME_ISO8601_MAX_LENGTH + 1];
+            size_t length = smalltime_format_iso8601(value, buffer);
+            smalltime parsed = 0;
+            ASSERT_EQ(length, smalltime_parse_iso8601(buffer, length, SMALLTIME_PARSE_TRUNCATE, &parsed)) << buffer;
+            ASSERT_EQ(value, parsed) << buffer;
+        }
+        for(nanotime value: random_nanotimes(20000, 2))
+        {
+            char buffer[NANOTIME_ISO8601_LENGTH + 1];
+            size_t length = nanotime_format_iso8601(value, buffer);
+            nanotime parsed = 0;
+            ASSERT_EQ(length, nanotime_parse_iso8601(buffer, length, SMALLTIME_PARSE_TRUNCATE, &parsed)) << buffer;
+            ASSERT_EQ(value, parsed) << buffer;
+        }
+    });
+}
+
+TEST(Parse, corrupted_input_is_consistent)
+{
+    // Every instruction set level finds the same values and error offsets.
+    std::mt19937_64 rng(3);
+    const char replacements[] = "0123456789-:T.Z+ x";
+    for(nanotime value: random_nanotimes(5000, 4))
+    {
+        char buffer[NANOTIME_ISO8601_LENGTH + 1];
+        size_t length = nanotime_format_iso8601(value, buffer);
+        buffer[rng() % length] = replacements[rng() % (sizeof(replacements) - 1)];
+        std::vector<size_t> results;
+        for_each_isa([&]
+        {
+            smalltime smalltime_value = 0;
+            nanotime nanotime_value = 0;
+            size_t smalltime_end = 0, nanotime_end = 0;
+            results.push_back(smalltime_batch_parse_iso8601(buffer, length, '\n', SMALLTIME_PARSE_ROUND, &smalltime_value, 1, &smalltime_end));
+            results.push_back(smalltime_end);
+            results.push_back((size_t)smalltime_value);
+            results.push_back(nanotime_batch_parse_iso8601(buffer, length, '\n', SMALLTIME_PARSE_ROUND, &nanotime_value, 1, &nanotime_end));
+            results.push_back(nanotime_end);
+            results.push_back((size_t)nanotime_value);
+        });
+        for(size_t i = 6; i < results.size(); i++)
+        {
+            ASSERT_EQ(results[i % 6], results[i]) << buffer;
+        }
+    }
+}
+
+TEST(Parse, batch)
+{
+    for_each_isa([&]
+    {
+        std::vector<nanotime> expected = random_nanotimes(1000, 5);
+        std::vector<char> text(expected.size() * (NANOTIME_ISO8601_LENGTH + 1));
+        size_t length = nanotime_batch_format_iso8601(expected.data(), expected.size(), 0, text.data());
+        std::vector<nanotime> values(expected.size() + 1);
+        size_t end_offset = 0;
+
+        // With and without the trailing delimiter.
+        EXPECT_EQ(expected.size(), nanotime_batch_parse_iso8601(text.data(), length, '\n', SMALLTIME_PARSE_TRUNCATE, values.data(), values.size(), &end_offset));
+        EXPECT_EQ(length, end_offset);
+        EXPECT_EQ(expected, std::vector<nanotime>(values.begin(), values.end() - 1));
+        EXPECT_EQ(expected.size(), nanotime_batch_parse_iso8601(text.data(), length - 1, '\n', SMALLTIME_PARSE_TRUNCATE, values.data(), values.size(), &end_offset));
+        EXPECT_EQ(length - 1, end_offset);
+
+        // Stops when full, at the start of the next timestamp.
+        EXPECT_EQ(10u, nanotime_batch_parse_iso8601(text.data(), length, '\n', SMALLTIME_PARSE_TRUNCATE, values.data(), 10, &end_offset));
+        EXPECT_EQ(10u * (NANOTIME_ISO8601_LENGTH + 1), end_offset);
+
+        // Stops at the first error.
+        size_t bad = 500 * (NANOTIME_ISO8601_LENGTH + 1) + 14;
+        text[bad] = 'x';
+        EXPECT_EQ(500u, nanotime_batch_parse_iso8601(text.data(), length, '\n', SMALLTIME_PARSE_TRUNCATE, values.data(), values.size(), &end_offset));
+        EXPECT_EQ(bad, end_offset);
+
+        // Wrong delimiter.
+        EXPECT_EQ(1u, nanotime_batch_parse_iso8601(text.data(), length, ',', SMALLTIME_PARSE_TRUNCATE, values.data(), values.size(), nullptr));
+
+        std::string csv = "2000-01-01T00:00:00Z,-000001-01-01T00:00:00+01:00,2000-01-01T00:00:00.5Z,";
+        smalltime smalltimes[4];
+        EXPECT_EQ(3u, smalltime_batch_parse_iso8601(csv.data(), csv.size(), ',', SMALLTIME_PARSE_TRUNCATE, smalltimes, 4, &end_offset));
+        EXPECT_EQ(csv.size(), end_offset);
+        EXPECT_EQ(smalltime_new(-2, 12, 31, 23, 0, 0, 0), smalltimes[1]);
+        EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 0, 500000), smalltimes[2]);
+    });
+}
@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+#include <smalltime/range.h>
+#include "for_each_isa.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static std::vector<smalltime> all_of(smalltime start, smalltime end, smalltime_unit unit, int64_t step)
+{
+    smalltime_range range;
+    smalltime_range_init(&range, start, end, unit, step);
+    std::vector<smalltime> values;
+    smalltime value;
+    while(smalltime_range_next(&range, &value))
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+static std::vector<nanotime> all_of(nanotime start, nanotime end, smalltime_unit unit, int64_t step)
+{
+    nanotime_range range;
+    nanotime_range_init(&range, start, end, unit, step);
+    std::vector<nanotime> values;
+    nanotime value;
+    while(nanotime_range_next(&range, &value))
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+// The value steps after start, by way of the arith.h add functions.
+static smalltime reference_step(smalltime start, smalltime_unit unit, int64_t step, int64_t steps)
+{
+    int64_t amount = step * steps;
+    switch(unit)
+    {
+        case SMALLTIME_UNIT_YEAR:
+            return smalltime_add_months(start, amount * 12);
+        case SMALLTIME_UNIT_MONTH:
+            return smalltime_add_months(start, amount);
+        case SMALLTIME_UNIT_DAY:
+            return smalltime_add_days(start, amount);
+        case SMALLTIME_UNIT_HOUR:
+            return smalltime_add_seconds(start, amount * 3600);
+        case SMALLTIME_UNIT_MINUTE:
+            return smalltime_add_seconds(start, amount * 60);
+        case SMALLTIME_UNIT_SECOND:
+            return smalltime_add_seconds(start, amount);
+        case SMALLTIME_UNIT_MILLISECOND:
+            return smalltime_add_microseconds(start, amount * 1000);
+        default:
+            return smalltime_add_microseconds(start, amount);
+    }
+}
+
+static std::vector<smalltime> fill_all(smalltime start, smalltime end, smalltime_unit unit, int64_t step, size_t capacity)
+{
+    smalltime_range range;
+    smalltime_range_init(&range, start, end, unit, step);
+    std::vector<smalltime> values;
+    std::vector<smalltime> buffer(capacity);
+    size_t count;
+    do
+    {
+        count = smalltime_range_fill(&range, buffer.data(), capacity);
+        values.insert(values.end(), buffer.begin(), buffer.begin() + (long)count);
+    } while(count == capacity);
+    return values;
+}
+
+struct fill_case
+{
+    smalltime start;
+    smalltime end;
+    smalltime_unit unit;
+    int64_t step;
+};
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Range, every_15_minutes)
+{
+    std::vector<smalltime> expected =
+    {
+        smalltime_new(2018, 12, 31, 23, 10, 0, 0),
+        smalltime_new(2018, 12, 31, 23, 25, 0, 0),
+        smalltime_new(2018, 12, 31, 23, 40, 0, 0),
+        smalltime_new(2018, 12, 31, 23, 55, 0, 0),
+        smalltime_new(2019, 1, 1, 0, 10, 0, 0),
+        smalltime_new(2019, 1, 1, 0, 25, 0, 0),
+    };
+    ASSERT_EQ(expected, all_of(smalltime_new(2018, 12, 31, 23, 10, 0, 0), smalltime_new(2019, 1, 1, 0, 40, 0, 0), SMALLTIME_UNIT_MINUTE, 15));
+    ASSERT_EQ(std::vector<smalltime>{}, all_of(smalltime_new(2018, 1, 1, 0, 0, 0, 0), smalltime_new(2018, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MINUTE, 15));
+}
+
+TEST(Range, months_keep_day)
+{
+    std::vector<smalltime> expected =
+    {
+        smalltime_new(2019, 12, 31, 8, 0, 0, 0),
+        smalltime_new(2020, 1, 31, 8, 0, 0, 0),
+        smalltime_new(2020, 2, 29, 8, 0, 0, 0),
+        smalltime_new(2020, 3, 31, 8, 0, 0, 0),
+        smalltime_new(2020, 4, 30, 8, 0, 0, 0),
+    };
+    ASSERT_EQ(expected, all_of(smalltime_new(2019, 12, 31, 8, 0, 0, 0), smalltime_new(2020, 5, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MONTH, 1));
+
+    expected =
+    {
+        smalltime_new(2016, 2, 29, 0, 0, 0, 0),
+        smalltime_new(2018, 2, 28, 0, 0, 0, 0),
+        smalltime_new(2020, 2, 29, 0, 0, 0, 0),
+    };
+    ASSERT_EQ(expected, all_of(smalltime_new(2016, 2, 29, 0, 0, 0, 0), smalltime_new(2021, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_YEAR, 2));
+
+    expected =
+    {
+        smalltime_new(-2, 11, 1, 0, 0, 0, 0),
+        smalltime_new(-1, 6, 1, 0, 0, 0, 0),
+        smalltime_new(0, 1, 1, 0, 0, 0, 0),
+        smalltime_new(0, 8, 1, 0, 0, 0, 0),
+        smalltime_new(1, 3, 1, 0, 0, 0, 0),
+    };
+    ASSERT_EQ(expected, all_of(smalltime_new(-2, 11, 1, 0, 0, 0, 0), smalltime_new(1, 4, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MONTH, 7));
+}
+
+TEST(Range, leap_second)
+{
+    // Second 60 counts as second 0 of the next minute, as in arith.h.
+    std::vector<smalltime> expected =
+    {
+        smalltime_new(2016, 12, 31, 23, 59, 60, 500000),
+        smalltime_new(2017, 1, 1, 0, 0, 1, 500000),
+    };
+    ASSERT_EQ(expected, all_of(smalltime_new(2016, 12, 31, 23, 59, 60, 500000), smalltime_new(2017, 1, 1, 0, 0, 2, 0), SMALLTIME_UNIT_SECOND, 1));
+}
+
+TEST(Range, matches_arith)
+{
+    std::mt19937_64 rng(1);
+    static const int64_t max_steps[] = {3, 40, 70, 50, 200, 200, 5000, 5000000};
+    for(int i = 0; i < 2000; i++)
+    {
+        smalltime start = smalltime_new((int)(rng() % 4000) - 2000, 1 + (int)(rng() % 12), 1 + (int)(rng() % 28),
+                                        (int)(rng() % 24), (int)(rng() % 60), (int)(rng() % 60), (int)(rng() % 1000000));
+        smalltime_unit unit = (smalltime_unit)(rng() % 8);
+        int64_t step = 1 + (int64_t)(rng() % (uint64_t)max_steps[unit]);
+        smalltime_range range;
+        smalltime_range_init(&range, start, reference_step(start, unit, step, 100), unit, step);
+        for(int64_t j = 0; j < 100; j++)
+        {
+            smalltime value;
+            ASSERT_TRUE(smalltime_range_next(&range, &value));
+            ASSERT_EQ(reference_step(start, unit, step, j), value) << "unit " << unit << ", step " << step << ", index " << j;
+        }
+        smalltime value;
+        ASSERT_FALSE(smalltime_range_next(&range, &value));
+    }
+}
+
+TEST(Range, fill)
+{
+    std::vector<fill_case> cases =
+    {
+        {smalltime_new(2018, 2, 27, 22, 10, 0, 0), smalltime_new(2018, 3, 4, 1, 0, 0, 0), SMALLTIME_UNIT_MINUTE, 15},
+        {smalltime_new(2018, 2, 28, 0, 0, 0, 0), smalltime_new(2018, 3, 2, 0, 0, 0, 1), SMALLTIME_UNIT_MINUTE, 1},
+        {smalltime_new(2018, 12, 31, 23, 59, 59, 999000), smalltime_new(2019, 1, 1, 0, 0, 3, 2), SMALLTIME_UNIT_MILLISECOND, 1},
+        {smalltime_new(-1, 12, 31, 23, 0, 0, 0), smalltime_new(0, 1, 3, 0, 0, 0, 0), SMALLTIME_UNIT_SECOND, 7},
+        {smalltime_new(-1, 12, 31, 23, 0, 0, 0), smalltime_new(0, 1, 3, 0, 0, 0, 0), SMALLTIME_UNIT_SECOND, 10},
+        {smalltime_new(2018, 1, 1, 0, 0, 0, 0), smalltime_new(2018, 1, 1, 0, 0, 0, 999), SMALLTIME_UNIT_MICROSECOND, 1},
+        {smalltime_new(2018, 1, 1, 5, 0, 0, 0), smalltime_new(2018, 6, 1, 0, 0, 0, 0), SMALLTIME_UNIT_HOUR, 7},
+        {smalltime_new(2018, 1, 30, 0, 0, 0, 0), smalltime_new(2021, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_DAY, 3},
+        {smalltime_new(2018, 1, 3, 0, 0, 0, 0), smalltime_new(2030, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MONTH, 1},
+        {smalltime_new(2018, 1, 31, 0, 0, 0, 0), smalltime_new(2030, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MONTH, 5},
+        {smalltime_new(-20, 2, 29, 0, 0, 0, 0), smalltime_new(30, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_YEAR, 1},
+        {smalltime_new(-20, 3, 1, 0, 0, 0, 0), smalltime_new(30, 1, 1, 0, 0, 0, 0), SMALLTIME_UNIT_YEAR, 3},
+    };
+    for_each_isa([&]
+    {
+        for(const fill_case& c: cases)
+        {
+            std::vector<smalltime> expected = all_of(c.start, c.end, c.unit, c.step);
+            ASSERT_FALSE(expected.empty());
+            for(size_t capacity: {(size_t)1, (size_t)5, (size_t)97, (size_t)100000})
+            {
+                ASSERT_EQ(expected, fill_all(c.start, c.end, c.unit, c.step, capacity))
+                    << "unit " << c.unit << ", step " << c.step << ", capacity " << capacity;
+            }
+        }
+    });
+}
+
+TEST(Range, nanotime)
+{
+    nanotime start = nanotime_new(2018, 12, 31, 23, 59, 59, 999999000);
+    nanotime end = nanotime_new(2019, 1, 1, 0, 0, 1, 0);
+    std::vector<nanotime> expected;
+    for(nanotime value = start; value < end; value = nanotime_add_nanoseconds(value, 250))
+    {
+        expected.push_back(value);
+    }
+    nanotime_range range;
+    nanotime_range_init(&range, start, end, SMALLTIME_UNIT_MICROSECOND, 1);
+    ASSERT_EQ(start, range.next);
+
+    for_each_isa([&]
+    {
+        std::vector<nanotime> values(expected.size() / 4 + 10);
+        nanotime_range_init(&range, start, end, SMALLTIME_UNIT_MICROSECOND, 1);
+        ASSERT_EQ(expected.size() / 4, nanotime_range_fill(&range, values.data(), values.size()));
+        for(size_t i = 0; i < expected.size() / 4; i++)
+        {
+            ASSERT_EQ(expected[i * 4], values[i]);
+        }
+    });
+
+    std::vector<nanotime> months =
+    {
+        nanotime_new(2224, 10, 31, 0, 0, 0, 0),
+        nanotime_new(2224, 12, 31, 0, 0, 0, 0),
+        nanotime_new(2225, 2, 28, 0, 0, 0, 0),
+    };
+    ASSERT_EQ(months, all_of(months[0], nanotime_new(2225, 3, 1, 0, 0, 0, 0), SMALLTIME_UNIT_MONTH, 2));
+}
+
+#if __cplusplus >= 202002L
+#include <ranges>
+
+static_assert(std::ranges::forward_range<smalltime_cpp::smalltime_range_view>);
+static_assert(std::ranges::view<smalltime_cpp::nanotime_range_view>);
+
+TEST(Range, view)
+{
+    smalltime_cpp::smalltime_range_view days(smalltime_new(2018, 2, 27, 12, 0, 0, 0), smalltime_new(2018, 3, 3, 0, 0, 0, 0),
+                                             SMALLTIME_UNIT_DAY, 1);
+    std::vector<int> day_numbers;
+    for(smalltime day: days)
+    {
+        day_numbers.push_back(smalltime_get_day(day));
+    }
+    ASSERT_EQ((std::vector<int>{27, 28, 1, 2}), day_numbers);
+
+    auto hours = days | std::views::transform(smalltime_get_hour) | std::views::take(2);
+    ASSERT_EQ(2, std::ranges::distance(hours));
+    ASSERT_EQ(12, *hours.begin());
+    ASSERT_TRUE(std::ranges::empty(smalltime_cpp::nanotime_range_view()));
+}
+#endif
@@ -0,0 +1,332 @@
+#include <gtest/gtest.h>
+#include <smalltime/rollup.h>
+#include <smalltime/epoch.h>
+#include "for_each_isa.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+#define EXPECT_TRUNCATED(UNIT, WIDTH, EXPECTED, TIME) \
+    EXPECT_EQ(EXPECTED, smalltime_truncate_to_multiple(TIME, UNIT, WIDTH))
+
+#define EXPECT_NANOTIME_TRUNCATED(UNIT, WIDTH, EXPECTED, TIME) \
+    EXPECT_EQ(EXPECTED, nanotime_truncate_to_multiple(TIME, UNIT, WIDTH))
+
+// Sorted events over about a day, in bursts of up to 100 at the same
+// time. Values are whole numbers, so that their sums are exact.
+static void make_events(size_t count, uint64_t seed, std::vector<smalltime>& times, std::vector<double>& values)
+{
+    std::mt19937_64 rng(seed);
+    int64_t current = 1500000000LL * 1000000;
+    while(times.size() < count)
+    {
+        current += (int64_t)(rng() % 40000000);
+        size_t burst = 1 + rng() % 100;
+        for(size_t i = 0; i < burst && times.size() < count; i++)
+        {
+            times.push_back(smalltime_from_unix_microseconds(current + (int64_t)i));
+            values.push_back((double)((int64_t)(rng() % 2001) - 1000));
+        }
+    }
+}
+
+static std::vector<smalltime_group> expected_groups(const std::vector<smalltime>& times, const std::vector<double>& values,
+                                                    smalltime_unit unit, int width)
+{
+    std::map<smalltime, smalltime_group> groups;
+    for(size_t i = 0; i < times.size(); i++)
+    {
+        smalltime bucket = smalltime_truncate_to_multiple(times[i], unit, width);
+        auto found = groups.find(bucket);
+        if(found == groups.end())
+        {
+            found = groups.emplace(bucket, smalltime_group{bucket, 0, 0, INFINITY, -INFINITY}).first;
+        }
+        smalltime_group& group = found->second;
+        group.count++;
+        group.sum += values[i];
+        group.min = std::min(group.min, values[i]);
+        group.max = std::max(group.max, values[i]);
+    }
+    std::vector<smalltime_group> result;
+    for(const auto& entry: groups)
+    {
+        result.push_back(entry.second);
+    }
+    return result;
+}
+
+static std::vector<smalltime_group> rollup_groups(smalltime_rollup* rollup)
+{
+    std::vector<smalltime_group> groups(smalltime_rollup_groups(rollup, nullptr, 0));
+    EXPECT_EQ(groups.size(), smalltime_rollup_groups(rollup, groups.data(), groups.size()));
+    return groups;
+}
+
+// Adds the values in batches of batch_length.
+static std::vector<smalltime_group> roll_up(const std::vector<smalltime>& times, const std::vector<double>& values,
+                                            smalltime_unit unit, int width, size_t batch_length)
+{
+    smalltime_rollup* rollup = smalltime_rollup_new(unit, width);
+    for(size_t i = 0; i < times.size(); i += batch_length)
+    {
+        size_t count = std::min(batch_length, times.size() - i);
+        EXPECT_TRUE(smalltime_rollup_add(rollup, times.data() + i, values.data() + i, count));
+    }
+    std::vector<smalltime_group> groups = rollup_groups(rollup);
+    smalltime_rollup_free(rollup);
+    return groups;
+}
+
+static void expect_groups(const std::vector<smalltime_group>& expected, const std::vector<smalltime_group>& actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for(size_t i = 0; i < expected.size(); i++)
+    {
+        ASSERT_EQ(expected[i].bucket, actual[i].bucket) << "at " << i;
+        ASSERT_EQ(expected[i].count, actual[i].count) << "at " << i;
+        ASSERT_EQ(expected[i].sum, actual[i].sum) << "at " << i;
+        ASSERT_EQ(expected[i].min, actual[i].min) << "at " << i;
+        ASSERT_EQ(expected[i].max, actual[i].max) << "at " << i;
+    }
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Rollup, truncate_to)
+{
+    smalltime time = smalltime_new(2018, 7, 19, 13, 45, 27, 123456);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_YEAR, 1, smalltime_new(2018, 1, 1, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MONTH, 1, smalltime_new(2018, 7, 1, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_DAY, 1, smalltime_new(2018, 7, 19, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_HOUR, 1, smalltime_new(2018, 7, 19, 13, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MINUTE, 1, smalltime_new(2018, 7, 19, 13, 45, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 1, smalltime_new(2018, 7, 19, 13, 45, 27, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MILLISECOND, 1, smalltime_new(2018, 7, 19, 13, 45, 27, 123000), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MICROSECOND, 1, time, time);
+    EXPECT_EQ(smalltime_new(-44, 3, 1, 0, 0, 0, 0), smalltime_truncate_to(smalltime_new(-44, 3, 15, 12, 0, 0, 0), SMALLTIME_UNIT_MONTH));
+
+    nanotime nano = nanotime_new(2018, 7, 19, 13, 45, 27, 123456789);
+    EXPECT_EQ(nanotime_new(2018, 1, 1, 0, 0, 0, 0), nanotime_truncate_to(nano, SMALLTIME_UNIT_YEAR));
+    EXPECT_EQ(nanotime_new(2018, 7, 1, 0, 0, 0, 0), nanotime_truncate_to(nano, SMALLTIME_UNIT_MONTH));
+    EXPECT_EQ(nanotime_new(2018, 7, 19, 13, 45, 0, 0), nanotime_truncate_to(nano, SMALLTIME_UNIT_MINUTE));
+    EXPECT_EQ(nanotime_new(2018, 7, 19, 13, 45, 27, 123000000), nanotime_truncate_to(nano, SMALLTIME_UNIT_MILLISECOND));
+    EXPECT_EQ(nanotime_new(2018, 7, 19, 13, 45, 27, 123456000), nanotime_truncate_to(nano, SMALLTIME_UNIT_MICROSECOND));
+}
+
+TEST(Rollup, truncate_to_multiple)
+{
+    smalltime time = smalltime_new(2018, 8, 31, 23, 59, 58, 999999);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_YEAR, 10, smalltime_new(2010, 1, 1, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MONTH, 3, smalltime_new(2018, 7, 1, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_DAY, 10, smalltime_new(2018, 8, 31, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_DAY, 7, smalltime_new(2018, 8, 29, 0, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_HOUR, 6, smalltime_new(2018, 8, 31, 18, 0, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MINUTE, 15, smalltime_new(2018, 8, 31, 23, 45, 0, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 7, smalltime_new(2018, 8, 31, 23, 59, 56, 0), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MILLISECOND, 250, smalltime_new(2018, 8, 31, 23, 59, 58, 750000), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_MICROSECOND, 100, smalltime_new(2018, 8, 31, 23, 59, 58, 999900), time);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_HOUR, 0, smalltime_new(2018, 8, 31, 23, 0, 0, 0), time);
+    // Years before 0 round down too.
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_YEAR, 10, smalltime_new(-10, 1, 1, 0, 0, 0, 0), smalltime_new(-5, 6, 1, 0, 0, 0, 0));
+
+    nanotime nano = nanotime_new(2018, 8, 31, 23, 59, 58, 999999999);
+    EXPECT_NANOTIME_TRUNCATED(SMALLTIME_UNIT_YEAR, 100, nanotime_new(2000, 1, 1, 0, 0, 0, 0), nano);
+    EXPECT_NANOTIME_TRUNCATED(SMALLTIME_UNIT_HOUR, 6, nanotime_new(2018, 8, 31, 18, 0, 0, 0), nano);
+    EXPECT_NANOTIME_TRUNCATED(SMALLTIME_UNIT_MILLISECOND, 100, nanotime_new(2018, 8, 31, 23, 59, 58, 900000000), nano);
+    EXPECT_NANOTIME_TRUNCATED(SMALLTIME_UNIT_MICROSECOND, 500, nanotime_new(2018, 8, 31, 23, 59, 58, 999500000), nano);
+
+    // A leap second is in the minute's last bucket.
+    smalltime leap = smalltime_new(2016, 12, 31, 23, 59, 60, 500000);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 15, smalltime_new(2016, 12, 31, 23, 59, 45, 0), leap);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 30, smalltime_new(2016, 12, 31, 23, 59, 30, 0), leap);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 60, smalltime_new(2016, 12, 31, 23, 59, 0, 0), leap);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 7, smalltime_new(2016, 12, 31, 23, 59, 56, 0), leap);
+    EXPECT_TRUNCATED(SMALLTIME_UNIT_SECOND, 1, smalltime_new(2016, 12, 31, 23, 59, 60, 0), leap);
+    EXPECT_NANOTIME_TRUNCATED(SMALLTIME_UNIT_SECOND, 15, nanotime_new(2016, 12, 31, 23, 59, 45, 0), nanotime_new(2016, 12, 31, 23, 59, 60, 1));
+}
+
+TEST(Rollup, sorted)
+{
+    std::vector<smalltime> times;
+    std::vector<double> values;
+    make_events(100000, 1, times, values);
+    for_each_isa([&]
+    {
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_MINUTE, 15),
+                      roll_up(times, values, SMALLTIME_UNIT_MINUTE, 15, times.size()));
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_HOUR, 6),
+                      roll_up(times, values, SMALLTIME_UNIT_HOUR, 6, 1000));
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_SECOND, 1),
+                      roll_up(times, values, SMALLTIME_UNIT_SECOND, 1, 777));
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_MILLISECOND, 20),
+                      roll_up(times, values, SMALLTIME_UNIT_MILLISECOND, 20, times.size()));
+    });
+}
+
+TEST(Rollup, unsorted)
+{
+    std::vector<smalltime> times;
+    std::vector<double> values;
+    make_events(50000, 2, times, values);
+    // Shuffle whole bursts, then some single values, so there are runs of
+    // every length.
+    std::mt19937_64 rng(3);
+    for(size_t i = 0; i + 200 < times.size(); i += 200)
+    {
+        size_t other = rng() % (times.size() - 100);
+        std::swap_ranges(times.begin() + (long)i, times.begin() + (long)i + 100, times.begin() + (long)other);
+        std::swap_ranges(values.begin() + (long)i, values.begin() + (long)i + 100, values.begin() + (long)other);
+        size_t a = rng() % times.size();
+        size_t b = rng() % times.size();
+        std::swap(times[a], times[b]);
+        std::swap(values[a], values[b]);
+    }
+    for_each_isa([&]
+    {
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_MINUTE, 1),
+                      roll_up(times, values, SMALLTIME_UNIT_MINUTE, 1, 3000));
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_DAY, 1),
+                      roll_up(times, values, SMALLTIME_UNIT_DAY, 1, times.size()));
+        // Adding more values after getting the groups.
+        smalltime_rollup* rollup = smalltime_rollup_new(SMALLTIME_UNIT_MINUTE, 5);
+        size_t half = times.size() / 2;
+        ASSERT_TRUE(smalltime_rollup_add(rollup, times.data(), values.data(), half));
+        rollup_groups(rollup);
+        ASSERT_TRUE(smalltime_rollup_add(rollup, times.data() + half, values.data() + half, times.size() - half));
+        expect_groups(expected_groups(times, values, SMALLTIME_UNIT_MINUTE, 5), rollup_groups(rollup));
+        smalltime_rollup_free(rollup);
+    });
+}
+
+TEST(Rollup, same_sums_for_every_isa)
+{
+    // Fractional values make the order of the additions matter.
+    std::vector<smalltime> times;
+    std::vector<double> values;
+    make_events(20000, 4, times, values);
+    for(double& value: values)
+    {
+        value /= 7;
+    }
+    smalltime_set_isa(SMALLTIME_ISA_SCALAR);
+    std::vector<smalltime_group> scalar = roll_up(times, values, SMALLTIME_UNIT_MINUTE, 1, times.size());
+    for_each_isa([&]
+    {
+        expect_groups(scalar, roll_up(times, values, SMALLTIME_UNIT_MINUTE, 1, times.size()));
+    });
+}
+
+TEST(Rollup, negative_years)
+{
+    // Decades either side of year 0, fed in both orders.
+    std::vector<smalltime> times;
+    std::vector<double> values;
+    for(int year = -35; year <= 35; year++)
+    {
+        for(int month = 1; month <= 12; month++)
+        {
+            times.push_back(smalltime_new(year, month, 1, 0, 0, 0, 0));
+            values.push_back(year);
+        }
+    }
+    for_each_isa([&]
+    {
+        std::vector<smalltime_group> expected = expected_groups(times, values, SMALLTIME_UNIT_YEAR, 10);
+        ASSERT_EQ(8u, expected.size());
+        ASSERT_EQ(smalltime_new(-40, 1, 1, 0, 0, 0, 0), expected[0].bucket);
+        expect_groups(expected, roll_up(times, values, SMALLTIME_UNIT_YEAR, 10, times.size()));
+        std::vector<smalltime> reversed_times(times.rbegin(), times.rend());
+        std::vector<double> reversed_values(values.rbegin(), values.rend());
+        expect_groups(expected, roll_up(reversed_times, reversed_values, SMALLTIME_UNIT_YEAR, 10, times.size()));
+    });
+}
+
+TEST(Rollup, nanotime)
+{
+    std::vector<nanotime> times;
+    std::vector<double> values;
+    for(int i = 0; i < 10000; i++)
+    {
+        times.push_back(nanotime_new(2018, 1, 1, 0, 0, i / 1000, (i % 1000) * 997));
+        values.push_back(i % 13);
+    }
+    nanotime_rollup* rollup = nanotime_rollup_new(SMALLTIME_UNIT_MICROSECOND, 100);
+    ASSERT_TRUE(nanotime_rollup_add(rollup, times.data(), values.data(), times.size()));
+    std::vector<nanotime_group> groups(nanotime_rollup_groups(rollup, nullptr, 0));
+    nanotime_rollup_groups(rollup, groups.data(), groups.size());
+    nanotime_rollup_free(rollup);
+
+    // Each second's 1000 values spread over 997 microseconds.
+    ASSERT_EQ(100u, groups.size());
+    size_t total = 0;
+    for(const nanotime_group& group: groups)
+    {
+        ASSERT_EQ(group.bucket, nanotime_truncate_to_multiple(group.bucket, SMALLTIME_UNIT_MICROSECOND, 100));
+        total += group.count;
+    }
+    ASSERT_EQ(times.size(), total);
+    ASSERT_EQ(nanotime_new(2018, 1, 1, 0, 0, 0, 0), groups[0].bucket);
+    ASSERT_EQ(nanotime_new(2018, 1, 1, 0, 0, 9, 900000), groups[99].bucket);
+    ASSERT_EQ(101u, groups[0].count);
+    ASSERT_EQ(0, groups[0].min);
+    ASSERT_EQ(12, groups[0].max);
+}
+
+TEST(Rollup, leap_second)
+{
+    std::vector<smalltime> times = {smalltime_new(2016, 12, 31, 23, 59, 50, 0), smalltime_new(2016, 12, 31, 23, 59, 59, 0),
+                                    smalltime_new(2016, 12, 31, 23, 59, 60, 0), smalltime_new(2016, 12, 31, 23, 59, 60, 999999),
+                                    smalltime_new(2017, 1, 1, 0, 0, 0, 0)};
+    std::vector<double> values = {1, 2, 3, 4, 5};
+    for_each_isa([&]
+    {
+        for(int width: {1, 7, 15, 30, 60})
+        {
+            SCOPED_TRACE(width);
+            expect_groups(expected_groups(times, values, SMALLTIME_UNIT_SECOND, width),
+                          roll_up(times, values, SMALLTIME_UNIT_SECOND, width, times.size()));
+            expect_groups(expected_groups(times, values, SMALLTIME_UNIT_SECOND, width),
+                          roll_up(times, values, SMALLTIME_UNIT_SECOND, width, 1));
+        }
+        std::vector<smalltime_group> groups = roll_up(times, values, SMALLTIME_UNIT_SECOND, 15, times.size());
+        ASSERT_EQ(2u, groups.size());
+        ASSERT_EQ(smalltime_new(2016, 12, 31, 23, 59, 45, 0), groups[0].bucket);
+        ASSERT_EQ(4u, groups[0].count);
+        ASSERT_EQ(smalltime_new(2017, 1, 1, 0, 0, 0, 0), groups[1].bucket);
+    });
+}
+
+TEST(Rollup, edges)
+{
+    ASSERT_EQ(nullptr, smalltime_rollup_new((smalltime_unit)99, 1));
+    smalltime_rollup_free(nullptr);
+
+    smalltime_rollup* rollup = smalltime_rollup_new(SMALLTIME_UNIT_SECOND, 1);
+    ASSERT_EQ(0u, smalltime_rollup_groups(rollup, nullptr, 0));
+    ASSERT_TRUE(smalltime_rollup_add(rollup, nullptr, nullptr, 0));
+
+    // NaN is left out of the minimum and maximum, but not the sum.
+    std::vector<smalltime> times(20, smalltime_new(2018, 1, 1, 0, 0, 0, 0));
+    std::vector<double> values(20, 1.0);
+    values[3] = NAN;
+    values[17] = NAN;
+    ASSERT_TRUE(smalltime_rollup_add(rollup, times.data(), values.data(), times.size()));
+    smalltime_group group;
+    ASSERT_EQ(1u, smalltime_rollup_groups(rollup, &group, 1));
+    ASSERT_EQ(20u, group.count);
+    ASSERT_TRUE(std::isnan(group.sum));
+    ASSERT_EQ(1.0, group.min);
+    ASSERT_EQ(1.0, group.max);
+    smalltime_rollup_free(rollup);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <smalltime/sort.h>
+#include <smalltime/epoch.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Events from within an hour, about a fifth of them duplicated.
+static std::vector<smalltime> smalltime_events(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<smalltime> values;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(i > 0 && rng() % 5 == 0)
+        {
+            values.push_back(values[rng() % i]);
+            continue;
+        }
+        values.push_back(smalltime_from_unix_microseconds(1500000000LL * 1000000 + (int64_t)(rng() % 3600000000LL)));
+    }
+    return values;
+}
+
+static std::vector<uint64_t> random_bits(size_t count, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> values(count);
+    for(auto& value: values)
+    {
+        value = rng();
+    }
+    return values;
+}
+
+static void expect_smalltime_sorted(const std::vector<smalltime>& values, unsigned threads)
+{
+    std::vector<smalltime> sorted = values;
+    ASSERT_TRUE(smalltime_sort(sorted.data(), NULL, sorted.size(), threads));
+    std::vector<smalltime> expected = values;
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected, sorted);
+
+    // Stable, so equal values keep the order of their indices.
+    std::vector<size_t> indices(values.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    sorted = values;
+    ASSERT_TRUE(smalltime_sort(sorted.data(), indices.data(), sorted.size(), threads));
+    std::vector<size_t> expected_indices(values.size());
+    std::iota(expected_indices.begin(), expected_indices.end(), 0);
+    std::stable_sort(expected_indices.begin(), expected_indices.end(), [&](size_t a, size_t b)
+    {
+        return values[a] < values[b];
+    });
+    ASSERT_EQ(expected, sorted);
+    ASSERT_EQ(expected_indices, indices);
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Sort, lengths)
+{
+    for(size_t count: {0, 1, 2, 63, 64, 65, 1000, 100000})
+    {
+        SCOPED_TRACE(count);
+        expect_smalltime_sorted(smalltime_events(count, count), 1);
+    }
+}
+
+TEST(Sort, threads)
+{
+    // Enough for several threads, with slices of uneven length.
+    std::vector<smalltime> values = smalltime_events(65536 * 5 + 3, 1);
+    for(unsigned threads: {0, 2, 3, 5, 100})
+    {
+        SCOPED_TRACE(threads);
+        expect_smalltime_sorted(values, threads);
+    }
+}
+
+TEST(Sort, negative_smalltime)
+{
+    std::vector<smalltime> values;
+    for(uint64_t bits: random_bits(100000, 2))
+    {
+        values.push_back((smalltime)bits);
+    }
+    expect_smalltime_sorted(values, 1);
+    expect_smalltime_sorted(values, 2);
+    values.resize(50);
+    expect_smalltime_sorted(values, 1);
+}
+
+TEST(Sort, every_digit_constant)
+{
+    std::vector<smalltime> values(1000, smalltime_new(2000, 1, 1, 0, 0, 0, 0));
+    expect_smalltime_sorted(values, 1);
+}
+
+TEST(Sort, nanotime)
+{
+    // Unsigned, so values with the top bit set sort last.
+    for(size_t count: {50, 200000})
+    {
+        std::vector<nanotime> values = random_bits(count, 3);
+        std::vector<size_t> indices(count);
+        std::iota(indices.begin(), indices.end(), 0);
+        std::vector<nanotime> sorted = values;
+        ASSERT_TRUE(nanotime_sort(sorted.data(), indices.data(), count, 2));
+        std::vector<nanotime> expected = values;
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(expected, sorted);
+        for(size_t i = 0; i < count; i++)
+        {
+            ASSERT_EQ(sorted[i], values[indices[i]]);
+        }
+    }
+}
@@ -0,0 +1,520 @@
+#include <gtest/gtest.h>
+#include <smalltime/tz.h>
+#include <smalltime/epoch.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+struct tzif_type
+{
+    int32_t offset;
+    bool is_dst;
+    std::string name;
+};
+
+static void put_be32(std::string& out, uint32_t value)
+{
+    for(int shift = 24; shift >= 0; shift -= 8)
+    {
+        out.push_back((char)(value >> shift));
+    }
+}
+
+static void put_be64(std::string& out, int64_t value)
+{
+    put_be32(out, (uint32_t)((uint64_t)value >> 32));
+    put_be32(out, (uint32_t)value);
+}
+
+// A TZif header and data block, with 32-bit or 64-bit times.
+static std::string tzif_block(char version, const std::vector<int64_t>& times, const std::vector<uint8_t>& type_indices,
+                              const std::vector<tzif_type>& types, int time_size)
+{
+    std::string chars;
+    std::vector<uint8_t> name_indices;
+    for(const auto& type: types)
+    {
+        name_indices.push_back((uint8_t)chars.size());
+        chars += type.name;
+        chars.push_back(0);
+    }
+
+    std::string out = "TZif";
+    out.push_back(version);
+    out.append(15, 0);
+    put_be32(out, 0);
+    put_be32(out, 0);
+    put_be32(out, 0);
+    put_be32(out, (uint32_t)times.size());
+    put_be32(out, (uint32_t)types.size());
+    put_be32(out, (uint32_t)chars.size());
+    for(int64_t time: times)
+    {
+        time_size == 8 ? put_be64(out, time) : put_be32(out, (uint32_t)time);
+    }
+    for(uint8_t index: type_indices)
+    {
+        out.push_back((char)index);
+    }
+    for(size_t i = 0; i < types.size(); i++)
+    {
+        put_be32(out, (uint32_t)types[i].offset);
+        out.push_back(types[i].is_dst);
+        out.push_back((char)name_indices[i]);
+    }
+    return out + chars;
+}
+
+static std::string make_tzif(const std::vector<int64_t>& times, const std::vector<uint8_t>& type_indices,
+                             const std::vector<tzif_type>& types, const std::string& footer)
+{
+    return tzif_block('2', {}, {}, {types[0]}, 4) + tzif_block('2', times, type_indices, types, 8) + "\n" + footer + "\n";
+}
+
+static const std::vector<tzif_type> eastern_types = {{-18000, false, "EST"}, {-14400, true, "EDT"}};
+
+// New York time, with the 2018 transitions given and the rest from the footer.
+static std::string eastern_tzif()
+{
+    return make_tzif({1520751600, 1541311200}, {1, 0}, eastern_types, "EST5EDT,M3.2.0,M11.1.0");
+}
+
+static std::string temp_directory()
+{
+    return ::testing::TempDir() + "smalltime_tz";
+}
+
+static void write_file(const std::string& path, const std::string& data)
+{
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ofstream(path, std::ios::binary) << data;
+}
+
+static smalltime_tz* open_zone(const std::string& name, const std::string& data)
+{
+    std::string path = temp_directory() + "/" + name;
+    write_file(path, data);
+    smalltime_tz* zone = smalltime_tz_open(path.c_str());
+    std::remove(path.c_str());
+    return zone;
+}
+
+static smalltime st(int year, int month, int day, int hour, int minute, int second = 0, int microsecond = 0)
+{
+    return smalltime_new(year, month, day, hour, minute, second, microsecond);
+}
+
+// Day number of the nth (or, for 5, the last) Sunday of a month.
+static int64_t nth_sunday(int year, int month, int n)
+{
+    int64_t first = smalltime_days_from_civil(year, month, 1);
+    int64_t sunday = first + (7 - (first + 4) % 7) % 7;
+    int64_t day = sunday + (n - 1) * 7;
+    while(day >= first + smalltime_days_in_month(year, month))
+    {
+        day -= 7;
+    }
+    return day;
+}
+
+// The New York offset, worked out from the rule directly.
+static int32_t reference_eastern_offset(int64_t seconds)
+{
+    if(seconds < 1520751600)
+    {
+        return -18000;
+    }
+    int year = smalltime_get_year(smalltime_from_unix_seconds(seconds));
+    int64_t start = nth_sunday(year, 3, 2) * 86400 + 7 * 3600;
+    int64_t end = nth_sunday(year, 11, 1) * 86400 + 6 * 3600;
+    return seconds >= start && seconds < end ? -14400 : -18000;
+}
+
+static void expect_from_local(const smalltime_tz* zone, smalltime local, smalltime_tz_ambiguous ambiguous, smalltime_tz_gap gap,
+                              int expected_success, smalltime expected)
+{
+    smalltime result = 12345;
+    EXPECT_EQ(expected_success, smalltime_tz_from_local(zone, local, ambiguous, gap, &result));
+    EXPECT_EQ(expected_success ? expected : 12345, result);
+}
+
+// Clustered values (every 7 minutes and a bit), then scattered ones.
+static std::vector<smalltime> test_values()
+{
+    std::vector<smalltime> values;
+    int64_t start = smalltime_to_unix_seconds(st(2017, 10, 1, 0, 0));
+    for(int64_t i = 0; i < 200000; i++)
+    {
+        values.push_back(smalltime_from_unix_microseconds((start + i * 421) * 1000000 + i % 1000000));
+    }
+    std::mt19937_64 rng(24);
+    for(int i = 0; i < 20000; i++)
+    {
+        values.push_back(smalltime_from_unix_seconds((int64_t)(rng() % 10000000000ULL)));
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Tz, to_local)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    EXPECT_EQ(st(2018, 1, 15, 7, 0), smalltime_tz_to_local(zone, st(2018, 1, 15, 12, 0)));
+    EXPECT_EQ(st(2018, 7, 1, 8, 0), smalltime_tz_to_local(zone, st(2018, 7, 1, 12, 0)));
+    EXPECT_EQ(st(2018, 3, 11, 1, 59, 59, 999999), smalltime_tz_to_local(zone, st(2018, 3, 11, 6, 59, 59, 999999)));
+    EXPECT_EQ(st(2018, 3, 11, 3, 0), smalltime_tz_to_local(zone, st(2018, 3, 11, 7, 0)));
+    EXPECT_EQ(st(2018, 11, 4, 1, 59, 59), smalltime_tz_to_local(zone, st(2018, 11, 4, 5, 59, 59)));
+    EXPECT_EQ(st(2018, 11, 4, 1, 0), smalltime_tz_to_local(zone, st(2018, 11, 4, 6, 0)));
+    EXPECT_EQ(st(2017, 12, 31, 19, 0), smalltime_tz_to_local(zone, st(2018, 1, 1, 0, 0)));
+    EXPECT_EQ(st(2016, 12, 31, 18, 59, 60, 500000), smalltime_tz_to_local(zone, st(2016, 12, 31, 23, 59, 60, 500000)));
+    EXPECT_EQ(st(-5000, 2, 28, 19, 0), smalltime_tz_to_local(zone, st(-5000, 3, 1, 0, 0)));
+
+    EXPECT_EQ(-18000, smalltime_tz_offset(zone, st(2018, 1, 15, 12, 0)));
+    EXPECT_EQ(-14400, smalltime_tz_offset(zone, st(2018, 7, 1, 12, 0)));
+    EXPECT_STREQ("EST", smalltime_tz_abbreviation(zone, st(2018, 1, 15, 12, 0)));
+    EXPECT_STREQ("EDT", smalltime_tz_abbreviation(zone, st(2018, 7, 1, 12, 0)));
+    EXPECT_STREQ("EDT", smalltime_tz_abbreviation(zone, st(2100, 7, 1, 12, 0)));
+    EXPECT_STREQ("EST", nanotime_tz_abbreviation(zone, nanotime_new(2100, 12, 1, 12, 0, 0, 0)));
+    EXPECT_EQ(-14400, nanotime_tz_offset(zone, nanotime_new(2200, 7, 1, 12, 0, 0, 0)));
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, follows_the_footer_rule_in_every_cycle)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    std::mt19937_64 rng(1);
+    int64_t first = smalltime_to_unix_seconds(st(2018, 1, 1, 0, 0));
+    int64_t last = smalltime_to_unix_seconds(st(131000, 1, 1, 0, 0));
+    std::uniform_int_distribution<int64_t> seconds(first, last);
+    for(int i = 0; i < 200000; i++)
+    {
+        // Half of them near a transition.
+        int64_t t = seconds(rng);
+        if(i % 2 == 0)
+        {
+            int year = smalltime_get_year(smalltime_from_unix_seconds(t));
+            t = (i % 4 == 0 ? nth_sunday(year, 3, 2) * 86400 + 7 * 3600 : nth_sunday(year, 11, 1) * 86400 + 6 * 3600) + (int64_t)(rng() % 7200) - 3600;
+        }
+        int32_t offset = reference_eastern_offset(t);
+        smalltime utc = smalltime_from_unix_seconds(t);
+        ASSERT_EQ(offset, smalltime_tz_offset(zone, utc)) << t;
+        ASSERT_EQ(smalltime_from_unix_seconds(t + offset), smalltime_tz_to_local(zone, utc)) << t;
+    }
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, from_local_resolves_gaps_and_overlaps)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    const auto earlier = SMALLTIME_TZ_AMBIGUOUS_EARLIER;
+    const auto later = SMALLTIME_TZ_AMBIGUOUS_LATER;
+    const auto reject_ambiguous = SMALLTIME_TZ_AMBIGUOUS_REJECT;
+    const auto shift = SMALLTIME_TZ_GAP_SHIFT_FORWARD;
+    const auto next = SMALLTIME_TZ_GAP_NEXT_VALID;
+    const auto reject_gap = SMALLTIME_TZ_GAP_REJECT;
+
+    expect_from_local(zone, st(2018, 1, 15, 7, 0), reject_ambiguous, reject_gap, 1, st(2018, 1, 15, 12, 0));
+    expect_from_local(zone, st(2018, 7, 1, 8, 0), reject_ambiguous, reject_gap, 1, st(2018, 7, 1, 12, 0));
+
+    // 02:00 - 03:00 doesn't exist.
+    expect_from_local(zone, st(2018, 3, 11, 1, 59, 59), reject_ambiguous, reject_gap, 1, st(2018, 3, 11, 6, 59, 59));
+    expect_from_local(zone, st(2018, 3, 11, 2, 30, 0, 250), earlier, shift, 1, st(2018, 3, 11, 7, 30, 0, 250));
+    expect_from_local(zone, st(2018, 3, 11, 2, 30, 0, 250), earlier, next, 1, st(2018, 3, 11, 7, 0));
+    expect_from_local(zone, st(2018, 3, 11, 2, 30), earlier, reject_gap, 0, 0);
+    expect_from_local(zone, st(2018, 3, 11, 3, 0), reject_ambiguous, reject_gap, 1, st(2018, 3, 11, 7, 0));
+
+    // 01:00 - 02:00 happens twice.
+    expect_from_local(zone, st(2018, 11, 4, 0, 59, 59), reject_ambiguous, reject_gap, 1, st(2018, 11, 4, 4, 59, 59));
+    expect_from_local(zone, st(2018, 11, 4, 1, 30), earlier, reject_gap, 1, st(2018, 11, 4, 5, 30));
+    expect_from_local(zone, st(2018, 11, 4, 1, 30), later, reject_gap, 1, st(2018, 11, 4, 6, 30));
+    expect_from_local(zone, st(2018, 11, 4, 1, 30), reject_ambiguous, shift, 0, 0);
+    expect_from_local(zone, st(2018, 11, 4, 2, 0), reject_ambiguous, reject_gap, 1, st(2018, 11, 4, 7, 0));
+
+    // The same, from the footer rule, in later cycles.
+    for(int year: {2030, 2500, 9999, 130000})
+    {
+        SCOPED_TRACE(year);
+        int spring_day, fall_day, month, ignored;
+        smalltime_civil_from_days((int32_t)nth_sunday(year, 3, 2), &ignored, &month, &spring_day);
+        smalltime_civil_from_days((int32_t)nth_sunday(year, 11, 1), &ignored, &month, &fall_day);
+        expect_from_local(zone, st(year, 3, spring_day, 2, 30), earlier, shift, 1, st(year, 3, spring_day, 7, 30));
+        expect_from_local(zone, st(year, 3, spring_day, 2, 30), earlier, next, 1, st(year, 3, spring_day, 7, 0));
+        expect_from_local(zone, st(year, 3, spring_day, 2, 30), earlier, reject_gap, 0, 0);
+        expect_from_local(zone, st(year, 11, fall_day, 1, 30), earlier, reject_gap, 1, st(year, 11, fall_day, 5, 30));
+        expect_from_local(zone, st(year, 11, fall_day, 1, 30), later, reject_gap, 1, st(year, 11, fall_day, 6, 30));
+        expect_from_local(zone, st(year, 11, fall_day, 1, 30), reject_ambiguous, reject_gap, 0, 0);
+        expect_from_local(zone, st(year, 6, 1, 20, 0), reject_ambiguous, reject_gap, 1, st(year, 6, 2, 0, 0));
+    }
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, from_local_undoes_to_local)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    for(smalltime utc: test_values())
+    {
+        smalltime local = smalltime_tz_to_local(zone, utc);
+        smalltime earlier = 0;
+        smalltime later = 0;
+        ASSERT_TRUE(smalltime_tz_from_local(zone, local, SMALLTIME_TZ_AMBIGUOUS_EARLIER, SMALLTIME_TZ_GAP_REJECT, &earlier));
+        ASSERT_TRUE(smalltime_tz_from_local(zone, local, SMALLTIME_TZ_AMBIGUOUS_LATER, SMALLTIME_TZ_GAP_REJECT, &later));
+        ASSERT_TRUE(earlier == utc || later == utc) << utc;
+    }
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, southern_hemisphere_footer_only)
+{
+    // No transitions at all, so the footer rule applies from 1970.
+    smalltime_tz* zone = open_zone("sydney", make_tzif({}, {}, {{36000, false, "AEST"}}, "AEST-10AEDT,M10.1.0,M4.1.0/3"));
+    ASSERT_NE(nullptr, zone);
+    EXPECT_EQ(39600, smalltime_tz_offset(zone, st(2018, 1, 15, 0, 0)));
+    EXPECT_EQ(36000, smalltime_tz_offset(zone, st(2018, 7, 1, 0, 0)));
+    EXPECT_STREQ("AEDT", smalltime_tz_abbreviation(zone, st(3000, 1, 15, 0, 0)));
+    EXPECT_STREQ("AEST", smalltime_tz_abbreviation(zone, st(3000, 7, 15, 0, 0)));
+    // DST ends 2018-04-01 at 03:00 local (16:00 UTC the day before).
+    EXPECT_EQ(st(2018, 4, 1, 2, 59, 59), smalltime_tz_to_local(zone, st(2018, 3, 31, 15, 59, 59)));
+    EXPECT_EQ(st(2018, 4, 1, 2, 0), smalltime_tz_to_local(zone, st(2018, 3, 31, 16, 0)));
+    smalltime_tz_close(zone);
+
+    zone = open_zone("lord_howe", make_tzif({}, {}, {{37800, false, "+1030"}}, "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0"));
+    ASSERT_NE(nullptr, zone);
+    EXPECT_EQ(39600, smalltime_tz_offset(zone, st(2018, 1, 15, 0, 0)));
+    EXPECT_EQ(37800, smalltime_tz_offset(zone, st(2018, 7, 1, 0, 0)));
+    EXPECT_STREQ("+11", smalltime_tz_abbreviation(zone, st(2018, 1, 15, 0, 0)));
+    EXPECT_STREQ("+1030", smalltime_tz_abbreviation(zone, st(2018, 7, 1, 0, 0)));
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, nanotime)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    nanotime result = 12345;
+    EXPECT_TRUE(nanotime_tz_to_local(zone, nanotime_new(2018, 7, 1, 12, 0, 0, 123456789), &result));
+    EXPECT_EQ(nanotime_new(2018, 7, 1, 8, 0, 0, 123456789), result);
+    EXPECT_FALSE(nanotime_tz_to_local(zone, nanotime_new(1970, 1, 1, 2, 0, 0, 0), &result));
+    EXPECT_EQ(nanotime_new(2018, 7, 1, 8, 0, 0, 123456789), result);
+
+    EXPECT_TRUE(nanotime_tz_from_local(zone, nanotime_new(2018, 3, 11, 2, 30, 0, 999), SMALLTIME_TZ_AMBIGUOUS_REJECT, SMALLTIME_TZ_GAP_SHIFT_FORWARD, &result));
+    EXPECT_EQ(nanotime_new(2018, 3, 11, 7, 30, 0, 999), result);
+    EXPECT_TRUE(nanotime_tz_from_local(zone, nanotime_new(2018, 3, 11, 2, 30, 0, 999), SMALLTIME_TZ_AMBIGUOUS_REJECT, SMALLTIME_TZ_GAP_NEXT_VALID, &result));
+    EXPECT_EQ(nanotime_new(2018, 3, 11, 7, 0, 0, 0), result);
+    EXPECT_FALSE(nanotime_tz_from_local(zone, nanotime_new(2018, 11, 4, 1, 30, 0, 0), SMALLTIME_TZ_AMBIGUOUS_REJECT, SMALLTIME_TZ_GAP_NEXT_VALID, &result));
+    EXPECT_FALSE(nanotime_tz_from_local(zone, nanotime_new(2225, 12, 31, 22, 0, 0, 0), SMALLTIME_TZ_AMBIGUOUS_REJECT, SMALLTIME_TZ_GAP_REJECT, &result));
+    EXPECT_EQ(nanotime_new(2018, 3, 11, 7, 0, 0, 0), result);
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, batch_matches_scalar)
+{
+    smalltime_tz* zone = open_zone("eastern", eastern_tzif());
+    ASSERT_NE(nullptr, zone);
+    std::vector<smalltime> values = test_values();
+    // Local times land in the gaps and overlaps too.
+    for(size_t i = 0; i < values.size(); i += 3)
+    {
+        values[i] = smalltime_tz_to_local(zone, values[i]);
+    }
+
+    std::vector<smalltime> results(values.size());
+    smalltime_tz_batch_to_local(zone, values.data(), values.size(), results.data());
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        ASSERT_EQ(smalltime_tz_to_local(zone, values[i]), results[i]) << i;
+    }
+
+    std::vector<nanotime> nanotimes;
+    for(smalltime value: values)
+    {
+        int year = smalltime_get_year(value);
+        nanotimes.push_back(nanotime_new(year < 1970 ? 1970 : year > 2225 ? 2225 : year, smalltime_get_month(value), smalltime_get_day(value),
+                                         smalltime_get_hour(value), smalltime_get_minute(value), smalltime_get_second(value),
+                                         smalltime_get_microsecond(value) * 1000 + 7));
+    }
+    // Local times before 1970.
+    for(size_t i = 5; i < nanotimes.size(); i += 997)
+    {
+        nanotimes[i] = nanotime_new(1970, 1, 1, 2, 0, 0, (int)i);
+    }
+    std::vector<nanotime> nanotime_results(values.size(), 12345);
+    std::vector<uint64_t> failed((values.size() + 63) / 64);
+    size_t flagged = nanotime_tz_batch_to_local(zone, nanotimes.data(), nanotimes.size(), nanotime_results.data(), failed.data());
+    size_t expected_flagged = 0;
+    for(size_t i = 0; i < nanotimes.size(); i++)
+    {
+        nanotime expected = 12345;
+        int success = nanotime_tz_to_local(zone, nanotimes[i], &expected);
+        expected_flagged += !success;
+        ASSERT_EQ(!success, (failed[i / 64] >> (i % 64)) & 1) << i;
+        ASSERT_EQ(expected, nanotime_results[i]) << i;
+    }
+    ASSERT_EQ(expected_flagged, flagged);
+    ASSERT_GT(flagged, 0u);
+
+    for(auto ambiguous: {SMALLTIME_TZ_AMBIGUOUS_EARLIER, SMALLTIME_TZ_AMBIGUOUS_LATER, SMALLTIME_TZ_AMBIGUOUS_REJECT})
+    {
+        for(auto gap: {SMALLTIME_TZ_GAP_SHIFT_FORWARD, SMALLTIME_TZ_GAP_NEXT_VALID, SMALLTIME_TZ_GAP_REJECT})
+        {
+            SCOPED_TRACE(ambiguous * 3 + gap);
+            std::fill(results.begin(), results.end(), 12345);
+            flagged = smalltime_tz_batch_from_local(zone, values.data(), values.size(), ambiguous, gap, results.data(), failed.data());
+            expected_flagged = 0;
+            for(size_t i = 0; i < values.size(); i++)
+            {
+                smalltime expected = 12345;
+                int success = smalltime_tz_from_local(zone, values[i], ambiguous, gap, &expected);
+                expected_flagged += !success;
+                ASSERT_EQ(!success, (failed[i / 64] >> (i % 64)) & 1) << i;
+                ASSERT_EQ(expected, results[i]) << i;
+            }
+            ASSERT_EQ(expected_flagged, flagged);
+            ASSERT_EQ(flagged, smalltime_tz_batch_from_local(zone, values.data(), values.size(), ambiguous, gap, results.data(), NULL));
+
+            std::fill(nanotime_results.begin(), nanotime_results.end(), 12345);
+            flagged = nanotime_tz_batch_from_local(zone, nanotimes.data(), nanotimes.size(), ambiguous, gap, nanotime_results.data(), failed.data());
+            expected_flagged = 0;
+            for(size_t i = 0; i < nanotimes.size(); i++)
+            {
+                nanotime expected = 12345;
+                int success = nanotime_tz_from_local(zone, nanotimes[i], ambiguous, gap, &expected);
+                expected_flagged += !success;
+                ASSERT_EQ(!success, (failed[i / 64] >> (i % 64)) & 1) << i;
+                ASSERT_EQ(expected, nanotime_results[i]) << i;
+            }
+            ASSERT_EQ(expected_flagged, flagged);
+        }
+    }
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, version_1_files)
+{
+    std::string data = tzif_block(0, {1520751600, 1541311200}, {1, 0}, eastern_types, 4);
+    smalltime_tz* zone = open_zone("version_1", data);
+    ASSERT_NE(nullptr, zone);
+    EXPECT_EQ(-14400, smalltime_tz_offset(zone, st(2018, 7, 1, 12, 0)));
+    // No footer, so the last period lasts forever.
+    EXPECT_EQ(-18000, smalltime_tz_offset(zone, st(2019, 7, 1, 12, 0)));
+    smalltime_tz_close(zone);
+}
+
+TEST(Tz, refuses_invalid_files)
+{
+    std::string valid = eastern_tzif();
+    std::string leap_seconds = valid;
+    leap_seconds[valid.find("TZif", 4) + 28 + 3] = 1;
+    std::string bad_type = valid;
+    bad_type[valid.find("TZif", 4) + 44 + 16] = 5;
+    for(const std::string& data: {std::string(), std::string("TZif"), valid.substr(0, 100), std::string("XZif") + valid.substr(4),
+                                  leap_seconds, bad_type, valid.substr(0, valid.size() - 5) + "!!!\n"})
+    {
+        errno = 0;
+        EXPECT_EQ(nullptr, open_zone("invalid", data));
+        EXPECT_EQ(EINVAL, errno);
+    }
+    errno = 0;
+    EXPECT_EQ(nullptr, smalltime_tz_open((temp_directory() + "/does_not_exist").c_str()));
+    EXPECT_EQ(ENOENT, errno);
+}
+
+TEST(Tz, cache)
+{
+    std::string directory = temp_directory() + "/cache";
+    write_file(directory + "/Test/Eastern", eastern_tzif());
+    smalltime_tz_cache* cache = smalltime_tz_cache_open(directory.c_str());
+    ASSERT_NE(nullptr, cache);
+
+    const smalltime_tz* zone = smalltime_tz_cache_get(cache, "Test/Eastern");
+    ASSERT_NE(nullptr, zone);
+    EXPECT_EQ(zone, smalltime_tz_cache_get(cache, "Test/Eastern"));
+    EXPECT_EQ(-14400, smalltime_tz_offset(zone, st(2018, 7, 1, 12, 0)));
+    EXPECT_EQ(nullptr, smalltime_tz_cache_get(cache, "Test/Missing"));
+    for(const char* name: {"", "/etc/passwd", "../cache/Test/Eastern", "Test/../../cache/Test/Eastern", "Test\\Eastern"})
+    {
+        errno = 0;
+        EXPECT_EQ(nullptr, smalltime_tz_cache_get(cache, name)) << name;
+        EXPECT_EQ(EINVAL, errno) << name;
+    }
+    smalltime_tz_cache_close(cache);
+
+    // Threads racing to load the same zones all get the same ones.
+    for(int round = 0; round < 20; round++)
+    {
+        cache = smalltime_tz_cache_open(directory.c_str());
+        std::vector<const smalltime_tz*> zones(8);
+        std::vector<std::thread> threads;
+        for(size_t i = 0; i < zones.size(); i++)
+        {
+            threads.emplace_back([&, i] { zones[i] = smalltime_tz_cache_get(cache, "Test/Eastern"); });
+        }
+        for(auto& thread: threads)
+        {
+            thread.join();
+        }
+        for(const smalltime_tz* loaded: zones)
+        {
+            ASSERT_NE(nullptr, loaded);
+            ASSERT_EQ(zones[0], loaded);
+        }
+        smalltime_tz_cache_close(cache);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+#ifndef _WIN32
+TEST(Tz, matches_the_system_zones)
+{
+    const char* directory = "/usr/share/zoneinfo";
+    if(!std::filesystem::exists(std::string(directory) + "/America/New_York"))
+    {
+        GTEST_SKIP() << "No system zone files";
+    }
+    smalltime_tz_cache* cache = smalltime_tz_cache_open(directory);
+    const char* original = getenv("TZ");
+    std::string saved = original != NULL ? original : "";
+    for(const char* name: {"America/New_York", "Europe/London", "Australia/Lord_Howe", "Asia/Kolkata", "America/Sao_Paulo"})
+    {
+        SCOPED_TRACE(name);
+        const smalltime_tz* zone = smalltime_tz_cache_get(cache, name);
+        ASSERT_NE(nullptr, zone);
+        setenv("TZ", (std::string(":") + name).c_str(), 1);
+        tzset();
+        std::mt19937_64 rng(25);
+        for(int i = 0; i < 20000; i++)
+        {
+            time_t t = (time_t)(rng() % 4000000000ULL) - 1800000000;
+            struct tm local;
+            ASSERT_NE(nullptr, localtime_r(&t, &local));
+            smalltime utc = smalltime_from_unix_seconds(t);
+            ASSERT_EQ(local.tm_gmtoff, smalltime_tz_offset(zone, utc)) << t;
+            ASSERT_STREQ(local.tm_zone, smalltime_tz_abbreviation(zone, utc)) << t;
+            ASSERT_EQ(st(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec),
+                      smalltime_tz_to_local(zone, utc)) << t;
+        }
+    }
+    original != NULL ? setenv("TZ", saved.c_str(), 1) : unsetenv("TZ");
+    tzset();
+    smalltime_tz_cache_close(cache);
+}
+#endif
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <smalltime/validate.h>
+#include "for_each_isa.h"
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+// Values from the whole range, with fields that are out of range about
+// half of the time.
+static std::vector<uint64_t> random_fields(size_t count, uint64_t seed, int nanotime_years)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> values(count);
+    for(auto& value: values)
+    {
+        bool is_wild = rng() % 2;
+        int year = nanotime_years ? 1970 + (int)(rng() % 256) : (int)(rng() % 262144) - 131072;
+        int month = is_wild && rng() % 4 == 0 ? (int)(rng() % 16) : 1 + (int)(rng() % 12);
+        int day = is_wild && rng() % 4 == 0 ? (int)(rng() % 32) : 1 + (int)(rng() % 28) + (rng() % 8 == 0 ? 1 : 0);
+        int hour = is_wild && rng() % 4 == 0 ? (int)(rng() % 32) : (int)(rng() % 24);
+        int minute = is_wild && rng() % 4 == 0 ? (int)(rng() % 64) : (int)(rng() % 60);
+        int second = is_wild && rng() % 4 == 0 ? (int)(rng() % 64) : (int)(rng() % 61);
+        if(nanotime_years)
+        {
+            int nanosecond = is_wild && rng() % 4 == 0 ? (int)(rng() % (1 << 30)) : (int)(rng() % 1000000000);
+            value = nanotime_new(year, month, day, hour, minute, second, nanosecond);
+        }
+        else
+        {
+            int microsecond = is_wild && rng() % 4 == 0 ? (int)(rng() % (1 << 20)) : (int)(rng() % 1000000);
+            value = (uint64_t)smalltime_new(year, month, day, hour, minute, second, microsecond);
+        }
+    }
+    return values;
+}
+
+static std::vector<smalltime> random_smalltimes(size_t count, uint64_t seed)
+{
+    std::vector<uint64_t> bits = random_fields(count, seed, 0);
+    return std::vector<smalltime>(bits.begin(), bits.end());
+}
+
+static std::vector<nanotime> random_nanotimes(size_t count, uint64_t seed)
+{
+    // Keep the normalized values in range.
+    std::vector<uint64_t> bits = random_fields(count, seed, 1);
+    std::vector<nanotime> values;
+    for(uint64_t value: bits)
+    {
+        int year = nanotime_get_year(value);
+        if(year > 1970 && year < 2225)
+        {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Validate, is_valid)
+{
+    EXPECT_TRUE(smalltime_is_valid(smalltime_new(2000, 2, 29, 23, 59, 60, 999999)));
+    EXPECT_TRUE(smalltime_is_valid(smalltime_new(-131072, 1, 1, 0, 0, 0, 0)));
+    EXPECT_TRUE(smalltime_is_valid(smalltime_new(131071, 12, 31, 23, 59, 59, 999999)));
+    EXPECT_TRUE(smalltime_is_valid(smalltime_new(-4, 2, 29, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(1900, 2, 29, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(-100, 2, 29, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 4, 31, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 0, 1, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 13, 1, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 1, 0, 0, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 1, 1, 24, 0, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 1, 1, 0, 60, 0, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 1, 1, 0, 0, 61, 0)));
+    EXPECT_FALSE(smalltime_is_valid(smalltime_new(2000, 1, 1, 0, 0, 0, 1000000)));
+
+    EXPECT_TRUE(nanotime_is_valid(nanotime_new(2000, 2, 29, 23, 59, 60, 999999999)));
+    EXPECT_TRUE(nanotime_is_valid(nanotime_new(2225, 12, 31, 23, 59, 59, 999999999)));
+    EXPECT_FALSE(nanotime_is_valid(nanotime_new(2100, 2, 29, 0, 0, 0, 0)));
+    EXPECT_FALSE(nanotime_is_valid(nanotime_new(2000, 1, 1, 0, 0, 0, 1000000000)));
+    EXPECT_FALSE(nanotime_is_valid(0));
+}
+
+TEST(Validate, normalize)
+{
+    EXPECT_EQ(smalltime_new(2001, 3, 2, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2001, 2, 30, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2000, 3, 1, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 2, 30, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2000, 2, 29, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 3, 0, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(1999, 12, 31, 12, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 1, 0, 12, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2001, 1, 15, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 13, 15, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2001, 3, 31, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 15, 31, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(1999, 12, 15, 0, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 0, 15, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(-2, 12, 15, 0, 0, 0, 0), smalltime_normalize(smalltime_new(-1, 0, 15, 0, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2000, 1, 2, 7, 0, 0, 0), smalltime_normalize(smalltime_new(2000, 1, 1, 31, 0, 0, 0)));
+    EXPECT_EQ(smalltime_new(2000, 1, 1, 1, 4, 3, 0), smalltime_normalize(smalltime_new(2000, 1, 1, 0, 63, 63, 0)));
+    EXPECT_EQ(smalltime_new(2000, 1, 1, 0, 0, 1, 48575), smalltime_normalize(smalltime_new(2000, 1, 1, 0, 0, 0, 1048575)));
+    // A leap second is only kept while the value is otherwise valid.
+    EXPECT_EQ(smalltime_new(2001, 1, 1, 0, 0, 1, 0), smalltime_normalize(smalltime_new(2000, 12, 31, 23, 59, 60, 1000000)));
+    EXPECT_EQ(smalltime_new(2000, 12, 31, 23, 59, 60, 0), smalltime_normalize(smalltime_new(2000, 12, 31, 23, 59, 60, 0)));
+
+    EXPECT_EQ(nanotime_new(2001, 3, 2, 0, 0, 0, 5), nanotime_normalize(nanotime_new(2001, 2, 30, 0, 0, 0, 5)));
+    EXPECT_EQ(nanotime_new(2000, 1, 1, 0, 0, 1, 73741823), nanotime_normalize(nanotime_new(2000, 1, 1, 0, 0, 0, 1073741823)));
+    EXPECT_EQ(nanotime_new(1970, 12, 1, 0, 0, 0, 0), nanotime_normalize(nanotime_new(1971, 0, 1, 0, 0, 0, 0)));
+}
+
+TEST(Validate, normalized_values_are_valid)
+{
+    for(smalltime value: random_smalltimes(100000, 1))
+    {
+        smalltime normalized = smalltime_normalize(value);
+        int year = smalltime_get_year(value);
+        if(year > -131072 && year < 131071)
+        {
+            ASSERT_TRUE(smalltime_is_valid(normalized)) << std::hex << value;
+        }
+        if(smalltime_is_valid(value))
+        {
+            ASSERT_EQ(value, normalized);
+        }
+    }
+    for(nanotime value: random_nanotimes(100000, 2))
+    {
+        nanotime normalized = nanotime_normalize(value);
+        ASSERT_TRUE(nanotime_is_valid(normalized)) << std::hex << value;
+        if(nanotime_is_valid(value))
+        {
+            ASSERT_EQ(value, normalized);
+        }
+    }
+}
+
+TEST(Validate, batch_validate)
+{
+    for_each_isa([&]
+    {
+        for(size_t count: {0, 1, 63, 64, 65, 1000})
+        {
+            std::vector<smalltime> smalltimes = random_smalltimes(count, count);
+            std::vector<nanotime> nanotimes = random_nanotimes(count, count);
+            std::vector<uint64_t> invalid((count + 63) / 64);
+
+            size_t expected = 0;
+            size_t invalid_count = smalltime_batch_validate(smalltimes.data(), smalltimes.size(), invalid.data());
+            for(size_t i = 0; i < smalltimes.size(); i++)
+            {
+                bool is_invalid = !smalltime_is_valid(smalltimes[i]);
+                expected += is_invalid;
+                ASSERT_EQ(is_invalid, (invalid[i / 64] >> (i % 64)) & 1) << i;
+            }
+            EXPECT_EQ(expected, invalid_count);
+            EXPECT_EQ(expected, smalltime_batch_validate(smalltimes.data(), smalltimes.size(), NULL));
+
+            expected = 0;
+            invalid_count = nanotime_batch_validate(nanotimes.data(), nanotimes.size(), invalid.data());
+            for(size_t i = 0; i < nanotimes.size(); i++)
+            {
+                bool is_invalid = !nanotime_is_valid(nanotimes[i]);
+                expected += is_invalid;
+                ASSERT_EQ(is_invalid, (invalid[i / 64] >> (i % 64)) & 1) << i;
+            }
+            EXPECT_EQ(expected, invalid_count);
+        }
+    });
+}
+
+TEST(Validate, batch_normalize)
+{
+    for_each_isa([&]
+    {
+        std::vector<smalltime> smalltimes = random_smalltimes(1000, 3);
+        std::vector<smalltime> smalltime_results(smalltimes.size());
+        size_t expected = 0;
+        for(smalltime value: smalltimes)
+        {
+            expected += !smalltime_is_valid(value);
+        }
+        EXPECT_EQ(expected, smalltime_batch_normalize(smalltimes.data(), smalltimes.size(), smalltime_results.data()));
+        for(size_t i = 0; i < smalltimes.size(); i++)
+        {
+            ASSERT_EQ(smalltime_normalize(smalltimes[i]), smalltime_results[i]);
+        }
+        smalltime_batch_normalize(smalltimes.data(), smalltimes.size(), smalltimes.data());
+        EXPECT_EQ(smalltime_results, smalltimes);
+
+        std::vector<nanotime> nanotimes = random_nanotimes(1000, 4);
+        std::vector<nanotime> nanotime_results(nanotimes.size());
+        nanotime_batch_normalize(nanotimes.data(), nanotimes.size(), nanotime_results.data());
+        for(size_t i = 0; i < nanotimes.size(); i++)
+        {
+            ASSERT_EQ(nanotime_normalize(nanotimes[i]), nanotime_results[i]);
+        }
+    });
+}
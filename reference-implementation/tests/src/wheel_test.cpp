@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <smalltime/wheel.h>
+#include <smalltime/arith.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+// ==================================================================
+// Helpers
+// ==================================================================
+
+static std::vector<smalltime_expiry> advance(smalltime_wheel* wheel, smalltime now, size_t capacity)
+{
+    std::vector<smalltime_expiry> fired;
+    std::vector<smalltime_expiry> batch(capacity);
+    size_t count;
+    do
+    {
+        count = smalltime_wheel_advance_to(wheel, now, batch.data(), capacity);
+        fired.insert(fired.end(), batch.begin(), batch.begin() + (long)count);
+    } while(count == capacity);
+    return fired;
+}
+
+static std::vector<size_t> contexts(const std::vector<smalltime_expiry>& fired)
+{
+    std::vector<size_t> result;
+    for(const auto& expiry: fired)
+    {
+        result.push_back((size_t)(uintptr_t)expiry.context);
+    }
+    return result;
+}
+
+static void* context(size_t id)
+{
+    return (void*)(uintptr_t)id;
+}
+
+// Microseconds at a random scale, from under a millisecond to a few years.
+static int64_t random_offset(std::mt19937_64& rng)
+{
+    static const int64_t scales[] = {1000, 1000000, 60000000, 3600000000LL, 86400000000LL, 86400000000LL * 1000};
+    return 1 + (int64_t)(rng() % (uint64_t)scales[rng() % 6]);
+}
+
+struct pending_timer
+{
+    smalltime deadline;
+    size_t id;
+    smalltime_timer timer;
+};
+
+
+// ==================================================================
+// Tests
+// ==================================================================
+
+TEST(Wheel, fires_in_order)
+{
+    smalltime start = smalltime_new(2018, 12, 31, 23, 59, 0, 0);
+    smalltime_wheel* wheel = smalltime_wheel_new(start);
+    // Deadlines on every level, added out of order, with a tie.
+    std::vector<smalltime> deadlines =
+    {
+        smalltime_new(2019, 1, 1, 0, 0, 0, 0),
+        smalltime_new(2018, 12, 31, 23, 59, 0, 1),
+        smalltime_new(2018, 12, 31, 23, 59, 0, 2000),
+        smalltime_new(2018, 12, 31, 23, 59, 30, 0),
+        smalltime_new(2019, 3, 1, 0, 0, 0, 0),
+        smalltime_new(2018, 12, 31, 23, 59, 0, 1),
+        smalltime_new(2025, 1, 1, 0, 0, 0, 0),
+    };
+    for(size_t i = 0; i < deadlines.size(); i++)
+    {
+        ASSERT_NE(0u, smalltime_wheel_add(wheel, deadlines[i], context(i)));
+    }
+    ASSERT_EQ(7u, smalltime_wheel_count(wheel));
+
+    ASSERT_EQ((std::vector<size_t>{}), contexts(advance(wheel, start, 4)));
+    ASSERT_EQ((std::vector<size_t>{1, 5, 2}), contexts(advance(wheel, smalltime_new(2018, 12, 31, 23, 59, 29, 999999), 4)));
+    std::vector<smalltime_expiry> fired = advance(wheel, smalltime_new(2019, 6, 1, 0, 0, 0, 0), 1);
+    ASSERT_EQ((std::vector<size_t>{3, 0, 4}), contexts(fired));
+    ASSERT_EQ(deadlines[3], fired[0].deadline);
+    ASSERT_EQ(deadlines[4], fired[2].deadline);
+    ASSERT_EQ(1u, smalltime_wheel_count(wheel));
+    ASSERT_EQ((std::vector<size_t>{6}), contexts(advance(wheel, smalltime_new(2030, 1, 1, 0, 0, 0, 0), 4)));
+    ASSERT_EQ(0u, smalltime_wheel_count(wheel));
+    smalltime_wheel_free(wheel);
+}
+
+TEST(Wheel, cancel)
+{
+    smalltime start = smalltime_new(2018, 1, 1, 0, 0, 0, 0);
+    smalltime_wheel* wheel = smalltime_wheel_new(start);
+    smalltime_timer a = smalltime_wheel_add(wheel, smalltime_new(2018, 1, 1, 0, 0, 1, 0), context(0));
+    smalltime_timer b = smalltime_wheel_add(wheel, smalltime_new(2018, 1, 1, 0, 0, 1, 0), context(1));
+    smalltime_timer c = smalltime_wheel_add(wheel, smalltime_new(2020, 1, 1, 0, 0, 1, 0), context(2));
+    ASSERT_TRUE(smalltime_wheel_cancel(wheel, a));
+    ASSERT_FALSE(smalltime_wheel_cancel(wheel, a));
+    ASSERT_TRUE(smalltime_wheel_cancel(wheel, c));
+    ASSERT_FALSE(smalltime_wheel_cancel(wheel, 0));
+    ASSERT_FALSE(smalltime_wheel_cancel(wheel, 12345));
+    ASSERT_EQ(1u, smalltime_wheel_count(wheel));
+
+    // A new timer reusing a's storage doesn't answer to a's handle.
+    smalltime_timer d = smalltime_wheel_add(wheel, smalltime_new(2018, 1, 1, 0, 0, 2, 0), context(3));
+    ASSERT_NE(a, d);
+    ASSERT_FALSE(smalltime_wheel_cancel(wheel, a));
+
+    ASSERT_EQ((std::vector<size_t>{1, 3}), contexts(advance(wheel, smalltime_new(2021, 1, 1, 0, 0, 0, 0), 8)));
+    ASSERT_FALSE(smalltime_wheel_cancel(wheel, b));
+    smalltime_wheel_free(wheel);
+}
+
+TEST(Wheel, already_due)
+{
+    smalltime start = smalltime_new(2018, 6, 1, 12, 0, 0, 0);
+    smalltime_wheel* wheel = smalltime_wheel_new(start);
+    smalltime_timer past = smalltime_wheel_add(wheel, smalltime_new(2017, 1, 1, 0, 0, 0, 0), context(0));
+    smalltime_wheel_add(wheel, start, context(1));
+    smalltime_wheel_add(wheel, smalltime_new(2018, 6, 1, 12, 0, 0, 1), context(2));
+    ASSERT_TRUE(smalltime_wheel_cancel(wheel, past));
+    // Going back in time only fires what's already due.
+    ASSERT_EQ((std::vector<size_t>{1}), contexts(advance(wheel, smalltime_new(2000, 1, 1, 0, 0, 0, 0), 8)));
+    ASSERT_EQ((std::vector<size_t>{2}), contexts(advance(wheel, smalltime_new(2018, 6, 1, 12, 0, 0, 1), 8)));
+    smalltime_wheel_free(wheel);
+}
+
+TEST(Wheel, random)
+{
+    std::mt19937_64 rng(1);
+    smalltime now = smalltime_new(2018, 2, 27, 23, 0, 0, 0);
+    smalltime_wheel* wheel = smalltime_wheel_new(now);
+    std::vector<pending_timer> pending;
+    size_t next_id = 0;
+    for(int round = 0; round < 2000; round++)
+    {
+        for(int i = 0; i < 20; i++)
+        {
+            smalltime deadline = smalltime_add_microseconds(now, random_offset(rng));
+            if(!pending.empty() && rng() % 8 == 0)
+            {
+                deadline = pending[rng() % pending.size()].deadline;
+            }
+            smalltime_timer timer = smalltime_wheel_add(wheel, deadline, context(next_id));
+            ASSERT_NE(0u, timer);
+            pending.push_back({deadline, next_id++, timer});
+        }
+        for(int i = 0; i < 5 && !pending.empty(); i++)
+        {
+            size_t victim = rng() % pending.size();
+            ASSERT_TRUE(smalltime_wheel_cancel(wheel, pending[victim].timer));
+            pending.erase(pending.begin() + (long)victim);
+        }
+
+        now = smalltime_add_microseconds(now, random_offset(rng) / 16);
+        std::vector<size_t> expected;
+        std::stable_sort(pending.begin(), pending.end(), [](const pending_timer& a, const pending_timer& b)
+        {
+            return a.deadline < b.deadline;
+        });
+        auto due_end = std::upper_bound(pending.begin(), pending.end(), now, [](smalltime value, const pending_timer& timer)
+        {
+            return value < timer.deadline;
+        });
+        for(auto it = pending.begin(); it != due_end; ++it)
+        {
+            expected.push_back(it->id);
+        }
+        pending.erase(pending.begin(), due_end);
+        // Keep the pending timers in the order they were added, for the
+        // stable sort next time.
+        std::sort(pending.begin(), pending.end(), [](const pending_timer& a, const pending_timer& b)
+        {
+            return a.id < b.id;
+        });
+
+        ASSERT_EQ(expected, contexts(advance(wheel, now, 1 + rng() % 64))) << "round " << round;
+        ASSERT_EQ(pending.size(), smalltime_wheel_count(wheel));
+    }
+    smalltime_wheel_free(wheel);
+}
+
+TEST(Wheel, negative_years)
+{
+    smalltime_wheel* wheel = smalltime_wheel_new(smalltime_new(-3, 12, 31, 0, 0, 0, 0));
+    smalltime_wheel_add(wheel, smalltime_new(1, 1, 1, 0, 0, 0, 0), context(0));
+    smalltime_wheel_add(wheel, smalltime_new(-1, 6, 1, 0, 0, 0, 0), context(1));
+    smalltime_wheel_add(wheel, smalltime_new(-2, 1, 1, 0, 0, 0, 5), context(2));
+    smalltime_wheel_add(wheel, smalltime_new(0, 2, 29, 0, 0, 0, 0), context(3));
+    std::vector<smalltime_expiry> fired = advance(wheel, smalltime_new(0, 12, 31, 0, 0, 0, 0), 2);
+    ASSERT_EQ((std::vector<size_t>{2, 1, 3}), contexts(fired));
+    ASSERT_EQ((std::vector<size_t>{0}), contexts(advance(wheel, smalltime_new(1, 1, 1, 0, 0, 0, 0), 2)));
+    smalltime_wheel_free(wheel);
+}
+
+TEST(Wheel, nanotime)
+{
+    nanotime start = nanotime_new(2018, 1, 1, 0, 0, 0, 0);
+    nanotime_wheel* wheel = nanotime_wheel_new(start);
+    std::vector<nanotime> deadlines;
+    for(int i = 0; i < 1000; i++)
+    {
+        deadlines.push_back(nanotime_add_nanoseconds(start, (int64_t)(i * 7919) % 1000 * 1000003 + 1));
+        nanotime_wheel_add(wheel, deadlines.back(), context((size_t)i));
+    }
+    nanotime_wheel_add(wheel, nanotime_new(2200, 1, 1, 0, 0, 0, 0), context(1000));
+    std::sort(deadlines.begin(), deadlines.end());
+
+    std::vector<nanotime_expiry> fired(2000);
+    size_t count = nanotime_wheel_advance_to(wheel, nanotime_new(2100, 1, 1, 0, 0, 0, 0), fired.data(), fired.size());
+    ASSERT_EQ(1000u, count);
+    for(size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(deadlines[i], fired[i].deadline);
+    }
+    ASSERT_EQ(1u, nanotime_wheel_count(wheel));
+    ASSERT_EQ(1u, nanotime_wheel_advance_to(wheel, nanotime_new(2225, 1, 1, 0, 0, 0, 0), fired.data(), fired.size()));
+    ASSERT_EQ(nanotime_new(2200, 1, 1, 0, 0, 0, 0), fired[0].deadline);
+    nanotime_wheel_free(wheel);
+}